@@ -90,6 +90,58 @@ extern void ac_rescale(const uint8_t *src1, const uint8_t *src2,
                        uint8_t *dest, int bytes,
                        uint32_t weight1, uint32_t weight2);
 
+/* Neighbourhood operations: each output sample combines the samples at
+ * the same position in `n' rows.  Pass consecutive lines for a vertical
+ * neighbourhood, or one line at increasing offsets for a horizontal one;
+ * edges are up to the caller. */
+
+/* Mean of the rows, rounded down */
+extern void ac_rows_mean(const uint8_t * const *rows, int n,
+                         uint8_t *dest, int bytes);
+
+/* Minimum and maximum of the rows */
+extern void ac_rows_min(const uint8_t * const *rows, int n,
+                        uint8_t *dest, int bytes);
+extern void ac_rows_max(const uint8_t * const *rows, int n,
+                        uint8_t *dest, int bytes);
+
+/* Weighted sum of the rows (kernel[i] being the weight of rows[i]),
+ * modulo 2^32 */
+extern void ac_rows_convolve(const uint8_t * const *rows,
+                             const uint32_t *kernel, int n,
+                             uint32_t *dest, int count);
+extern void ac_rows_convolve32(const uint32_t * const *rows,
+                               const uint32_t *kernel, int n,
+                               uint32_t *dest, int count);
+
+/* Mean of `n' bytes `step' bytes apart, rounded down:
+ * dest[i] = (src[i] + src[i+step] + ... + src[i+(n-1)*step]) / n */
+extern void ac_box_mean(const uint8_t *src, int n, int step,
+                        uint8_t *dest, int bytes);
+
+/* Template matching: sum of absolute differences between two sets of
+ * data, over the bytes where `mask' is 0xFF (all of them if `mask' is
+ * NULL; other mask values are undefined) */
+extern uint32_t ac_sad(const uint8_t *src1, const uint8_t *src2,
+                       const uint8_t *mask, int bytes);
+
+/* Sums for a normalized cross-correlation over the bytes selected like
+ * for ac_sad(): sums[0] = sum of src, sums[1] = sum of src squared,
+ * sums[2] = sum of src*pattern, all modulo 2^32 (no wrap for up to
+ * 66051 bytes) */
+extern void ac_correlate(const uint8_t *src, const uint8_t *pattern,
+                         const uint8_t *mask, int bytes, uint32_t *sums);
+
+/* Geometric remapping: sets the `count' pixels of `Bpp' bytes each in
+ * `dest' to the bilinear interpolation of the 2x2 pixels of `src'
+ * starting `offset[i]' bytes in (the lower two `stride' bytes after the
+ * upper ones), with weight[i*4..i*4+3] = {128-fx, fx, 128-fy, fy} for
+ * a position of fx/128, fy/128 pixels (0 <= fx,fy < 128) past the
+ * upper left one */
+extern void ac_remap_bilinear(const uint8_t *src, int stride, int Bpp,
+                              const int32_t *offset, const int16_t *weight,
+                              uint8_t *dest, int count);
+
 /* Image format manipulation is available in aclib/imgconvert.h */
 
 /*************************************************************************/
@@ -24,8 +24,11 @@
 
 /* Initialization subfunctions */
 extern int ac_average_init(int accel);
+extern int ac_convolve_init(int accel);
 extern int ac_imgconvert_init(int accel);
+extern int ac_match_init(int accel);
 extern int ac_memcpy_init(int accel);
+extern int ac_remap_init(int accel);
 extern int ac_rescale_init(int accel);
 
 
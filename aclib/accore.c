@@ -30,8 +30,11 @@ int ac_init(int accel)
 {
     accel &= ac_cpuinfo();
     if (!ac_average_init(accel)
+     || !ac_convolve_init(accel)
      || !ac_imgconvert_init(accel)
+     || !ac_match_init(accel)
      || !ac_memcpy_init(accel)
+     || !ac_remap_init(accel)
      || !ac_rescale_init(accel)
     ) {
         return 0;
@@ -0,0 +1,475 @@
+/*
+ * convolve.c -- neighbourhood operations (mean, minimum, maximum,
+ *               weighted sum) over sets of rows of data
+ *
+ * This file is part of transcode, a video stream processing tool.
+ * transcode is free software, distributable under the terms of the GNU
+ * General Public License (version 2 or later).  See the file COPYING
+ * for details.
+ */
+
+#include "ac.h"
+#include "ac_internal.h"
+
+/* Largest number of rows the SSE2 routines handle; more are passed to
+ * the C versions (for the mean, larger sums would overflow the 16-bit
+ * lanes). */
+#define MAX_MEAN_ROWS   16
+#define MAX_CONV_ROWS   64
+
+static void rows_mean(const uint8_t * const *, int, uint8_t *, int);
+static void rows_min(const uint8_t * const *, int, uint8_t *, int);
+static void rows_max(const uint8_t * const *, int, uint8_t *, int);
+static void rows_convolve(const uint8_t * const *, const uint32_t *, int,
+                          uint32_t *, int);
+static void rows_convolve32(const uint32_t * const *, const uint32_t *,
+                            int, uint32_t *, int);
+
+static void (*rows_mean_ptr)(const uint8_t * const *, int, uint8_t *, int)
+     = rows_mean;
+static void (*rows_min_ptr)(const uint8_t * const *, int, uint8_t *, int)
+     = rows_min;
+static void (*rows_max_ptr)(const uint8_t * const *, int, uint8_t *, int)
+     = rows_max;
+static void (*rows_convolve_ptr)(const uint8_t * const *, const uint32_t *,
+                                 int, uint32_t *, int)
+     = rows_convolve;
+static void (*rows_convolve32_ptr)(const uint32_t * const *,
+                                   const uint32_t *, int, uint32_t *, int)
+     = rows_convolve32;
+
+/*************************************************************************/
+
+/* External interface */
+
+void ac_rows_mean(const uint8_t * const *rows, int n,
+                  uint8_t *dest, int bytes)
+{
+    if (n == 1)
+        ac_memcpy(dest, rows[0], bytes);
+    else
+        (*rows_mean_ptr)(rows, n, dest, bytes);
+}
+
+void ac_rows_min(const uint8_t * const *rows, int n,
+                 uint8_t *dest, int bytes)
+{
+    (*rows_min_ptr)(rows, n, dest, bytes);
+}
+
+void ac_rows_max(const uint8_t * const *rows, int n,
+                 uint8_t *dest, int bytes)
+{
+    (*rows_max_ptr)(rows, n, dest, bytes);
+}
+
+void ac_rows_convolve(const uint8_t * const *rows, const uint32_t *kernel,
+                      int n, uint32_t *dest, int count)
+{
+    (*rows_convolve_ptr)(rows, kernel, n, dest, count);
+}
+
+void ac_rows_convolve32(const uint32_t * const *rows,
+                        const uint32_t *kernel, int n,
+                        uint32_t *dest, int count)
+{
+    (*rows_convolve32_ptr)(rows, kernel, n, dest, count);
+}
+
+/* Small windows are summed directly (as rows at increasing offsets, so
+ * they get the accelerated mean); larger ones slide a running sum over
+ * each of the `step' interleaved sequences, which costs the same
+ * whatever the window size. */
+
+void ac_box_mean(const uint8_t *src, int n, int step,
+                 uint8_t *dest, int bytes)
+{
+    int i, j;
+
+    if (n <= MAX_MEAN_ROWS) {
+        const uint8_t *rows[MAX_MEAN_ROWS];
+        for (i = 0; i < n; i++)
+            rows[i] = src + i*step;
+        ac_rows_mean(rows, n, dest, bytes);
+        return;
+    }
+
+    for (j = 0; j < step && j < bytes; j++) {
+        int sum = 0;
+        for (i = 0; i < n; i++)
+            sum += src[j + i*step];
+        for (i = j; i < bytes; i += step) {
+            dest[i] = sum / n;
+            if (i + step < bytes)
+                sum += src[i + n*step] - src[i];
+        }
+    }
+}
+
+/*************************************************************************/
+/*************************************************************************/
+
+/* Vanilla C versions.  Each does samples [start,count), so the
+ * accelerated versions can hand over the samples left at the end. */
+
+static void rows_mean_from(const uint8_t * const *rows, int n,
+                           uint8_t *dest, int start, int bytes)
+{
+    int i, j;
+    for (i = start; i < bytes; i++) {
+        int sum = 0;
+        for (j = 0; j < n; j++)
+            sum += rows[j][i];
+        dest[i] = sum / n;
+    }
+}
+
+static void rows_min_from(const uint8_t * const *rows, int n,
+                          uint8_t *dest, int start, int bytes)
+{
+    int i, j;
+    for (i = start; i < bytes; i++) {
+        uint8_t val = rows[0][i];
+        for (j = 1; j < n; j++) {
+            if (rows[j][i] < val)
+                val = rows[j][i];
+        }
+        dest[i] = val;
+    }
+}
+
+static void rows_max_from(const uint8_t * const *rows, int n,
+                          uint8_t *dest, int start, int bytes)
+{
+    int i, j;
+    for (i = start; i < bytes; i++) {
+        uint8_t val = rows[0][i];
+        for (j = 1; j < n; j++) {
+            if (rows[j][i] > val)
+                val = rows[j][i];
+        }
+        dest[i] = val;
+    }
+}
+
+static void rows_convolve_from(const uint8_t * const *rows,
+                               const uint32_t *kernel, int n,
+                               uint32_t *dest, int start, int count)
+{
+    int i, j;
+    for (i = start; i < count; i++)
+        dest[i] = kernel[0] * rows[0][i];
+    for (j = 1; j < n; j++) {
+        for (i = start; i < count; i++)
+            dest[i] += kernel[j] * rows[j][i];
+    }
+}
+
+static void rows_convolve32_from(const uint32_t * const *rows,
+                                 const uint32_t *kernel, int n,
+                                 uint32_t *dest, int start, int count)
+{
+    int i, j;
+    for (i = start; i < count; i++)
+        dest[i] = kernel[0] * rows[0][i];
+    for (j = 1; j < n; j++) {
+        for (i = start; i < count; i++)
+            dest[i] += kernel[j] * rows[j][i];
+    }
+}
+
+
+static void rows_mean(const uint8_t * const *rows, int n,
+                      uint8_t *dest, int bytes)
+{
+    rows_mean_from(rows, n, dest, 0, bytes);
+}
+
+static void rows_min(const uint8_t * const *rows, int n,
+                     uint8_t *dest, int bytes)
+{
+    rows_min_from(rows, n, dest, 0, bytes);
+}
+
+static void rows_max(const uint8_t * const *rows, int n,
+                     uint8_t *dest, int bytes)
+{
+    rows_max_from(rows, n, dest, 0, bytes);
+}
+
+static void rows_convolve(const uint8_t * const *rows,
+                          const uint32_t *kernel, int n,
+                          uint32_t *dest, int count)
+{
+    rows_convolve_from(rows, kernel, n, dest, 0, count);
+}
+
+static void rows_convolve32(const uint32_t * const *rows,
+                            const uint32_t *kernel, int n,
+                            uint32_t *dest, int count)
+{
+    rows_convolve32_from(rows, kernel, n, dest, 0, count);
+}
+
+/*************************************************************************/
+
+/* SSE2 versions.  They loop over the rows inside the asm block, so row
+ * pointers are loaded from the array 8 bytes at a time: x86_64 only. */
+
+#if defined(HAVE_ASM_SSE2) && defined(ARCH_X86_64)
+
+/* The mean divides with PMULHUW by ceil(65536/n), which gives the
+ * rounded down quotient for every sum of up to 16 bytes. */
+
+static void rows_mean_sse2(const uint8_t * const *rows, int n,
+                           uint8_t *dest, int bytes)
+{
+    long i = 0;
+
+    if (n < 2 || n > MAX_MEAN_ROWS) {
+        rows_mean_from(rows, n, dest, 0, bytes);
+        return;
+    }
+    if (bytes >= 16) {
+        asm("\
+            movd %[magic], %%xmm6                                       \n\
+            pshuflw $0, %%xmm6, %%xmm6                                  \n\
+            punpcklqdq %%xmm6, %%xmm6   # XMM6: divisor, 8 words        \n\
+            pxor %%xmm7, %%xmm7                                         \n\
+            0:                                                          \n\
+            pxor %%xmm0, %%xmm0                                         \n\
+            pxor %%xmm1, %%xmm1                                         \n\
+            mov %[n], %%rcx                                             \n\
+            1:                                                          \n\
+            mov -8(%[rows],%%rcx,8), %%rdx                              \n\
+            movdqu (%%rdx,%[i]), %%xmm2                                 \n\
+            movdqa %%xmm2, %%xmm3                                       \n\
+            punpcklbw %%xmm7, %%xmm2                                    \n\
+            punpckhbw %%xmm7, %%xmm3                                    \n\
+            paddw %%xmm2, %%xmm0                                        \n\
+            paddw %%xmm3, %%xmm1                                        \n\
+            dec %%rcx                                                   \n\
+            jnz 1b                                                      \n\
+            pmulhuw %%xmm6, %%xmm0                                      \n\
+            pmulhuw %%xmm6, %%xmm1                                      \n\
+            packuswb %%xmm1, %%xmm0                                     \n\
+            movdqu %%xmm0, (%[dest],%[i])                               \n\
+            add $16, %[i]                                               \n\
+            cmp %[last], %[i]                                           \n\
+            jle 0b"
+            : [i] "+r" (i)
+            : [rows] "r" (rows), [n] "r" ((long)n), [dest] "r" (dest),
+              [last] "r" ((long)bytes - 16),
+              [magic] "r" ((65536 + n - 1) / n)
+            : "rcx", "rdx", "xmm0", "xmm1", "xmm2", "xmm3", "xmm6",
+              "xmm7", "memory");
+    }
+    if (UNLIKELY(i < bytes))
+        rows_mean_from(rows, n, dest, i, bytes);
+}
+
+/* Minimum and maximum only differ in the instruction */
+
+#define ROWS_MINMAX_SSE2(name,insn)                                     \
+static void rows_##name##_sse2(const uint8_t * const *rows, int n,     \
+                               uint8_t *dest, int bytes)               \
+{                                                                       \
+    long i = 0;                                                         \
+                                                                        \
+    if (bytes >= 16) {                                                  \
+        asm("\
+            0:                                                          \n\
+            mov (%[rows]), %%rdx                                        \n\
+            movdqu (%%rdx,%[i]), %%xmm0                                 \n\
+            mov %[n], %%rcx                                             \n\
+            jmp 2f                                                      \n\
+            1:                                                          \n\
+            mov (%[rows],%%rcx,8), %%rdx                                \n\
+            movdqu (%%rdx,%[i]), %%xmm1                                 \n\
+            " insn " %%xmm1, %%xmm0                                     \n\
+            2:                                                          \n\
+            dec %%rcx                                                   \n\
+            jnz 1b                                                      \n\
+            movdqu %%xmm0, (%[dest],%[i])                               \n\
+            add $16, %[i]                                               \n\
+            cmp %[last], %[i]                                           \n\
+            jle 0b"                                                     \
+            : [i] "+r" (i)                                              \
+            : [rows] "r" (rows), [n] "r" ((long)n), [dest] "r" (dest),  \
+              [last] "r" ((long)bytes - 16)                             \
+            : "rcx", "rdx", "xmm0", "xmm1", "memory");                  \
+    }                                                                   \
+    if (UNLIKELY(i < bytes))                                            \
+        rows_##name##_from(rows, n, dest, i, bytes);                    \
+}
+
+ROWS_MINMAX_SSE2(min, "pminub")
+ROWS_MINMAX_SSE2(max, "pmaxub")
+
+/* 8-bit rows are taken in pairs, interleaved, and multiplied with
+ * PMADDWD by the matching pair of weights; the weights must fit in 15
+ * bits for that, otherwise the C version is used.  An odd row is paired
+ * with itself and a zero weight.  Sums wrap around like in C. */
+
+static void rows_convolve_sse2(const uint8_t * const *rows,
+                               const uint32_t *kernel, int n,
+                               uint32_t *dest, int count)
+{
+    const uint8_t *pairs[MAX_CONV_ROWS+1];
+    int16_t weights[MAX_CONV_ROWS/2][8] __attribute__((aligned(16)));
+    long i = 0;
+    int j, k;
+
+    if (n > MAX_CONV_ROWS) {
+        rows_convolve_from(rows, kernel, n, dest, 0, count);
+        return;
+    }
+    for (j = 0; j < n; j++) {
+        if (kernel[j] > 0x7FFF) {
+            rows_convolve_from(rows, kernel, n, dest, 0, count);
+            return;
+        }
+        pairs[j] = rows[j];
+        for (k = j & 1; k < 8; k += 2)
+            weights[j/2][k] = kernel[j];
+    }
+    if (n & 1) {
+        pairs[n] = rows[n-1];
+        for (k = 1; k < 8; k += 2)
+            weights[n/2][k] = 0;
+    }
+
+    if (count >= 8) {
+        asm("\
+            pxor %%xmm7, %%xmm7                                         \n\
+            0:                                                          \n\
+            pxor %%xmm0, %%xmm0                                         \n\
+            pxor %%xmm1, %%xmm1                                         \n\
+            xor %%rcx, %%rcx                                            \n\
+            1:                                                          \n\
+            mov (%[pairs],%%rcx), %%rdx                                 \n\
+            movq (%%rdx,%[i]), %%xmm2                                   \n\
+            mov 8(%[pairs],%%rcx), %%rdx                                \n\
+            movq (%%rdx,%[i]), %%xmm3                                   \n\
+            punpcklbw %%xmm7, %%xmm2                                    \n\
+            punpcklbw %%xmm7, %%xmm3                                    \n\
+            movdqa %%xmm2, %%xmm4                                       \n\
+            punpcklwd %%xmm3, %%xmm2    # XMM2: A0 B0 A1 B1 ... A3 B3   \n\
+            punpckhwd %%xmm3, %%xmm4    # XMM4: A4 B4 A5 B5 ... A7 B7   \n\
+            pmaddwd (%[weights],%%rcx), %%xmm2                          \n\
+            pmaddwd (%[weights],%%rcx), %%xmm4                          \n\
+            paddd %%xmm2, %%xmm0                                        \n\
+            paddd %%xmm4, %%xmm1                                        \n\
+            add $16, %%rcx                                              \n\
+            cmp %[end], %%rcx                                           \n\
+            jb 1b                                                       \n\
+            movdqu %%xmm0, (%[dest],%[i],4)                             \n\
+            movdqu %%xmm1, 16(%[dest],%[i],4)                           \n\
+            add $8, %[i]                                                \n\
+            cmp %[last], %[i]                                           \n\
+            jle 0b"
+            : [i] "+r" (i)
+            : [pairs] "r" (pairs), [weights] "r" (weights),
+              [end] "r" ((long)(n+1)/2 * 16), [dest] "r" (dest),
+              [last] "r" ((long)count - 8)
+            : "rcx", "rdx", "xmm0", "xmm1", "xmm2", "xmm3", "xmm4",
+              "xmm7", "memory");
+    }
+    if (UNLIKELY(i < count))
+        rows_convolve_from(rows, kernel, n, dest, i, count);
+}
+
+/* 32-bit rows: PMULUDQ on the even and odd lanes, keeping the low half
+ * of each product. */
+
+static void rows_convolve32_sse2(const uint32_t * const *rows,
+                                 const uint32_t *kernel, int n,
+                                 uint32_t *dest, int count)
+{
+    uint32_t weights[MAX_CONV_ROWS][4] __attribute__((aligned(16)));
+    long i = 0;
+    int j;
+
+    if (n > MAX_CONV_ROWS) {
+        rows_convolve32_from(rows, kernel, n, dest, 0, count);
+        return;
+    }
+    for (j = 0; j < n; j++) {
+        weights[j][0] = weights[j][1] = kernel[j];
+        weights[j][2] = weights[j][3] = kernel[j];
+    }
+
+    if (count >= 4) {
+        asm("\
+            0:                                                          \n\
+            pxor %%xmm0, %%xmm0                                         \n\
+            xor %%rcx, %%rcx                                            \n\
+            1:                                                          \n\
+            mov (%[rows],%%rcx,8), %%rdx                                \n\
+            movdqu (%%rdx,%[i],4), %%xmm2                               \n\
+            movdqa %%xmm2, %%xmm3                                       \n\
+            psrlq $32, %%xmm3                                           \n\
+            mov %%rcx, %%rdx                                            \n\
+            shl $4, %%rdx                                               \n\
+            pmuludq (%[weights],%%rdx), %%xmm2                          \n\
+            pmuludq (%[weights],%%rdx), %%xmm3                          \n\
+            pshufd $0x08, %%xmm2, %%xmm2                                \n\
+            pshufd $0x08, %%xmm3, %%xmm3                                \n\
+            punpckldq %%xmm3, %%xmm2                                    \n\
+            paddd %%xmm2, %%xmm0                                        \n\
+            inc %%rcx                                                   \n\
+            cmp %[n], %%rcx                                             \n\
+            jb 1b                                                       \n\
+            movdqu %%xmm0, (%[dest],%[i],4)                             \n\
+            add $4, %[i]                                                \n\
+            cmp %[last], %[i]                                           \n\
+            jle 0b"
+            : [i] "+r" (i)
+            : [rows] "r" (rows), [weights] "r" (weights),
+              [n] "r" ((long)n), [dest] "r" (dest),
+              [last] "r" ((long)count - 4)
+            : "rcx", "rdx", "xmm0", "xmm2", "xmm3", "memory");
+    }
+    if (UNLIKELY(i < count))
+        rows_convolve32_from(rows, kernel, n, dest, i, count);
+}
+
+#endif  /* HAVE_ASM_SSE2 && ARCH_X86_64 */
+
+/*************************************************************************/
+/*************************************************************************/
+
+/* Initialization routine. */
+
+int ac_convolve_init(int accel)
+{
+    rows_mean_ptr       = rows_mean;
+    rows_min_ptr        = rows_min;
+    rows_max_ptr        = rows_max;
+    rows_convolve_ptr   = rows_convolve;
+    rows_convolve32_ptr = rows_convolve32;
+
+#if defined(HAVE_ASM_SSE2) && defined(ARCH_X86_64)
+    if (HAS_ACCEL(accel, AC_SSE2)) {
+        rows_mean_ptr       = rows_mean_sse2;
+        rows_min_ptr        = rows_min_sse2;
+        rows_max_ptr        = rows_max_sse2;
+        rows_convolve_ptr   = rows_convolve_sse2;
+        rows_convolve32_ptr = rows_convolve32_sse2;
+    }
+#endif
+
+    return 1;
+}
+
+/*************************************************************************/
+
+/*
+ * Local variables:
+ *   c-file-style: "stroustrup"
+ *   c-file-offsets: ((case-label . *) (statement-case-intro . *))
+ *   indent-tabs-mode: nil
+ * End:
+ *
+ * vim: expandtab shiftwidth=4:
+ */
@@ -22,6 +22,7 @@ extern int register_conversion(ImageFormat srcfmt, ImageFormat destfmt,
 /* Initialization routines */
 extern int ac_imgconvert_init(int accel);
 extern int ac_imgconvert_init_yuv_planar(int accel);
+extern int ac_imgconvert_init_yuv_deep(int accel);
 extern int ac_imgconvert_init_yuv_packed(int accel);
 extern int ac_imgconvert_init_yuv_mixed(int accel);
 extern int ac_imgconvert_init_yuv_rgb(int accel);
@@ -0,0 +1,361 @@
+/*
+ * img_yuv_deep.c - conversion routines between the high bit depth YUV
+ *                  planar formats (samples in 16-bit words) and their
+ *                  8-bit counterparts
+ *
+ * This file is part of transcode, a video stream processing tool.
+ * transcode is free software, distributable under the terms of the GNU
+ * General Public License (version 2 or later).  See the file COPYING
+ * for details.
+ */
+
+#include "ac.h"
+#include "ac_internal.h"
+#include "imgconvert.h"
+#include "img_internal.h"
+
+/*************************************************************************/
+
+/* Reducing to 8 bits uses ordered dithering: each sample gets a value
+ * from this 4x4 Bayer matrix, scaled to the bits being dropped, added
+ * before the shift.  Over any 4x4 block of a flat area the mean of the
+ * output is then the mean of the input, where plain truncation would
+ * leave bands and darken everything by half a step. */
+
+static const uint8_t bayer[4][4] = {
+    {  0,  8,  2, 10 },
+    { 12,  4, 14,  6 },
+    {  3, 11,  1,  9 },
+    { 15,  7, 13,  5 },
+};
+
+/* Dither values for row `y', for 8 columns from a multiple of 8, when
+ * dropping `shift' bits: the Bayer values centred in 16 steps of
+ * 1<<shift. */
+
+static void dither_row(uint16_t *dither, int y, int shift)
+{
+    int x;
+    for (x = 0; x < 8; x++)
+        dither[x] = ((2 * bayer[y & 3][x & 3] + 1) << shift) >> 5;
+}
+
+/*************************************************************************/
+/*************************************************************************/
+
+/* Row kernels, vanilla C versions.  Each does samples [start,count), so
+ * the accelerated versions can hand over the samples left at the end.
+ * The dithered sum saturates at 0xFFFF and the result at 255, which
+ * only matters for out-of-range input, but keeps the versions exact
+ * matches of each other. */
+
+static void reduce_row_from(const uint16_t *src, uint8_t *dest,
+                            const uint16_t *dither, int shift,
+                            int start, int count)
+{
+    int i;
+    for (i = start; i < count; i++) {
+        uint32_t v = src[i] + dither[i & 7];
+        if (v > 0xFFFF)
+            v = 0xFFFF;
+        v >>= shift;
+        dest[i] = (v > 255) ? 255 : v;
+    }
+}
+
+/* Widening replicates the top bits into the new low ones, so that 0
+ * and 255 map to the ends of the deeper range. */
+
+static void expand_row_from(const uint8_t *src, uint16_t *dest, int shift,
+                            int start, int count)
+{
+    int i;
+    for (i = start; i < count; i++)
+        dest[i] = src[i] << shift | src[i] >> (8 - shift);
+}
+
+static void reduce_row(const uint16_t *src, uint8_t *dest,
+                       const uint16_t *dither, int shift, int count)
+{
+    reduce_row_from(src, dest, dither, shift, 0, count);
+}
+
+static void expand_row(const uint8_t *src, uint16_t *dest, int shift,
+                       int count)
+{
+    expand_row_from(src, dest, shift, 0, count);
+}
+
+/*************************************************************************/
+
+/* SSE2 versions, 16 samples per loop. */
+
+#if defined(HAVE_ASM_SSE2)
+
+/* PADDUSW does the saturating add, and PACKUSWB the clamp, as the
+ * shifted words can't reach the sign bit. */
+
+static void reduce_row_sse2(const uint16_t *src, uint8_t *dest,
+                            const uint16_t *dither, int shift, int count)
+{
+    long i = 0;
+
+    if (count >= 16) {
+        asm("\
+            movdqu %[dither], %%xmm6    # XMM6: dither, 8 words         \n\
+            movd %[shift], %%xmm7       # XMM7: shift count             \n\
+            0:                                                          \n\
+            movdqu (%[src],%[i],2), %%xmm0                              \n\
+            movdqu 16(%[src],%[i],2), %%xmm1                            \n\
+            paddusw %%xmm6, %%xmm0                                      \n\
+            paddusw %%xmm6, %%xmm1                                      \n\
+            psrlw %%xmm7, %%xmm0                                        \n\
+            psrlw %%xmm7, %%xmm1                                        \n\
+            packuswb %%xmm1, %%xmm0                                     \n\
+            movdqu %%xmm0, (%[dest],%[i])                               \n\
+            add $16, %[i]                                               \n\
+            cmp %[last], %[i]                                           \n\
+            jle 0b"
+            : [i] "+r" (i)
+            : [src] "r" (src), [dest] "r" (dest),
+              [dither] "m" (*(const uint16_t (*)[8])dither),
+              [shift] "rm" (shift), [last] "r" ((long)count - 16)
+            : "xmm0", "xmm1", "xmm6", "xmm7", "cc", "memory");
+    }
+    if (UNLIKELY(i < count))
+        reduce_row_from(src, dest, dither, shift, i, count);
+}
+
+static void expand_row_sse2(const uint8_t *src, uint16_t *dest, int shift,
+                            int count)
+{
+    long i = 0;
+
+    if (count >= 16) {
+        asm("\
+            pxor %%xmm5, %%xmm5                                         \n\
+            movd %[shift], %%xmm6       # XMM6: left shift count        \n\
+            movd %[rshift], %%xmm7      # XMM7: right shift count       \n\
+            0:                                                          \n\
+            movdqu (%[src],%[i]), %%xmm0                                \n\
+            movdqa %%xmm0, %%xmm1                                       \n\
+            punpcklbw %%xmm5, %%xmm0                                    \n\
+            punpckhbw %%xmm5, %%xmm1                                    \n\
+            movdqa %%xmm0, %%xmm2                                       \n\
+            movdqa %%xmm1, %%xmm3                                       \n\
+            psllw %%xmm6, %%xmm0                                        \n\
+            psllw %%xmm6, %%xmm1                                        \n\
+            psrlw %%xmm7, %%xmm2                                        \n\
+            psrlw %%xmm7, %%xmm3                                        \n\
+            por %%xmm2, %%xmm0                                          \n\
+            por %%xmm3, %%xmm1                                          \n\
+            movdqu %%xmm0, (%[dest],%[i],2)                             \n\
+            movdqu %%xmm1, 16(%[dest],%[i],2)                           \n\
+            add $16, %[i]                                               \n\
+            cmp %[last], %[i]                                           \n\
+            jle 0b"
+            : [i] "+r" (i)
+            : [src] "r" (src), [dest] "r" (dest), [shift] "rm" (shift),
+              [rshift] "rm" (8 - shift), [last] "r" ((long)count - 16)
+            : "xmm0", "xmm1", "xmm2", "xmm3", "xmm5", "xmm6", "xmm7",
+              "cc", "memory");
+    }
+    if (UNLIKELY(i < count))
+        expand_row_from(src, dest, shift, i, count);
+}
+
+#endif  /* HAVE_ASM_SSE2 */
+
+/*************************************************************************/
+/*************************************************************************/
+
+/* Plane loops.  `xdiv' and `ydiv' are the U/V subsampling factors, and
+ * `bits' the significant bits of the deep format. */
+
+typedef void (*ReduceRowFunc)(const uint16_t *, uint8_t *, const uint16_t *,
+                              int, int);
+typedef void (*ExpandRowFunc)(const uint8_t *, uint16_t *, int, int);
+
+static int reduce_planes(uint8_t **src, uint8_t **dest, int width,
+                         int height, int xdiv, int ydiv, int bits,
+                         ReduceRowFunc func)
+{
+    uint16_t dither[4][8];
+    int p, y;
+
+    for (y = 0; y < 4; y++)
+        dither_row(dither[y], y, bits - 8);
+    for (p = 0; p < 3; p++) {
+        int w = p ? width / xdiv : width, h = p ? height / ydiv : height;
+        const uint16_t *s = (const uint16_t *)src[p];
+        for (y = 0; y < h; y++)
+            (*func)(s + y*w, dest[p] + y*w, dither[y & 3], bits - 8, w);
+    }
+    return 1;
+}
+
+static int expand_planes(uint8_t **src, uint8_t **dest, int width,
+                         int height, int xdiv, int ydiv, int bits,
+                         ExpandRowFunc func)
+{
+    int p;
+
+    for (p = 0; p < 3; p++) {
+        int w = p ? width / xdiv : width, h = p ? height / ydiv : height;
+        (*func)(src[p], (uint16_t *)dest[p], bits - 8, w*h);
+    }
+    return 1;
+}
+
+/*************************************************************************/
+
+/* Identity transformations */
+
+static int yuv420p10_copy(uint8_t **src, uint8_t **dest, int width, int height)
+{
+    ac_memcpy(dest[0], src[0], width*height*2);
+    ac_memcpy(dest[1], src[1], (width/2)*(height/2)*2);
+    ac_memcpy(dest[2], src[2], (width/2)*(height/2)*2);
+    return 1;
+}
+
+static int yuv422p10_copy(uint8_t **src, uint8_t **dest, int width, int height)
+{
+    ac_memcpy(dest[0], src[0], width*height*2);
+    ac_memcpy(dest[1], src[1], (width/2)*height*2);
+    ac_memcpy(dest[2], src[2], (width/2)*height*2);
+    return 1;
+}
+
+static int yuv444p16_copy(uint8_t **src, uint8_t **dest, int width, int height)
+{
+    ac_memcpy(dest[0], src[0], width*height*2);
+    ac_memcpy(dest[1], src[1], width*height*2);
+    ac_memcpy(dest[2], src[2], width*height*2);
+    return 1;
+}
+
+/*************************************************************************/
+
+static int yuv420p10_yuv420p(uint8_t **src, uint8_t **dest, int width, int height)
+{
+    return reduce_planes(src, dest, width, height, 2, 2, 10, reduce_row);
+}
+
+static int yuv422p10_yuv422p(uint8_t **src, uint8_t **dest, int width, int height)
+{
+    return reduce_planes(src, dest, width, height, 2, 1, 10, reduce_row);
+}
+
+static int yuv444p16_yuv444p(uint8_t **src, uint8_t **dest, int width, int height)
+{
+    return reduce_planes(src, dest, width, height, 1, 1, 16, reduce_row);
+}
+
+static int yuv420p_yuv420p10(uint8_t **src, uint8_t **dest, int width, int height)
+{
+    return expand_planes(src, dest, width, height, 2, 2, 10, expand_row);
+}
+
+static int yuv422p_yuv422p10(uint8_t **src, uint8_t **dest, int width, int height)
+{
+    return expand_planes(src, dest, width, height, 2, 1, 10, expand_row);
+}
+
+static int yuv444p_yuv444p16(uint8_t **src, uint8_t **dest, int width, int height)
+{
+    return expand_planes(src, dest, width, height, 1, 1, 16, expand_row);
+}
+
+/*************************************************************************/
+
+#if defined(HAVE_ASM_SSE2)
+
+static int yuv420p10_yuv420p_sse2(uint8_t **src, uint8_t **dest, int width, int height)
+{
+    return reduce_planes(src, dest, width, height, 2, 2, 10,
+                         reduce_row_sse2);
+}
+
+static int yuv422p10_yuv422p_sse2(uint8_t **src, uint8_t **dest, int width, int height)
+{
+    return reduce_planes(src, dest, width, height, 2, 1, 10,
+                         reduce_row_sse2);
+}
+
+static int yuv444p16_yuv444p_sse2(uint8_t **src, uint8_t **dest, int width, int height)
+{
+    return reduce_planes(src, dest, width, height, 1, 1, 16,
+                         reduce_row_sse2);
+}
+
+static int yuv420p_yuv420p10_sse2(uint8_t **src, uint8_t **dest, int width, int height)
+{
+    return expand_planes(src, dest, width, height, 2, 2, 10,
+                         expand_row_sse2);
+}
+
+static int yuv422p_yuv422p10_sse2(uint8_t **src, uint8_t **dest, int width, int height)
+{
+    return expand_planes(src, dest, width, height, 2, 1, 10,
+                         expand_row_sse2);
+}
+
+static int yuv444p_yuv444p16_sse2(uint8_t **src, uint8_t **dest, int width, int height)
+{
+    return expand_planes(src, dest, width, height, 1, 1, 16,
+                         expand_row_sse2);
+}
+
+#endif  /* HAVE_ASM_SSE2 */
+
+/*************************************************************************/
+/*************************************************************************/
+
+/* Initialization */
+
+int ac_imgconvert_init_yuv_deep(int accel)
+{
+    if (!register_conversion(IMG_YUV420P10, IMG_YUV420P10, yuv420p10_copy)
+     || !register_conversion(IMG_YUV420P10, IMG_YUV420P,   yuv420p10_yuv420p)
+     || !register_conversion(IMG_YUV420P,   IMG_YUV420P10, yuv420p_yuv420p10)
+
+     || !register_conversion(IMG_YUV422P10, IMG_YUV422P10, yuv422p10_copy)
+     || !register_conversion(IMG_YUV422P10, IMG_YUV422P,   yuv422p10_yuv422p)
+     || !register_conversion(IMG_YUV422P,   IMG_YUV422P10, yuv422p_yuv422p10)
+
+     || !register_conversion(IMG_YUV444P16, IMG_YUV444P16, yuv444p16_copy)
+     || !register_conversion(IMG_YUV444P16, IMG_YUV444P,   yuv444p16_yuv444p)
+     || !register_conversion(IMG_YUV444P,   IMG_YUV444P16, yuv444p_yuv444p16)
+    ) {
+        return 0;
+    }
+
+#if defined(HAVE_ASM_SSE2)
+    if (accel & AC_SSE2) {
+        if (!register_conversion(IMG_YUV420P10, IMG_YUV420P,   yuv420p10_yuv420p_sse2)
+         || !register_conversion(IMG_YUV420P,   IMG_YUV420P10, yuv420p_yuv420p10_sse2)
+         || !register_conversion(IMG_YUV422P10, IMG_YUV422P,   yuv422p10_yuv422p_sse2)
+         || !register_conversion(IMG_YUV422P,   IMG_YUV422P10, yuv422p_yuv422p10_sse2)
+         || !register_conversion(IMG_YUV444P16, IMG_YUV444P,   yuv444p16_yuv444p_sse2)
+         || !register_conversion(IMG_YUV444P,   IMG_YUV444P16, yuv444p_yuv444p16_sse2)
+        ) {
+            return 0;
+        }
+    }
+#endif  /* HAVE_ASM_SSE2 */
+
+    return 1;
+}
+
+/*************************************************************************/
+
+/*
+ * Local variables:
+ *   c-file-style: "stroustrup"
+ *   c-file-offsets: ((case-label . *) (statement-case-intro . *))
+ *   indent-tabs-mode: nil
+ * End:
+ *
+ * vim: expandtab shiftwidth=4:
+ */
@@ -522,7 +522,8 @@ static int y8_yuv444p(uint8_t **src, uint8_t **dest, int width, int height)
         movq %%xmm0, -8("EDI","ECX")",                                  \
         /* emms */ "emms")                                              \
         : "=c" (dummy)                                                  \
-        : "S" (src1), "d" (src2), "D" (dest), "c" (count));             \
+        : "S" (src1), "d" (src2), "D" (dest), "0" (count)               \
+        : "eax");                                                       \
 } while (0)
 
 /*************************************************************************/
@@ -71,6 +71,7 @@ int ac_imgconvert(uint8_t **src, ImageFormat srcfmt,
 int ac_imgconvert_init(int accel)
 {
     if (!ac_imgconvert_init_yuv_planar(accel)
+     || !ac_imgconvert_init_yuv_deep(accel)
      || !ac_imgconvert_init_yuv_packed(accel)
      || !ac_imgconvert_init_yuv_mixed(accel)
      || !ac_imgconvert_init_yuv_rgb(accel)
@@ -27,6 +27,9 @@ typedef enum {
     IMG_UYVY,           /* YUV packed, 1 U/V per 2x1 Y pixels, U:Y:V:Y */
     IMG_YVYU,           /* YUV packed, 1 U/V per 2x1 Y pixels, Y:V:Y:U */
     IMG_Y8,             /* Y-only 8-bit data */
+    IMG_YUV420P10,      /* YUV420P, 10 bits in each native 16-bit word */
+    IMG_YUV422P10,      /* YUV422P, 10 bits in each native 16-bit word */
+    IMG_YUV444P16,      /* YUV444P, 16 bits in each native 16-bit word */
     IMG_YUV_LAST,
     /* RGB formats */
     IMG_RGB_BASE = 0x2000,
@@ -51,18 +54,32 @@ typedef enum {
 #define IS_YUV_FORMAT(fmt)      ((fmt) > IMG_YUV_BASE && (fmt) < IMG_YUV_LAST)
 #define IS_RGB_FORMAT(fmt)      ((fmt) > IMG_RGB_BASE && (fmt) < IMG_RGB_LAST)
 
-/* U/V plane size for YUV planar formats (Y plane size is always w*h) */
+/* Bytes per sample and significant bits per sample of YUV formats (the
+ * high bit depth formats keep their samples in the low bits of a word) */
+#define YUV_SAMPLE_SIZE(fmt) \
+    ((fmt)==IMG_YUV420P10 || (fmt)==IMG_YUV422P10 \
+     || (fmt)==IMG_YUV444P16 ? 2 : 1)
+#define YUV_SAMPLE_BITS(fmt) \
+    ((fmt)==IMG_YUV420P10 ? 10 : \
+     (fmt)==IMG_YUV422P10 ? 10 : \
+     (fmt)==IMG_YUV444P16 ? 16 : 8)
+
+/* Y and U/V plane sizes in bytes for YUV planar formats */
+#define Y_PLANE_SIZE(fmt,w,h)   ((w)*(h)*YUV_SAMPLE_SIZE(fmt))
 #define UV_PLANE_SIZE(fmt,w,h) \
-    ((fmt)==IMG_YUV420P ? ((w)/2)*((h)/2) : \
-     (fmt)==IMG_YV12    ? ((w)/2)*((h)/2) : \
-     (fmt)==IMG_YUV411P ? ((w)/4)* (h)    : \
-     (fmt)==IMG_YUV422P ? ((w)/2)* (h)    : \
-     (fmt)==IMG_YUV444P ?  (w)   * (h)    : 0)
+    ((fmt)==IMG_YUV420P   ? ((w)/2)*((h)/2)   : \
+     (fmt)==IMG_YV12      ? ((w)/2)*((h)/2)   : \
+     (fmt)==IMG_YUV411P   ? ((w)/4)* (h)      : \
+     (fmt)==IMG_YUV422P   ? ((w)/2)* (h)      : \
+     (fmt)==IMG_YUV444P   ?  (w)   * (h)      : \
+     (fmt)==IMG_YUV420P10 ? ((w)/2)*((h)/2)*2 : \
+     (fmt)==IMG_YUV422P10 ? ((w)/2)* (h)   *2 : \
+     (fmt)==IMG_YUV444P16 ?  (w)   * (h)   *2 : 0)
 
 /* Macro to initialize an array of planes from a buffer */
 #define YUV_INIT_PLANES(planes,buffer,fmt,w,h) \
-    ((planes)[0] = (buffer),                   \
-     (planes)[1] = (planes)[0] + (w)*(h),      \
+    ((planes)[0] = (buffer),                                    \
+     (planes)[1] = (planes)[0] + Y_PLANE_SIZE((fmt),(w),(h)),   \
      (planes)[2] = (planes)[1] + UV_PLANE_SIZE((fmt),(w),(h)))
 
 #if 0
@@ -0,0 +1,260 @@
+/*
+ * match.c -- block comparison primitives for template matching: sum of
+ *            absolute differences and the sums needed for normalized
+ *            cross-correlation
+ *
+ * This file is part of transcode, a video stream processing tool.
+ * transcode is free software, distributable under the terms of the GNU
+ * General Public License (version 2 or later).  See the file COPYING
+ * for details.
+ */
+
+#include "ac.h"
+#include "ac_internal.h"
+
+static uint32_t sad(const uint8_t *, const uint8_t *, const uint8_t *,
+                    int);
+static void correlate(const uint8_t *, const uint8_t *, const uint8_t *,
+                      int, uint32_t *);
+
+static uint32_t (*sad_ptr)(const uint8_t *, const uint8_t *,
+                           const uint8_t *, int)
+     = sad;
+static void (*correlate_ptr)(const uint8_t *, const uint8_t *,
+                             const uint8_t *, int, uint32_t *)
+     = correlate;
+
+/*************************************************************************/
+
+/* External interface */
+
+uint32_t ac_sad(const uint8_t *src1, const uint8_t *src2,
+                const uint8_t *mask, int bytes)
+{
+    return (*sad_ptr)(src1, src2, mask, bytes);
+}
+
+void ac_correlate(const uint8_t *src, const uint8_t *pattern,
+                  const uint8_t *mask, int bytes, uint32_t *sums)
+{
+    (*correlate_ptr)(src, pattern, mask, bytes, sums);
+}
+
+/*************************************************************************/
+/*************************************************************************/
+
+/* Vanilla C versions.  Each does bytes [start,bytes) and adds to the
+ * sums passed in, so the accelerated versions can hand over the bytes
+ * left at the end. */
+
+static uint32_t sad_from(const uint8_t *src1, const uint8_t *src2,
+                         const uint8_t *mask, int start, int bytes,
+                         uint32_t sum)
+{
+    int i;
+    if (mask) {
+        for (i = start; i < bytes; i++) {
+            int diff = (src1[i] & mask[i]) - (src2[i] & mask[i]);
+            sum += (diff < 0) ? -diff : diff;
+        }
+    } else {
+        for (i = start; i < bytes; i++) {
+            int diff = src1[i] - src2[i];
+            sum += (diff < 0) ? -diff : diff;
+        }
+    }
+    return sum;
+}
+
+static void correlate_from(const uint8_t *src, const uint8_t *pattern,
+                           const uint8_t *mask, int start, int bytes,
+                           uint32_t *sums)
+{
+    int i;
+    for (i = start; i < bytes; i++) {
+        uint32_t s = mask ? (src[i] & mask[i]) : src[i];
+        sums[0] += s;
+        sums[1] += s * s;
+        sums[2] += s * pattern[i];
+    }
+}
+
+
+static uint32_t sad(const uint8_t *src1, const uint8_t *src2,
+                    const uint8_t *mask, int bytes)
+{
+    return sad_from(src1, src2, mask, 0, bytes, 0);
+}
+
+static void correlate(const uint8_t *src, const uint8_t *pattern,
+                      const uint8_t *mask, int bytes, uint32_t *sums)
+{
+    sums[0] = sums[1] = sums[2] = 0;
+    correlate_from(src, pattern, mask, 0, bytes, sums);
+}
+
+/*************************************************************************/
+
+/* SSE2 versions. */
+
+#if defined(HAVE_ASM_SSE2) && defined(ARCH_X86_64)
+
+/* PSADBW does the whole job on 16 bytes; masking both sides first
+ * zeroes the difference of the excluded bytes. */
+
+static uint32_t sad_sse2(const uint8_t *src1, const uint8_t *src2,
+                         const uint8_t *mask, int bytes)
+{
+    long i = 0;
+    uint32_t sum = 0;
+
+    if (bytes >= 16 && mask) {
+        asm("\
+            pxor %%xmm7, %%xmm7                                         \n\
+            0:                                                          \n\
+            movdqu (%[src1],%[i]), %%xmm0                               \n\
+            movdqu (%[src2],%[i]), %%xmm1                               \n\
+            movdqu (%[mask],%[i]), %%xmm2                               \n\
+            pand %%xmm2, %%xmm0                                         \n\
+            pand %%xmm2, %%xmm1                                         \n\
+            psadbw %%xmm1, %%xmm0                                       \n\
+            paddq %%xmm0, %%xmm7                                        \n\
+            add $16, %[i]                                               \n\
+            cmp %[last], %[i]                                           \n\
+            jle 0b                                                      \n\
+            pshufd $0x4E, %%xmm7, %%xmm0                                \n\
+            paddq %%xmm0, %%xmm7                                        \n\
+            movd %%xmm7, %[sum]"
+            : [i] "+r" (i), [sum] "=r" (sum)
+            : [src1] "r" (src1), [src2] "r" (src2), [mask] "r" (mask),
+              [last] "r" ((long)bytes - 16)
+            : "xmm0", "xmm1", "xmm2", "xmm7");
+    } else if (bytes >= 16) {
+        asm("\
+            pxor %%xmm7, %%xmm7                                         \n\
+            0:                                                          \n\
+            movdqu (%[src1],%[i]), %%xmm0                               \n\
+            movdqu (%[src2],%[i]), %%xmm1                               \n\
+            psadbw %%xmm1, %%xmm0                                       \n\
+            paddq %%xmm0, %%xmm7                                        \n\
+            add $16, %[i]                                               \n\
+            cmp %[last], %[i]                                           \n\
+            jle 0b                                                      \n\
+            pshufd $0x4E, %%xmm7, %%xmm0                                \n\
+            paddq %%xmm0, %%xmm7                                        \n\
+            movd %%xmm7, %[sum]"
+            : [i] "+r" (i), [sum] "=r" (sum)
+            : [src1] "r" (src1), [src2] "r" (src2),
+              [last] "r" ((long)bytes - 16)
+            : "xmm0", "xmm1", "xmm7");
+    }
+    if (UNLIKELY(i < bytes))
+        sum = sad_from(src1, src2, mask, i, bytes, sum);
+    return sum;
+}
+
+/* The sum comes from PSADBW against zero; the bytes are then widened to
+ * words and PMADDWD gives the squares and the cross products, in four
+ * 32-bit lanes which are added up at the end (modulo 2^32, like the C
+ * version). */
+
+static void correlate_sse2(const uint8_t *src, const uint8_t *pattern,
+                           const uint8_t *mask, int bytes, uint32_t *sums)
+{
+    long i = 0;
+    uint32_t sum = 0, sumsq = 0, cross = 0;
+
+    if (bytes >= 16) {
+        asm("\
+            pxor %%xmm4, %%xmm4         # XMM4: sum, 2 quadwords        \n\
+            pxor %%xmm5, %%xmm5         # XMM5: squares, 4 dwords       \n\
+            pxor %%xmm6, %%xmm6         # XMM6: products, 4 dwords      \n\
+            pxor %%xmm7, %%xmm7                                         \n\
+            0:                                                          \n\
+            movdqu (%[src],%[i]), %%xmm0                                \n\
+            movdqu (%[pattern],%[i]), %%xmm1                            \n\
+            test %[mask], %[mask]                                       \n\
+            jz 1f                                                       \n\
+            movdqu (%[mask],%[i]), %%xmm2                               \n\
+            pand %%xmm2, %%xmm0                                         \n\
+            1:                                                          \n\
+            movdqa %%xmm0, %%xmm2                                       \n\
+            psadbw %%xmm7, %%xmm2                                       \n\
+            paddq %%xmm2, %%xmm4                                        \n\
+            movdqa %%xmm0, %%xmm2                                       \n\
+            punpcklbw %%xmm7, %%xmm0                                    \n\
+            punpckhbw %%xmm7, %%xmm2                                    \n\
+            movdqa %%xmm1, %%xmm3                                       \n\
+            punpcklbw %%xmm7, %%xmm1                                    \n\
+            punpckhbw %%xmm7, %%xmm3                                    \n\
+            pmaddwd %%xmm0, %%xmm1                                      \n\
+            pmaddwd %%xmm2, %%xmm3                                      \n\
+            paddd %%xmm1, %%xmm6                                        \n\
+            paddd %%xmm3, %%xmm6                                        \n\
+            pmaddwd %%xmm0, %%xmm0                                      \n\
+            pmaddwd %%xmm2, %%xmm2                                      \n\
+            paddd %%xmm0, %%xmm5                                        \n\
+            paddd %%xmm2, %%xmm5                                        \n\
+            add $16, %[i]                                               \n\
+            cmp %[last], %[i]                                           \n\
+            jle 0b                                                      \n\
+            pshufd $0x4E, %%xmm4, %%xmm0                                \n\
+            paddq %%xmm0, %%xmm4                                        \n\
+            movd %%xmm4, %[sum]                                         \n\
+            pshufd $0x4E, %%xmm5, %%xmm0                                \n\
+            paddd %%xmm0, %%xmm5                                        \n\
+            pshufd $0xB1, %%xmm5, %%xmm0                                \n\
+            paddd %%xmm0, %%xmm5                                        \n\
+            movd %%xmm5, %[sumsq]                                       \n\
+            pshufd $0x4E, %%xmm6, %%xmm0                                \n\
+            paddd %%xmm0, %%xmm6                                        \n\
+            pshufd $0xB1, %%xmm6, %%xmm0                                \n\
+            paddd %%xmm0, %%xmm6                                        \n\
+            movd %%xmm6, %[cross]"
+            : [i] "+r" (i), [sum] "=r" (sum), [sumsq] "=r" (sumsq),
+              [cross] "=r" (cross)
+            : [src] "r" (src), [pattern] "r" (pattern), [mask] "r" (mask),
+              [last] "r" ((long)bytes - 16)
+            : "xmm0", "xmm1", "xmm2", "xmm3", "xmm4", "xmm5", "xmm6",
+              "xmm7", "cc");
+    }
+    sums[0] = sum;
+    sums[1] = sumsq;
+    sums[2] = cross;
+    if (UNLIKELY(i < bytes))
+        correlate_from(src, pattern, mask, i, bytes, sums);
+}
+
+#endif  /* HAVE_ASM_SSE2 && ARCH_X86_64 */
+
+/*************************************************************************/
+/*************************************************************************/
+
+/* Initialization routine. */
+
+int ac_match_init(int accel)
+{
+    sad_ptr       = sad;
+    correlate_ptr = correlate;
+
+#if defined(HAVE_ASM_SSE2) && defined(ARCH_X86_64)
+    if (HAS_ACCEL(accel, AC_SSE2)) {
+        sad_ptr       = sad_sse2;
+        correlate_ptr = correlate_sse2;
+    }
+#endif
+
+    return 1;
+}
+
+/*************************************************************************/
+
+/*
+ * Local variables:
+ *   c-file-style: "stroustrup"
+ *   c-file-offsets: ((case-label . *) (statement-case-intro . *))
+ *   indent-tabs-mode: nil
+ * End:
+ *
+ * vim: expandtab shiftwidth=4:
+ */
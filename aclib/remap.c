@@ -0,0 +1,182 @@
+/*
+ * remap.c -- bilinear sampling of precomputed source positions, for
+ *            geometric transformations (rotation, lens distortion, etc.)
+ *
+ * This file is part of transcode, a video stream processing tool.
+ * transcode is free software, distributable under the terms of the GNU
+ * General Public License (version 2 or later).  See the file COPYING
+ * for details.
+ */
+
+#include "ac.h"
+#include "ac_internal.h"
+
+static void remap_bilinear(const uint8_t *, int, int, const int32_t *,
+                           const int16_t *, uint8_t *, int);
+
+static void (*remap_bilinear_ptr)(const uint8_t *, int, int,
+                                  const int32_t *, const int16_t *,
+                                  uint8_t *, int)
+     = remap_bilinear;
+
+/*************************************************************************/
+
+/* External interface */
+
+void ac_remap_bilinear(const uint8_t *src, int stride, int Bpp,
+                       const int32_t *offset, const int16_t *weight,
+                       uint8_t *dest, int count)
+{
+    (*remap_bilinear_ptr)(src, stride, Bpp, offset, weight, dest, count);
+}
+
+/*************************************************************************/
+/*************************************************************************/
+
+/* Vanilla C version.  Does pixels [start,count), so the accelerated
+ * version can hand over the pixels left at the end.  The horizontal
+ * pass gives at most 255*128, which the vertical one scales by at most
+ * 128 again; the result is rounded from 1/16384 units. */
+
+static void remap_bilinear_from(const uint8_t *src, int stride, int Bpp,
+                                const int32_t *offset, const int16_t *weight,
+                                uint8_t *dest, int start, int count)
+{
+    int i, c;
+
+    for (i = start; i < count; i++) {
+        const uint8_t *top = src + offset[i];
+        const uint8_t *bottom = top + stride;
+        const int16_t *w = weight + i*4;
+        for (c = 0; c < Bpp; c++) {
+            int32_t t = top[c]*w[0] + top[c+Bpp]*w[1];
+            int32_t b = bottom[c]*w[0] + bottom[c+Bpp]*w[1];
+            dest[i*Bpp+c] = (t*w[2] + b*w[3] + 8192) >> 14;
+        }
+    }
+}
+
+static void remap_bilinear(const uint8_t *src, int stride, int Bpp,
+                           const int32_t *offset, const int16_t *weight,
+                           uint8_t *dest, int count)
+{
+    remap_bilinear_from(src, stride, Bpp, offset, weight, dest, 0, count);
+}
+
+/*************************************************************************/
+
+/* SSE2 version, for single-byte pixels (planar data); other pixel sizes
+ * go to the C version. */
+
+#if defined(HAVE_ASM_SSE2) && defined(ARCH_X86_64)
+
+/* Four pixels per loop.  The two 16-bit pairs of each pixel are fetched
+ * into one doubleword, upper pair first, and widened to words; PMADDWD
+ * against the horizontal weights, repeated for both pairs by PSHUFD,
+ * leaves the upper and lower sums of each pixel side by side, and a
+ * second PMADDWD against the vertical weights finishes the job. */
+
+static void remap_bilinear_sse2(const uint8_t *src, int stride, int Bpp,
+                                const int32_t *offset, const int16_t *weight,
+                                uint8_t *dest, int count)
+{
+    long i = 0;
+
+    if (Bpp == 1 && count >= 4) {
+        asm("\
+            mov $8192, %%eax                                            \n\
+            movd %%eax, %%xmm6                                          \n\
+            pshufd $0, %%xmm6, %%xmm6   # XMM6: rounding, 4 dwords      \n\
+            pxor %%xmm7, %%xmm7                                         \n\
+            0:                                                          \n\
+            movslq (%[offset],%[i],4), %%rax                            \n\
+            movzwl (%[src],%%rax), %%edx                                \n\
+            movzwl (%[src2],%%rax), %%eax                               \n\
+            shl $16, %%eax                                              \n\
+            or %%edx, %%eax                                             \n\
+            movd %%eax, %%xmm0                                          \n\
+            movslq 4(%[offset],%[i],4), %%rax                           \n\
+            movzwl (%[src],%%rax), %%edx                                \n\
+            movzwl (%[src2],%%rax), %%eax                               \n\
+            shl $16, %%eax                                              \n\
+            or %%edx, %%eax                                             \n\
+            movd %%eax, %%xmm1                                          \n\
+            movslq 8(%[offset],%[i],4), %%rax                           \n\
+            movzwl (%[src],%%rax), %%edx                                \n\
+            movzwl (%[src2],%%rax), %%eax                               \n\
+            shl $16, %%eax                                              \n\
+            or %%edx, %%eax                                             \n\
+            movd %%eax, %%xmm2                                          \n\
+            movslq 12(%[offset],%[i],4), %%rax                          \n\
+            movzwl (%[src],%%rax), %%edx                                \n\
+            movzwl (%[src2],%%rax), %%eax                               \n\
+            shl $16, %%eax                                              \n\
+            or %%edx, %%eax                                             \n\
+            movd %%eax, %%xmm3                                          \n\
+            punpckldq %%xmm1, %%xmm0                                    \n\
+            punpckldq %%xmm3, %%xmm2                                    \n\
+            punpcklqdq %%xmm2, %%xmm0   # XMM0: 2x2 bytes of 4 pixels   \n\
+            movdqa %%xmm0, %%xmm1                                       \n\
+            punpcklbw %%xmm7, %%xmm0                                    \n\
+            punpckhbw %%xmm7, %%xmm1                                    \n\
+            movdqu (%[weight],%[i],8), %%xmm2                           \n\
+            movdqu 16(%[weight],%[i],8), %%xmm3                         \n\
+            pshufd $0xA0, %%xmm2, %%xmm4                                \n\
+            pshufd $0xA0, %%xmm3, %%xmm5                                \n\
+            pmaddwd %%xmm4, %%xmm0                                      \n\
+            pmaddwd %%xmm5, %%xmm1                                      \n\
+            packssdw %%xmm1, %%xmm0     # XMM0: upper/lower sum pairs   \n\
+            pshufd $0xDD, %%xmm2, %%xmm2                                \n\
+            pshufd $0xDD, %%xmm3, %%xmm3                                \n\
+            punpcklqdq %%xmm3, %%xmm2   # XMM2: vertical weight pairs   \n\
+            pmaddwd %%xmm2, %%xmm0                                      \n\
+            paddd %%xmm6, %%xmm0                                        \n\
+            psrld $14, %%xmm0                                           \n\
+            packssdw %%xmm0, %%xmm0                                     \n\
+            packuswb %%xmm0, %%xmm0                                     \n\
+            movd %%xmm0, (%[dest],%[i])                                 \n\
+            add $4, %[i]                                                \n\
+            cmp %[last], %[i]                                           \n\
+            jle 0b"
+            : [i] "+r" (i)
+            : [src] "r" (src), [src2] "r" (src + stride),
+              [offset] "r" (offset), [weight] "r" (weight),
+              [dest] "r" (dest), [last] "r" ((long)count - 4)
+            : "rax", "rdx", "xmm0", "xmm1", "xmm2", "xmm3", "xmm4", "xmm5",
+              "xmm6", "xmm7", "cc", "memory");
+    }
+    if (UNLIKELY(i < count))
+        remap_bilinear_from(src, stride, Bpp, offset, weight, dest, i, count);
+}
+
+#endif  /* HAVE_ASM_SSE2 && ARCH_X86_64 */
+
+/*************************************************************************/
+/*************************************************************************/
+
+/* Initialization routine. */
+
+int ac_remap_init(int accel)
+{
+    remap_bilinear_ptr = remap_bilinear;
+
+#if defined(HAVE_ASM_SSE2) && defined(ARCH_X86_64)
+    if (HAS_ACCEL(accel, AC_SSE2)) {
+        remap_bilinear_ptr = remap_bilinear_sse2;
+    }
+#endif
+
+    return 1;
+}
+
+/*************************************************************************/
+
+/*
+ * Local variables:
+ *   c-file-style: "stroustrup"
+ *   c-file-offsets: ((case-label . *) (statement-case-intro . *))
+ *   indent-tabs-mode: nil
+ * End:
+ *
+ * vim: expandtab shiftwidth=4:
+ */
@@ -26,20 +26,20 @@
 #include "libtcmodule/tcmodule-plugin.h"
 
 #define MOD_NAME    "encode_copy.so"
-#define MOD_VERSION "v0.0.5 (2009-02-03)"
+#define MOD_VERSION "v0.0.7 (2026-10-18)"
 #define MOD_CAP     "copy (passthrough) A/V frames"
 
 #define MOD_FEATURES \
     TC_MODULE_FEATURE_ENCODE|TC_MODULE_FEATURE_VIDEO|TC_MODULE_FEATURE_AUDIO
 
 #define MOD_FLAGS \
-    TC_MODULE_FLAG_RECONFIGURABLE
+    TC_MODULE_FLAG_RECONFIGURABLE|TC_MODULE_FLAG_REPEAT
 
 static const char copy_help[] = ""
     "Overview:\n"
-    "    this module passthrough A/V frames copying them from input\n"
-    "    to output.\n"
-    "    For a faster passthrough consider usage of 'null' module.\n"
+    "    this module passthrough A/V frames from input to output.\n"
+    "    The payload is handed to the multiplexor by reference,\n"
+    "    without copying it.\n"
     "Options:\n"
     "    help    produce module overview and options explanations\n";
 
@@ -102,8 +102,13 @@ static int copy_encode_video(TCModuleInstance *self,
 {
     TC_MODULE_SELF_CHECK(self, "encode_video");
 
-    vframe_copy(outframe, inframe, 1);
+    vframe_copy(outframe, inframe, 0);
+    tc_borrow_video_frame(outframe, inframe);
     outframe->video_len = outframe->video_size;
+    if (inframe->attributes & TC_FRAME_IS_REPEAT) {
+        /* nothing to pass: a copy of a delta frame would be wrong too */
+        outframe->video_len = 0;
+    }
 
     return TC_OK;
 }
@@ -113,7 +118,8 @@ static int copy_encode_audio(TCModuleInstance *self,
 {
     TC_MODULE_SELF_CHECK(self, "encode_audio");
 
-    aframe_copy(outframe, inframe, 1);
+    aframe_copy(outframe, inframe, 0);
+    tc_borrow_audio_frame(outframe, inframe);
     outframe->audio_len = outframe->audio_size;
 
     return TC_OK;
@@ -24,6 +24,7 @@
 
 #include "libtcmodule/tcmodule-plugin.h"
 
+#include "libtcutil/tcthread.h"
 #include "libtcext/tc_magick.h"
 
 
@@ -40,17 +41,51 @@
 #define FMT_NAME_LEN    16
 #define DEFAULT_QUALITY 75
 #define DEFAULT_FORMAT  "png"
+#define DEFAULT_PREFIX  "frame."
+#define MAX_THREADS     64
 
 static const char tc_im_help[] = ""
     "Overview:\n"
     "    This module encodes video frames independently in various\n"
     "    image formats using ImageMagick libraries.\n"
     "Options:\n"
-    "    format  name of the format to use for encoding images\n"
-    "    quality select output quality (higher is better)\n"
-    "    help    produce module overview and options explanations\n";
+    "    format   name of the format to use for encoding images\n"
+    "    quality  select output quality (higher is better)\n"
+    "    threads  encode and write the images with this many threads,\n"
+    "             straight to <output file>NNNNNN.<format> files\n"
+    "             (use with a null multiplexor) [0: no threads]\n"
+    "    inflight maximum frames queued to the threads [2*threads]\n"
+    "    help     produce module overview and options explanations\n";
+
+/*
+ * Threaded mode: frames are copied into a ring of `inflight' slots and
+ * encoded by the workers, each one with its own Magick context, which
+ * also write the image files. Names are assigned when a frame is queued,
+ * so they follow the encoding order whatever the completion order.
+ */
+enum {
+    IM_SLOT_FREE = 0,
+    IM_SLOT_QUEUED,
+    IM_SLOT_BUSY,
+};
+
+typedef struct tcimslot_ TCIMSlot;
+struct tcimslot_ {
+    uint8_t         *data;
+    uint32_t        number;
+    int             state;
+};
 
 typedef struct tcimprivatedata_ TCIMPrivateData;
+
+typedef struct tcimworker_ TCIMWorker;
+struct tcimworker_ {
+    TCIMPrivateData *pd;
+    TCMagickContext magick;
+    TCThread        thread;
+    char            filename[PATH_MAX+1];
+};
+
 struct tcimprivatedata_ {
     TCMagickContext magick;
 
@@ -59,6 +94,20 @@ struct tcimprivatedata_ {
     int             height;
     char            opt_buf[TC_BUF_MIN];
     char            img_fmt[FMT_NAME_LEN];
+
+    const char      *prefix;
+    int             nthreads;
+    TCIMWorker      *workers;
+    TCIMSlot        *slots;
+    int             inflight;
+    int             head;       /* next slot to be encoded */
+    int             tail;       /* next slot to be filled */
+    int             queued;     /* queued or being encoded */
+    uint32_t        number;     /* of the next frame */
+    int             error;
+    int             quit;
+    TCMutex         lock;
+    TCCondition     cond;
 };
 
 
@@ -83,6 +132,189 @@ static int is_supported(TCCodecID codec)
     return found;
 }
 
+/*************************************************************************/
+
+static int tc_im_worker(TCThreadData *td, void *datum)
+{
+    TCIMWorker *worker = datum;
+    TCIMPrivateData *pd = worker->pd;
+
+    tc_mutex_lock(&pd->lock);
+    while (TC_TRUE) {
+        TCIMSlot *slot = &pd->slots[pd->head];
+        int ret;
+
+        while (!pd->quit && slot->state != IM_SLOT_QUEUED) {
+            tc_condition_wait(&pd->cond, &pd->lock);
+            slot = &pd->slots[pd->head];
+        }
+        if (pd->quit) {
+            break;
+        }
+        slot->state = IM_SLOT_BUSY;
+        pd->head = (pd->head + 1) % pd->inflight;
+        tc_mutex_unlock(&pd->lock);
+
+        tc_snprintf(worker->filename, sizeof(worker->filename),
+                    "%s%06u.%s", pd->prefix, slot->number, pd->img_fmt);
+        ret = tc_magick_RGBin(&worker->magick, pd->width, pd->height,
+                              slot->data);
+        if (ret == TC_OK) {
+            ret = tc_magick_fileout(&worker->magick, pd->img_fmt,
+                                    worker->filename);
+        }
+
+        tc_mutex_lock(&pd->lock);
+        if (ret != TC_OK) {
+            tc_log_error(MOD_NAME, "failed to write %s", worker->filename);
+            pd->error = TC_TRUE;
+        }
+        slot->state = IM_SLOT_FREE;
+        pd->queued--;
+        tc_condition_broadcast(&pd->cond);
+    }
+    tc_mutex_unlock(&pd->lock);
+    return TC_OK;
+}
+
+/* wait for the queued frames to be written; TC_ERROR if any failed */
+static int tc_im_sync(TCIMPrivateData *pd)
+{
+    int ret;
+
+    tc_mutex_lock(&pd->lock);
+    while (pd->queued > 0) {
+        tc_condition_wait(&pd->cond, &pd->lock);
+    }
+    ret = (pd->error) ?TC_ERROR :TC_OK;
+    pd->error = TC_FALSE;
+    tc_mutex_unlock(&pd->lock);
+    return ret;
+}
+
+static void tc_im_pool_stop(TCIMPrivateData *pd)
+{
+    int i;
+
+    if (pd->workers == NULL) {
+        return;
+    }
+
+    tc_mutex_lock(&pd->lock);
+    pd->quit = TC_TRUE;
+    tc_condition_broadcast(&pd->cond);
+    tc_mutex_unlock(&pd->lock);
+
+    for (i = 0; i < pd->nthreads; i++) {
+        tc_thread_wait(&pd->workers[i].thread, NULL);
+        tc_magick_fini(&pd->workers[i].magick);
+    }
+    for (i = 0; i < pd->inflight; i++) {
+        tc_buffree(pd->slots[i].data);
+    }
+    tc_free(pd->slots);
+    tc_free(pd->workers);
+    pd->slots    = NULL;
+    pd->workers  = NULL;
+    pd->nthreads = 0;
+}
+
+static int tc_im_pool_start(TCIMPrivateData *pd, int nthreads)
+{
+    int i;
+
+    pd->head   = 0;
+    pd->tail   = 0;
+    pd->queued = 0;
+    pd->number = 0;
+    pd->error  = TC_FALSE;
+    pd->quit   = TC_FALSE;
+    tc_mutex_init(&pd->lock);
+    tc_condition_init(&pd->cond);
+
+    pd->slots = tc_zalloc(pd->inflight * sizeof(TCIMSlot));
+    pd->workers = tc_zalloc(nthreads * sizeof(TCIMWorker));
+    if (pd->slots == NULL || pd->workers == NULL) {
+        goto nomem;
+    }
+    for (i = 0; i < pd->inflight; i++) {
+        pd->slots[i].data = tc_bufalloc(pd->width * pd->height * 3);
+        if (pd->slots[i].data == NULL) {
+            goto nomem;
+        }
+    }
+
+    /* one at time: tc_magick_init isn't safe to race */
+    for (i = 0; i < nthreads; i++) {
+        TCIMWorker *worker = &pd->workers[i];
+
+        worker->pd = pd;
+        if (tc_magick_init(&worker->magick, pd->quality) != TC_OK) {
+            tc_log_error(MOD_NAME, "cannot create Magick context");
+            break;
+        }
+        tc_thread_init(&worker->thread, "encode_im");
+        if (tc_thread_start(&worker->thread, tc_im_worker,
+                            worker) != TC_OK) {
+            tc_log_error(MOD_NAME, "cannot start encoding thread");
+            tc_magick_fini(&worker->magick);
+            break;
+        }
+        pd->nthreads++;
+    }
+    if (pd->nthreads < nthreads) {
+        tc_im_pool_stop(pd);
+        return TC_ERROR;
+    }
+    return TC_OK;
+
+  nomem:
+    tc_log_error(MOD_NAME, "out of memory");
+    if (pd->slots != NULL) {
+        for (i = 0; i < pd->inflight; i++) {
+            tc_buffree(pd->slots[i].data);
+        }
+    }
+    tc_free(pd->slots);
+    tc_free(pd->workers);
+    pd->slots   = NULL;
+    pd->workers = NULL;
+    return TC_ERROR;
+}
+
+/* queue a copy of the frame, waiting for room if needed */
+static int tc_im_queue(TCIMPrivateData *pd, const uint8_t *data)
+{
+    TCIMSlot *slot = &pd->slots[pd->tail];
+    int ret = TC_OK;
+
+    /* slots are claimed in order, but can complete out of order */
+    tc_mutex_lock(&pd->lock);
+    while (slot->state != IM_SLOT_FREE) {
+        tc_condition_wait(&pd->cond, &pd->lock);
+    }
+    if (pd->error) {
+        /* report it once, then go on */
+        pd->error = TC_FALSE;
+        ret = TC_ERROR;
+    }
+    tc_mutex_unlock(&pd->lock);
+
+    /* a FREE slot is never touched by the workers */
+    ac_memcpy(slot->data, data, pd->width * pd->height * 3);
+    slot->number = pd->number++;
+
+    tc_mutex_lock(&pd->lock);
+    slot->state = IM_SLOT_QUEUED;
+    pd->tail = (pd->tail + 1) % pd->inflight;
+    pd->queued++;
+    tc_condition_broadcast(&pd->cond);
+    tc_mutex_unlock(&pd->lock);
+    return ret;
+}
+
+/*************************************************************************/
+
 static int tc_im_configure(TCModuleInstance *self,
                           const char *options,
                           vob_t *vob,
@@ -90,7 +322,7 @@ static int tc_im_configure(TCModuleInstance *self,
 {
     TCCodecID id = TC_CODEC_ERROR;
     TCIMPrivateData *pd = NULL;
-    int ret = 0;
+    int ret = 0, nthreads = 0;
 
     TC_MODULE_SELF_CHECK(self, "configure");
 
@@ -102,7 +334,7 @@ static int tc_im_configure(TCModuleInstance *self,
 
     pd->img_fmt[0] = '\0';
 
-    ret = optstr_get(options, "format", "%15s", pd->img_fmt);
+    ret = optstr_get(options, "format", "%15[^:]", pd->img_fmt);
     if (ret != 1) {
         /* missing option, let's use the default */
         strlcpy(pd->img_fmt, DEFAULT_FORMAT, sizeof(pd->img_fmt));
@@ -125,9 +357,31 @@ static int tc_im_configure(TCModuleInstance *self,
         pd->quality = DEFAULT_QUALITY;
     }
 
+    nthreads = 0;
+    optstr_get(options, "threads", "%i", &nthreads);
+    if (nthreads < 0 || nthreads > MAX_THREADS) {
+        tc_log_error(MOD_NAME, "threads must be between 0 and %i",
+                     MAX_THREADS);
+        return TC_ERROR;
+    }
+    pd->inflight = 2 * nthreads;
+    optstr_get(options, "inflight", "%i", &pd->inflight);
+    if (nthreads > 0 && pd->inflight < 1) {
+        tc_log_error(MOD_NAME, "inflight must be at least 1");
+        return TC_ERROR;
+    }
+    pd->prefix = (vob->video_out_file != NULL
+                  && strcmp(vob->video_out_file, "/dev/null") != 0)
+                 ?vob->video_out_file :DEFAULT_PREFIX;
+
     if (verbose >= TC_INFO) {
         tc_log_info(MOD_NAME, "encoding %s with quality %lu",
                     pd->img_fmt, pd->quality);
+        if (nthreads > 0) {
+            tc_log_info(MOD_NAME, "writing %s%%06u.%s with %i thread(s),"
+                                  " %i frame(s) in flight",
+                        pd->prefix, pd->img_fmt, nthreads, pd->inflight);
+        }
     }
 
     ret = tc_magick_init(&pd->magick, pd->quality);
@@ -135,6 +389,17 @@ static int tc_im_configure(TCModuleInstance *self,
         tc_log_error(MOD_NAME, "cannot create Magick context");
         return ret;
     }
+
+    pd->nthreads = 0;
+    pd->workers  = NULL;
+    pd->slots    = NULL;
+    if (nthreads > 0) {
+        ret = tc_im_pool_start(pd, nthreads);
+        if (ret != TC_OK) {
+            tc_magick_fini(&pd->magick);
+            return ret;
+        }
+    }
     return TC_OK;
 }
 
@@ -157,18 +422,34 @@ static int tc_im_inspect(TCModuleInstance *self,
         tc_snprintf(pd->opt_buf, sizeof(pd->opt_buf), "%lu", pd->quality);
         *value = pd->opt_buf;
     }
+    if (optstr_lookup(param, "threads")) {
+        tc_snprintf(pd->opt_buf, sizeof(pd->opt_buf), "%i", pd->nthreads);
+        *value = pd->opt_buf;
+    }
+    if (optstr_lookup(param, "inflight")) {
+        tc_snprintf(pd->opt_buf, sizeof(pd->opt_buf), "%i", pd->inflight);
+        *value = pd->opt_buf;
+    }
     return TC_OK;
 }
 
 static int tc_im_stop(TCModuleInstance *self)
 {
     TCIMPrivateData *pd = NULL;
+    int ret = TC_OK;
 
     TC_MODULE_SELF_CHECK(self, "stop");
 
     pd = self->userdata;
 
-    return tc_magick_fini(&pd->magick);
+    if (pd->workers != NULL) {
+        ret = tc_im_sync(pd);
+        tc_im_pool_stop(pd);
+    }
+    if (tc_magick_fini(&pd->magick) != TC_OK) {
+        ret = TC_ERROR;
+    }
+    return ret;
 }
 
 TC_MODULE_GENERIC_INIT(tc_im, TCIMPrivateData);
@@ -185,6 +466,13 @@ static int tc_im_encode_video(TCModuleInstance *self,
 
     pd = self->userdata;
 
+    if (pd->workers != NULL) {
+        /* nothing to multiplex: the workers write the files */
+        outframe->video_len = 0;
+        outframe->attributes |= TC_FRAME_IS_KEYFRAME;
+        return tc_im_queue(pd, inframe->video_buf);
+    }
+
     ret = tc_magick_RGBin(&pd->magick, pd->width, pd->height,
                           inframe->video_buf);
     if (ret != TC_OK) {
@@ -197,6 +485,20 @@ static int tc_im_encode_video(TCModuleInstance *self,
 }
 
 
+static int tc_im_flush_video(TCModuleInstance *self,
+                             TCFrameVideo *outframe, int *frame_returned)
+{
+    TCIMPrivateData *pd = NULL;
+
+    TC_MODULE_SELF_CHECK(self, "flush_video");
+
+    pd = self->userdata;
+
+    *frame_returned = 0;
+    return (pd->workers != NULL) ?tc_im_sync(pd) :TC_OK;
+}
+
+
 /*************************************************************************/
 
 static const TCCodecID tc_im_codecs_video_in[] = { 
@@ -217,6 +519,7 @@ static const TCModuleClass tc_im_class = {
     .inspect      = tc_im_inspect,
 
     .encode_video = tc_im_encode_video,
+    .flush_video  = tc_im_flush_video,
 };
 
 TC_MODULE_ENTRY_POINT(tc_im);
@@ -36,14 +36,14 @@
 #include <math.h>
 
 #define MOD_NAME    "encode_lavc.so"
-#define MOD_VERSION "v0.1.1 (2009-02-07)"
+#define MOD_VERSION "v0.1.2 (2026-10-18)"
 #define MOD_CAP     "libavcodec based encoder (" LIBAVCODEC_IDENT ")"
 
 #define MOD_FEATURES \
     TC_MODULE_FEATURE_ENCODE|TC_MODULE_FEATURE_VIDEO|TC_MODULE_FEATURE_AUDIO
 
 #define MOD_FLAGS \
-    TC_MODULE_FLAG_RECONFIGURABLE
+    TC_MODULE_FLAG_RECONFIGURABLE|TC_MODULE_FLAG_REPEAT
 
 #define LAVC_CONFIG_FILE "lavc.cfg"
 #define PSNR_LOG_FILE    "psnr.log"
@@ -1644,6 +1644,15 @@ static int tc_lavc_encode_video(TCModuleInstance *self,
 
     pd = self->userdata;
 
+    /* without B-frames nothing is reordered, so a repeated frame
+     * can be left to the multiplexor */
+    if ((inframe->attributes & TC_FRAME_IS_REPEAT)
+     && pd->ff_vcontext.max_b_frames == 0) {
+        outframe->video_len = 0;
+        outframe->attributes |= TC_FRAME_IS_REPEAT;
+        return TC_OK;
+    }
+
     pd->ff_venc_frame.interlaced_frame = pd->interlacing.active;
     pd->ff_venc_frame.top_field_first  = pd->interlacing.top_first;
 
@@ -58,14 +58,14 @@
  ****************************************************************************/
 
 #define MOD_NAME    "encode_xvid.so"
-#define MOD_VERSION "v0.0.7 (2009-02-07)"
+#define MOD_VERSION "v0.0.9 (2026-10-18)"
 #define MOD_CAP     "XviD 1.1.x encoder"
 
 #define MOD_FEATURES \
     TC_MODULE_FEATURE_ENCODE|TC_MODULE_FEATURE_VIDEO
 
 #define MOD_FLAGS \
-    TC_MODULE_FLAG_RECONFIGURABLE
+    TC_MODULE_FLAG_RECONFIGURABLE|TC_MODULE_FLAG_REPEAT
 
 
 #define XVID_CONFIG_FILE "xvid.cfg"
@@ -329,10 +329,22 @@ static int tc_xvid_encode_video(TCModuleInstance *self,
 
     pd = self->userdata;
 
+    /* Without B-frames nothing is reordered, so a repeated frame can be
+     * left to the multiplexor */
+    if ((inframe->attributes & TC_FRAME_IS_REPEAT)
+     && pd->xvid_enc_create.max_bframes == 0) {
+        outframe->video_len = 0;
+        outframe->attributes |= TC_FRAME_IS_REPEAT;
+        return TC_OK;
+    }
+
     /* Init the stat structure */
     memset(&xvid_enc_stats, 0, sizeof(xvid_enc_stats_t));
     xvid_enc_stats.version = XVID_VERSION;
 
+    if (vob->im_v_codec != TC_CODEC_YUV420P) {
+        tc_unshare_video_frame(inframe);  /* converted in place */
+    }
     if(vob->im_v_codec == TC_CODEC_YUV422P) {
         /* Convert to UYVY */
         tcv_convert(pd->tcvhandle, inframe->video_buf, inframe->video_buf,
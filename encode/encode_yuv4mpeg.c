@@ -25,7 +25,7 @@
 /*************************************************************************/
 
 #define MOD_NAME    "encode_yuv4mpeg.so"
-#define MOD_VERSION "v0.2.0 (2009-07-13)"
+#define MOD_VERSION "v0.2.1 (2026-10-18)"
 #define MOD_CAP     "YUV4MPEG encoder (uncompressed YUV stream)"
 
 #define MOD_FEATURES \
@@ -257,6 +257,9 @@ static int tc_yuv4mpeg_encode_video(TCModuleInstance *self,
         return TC_OK;
     }
 
+    if (pd->srcfmt != IMG_YUV420P) {
+        tc_unshare_video_frame(inframe);  /* converted in place */
+    }
     if (!tcv_convert(pd->tcvhandle, inframe->video_buf, inframe->video_buf,
                      vob->ex_v_width, vob->ex_v_height,
                      pd->srcfmt, IMG_YUV420P)) {
@@ -22,14 +22,21 @@
  */
 
 #define MOD_NAME    "filter_32detect.so"
-#define MOD_VERSION "v0.2.4 (2003-07-22)"
+#define MOD_VERSION "v0.3.1 (2026-10-18)"
 #define MOD_CAP     "3:2 pulldown / interlace detection plugin"
 #define MOD_AUTHOR  "Thomas Oestreich"
 
+#define MOD_FEATURES \
+    TC_MODULE_FEATURE_FILTER|TC_MODULE_FEATURE_VIDEO
+#define MOD_FLAGS \
+    TC_MODULE_FLAG_RECONFIGURABLE|TC_MODULE_FLAG_REENTRANT
+
 #include "src/transcode.h"
 #include "src/filter.h"
 #include "libtc/libtc.h"
 #include "libtcutil/optstr.h"
+#include "libtcutil/tcthread.h"
+#include "libtcmodule/tcmodule-plugin.h"
 
 #include <stdint.h>
 
@@ -39,250 +46,438 @@
 #define COLOR_DIFF   30
 #define THRESHOLD     9
 
-/* FIXME: these all use the filter ID as an index--the ID can grow
- * arbitrarily large, so this needs to be fixed */
-static int color_diff_threshold1[100];  //=COLOR_EQUAL;
-static int color_diff_threshold2[100];  //=COLOR_DIFF;
-static int chroma_diff_threshold1[100]; //=COLOR_EQUAL/2;
-static int chroma_diff_threshold2[100]; //=COLOR_DIFF/2;
+/*************************************************************************/
+
+static const char detect32_help[] = ""
+    "* Overview\n"
+    "    This filter checks for interlaced video frames.\n"
+    "    Subsequent de-interlacing with transcode can be enforced with\n"
+    "    'force_mode' option\n"
+    "\n"
+    "* Options\n"
+    "   'threshold' interlace detection threshold [9]\n"
+    "   'chromathres' interlace detection chroma threshold [4]\n"
+    "   'equal' threshold for equal colors [10]\n"
+    "   'chromaeq' threshold for equal chroma [5]\n"
+    "   'diff' threshold for different colors [30]\n"
+    "   'chromadi' threshold for different colors [15]\n"
+    "   'force_mode' set internal force de-interlace flag with mode -I N [0]\n"
+    "   'pre' run as pre filter [1]\n"
+    "   'verbose' show results [off]\n";
 
-static int force_mode=0;
-static int threshold[100];              //=THRESHOLD;
-static int chroma_threshold[100];       //=THRESHOLD/2;
-static int show_results[100];           //=0;
+/*
+ * All the per-instance state lives here. Apart from the statistics,
+ * which are guarded by their own lock, nothing is modified after
+ * configure(), so any number of frames can be analyzed concurrently
+ * by the same instance.
+ */
+typedef struct detect32privatedata_ Detect32PrivateData;
+struct detect32privatedata_ {
+    int color_diff_threshold1;
+    int color_diff_threshold2;
+    int chroma_diff_threshold1;
+    int chroma_diff_threshold2;
+
+    int threshold;
+    int chroma_threshold;
+    int show_results;
+    int force_mode;
+    int pre;
+
+    int is_rgb;
+
+    TCMutex lock;       /* protects the statistics below */
+    int frames;         /* frames checked */
+    int interlaced;     /* frames found interlaced */
+    int share;          /* interlaced share in tenths, -1 if no frames */
+    int changes;        /* times the share changed */
+
+    char conf_str[TC_BUF_MIN];
+};
+
+/*************************************************************************/
+
+static int interlace_test(Detect32PrivateData *pd, uint8_t *video_buf,
+                          int width, int height, int id, int instance,
+                          int thres, int eq, int diff)
+{
+    int j, n, off, block, cc_1, cc_2, cc, flag;
+    uint16_t s1, s2, s3, s4;
 
-static int pre[100];	// = 0;
+    cc_1  = 0;
+    cc_2  = 0;
+    block = width;
+    flag  = 0;
 
-/*-------------------------------------------------
- *
- * single function interface
- *
- *-------------------------------------------------*/
+    for (j = 0; j < block; ++j) {
+        off = 0;
 
-static inline int sq( int d ) { return d * d; }
+        for (n = 0; n < (height - 4); n = n + 2) {
+            s1 = (video_buf[off+j        ] & 0xff);
+            s2 = (video_buf[off+j+  block] & 0xff);
+            s3 = (video_buf[off+j+2*block] & 0xff);
+            s4 = (video_buf[off+j+3*block] & 0xff);
 
-static void help_optstr(void)
-{
-    tc_log_info(MOD_NAME, "(%s) help\n"
-"* Overview\n"
-"    This filter checks for interlaced video frames.\n"
-"    Subsequent de-interlacing with transcode can be enforced with 'force_mode' option\n"
-"\n"
-"* Options\n"
-"   'threshold' interlace detection threshold [%d]\n"
-"   'chromathres' interlace detection chroma threshold [%d]\n"
-"   'equal' threshold for equal colors [%d]\n"
-"   'chromaeq' threshold for equal chroma [%d]\n"
-"   'diff' threshold for different colors [%d]\n"
-"   'chromadi' threshold for different colors [%d]\n"
-"   'force_mode' set internal force de-interlace flag with mode -I N [0]\n"
-"   'pre' run as pre filter [1]\n"
-"   'verbose' show results [off]\n"
-		, MOD_CAP,
-		THRESHOLD,
-		THRESHOLD/2,
-		COLOR_EQUAL,
-		COLOR_EQUAL/2,
-		COLOR_DIFF,
-		COLOR_DIFF/2);
-}
+            if ((abs(s1 - s3) < eq) && (abs(s1 - s2) > diff))
+                ++cc_1;
 
-static int interlace_test(char *video_buf, int width, int height, int id, int instance, int thres, int eq, int diff)
-{
+            if ((abs(s2 - s4) < eq) && (abs(s2 - s3) > diff))
+                ++cc_2;
 
-    int j, n, off, block, cc_1, cc_2, cc, flag;
+            off += 2*block;
+        }
+    }
 
-    uint16_t s1, s2, s3, s4;
+    // compare results
 
-    cc_1 = 0;
-    cc_2 = 0;
+    cc = (int)((cc_1 + cc_2)*1000.0/(width*height));
 
-    block = width;
+    flag = (cc > thres) ?1 :0;
 
-    flag = 0;
+    if (pd->show_results) {
+        tc_log_info(MOD_NAME, "(%d) frame [%06d]: (1) = %5d | (2) = %5d "
+                              "| (3) = %3d | interlaced = %s",
+                              instance, id, cc_1, cc_2, cc,
+                              ((flag) ?"yes" :"no"));
+    }
+    return flag;
+}
 
-    for(j=0; j<block; ++j) {
+/*************************************************************************/
 
-	off=0;
+/* Module interface routines and data. */
 
-	for(n=0; n<(height-4); n=n+2) {
+/*************************************************************************/
 
+/**
+ * detect32_init:  Initialize this instance of the module.  See
+ * tcmodule-data.h for function details.
+ */
+
+TC_MODULE_GENERIC_INIT(detect32, Detect32PrivateData)
 
-	    s1 = (video_buf[off+j        ] & 0xff);
-	    s2 = (video_buf[off+j+  block] & 0xff);
-	    s3 = (video_buf[off+j+2*block] & 0xff);
-	    s4 = (video_buf[off+j+3*block] & 0xff);
+/*************************************************************************/
+
+/**
+ * detect32_fini:  Clean up after this instance of the module.  See
+ * tcmodule-data.h for function details.
+ */
 
-	    if((abs(s1 - s3) < eq) &&
-	       (abs(s1 - s2) > diff)) ++cc_1;
+TC_MODULE_GENERIC_FINI(detect32)
 
-	    if((abs(s2 - s4) < eq) &&
-	       (abs(s2 - s3) > diff)) ++cc_2;
+/*************************************************************************/
 
-	    off +=2*block;
-	}
+/**
+ * detect32_configure:  Configure this instance of the module.  See
+ * tcmodule-data.h for function details.
+ */
+
+static int detect32_configure(TCModuleInstance *self,
+                              const char *options,
+                              TCJob *vob,
+                              TCModuleExtraData *xdata[])
+{
+    Detect32PrivateData *pd = NULL;
+
+    TC_MODULE_SELF_CHECK(self, "configure");
+
+    pd = self->userdata;
+
+    /* enforce defaults */
+    pd->color_diff_threshold1  = COLOR_EQUAL;
+    pd->chroma_diff_threshold1 = COLOR_EQUAL/2;
+    pd->color_diff_threshold2  = COLOR_DIFF;
+    pd->chroma_diff_threshold2 = COLOR_DIFF/2;
+    pd->threshold              = THRESHOLD;
+    pd->chroma_threshold       = THRESHOLD/2;
+    pd->show_results           = TC_FALSE;
+    pd->force_mode             = 0;
+    pd->pre                    = TC_TRUE;
+    pd->is_rgb                 = (vob->im_v_codec == TC_CODEC_RGB24);
+
+    tc_mutex_init(&pd->lock);
+    pd->frames                 = 0;
+    pd->interlaced             = 0;
+    pd->share                  = -1;
+    pd->changes                = 0;
+
+    if (options) {
+        if (verbose) {
+            tc_log_info(MOD_NAME, "options=%s", options);
+        }
+
+        optstr_get(options, "threshold",   "%d", &pd->threshold);
+        optstr_get(options, "chromathres", "%d", &pd->chroma_threshold);
+        optstr_get(options, "force_mode",  "%d", &pd->force_mode);
+        optstr_get(options, "equal",       "%d", &pd->color_diff_threshold1);
+        optstr_get(options, "chromaeq",    "%d", &pd->chroma_diff_threshold1);
+        optstr_get(options, "diff",        "%d", &pd->color_diff_threshold2);
+        optstr_get(options, "chromadi",    "%d", &pd->chroma_diff_threshold2);
+        optstr_get(options, "pre",         "%d", &pd->pre);
+
+        if (optstr_lookup(options, "verbose") != NULL) {
+            pd->show_results = TC_TRUE;
+        }
+        if (optstr_lookup(options, "help") != NULL) {
+            tc_log_info(MOD_NAME, "(%s) help\n%s", MOD_CAP, detect32_help);
+        }
     }
 
-    // compare results
+    return TC_OK;
+}
 
-    cc = (int)((cc_1 + cc_2)*1000.0/(width*height));
+/*************************************************************************/
+
+/**
+ * detect32_stop:  Reset this instance of the module.  See tcmodule-data.h
+ * for function details.
+ */
 
-    flag = (cc > thres) ? 1:0;
+static int detect32_stop(TCModuleInstance *self)
+{
+    Detect32PrivateData *pd = NULL;
 
+    TC_MODULE_SELF_CHECK(self, "stop");
 
-    if(show_results[instance])
-        tc_log_info(MOD_NAME, "(%d) frame [%06d]: (1) = %5d | (2) = %5d "
-                              "| (3) = %3d | interlaced = %s",
-                              instance, id, cc_1, cc_2, cc,
-                              ((flag)?"yes":"no"));
+    pd = self->userdata;
 
-    return(flag);
+    if (pd->frames > 0) {
+        tc_log_info(MOD_NAME, "(%d) %d of %d frames (%d%%) interlaced",
+                    self->id, pd->interlaced, pd->frames,
+                    pd->interlaced * 100 / pd->frames);
+    }
+    pd->frames     = 0;
+    pd->interlaced = 0;
+    pd->share      = -1;
+
+    return TC_OK;
 }
 
-int tc_filter(frame_list_t *ptr_, char *options)
+/*************************************************************************/
+
+/**
+ * detect32_inspect:  Return the value of an option in this instance of
+ * the module.  See tcmodule-data.h for function details.
+ */
+
+#define INSPECT_PARAM(NAME, FIELD) do { \
+    if (optstr_lookup(param, NAME)) { \
+        tc_snprintf(pd->conf_str, sizeof(pd->conf_str), \
+                    "%s=%i", NAME, pd->FIELD); \
+        *value = pd->conf_str; \
+    } \
+} while (0)
+
+static int detect32_inspect(TCModuleInstance *self,
+                            const char *param, const char **value)
 {
-  vframe_list_t *ptr = (vframe_list_t *)ptr_;
-  static vob_t *vob=NULL;
+    Detect32PrivateData *pd = NULL;
 
-  int is_interlaced = 0;
-  int instance = ptr->filter_id;
+    TC_MODULE_SELF_CHECK(self,  "inspect");
+    TC_MODULE_SELF_CHECK(param, "inspect");
 
-  //----------------------------------
-  //
-  // filter init
-  //
-  //----------------------------------
+    pd = self->userdata;
 
+    if (optstr_lookup(param, "help")) {
+        *value = detect32_help;
+    }
 
-  if(ptr->tag & TC_FILTER_GET_CONFIG) {
-      char buf[255];
-      optstr_filter_desc (options, MOD_NAME, MOD_CAP, MOD_VERSION, "Thomas", "VRYMEO", "1");
+    INSPECT_PARAM("threshold",   threshold);
+    INSPECT_PARAM("chromathres", chroma_threshold);
+    INSPECT_PARAM("equal",       color_diff_threshold1);
+    INSPECT_PARAM("chromaeq",    chroma_diff_threshold1);
+    INSPECT_PARAM("diff",        color_diff_threshold2);
+    INSPECT_PARAM("chromadi",    chroma_diff_threshold2);
+    INSPECT_PARAM("force_mode",  force_mode);
+    INSPECT_PARAM("pre",         pre);
 
-      tc_snprintf(buf, sizeof(buf), "%d", THRESHOLD);
-      optstr_param (options, "threshold", "Interlace detection threshold", "%d", buf, "0", "255");
+    return TC_OK;
+}
 
-      tc_snprintf(buf, sizeof(buf), "%d", THRESHOLD/2);
-      optstr_param (options, "chromathres", "Interlace detection chroma threshold", "%d", buf, "0", "255");
+#undef INSPECT_PARAM
 
-      tc_snprintf(buf, sizeof(buf), "%d", COLOR_EQUAL);
-      optstr_param (options, "equal", "threshold for equal colors", "%d", buf, "0", "255");
+/*************************************************************************/
 
-      tc_snprintf(buf, sizeof(buf), "%d", COLOR_EQUAL/2);
-      optstr_param (options, "chromaeq", "threshold for equal chroma", "%d", buf, "0", "255");
+/**
+ * detect32_filter_video:  check a video frame for interlacing artifacts
+ * and optionally mark it for the core deinterlacer. See tcmodule-data.h
+ * for function details.
+ */
 
-      tc_snprintf(buf, sizeof(buf), "%d", COLOR_DIFF);
-      optstr_param (options, "diff", "threshold for different colors", "%d", buf, "0", "255");
+static int detect32_filter_video(TCModuleInstance *self,
+                                 vframe_list_t *frame)
+{
+    Detect32PrivateData *pd = NULL;
+    int is_interlaced = 0;
+    int w = 0, h = 0;
+
+    TC_MODULE_SELF_CHECK(self,  "filter");
+    TC_MODULE_SELF_CHECK(frame, "filter");
+
+    pd = self->userdata;
+    w  = frame->v_width;
+    h  = frame->v_height;
+
+    if (pd->is_rgb) {
+        is_interlaced = interlace_test(pd, frame->video_buf,
+                                       3*w, h, frame->id, self->id,
+                                       pd->threshold,
+                                       pd->color_diff_threshold1,
+                                       pd->color_diff_threshold2);
+    } else {
+        is_interlaced += interlace_test(pd, frame->video_buf,
+                                        w, h, frame->id, self->id,
+                                        pd->threshold,
+                                        pd->color_diff_threshold1,
+                                        pd->color_diff_threshold2);
+        is_interlaced += interlace_test(pd, frame->video_buf + w*h,
+                                        w/2, h/2, frame->id, self->id,
+                                        pd->chroma_threshold,
+                                        pd->chroma_diff_threshold1,
+                                        pd->chroma_diff_threshold2);
+        is_interlaced += interlace_test(pd, frame->video_buf + w*h*5/4,
+                                        w/2, h/2, frame->id, self->id,
+                                        pd->chroma_threshold,
+                                        pd->chroma_diff_threshold1,
+                                        pd->chroma_diff_threshold2);
+    }
 
-      tc_snprintf(buf, sizeof(buf), "%d", COLOR_DIFF/2);
-      optstr_param (options, "chromadi", "threshold for different chroma", "%d", buf, "0", "255");
+    /* force de-interlacing? */
+    if (pd->force_mode && is_interlaced) {
+        frame->attributes  |= TC_FRAME_IS_INTERLACED;
+        frame->deinter_flag = pd->force_mode;
+    }
 
-      optstr_param (options, "force_mode", "set internal force de-interlace flag with mode -I N",
-	      "%d", "0", "0", "5");
+    tc_mutex_lock(&pd->lock);
+    pd->frames++;
+    if (is_interlaced) {
+        pd->interlaced++;
+    }
+    if (pd->interlaced * 10 / pd->frames != pd->share) {
+        pd->share = pd->interlaced * 10 / pd->frames;
+        pd->changes++;
+    }
+    tc_mutex_unlock(&pd->lock);
 
-      optstr_param (options, "pre", "run as pre filter", "%d", "1", "0", "1");
-      optstr_param (options, "verbose", "show results", "", "0");
-      return (0);
-  }
+    return TC_OK;
+}
 
-  if(ptr->tag & TC_FILTER_INIT) {
+/*************************************************************************/
 
-      if((vob = tc_get_vob())==NULL) return(-1);
+static const TCCodecID detect32_codecs_video_in[] = {
+    TC_CODEC_YUV420P, TC_CODEC_RGB24, TC_CODEC_ERROR
+};
+static const TCCodecID detect32_codecs_video_out[] = {
+    TC_CODEC_YUV420P, TC_CODEC_RGB24, TC_CODEC_ERROR
+};
+TC_MODULE_AUDIO_UNSUPPORTED(detect32);
+TC_MODULE_FILTER_FORMATS(detect32);
 
-      color_diff_threshold1[instance]  = COLOR_EQUAL;
-      chroma_diff_threshold1[instance] = COLOR_EQUAL/2;
-      color_diff_threshold2[instance]  = COLOR_DIFF;
-      chroma_diff_threshold2[instance] = COLOR_DIFF/2;
-      threshold[instance]              = THRESHOLD;
-      chroma_threshold[instance]       = THRESHOLD/2;
-      show_results[instance]           = 0;
-      pre[instance]                    = 1;
+TC_MODULE_INFO(detect32);
 
-      // filter init ok.
+static const TCModuleClass detect32_class = {
+    TC_MODULE_CLASS_HEAD(detect32),
 
-      if(verbose) tc_log_info(MOD_NAME, "%s %s", MOD_VERSION, MOD_CAP);
+    .init         = detect32_init,
+    .fini         = detect32_fini,
+    .configure    = detect32_configure,
+    .stop         = detect32_stop,
+    .inspect      = detect32_inspect,
 
-      // process filter options:
+    .filter_video = detect32_filter_video,
+};
 
-      if (options != NULL) {
+TC_MODULE_ENTRY_POINT(detect32)
 
-	  if(verbose) tc_log_info(MOD_NAME, "options=%s", options);
+/*************************************************************************/
 
-	  optstr_get (options, "threshold", "%d",  &threshold[instance]);
-	  optstr_get (options, "chromathres", "%d",  &chroma_threshold[instance]);
-	  optstr_get (options, "force_mode", "%d",  &force_mode);
-	  optstr_get (options, "equal", "%d",  &color_diff_threshold1[instance]);
-	  optstr_get (options, "chromaeq", "%d",  &chroma_diff_threshold1[instance]);
-	  optstr_get (options, "diff", "%d",  &color_diff_threshold2[instance]);
-	  optstr_get (options, "chromadi", "%d",  &chroma_diff_threshold2[instance]);
-	  optstr_get (options, "pre", "%d",  &pre[instance]);
+static int detect32_get_config(TCModuleInstance *self, char *options)
+{
+    char buf[TC_BUF_MIN];
 
-	  if (optstr_lookup (options, "verbose") != NULL) {
-	      show_results[instance]=1;
-	  }
+    TC_MODULE_SELF_CHECK(self, "get_config");
 
-	  if (optstr_lookup (options, "help") != NULL) {
-	      help_optstr();
-	  }
-      }
+    optstr_filter_desc(options, MOD_NAME, MOD_CAP, MOD_VERSION,
+                       "Thomas", "VRYMEO", "1");
 
-      return(0);
-  }
+    tc_snprintf(buf, sizeof(buf), "%d", THRESHOLD);
+    optstr_param(options, "threshold", "Interlace detection threshold",
+                 "%d", buf, "0", "255");
 
-  //----------------------------------
-  //
-  // filter close
-  //
-  //----------------------------------
+    tc_snprintf(buf, sizeof(buf), "%d", THRESHOLD/2);
+    optstr_param(options, "chromathres",
+                 "Interlace detection chroma threshold",
+                 "%d", buf, "0", "255");
 
+    tc_snprintf(buf, sizeof(buf), "%d", COLOR_EQUAL);
+    optstr_param(options, "equal", "threshold for equal colors",
+                 "%d", buf, "0", "255");
 
-  if(ptr->tag & TC_FILTER_CLOSE) {
-    return(0);
-  }
+    tc_snprintf(buf, sizeof(buf), "%d", COLOR_EQUAL/2);
+    optstr_param(options, "chromaeq", "threshold for equal chroma",
+                 "%d", buf, "0", "255");
 
-  //----------------------------------
-  //
-  // filter frame routine
-  //
-  //----------------------------------
+    tc_snprintf(buf, sizeof(buf), "%d", COLOR_DIFF);
+    optstr_param(options, "diff", "threshold for different colors",
+                 "%d", buf, "0", "255");
 
+    tc_snprintf(buf, sizeof(buf), "%d", COLOR_DIFF/2);
+    optstr_param(options, "chromadi", "threshold for different chroma",
+                 "%d", buf, "0", "255");
 
-  // tag variable indicates, if we are called before
-  // transcodes internal video/audo frame processing routines
-  // or after and determines video/audio context
+    optstr_param(options, "force_mode",
+                 "set internal force de-interlace flag with mode -I N",
+                 "%d", "0", "0", "5");
 
-  if (!(ptr->tag & TC_VIDEO))
-	  return (0);
+    optstr_param(options, "pre", "run as pre filter", "%d", "1", "0", "1");
+    optstr_param(options, "verbose", "show results", "", "0");
 
-  //if((ptr->tag & TC_PRE_M_PROCESS) && (ptr->tag & TC_VIDEO))  {
-  if(((ptr->tag & TC_PRE_M_PROCESS  && pre[instance]) ||
-	  (ptr->tag & TC_POST_M_PROCESS && !pre[instance])) && !(ptr->attributes & TC_FRAME_IS_SKIPPED)) {
+    return TC_OK;
+}
 
-    //if (ptr->tag & TC_PRE_M_PROCESS) tc_log_msg(MOD_NAME, "32#%d pre (%d)", instance, ptr->id);
-    //if (ptr->tag & TC_POST_M_PROCESS) tc_log_msg(MOD_NAME, "32#%d post (%d)", instance, ptr->id);
+static int detect32_process(TCModuleInstance *self, frame_list_t *frame)
+{
+    Detect32PrivateData *pd = NULL;
 
-    if(vob->im_v_codec==TC_CODEC_RGB24) {
-	is_interlaced = interlace_test(ptr->video_buf, 3*ptr->v_width, ptr->v_height, ptr->id, instance,
-		threshold[instance], color_diff_threshold1[instance], color_diff_threshold2[instance]);
-    } else {
-	is_interlaced += interlace_test(ptr->video_buf, ptr->v_width, ptr->v_height, ptr->id, instance,
-		threshold[instance], color_diff_threshold1[instance], color_diff_threshold2[instance]);
-	is_interlaced += interlace_test(ptr->video_buf+ptr->v_width*ptr->v_height, ptr->v_width/2, ptr->v_height/2, ptr->id, instance,
-		chroma_threshold[instance], chroma_diff_threshold1[instance], chroma_diff_threshold2[instance]);
-	is_interlaced += interlace_test(ptr->video_buf+ptr->v_width*ptr->v_height*5/4, ptr->v_width/2, ptr->v_height/2, ptr->id, instance,
-		chroma_threshold[instance], chroma_diff_threshold1[instance], chroma_diff_threshold2[instance]);
-    }
+    TC_MODULE_SELF_CHECK(self, "process");
 
-    //force de-interlacing?
-    if(force_mode && is_interlaced) {
-	ptr->attributes  |= TC_FRAME_IS_INTERLACED;
-	ptr->deinter_flag = force_mode;
-    }
+    pd = self->userdata;
+
+    if ((frame->tag & TC_VIDEO) && !(frame->attributes & TC_FRAME_IS_SKIPPED)
+       && (((frame->tag & TC_PRE_M_PROCESS) && pd->pre)
+         || ((frame->tag & TC_POST_M_PROCESS) && !pd->pre))) {
+        int changes, ret;
 
-    //reset
-    is_interlaced=0;
+        tc_mutex_lock(&pd->lock);
+        changes = pd->changes;
+        tc_mutex_unlock(&pd->lock);
 
-  }
+        ret = detect32_filter_video(self, (vframe_list_t*)frame);
 
-  return(0);
+        /* the verdict only depends on the share of interlaced frames */
+        tc_mutex_lock(&pd->lock);
+        changes = (changes != pd->changes);
+        tc_mutex_unlock(&pd->lock);
+        tc_filter_report(frame->filter_id, changes);
+        return ret;
+    }
+    return TC_OK;
 }
 
+/*************************************************************************/
+
+/* Old-fashioned module interface. */
+
+TC_FILTER_OLDINTERFACE_M(detect32)
+
+/*************************************************************************/
+
+/*
+ * Local variables:
+ *   c-file-style: "stroustrup"
+ *   c-file-offsets: ((case-label . *) (statement-case-intro . *))
+ *   indent-tabs-mode: nil
+ * End:
+ *
+ * vim: expandtab shiftwidth=4:
+ */
@@ -22,7 +22,7 @@
  */
 
 #define MOD_NAME    "filter_astat.so"
-#define MOD_VERSION "v0.2.1 (2009-02-07)"
+#define MOD_VERSION "v0.2.2 (2026-10-18)"
 #define MOD_CAP     "audio statistics filter plugin"
 #define MOD_AUTHOR  "Thomas Oestreich"
 
@@ -326,7 +326,14 @@ static int astat_process(TCModuleInstance *self, frame_list_t *frame)
 
     if (frame->tag & TC_PRE_S_PROCESS && frame->tag & TC_AUDIO
      && !(frame->attributes & TC_FRAME_IS_SKIPPED)) {
-        return astat_filter_audio(self, (aframe_list_t*)frame);
+        AStatPrivateData *pd = self->userdata;
+        int32_t min = pd->min, max = pd->max;
+        int ret = astat_filter_audio(self, (aframe_list_t*)frame);
+
+        /* the rescale value only depends on the peaks */
+        tc_filter_report(frame->filter_id,
+                         pd->min != min || pd->max != max);
+        return ret;
     }
     return TC_OK;
 }
@@ -22,7 +22,7 @@
  */
 
 #define MOD_NAME      "filter_barrel.so"
-#define MOD_VERSION   "v0.1.0 (2009-07-30)"
+#define MOD_VERSION   "v0.2.0 (2026-10-18)"
 #define MOD_CAP       "apply/remove barrel distortion"
 #define MOD_AUTHOR    "Andrew Church"
 #define MOD_CAPSTRING "VYE"
@@ -39,6 +39,7 @@
 #include "src/filter.h"
 #include "libtc/libtc.h"
 #include "libtcutil/optstr.h"
+#include "libtcutil/tcthread.h"
 #include "libtcmodule/tcmodule-plugin.h"
 
 #include <math.h>
@@ -57,6 +58,7 @@ static const char barrel_help[] =
     "    order4=strength        Strength of order-4 distortion [0]\n"
     "    center=x/y             Center of distortion [center of frame]\n"
     "    range=start-end/step   Apply filter only to given frames [0-oo/1]\n"
+    "    threads=n              Filter n bands of rows in parallel [1]\n"
     ;
 
 /*----------------------------------*/
@@ -72,6 +74,7 @@ typedef struct BarrelPrivateData {
     double order2, order4;          // Order-2 and order-4 filter strength
     int cx, cy;                     // Center of distortion
     unsigned int start, end, step;  // Filter application range and step
+    int threads;                    // Row bands filtered in parallel
 
     char opt_buf[TC_BUF_MIN];       // Return buffer for inspect() method
 
@@ -105,8 +108,12 @@ static int barrel_init(TCModuleInstance *self, uint32_t features)
         tc_log_error(MOD_NAME, "init: out of memory!");
         return TC_ERROR;
     }
+    pd->buf_y = NULL;
+    pd->buf_u = NULL;
+    pd->buf_v = NULL;
     pd->map_y = NULL;
     pd->map_uv = NULL;
+    pd->threads = 1;
 
     self->userdata = pd;
 
@@ -178,6 +185,7 @@ static int barrel_configure(TCModuleInstance *self, const char *options,
     pd->start = 0;
     pd->end = (unsigned int)-1;
     pd->step = 1;
+    pd->threads = 1;
 
     /* Read options */
     if (options != NULL) {
@@ -189,7 +197,9 @@ static int barrel_configure(TCModuleInstance *self, const char *options,
         optstr_get(options, "center", "%d/%d", &pd->cx, &pd->cy);
         optstr_get(options, "range", "%u-%u/%d",
                    &pd->start, &pd->end, &pd->step);
+        optstr_get(options, "threads", "%d", &pd->threads);
     }
+    pd->threads = TC_CLAMP(pd->threads, 1, TC_THREAD_MAX_BANDS);
     if (verbose > TC_INFO) {
         tc_log_info(MOD_NAME, "Barrel distortion settings:");
         tc_log_info(MOD_NAME, "    order2 = %f", pd->order2);
@@ -197,6 +207,7 @@ static int barrel_configure(TCModuleInstance *self, const char *options,
         tc_log_info(MOD_NAME, "    center = %d/%d", pd->cx, pd->cy);
         tc_log_info(MOD_NAME, "     range = %u-%u/%u",
                     pd->start, pd->end, pd->step);
+        tc_log_info(MOD_NAME, "   threads = %d", pd->threads);
     }
 
     /* Allocate temporary frame buffers */
@@ -353,6 +364,10 @@ static int barrel_inspect(TCModuleInstance *self,
                     pd->start, pd->end, pd->step);
         *value = pd->opt_buf; 
     }
+    if (optstr_lookup(param, "threads")) {
+        tc_snprintf(pd->opt_buf, sizeof(pd->opt_buf), "%d", pd->threads);
+        *value = pd->opt_buf; 
+    }
 
     return TC_OK;
 }
@@ -366,7 +381,7 @@ static int barrel_inspect(TCModuleInstance *self,
 
 static void filter_plane(const uint8_t *src, uint8_t *dest,
                          const DistortionMapEntry *map, uint8_t defval,
-                         int width, int height);
+                         int width, int height, int threads);
 
 static int barrel_filter_video(TCModuleInstance *self, vframe_list_t *frame)
 {
@@ -395,11 +410,11 @@ static int barrel_filter_video(TCModuleInstance *self, vframe_list_t *frame)
 
         /* Apply filter to each plane */
         filter_plane(pd->buf_y, ptr_y, pd->map_y,   16,
-                     pd->width,   pd->height);
+                     pd->width,   pd->height,   pd->threads);
         filter_plane(pd->buf_u, ptr_u, pd->map_uv, 128,
-                     pd->width/2, pd->height/2);
+                     pd->width/2, pd->height/2, pd->threads);
         filter_plane(pd->buf_v, ptr_v, pd->map_uv, 128,
-                     pd->width/2, pd->height/2);
+                     pd->width/2, pd->height/2, pd->threads);
     }
 
     return TC_OK;
@@ -418,40 +433,93 @@ static int barrel_filter_video(TCModuleInstance *self, vframe_list_t *frame)
  *     defval: Value for out-of-frame pixels.
  *      width: Width of plane, in pixels.
  *     height: Height of plane, in pixels.
+ *    threads: Number of row bands to filter in parallel.
  * Return value: None.
  */
 
+typedef struct BarrelPlane {
+    const uint8_t *src;
+    uint8_t *dest;
+    const DistortionMapEntry *map;
+    uint8_t defval;
+    int width, height;
+} BarrelPlane;
+
+static void filter_rows(void *datum, int band, int first, int last);
+
 static void filter_plane(const uint8_t *src, uint8_t *dest,
                          const DistortionMapEntry *map, uint8_t defval,
-                         int width, int height)
+                         int width, int height, int threads)
 {
-    int x, y, index;
+    BarrelPlane plane;
 
     if (!src || !dest) {
         tc_log_error(MOD_NAME, "filter_plane(): NULL pointer(s)!");
         return;
     }
 
-    for (index = 0, y = 0; y < height; y++) {
+    plane.src    = src;
+    plane.dest   = dest;
+    plane.map    = map;
+    plane.defval = defval;
+    plane.width  = width;
+    plane.height = height;
+    tc_thread_bands(threads, height, filter_rows, &plane);
+}
+
+/**
+ * filter_rows:  Apply the barrel distortion filter to rows first..last-1
+ * of a plane.  Pixels whose 3x3 source block lies entirely within the
+ * plane, which is most of them, are done without any bounds checks.
+ *
+ * Parameters:
+ *     datum: Pointer to the BarrelPlane describing the plane.
+ *      band: Band index (unused).
+ *     first: First row to filter.
+ *      last: Row to stop at.
+ * Return value: None.
+ */
+
+static void filter_rows(void *datum, int band, int first, int last)
+{
+    const BarrelPlane *plane = datum;
+    const uint8_t *src = plane->src;
+    const int width = plane->width, height = plane->height;
+    int x, y, index;
+
+    for (index = first * width, y = first; y < last; y++) {
         for (x = 0; x < width; x++, index++) {
+            const DistortionMapEntry *entry = &plane->map[index];
             uint32_t pixel_total = 0;
             int xx, yy;
+            if (entry->x >= 1 && entry->x < width-1
+             && entry->y >= 1 && entry->y < height-1
+            ) {
+                const uint8_t *row = src + (entry->y-1) * width + entry->x;
+                for (yy = 0; yy < 3; yy++, row += width) {
+                    pixel_total += row[-1] * entry->weight[yy][0]
+                                 + row[ 0] * entry->weight[yy][1]
+                                 + row[ 1] * entry->weight[yy][2];
+                }
+                plane->dest[index] = pixel_total >> 15;
+                continue;
+            }
             for (yy = -1; yy <= 1; yy++) {
-                const int srcy = map[index].y + yy;
+                const int srcy = entry->y + yy;
                 for (xx = -1; xx <= 1; xx++) {
-                    const int srcx = map[index].x + xx;
+                    const int srcx = entry->x + xx;
                     uint32_t pixel;
                     if (srcx < 0 || srcx >= width
                      || srcy < 0 || srcy >= height
                     ) {
-                        pixel = defval;
+                        pixel = plane->defval;
                     } else {
                         pixel = src[srcy * width + srcx];
                     }
-                    pixel_total += pixel * map[index].weight[yy+1][xx+1];
+                    pixel_total += pixel * entry->weight[yy+1][xx+1];
                 }
             }
-            dest[index] = pixel_total >> 15;
+            plane->dest[index] = pixel_total >> 15;
         }
     }
 }
@@ -508,6 +576,9 @@ static int barrel_get_config(TCModuleInstance *self, char *options)
     tc_snprintf(buf, sizeof(buf), "%u-%u/%d", pd->start, pd->end, pd->step);
     optstr_param(options, "range", "Apply filter only to given frames",
                  "%u-%u/%d", buf, "0", "oo", "0", "oo", "1", "oo");
+    tc_snprintf(buf, sizeof(buf), "%d", pd->threads);
+    optstr_param(options, "threads", "Row bands filtered in parallel",
+                 "%d", buf, "1", "16");
 
     return TC_OK;
 }
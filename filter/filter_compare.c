@@ -26,10 +26,11 @@
 #include "src/transcode.h"
 #include "src/filter.h"
 #include "libtc/libtc.h"
-#include "libtcutil/tclist.h"
 #include "libtcutil/optstr.h"
 #include "libtcext/tc_magick.h"
 #include "libtcmodule/tcmodule-plugin.h"
+#include "libtcvideo/tcvideo.h"
+#include "aclib/ac.h"
 
 #include <math.h>
 #include <stdint.h>
@@ -40,7 +41,7 @@
  */
 
 #define MOD_NAME    "filter_compare.so"
-#define MOD_VERSION "v0.2.0 (2009-03-06)"
+#define MOD_VERSION "v0.3.0 (2026-10-18)"
 #define MOD_CAP     "compare with other image to find a pattern"
 #define MOD_AUTHOR  "Antonio Beamud"
 
@@ -51,20 +52,11 @@
 
 
 #define DELTA_COLOR            45.0
+#define DEFAULT_CORRELATION    0.8
 #define DEFAULT_COMPARE_IMG    "compare.png"
 #define DEFAULT_RESULTS_LOG    "compare.log"
 
 
-typedef struct pixelsmask_ PixelsMask;
-struct pixelsmask_ {
-    unsigned int    row;
-    unsigned int    col;
-
-    uint8_t         r;
-    uint8_t         g;
-    uint8_t         b;
-};
-
 typedef struct comparedata_ ComparePrivateData;
 struct comparedata_ {
     TCMagickContext magick;
@@ -73,9 +65,24 @@ struct comparedata_ {
     float           delta;
     int             step;
 
-    TCList          pixel_mask;
+    /* The pattern as packed RGB, with masks selecting the bytes of its
+     * opaque pixels: all of them, and those of each channel. */
+    uint8_t         *pattern;
+    uint8_t         *mask;
+    uint8_t         *chmask[3];
+    int             pwidth;
+    int             pheight;
     int             pixel_count;
 
+    TCVHandle       tcvhandle;
+    int             search;
+    int             track;
+    int             ncc;
+    float           corr;
+    int             found;  /* pattern seen in the last frame? */
+    int             lastx;
+    int             lasty;
+
     vob_t           *vob;
 
     unsigned int    frames;
@@ -106,7 +113,16 @@ static const char compare_help[] = ""
     "    'results' path to the file used to write the results\n"
     "    'delta'   delta error allowed\n"
     "    'rgbswap' enable G/B color swapping\n"
-    "    'flip'    flip the pattern image\n";
+    "    'flip'    flip the pattern image\n"
+    "    'search'  look for the pattern, at its own size, anywhere in\n"
+    "              the frame; each frame gets a line with its number,\n"
+    "              the position of the best match, its score and 1 or n\n"
+    "    'track'   search only this many pixels around the last match\n"
+    "              (and the whole frame once the pattern is lost)\n"
+    "    'method'  how to compare in search mode: 'sad' (mean difference\n"
+    "              within 'delta') or 'ncc' (correlation of at least\n"
+    "              'corr', which ignores brightness and contrast)\n"
+    "    'corr'    correlation needed for a match with 'ncc'\n";
 
 
 /*************************************************************************/
@@ -122,6 +138,13 @@ static void compare_defaults(ComparePrivateData *pd, vob_t *vob)
     pd->flip         = TC_TRUE;
     pd->delta        = DELTA_COLOR;
     pd->step         = 1;
+    pd->search       = TC_FALSE;
+    pd->track        = -1;
+    pd->ncc          = TC_FALSE;
+    pd->corr         = DEFAULT_CORRELATION;
+    pd->found        = TC_FALSE;
+    pd->lastx        = 0;
+    pd->lasty        = 0;
     pd->frames       = 0;
     pd->results      = NULL;
     pd->pattern_name = NULL; /* see note above */
@@ -131,6 +154,7 @@ static void compare_defaults(ComparePrivateData *pd, vob_t *vob)
 static int compare_parse_options(ComparePrivateData *pd,
                                  const char *options)
 {
+    char method[TC_BUF_MIN] = { '\0' };
     int ret = TC_OK;
 
     if (optstr_get(options, "pattern", "%[^:]", pd->pattern_name) != 1) {
@@ -143,6 +167,20 @@ static int compare_parse_options(ComparePrivateData *pd,
     optstr_get(options, "delta",   "%f",    &pd->delta);
     optstr_get(options, "rgbswap", "%i",    &pd->rgbswap);
     optstr_get(options, "flip",    "%i",    &pd->flip);
+    optstr_get(options, "search",  "%i",    &pd->search);
+    optstr_get(options, "track",   "%i",    &pd->track);
+    optstr_get(options, "corr",    "%f",    &pd->corr);
+    if (optstr_get(options, "method", "%[^:]", method) == 1) {
+        if (!strcmp(method, "ncc")) {
+            pd->ncc = TC_TRUE;
+        } else if (strcmp(method, "sad") != 0) {
+            tc_log_error(MOD_NAME, "unknown method '%s'", method);
+            ret = TC_ERROR;
+        }
+    }
+    if (pd->track >= 0) {
+        pd->search = TC_TRUE;
+    }
 
     if (verbose) {
         tc_log_info(MOD_NAME, "Compare Image Settings:");
@@ -151,6 +189,13 @@ static int compare_parse_options(ComparePrivateData *pd,
         tc_log_info(MOD_NAME, "        delta = %f", pd->delta);
         tc_log_info(MOD_NAME, "      rgbswap = %i", pd->rgbswap);
         tc_log_info(MOD_NAME, "         flip = %i", pd->flip);
+        if (pd->search) {
+            tc_log_info(MOD_NAME, "        track = %i", pd->track);
+            tc_log_info(MOD_NAME, "       method = %s",
+                        pd->ncc ? "ncc" : "sad");
+            if (pd->ncc)
+                tc_log_info(MOD_NAME, "         corr = %f", pd->corr);
+        }
     }
 
     return ret;
@@ -162,6 +207,8 @@ static int compare_open_log(ComparePrivateData *pd)
     pd->results = fopen(pd->results_name, "w");
     if (pd->results) {
         fprintf(pd->results, "#fps:%f\n", pd->vob->fps);
+        if (pd->search)
+            fprintf(pd->results, "#frame x y score match\n");
     } else {
         tc_log_error(MOD_NAME, "could not open file for writing");
         ret =  TC_ERROR;
@@ -177,49 +224,91 @@ static int compare_open_log(ComparePrivateData *pd)
 } while (0)
     
 
+static void compare_free_pattern(ComparePrivateData *pd)
+{
+    tc_free(pd->pattern);
+    pd->pattern = NULL;
+    pd->mask = NULL;
+    pd->chmask[0] = pd->chmask[1] = pd->chmask[2] = NULL;
+}
+
+/* In search mode the pattern keeps its size, otherwise it is stretched
+ * over the whole frame and compared only in place. */
+
 static int compare_setup_pattern(ComparePrivateData *pd)
 {
-    int r = 0, t = 0, j = 0;
-	Image *pattern = NULL, *resized = NULL;
+    int r = 0, t = 0, j = 0, c = 0, size = 0;
+    Image *pattern = NULL, *resized = NULL;
     PixelPacket *pixels = NULL;
 
-    /* FIXME: filter used */
-    /* FIXME: switch to tcvideo? */
-    resized = ResizeImage(pd->magick.image,
-                          pd->width, pd->height,
-                          GaussianFilter,  1.0,
-                          &pd->magick.exception_info);
-    RETURN_IF_GM_ERROR(resized, pd);
+    if (pd->search) {
+        if ((int)pd->magick.image->columns > pd->width
+         || (int)pd->magick.image->rows > pd->height) {
+            tc_log_error(MOD_NAME, "pattern larger than the frame");
+            return TC_ERROR;
+        }
+        resized = pd->magick.image;
+    } else {
+        /* FIXME: filter used */
+        resized = ResizeImage(pd->magick.image,
+                              pd->width, pd->height,
+                              GaussianFilter,  1.0,
+                              &pd->magick.exception_info);
+        RETURN_IF_GM_ERROR(resized, pd);
+    }
 
     if (pd->flip) {
         pattern = FlipImage(resized, &pd->magick.exception_info);
+        if (resized != pd->magick.image)
+            DestroyImage(resized);
     } else {
         pattern = resized;
     }
     RETURN_IF_GM_ERROR(pattern, pd);
 
+    pd->pwidth  = pattern->columns;
+    pd->pheight = pattern->rows;
+    size = pd->pwidth * pd->pheight * 3;
+    pd->pattern = tc_zalloc(size * 5);
+    if (!pd->pattern) {
+        tc_log_error(MOD_NAME, "out of memory");
+        if (pattern != pd->magick.image)
+            DestroyImage(pattern);
+        return TC_ERROR;
+    }
+    pd->mask = pd->pattern + size;
+    for (c = 0; c < 3; c++)
+        pd->chmask[c] = pd->mask + (c+1) * size;
+
     pixels = GetImagePixels(pattern, 0, 0,
                             pattern->columns,
                             pattern->rows);
 
+    pd->pixel_count = 0;
     for (t = 0; t < pattern->rows; t++) {
         for (r = 0; r < pattern->columns; r++) {
             j = t * pattern->columns + r;
             if (pixels[j].opacity == 0) {
-                PixelsMask pm = {
-                    .row = t,
-                    .col = r,
-                    .r   = (uint8_t)ScaleQuantumToChar(pixels[j].red),
-                    .g   = (uint8_t)ScaleQuantumToChar(pixels[j].green),
-                    .b   = (uint8_t)ScaleQuantumToChar(pixels[j].blue),
-                };
-                tc_list_append_dup(&pd->pixel_mask, &pm, sizeof(pm));
-                /* FIXME: return value */
+                uint8_t *p = pd->pattern + j*3;
+                p[0] = (uint8_t)ScaleQuantumToChar(pixels[j].red);
+                p[1] = (uint8_t)ScaleQuantumToChar(pixels[j].green);
+                p[2] = (uint8_t)ScaleQuantumToChar(pixels[j].blue);
+                for (c = 0; c < 3; c++) {
+                    pd->mask[j*3 + c] = 0xFF;
+                    pd->chmask[c][j*3 + c] = 0xFF;
+                }
+                pd->pixel_count++;
             }
         }
     }
 
-    pd->pixel_count = tc_list_size(&pd->pixel_mask);
+    if (pattern != pd->magick.image)
+        DestroyImage(pattern);
+    if (pd->search && !pd->pixel_count) {
+        tc_log_error(MOD_NAME, "pattern is fully transparent");
+        compare_free_pattern(pd);
+        return TC_ERROR;
+    }
     return TC_OK;
 }
 
@@ -276,8 +365,6 @@ static int compare_configure(TCModuleInstance *self,
 
     pd = self->userdata;
 
-    tc_list_init(&pd->pixel_mask, TC_FALSE);
-
     /* careful here, see note above */
     compare_defaults(pd, vob);
 
@@ -299,6 +386,16 @@ static int compare_configure(TCModuleInstance *self,
     ret = compare_setup_pattern(pd);
     RETURN_IF_NOT_OK(pd, ret);
 
+    if (pd->search) {
+        pd->tcvhandle = tcv_init();
+        if (!pd->tcvhandle) {
+            tc_log_error(MOD_NAME, "tcv_init() failed");
+            compare_free_pattern(pd);
+            ret = TC_ERROR;
+        }
+        RETURN_IF_NOT_OK(pd, ret);
+    }
+
     /* no longer needed (see note above) */
     pd->pattern_name = NULL;
     pd->results_name = NULL;
@@ -321,8 +418,11 @@ static int compare_stop(TCModuleInstance *self)
 
     pd = self->userdata;
 
-    tc_list_fini_cleanup(&pd->pixel_mask);
-    /* FIXME: free images */
+    compare_free_pattern(pd);
+    if (pd->tcvhandle) {
+        tcv_free(pd->tcvhandle);
+        pd->tcvhandle = NULL;
+    }
 
     if (pd->results) {
         fclose(pd->results);
@@ -366,36 +466,73 @@ static int compare_inspect(TCModuleInstance *self,
         tc_snprintf(pd->conf_str, sizeof(pd->conf_str), "%i", pd->flip);
         *value = pd->conf_str;
     }
+    if (optstr_lookup(param, "search")) {
+        tc_snprintf(pd->conf_str, sizeof(pd->conf_str), "%i", pd->search);
+        *value = pd->conf_str;
+    }
+    if (optstr_lookup(param, "track")) {
+        tc_snprintf(pd->conf_str, sizeof(pd->conf_str), "%i", pd->track);
+        *value = pd->conf_str;
+    }
+    if (optstr_lookup(param, "method")) {
+        *value = pd->ncc ? "ncc" : "sad";
+    }
+    if (optstr_lookup(param, "corr")) {
+        tc_snprintf(pd->conf_str, sizeof(pd->conf_str), "%f", pd->corr);
+        *value = pd->conf_str;
+    }
     /* see note above for pattern_name and results_name */
     return TC_OK;
 }
 
 /*************************************************************************/
 
-typedef struct workitem_ WorkItem;
-struct workitem_ {
-    const uint8_t   *buf;
-    int             stride;
-    double          sr;
-    double          sg;
-    double          sb;
-};
+/* Mean difference of each channel over the opaque pixels, with the
+ * pattern at (x,y). */
 
-
-static int image_compare(TCListItem *item, void *userdata)
+static void compare_at(ComparePrivateData *pd, const uint8_t *buf,
+                       int x, int y, double *avg)
 {
-    PixelsMask *pix = item->data;
-    WorkItem  *wi  = userdata;
-
-    int r   = pix->row * wi->stride + pix->col * 3;
-    int g   = pix->row * wi->stride + pix->col * 3 + 1;
-    int b   = pix->row * wi->stride + pix->col * 3 + 2;
+    int stride = pd->width * 3, Bpl = pd->pwidth * 3, c, i;
+
+    buf += y * stride + x * 3;
+    for (c = 0; c < 3; c++) {
+        double sum = 0.0;
+        for (i = 0; i < pd->pheight; i++) {
+            sum += ac_sad(buf + i * stride, pd->pattern + i * Bpl,
+                          pd->chmask[c] + i * Bpl, Bpl);
+        }
+        avg[c] = sum / pd->pixel_count;
+    }
+}
 
-    wi->sr += (double)abs(wi->buf[r] - pix->r);
-    wi->sg += (double)abs(wi->buf[g] - pix->g);
-    wi->sb += (double)abs(wi->buf[b] - pix->b);
+/* Finds the best match in the frame, near the last one when tracking;
+ * returns whether it is good enough. */
 
-    return 0;
+static int compare_search(ComparePrivateData *pd, const uint8_t *buf,
+                          int *x, int *y, double *score)
+{
+    TCVMatchMethod method = pd->ncc ? TCV_MATCH_NCC : TCV_MATCH_SAD;
+    int radius = (pd->track >= 0 && pd->found) ? pd->track : -1;
+    int matched = TC_FALSE;
+    double avg[3];
+
+    while (1) {
+        tcv_match(pd->tcvhandle, buf, pd->width, pd->height, 3,
+                  pd->pattern, pd->mask, pd->pwidth, pd->pheight, method,
+                  pd->lastx, pd->lasty, radius, x, y, score);
+        if (pd->ncc) {
+            matched = (*score >= pd->corr);
+        } else {
+            compare_at(pd, buf, *x, *y, avg);
+            matched = (avg[0] < pd->delta) && (avg[1] < pd->delta)
+                   && (avg[2] < pd->delta);
+        }
+        if (matched || radius < 0)
+            break;
+        radius = -1;  /* lost it: try everywhere */
+    }
+    return matched;
 }
 
 /**
@@ -407,30 +544,34 @@ static int compare_filter_video(TCModuleInstance *self,
                                 TCFrameVideo *frame)
 {
     ComparePrivateData *pd = NULL;
-    double avg_dr = 0.0, avg_dg = 0.0, avg_db = 0.0;
-    WorkItem W;
+    double avg[3];
 
     TC_MODULE_SELF_CHECK(self,  "filter");
     TC_MODULE_SELF_CHECK(frame, "filter");
 
     pd = self->userdata;
 
-    W.stride = pd->width * 3;
-    W.sr     = 0.0;
-    W.sg     = 0.0;
-    W.sb     = 0.0;
-    W.buf    = frame->video_buf;
+    if (pd->search) {
+        double score = 0.0;
+        int x = 0, y = 0, found;
 
-    tc_list_foreach(&pd->pixel_mask, image_compare, &W);
-
-    avg_dr = W.sr / pd->pixel_count;
-    avg_dg = W.sg / pd->pixel_count;
-    avg_db = W.sb / pd->pixel_count;
-
-    if ((avg_dr < pd->delta) && (avg_dg < pd->delta) && (avg_db < pd->delta))
-        fprintf(pd->results,"1");
-    else
-        fprintf(pd->results,"n");
+        found = compare_search(pd, frame->video_buf, &x, &y, &score);
+        if (found) {
+            pd->lastx = x;
+            pd->lasty = y;
+        }
+        pd->found = found;
+        fprintf(pd->results, "%i %i %i %f %s\n", frame->id, x,
+                pd->flip ? pd->height - pd->pheight - y : y,
+                score, found ? "1" : "n");
+    } else {
+        compare_at(pd, frame->video_buf, 0, 0, avg);
+        if ((avg[0] < pd->delta) && (avg[1] < pd->delta)
+         && (avg[2] < pd->delta))
+            fprintf(pd->results,"1");
+        else
+            fprintf(pd->results,"n");
+    }
 
     fflush(pd->results); /* FIXME */
     pd->frames++;
@@ -488,6 +629,17 @@ static int compare_get_config(TCModuleInstance *self, char *options)
     optstr_param(options, "delta", "Delta error", "%f",buf,"0.0", "100.0");
     tc_snprintf(buf, TC_BUF_MIN, "%i", pd->rgbswap);
     optstr_param(options, "rgbswap", "RGB swapping", "%i",buf,"0", "1");
+    tc_snprintf(buf, TC_BUF_MIN, "%i", pd->search);
+    optstr_param(options, "search", "Search the pattern at its own size",
+                 "%i", buf, "0", "1");
+    tc_snprintf(buf, TC_BUF_MIN, "%i", pd->track);
+    optstr_param(options, "track", "Search radius around the last match",
+                 "%i", buf, "-1", "oo");
+    optstr_param(options, "method", "Search comparison (sad or ncc)",
+                 "%s", pd->ncc ? "ncc" : "sad");
+    tc_snprintf(buf, TC_BUF_MIN, "%f", pd->corr);
+    optstr_param(options, "corr", "Correlation needed with ncc",
+                 "%f", buf, "-1.0", "1.0");
 
     return TC_OK;
 }
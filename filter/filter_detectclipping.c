@@ -24,7 +24,7 @@
  */
 
 #define MOD_NAME    "filter_detectclipping.so"
-#define MOD_VERSION "v0.2.0 (2009-01-30)"
+#define MOD_VERSION "v0.2.1 (2026-10-18)"
 #define MOD_CAP     "detect clipping parameters (-j or -Y)"
 #define MOD_AUTHOR  "Tilmann Bitterberg, A'rpi, A. Beamud"
 
@@ -223,8 +223,10 @@ int tc_filter(frame_list_t *ptr_, char *options)
   if(ptr->tag & TC_FILTER_CLOSE) {
 
     if (mfd[ptr->filter_id]) {
-        fprintf(mfd[ptr->filter_id]->log,"#total: %d",mfd[ptr->filter_id]->frames);
-        fclose(mfd[ptr->filter_id]->log);
+        if (mfd[ptr->filter_id]->log) {
+            fprintf(mfd[ptr->filter_id]->log,"#total: %d",mfd[ptr->filter_id]->frames);
+            fclose(mfd[ptr->filter_id]->log);
+        }
 	free(mfd[ptr->filter_id]);
     }
     mfd[ptr->filter_id]=NULL;
@@ -250,12 +252,18 @@ int tc_filter(frame_list_t *ptr_, char *options)
     int y;
     char *p = ptr->video_buf;
     int l,r,t,b;
+    int x1, x2, y1, y2;
 
     if (mfd[ptr->filter_id]->fno++ < 3)
 	return 0;
 
     if (mfd[ptr->filter_id]->start <= ptr->id && ptr->id <= mfd[ptr->filter_id]->end && ptr->id%mfd[ptr->filter_id]->step == mfd[ptr->filter_id]->boolstep) {
 
+    x1 = mfd[ptr->filter_id]->x1;
+    x2 = mfd[ptr->filter_id]->x2;
+    y1 = mfd[ptr->filter_id]->y1;
+    y2 = mfd[ptr->filter_id]->y2;
+
     for (y = 0; y < mfd[ptr->filter_id]->y1; y++) {
 	if(checkline(p+mfd[ptr->filter_id]->stride*y, mfd[ptr->filter_id]->bpp, ptr->v_width, mfd[ptr->filter_id]->bpp) > mfd[ptr->filter_id]->limit) {
 	    mfd[ptr->filter_id]->y1 = y;
@@ -300,7 +308,11 @@ int tc_filter(frame_list_t *ptr_, char *options)
         fprintf(mfd[ptr->filter_id]->log, "%d %d %d %d %d\n",
                 mfd[ptr->filter_id]->frames,
                 t, l , b, r);
-    
+
+    /* the area only ever grows; tell the core when it stops doing so */
+    tc_filter_report(ptr->filter_id,
+                     x1 != mfd[ptr->filter_id]->x1 || x2 != mfd[ptr->filter_id]->x2
+                  || y1 != mfd[ptr->filter_id]->y1 || y2 != mfd[ptr->filter_id]->y2);
 
 
     }
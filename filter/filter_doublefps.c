@@ -9,7 +9,7 @@
  */
 
 #define MOD_NAME        "filter_doublefps.so"
-#define MOD_VERSION     "v1.1.1 (2009-02-07)"
+#define MOD_VERSION     "v1.1.2 (2026-10-18)"
 #define MOD_CAP         "double frame rate by deinterlacing fields into frames"
 #define MOD_AUTHOR      "Andrew Church"
 
@@ -37,6 +37,7 @@ typedef struct {
     int saved_audio_len;    // Number of bytes of audio saved for second field
     uint8_t saved_audio[SIZE_PCM_FRAME];
     uint8_t saved_frame[TC_MAX_V_FRAME_WIDTH*TC_MAX_V_FRAME_HEIGHT*3];
+    TCFramePayload *saved_payload;  // Last frame, for full-height operation
     int saved_width, saved_height;  // For full-height operation
 } DfpsPrivateData;
 
@@ -68,6 +69,7 @@ static int doublefps_init(TCModuleInstance *self, uint32_t features)
     pd->topfirst = -1;
     pd->fullheight = 0;
     pd->have_first_frame = pd->saved_width = pd->saved_height = 0;
+    pd->saved_payload = NULL;
 
     /* FIXME: we need a proper way for filters to tell the core that
      * they're changing the export parameters */
@@ -110,6 +112,7 @@ static int doublefps_fini(TCModuleInstance *self)
         tcv_free(pd->tcvhandle);
         pd->tcvhandle = 0;
     }
+    tc_release_payload(pd->saved_payload);
 
     tc_free(self->userdata);
     self->userdata = NULL;
@@ -183,6 +186,8 @@ static int doublefps_stop(TCModuleInstance *self)
 
     pd = self->userdata;
     pd->have_first_frame = pd->saved_width = pd->saved_height = 0;
+    tc_release_payload(pd->saved_payload);
+    pd->saved_payload = NULL;
     return TC_OK;
 }
 
@@ -329,6 +334,7 @@ static int doublefps_filter_video(TCModuleInstance *self, vframe_list_t *frame)
         frame->v_height /= 2;
         frame->video_buf = newbuf[0];
         frame->free = (frame->free==0) ? 1 : 0;
+        tc_unshare_video_frame(frame);  // just drops the old picture
         break;
 
       }  // case 0: half height, first field
@@ -337,24 +343,33 @@ static int doublefps_filter_video(TCModuleInstance *self, vframe_list_t *frame)
 
         /* The new frame is already saved in our private data structure,
          * so copy it over and return. */
+        tc_unshare_video_frame(frame);
         ac_memcpy(frame->video_buf, pd->saved_frame, w*h + (w/2)*hUV*2);
         frame->attributes &= ~TC_FRAME_IS_INTERLACED;
         break;
 
       case 2: {  // Full height, first field
         uint8_t *top[3], *bottom[3], *out[3];
-        uint8_t *oldframe = frame->video_buf;  // for saving
+        TCFramePayload *oldframe;  // for saving
+
+        /* Keep a reference on this frame's picture rather than a copy;
+         * the second field will show it again. */
+        oldframe = tc_hold_video_frame(frame);
+        if (!oldframe) {
+            tc_log_error(MOD_NAME, "out of memory saving frame");
+            return TC_ERROR;
+        }
 
         /* Merge this frame's first field and the previous frame's second
          * field (unless this is the first frame, in which case we do
          * nothing). */
-        if (pd->have_first_frame) {
+        if (pd->have_first_frame && pd->saved_payload) {
             int plane;
             if (pd->topfirst) {
                 top[0]    = frame->video_buf;
-                bottom[0] = pd->saved_frame;
+                bottom[0] = pd->saved_payload->data;
             } else {
-                top[0]    = pd->saved_frame;
+                top[0]    = pd->saved_payload->data;
                 bottom[0] = frame->video_buf;
             }
             top[1]    = top[0] + w * h;
@@ -379,11 +394,13 @@ static int doublefps_filter_video(TCModuleInstance *self, vframe_list_t *frame)
             /* Update frame data */
             frame->video_buf = out[0];
             frame->free = (frame->free==0) ? 1 : 0;
+            tc_unshare_video_frame(frame);
         }
         frame->attributes |= TC_FRAME_IS_CLONED;
 
-        /* Now save this frame in the temporary buffer. */
-        ac_memcpy(pd->saved_frame, oldframe, w*h + (w/2)*hUV*2);
+        /* Now save this frame for the next time we're called. */
+        tc_release_payload(pd->saved_payload);
+        pd->saved_payload = oldframe;
         pd->saved_width = w;
         pd->saved_height = h;
         break;
@@ -392,9 +409,11 @@ static int doublefps_filter_video(TCModuleInstance *self, vframe_list_t *frame)
 
       case 3:  // Full height, second field
 
-        /* Restore the original frame (we copy the entire frame because
-         * somebody else might have changed the working copy). */
-        ac_memcpy(frame->video_buf, pd->saved_frame, w*h + (w/2)*hUV*2);
+        /* Restore the original frame (we show the saved picture rather
+         * than the working copy, because somebody else might have
+         * changed that). */
+        if (pd->saved_payload)
+            tc_share_video_frame(frame, pd->saved_payload);
         break;
 
     }  // switch (height mode + field number)
@@ -485,7 +504,7 @@ static int doublefps_get_config(TCModuleInstance *self, char *options)
     pd = self->userdata;
 
     optstr_filter_desc(options, MOD_NAME, MOD_CAP, MOD_VERSION,
-                       MOD_AUTHOR, "VAEY4", "1");
+                       MOD_AUTHOR, "VAEY4S", "1");
     tc_snprintf(buf, sizeof(buf), "%i", pd->topfirst);
     optstr_param(options, "topfirst",
                  "select if top first is first displayed or not",
@@ -28,21 +28,28 @@
   */
 
 #define MOD_NAME    "filter_fieldanalysis.so"
-#define MOD_VERSION "v1.0 pl1 (2004-08-13)"
+#define MOD_VERSION "v1.2 (2026-10-18)"
 #define MOD_CAP     "Field analysis for detecting interlace and telecine"
 #define MOD_AUTHOR  "Matthias Hopf"
 
+#define MOD_FEATURES \
+    TC_MODULE_FEATURE_FILTER|TC_MODULE_FEATURE_VIDEO
+#define MOD_FLAGS \
+    TC_MODULE_FLAG_RECONFIGURABLE|TC_MODULE_FLAG_BUFFERING
+
 #include "src/transcode.h"
 #include "src/filter.h"
 #include "libtc/libtc.h"
 #include "libtcutil/optstr.h"
 #include "libtcvideo/tcvideo.h"
+#include "libtcmodule/tcmodule-plugin.h"
 
 #include <assert.h>
 
 
 /*
- * State
+ * State. Analysis compares each frame with the previous one, so frames
+ * must be seen in order: this is NOT a reentrant module.
  */
 
 typedef struct {
@@ -69,6 +76,9 @@ typedef struct {
     uint8_t *lumIn, *lumPrev, *lumInT, *lumInB, *lumPrevT, *lumPrevB;
 
     int   telecineState;
+    int   lastId;           /* frame compared against lumPrev next */
+    int   conclusion;       /* see conclude(), for tc_filter_report() */
+    int   changed;
 
     int   numFrames;
     int   unknownFrames;
@@ -81,13 +91,30 @@ typedef struct {
 
     TCVHandle tcvhandle;
 
+    char  conf_str[TC_BUF_MIN];
 } myfilter_t;
 
-static myfilter_t *myf_global = NULL;
+static const char fieldanalysis_help[] = ""
+"* Overview:\n"
+"  'fieldanalysis' scans video for interlacing artifacts and\n"
+"  detects progressive / interlaced / telecined video.\n"
+"  It also determines the major field for interlaced video.\n"
+"* Verbose Output:   [PtPb c t stsb]\n"
+"  Pt, Pb:   progressivediff succeeded, per field.\n"
+"  pt, pb:   unknowndiff succeeded, progressivediff failed.\n"
+"  c:        progressivechange succeeded.\n"
+"  t:        topFieldFirst / b: bottomFieldFirst detected.\n"
+"  st, sb:   changedifmore failed (fields are similar to last frame).\n";
 
 /* Internal state flag values */
 enum { IS_UNKNOWN = -1, IS_FALSE = 0, IS_TRUE = 1 };
 
+/* Possible outcomes of the analysis */
+enum {
+    NO_CONCLUSION_FEW = 0, NO_CONCLUSION_UNKNOWN, PROGRESSIVE,
+    FIELD_UNSURE, TELECINE, FIELD_SHIFT, INTERLACED, MIXED
+};
+
 
 /*
  * Helper functions
@@ -378,146 +405,48 @@ static void check_interlace (myfilter_t *myf, int id) {
 
 
 /*
- * transcode API
+ * conclude what the video is from the analysis done so far
  */
-int tc_filter(frame_list_t *ptr_, char *options)
-{
-    vframe_list_t *ptr = (vframe_list_t *)ptr_;
-    vob_t *vob = NULL;
-    myfilter_t *myf = myf_global;
-
-    /*
-     * filter init
-     */
-    if (ptr->tag & TC_FILTER_INIT) {
-
-	if (! (vob = tc_get_vob ()))
-	    return -1;
-
-	if (! (myf = myf_global = tc_zalloc (sizeof (myfilter_t)))) {
-	    return -1;
-	}
-
-	if (! (myf->tcvhandle = tcv_init())) {
-	    tc_log_error(MOD_NAME, "tcv_init() failed");
-	    free(myf);
-	    myf = myf_global = NULL;
-	    return -1;
-	}
-
-	if (verbose)			/* global verbose */
-	    tc_log_info(MOD_NAME, "%s %s", MOD_VERSION, MOD_CAP);
-
-	/* default values */
-	myf->interlaceDiff       = 1.1;
-	myf->unknownDiff         = 1.5;
-	myf->progressiveDiff     = 8;
-	myf->progressiveChange   = 0.2;
-	myf->changedIfMore       = 10;
-
-	myf->forceTelecineDetect = 0;
-	myf->verbose             = 0;
-	myf->outDiff             = 0;
-
-	/* video parameters */
-	switch (vob->im_v_codec) {
-	case TC_CODEC_YUY2:
-	case TC_CODEC_YUV420P:
-	case TC_CODEC_YUV422P:
-	case TC_CODEC_RGB24:
-	    break;
-	default:
-	    tc_log_error(MOD_NAME,
-                     "Unsupported codec - need one of RGB24 YUV420P YUY2 YUV422P");
-	    return -1;
-	}
-	myf->codec     = vob->im_v_codec;
-	myf->width     = vob->im_v_width;
-	myf->height    = vob->im_v_height;
-	myf->fps       = vob->fps;
-	myf->size = myf->width * myf->height;
-
-	if (options) {
-	    optstr_get (options, "interlacediff",     "%lf",
-			&myf->interlaceDiff);
-	    optstr_get (options, "unknowndiff",       "%lf",
-			&myf->unknownDiff);
-	    optstr_get (options, "progressivediff",   "%lf",
-			&myf->progressiveDiff);
-	    optstr_get (options, "progressivechange", "%lf",
-			&myf->progressiveChange);
-	    optstr_get (options, "changedifmore",     "%lf",
-			&myf->changedIfMore);
-	    optstr_get (options, "forcetelecinedetect",
-		        "%d", &myf->forceTelecineDetect);
-	    optstr_get (options, "verbose",          "%d", &myf->verbose);
-	    optstr_get (options, "outdiff",          "%d", &myf->outDiff);
-
-	    if (optstr_lookup (options, "help") != NULL) {
-		tc_log_info (MOD_NAME, "(%s) help\n"
-"* Overview:\n"
-"  'fieldanalysis' scans video for interlacing artifacts and\n"
-"  detects progressive / interlaced / telecined video.\n"
-"  It also determines the major field for interlaced video.\n"
-"* Verbose Output:   [PtPb c t stsb]\n"
-"  Pt, Pb:   progressivediff succeeded, per field.\n"
-"  pt, pb:   unknowndiff succeeded, progressivediff failed.\n"
-"  c:        progressivechange succeeded.\n"
-"  t:        topFieldFirst / b: bottomFieldFirst detected.\n"
-"  st, sb:   changedifmore failed (fields are similar to last frame).\n"
-			     , MOD_CAP);
-	    }
-	}
+static int conclude (myfilter_t *myf) {
+
+    int total = myf->numFrames - myf->unknownFrames;
+
+    if (total < 50)
+	return NO_CONCLUSION_FEW;
+    else if (myf->unknownFrames * 10 > myf->numFrames * 9)
+	return NO_CONCLUSION_UNKNOWN;
+    else if (myf->progressiveFrames * 8 > total * 7)
+	return PROGRESSIVE;
+    else if (myf->topFirstFrames * 8 > myf->bottomFirstFrames &&
+	     myf->bottomFirstFrames * 8 > myf->topFirstFrames)
+	return FIELD_UNSURE;
+    else if (myf->telecineFrames * 4 > total * 3)
+	return TELECINE;
+    else if (myf->fieldShiftFrames * 4 > total * 3)
+	return FIELD_SHIFT;
+    else if (myf->interlacedFrames > myf->fieldShiftFrames &&
+	     (myf->interlacedFrames+myf->fieldShiftFrames) * 8 > total * 7)
+	return INTERLACED;
+    else
+	return MIXED;
+}
 
-	/* frame memory */
-	if (! (myf->lumIn    = calloc (1, myf->size)) ||
-	    ! (myf->lumPrev  = calloc (1, myf->size)) ||
-	    ! (myf->lumInT   = calloc (1, myf->size)) ||
-	    ! (myf->lumInB   = calloc (1, myf->size)) ||
-	    ! (myf->lumPrevT = calloc (1, myf->size)) ||
-	    ! (myf->lumPrevB = calloc (1, myf->size))) {
-	    tc_log_error(MOD_NAME, "calloc() failed");
-	    return -1;
-	}
 
-	if (verbose) {			/* global verbose */
-	    tc_log_info(MOD_NAME, "interlacediff %.2f,  unknowndiff %.2f,  progressivediff %.2f",
-		                        myf->interlaceDiff, myf->unknownDiff, myf->progressiveDiff);
-        tc_log_info(MOD_NAME, "progressivechange %.2f, changedifmore %.2f",
-                    		   myf->progressiveChange, myf->changedIfMore);
-        tc_log_info(MOD_NAME, "forcetelecinedetect %s, verbose %d, outdiff %d",
-                    		   myf->forceTelecineDetect ? "True":"False", myf->verbose,
-                               myf->outDiff);
-	}
+/*
+ * print the summary of the analysis done so far
+ */
+static void print_results (myfilter_t *myf) {
 
-	return 0;
-    }
+    int totalfields = myf->topFirstFrames + myf->bottomFirstFrames;
 
-    /*
-     * filter close
-     */
+    if (myf->numFrames < 1)
+	return;
+    if (totalfields < 1)
+	totalfields = 1;
 
-    if (ptr->tag & TC_FILTER_CLOSE) {
-
-	int total = myf->numFrames - myf->unknownFrames;
-	int totalfields = myf->topFirstFrames + myf->bottomFirstFrames;
-
-	/* Cleanup */
-	free (myf->lumIn);
-	free (myf->lumPrev);
-	free (myf->lumInT);
-	free (myf->lumInB);
-	free (myf->lumPrevT);
-	free (myf->lumPrevB);
-	myf->lumIn = myf->lumPrev = myf->lumInT = myf->lumInB =
-	    myf->lumPrevT = myf->lumPrevB = NULL;
-
-	/* Output results */
-	if (totalfields < 1)
-	    totalfields = 1;
-	tc_log_info(MOD_NAME, "RESULTS: Frames:      %d (100%%)  Unknown:      %d (%.3g%%)",
-		                myf->numFrames, myf->unknownFrames,
-                		100.0 * myf->unknownFrames / (double)myf->numFrames);
+    tc_log_info(MOD_NAME, "RESULTS: Frames:      %d (100%%)  Unknown:      %d (%.3g%%)",
+		myf->numFrames, myf->unknownFrames,
+		100.0 * myf->unknownFrames / (double)myf->numFrames);
     tc_log_info(MOD_NAME, "RESULTS: Progressive: %d (%.3g%%)  Interlaced:   %d (%.3g%%)",
 		myf->progressiveFrames, 100.0 * myf->progressiveFrames / (double)myf->numFrames,
 		myf->interlacedFrames, 100.0 * myf->interlacedFrames / (double)myf->numFrames);
@@ -528,157 +457,496 @@ int tc_filter(frame_list_t *ptr_, char *options)
 		myf->topFirstFrames, 100.0 * myf->topFirstFrames / (double)totalfields,
 		myf->bottomFirstFrames, 100.0 * myf->bottomFirstFrames / (double)totalfields);
 
-	if (total < 50)
-	    tc_log_warn (MOD_NAME, "less than 50 frames analyzed correctly, no conclusion.");
-	else if (myf->unknownFrames * 10 > myf->numFrames * 9)
-	    tc_log_warn (MOD_NAME, "less than 10%% frames analyzed correctly, no conclusion.");
-	else if (myf->progressiveFrames * 8 > total * 7)
-	    tc_log_info (MOD_NAME, "CONCLUSION: progressive video.");
-	else if (myf->topFirstFrames * 8 > myf->bottomFirstFrames &&
-		 myf->bottomFirstFrames * 8 > myf->topFirstFrames)
-	    tc_log_info (MOD_NAME, "major field unsure, no conclusion. Use deinterlacer for processing.");
-	else if (myf->telecineFrames * 4 > total * 3)
-	    tc_log_info (MOD_NAME, "CONCLUSION: telecined video, %s field first.",
-                        myf->topFirstFrames > myf->bottomFirstFrames ? "top" : "bottom");
-	else if (myf->fieldShiftFrames * 4 > total * 3)
-	    tc_log_info (MOD_NAME, "CONCLUSION: field shifted progressive video, %s field first.",
-                        myf->topFirstFrames > myf->bottomFirstFrames ? "top" : "bottom");
-	else if (myf->interlacedFrames > myf->fieldShiftFrames &&
-		 (myf->interlacedFrames+myf->fieldShiftFrames) * 8 > total * 7)
-	    tc_log_info (MOD_NAME, "CONCLUSION: interlaced video, %s field first.",
-                        myf->topFirstFrames > myf->bottomFirstFrames ? "top" : "bottom");
-	else
-	    tc_log_info (MOD_NAME, "mixed video, no conclusion. Use deinterlacer for processing.");
+    switch (conclude (myf)) {
+    case NO_CONCLUSION_FEW:
+	tc_log_warn (MOD_NAME, "less than 50 frames analyzed correctly, no conclusion.");
+	break;
+    case NO_CONCLUSION_UNKNOWN:
+	tc_log_warn (MOD_NAME, "less than 10%% frames analyzed correctly, no conclusion.");
+	break;
+    case PROGRESSIVE:
+	tc_log_info (MOD_NAME, "CONCLUSION: progressive video.");
+	break;
+    case FIELD_UNSURE:
+	tc_log_info (MOD_NAME, "major field unsure, no conclusion. Use deinterlacer for processing.");
+	break;
+    case TELECINE:
+	tc_log_info (MOD_NAME, "CONCLUSION: telecined video, %s field first.",
+		     myf->topFirstFrames > myf->bottomFirstFrames ? "top" : "bottom");
+	break;
+    case FIELD_SHIFT:
+	tc_log_info (MOD_NAME, "CONCLUSION: field shifted progressive video, %s field first.",
+		     myf->topFirstFrames > myf->bottomFirstFrames ? "top" : "bottom");
+	break;
+    case INTERLACED:
+	tc_log_info (MOD_NAME, "CONCLUSION: interlaced video, %s field first.",
+		     myf->topFirstFrames > myf->bottomFirstFrames ? "top" : "bottom");
+	break;
+    default:
+	tc_log_info (MOD_NAME, "mixed video, no conclusion. Use deinterlacer for processing.");
+	break;
+    }
+}
+
+
+/*************************************************************************/
 
-	tcv_free(myf->tcvhandle);
-	myf->tcvhandle = 0;
+/* Module interface routines and data. */
 
-	return 0;
+/*************************************************************************/
+
+/**
+ * fieldanalysis_init:  Initialize this instance of the module.  See
+ * tcmodule-data.h for function details.
+ */
+
+static int fieldanalysis_init(TCModuleInstance *self, uint32_t features)
+{
+    myfilter_t *myf = NULL;
+
+    TC_MODULE_SELF_CHECK(self, "init");
+    TC_MODULE_INIT_CHECK(self, MOD_FEATURES, features);
+
+    myf = tc_zalloc(sizeof(myfilter_t));
+    if (myf == NULL) {
+        tc_log_error(MOD_NAME, "init: out of memory!");
+        return TC_ERROR;
     }
 
-    /*
-     * filter description
-     */
-    if (ptr->tag & TC_FILTER_GET_CONFIG) {
-	char buf[255];
-	optstr_filter_desc (options, MOD_NAME, MOD_CAP, MOD_VERSION,
-			    MOD_AUTHOR, "VRY4E", "2");
-	tc_snprintf (buf, sizeof(buf), "%g", myf->interlaceDiff);
-	optstr_param (options, "interlacediff", "Minimum temporal inter-field difference for detecting interlaced video", "%f", buf, "1.0", "inf");
-	tc_snprintf (buf, sizeof(buf), "%g", myf->unknownDiff);
-	optstr_param (options, "unknowndiff", "Maximum inter-frame change vs. detail differences for neglecting interlaced video", "%f", buf, "1.0", "inf");
-	tc_snprintf (buf, sizeof(buf), "%g", myf->progressiveDiff);
-	optstr_param (options, "progressivediff", "Minimum inter-frame change vs. detail differences for detecting progressive video" ,"%f", buf, "unknowndiff", "inf");
-	tc_snprintf (buf, sizeof(buf), "%g", myf->progressiveChange);
-	optstr_param (options, "progressivechange", "Minimum temporal change needed for detecting progressive video" ,"%f", buf, "0", "inf");
-	tc_snprintf (buf, sizeof(buf), "%g", myf->changedIfMore);
-	optstr_param (options, "changedifmore", "Minimum temporal change for detecting truly changed frames" ,"%f", buf, "0", "65025");
-	tc_snprintf (buf, sizeof(buf), "%d", myf->forceTelecineDetect);
-	optstr_param (options, "forcetelecinedetect", "Detect telecine even on non-NTSC (29.97fps) video", "%d", buf, "0", "1");
-	tc_snprintf (buf, sizeof(buf), "%d", myf->verbose);
-	optstr_param (options, "verbose", "Output analysis for every frame", "%d", buf, "0", "2");
-	tc_snprintf (buf, sizeof(buf), "%d", myf->outDiff);
-	optstr_param (options, "outdiff", "Output internal debug frames as luminance of YUV video (see source)", "%d", buf, "0", "11");
+    myf->tcvhandle = tcv_init();
+    if (!myf->tcvhandle) {
+        tc_log_error(MOD_NAME, "tcv_init() failed");
+        tc_free(myf);
+        return TC_ERROR;
     }
 
-    /*
-     * filter frame routine
-     */
-    /* need to process frames in-order */
-    if ((ptr->tag & TC_PRE_S_PROCESS) && (ptr->tag & TC_VIDEO)) {
-
-	uint8_t *tmp;
-	int i, j;
-
-	assert (ptr->free == 0 || ptr->free == 1);
-	assert (ptr->video_buf_Y[!ptr->free] == ptr->video_buf);
-
-	/* Convert / Copy to luminance only */
-	switch (myf->codec) {
-	case TC_CODEC_RGB24:
-	    tcv_convert(myf->tcvhandle, ptr->video_buf, myf->lumIn,
-			myf->width, myf->height, IMG_RGB_DEFAULT, IMG_Y8);
-	    break;
-	case TC_CODEC_YUY2:
-	    tcv_convert(myf->tcvhandle, ptr->video_buf, myf->lumIn,
-			myf->width, myf->height, IMG_YUY2, IMG_Y8);
-	    break;
-	case TC_CODEC_YUV420P:
-	    tcv_convert(myf->tcvhandle, ptr->video_buf, myf->lumIn,
-			myf->width, myf->height, IMG_YUV_DEFAULT, IMG_Y8);
-	    break;
-	case TC_CODEC_YUV422P:
-	    tcv_convert(myf->tcvhandle, ptr->video_buf, myf->lumIn,
-			myf->width, myf->height, IMG_YUV422P, IMG_Y8);
-	    break;
-	default:
-	    assert (0);
-	}
+    self->userdata = myf;
 
-	/* Bob Top field */
-	bob_field (myf->lumIn, myf->lumInT, myf->width, myf->height/2-1);
-	/* Bob Bottom field */
-	ac_memcpy (myf->lumInB, myf->lumIn + myf->width, myf->width);
-	bob_field (myf->lumIn + myf->width, myf->lumInB + myf->width,
-	           myf->width, myf->height/2-1);
-	/* last copied line is ignored, buffer is large enough */
-
-	if (myf->numFrames == 0)
-	    myf->numFrames++;
-	else if (! (ptr->tag & TC_FRAME_IS_SKIPPED)) {
-	    /* check_it */
-	    check_interlace (myf, ptr->id);
-	}
+    if (verbose) {
+        tc_log_info(MOD_NAME, "%s %s", MOD_VERSION, MOD_CAP);
+    }
+    return TC_OK;
+}
 
-	/* only works with YUV data correctly */
-	switch (myf->outDiff) {
-	case 1:				/* lumIn */
-	    ac_memcpy (ptr->video_buf, myf->lumIn, myf->size);
-	    break;
-	case 2:				/* field shift */
-	    for (i = 0 ; i < myf->height-2; i += 2)
-		for (j = 0; j < myf->width; j++) {
-		    ptr->video_buf [myf->width*i+j] =
-			myf->lumIn [myf->width*i+j];
-		    ptr->video_buf [myf->width*(i+1)+j] =
-			myf->lumPrev [myf->width*(i+1)+j];
-		}
-	    break;
-	case 3:				/* lumInT */
-	    ac_memcpy (ptr->video_buf, myf->lumInT, myf->size);
-	    break;
-	case 4:				/* lumInB */
-	    ac_memcpy (ptr->video_buf, myf->lumInB, myf->size);
-	    break;
-	case 5:				/* lumPrevT */
-	    ac_memcpy (ptr->video_buf, myf->lumPrevT, myf->size);
-	    break;
-	case 6:				/* lumPrevB */
-	    ac_memcpy (ptr->video_buf, myf->lumPrevB, myf->size);
-	    break;
-	case 7:				/* pixDiff */
-	    pic_diff (myf->lumInT, myf->lumInB,   ptr->video_buf, myf->size,4);
-	    break;
-	case 8:				/* pixShiftChangedT */
-	    pic_diff (myf->lumInT, myf->lumPrevB, ptr->video_buf, myf->size,4);
-	    break;
-	case 9:				/* pixShiftChangedB */
-	    pic_diff (myf->lumInB, myf->lumPrevT, ptr->video_buf, myf->size,4);
-	    break;
-	case 10:			/* pixLastT */
-	    pic_diff (myf->lumInT, myf->lumPrevT, ptr->video_buf, myf->size,4);
-	    break;
-	case 11:			/* pixLastB */
-	    pic_diff (myf->lumInB, myf->lumPrevB, ptr->video_buf, myf->size,4);
-	    break;
-	}
+/*************************************************************************/
+
+/**
+ * fieldanalysis_fini:  Clean up after this instance of the module.  See
+ * tcmodule-data.h for function details.
+ */
+
+static int fieldanalysis_fini(TCModuleInstance *self)
+{
+    myfilter_t *myf = NULL;
+
+    TC_MODULE_SELF_CHECK(self, "fini");
+
+    myf = self->userdata;
+
+    tcv_free(myf->tcvhandle);
+    myf->tcvhandle = 0;
+
+    tc_free(myf);
+    self->userdata = NULL;
+    return TC_OK;
+}
+
+/*************************************************************************/
+
+/**
+ * fieldanalysis_stop:  Reset this instance of the module, reporting the
+ * results of the analysis.  See tcmodule-data.h for function details.
+ */
 
-	/* The current frame gets the next previous frame :-P */
-	tmp = myf->lumPrev;   myf->lumPrev  = myf->lumIn;   myf->lumIn  = tmp;
-	tmp = myf->lumPrevT;  myf->lumPrevT = myf->lumInT;  myf->lumInT = tmp;
-	tmp = myf->lumPrevB;  myf->lumPrevB = myf->lumInB;  myf->lumInB = tmp;
+static int fieldanalysis_stop(TCModuleInstance *self)
+{
+    myfilter_t *myf = NULL;
+
+    TC_MODULE_SELF_CHECK(self, "stop");
+
+    myf = self->userdata;
+
+    print_results(myf);
+
+    tc_free(myf->lumIn);
+    tc_free(myf->lumPrev);
+    tc_free(myf->lumInT);
+    tc_free(myf->lumInB);
+    tc_free(myf->lumPrevT);
+    tc_free(myf->lumPrevB);
+    myf->lumIn = myf->lumPrev = myf->lumInT = myf->lumInB =
+        myf->lumPrevT = myf->lumPrevB = NULL;
+
+    return TC_OK;
+}
+
+/*************************************************************************/
+
+/**
+ * fieldanalysis_configure:  Configure this instance of the module.  See
+ * tcmodule-data.h for function details.
+ */
+
+static int fieldanalysis_configure(TCModuleInstance *self,
+                                   const char *options,
+                                   TCJob *vob,
+                                   TCModuleExtraData *xdata[])
+{
+    myfilter_t *myf = NULL;
+
+    TC_MODULE_SELF_CHECK(self, "configure");
+
+    myf = self->userdata;
+
+    /* default values */
+    myf->interlaceDiff       = 1.1;
+    myf->unknownDiff         = 1.5;
+    myf->progressiveDiff     = 8;
+    myf->progressiveChange   = 0.2;
+    myf->changedIfMore       = 10;
+
+    myf->forceTelecineDetect = 0;
+    myf->verbose             = 0;
+    myf->outDiff             = 0;
+
+    /* start over the analysis */
+    myf->telecineState       = 0;
+    myf->lastId              = -1;
+    myf->conclusion          = NO_CONCLUSION_FEW;
+    myf->changed             = 0;
+    myf->numFrames           = 0;
+    myf->unknownFrames       = 0;
+    myf->topFirstFrames      = 0;
+    myf->bottomFirstFrames   = 0;
+    myf->interlacedFrames    = 0;
+    myf->progressiveFrames   = 0;
+    myf->fieldShiftFrames    = 0;
+    myf->telecineFrames      = 0;
+
+    /* video parameters */
+    switch (vob->im_v_codec) {
+      case TC_CODEC_YUY2:
+      case TC_CODEC_YUV420P:
+      case TC_CODEC_YUV422P:
+      case TC_CODEC_RGB24:
+        break;
+      default:
+        tc_log_error(MOD_NAME, "Unsupported codec - need one of"
+                               " RGB24 YUV420P YUY2 YUV422P");
+        return TC_ERROR;
+    }
+    myf->codec  = vob->im_v_codec;
+    myf->width  = vob->im_v_width;
+    myf->height = vob->im_v_height;
+    myf->fps    = vob->fps;
+    myf->size   = myf->width * myf->height;
+
+    if (options) {
+        optstr_get(options, "interlacediff",       "%lf",
+                   &myf->interlaceDiff);
+        optstr_get(options, "unknowndiff",         "%lf",
+                   &myf->unknownDiff);
+        optstr_get(options, "progressivediff",     "%lf",
+                   &myf->progressiveDiff);
+        optstr_get(options, "progressivechange",   "%lf",
+                   &myf->progressiveChange);
+        optstr_get(options, "changedifmore",       "%lf",
+                   &myf->changedIfMore);
+        optstr_get(options, "forcetelecinedetect", "%d",
+                   &myf->forceTelecineDetect);
+        optstr_get(options, "verbose",             "%d", &myf->verbose);
+        optstr_get(options, "outdiff",             "%d", &myf->outDiff);
+
+        if (optstr_lookup(options, "help") != NULL) {
+            tc_log_info(MOD_NAME, "(%s) help\n%s",
+                        MOD_CAP, fieldanalysis_help);
+        }
+    }
+
+    /* frame memory */
+    myf->lumIn    = tc_zalloc(myf->size);
+    myf->lumPrev  = tc_zalloc(myf->size);
+    myf->lumInT   = tc_zalloc(myf->size);
+    myf->lumInB   = tc_zalloc(myf->size);
+    myf->lumPrevT = tc_zalloc(myf->size);
+    myf->lumPrevB = tc_zalloc(myf->size);
+    if (!myf->lumIn  || !myf->lumPrev  || !myf->lumInT
+     || !myf->lumInB || !myf->lumPrevT || !myf->lumPrevB) {
+        tc_log_error(MOD_NAME, "out of memory");
+        fieldanalysis_stop(self);
+        return TC_ERROR;
+    }
+
+    if (verbose) {
+        tc_log_info(MOD_NAME, "interlacediff %.2f,  unknowndiff %.2f,"
+                              "  progressivediff %.2f",
+                    myf->interlaceDiff, myf->unknownDiff,
+                    myf->progressiveDiff);
+        tc_log_info(MOD_NAME, "progressivechange %.2f, changedifmore %.2f",
+                    myf->progressiveChange, myf->changedIfMore);
+        tc_log_info(MOD_NAME, "forcetelecinedetect %s, verbose %d,"
+                              " outdiff %d",
+                    myf->forceTelecineDetect ? "True" : "False",
+                    myf->verbose, myf->outDiff);
     }
 
-    return 0;
+    return TC_OK;
 }
 
+/*************************************************************************/
+
+/**
+ * fieldanalysis_inspect:  Return the value of an option in this instance
+ * of the module.  See tcmodule-data.h for function details.
+ */
+
+#define INSPECT_PARAM(NAME, FMT, FIELD) do { \
+    if (optstr_lookup(param, NAME)) { \
+        tc_snprintf(myf->conf_str, sizeof(myf->conf_str), \
+                    "%s=" FMT, NAME, myf->FIELD); \
+        *value = myf->conf_str; \
+    } \
+} while (0)
+
+static int fieldanalysis_inspect(TCModuleInstance *self,
+                                 const char *param, const char **value)
+{
+    myfilter_t *myf = NULL;
+
+    TC_MODULE_SELF_CHECK(self,  "inspect");
+    TC_MODULE_SELF_CHECK(param, "inspect");
+
+    myf = self->userdata;
+
+    if (optstr_lookup(param, "help")) {
+        *value = fieldanalysis_help;
+    }
+
+    INSPECT_PARAM("interlacediff",       "%g", interlaceDiff);
+    INSPECT_PARAM("unknowndiff",         "%g", unknownDiff);
+    INSPECT_PARAM("progressivediff",     "%g", progressiveDiff);
+    INSPECT_PARAM("progressivechange",   "%g", progressiveChange);
+    INSPECT_PARAM("changedifmore",       "%g", changedIfMore);
+    INSPECT_PARAM("forcetelecinedetect", "%i", forceTelecineDetect);
+    INSPECT_PARAM("verbose",             "%i", verbose);
+    INSPECT_PARAM("outdiff",             "%i", outDiff);
+
+    return TC_OK;
+}
+
+#undef INSPECT_PARAM
+
+/*************************************************************************/
+
+/**
+ * fieldanalysis_filter_video:  analyze the fields of a frame against the
+ * previous one.  See tcmodule-data.h for function details.
+ */
+
+static int fieldanalysis_filter_video(TCModuleInstance *self,
+                                      vframe_list_t *frame)
+{
+    myfilter_t *myf = NULL;
+    uint8_t *tmp;
+    int i, j;
+
+    TC_MODULE_SELF_CHECK(self,  "filter");
+    TC_MODULE_SELF_CHECK(frame, "filter");
+
+    myf = self->userdata;
+
+    /* Convert / Copy to luminance only */
+    switch (myf->codec) {
+      case TC_CODEC_RGB24:
+        tcv_convert(myf->tcvhandle, frame->video_buf, myf->lumIn,
+                    myf->width, myf->height, IMG_RGB_DEFAULT, IMG_Y8);
+        break;
+      case TC_CODEC_YUY2:
+        tcv_convert(myf->tcvhandle, frame->video_buf, myf->lumIn,
+                    myf->width, myf->height, IMG_YUY2, IMG_Y8);
+        break;
+      case TC_CODEC_YUV420P:
+        tcv_convert(myf->tcvhandle, frame->video_buf, myf->lumIn,
+                    myf->width, myf->height, IMG_YUV_DEFAULT, IMG_Y8);
+        break;
+      case TC_CODEC_YUV422P:
+        tcv_convert(myf->tcvhandle, frame->video_buf, myf->lumIn,
+                    myf->width, myf->height, IMG_YUV422P, IMG_Y8);
+        break;
+      default:
+        assert (0);
+    }
+
+    /* Bob Top field */
+    bob_field (myf->lumIn, myf->lumInT, myf->width, myf->height/2-1);
+    /* Bob Bottom field */
+    ac_memcpy (myf->lumInB, myf->lumIn + myf->width, myf->width);
+    bob_field (myf->lumIn + myf->width, myf->lumInB + myf->width,
+               myf->width, myf->height/2-1);
+    /* last copied line is ignored, buffer is large enough */
+
+    myf->changed = 0;
+    if (myf->numFrames == 0)
+        myf->numFrames++;
+    else if (frame->id != myf->lastId + 1) {
+        /* not the successor of the previous frame (next range of -c,
+         * next window of a sampled run): nothing to compare with yet */
+        myf->telecineState = 0;
+    } else if (!(frame->attributes & TC_FRAME_IS_SKIPPED)) {
+        int conclusion;
+
+        /* check_it */
+        check_interlace (myf, frame->id);
+
+        conclusion = conclude (myf) * 2
+                   + (myf->topFirstFrames > myf->bottomFirstFrames);
+        myf->changed = (conclusion != myf->conclusion);
+        myf->conclusion = conclusion;
+    }
+    myf->lastId = frame->id;
+
+    /* only works with YUV data correctly */
+    switch (myf->outDiff) {
+      case 1:                           /* lumIn */
+        ac_memcpy (frame->video_buf, myf->lumIn, myf->size);
+        break;
+      case 2:                           /* field shift */
+        for (i = 0 ; i < myf->height-2; i += 2)
+            for (j = 0; j < myf->width; j++) {
+                frame->video_buf [myf->width*i+j] =
+                    myf->lumIn [myf->width*i+j];
+                frame->video_buf [myf->width*(i+1)+j] =
+                    myf->lumPrev [myf->width*(i+1)+j];
+            }
+        break;
+      case 3:                           /* lumInT */
+        ac_memcpy (frame->video_buf, myf->lumInT, myf->size);
+        break;
+      case 4:                           /* lumInB */
+        ac_memcpy (frame->video_buf, myf->lumInB, myf->size);
+        break;
+      case 5:                           /* lumPrevT */
+        ac_memcpy (frame->video_buf, myf->lumPrevT, myf->size);
+        break;
+      case 6:                           /* lumPrevB */
+        ac_memcpy (frame->video_buf, myf->lumPrevB, myf->size);
+        break;
+      case 7:                           /* pixDiff */
+        pic_diff (myf->lumInT, myf->lumInB,   frame->video_buf, myf->size,4);
+        break;
+      case 8:                           /* pixShiftChangedT */
+        pic_diff (myf->lumInT, myf->lumPrevB, frame->video_buf, myf->size,4);
+        break;
+      case 9:                           /* pixShiftChangedB */
+        pic_diff (myf->lumInB, myf->lumPrevT, frame->video_buf, myf->size,4);
+        break;
+      case 10:                          /* pixLastT */
+        pic_diff (myf->lumInT, myf->lumPrevT, frame->video_buf, myf->size,4);
+        break;
+      case 11:                          /* pixLastB */
+        pic_diff (myf->lumInB, myf->lumPrevB, frame->video_buf, myf->size,4);
+        break;
+    }
+
+    /* The current frame gets the next previous frame :-P */
+    tmp = myf->lumPrev;   myf->lumPrev  = myf->lumIn;   myf->lumIn  = tmp;
+    tmp = myf->lumPrevT;  myf->lumPrevT = myf->lumInT;  myf->lumInT = tmp;
+    tmp = myf->lumPrevB;  myf->lumPrevB = myf->lumInB;  myf->lumInB = tmp;
+
+    return TC_OK;
+}
+
+/*************************************************************************/
+
+static const TCCodecID fieldanalysis_codecs_video_in[] = {
+    TC_CODEC_YUV420P, TC_CODEC_YUV422P, TC_CODEC_YUY2, TC_CODEC_RGB24,
+    TC_CODEC_ERROR
+};
+static const TCCodecID fieldanalysis_codecs_video_out[] = {
+    TC_CODEC_YUV420P, TC_CODEC_YUV422P, TC_CODEC_YUY2, TC_CODEC_RGB24,
+    TC_CODEC_ERROR
+};
+TC_MODULE_AUDIO_UNSUPPORTED(fieldanalysis);
+TC_MODULE_FILTER_FORMATS(fieldanalysis);
+
+TC_MODULE_INFO(fieldanalysis);
+
+static const TCModuleClass fieldanalysis_class = {
+    TC_MODULE_CLASS_HEAD(fieldanalysis),
+
+    .init         = fieldanalysis_init,
+    .fini         = fieldanalysis_fini,
+    .configure    = fieldanalysis_configure,
+    .stop         = fieldanalysis_stop,
+    .inspect      = fieldanalysis_inspect,
+
+    .filter_video = fieldanalysis_filter_video,
+};
+
+TC_MODULE_ENTRY_POINT(fieldanalysis)
+
+/*************************************************************************/
+
+static int fieldanalysis_get_config(TCModuleInstance *self, char *options)
+{
+    myfilter_t *myf = NULL;
+    char buf[TC_BUF_MIN];
+
+    TC_MODULE_SELF_CHECK(self, "get_config");
+
+    myf = self->userdata;
+
+    optstr_filter_desc(options, MOD_NAME, MOD_CAP, MOD_VERSION,
+                       MOD_AUTHOR, "VRY4E", "2");
+    tc_snprintf(buf, sizeof(buf), "%g", myf->interlaceDiff);
+    optstr_param(options, "interlacediff", "Minimum temporal inter-field difference for detecting interlaced video", "%f", buf, "1.0", "inf");
+    tc_snprintf(buf, sizeof(buf), "%g", myf->unknownDiff);
+    optstr_param(options, "unknowndiff", "Maximum inter-frame change vs. detail differences for neglecting interlaced video", "%f", buf, "1.0", "inf");
+    tc_snprintf(buf, sizeof(buf), "%g", myf->progressiveDiff);
+    optstr_param(options, "progressivediff", "Minimum inter-frame change vs. detail differences for detecting progressive video" ,"%f", buf, "unknowndiff", "inf");
+    tc_snprintf(buf, sizeof(buf), "%g", myf->progressiveChange);
+    optstr_param(options, "progressivechange", "Minimum temporal change needed for detecting progressive video" ,"%f", buf, "0", "inf");
+    tc_snprintf(buf, sizeof(buf), "%g", myf->changedIfMore);
+    optstr_param(options, "changedifmore", "Minimum temporal change for detecting truly changed frames" ,"%f", buf, "0", "65025");
+    tc_snprintf(buf, sizeof(buf), "%d", myf->forceTelecineDetect);
+    optstr_param(options, "forcetelecinedetect", "Detect telecine even on non-NTSC (29.97fps) video", "%d", buf, "0", "1");
+    tc_snprintf(buf, sizeof(buf), "%d", myf->verbose);
+    optstr_param(options, "verbose", "Output analysis for every frame", "%d", buf, "0", "2");
+    tc_snprintf(buf, sizeof(buf), "%d", myf->outDiff);
+    optstr_param(options, "outdiff", "Output internal debug frames as luminance of YUV video (see source)", "%d", buf, "0", "11");
+
+    return TC_OK;
+}
+
+static int fieldanalysis_process(TCModuleInstance *self, frame_list_t *frame)
+{
+    TC_MODULE_SELF_CHECK(self, "process");
+
+    /* need to process frames in-order */
+    if ((frame->tag & TC_PRE_S_PROCESS) && (frame->tag & TC_VIDEO)) {
+        myfilter_t *myf = self->userdata;
+        int ret = fieldanalysis_filter_video(self, (vframe_list_t*)frame);
+
+        tc_filter_report(frame->filter_id, myf->changed);
+        return ret;
+    }
+    return TC_OK;
+}
+
+/*************************************************************************/
+
+/* Old-fashioned module interface. */
+
+TC_FILTER_OLDINTERFACE_M(fieldanalysis)
+
+/*************************************************************************/
+
+/*
+ * Local variables:
+ *   c-file-style: "stroustrup"
+ *   c-file-offsets: ((case-label . *) (statement-case-intro . *))
+ *   indent-tabs-mode: nil
+ * End:
+ *
+ * vim: expandtab shiftwidth=4:
+ */
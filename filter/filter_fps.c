@@ -22,7 +22,7 @@
  */
 
 #define MOD_NAME    "filter_fps.so"
-#define MOD_VERSION "v1.1 (2004-05-01)"
+#define MOD_VERSION "v1.1.1 (2026-10-18)"
 #define MOD_CAP     "convert video frame rate, gets defaults from -f and --export_fps"
 #define MOD_AUTHOR  "Christopher Cramer"
 
@@ -117,7 +117,7 @@ tc_filter(frame_list_t *ptr_, char *options)
 
 	if(ptr->tag & TC_FILTER_GET_CONFIG) {
 	    optstr_filter_desc (options, MOD_NAME, MOD_CAP, MOD_VERSION,
-		"Christopher Cramer", "VRYEO", "1");
+		"Christopher Cramer", "VRYEOS", "1");
 	    return 0;
 	}
 
@@ -18,14 +18,21 @@
 */
 
 #define MOD_NAME    "filter_hqdn3d.so"
-#define MOD_VERSION "v1.0.2 (2003-08-15)"
+#define MOD_VERSION "v1.2.0 (2026-10-18)"
 #define MOD_CAP     "High Quality 3D Denoiser"
 #define MOD_AUTHOR  "Daniel Moreno, A'rpi"
 
+#define MOD_FEATURES \
+    TC_MODULE_FEATURE_FILTER|TC_MODULE_FEATURE_VIDEO
+#define MOD_FLAGS \
+    TC_MODULE_FLAG_RECONFIGURABLE|TC_MODULE_FLAG_BUFFERING
+
 #include "src/transcode.h"
 #include "src/filter.h"
 #include "libtc/libtc.h"
 #include "libtcutil/optstr.h"
+#include "libtcutil/tcthread.h"
+#include "libtcmodule/tcmodule-plugin.h"
 
 #include <math.h>
 
@@ -36,12 +43,42 @@
 
 //===========================================================================//
 
-typedef struct vf_priv_s {
-        int Coefs[4][512*16];
-        unsigned int *Line;
-	unsigned short *Frame[3];
-	int pre;
-} MyFilterData;
+/*
+ * The temporal part of the filter needs the previous (filtered) frame,
+ * so an instance must see frames one at a time and in order: this is
+ * NOT a reentrant module.
+ */
+typedef struct hqdn3dprivatedata_ Hqdn3dPrivateData;
+struct hqdn3dprivatedata_ {
+    int Coefs[4][512*16];
+    unsigned int *Line;
+    unsigned int *Spatial;
+    unsigned short *Frame[3];
+    uint8_t *buffer;
+    int pre;
+    int threads;
+    int sse2;
+
+    double lum_spac;
+    double lum_tmp;
+    double chrom_spac;
+    double chrom_tmp;
+
+    char conf_str[TC_BUF_MIN];
+};
+
+static const char hqdn3d_help[] = ""
+    "* Overview\n"
+    "  This filter aims to reduce image noise producing\n"
+    "  smooth images and making still images really still\n"
+    "  (This should enhance compressibility).\n"
+    "* Options\n"
+    "             luma : spatial luma strength (4.0)\n"
+    "           chroma : spatial chroma strength (3.0)\n"
+    "    luma_strength : temporal luma strength (6.0)\n"
+    "  chroma_strength : temporal chroma strength (4.5)\n"
+    "              pre : run as a pre filter (0)\n"
+    "          threads : bands filtered in parallel (1)\n";
 
 
 /***************************************************************************/
@@ -53,64 +90,237 @@ static inline unsigned int LowPassMul(unsigned int PrevMul, unsigned int CurrMul
     return CurrMul + Coef[d];
 }
 
-static void deNoise(unsigned char *Frame,        // mpi->planes[x]
+/*
+ * The filter runs in two passes, so that it can be split across threads.
+ * The horizontal low-pass of a line only depends on that line: it runs
+ * over bands of lines and stores its result in the Spatial plane.  The
+ * vertical and temporal low-passes of a pixel only depend on the pixel
+ * above and on the previous frame: they run down bands of columns, each
+ * band carrying its own part of the line buffer.  The arithmetic is the
+ * one of the original single pass, so the output does not change.
+ */
+
+typedef struct hqdn3dplane_ Hqdn3dPlane;
+struct hqdn3dplane_ {
+    unsigned char *Frame;       /* source plane */
+    unsigned char *FrameDest;   /* destination plane */
+    unsigned int *Spatial;      /* horizontal low-pass, W*H */
+    unsigned int *LineAnt;      /* vertical low-pass of the last line */
+    unsigned short *FrameAnt;   /* previous frame */
+    int W, H;
+    int *Horizontal, *Vertical, *Temporal;
+    int sse2;
+};
+
+/* Columns in a band are a multiple of this */
+#define HQDN3D_COLUMNS 16
+
+static void deNoiseRows(void *datum, int band, int first, int last)
+{
+    Hqdn3dPlane *p = datum;
+    int X, Y;
+
+    for (Y = first; Y < last; Y++) {
+        unsigned char *Frame = p->Frame + Y*p->W;
+        unsigned int *Spatial = p->Spatial + Y*p->W;
+        unsigned int PixelAnt;
+
+        /* First pixel on each line doesn't have previous pixel */
+        Spatial[0] = PixelAnt = Frame[0]<<16;
+        for (X = 1; X < p->W; X++){
+            Spatial[X] = PixelAnt = LowPassMul(PixelAnt, Frame[X]<<16,
+                                               p->Horizontal);
+        }
+    }
+}
+
+static void deNoiseLine(unsigned int *LineAnt, unsigned short *LinePrev,
+                        unsigned char *Dest, const unsigned int *Spatial,
+                        int W, int *Vertical, int *Temporal)
+{
+    int X;
+
+    for (X = 0; X < W; X++){
+        int PixelDst;
+        LineAnt[X] = LowPassMul(LineAnt[X], Spatial[X], Vertical);
+        PixelDst = LowPassMul(LinePrev[X]<<8, LineAnt[X], Temporal);
+        LinePrev[X] = ((PixelDst+0x1000007F)/256);
+        Dest[X]= ((PixelDst+0x10007FFF)/65536);
+    }
+}
+
+#if defined(HAVE_ASM_SSE2) && defined(ARCH_X86_64)
+
+/*
+ * deNoiseLine on four pixels at once.  SSE2 has no gather, so the
+ * Coef[] indexes are moved to general registers two at a time and the
+ * four coefficients are loaded one by one; everything else is done in
+ * 32 bit lanes, wrapping like the C code does.  The outermost Coef[]
+ * entries are not numbers (pow() of a negative value), so once a pixel
+ * went through one of them the sums can be negative: the divisions
+ * round towards zero, as in C, and the indexes are sign extended.
+ */
+
+static const int32_t hqdn3d_index_round[4] __attribute__((aligned(16)))
+    = { 0x10007FF, 0x10007FF, 0x10007FF, 0x10007FF };
+static const int32_t hqdn3d_prev_round[4] __attribute__((aligned(16)))
+    = { 0x1000007F, 0x1000007F, 0x1000007F, 0x1000007F };
+static const int32_t hqdn3d_dest_round[4] __attribute__((aligned(16)))
+    = { 0x10007FFF, 0x10007FFF, 0x10007FFF, 0x10007FFF };
+static const int32_t hqdn3d_low_byte[4] __attribute__((aligned(16)))
+    = { 0xFF, 0xFF, 0xFF, 0xFF };
+
+/* xmm1 /= 2^bits, rounding towards zero; clobbers xmm3 */
+#define HQDN3D_SSE2_DIV(bits)                                           \
+    "movdqa %%xmm1, %%xmm3                                      \n\
+    psrad $31, %%xmm3                                           \n\
+    psrld $(32-" #bits "), %%xmm3                               \n\
+    paddd %%xmm3, %%xmm1                                        \n\
+    psrad $" #bits ", %%xmm1                                    \n"
+
+/* xmm2 = Coef[xmm1], clobbers xmm3, xmm4 and the index registers */
+#define HQDN3D_SSE2_LOOKUP(coef)                                        \
+    "movq %%xmm1, %[i1]                                         \n\
+    movslq %k[i1], %[i0]                                        \n\
+    sarq $32, %[i1]                                             \n\
+    pshufd $0xEE, %%xmm1, %%xmm1                                \n\
+    movq %%xmm1, %[i3]                                          \n\
+    movslq %k[i3], %[i2]                                        \n\
+    sarq $32, %[i3]                                             \n\
+    movd (%[" coef "],%[i0],4), %%xmm2                          \n\
+    movd (%[" coef "],%[i1],4), %%xmm3                          \n\
+    punpckldq %%xmm3, %%xmm2                                    \n\
+    movd (%[" coef "],%[i2],4), %%xmm3                          \n\
+    movd (%[" coef "],%[i3],4), %%xmm4                          \n\
+    punpckldq %%xmm4, %%xmm3                                    \n\
+    punpcklqdq %%xmm3, %%xmm2                                   \n"
+
+static void deNoiseLine_sse2(unsigned int *LineAnt, unsigned short *LinePrev,
+                             unsigned char *Dest, const unsigned int *Spatial,
+                             int W, int *Vertical, int *Temporal)
+{
+    long i0, i1, i2, i3;
+    int X;
+
+    for (X = 0; X + 4 <= W; X += 4) {
+        __asm__ __volatile__(
+            /* LineAnt = LowPassMul(LineAnt, Spatial, Vertical) */
+            "movdqu (%[spatial]), %%xmm0                        \n\
+            movdqu (%[line]), %%xmm1                            \n\
+            psubd %%xmm0, %%xmm1                                \n\
+            paddd %[index_round], %%xmm1                        \n"
+            HQDN3D_SSE2_DIV(12)
+            HQDN3D_SSE2_LOOKUP("vertical")
+            "paddd %%xmm2, %%xmm0                               \n\
+            movdqu %%xmm0, (%[line])                            \n"
+            /* PixelDst = LowPassMul(LinePrev<<8, LineAnt, Temporal) */
+            "movq (%[prev]), %%xmm1                             \n\
+            pxor %%xmm3, %%xmm3                                 \n\
+            punpcklwd %%xmm3, %%xmm1                            \n\
+            pslld $8, %%xmm1                                    \n\
+            psubd %%xmm0, %%xmm1                                \n\
+            paddd %[index_round], %%xmm1                        \n"
+            HQDN3D_SSE2_DIV(12)
+            HQDN3D_SSE2_LOOKUP("temporal")
+            "paddd %%xmm2, %%xmm0                               \n"
+            /* LinePrev: low 16 bits of (PixelDst+0x1000007F)/256 */
+            "movdqa %%xmm0, %%xmm1                              \n\
+            paddd %[prev_round], %%xmm1                         \n"
+            HQDN3D_SSE2_DIV(8)
+            "pslld $16, %%xmm1                                  \n\
+            psrad $16, %%xmm1                                   \n\
+            packssdw %%xmm1, %%xmm1                             \n\
+            movq %%xmm1, (%[prev])                              \n"
+            /* Dest: low 8 bits of (PixelDst+0x10007FFF)/65536 */
+            "movdqa %%xmm0, %%xmm1                              \n\
+            paddd %[dest_round], %%xmm1                         \n"
+            HQDN3D_SSE2_DIV(16)
+            "pand %[low_byte], %%xmm1                           \n\
+            packssdw %%xmm1, %%xmm1                             \n\
+            packuswb %%xmm1, %%xmm1                             \n\
+            movd %%xmm1, (%[dest])                              \n"
+            : [i0] "=&r" (i0), [i1] "=&r" (i1),
+              [i2] "=&r" (i2), [i3] "=&r" (i3)
+            : [spatial] "r" (Spatial + X), [line] "r" (LineAnt + X),
+              [prev] "r" (LinePrev + X), [dest] "r" (Dest + X),
+              [vertical] "r" (Vertical), [temporal] "r" (Temporal),
+              [index_round] "m" (*hqdn3d_index_round),
+              [prev_round] "m" (*hqdn3d_prev_round),
+              [dest_round] "m" (*hqdn3d_dest_round),
+              [low_byte] "m" (*hqdn3d_low_byte)
+            : "xmm0", "xmm1", "xmm2", "xmm3", "xmm4", "memory"
+        );
+    }
+    deNoiseLine(LineAnt + X, LinePrev + X, Dest + X, Spatial + X,
+                W - X, Vertical, Temporal);
+}
+
+#endif  /* HAVE_ASM_SSE2 && ARCH_X86_64 */
+
+static void deNoiseColumns(void *datum, int band, int first, int last)
+{
+    Hqdn3dPlane *p = datum;
+    int X = first * HQDN3D_COLUMNS;
+    int W = TC_MIN(last * HQDN3D_COLUMNS, p->W) - X;
+    int Y;
+
+    /* First line has no top neighbour: low-passing it against itself
+     * leaves it as it is, since Coef[] is 0 for no difference. */
+    ac_memcpy(p->LineAnt + X, p->Spatial + X, W * sizeof(unsigned int));
+
+    for (Y = 0; Y < p->H; Y++){
+        unsigned int *LineAnt = p->LineAnt + X;
+        unsigned short *LinePrev = p->FrameAnt + Y*p->W + X;
+        unsigned char *Dest = p->FrameDest + Y*p->W + X;
+        const unsigned int *Spatial = p->Spatial + Y*p->W + X;
+
+#if defined(HAVE_ASM_SSE2) && defined(ARCH_X86_64)
+        if (p->sse2) {
+            deNoiseLine_sse2(LineAnt, LinePrev, Dest, Spatial, W,
+                             p->Vertical, p->Temporal);
+            continue;
+        }
+#endif
+        deNoiseLine(LineAnt, LinePrev, Dest, Spatial, W,
+                    p->Vertical, p->Temporal);
+    }
+}
+
+static void deNoise(Hqdn3dPrivateData *pd,
+                    unsigned char *Frame,        // mpi->planes[x]
                     unsigned char *FrameDest,    // dmpi->planes[x]
-                    unsigned int *LineAnt,      // vf->priv->Line (width bytes)
 		    unsigned short **FrameAntPtr,
-                    int W, int H, int sStride, int dStride,
+                    int W, int H,
                     int *Horizontal, int *Vertical, int *Temporal)
 {
+    Hqdn3dPlane p;
     int X, Y;
-    int sLineOffs = 0, dLineOffs = 0;
-    unsigned int PixelAnt;
-    int PixelDst;
     unsigned short* FrameAnt=(*FrameAntPtr);
 
     if(!FrameAnt){
 	(*FrameAntPtr)=FrameAnt=tc_malloc(W*H*sizeof(unsigned short));
 	for (Y = 0; Y < H; Y++){
 	    unsigned short* dst=&FrameAnt[Y*W];
-	    unsigned char* src=Frame+Y*sStride;
+	    unsigned char* src=Frame+Y*W;
 	    for (X = 0; X < W; X++) dst[X]=src[X]<<8;
 	}
     }
 
-    /* First pixel has no left nor top neightbour. Only previous frame */
-    LineAnt[0] = PixelAnt = Frame[0]<<16;
-    PixelDst = LowPassMul(FrameAnt[0]<<8, PixelAnt, Temporal);
-    FrameAnt[0] = ((PixelDst+0x1000007F)/256);
-    FrameDest[0]= ((PixelDst+0x10007FFF)/65536);
-
-    /* Fist line has no top neightbour. Only left one for each pixel and
-     * last frame */
-    for (X = 1; X < W; X++){
-        LineAnt[X] = PixelAnt = LowPassMul(PixelAnt, Frame[X]<<16, Horizontal);
-        PixelDst = LowPassMul(FrameAnt[X]<<8, PixelAnt, Temporal);
-	FrameAnt[X] = ((PixelDst+0x1000007F)/256);
-	FrameDest[X]= ((PixelDst+0x10007FFF)/65536);
-    }
-
-    for (Y = 1; Y < H; Y++){
-	unsigned int PixelAnt;
-	unsigned short* LinePrev=&FrameAnt[Y*W];
-	sLineOffs += sStride, dLineOffs += dStride;
-        /* First pixel on each line doesn't have previous pixel */
-        PixelAnt = Frame[sLineOffs]<<16;
-        LineAnt[0] = LowPassMul(LineAnt[0], PixelAnt, Vertical);
-	PixelDst = LowPassMul(LinePrev[0]<<8, LineAnt[0], Temporal);
-	LinePrev[0] = ((PixelDst+0x1000007F)/256);
-	FrameDest[dLineOffs]= ((PixelDst+0x10007FFF)/65536);
-
-        for (X = 1; X < W; X++){
-	    int PixelDst;
-            /* The rest are normal */
-            PixelAnt = LowPassMul(PixelAnt, Frame[sLineOffs+X]<<16, Horizontal);
-            LineAnt[X] = LowPassMul(LineAnt[X], PixelAnt, Vertical);
-	    PixelDst = LowPassMul(LinePrev[X]<<8, LineAnt[X], Temporal);
-	    LinePrev[X] = ((PixelDst+0x1000007F)/256);
-	    FrameDest[dLineOffs+X]= ((PixelDst+0x10007FFF)/65536);
-        }
-    }
+    p.Frame      = Frame;
+    p.FrameDest  = FrameDest;
+    p.Spatial    = pd->Spatial;
+    p.LineAnt    = pd->Line;
+    p.FrameAnt   = FrameAnt;
+    p.W          = W;
+    p.H          = H;
+    p.Horizontal = Horizontal;
+    p.Vertical   = Vertical;
+    p.Temporal   = Temporal;
+    p.sse2       = pd->sse2;
+
+    tc_thread_bands(pd->threads, H, deNoiseRows, &p);
+    tc_thread_bands(pd->threads, (W + HQDN3D_COLUMNS-1) / HQDN3D_COLUMNS,
+                    deNoiseColumns, &p);
 }
 
 
@@ -132,203 +342,361 @@ static void PrecalcCoefs(int *Ct, double Dist25)
     }
 }
 
-static void help_optstr(void)
+/*************************************************************************/
+
+/* Module interface routines and data. */
+
+/*************************************************************************/
+
+/**
+ * hqdn3d_init:  Initialize this instance of the module.  See
+ * tcmodule-data.h for function details.
+ */
+
+static int hqdn3d_init(TCModuleInstance *self, uint32_t features)
 {
-    tc_log_info(MOD_NAME, "(%s) help\n"
-"* Overview\n"
-"  This filter aims to reduce image noise producing\n"
-"  smooth images and making still images really still\n"
-"  (This should enhance compressibility).\n"
-"* Options\n"
-"             luma : spatial luma strength (%f)\n"
-"           chroma : spatial chroma strength (%f)\n"
-"    luma_strength : temporal luma strength (%f)\n"
-"  chroma_strength : temporal chroma strength (%f)\n"
-"              pre : run as a pre filter (0)\n"
-		, MOD_CAP,
-		PARAM1_DEFAULT,
-		PARAM2_DEFAULT,
-		PARAM3_DEFAULT,
-		PARAM3_DEFAULT*PARAM2_DEFAULT/PARAM1_DEFAULT);
+    Hqdn3dPrivateData *pd = NULL;
+
+    TC_MODULE_SELF_CHECK(self, "init");
+    TC_MODULE_INIT_CHECK(self, MOD_FEATURES, features);
+
+    pd = tc_zalloc(sizeof(Hqdn3dPrivateData));
+    if (pd == NULL) {
+        tc_log_error(MOD_NAME, "init: out of memory!");
+        return TC_ERROR;
+    }
+    self->userdata = pd;
+
+    if (verbose) {
+        tc_log_info(MOD_NAME, "%s %s", MOD_VERSION, MOD_CAP);
+    }
+    return TC_OK;
 }
 
-// main filter routine
-int tc_filter(frame_list_t *ptr_, char *options)
+/*************************************************************************/
+
+/**
+ * hqdn3d_fini:  Clean up after this instance of the module.  See
+ * tcmodule-data.h for function details.
+ */
+
+TC_MODULE_GENERIC_FINI(hqdn3d)
+
+/*************************************************************************/
+
+/**
+ * hqdn3d_configure:  Configure this instance of the module.  See
+ * tcmodule-data.h for function details.
+ */
+
+static int hqdn3d_configure(TCModuleInstance *self,
+                            const char *options,
+                            TCJob *vob,
+                            TCModuleExtraData *xdata[])
 {
-  vframe_list_t *ptr = (vframe_list_t *)ptr_;
-  static vob_t *vob=NULL;
-  /* FIXME: these use the filter ID as an index--the ID can grow
-   * arbitrarily large, so this needs to be fixed */
-  static MyFilterData *mfd[100];
-  static char *buffer[100];
-  int instance = ptr->filter_id;
+    Hqdn3dPrivateData *pd = NULL;
+    double Param1 = 0.0, Param2 = 0.0, Param3 = 0.0, Param4 = 0.0;
 
+    TC_MODULE_SELF_CHECK(self, "configure");
 
-  if(ptr->tag & TC_AUDIO)
-      return 0;
+    pd = self->userdata;
 
-  if(ptr->tag & TC_FILTER_GET_CONFIG) {
+    if (vob->im_v_codec != TC_CODEC_YUV420P) {
+        tc_log_error(MOD_NAME, "This filter is only capable of YUV 4:2:0 mode");
+        return TC_ERROR;
+    }
 
-      char buf[128];
-      optstr_filter_desc (options, MOD_NAME, MOD_CAP, MOD_VERSION, MOD_AUTHOR, "VYMOE", "2");
+    pd->Line   = tc_zalloc(TC_MAX_V_FRAME_WIDTH * sizeof(int));
+    pd->buffer = tc_zalloc(SIZE_RGB_FRAME);
+    if (!pd->Line || !pd->buffer) {
+        tc_log_error(MOD_NAME, "Malloc failed");
+        tc_free(pd->Line);
+        tc_free(pd->buffer);
+        pd->Line   = NULL;
+        pd->buffer = NULL;
+        return TC_ERROR;
+    }
 
-      tc_snprintf(buf, 128, "%f", PARAM1_DEFAULT);
-      optstr_param (options, "luma", "spatial luma strength", "%f", buf, "0.0", "100.0" );
+    /* defaults */
+    pd->pre        = TC_FALSE;
+    pd->threads    = 1;
+    pd->lum_spac   = PARAM1_DEFAULT;
+    pd->lum_tmp    = PARAM3_DEFAULT;
+    pd->chrom_spac = PARAM2_DEFAULT;
+    pd->chrom_tmp  = pd->lum_tmp * pd->chrom_spac / pd->lum_spac;
+
+    if (options) {
+        if (optstr_lookup(options, "help")) {
+            tc_log_info(MOD_NAME, "(%s) help\n%s", MOD_CAP, hqdn3d_help);
+        }
 
-      tc_snprintf(buf, 128, "%f", PARAM2_DEFAULT);
-      optstr_param (options, "chroma", "spatial chroma strength", "%f", buf, "0.0", "100.0" );
+        optstr_get(options, "luma",            "%lf", &Param1);
+        optstr_get(options, "luma_strength",   "%lf", &Param3);
+        optstr_get(options, "chroma",          "%lf", &Param2);
+        optstr_get(options, "chroma_strength", "%lf", &Param4);
+        optstr_get(options, "pre",             "%d",  &pd->pre);
+        optstr_get(options, "threads",         "%d",  &pd->threads);
+
+        /* recalculate only the needed params */
+        if (Param1 != 0.0) {
+            pd->lum_spac   = Param1;
+            pd->lum_tmp    = PARAM3_DEFAULT * Param1 / PARAM1_DEFAULT;
+            pd->chrom_spac = PARAM2_DEFAULT * Param1 / PARAM1_DEFAULT;
+            pd->chrom_tmp  = pd->lum_tmp * pd->chrom_spac / pd->lum_spac;
+        }
+        if (Param2 != 0.0) {
+            pd->chrom_spac = Param2;
+            pd->chrom_tmp  = pd->lum_tmp * pd->chrom_spac / pd->lum_spac;
+        }
+        if (Param3 != 0.0) {
+            pd->lum_tmp    = Param3;
+            pd->chrom_tmp  = pd->lum_tmp * pd->chrom_spac / pd->lum_spac;
+        }
+        if (Param4 != 0.0) {
+            pd->chrom_tmp  = Param4;
+        }
+    }
 
-      tc_snprintf(buf, 128, "%f", PARAM3_DEFAULT);
-      optstr_param (options, "luma_strength", "temporal luma strength", "%f", buf, "0.0", "100.0" );
+    pd->threads = TC_CLAMP(pd->threads, 1, TC_THREAD_MAX_BANDS);
+#if defined(HAVE_ASM_SSE2) && defined(ARCH_X86_64)
+    pd->sse2 = (tc_get_session()->acceleration & AC_SSE2) != 0;
+#endif
+
+    PrecalcCoefs(pd->Coefs[0], pd->lum_spac);
+    PrecalcCoefs(pd->Coefs[1], pd->lum_tmp);
+    PrecalcCoefs(pd->Coefs[2], pd->chrom_spac);
+    PrecalcCoefs(pd->Coefs[3], pd->chrom_tmp);
+
+    if (verbose) {
+        tc_log_info(MOD_NAME, "Settings luma=%.2f chroma=%.2f"
+                              " luma_strength=%.2f chroma_strength=%.2f",
+                    pd->lum_spac, pd->chrom_spac,
+                    pd->lum_tmp, pd->chrom_tmp);
+        tc_log_info(MOD_NAME, "%d thread(s)%s", pd->threads,
+                    pd->sse2 ? ", SSE2" : "");
+    }
+    return TC_OK;
+}
 
-      tc_snprintf(buf, 128, "%f", PARAM3_DEFAULT*PARAM2_DEFAULT/PARAM1_DEFAULT);
-      optstr_param (options, "chroma_strength", "temporal chroma strength", "%f", buf, "0.0", "100.0" );
-      tc_snprintf(buf, 128, "%d", mfd[instance]->pre);
-      optstr_param (options, "pre", "run as a pre filter", "%d", buf, "0", "1" );
+/*************************************************************************/
 
-      return 0;
-  }
+/**
+ * hqdn3d_stop:  Reset this instance of the module.  See tcmodule-data.h
+ * for function details.
+ */
 
-  if(ptr->tag & TC_FILTER_INIT) {
+#define FREE_MEM(PTR) do { \
+    if ((PTR)) \
+        tc_free((PTR)); \
+    (PTR) = NULL; \
+} while (0)
 
-      double LumSpac, LumTmp, ChromSpac, ChromTmp;
-      double Param1=0.0, Param2=0.0, Param3=0.0, Param4=0.0;
+static int hqdn3d_stop(TCModuleInstance *self)
+{
+    Hqdn3dPrivateData *pd = NULL;
 
-      if((vob = tc_get_vob())==NULL) return(-1);
+    TC_MODULE_SELF_CHECK(self, "stop");
 
-      if (vob->im_v_codec != TC_CODEC_YUV420P) {
-	  tc_log_error(MOD_NAME, "This filter is only capable of YUV 4:2:0 mode");
-	  return -1;
-      }
+    pd = self->userdata;
 
-      mfd[instance] = tc_zalloc(sizeof(MyFilterData));
+    FREE_MEM(pd->buffer);
+    FREE_MEM(pd->Line);
+    FREE_MEM(pd->Spatial);
+    FREE_MEM(pd->Frame[0]);
+    FREE_MEM(pd->Frame[1]);
+    FREE_MEM(pd->Frame[2]);
 
-      if (mfd[instance]) {
-	  mfd[instance]->Line = tc_zalloc(TC_MAX_V_FRAME_WIDTH*sizeof(int));
-      }
+    return TC_OK;
+}
 
-      buffer[instance] = tc_zalloc(SIZE_RGB_FRAME);
+#undef FREE_MEM
 
-      if (!mfd[instance] || !mfd[instance]->Line || !buffer[instance]) {
-	  tc_log_error(MOD_NAME, "Malloc failed");
-	  return -1;
-      }
+/*************************************************************************/
 
+/**
+ * hqdn3d_inspect:  Return the value of an option in this instance of
+ * the module.  See tcmodule-data.h for function details.
+ */
 
-      // defaults
+#define INSPECT_PARAM(NAME, FMT, FIELD) do { \
+    if (optstr_lookup(param, NAME)) { \
+        tc_snprintf(pd->conf_str, sizeof(pd->conf_str), \
+                    "%s=" FMT, NAME, pd->FIELD); \
+        *value = pd->conf_str; \
+    } \
+} while (0)
 
-      LumSpac = PARAM1_DEFAULT;
-      LumTmp = PARAM3_DEFAULT;
+static int hqdn3d_inspect(TCModuleInstance *self,
+                          const char *param, const char **value)
+{
+    Hqdn3dPrivateData *pd = NULL;
 
-      ChromSpac = PARAM2_DEFAULT;
-      ChromTmp = LumTmp * ChromSpac / LumSpac;
+    TC_MODULE_SELF_CHECK(self,  "inspect");
+    TC_MODULE_SELF_CHECK(param, "inspect");
 
-      if (options) {
+    pd = self->userdata;
 
-	  if (optstr_lookup (options, "help")) {
-	      help_optstr();
-	  }
+    if (optstr_lookup(param, "help")) {
+        *value = hqdn3d_help;
+    }
 
-	  optstr_get (options, "luma",           "%lf",    &Param1);
-	  optstr_get (options, "luma_strength",  "%lf",    &Param3);
-	  optstr_get (options, "chroma",         "%lf",    &Param2);
-	  optstr_get (options, "chroma_strength","%lf",    &Param4);
-	  optstr_get (options, "pre", "%d",    &mfd[instance]->pre);
+    INSPECT_PARAM("luma",            "%f", lum_spac);
+    INSPECT_PARAM("chroma",          "%f", chrom_spac);
+    INSPECT_PARAM("luma_strength",   "%f", lum_tmp);
+    INSPECT_PARAM("chroma_strength", "%f", chrom_tmp);
+    INSPECT_PARAM("pre",             "%i", pre);
+    INSPECT_PARAM("threads",         "%i", threads);
 
-	  // recalculate only the needed params
+    return TC_OK;
+}
 
-	  if (Param1!=0.0) {
+#undef INSPECT_PARAM
 
-	      LumSpac = Param1;
-	      LumTmp = PARAM3_DEFAULT * Param1 / PARAM1_DEFAULT;
+/*************************************************************************/
 
-	      ChromSpac = PARAM2_DEFAULT * Param1 / PARAM1_DEFAULT;
-	      ChromTmp = LumTmp * ChromSpac / LumSpac;
-	  }
-	  if (Param2!=0.0) {
+/**
+ * hqdn3d_filter_video:  denoise the three planes of a YUV 4:2:0 frame,
+ * spatially and against the previous frame. See tcmodule-data.h for
+ * function details.
+ */
 
-	      ChromSpac = Param2;
-	      ChromTmp = LumTmp * ChromSpac / LumSpac;
-	  }
-	  if (Param3!=0.0) {
+static int hqdn3d_filter_video(TCModuleInstance *self,
+                               vframe_list_t *frame)
+{
+    Hqdn3dPrivateData *pd = NULL;
+    int w = 0, h = 0;
 
-	      LumTmp = Param3;
-	      ChromTmp = LumTmp * ChromSpac / LumSpac;
+    TC_MODULE_SELF_CHECK(self,  "filter");
+    TC_MODULE_SELF_CHECK(frame, "filter");
 
-	  }
-	  if (Param4!=0.0) {
+    pd = self->userdata;
+    w  = frame->v_width;
+    h  = frame->v_height;
 
-	      ChromTmp = Param4;
-	  }
+    if (!pd->Spatial) {
+        pd->Spatial = tc_malloc(w * h * sizeof(unsigned int));
+        if (!pd->Spatial) {
+            tc_log_error(MOD_NAME, "Malloc failed");
+            return TC_ERROR;
+        }
+    }
+
+    ac_memcpy(pd->buffer, frame->video_buf, frame->video_size);
+
+    deNoise(pd, pd->buffer, frame->video_buf,
+            &pd->Frame[0], w, h,
+            pd->Coefs[0], pd->Coefs[0], pd->Coefs[1]);
+
+    deNoise(pd, pd->buffer + w*h, frame->video_buf + w*h,
+            &pd->Frame[1], w>>1, h>>1,
+            pd->Coefs[2], pd->Coefs[2], pd->Coefs[3]);
 
-      }
+    deNoise(pd, pd->buffer + 5*w*h/4, frame->video_buf + 5*w*h/4,
+            &pd->Frame[2], w>>1, h>>1,
+            pd->Coefs[2], pd->Coefs[2], pd->Coefs[3]);
 
-      PrecalcCoefs(mfd[instance]->Coefs[0], LumSpac);
-      PrecalcCoefs(mfd[instance]->Coefs[1], LumTmp);
-      PrecalcCoefs(mfd[instance]->Coefs[2], ChromSpac);
-      PrecalcCoefs(mfd[instance]->Coefs[3], ChromTmp);
+    return TC_OK;
+}
+
+/*************************************************************************/
 
+static const TCCodecID hqdn3d_codecs_video_in[] = {
+    TC_CODEC_YUV420P, TC_CODEC_ERROR
+};
+static const TCCodecID hqdn3d_codecs_video_out[] = {
+    TC_CODEC_YUV420P, TC_CODEC_ERROR
+};
+TC_MODULE_AUDIO_UNSUPPORTED(hqdn3d);
+TC_MODULE_FILTER_FORMATS(hqdn3d);
 
-      if(verbose) {
-	  tc_log_info(MOD_NAME, "%s %s #%d", MOD_VERSION, MOD_CAP, instance);
-	  tc_log_info(MOD_NAME, "Settings luma=%.2f chroma=%.2f luma_strength=%.2f chroma_strength=%.2f",
-		  LumSpac, ChromSpac, LumTmp, ChromTmp);
-      }
-      return 0;
-  }
+TC_MODULE_INFO(hqdn3d);
 
+static const TCModuleClass hqdn3d_class = {
+    TC_MODULE_CLASS_HEAD(hqdn3d),
 
+    .init         = hqdn3d_init,
+    .fini         = hqdn3d_fini,
+    .configure    = hqdn3d_configure,
+    .stop         = hqdn3d_stop,
+    .inspect      = hqdn3d_inspect,
 
-  //----------------------------------
-  //
-  // filter close
-  //
-  //----------------------------------
+    .filter_video = hqdn3d_filter_video,
+};
 
+TC_MODULE_ENTRY_POINT(hqdn3d)
 
-  if(ptr->tag & TC_FILTER_CLOSE) {
+/*************************************************************************/
 
-      if (buffer[instance]) {free(buffer[instance]); buffer[instance]=NULL;}
-      if (mfd[instance]) {
-	  if(mfd[instance]->Line){free(mfd[instance]->Line);mfd[instance]->Line=NULL;}
-	  if(mfd[instance]->Frame[0]){free(mfd[instance]->Frame[0]);mfd[instance]->Frame[0]=NULL;}
-	  if(mfd[instance]->Frame[1]){free(mfd[instance]->Frame[1]);mfd[instance]->Frame[1]=NULL;}
-	  if(mfd[instance]->Frame[2]){free(mfd[instance]->Frame[2]);mfd[instance]->Frame[2]=NULL;}
-	  free(mfd[instance]);
-      }
-      mfd[instance]=NULL;
+static int hqdn3d_get_config(TCModuleInstance *self, char *options)
+{
+    Hqdn3dPrivateData *pd = NULL;
+    char buf[TC_BUF_MIN];
 
-      return(0);
+    TC_MODULE_SELF_CHECK(self, "get_config");
 
-  } /* filter close */
+    pd = self->userdata;
 
-  //actually do the filter
+    optstr_filter_desc(options, MOD_NAME, MOD_CAP, MOD_VERSION,
+                       MOD_AUTHOR, "VYMOE", "2");
 
-  if(((ptr->tag & TC_PRE_M_PROCESS  && mfd[instance]->pre) ||
-	  (ptr->tag & TC_POST_M_PROCESS && !mfd[instance]->pre)) &&
-	  !(ptr->attributes & TC_FRAME_IS_SKIPPED)) {
+    tc_snprintf(buf, sizeof(buf), "%f", PARAM1_DEFAULT);
+    optstr_param(options, "luma", "spatial luma strength",
+                 "%f", buf, "0.0", "100.0");
 
-      ac_memcpy (buffer[instance], ptr->video_buf, ptr->video_size);
+    tc_snprintf(buf, sizeof(buf), "%f", PARAM2_DEFAULT);
+    optstr_param(options, "chroma", "spatial chroma strength",
+                 "%f", buf, "0.0", "100.0");
 
-      deNoise(buffer[instance],                                  ptr->video_buf,
-	      mfd[instance]->Line, &mfd[instance]->Frame[0], ptr->v_width, ptr->v_height,
-	      ptr->v_width,  ptr->v_width,
-	      mfd[instance]->Coefs[0], mfd[instance]->Coefs[0], mfd[instance]->Coefs[1]);
+    tc_snprintf(buf, sizeof(buf), "%f", PARAM3_DEFAULT);
+    optstr_param(options, "luma_strength", "temporal luma strength",
+                 "%f", buf, "0.0", "100.0");
 
-      deNoise(buffer[instance] + ptr->v_width*ptr->v_height,     ptr->video_buf + ptr->v_width*ptr->v_height,
-	      mfd[instance]->Line, &mfd[instance]->Frame[1], ptr->v_width>>1, ptr->v_height>>1,
-	      ptr->v_width>>1,  ptr->v_width>>1,
-	      mfd[instance]->Coefs[2], mfd[instance]->Coefs[2], mfd[instance]->Coefs[3]);
+    tc_snprintf(buf, sizeof(buf), "%f",
+                PARAM3_DEFAULT*PARAM2_DEFAULT/PARAM1_DEFAULT);
+    optstr_param(options, "chroma_strength", "temporal chroma strength",
+                 "%f", buf, "0.0", "100.0");
 
-      deNoise(buffer[instance] + 5*ptr->v_width*ptr->v_height/4, ptr->video_buf + 5*ptr->v_width*ptr->v_height/4,
-	      mfd[instance]->Line, &mfd[instance]->Frame[2], ptr->v_width>>1, ptr->v_height>>1,
-	      ptr->v_width>>1,  ptr->v_width>>1,
-	      mfd[instance]->Coefs[2], mfd[instance]->Coefs[2], mfd[instance]->Coefs[3]);
+    tc_snprintf(buf, sizeof(buf), "%d", pd->pre);
+    optstr_param(options, "pre", "run as a pre filter",
+                 "%d", buf, "0", "1");
 
-  }
-  return 0;
+    tc_snprintf(buf, sizeof(buf), "%d", pd->threads);
+    optstr_param(options, "threads", "bands filtered in parallel",
+                 "%d", buf, "1", "16");
 
+    return TC_OK;
 }
 
+static int hqdn3d_process(TCModuleInstance *self, frame_list_t *frame)
+{
+    Hqdn3dPrivateData *pd = NULL;
 
-//===========================================================================//
+    TC_MODULE_SELF_CHECK(self, "process");
+
+    pd = self->userdata;
+
+    if ((frame->tag & TC_VIDEO) && !(frame->attributes & TC_FRAME_IS_SKIPPED)
+       && (((frame->tag & TC_PRE_M_PROCESS) && pd->pre)
+         || ((frame->tag & TC_POST_M_PROCESS) && !pd->pre))) {
+        return hqdn3d_filter_video(self, (vframe_list_t*)frame);
+    }
+    return TC_OK;
+}
+
+/*************************************************************************/
+
+/* Old-fashioned module interface. */
+
+TC_FILTER_OLDINTERFACE_M(hqdn3d)
+
+/*************************************************************************/
+
+/*
+ * Local variables:
+ *   c-file-style: "stroustrup"
+ *   c-file-offsets: ((case-label . *) (statement-case-intro . *))
+ *   indent-tabs-mode: nil
+ * End:
+ *
+ * vim: expandtab shiftwidth=4:
+ */
@@ -32,7 +32,7 @@
  
 
 #define MOD_NAME    "filter_logoaway.so"
-#define MOD_VERSION "v0.6.0 (2009-02-24)"
+#define MOD_VERSION "v0.6.1 (2026-10-18)"
 #define MOD_CAP     "remove an image from the video"
 #define MOD_AUTHOR  "Thomas Wehrspann"
 
@@ -48,6 +48,7 @@
 #include "libtcvideo/tcvideo.h"
 #include "libtcext/tc_magick.h"
 #include "libtcmodule/tcmodule-plugin.h"
+#include "aclib/ac.h"
 
 
 /* FIXME */
@@ -101,7 +102,8 @@ struct logoawayprivatedata_ {
 
     TCMagickContext logo_ctx;
     TCMagickContext dump_ctx;
-    PixelPacket     *pixels;
+    uint8_t         *pixels;    /* alpha/shape image as packed RGB */
+    uint8_t         *fill_row;  /* one row of the solid fill color */
 
     int             dump;
     uint8_t         *dump_buf;
@@ -113,6 +115,10 @@ struct logoawayprivatedata_ {
 };
 
 
+/* Channel `ch' of the alpha/shape image at pixel offset `off' */
+#define LOGO_PIXEL(pd, off, ch) ((pd)->pixels[(off)*3 + (ch)])
+
+
 /*********************************************************
  * blend two pixel
  * this function blends two pixel with the given
@@ -227,23 +233,25 @@ static int process_frame_rgb_solid(LogoAwayPrivateData *pd,
         dump_image_rgb(pd, buffer, width, height);
     }
 
-    for (row = pd->ypos; row < pd->height; row++) {
-        for (col = pd->xpos; col < pd->width; col++) {
-            buf_off = ((height-row)*width+col) * 3;
-            pkt_off = (row-pd->ypos) * (pd->width-pd->xpos) + (col-pd->xpos);
-            /* R */
-            if (!pd->alpha) {
-                buffer[buf_off +0] = pd->rcolor;
-                buffer[buf_off +1] = pd->gcolor;
-                buffer[buf_off +2] = pd->bcolor;
-            } else {
-                px = (uint8_t)ScaleQuantumToChar(pd->pixels[pkt_off].red);
+    if (!pd->alpha) {
+        for (row = pd->ypos; row < pd->height; row++) {
+            buf_off = ((height-row)*width+pd->xpos) * 3;
+            ac_memcpy(buffer + buf_off, pd->fill_row,
+                      (pd->width-pd->xpos) * 3);
+        }
+    } else {
+        for (row = pd->ypos; row < pd->height; row++) {
+            for (col = pd->xpos; col < pd->width; col++) {
+                buf_off = ((height-row)*width+col) * 3;
+                pkt_off = (row-pd->ypos) * (pd->width-pd->xpos) + (col-pd->xpos);
+                /* R */
+                px = LOGO_PIXEL(pd, pkt_off, 0);
                 buffer[buf_off +0] = alpha_blending(buffer[buf_off +0], pd->rcolor, px);
                 /* G */
-                px = (uint8_t)ScaleQuantumToChar(pd->pixels[pkt_off].green);
+                px = LOGO_PIXEL(pd, pkt_off, 1);
                 buffer[buf_off +1] = alpha_blending(buffer[buf_off +1], pd->gcolor, px);
                 /* B */
-                px = (uint8_t)ScaleQuantumToChar(pd->pixels[pkt_off].blue);
+                px = LOGO_PIXEL(pd, pkt_off, 2);
                 buffer[buf_off +2] = alpha_blending(buffer[buf_off +2], pd->bcolor, px);
             }
         }
@@ -306,9 +314,9 @@ static int process_frame_rgb_xy(LogoAwayPrivateData *pd,
                 buffer[buf_off +1] = npx[1];
                 buffer[buf_off +2] = npx[2];
             } else {
-                px[0] = (uint8_t)ScaleQuantumToChar(pd->pixels[pkt_off].red);
-                px[1] = (uint8_t)ScaleQuantumToChar(pd->pixels[pkt_off].green);
-                px[2] = (uint8_t)ScaleQuantumToChar(pd->pixels[pkt_off].blue);
+                px[0] = LOGO_PIXEL(pd, pkt_off, 0);
+                px[1] = LOGO_PIXEL(pd, pkt_off, 1);
+                px[2] = LOGO_PIXEL(pd, pkt_off, 2);
                 buffer[buf_off +0] = alpha_blending(buffer[buf_off +0], npx[0], px[0]);
                 buffer[buf_off +1] = alpha_blending(buffer[buf_off +1], npx[1], px[1]);
                 buffer[buf_off +2] = alpha_blending(buffer[buf_off +2], npx[2], px[2]);
@@ -357,23 +365,23 @@ static int process_frame_rgb_shape(LogoAwayPrivateData *pd,
             buf_off_ypos = ((height-pd->ypos)*width+col) * 3;
             buf_off_height = ((height-pd->height)*width+col) * 3;
 
-            tmpx = (uint8_t)ScaleQuantumToChar(pd->pixels[pkt_off-i].red);
+            tmpx = LOGO_PIXEL(pd, pkt_off-i, 0);
             i = 0;
             while ((tmpx != 255) && (col-i > pd->xpos))
                 i++;
             buf_off_xpos   = ((height-row)*width + col-i) * 3;
-            tmpx = (uint8_t)ScaleQuantumToChar(pd->pixels[pkt_off+i].red);
+            tmpx = LOGO_PIXEL(pd, pkt_off+i, 0);
             i = 0;
             while ((tmpx != 255) && (col + i < pd->width))
                 i++;
             buf_off_width  = ((height-row)*width + col+i) * 3;
 
-            tmpx = (uint8_t)ScaleQuantumToChar(pd->pixels[pkt_off-i*(pd->width-pd->xpos)].red);
+            tmpx = LOGO_PIXEL(pd, pkt_off-i*(pd->width-pd->xpos), 0);
             i = 0;
             while ((tmpx != 255) && (row - i > pd->ypos))
                 i++;
             buf_off_ypos   = (height*width*3)-((row-i)*width - col) * 3;
-            tmpx = (uint8_t)ScaleQuantumToChar(pd->pixels[pkt_off+i*(pd->width-pd->xpos)].red);
+            tmpx = LOGO_PIXEL(pd, pkt_off+i*(pd->width-pd->xpos), 0);
             i = 0;
             while ((tmpx != 255) && (row + i < pd->height))
                 i++;
@@ -383,17 +391,17 @@ static int process_frame_rgb_shape(LogoAwayPrivateData *pd,
             hcalc  = alpha_blending(buffer[buf_off_xpos +0], buffer[buf_off_width  +0], alpha_hori);
             vcalc  = alpha_blending(buffer[buf_off_ypos +0], buffer[buf_off_height +0], alpha_vert);
             npx[0] = (hcalc*pd->xweight + vcalc*pd->yweight)/100;
-            px[0]  = (uint8_t)ScaleQuantumToChar(pd->pixels[pkt_off].red);
+            px[0]  = LOGO_PIXEL(pd, pkt_off, 0);
             /* G */
             hcalc = alpha_blending(buffer[buf_off_xpos +1], buffer[buf_off_width  +1], alpha_hori);
             vcalc = alpha_blending(buffer[buf_off_ypos +1], buffer[buf_off_height +1], alpha_vert);
             npx[1] = (hcalc*pd->xweight + vcalc*pd->yweight)/100;
-            px[1] = (uint8_t)ScaleQuantumToChar(pd->pixels[pkt_off].green);
+            px[1] = LOGO_PIXEL(pd, pkt_off, 1);
             /* B */
             hcalc = alpha_blending(buffer[buf_off_xpos +2], buffer[buf_off_width  +2], alpha_hori);
             vcalc = alpha_blending(buffer[buf_off_ypos +2], buffer[buf_off_height +2], alpha_vert);
             npx[2] = (hcalc*pd->xweight + vcalc*pd->yweight)/100;
-            px[2] = (uint8_t)ScaleQuantumToChar(pd->pixels[pkt_off].blue);
+            px[2] = LOGO_PIXEL(pd, pkt_off, 2);
 
             buffer[buf_off +0] = alpha_blending(buffer[buf_off +0], npx[0], px[0]);
             buffer[buf_off +0] = alpha_blending(buffer[buf_off +0], npx[1], px[1]);
@@ -416,33 +424,39 @@ static int process_frame_yuv_solid(LogoAwayPrivateData *pd,
     craddr = (width * height);
     cbaddr = (width * height) * 5 / 4;
 
-    /* Y */
-    for (row = pd->ypos; row < pd->height; row++) {
-        for (col = pd->xpos; col < pd->width; col++) {
-
-            buf_off = row * width + col;
-            pkt_off = (row - pd->ypos) * (pd->width - pd->xpos) + (col - pd->xpos);
-            if (!pd->alpha) {
-                buffer[buf_off] = pd->ycolor;
-            } else {
-                px = (uint8_t)ScaleQuantumToChar(pd->pixels[pkt_off].red);
+    if (!pd->alpha) {
+        /* Y */
+        for (row = pd->ypos; row < pd->height; row++) {
+            memset(buffer + row * width + pd->xpos, pd->ycolor,
+                   pd->width - pd->xpos);
+        }
+        /* Cb, Cr */
+        for (row = pd->ypos/2+1; row < pd->height/2; row++) {
+            buf_off = row * width/2 + pd->xpos/2+1;
+            if (pd->width/2 > pd->xpos/2+1) {
+                memset(buffer + craddr + buf_off, pd->ucolor,
+                       pd->width/2 - (pd->xpos/2+1));
+                memset(buffer + cbaddr + buf_off, pd->vcolor,
+                       pd->width/2 - (pd->xpos/2+1));
+            }
+        }
+    } else {
+        /* Y */
+        for (row = pd->ypos; row < pd->height; row++) {
+            for (col = pd->xpos; col < pd->width; col++) {
+                buf_off = row * width + col;
+                pkt_off = (row - pd->ypos) * (pd->width - pd->xpos) + (col - pd->xpos);
+                px = LOGO_PIXEL(pd, pkt_off, 0);
                 buffer[buf_off] = alpha_blending(buffer[buf_off], pd->ycolor, px);
             }
         }
-    }
-
-    /* Cb, Cr */
-    for(row = pd->ypos/2+1; row < pd->height/2; row++) {
-        for(col = pd->xpos/2+1; col < pd->width/2; col++) {
-            buf_off = row * width/2 + col;
-            pkt_off = (row * 2 - pd->ypos) * (pd->width - pd->xpos) + (col * 2 - pd->xpos);
-
-            if (!pd->alpha) {
-                buffer[craddr + buf_off] = pd->ucolor;
-                buffer[cbaddr + buf_off] = pd->vcolor;
-            } else {
+        /* Cb, Cr */
+        for (row = pd->ypos/2+1; row < pd->height/2; row++) {
+            for (col = pd->xpos/2+1; col < pd->width/2; col++) {
+                buf_off = row * width/2 + col;
+                pkt_off = (row * 2 - pd->ypos) * (pd->width - pd->xpos) + (col * 2 - pd->xpos);
                 /* sic */
-                px = (uint8_t)ScaleQuantumToChar(pd->pixels[pkt_off].red);
+                px = LOGO_PIXEL(pd, pkt_off, 0);
                 buffer[craddr + buf_off] = alpha_blending(buffer[craddr + buf_off], pd->ucolor, px);
                 buffer[cbaddr + buf_off] = alpha_blending(buffer[cbaddr + buf_off], pd->vcolor, px);
             }
@@ -497,7 +511,7 @@ static int process_frame_yuv_xy(LogoAwayPrivateData *pd,
           if (!pd->alpha) {
             buffer[buf_off] = npx;
           } else {
-            px = (uint8_t)ScaleQuantumToChar(pd->pixels[pkt_off].red);
+            px = LOGO_PIXEL(pd, pkt_off, 0);
             buffer[buf_off] = alpha_blending(buffer[buf_off], npx, px);
           }
         }
@@ -537,7 +551,7 @@ static int process_frame_yuv_xy(LogoAwayPrivateData *pd,
             buffer[craddr + buf_off] = npx[0];
             buffer[cbaddr + buf_off] = npx[1];
           } else {
-            px = (uint8_t)ScaleQuantumToChar(pd->pixels[pkt_off].red); /* sic */
+            px = LOGO_PIXEL(pd, pkt_off, 0); /* sic */
             buffer[craddr + buf_off] = alpha_blending(buffer[craddr + buf_off], npx[0], px);
             buffer[craddr + buf_off] = alpha_blending(buffer[craddr + buf_off], npx[1], px);
           }
@@ -580,26 +594,26 @@ static int process_frame_yuv_shape(LogoAwayPrivateData *pd,
           pkt_off = (row-pd->ypos) * (pd->width-pd->xpos) + (col-pd->xpos);
 
           i=0;
-          px = (uint8_t)ScaleQuantumToChar(pd->pixels[pkt_off-i].red);
+          px = LOGO_PIXEL(pd, pkt_off-i, 0);
           while( (px != 255) && (col-i>pd->xpos) ) i++;
           buf_off_xpos   = (row*width + col-i);
           i=0;
-          px = (uint8_t)ScaleQuantumToChar(pd->pixels[pkt_off+i].red);
+          px = LOGO_PIXEL(pd, pkt_off+i, 0);
           while( (px != 255) && (col+i<pd->width) ) i++;
           buf_off_width  = (row*width + col+i);
 
           i=0;
-          px = (uint8_t)ScaleQuantumToChar(pd->pixels[pkt_off-i*(pd->width-pd->xpos)].red);
+          px = LOGO_PIXEL(pd, pkt_off-i*(pd->width-pd->xpos), 0);
           while( (px != 255) && (row-i>pd->ypos) ) i++;
           buf_off_ypos   = ((row-i)*width + col);
           i=0;
-          px = (uint8_t)ScaleQuantumToChar(pd->pixels[pkt_off+i*(pd->width-pd->xpos)].red);
+          px = LOGO_PIXEL(pd, pkt_off+i*(pd->width-pd->xpos), 0);
           while( (px != 255) && (row+i<pd->height) ) i++;
           buf_off_height = ((row+i)*width + col);
 
           hcalc  = alpha_blending( buffer[buf_off_xpos], buffer[buf_off_width],  alpha_hori );
           vcalc  = alpha_blending( buffer[buf_off_ypos], buffer[buf_off_height], alpha_vert );
-          px     = (uint8_t)ScaleQuantumToChar(pd->pixels[pkt_off].red);
+          px     = LOGO_PIXEL(pd, pkt_off, 0);
           npx[0] = ((hcalc*pd->xweight + vcalc*pd->yweight)/100); /* FIXME */
           buffer[buf_off] = alpha_blending(buffer[buf_off], npx[0], px);
         }
@@ -619,20 +633,20 @@ static int process_frame_yuv_shape(LogoAwayPrivateData *pd,
           alpha_hori = xdistance * distance_west;
 
           i=0;
-          px = (uint8_t)ScaleQuantumToChar(pd->pixels[pkt_off-i].red);
+          px = LOGO_PIXEL(pd, pkt_off-i, 0);
           while( (px != 255) && (col-i>pd->xpos) ) i++;
           buf_off_xpos   = (row*width/2 + col-i);
           i=0;
-          px = (uint8_t)ScaleQuantumToChar(pd->pixels[pkt_off+i].red);
+          px = LOGO_PIXEL(pd, pkt_off+i, 0);
           while( (px != 255) && (col+i<pd->width) ) i++;
           buf_off_width  = (row*width/2 + col+i);
 
           i=0;
-          px = (uint8_t)ScaleQuantumToChar(pd->pixels[pkt_off-i*(pd->width-pd->xpos)].red);
+          px = LOGO_PIXEL(pd, pkt_off-i*(pd->width-pd->xpos), 0);
           while( (px != 255) && (row-i>pd->ypos) ) i++;
           buf_off_ypos   = ((row-i)*width/2 + col);
           i=0;
-          px = (uint8_t)ScaleQuantumToChar(pd->pixels[pkt_off+i*(pd->width-pd->xpos)].red);
+          px = LOGO_PIXEL(pd, pkt_off+i*(pd->width-pd->xpos), 0);
           while( (px != 255) && (row+i<pd->height) ) i++;
           buf_off_height = ((row+i)*width/2 + col);
 
@@ -642,7 +656,7 @@ static int process_frame_yuv_shape(LogoAwayPrivateData *pd,
 
           pkt_off = (row*2-pd->ypos) * (pd->width-pd->xpos) + (col*2-pd->xpos);
 
-          px     = (uint8_t)ScaleQuantumToChar(pd->pixels[pkt_off].red);
+          px     = LOGO_PIXEL(pd, pkt_off, 0);
           /* sic */
           hcalc  = alpha_blending(buffer[craddr + buf_off_xpos], buffer[craddr + buf_off_width],  alpha_hori);
           vcalc  = alpha_blending(buffer[craddr + buf_off_ypos], buffer[craddr + buf_off_height], alpha_vert);
@@ -673,8 +687,48 @@ static void free_dump_buf(LogoAwayPrivateData *pd)
     }   
 }
 
+static void free_logo_buf(LogoAwayPrivateData *pd)
+{
+    tc_free(pd->pixels);
+    pd->pixels = NULL;
+    tc_free(pd->fill_row);
+    pd->fill_row = NULL;
+}
+
+/* The frame loops only need the alpha/shape bytes, and a row of the
+ * fill color to copy: get them ready once. */
+
+static int logoaway_setup_buffers(LogoAwayPrivateData *pd,
+                                  const PixelPacket *pixels)
+{
+    int size = (pd->width-pd->xpos) * (pd->height-pd->ypos), i;
+
+    pd->fill_row = tc_malloc((pd->width-pd->xpos) * 3 + 1);
+    if (pixels) {
+        pd->pixels = tc_malloc(size * 3);
+    }
+    if (!pd->fill_row || (pixels && !pd->pixels)) {
+        tc_log_error(MOD_NAME, "out of memory");
+        free_logo_buf(pd);
+        return TC_ERROR;
+    }
+    for (i = 0; i < pd->width-pd->xpos; i++) {
+        pd->fill_row[i*3 +0] = pd->rcolor;
+        pd->fill_row[i*3 +1] = pd->gcolor;
+        pd->fill_row[i*3 +2] = pd->bcolor;
+    }
+    for (i = 0; pixels && i < size; i++) {
+        pd->pixels[i*3 +0] = (uint8_t)ScaleQuantumToChar(pixels[i].red);
+        pd->pixels[i*3 +1] = (uint8_t)ScaleQuantumToChar(pixels[i].green);
+        pd->pixels[i*3 +2] = (uint8_t)ScaleQuantumToChar(pixels[i].blue);
+    }
+    return TC_OK;
+}
+
 static int logoaway_setup(LogoAwayPrivateData *pd, vob_t *vob)
 {
+    PixelPacket *pixels = NULL;
+
     if (pd->dump) {
         pd->dump_buf = tc_malloc((pd->width-pd->xpos)*(pd->height-pd->ypos)*3);
         /* FIXME */
@@ -704,9 +758,13 @@ static int logoaway_setup(LogoAwayPrivateData *pd, vob_t *vob)
             return TC_ERROR;
         }
 
-        pd->pixels = GetImagePixels(pd->logo_ctx.image, 0, 0,
-                                    pd->logo_ctx.image->columns,
-                                    pd->logo_ctx.image->rows);
+        pixels = GetImagePixels(pd->logo_ctx.image, 0, 0,
+                                pd->logo_ctx.image->columns,
+                                pd->logo_ctx.image->rows);
+    }
+    if (logoaway_setup_buffers(pd, pixels) != TC_OK) {
+        free_dump_buf(pd);
+        return TC_ERROR;
     }
 
     /* FIXME: this can be improved. What about a LUT? */
@@ -903,6 +961,7 @@ static int logoaway_stop(TCModuleInstance *self)
     tc_magick_fini(&pd->dump_ctx);
 
     free_dump_buf(pd);
+    free_logo_buf(pd);
     return TC_OK;
 }
 
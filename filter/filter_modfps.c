@@ -24,6 +24,9 @@
  */
 
 // ----------------- Changes
+// 0.10 -> 0.11:
+//		hold references on the buffered frames and show them again
+//		instead of copying them in and out of private buffers
 // 0.9 -> 0.10: marrq
 //		added scene change detection code courtesy of Tilmann Bitterberg
 //		so we won't blend if there's a change of scene (we'll still interpolate)
@@ -49,7 +52,7 @@
 //             Fix a bug related to scanrange.
 
 #define MOD_NAME    "filter_modfps.so"
-#define MOD_VERSION "v0.10 (2003-08-18)"
+#define MOD_VERSION "v0.11 (2026-10-18)"
 #define MOD_CAP     "plugin to modify framerate"
 #define MOD_AUTHOR  "Marrq"
 
@@ -81,7 +84,7 @@ static int numSample=5;
 static int offset = 32;
 static int runnow = 0;
 
-static char **frames = NULL;
+static TCFramePayload **frames = NULL;
 static int frbufsize;
 static int frameIn = 0, frameOut = 0;
 static int *framesOK, *framesScore;
@@ -373,7 +376,6 @@ static void fancy_clone(char* clone, char* next, vframe_list_t *ptr, int tin, in
 
 static int memory_init(vframe_list_t * ptr){
 
-  int i;
   frbufsize = numSample +1;
   if (ptr->v_codec == TC_CODEC_YUV420P){
     // we only care about luminance
@@ -393,18 +395,13 @@ static int memory_init(vframe_list_t * ptr){
     return -1;
   }
 
-  frames = tc_malloc(sizeof (char*)*frbufsize);
+  // the slots hold references on the frames themselves, taken
+  // as they come in; see tc_hold_video_frame()
+  frames = tc_zalloc(sizeof (TCFramePayload*)*frbufsize);
   if (NULL == frames){
     tc_log_error(MOD_NAME, "Error allocating memory in init");
     return -1;
   } // else
-  for (i=0;i<frbufsize; i++){
-    frames[i] = tc_malloc(sizeof(char)*ptr->video_size);
-    if (NULL == frames[i]){
-      tc_log_error(MOD_NAME, "Error allocating memory in init");
-      return -1;
-    }
-  }
   framesOK = tc_malloc(sizeof(int)*frbufsize);
   if (NULL == framesOK){
     tc_log_error(MOD_NAME, "Error allocating memory in init");
@@ -499,7 +496,7 @@ int tc_filter(frame_list_t *ptr_, char *options)
 
     if (ptr->tag & TC_FILTER_GET_CONFIG){
       char buf[255];
-      optstr_filter_desc (options, MOD_NAME, MOD_CAP, MOD_VERSION, MOD_AUTHOR, "VYRE", "1");
+      optstr_filter_desc (options, MOD_NAME, MOD_CAP, MOD_VERSION, MOD_AUTHOR, "VYRES", "1");
 
       tc_snprintf(buf, sizeof(buf), "%d",mode);
       optstr_param(options,"mode","mode of operation", "%d", buf, "0", "1");
@@ -526,7 +523,14 @@ int tc_filter(frame_list_t *ptr_, char *options)
 
 
     if (ptr->tag & TC_FILTER_CLOSE) {
-
+	if (frames != NULL){
+	  int i;
+	  for (i=0; i<frbufsize; i++){
+	    tc_release_payload(frames[i]);
+	  }
+	  tc_free(frames);
+	  frames = NULL;
+	}
 	return (0);
     }
     //----------------------------------
@@ -579,6 +583,7 @@ int tc_filter(frame_list_t *ptr_, char *options)
 	return(0);
       } // else
       if (mode == 1){
+        TCFramePayload *clone, *next;
         int i;
 	if (init){
 	  init = 0;
@@ -606,10 +611,26 @@ int tc_filter(frame_list_t *ptr_, char *options)
 	  if (show_results){
 	    tc_log_info(MOD_NAME, "no slot needed for clones");
 	  }
-	  fancy_clone(frames[frameIn],frames[(frameIn+1)%frbufsize],ptr,framesin-numSample,outframes+cloneq+1);
+	  clone = frames[frameIn];
+	  next = frames[(frameIn+1)%frbufsize];
+	  if (clone == NULL || next == NULL){
+	    tc_log_warn(MOD_NAME, "nothing buffered to clone from yet");
+	  } else if (clonetype == 0){
+	    // a plain clone is just the same picture again
+	    tc_share_video_frame(ptr, clone);
+	  } else {
+	    tc_unshare_video_frame(ptr);
+	    fancy_clone((char *)clone->data, (char *)next->data,
+	                ptr,framesin-numSample,outframes+cloneq+1);
+	  }
 	  return 0;
 	} // else
-	ac_memcpy(frames[frameIn], ptr->video_buf, ptr->video_size);
+	tc_release_payload(frames[frameIn]);
+	frames[frameIn] = tc_hold_video_frame(ptr);
+	if (frames[frameIn] == NULL){
+	  tc_log_error(MOD_NAME, "Error allocating memory for frame %d", framesin);
+	  return -1;
+	}
 	framesOK[frameIn] = 1;
 #ifdef DEBUG
 	tc_log_info(MOD_NAME, "Inserted frame %d into slot %d",framesin, frameIn);
@@ -622,8 +643,8 @@ int tc_filter(frame_list_t *ptr_, char *options)
 	  int *score,t;
 	  t=(frameIn+numSample)%frbufsize;
 	  score = &framesScore[t];
-	  t1 = frames[t];
-	  t2 = frames[frameIn];
+	  t1 = (char *)frames[t]->data;
+	  t2 = (char *)frames[frameIn]->data;
 #ifdef DEBUG
 	    tc_log_info(MOD_NAME, "score: slot=%d, t1=%p t2=%p ",
 	      t,t1,t2);
@@ -684,7 +705,7 @@ int tc_filter(frame_list_t *ptr_, char *options)
 	    ++cloneq;
 	    framesOK[mod] = 0;
 	  }
-	  ac_memcpy(ptr->video_buf,frames[frameOut],ptr->video_size);
+	  tc_share_video_frame(ptr, frames[frameOut]);
 	  if (framesOK[frameOut]){
 	    if (show_results){
 	      tc_log_info(MOD_NAME, "giving   slot %2d frame %6d",frameOut,ptr->id);
@@ -724,7 +745,7 @@ int tc_filter(frame_list_t *ptr_, char *options)
 	    ++outframes;
 	  }
 	  if (framesOK[frameOut]){
-	    ac_memcpy(ptr->video_buf,frames[frameOut],ptr->video_size);
+	    tc_share_video_frame(ptr, frames[frameOut]);
 	    if (show_results){
 	      tc_log_info(MOD_NAME, "giving   slot %2d frame %6d",frameOut,ptr->id);
 	    }
@@ -28,7 +28,7 @@
  */
 
 #define MOD_NAME    "filter_msharpen.so"
-#define MOD_VERSION "(1.1.1) (2009-02-07)"
+#define MOD_VERSION "(1.2.0) (2026-10-18)"
 #define MOD_CAP     "VirtualDub's MSharpen Filter"
 #define MOD_AUTHOR  "Donald Graft, William Hawkins"
 
@@ -42,6 +42,7 @@
 #include "src/filter.h"
 #include "libtc/libtc.h"
 #include "libtcutil/optstr.h"
+#include "libtcutil/tcthread.h"
 #include "libtcmodule/tcmodule-plugin.h"
 #include "libtcvideo/tcvideo.h"
 
@@ -56,6 +57,7 @@ typedef struct MsharpenPrivateData {
     int            threshold;
     int            mask;
     int            highq;
+    int            threads;
     TCVHandle      tcvhandle;
     ImageFormat    out_fmt;
     char           conf_str[TC_BUF_MIN]; 
@@ -89,7 +91,10 @@ static const char msharpen_help[] = ""
     "  * HighQ 'highq' (0-1) [1]\n"
     "    This parameter lets you tradeoff speed for quality of detail\n"
     "    detection. Set it to true for the best detail detection. Set it to\n"
-    "    false for maximum speed.\n";
+    "    false for maximum speed.\n"
+    "\n"
+    "  * Threads 'threads' (1-16) [1]\n"
+    "    Process the frame in that many bands of rows in parallel.\n";
 
 /*************************************************************************/
 
@@ -133,6 +138,7 @@ static int msharpen_configure(TCModuleInstance *self,
     pd->threshold = 10;
     pd->mask      = TC_FALSE; /* not sure what this does at the moment */
     pd->highq     = TC_TRUE; /* high Q or not? */
+    pd->threads   = 1;
     pd->out_fmt   = (vob->im_v_codec == TC_CODEC_YUV420P)
                         ?IMG_YUV_DEFAULT :IMG_RGB24;
 
@@ -141,7 +147,9 @@ static int msharpen_configure(TCModuleInstance *self,
         optstr_get(options, "threshold", "%d", &pd->threshold);
         optstr_get(options, "highq",     "%d", &pd->highq);
         optstr_get(options, "mask",      "%d", &pd->mask);
+        optstr_get(options, "threads",   "%d", &pd->threads);
     }
+    pd->threads = TC_CLAMP(pd->threads, 1, TC_THREAD_MAX_BANDS);
 
     if (verbose) {
         tc_log_info(MOD_NAME, "strength=%i threshold=%i (masking %s|highq %s)",
@@ -252,6 +260,7 @@ static int msharpen_inspect(TCModuleInstance *self,
     INSPECT_PARAM(threshold, "%i");
     INSPECT_PARAM(highq,     "%i");
     INSPECT_PARAM(mask,      "%i");
+    INSPECT_PARAM(threads,   "%i");
 
     return TC_OK;
 }
@@ -261,143 +270,115 @@ static int msharpen_inspect(TCModuleInstance *self,
 /*************************************************************************/
 
 
-static int msharpen_filter_video(TCModuleInstance *self,
-                                 vframe_list_t *frame)
-{
-    const int  width  = frame->v_width;
-    const int  height = frame->v_height;
-    const long pitch = frame->v_width * 4;
-    int        bwidth = 4 * width;
-    uint8_t *src = NULL;
-    uint8_t *dst = NULL;
-    uint8_t *srcpp, *srcp, *srcpn, *workp, *blurp, *blurpn, *dstp;
-    int r1, r2, r3, r4, g1, g2, g3, g4, b1, b2, b3, b4;
-    int x, y, max, strength, invstrength, threshold;
-    const int dstpitch = frame->v_width * 4;
-
-    // MsharpenPrivateData *pd = NULL; /* yes, I'm (too) lazy */
-    MsharpenPrivateData *mfd = NULL;
-
-    TC_MODULE_SELF_CHECK(self, "filter");
-    TC_MODULE_SELF_CHECK(frame, "filter");
-
-    mfd = self->userdata;
-
-    threshold   = mfd->threshold;
-    strength    = mfd->strength;
-    invstrength = 255 - strength;
-
-    tcv_convert(mfd->tcvhandle, frame->video_buf, mfd->convertFrameIn,
-                frame->v_width, frame->v_height, mfd->out_fmt, IMG_BGRA32);
+/*
+ * The frame is processed in two steps, each split in bands of rows:
+ * blurring, which only needs the rows around, then detail detection and
+ * sharpening, which need the blurred row below.
+ */
 
-    src = mfd->convertFrameIn;
-    dst = mfd->convertFrameOut;
-
-    /* Blur the source image prior to detail detection. Separate
-       dimensions for speed. */
-    /* Vertical. */
-    srcpp = src;
-    srcp  = srcpp + pitch;
-    srcpn = srcp + pitch;
-    workp = mfd->work + bwidth;
-    for (y = 1; y < height - 1; y++) {
-        for (x = 0; x < bwidth; x++) {
-            workp[x] = (srcpp[x] + srcp[x] + srcpn[x]) / 3;
-        }
-        srcpp += pitch;
-        srcp  += pitch;
-        srcpn += pitch;
-        workp += bwidth;
-    }
+typedef struct msharpenframe_ MsharpenFrame;
+struct msharpenframe_ {
+    MsharpenPrivateData *pd;
+    const uint8_t       *src;
+    uint8_t             *dst;
+    int                 width;
+    int                 height;
+};
 
-    /* Horizontal. */
-    workp  = mfd->work;
-    blurp  = mfd->blur;
-    for (y = 0; y < height; y++) {
-        for (x = 4; x < bwidth - 4; x++) {
-            blurp[x] = (workp[x-4] + workp[x] + workp[x+4]) / 3;
+/* Blur the source image prior to detail detection. Separate dimensions
+   for speed; the borders are taken from the source. */
+static void msharpen_blur_rows(void *datum, int band, int first, int last)
+{
+    const MsharpenFrame *fr = datum;
+    const int bwidth = 4 * fr->width;
+    const uint8_t *rows[3];
+    int y;
+
+    for (y = first; y < last; y++) {
+        const uint8_t *srcp = fr->src + y*bwidth;
+        uint8_t *workp = fr->pd->work + y*bwidth;
+        uint8_t *blurp = fr->pd->blur + y*bwidth;
+
+        if (y == 0 || y == fr->height - 1) {
+            ac_memcpy(blurp, srcp, bwidth);
+            continue;
         }
-        workp += bwidth;
-        blurp += bwidth;
-    }
+        /* Vertical. */
+        rows[0] = srcp - bwidth;
+        rows[1] = srcp;
+        rows[2] = srcp + bwidth;
+        ac_rows_mean(rows, 3, workp, bwidth);
+        /* Horizontal. */
+        ac_box_mean(workp, 3, 4, blurp + 4, bwidth - 8);
 
-    /* Fix up blur frame borders. */
-    srcp  = src;
-    blurp = mfd->blur;
-    ac_memcpy(blurp, srcp, bwidth);
-    ac_memcpy(blurp + (height-1)*bwidth, srcp + (height-1)*pitch, bwidth);
-    for (y = 0; y < height; y++) {
         *((unsigned int *)(&blurp[0])) = *((unsigned int *)(&srcp[0]));
         *((unsigned int *)(&blurp[bwidth-4])) = *((unsigned int *)(&srcp[bwidth-4]));
-        srcp  += pitch;
-        blurp += bwidth;
     }
+}
 
-    /* Diagonal detail detection. */
-    blurp  = mfd->blur;
-    blurpn = blurp + bwidth;
-    workp  = mfd->work;
-    for (y = 0; y < height - 1; y++) {
-        b1 = blurp[0];
-        g1 = blurp[1];
-        r1 = blurp[2];
-        b3 = blurpn[0];
-        g3 = blurpn[1];
-        r3 = blurpn[2];
-        for (x = 0; x < bwidth - 4; x+=4) {
-            b2 = blurp[x+4];
-            g2 = blurp[x+5];
-            r2 = blurp[x+6];
-            b4 = blurpn[x+4];
-            g4 = blurpn[x+5];
-            r4 = blurpn[x+6];
-            if ((abs(b1 - b4) >= threshold) || (abs(g1 - g4) >= threshold) || (abs(r1 - r4) >= threshold) 
-             || (abs(b2 - b3) >= threshold) || (abs(g2 - g3) >= threshold) || (abs(g2 - g3) >= threshold)) {
-                *((unsigned int *)(&workp[x])) = 0xffffffff;
-            } else {
-                *((unsigned int *)(&workp[x])) = 0x0;
-            }
-            b1 = b2;
-            b3 = b4;
-            g1 = g2;
-            g3 = g4;
-            r1 = r2;
-            r3 = r4;
-        }
-        workp  += bwidth;
-        blurp  += bwidth;
-        blurpn += bwidth;
-    }
+static void msharpen_sharpen_rows(void *datum, int band, int first, int last)
+{
+    const MsharpenFrame *fr = datum;
+    const MsharpenPrivateData *mfd = fr->pd;
+    const int height = fr->height;
+    const int bwidth = 4 * fr->width;
+    const int threshold = mfd->threshold;
+    const int strength = mfd->strength, invstrength = 255 - strength;
+    const uint8_t *srcp, *blurp, *blurpn;
+    uint8_t *workp, *dstp;
+    int r1, r2, r3, r4, g1, g2, g3, g4, b1, b2, b3, b4;
+    int x, y, max;
 
-    if (mfd->highq == TC_TRUE) {
-        /* Vertical detail detection. */
-        for (x = 0; x < bwidth; x += 4) {
-            blurp  = mfd->blur;
-            blurpn = blurp + bwidth;
-            workp  = mfd->work;
-            b1 = blurp[x];
-            g1 = blurp[x+1];
-            r1 = blurp[x+2];
-            for (y = 0; y < height - 1; y++) {
-                b2 = blurpn[x];
-                g2 = blurpn[x+1];
-                r2 = blurpn[x+2];
-                if (abs(b1 - b2) >= threshold || abs(g1 - g2) >= threshold || abs(r1 - r2) >= threshold) {
+    for (y = first; y < last; y++) {
+        srcp   = fr->src + y*bwidth;
+        dstp   = fr->dst + y*bwidth;
+        workp  = mfd->work + y*bwidth;
+        blurp  = mfd->blur + y*bwidth;
+        blurpn = blurp + bwidth;
+
+        if (y < height - 1) {
+            /* Diagonal detail detection. */
+            b1 = blurp[0];
+            g1 = blurp[1];
+            r1 = blurp[2];
+            b3 = blurpn[0];
+            g3 = blurpn[1];
+            r3 = blurpn[2];
+            for (x = 0; x < bwidth - 4; x+=4) {
+                b2 = blurp[x+4];
+                g2 = blurp[x+5];
+                r2 = blurp[x+6];
+                b4 = blurpn[x+4];
+                g4 = blurpn[x+5];
+                r4 = blurpn[x+6];
+                if ((abs(b1 - b4) >= threshold) || (abs(g1 - g4) >= threshold) || (abs(r1 - r4) >= threshold) 
+                 || (abs(b2 - b3) >= threshold) || (abs(g2 - g3) >= threshold) || (abs(g2 - g3) >= threshold)) {
                     *((unsigned int *)(&workp[x])) = 0xffffffff;
+                } else {
+                    *((unsigned int *)(&workp[x])) = 0x0;
                 }
                 b1 = b2;
+                b3 = b4;
                 g1 = g2;
+                g3 = g4;
                 r1 = r2;
-                workp += bwidth;
-                blurp += bwidth;
-                blurpn += bwidth;
+                r3 = r4;
+            }
+
+            if (mfd->highq == TC_TRUE) {
+                /* Vertical detail detection. */
+                for (x = 0; x < bwidth; x += 4) {
+                    if (abs(blurp[x] - blurpn[x]) >= threshold
+                     || abs(blurp[x+1] - blurpn[x+1]) >= threshold
+                     || abs(blurp[x+2] - blurpn[x+2]) >= threshold) {
+                        *((unsigned int *)(&workp[x])) = 0xffffffff;
+                    }
+                }
             }
         }
 
-        /* Horizontal detail detection. */
-        blurp = mfd->blur;
-        workp = mfd->work;
-        for (y = 0; y < height; y++) {
+        if (mfd->highq == TC_TRUE) {
+            /* Horizontal detail detection. */
             b1 = blurp[0];
             g1 = blurp[1];
             r1 = blurp[2];
@@ -412,50 +393,27 @@ static int msharpen_filter_video(TCModuleInstance *self,
                 g1 = g2;
                 r1 = r2;
             }
-            workp += bwidth;
-            blurp += bwidth;
         }
-    }
-
-    /* Fix up detail map borders. */
-    memset(mfd->work + (height-1)*bwidth, 0, bwidth);
-    workp = mfd->work;
-    for (y = 0; y < height; y++) {
+        /* Fix up detail map borders. */
+        if (y == height - 1) {
+            memset(workp, 0, bwidth);
+        }
         *((unsigned int *)(&workp[bwidth-4])) = 0;
-        workp += bwidth;
-    }
 
-    if (mfd->mask == TC_TRUE) {
-        workp = mfd->work;
-        dstp  = dst;
-        for (y = 0; y < height; y++) {
-            for (x = 0; x < bwidth; x++) {
-                dstp[x] = workp[x];
-            }
-            workp += bwidth;
-            dstp = dstp + dstpitch;
+        if (mfd->mask == TC_TRUE) {
+            ac_memcpy(dstp, workp, bwidth);
+            continue;
         }
-        return TC_OK;
-    }
 
-    /* Fix up output frame borders. */
-    srcp = src;
-    dstp = dst;
-    ac_memcpy(dstp, srcp, bwidth);
-    ac_memcpy(dstp + (height-1)*pitch, srcp + (height-1)*pitch, bwidth);
-    for (y = 0; y < height; y++) {
+        /* Fix up output frame borders. */
+        if (y == 0 || y == height - 1) {
+            ac_memcpy(dstp, srcp, bwidth);
+            continue;
+        }
         *((unsigned int *)(&dstp[0])) = *((unsigned int *)(&srcp[0]));
         *((unsigned int *)(&dstp[bwidth-4])) = *((unsigned int *)(&srcp[bwidth-4]));
-        srcp += pitch;
-        dstp += pitch;
-    }
 
-    /* Now sharpen the edge areas and we're done! */
-    srcp = src + pitch;
-    dstp = dst + pitch;
-    workp = mfd->work + bwidth;
-    blurp = mfd->blur + bwidth;
-    for (y = 1; y < height - 1; y++) {
+        /* Now sharpen the edge areas and we're done! */
         for (x = 4; x < bwidth - 4; x+=4) {
             int xplus1 = x + 1, xplus2 = x + 2;
 
@@ -484,10 +442,34 @@ static int msharpen_filter_video(TCModuleInstance *self,
                 dstp[xplus2] = srcp[xplus2];
             }
         }
-        srcp  += pitch;
-        dstp  += pitch;
-        workp += bwidth;
-        blurp += bwidth;
+    }
+}
+
+static int msharpen_filter_video(TCModuleInstance *self,
+                                 vframe_list_t *frame)
+{
+    MsharpenPrivateData *mfd = NULL;
+    MsharpenFrame fr;
+
+    TC_MODULE_SELF_CHECK(self, "filter");
+    TC_MODULE_SELF_CHECK(frame, "filter");
+
+    mfd = self->userdata;
+
+    tcv_convert(mfd->tcvhandle, frame->video_buf, mfd->convertFrameIn,
+                frame->v_width, frame->v_height, mfd->out_fmt, IMG_BGRA32);
+
+    fr.pd     = mfd;
+    fr.src    = mfd->convertFrameIn;
+    fr.dst    = mfd->convertFrameOut;
+    fr.width  = frame->v_width;
+    fr.height = frame->v_height;
+
+    tc_thread_bands(mfd->threads, fr.height, msharpen_blur_rows, &fr);
+    tc_thread_bands(mfd->threads, fr.height, msharpen_sharpen_rows, &fr);
+
+    if (mfd->mask == TC_TRUE) {
+        return TC_OK;
     }
 
     tcv_convert(mfd->tcvhandle, mfd->convertFrameOut, frame->video_buf,
@@ -550,6 +532,9 @@ static int msharpen_get_config(TCModuleInstance *self, char *options)
         tc_snprintf(buf, sizeof(buf), "%d", pd->mask);
         optstr_param(options, "mask",  "Areas to be sharpened are shown in white",
                   "%d", buf, "0", "1");
+        tc_snprintf(buf, sizeof(buf), "%d", pd->threads);
+        optstr_param(options, "threads",  "Bands of rows processed in parallel",
+                  "%d", buf, "1", "16");
     }
     return TC_OK;
 }
@@ -28,13 +28,24 @@
  * 2: uses several samples to smooth the variations (standard weighted mean
  *    on past samples)
  *
+ * With lookahead=N the filter runs after the audio conversions instead
+ * and holds back N frames: the gain of a frame comes from the gated
+ * level of the N frames around it on either side, so no second pass is
+ * needed, and it is lowered ahead of time so that the peaks of the next
+ * N frames do not clip.  The gain changes linearly over each frame.
+ * The gating is a simplified EBU R128 one: frames below the silence
+ * level, then frames more than 10dB below the mean of the rest, do not
+ * count.  The first N frames are skipped to keep the audio in sync, and
+ * the N frames still held at the end of the stream are given out when
+ * transcode drains the filters.
+ *
  * Limitations:
  *  - only AFMT_S16_LE supported
  *
  * */
 
 #define MOD_NAME    "filter_normalize.so"
-#define MOD_VERSION "v0.1.1 (2002-06-18)"
+#define MOD_VERSION "v0.2.0 (2026-10-18)"
 #define MOD_CAP     "Volume normalizer"
 #define MOD_AUTHOR  "pl, Tilmann Bitterberg"
 
@@ -42,6 +53,7 @@
 #include "src/filter.h"
 #include "libtc/libtc.h"
 #include "libtcutil/optstr.h"
+#include "libtcaudio/tcaudio.h"
 
 #include <math.h>
 
@@ -68,6 +80,15 @@
 #define SIL_S16 (MAX_S16 * 0.01)
 
 
+// Relative gate of the lookahead mode (-10dB, on the mean square)
+#define REL_GATE 0.1
+
+#define MAX_LOOKAHEAD 250
+
+
+#define CLAMP(x,m,M) do { if ((x)<(m)) (x) = (m); else if ((x)>(M)) (x) = (M); } while(0)
+
+
 // Local data
 
 #define NSAMPLES 128
@@ -77,6 +98,19 @@ struct mem_t {
     int32_t len;	// sample size (weight)
 };
 
+// lookahead mode: one frame held back, and the level of one frame
+struct held_t {
+    uint8_t *buf;
+    int size;
+    int alloc;
+};
+
+struct level_t {
+    double ms;		// mean square of the samples
+    int32_t len;	// sample count
+    int32_t peak;	// highest magnitude
+};
+
 typedef struct MyFilterData {
 	int format;
 	double mul;
@@ -86,6 +120,17 @@ typedef struct MyFilterData {
 	int idx;
 	struct mem_t mem[NSAMPLES];
 	int AVG;
+	double mid;
+
+	int lookahead;
+	int chans;
+	TCAHandle tca;
+	struct held_t *held;	// lookahead+1 frames, by frame number
+	struct level_t *level;	// 2*lookahead+1 frames, by frame number
+	long frames;		// frames seen so far
+	long drained;		// held frames given out at end of stream
+	double gain;		// gain at the end of the last frame given out
+	long clipped;
 } MyFilterData;
 
 static MyFilterData *mfd = NULL;
@@ -110,6 +155,11 @@ static void help_optstr(void)
 "            1: uses a 1 value memory and coefficients new=a*old+b*cur (with a+b=1)\n"
 "            2: uses several samples to smooth the variations (standard weighted mean\n"
 "            on past samples)\n"
+"     'target' level to normalize to, relative to full scale ]0.0 1.0] [0.25]\n"
+"  'lookahead' frames to look ahead (0 = none, 'algo' is used) [0]\n"
+"            the gain follows the gated level of the surrounding frames, with\n"
+"            'smooth', and is lowered in time for the peaks; that many\n"
+"            frames are held back, and given out at the end of the stream\n"
 		, MOD_CAP);
 }
 
@@ -132,16 +182,201 @@ static void reset(void)
   }
 }
 
+/*-------------------------------------------------
+ *
+ * lookahead mode
+ *
+ *-------------------------------------------------*/
+
+#define LEVEL(n) (&mfd->level[(n) % (2*mfd->lookahead+1)])
+#define HELD(n)  (&mfd->held[(n) % (mfd->lookahead+1)])
+
+// the gain a frame could go up to without clipping
+static double peak_gain(long n)
+{
+  int32_t peak = LEVEL(n)->peak;
+  return (peak > 0) ? (double) MAX_S16 / peak : MUL_MAX;
+}
+
+// gain to bring frames first..last to the target level, or -1 if they
+// are all gated out
+static double gated_gain(long first, long last)
+{
+  double sum, gate;
+  int32_t total;
+  long n;
+  int pass;
+
+  gate = (double) SIL_S16 * SIL_S16;
+  for (pass = 0; pass < 2; pass++) {
+    sum = 0.0;
+    total = 0;
+    for (n = first; n <= last; n++) {
+      struct level_t *l = LEVEL(n);
+      if (l->ms >= gate) {
+	sum += l->ms * l->len;
+	total += l->len;
+      }
+    }
+    if (total == 0)
+      return -1.0;
+    if (REL_GATE * sum / total > gate)
+      gate = REL_GATE * sum / total;
+  }
+  sum = mfd->mid / sqrt(sum / total);
+  return (sum < MUL_MIN) ? MUL_MIN : (sum > MUL_MAX) ? MUL_MAX : sum;
+}
+
+static int lookahead_init(vob_t *vob)
+{
+  int n = mfd->lookahead;
+
+  if (vob->dm_bits != 16) {
+    tc_log_error(MOD_NAME, "This filter only works for 16 bit samples");
+    return -1;
+  }
+  mfd->chans = vob->dm_chan;
+  mfd->tca = tca_init(TCA_S16LE);
+  mfd->held = tc_zalloc((n+1) * sizeof(struct held_t));
+  mfd->level = tc_zalloc((2*n+1) * sizeof(struct level_t));
+  if (!mfd->tca || !mfd->held || !mfd->level) {
+    tc_log_error(MOD_NAME, "can't allocate the lookahead buffers");
+    return -1;
+  }
+  tca_set_accel(mfd->tca, tc_get_session()->acceleration);
+  mfd->frames = 0;
+  mfd->drained = 0;
+  mfd->gain = -1.0;
+  mfd->clipped = 0;
+  return 0;
+}
+
+static void lookahead_close(void)
+{
+  int i;
+
+  if (mfd->held) {
+    for (i = 0; i <= mfd->lookahead; i++)
+      tc_free(mfd->held[i].buf);
+    tc_free(mfd->held);
+  }
+  tc_free(mfd->level);
+  if (mfd->tca)
+    tca_free(mfd->tca);
+  if (verbose && mfd->frames > 0) {
+    tc_log_info(MOD_NAME, "lookahead: %ld samples clipped, %ld frames"
+		" drained", mfd->clipped, mfd->drained);
+  }
+}
+
+// Gives out frame `out' amplified, frames up to `now' being known
+static void lookahead_emit(aframe_list_t *ptr, long out, long now)
+{
+  struct held_t *h;
+  double want, end;
+  int32_t i;
+  int nclip = 0;
+
+  // the gain asked for by the frames around, held through silence
+  want = gated_gain((out > mfd->lookahead) ? out - mfd->lookahead : 0, now);
+  if (mfd->gain < 0.0)
+    mfd->gain = (want < 0.0) ? MUL_INIT : want;
+  if (want < 0.0)
+    want = mfd->gain;
+  if (mfd->gain > peak_gain(out))
+    mfd->gain = peak_gain(out);
+
+  // move towards it, but down fast enough to meet every peak ahead
+  end = mfd->gain + mfd->SMOOTH_MUL * (want - mfd->gain);
+  for (i = 0; out + i < now; i++) {
+    double limit = peak_gain(out + i), next = peak_gain(out + i + 1);
+    if (next < limit) limit = next;
+    limit = mfd->gain + (limit - mfd->gain) / (i + 1);
+    if (limit < end) end = limit;
+  }
+
+  h = HELD(out);
+  ac_memcpy(ptr->audio_buf, h->buf, h->size);
+  ptr->audio_size = h->size;
+  tca_amplify_ramp(mfd->tca, ptr->audio_buf, h->size / 2 / mfd->chans,
+		   mfd->chans, mfd->gain, end, &nclip);
+  mfd->clipped += nclip;
+  mfd->gain = end;
+}
+
+// Keeps the frame and gives out the one lookahead frames older, amplified
+static int lookahead_frame(aframe_list_t *ptr)
+{
+  int16_t *data = (int16_t *)ptr->audio_buf;
+  int len = ptr->audio_size / 2;
+  long now = mfd->frames++, out = now - mfd->lookahead;
+  struct level_t *l = LEVEL(now);
+  struct held_t *h = HELD(now);
+  int32_t i, tmp;
+
+  // level of the new frame
+  l->ms = 0.0;
+  l->len = len;
+  l->peak = 0;
+  for (i = 0; i < len; i++) {
+    tmp = data[i];
+    l->ms += tmp * tmp;
+    if (tmp < 0) tmp = -tmp;
+    if (tmp > l->peak) l->peak = tmp;
+  }
+  if (len > 0)
+    l->ms /= len;
+
+  if (h->alloc < ptr->audio_size) {
+    tc_free(h->buf);
+    h->buf = tc_malloc(ptr->audio_size);
+    if (!h->buf) {
+      h->alloc = 0;
+      tc_log_error(MOD_NAME, "can't allocate the lookahead buffers");
+      return -1;
+    }
+    h->alloc = ptr->audio_size;
+  }
+  ac_memcpy(h->buf, ptr->audio_buf, ptr->audio_size);
+  h->size = ptr->audio_size;
+
+  if (out < 0) {
+    // still filling up: the audio starts lookahead frames late
+    ptr->attributes |= TC_FRAME_IS_SKIPPED;
+    return 0;
+  }
+  lookahead_emit(ptr, out, now);
+  return 0;
+}
+
+// At end of stream, gives out the next frame still held back, if any
+static void lookahead_drain(aframe_list_t *ptr)
+{
+  long now = mfd->frames - 1;
+  long out = now - mfd->lookahead + 1;
+
+  if (out < 0)
+    out = 0;
+  out += mfd->drained;
+  if (out > now)
+    return;
+  mfd->drained++;
+  ptr->attributes &= ~TC_FRAME_IS_SKIPPED;
+  lookahead_emit(ptr, out, now);
+}
+
 int tc_filter(frame_list_t *ptr_, char *options)
 {
   aframe_list_t *ptr = (aframe_list_t *)ptr_;
   static vob_t *vob=NULL;
 
   if(ptr->tag & TC_FILTER_GET_CONFIG) {
-      optstr_filter_desc (options, MOD_NAME, MOD_CAP, MOD_VERSION, "pl, Tilmann Bitterberg", "AE", "1");
+      optstr_filter_desc (options, MOD_NAME, MOD_CAP, MOD_VERSION, "pl, Tilmann Bitterberg", "AEO", "1");
       optstr_param (options, "smooth", "Value for smoothing ]0.0 1.0[", "%f", "0.06", "0.0", "1.0");
       optstr_param (options, "smoothlast", "Value for smoothing last sample ]0.0, 1.0[", "%f", "0.06", "0.0", "1.0");
       optstr_param (options, "algo", "Algorithm to use (1 or 2). 1=uses a 1 value memory and coefficients new=a*old+b*cur (with a+b=1).   2=uses several samples to smooth the variations (standard weighted mean on past samples)", "%d", "1", "1", "2");
+      optstr_param (options, "target", "Level to normalize to, relative to full scale", "%f", "0.25", "0.01", "1.0");
+      optstr_param (options, "lookahead", "Frames to look ahead (0 = use algo)", "%d", "0", "0", "250");
       return 0;
   }
 
@@ -157,12 +392,7 @@ int tc_filter(frame_list_t *ptr_, char *options)
 
     if((vob = tc_get_vob())==NULL) return(-1);
 
-    if (vob->a_bits != 16) {
-	tc_log_error(MOD_NAME, "This filter only works for 16 bit samples");
-	return (-1);
-
-    }
-    if((mfd = tc_malloc (sizeof(MyFilterData))) == NULL) return (-1);
+    if((mfd = tc_zalloc (sizeof(MyFilterData))) == NULL) return (-1);
 
     mfd->format  = 1; /* XXX bogus */
     mfd->mul     = MUL_INIT;
@@ -171,6 +401,7 @@ int tc_filter(frame_list_t *ptr_, char *options)
     mfd->SMOOTH_MUL     = 0.06;
     mfd->SMOOTH_LASTAVG = 0.06;
     mfd->AVG     = 1;
+    mfd->mid     = MID_S16;
 
     reset();
 
@@ -182,9 +413,23 @@ int tc_filter(frame_list_t *ptr_, char *options)
 	optstr_get(options, "smoothlast", "%lf", &mfd->SMOOTH_LASTAVG);
 	optstr_get(options, "algo", "%d", &mfd->AVG);
 
+	optstr_get(options, "lookahead", "%d", &mfd->lookahead);
+	if (optstr_get(options, "target", "%lf", &mfd->mid) >= 0) {
+	    CLAMP(mfd->mid, 0.01, 1.0);
+	    mfd->mid *= MAX_S16;
+	}
+
 	if (mfd->AVG > 2) mfd->AVG = 2;
 	if (mfd->AVG < 1) mfd->AVG = 1;
+	CLAMP(mfd->lookahead, 0, MAX_LOOKAHEAD);
+
+    }
 
+    if (mfd->lookahead > 0) {
+	if (lookahead_init(vob) < 0) return (-1);
+    } else if (vob->a_bits != 16) {
+	tc_log_error(MOD_NAME, "This filter only works for 16 bit samples");
+	return (-1);
     }
 
 #if 0
@@ -215,7 +460,10 @@ int tc_filter(frame_list_t *ptr_, char *options)
   if(ptr->tag & TC_FILTER_CLOSE) {
 
     if (mfd) {
+	if (mfd->lookahead > 0)
+	    lookahead_close();
 	free(mfd);
+	mfd = NULL;
     }
 
     return(0);
@@ -233,10 +481,15 @@ int tc_filter(frame_list_t *ptr_, char *options)
   // transcodes internal video/audo frame processing routines
   // or after and determines video/audio context
 
-  if((ptr->tag & TC_PRE_M_PROCESS) && (ptr->tag & TC_AUDIO) && !(ptr->attributes & TC_FRAME_IS_SKIPPED))  {
+  if((ptr->tag & TC_POST_S_PROCESS) && (ptr->tag & TC_AUDIO) && mfd->lookahead > 0 && !(ptr->attributes & TC_FRAME_IS_SKIPPED))
+    return lookahead_frame(ptr);
 
+  if((ptr->tag & TC_FILTER_DRAIN) && (ptr->tag & TC_AUDIO) && mfd->lookahead > 0) {
+    lookahead_drain(ptr);
+    return 0;
+  }
 
-#define CLAMP(x,m,M) do { if ((x)<(m)) (x) = (m); else if ((x)>(M)) (x) = (M); } while(0)
+  if((ptr->tag & TC_PRE_M_PROCESS) && (ptr->tag & TC_AUDIO) && mfd->lookahead == 0 && !(ptr->attributes & TC_FRAME_IS_SKIPPED))  {
 
     int16_t* data=(int16_t *)ptr->audio_buf;
     int len=ptr->audio_size / 2; // 16 bits samples
@@ -261,7 +514,7 @@ int tc_filter(frame_list_t *ptr_, char *options)
     // samples level, etc
     if (mfd->AVG == 1) {
 	if (curavg > SIL_S16) {
-	    neededmul = MID_S16 / ( curavg * mfd->mul);
+	    neededmul = mfd->mid / ( curavg * mfd->mul);
 	    mfd->mul = (1.0 - mfd->SMOOTH_MUL) * mfd->mul + mfd->SMOOTH_MUL * neededmul;
 
 	    // Clamp the mul coefficient
@@ -279,7 +532,7 @@ int tc_filter(frame_list_t *ptr_, char *options)
 	if (totallen > MIN_SAMPLE_SIZE) {
 	    avg /= (double) totallen;
 	    if (avg >= SIL_S16) {
-		mfd->mul = (double) MID_S16 / avg;
+		mfd->mul = mfd->mid / avg;
 		CLAMP(mfd->mul, MUL_MIN, MUL_MAX);
 	    }
 	}
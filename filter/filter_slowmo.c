@@ -22,7 +22,7 @@
  */
 
 #define MOD_NAME    "filter_slowmo.so"
-#define MOD_VERSION "v0.3.1 (2006-09-10)"
+#define MOD_VERSION "v0.3.2 (2026-10-18)"
 #define MOD_CAP     "very cheap slow-motion effect"
 #define MOD_AUTHOR  "Tilmann Bitterberg"
 
@@ -129,7 +129,7 @@ int tc_filter(frame_list_t *ptr_, char *options)
 
     if (ptr->tag & TC_FILTER_GET_CONFIG) {
         optstr_filter_desc(options, MOD_NAME, MOD_CAP,
-                           MOD_VERSION, MOD_AUTHOR, "VRYE", "1");
+                           MOD_VERSION, MOD_AUTHOR, "VRYES", "1");
         return 0;
     }
 
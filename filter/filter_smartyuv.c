@@ -21,14 +21,20 @@
 */
 
 #define MOD_NAME    "filter_smartyuv.so"
-#define MOD_VERSION "0.1.6 (2007-05-31)"
+#define MOD_VERSION "0.2.0 (2026-10-18)"
 #define MOD_CAP     "Motion-adaptive deinterlacing"
 #define MOD_AUTHOR  "Tilmann Bitterberg"
 
+#define MOD_FEATURES \
+    TC_MODULE_FEATURE_FILTER|TC_MODULE_FEATURE_VIDEO
+#define MOD_FLAGS \
+    TC_MODULE_FLAG_RECONFIGURABLE|TC_MODULE_FLAG_BUFFERING
+
 #include "src/transcode.h"
 #include "src/filter.h"
 #include "libtc/libtc.h"
 #include "libtcutil/optstr.h"
+#include "libtcmodule/tcmodule-plugin.h"
 
 //#undef HAVE_ASM_MMX
 //#undef CAN_COMPILE_C_ALTIVEC
@@ -49,8 +55,6 @@
 #define rdtscll(val) __asm__ __volatile__("rdtsc" : "=A" (val))
 
 
-static vob_t *vob  = NULL;
-
 ///////////////////////////////////////////////////////////////////////////
 
 // this value is "hardcoded" in the optimized code for speed reasons
@@ -98,12 +102,13 @@ count: 1-256
 stride: -32000 - 320000
 */
 
-static void smartyuv_core (char *_src, char *_dst, char *_prev, int _width, int _height,
-                           int _srcpitch, int _dstpitch,
-                           unsigned char *_moving, unsigned char *_fmoving,
-                           yuv_clamp_fn clamp_f, int _threshold );
-
-typedef struct MyFilterData {
+/*
+ * The motion maps and the previous frame are per-instance scratch state
+ * updated on every frame, so an instance must see frames in order and one
+ * at a time: this is NOT a reentrant module.
+ */
+typedef struct smartyuvprivatedata_ SmartYUVPrivateData;
+struct smartyuvprivatedata_ {
     char            *buf;
     char            *prevFrame;
     unsigned char   *movingY;
@@ -123,13 +128,17 @@ typedef struct MyFilterData {
     int             Blend;
     int             doChroma;
     int             verbose;
-} MyFilterData;
+    int             counter;
+    char            conf_str[TC_BUF_MIN];
+};
 
-static MyFilterData *mfd = NULL;
+static void smartyuv_core (SmartYUVPrivateData *mfd,
+                           char *_src, char *_dst, char *_prev, int _width, int _height,
+                           int _srcpitch, int _dstpitch,
+                           unsigned char *_moving, unsigned char *_fmoving,
+                           yuv_clamp_fn clamp_f, int _threshold );
 
-static void help_optstr(void)
-{
-   tc_log_info (MOD_NAME, "(%s) help\n"
+static const char smartyuv_help[] = ""
 "* Overview\n"
 "   This filter is basically a rewrite of the\n"
 "   smartdeinter filter by Donald Graft (without advanced processing\n"
@@ -160,9 +169,7 @@ static void help_optstr(void)
 "       'highq' High-Quality processing (motion Map denoising) (0=off 1=on) [1]\n"
 "       'Blend' Blend the frames for deinterlacing (0=off 1=on) [1]\n"
 "    'doChroma' Enable chroma processing (slower but more accurate) (0=off 1=on) [1]\n"
-"     'verbose' Verbose mode (0=off 1=on) [1]\n"
-		, MOD_CAP);
-}
+"     'verbose' Verbose mode (0=off 1=on) [1]\n";
 
 static void Erode_Dilate (uint8_t *_moving, uint8_t *_fmoving, int width, int height)
 {
@@ -328,7 +335,8 @@ static void inline Blendline_c (uint8_t *dst, uint8_t *src, uint8_t *srcminus, u
 // this works fine on OSX too
 #define ABS_u8(a) (((a)^((a)>>7))-((a)>>7))
 
-static void smartyuv_core (char *_src, char *_dst, char *_prev, int _width, int _height,
+static void smartyuv_core (SmartYUVPrivateData *mfd,
+                           char *_src, char *_dst, char *_prev, int _width, int _height,
                            int _srcpitch, int _dstpitch,
                            unsigned char *_moving, unsigned char *_fmoving,
                            yuv_clamp_fn clamp_f, int _threshold )
@@ -355,7 +363,6 @@ static void smartyuv_core (char *_src, char *_dst, char *_prev, int _width, int
 	int 			rp, rn, rpp, rnn, R;
 	unsigned char		fiMotion;
 	int			cubic = mfd->cubic;
-	static int 		counter=0;
 #ifdef HAVE_ASM_MMX
 	const int		can_use_mmx = !(w%8); // width must a multiple of 8
 #endif
@@ -788,10 +795,10 @@ static void smartyuv_core (char *_src, char *_dst, char *_prev, int _width, int
 		else scenechange = 0;
 
 		if (scenechange && mfd->verbose)
-		    tc_log_info(MOD_NAME, "Scenechange at %6d (%6ld moving pixels)", counter, count);
+		    tc_log_info(MOD_NAME, "Scenechange at %6d (%6ld moving pixels)", mfd->counter, count);
 		/*
 		tc_log_msg(MOD_NAME, "Frame (%04d) count (%8ld) sc (%d) calc (%02ld)",
-				counter, count, scenechange, (100 * count) / (h * w));
+				mfd->counter, count, scenechange, (100 * count) / (h * w));
 				*/
 
 
@@ -1013,7 +1020,7 @@ static void smartyuv_core (char *_src, char *_dst, char *_prev, int _width, int
 	    ac_memcpy(dst, src, w);
 
 	    if (clamp_f == clamp_Y)
-		counter++;
+		mfd->counter++;
 
 	    return;
 
@@ -1197,296 +1204,462 @@ static void smartyuv_core (char *_src, char *_dst, char *_prev, int _width, int
 	// The last line gets a free ride.
 	ac_memcpy(dst, src, w);
 	if (clamp_f == clamp_Y)
-	    counter++;
+	    mfd->counter++;
 
 	return;
 }
 
-int tc_filter(frame_list_t *ptr_, char *options)
+
+/*************************************************************************/
+
+/* Module interface routines and data. */
+
+/*************************************************************************/
+
+/**
+ * smartyuv_init:  Initialize this instance of the module.  See
+ * tcmodule-data.h for function details.
+ */
+
+static int smartyuv_init(TCModuleInstance *self, uint32_t features)
 {
-  vframe_list_t *ptr = (vframe_list_t *)ptr_;
+    SmartYUVPrivateData *pd = NULL;
 
-  //----------------------------------
-  //
-  // filter init
-  //
-  //----------------------------------
+    TC_MODULE_SELF_CHECK(self, "init");
+    TC_MODULE_INIT_CHECK(self, MOD_FEATURES, features);
 
+    pd = tc_zalloc(sizeof(SmartYUVPrivateData));
+    if (pd == NULL) {
+        tc_log_error(MOD_NAME, "init: out of memory!");
+        return TC_ERROR;
+    }
+    self->userdata = pd;
 
-  if(ptr->tag & TC_FILTER_INIT) {
+    if (verbose) {
+        tc_log_info(MOD_NAME,
+#ifdef HAVE_ASM_MMX
+                    "(MMX) "
+#endif
+#ifdef CAN_COMPILE_C_ALTIVEC
+                    "(ALTIVEC) "
+#endif
+                    "%s %s", MOD_VERSION, MOD_CAP);
+    }
+    return TC_OK;
+}
 
-	unsigned int width, height;
-	int msize;
+/*************************************************************************/
 
-	if((vob = tc_get_vob())==NULL) return(-1);
+/**
+ * smartyuv_fini:  Clean up after this instance of the module.  See
+ * tcmodule-data.h for function details.
+ */
 
+TC_MODULE_GENERIC_FINI(smartyuv)
 
-	mfd = tc_zalloc(sizeof(MyFilterData));
+/*************************************************************************/
 
-	if (!mfd) {
-		tc_log_error(MOD_NAME, "No memory!");
-	        return (-1);
-	}
+/**
+ * smartyuv_stop:  Reset this instance of the module.  See tcmodule-data.h
+ * for function details.
+ */
 
-	width  = vob->im_v_width;
-	height = vob->im_v_height;
-
-	/* default values */
-	mfd->motionOnly     = 0;
-	mfd->threshold      = LUMA_THRESHOLD;
-	mfd->chromathres    = CHROMA_THRESHOLD;
-	mfd->scenethreshold = SCENE_THRESHOLD;
-	mfd->diffmode       = FRAME_ONLY;
-	mfd->codec          = vob->im_v_codec;
-	mfd->highq          = 1;
-	mfd->cubic          = 1;
-	mfd->doChroma       = 1;
-	mfd->Blend          = 1;
-	mfd->verbose        = 0;
-
-	if (mfd->codec != TC_CODEC_YUV420P) {
-	    tc_log_error (MOD_NAME, "This filter is only capable of YUV mode");
-	    return -1;
-	}
+#define FREE_BUF(PTR) do { \
+    if ((PTR)) \
+        tc_buffree((PTR)); \
+    (PTR) = NULL; \
+} while (0)
 
-	if (options != NULL) {
+static int smartyuv_stop(TCModuleInstance *self)
+{
+    SmartYUVPrivateData *pd = NULL;
 
-	  if(verbose) tc_log_info(MOD_NAME, "options=%s", options);
+    TC_MODULE_SELF_CHECK(self, "stop");
 
-	  optstr_get (options, "motionOnly",     "%d",  &mfd->motionOnly     );
-	  optstr_get (options, "threshold",      "%d",  &mfd->threshold      );
-	  optstr_get (options, "chromathres",    "%d",  &mfd->chromathres    );
-	  optstr_get (options, "Blend",          "%d",  &mfd->Blend          );
-	  optstr_get (options, "scenethres",     "%d",  &mfd->scenethreshold );
-	  optstr_get (options, "highq",          "%d",  &mfd->highq          );
-	  optstr_get (options, "cubic",          "%d",  &mfd->cubic          );
-	  optstr_get (options, "diffmode",       "%d",  &mfd->diffmode       );
-	  optstr_get (options, "doChroma",       "%d",  &mfd->doChroma       );
-	  optstr_get (options, "verbose",        "%d",  &mfd->verbose        );
+    pd = self->userdata;
 
-	  if (optstr_lookup (options, "help") != NULL) {
-		  help_optstr();
-	  }
-	}
+    FREE_BUF(pd->buf);
+    FREE_BUF(pd->prevFrame);
+    FREE_BUF(pd->movingY);
+    FREE_BUF(pd->movingU);
+    FREE_BUF(pd->movingV);
+    FREE_BUF(pd->fmovingY);
+    FREE_BUF(pd->fmovingU);
+    FREE_BUF(pd->fmovingV);
 
-	if (verbose > 1) {
-
-	  tc_log_info (MOD_NAME, " Smart YUV Deinterlacer Test Filter Settings (%dx%d):", width, height);
-	  tc_log_info (MOD_NAME, "        motionOnly = %d", mfd->motionOnly);
-	  tc_log_info (MOD_NAME, "          diffmode = %d", mfd->diffmode);
-	  tc_log_info (MOD_NAME, "         threshold = %d", mfd->threshold);
-	  tc_log_info (MOD_NAME, "       chromathres = %d", mfd->chromathres);
-	  tc_log_info (MOD_NAME, "        scenethres = %d", mfd->scenethreshold);
-	  tc_log_info (MOD_NAME, "             cubic = %d", mfd->cubic);
-	  tc_log_info (MOD_NAME, "             highq = %d", mfd->highq);
-	  tc_log_info (MOD_NAME, "             Blend = %d", mfd->Blend);
-	  tc_log_info (MOD_NAME, "          doChroma = %d", mfd->doChroma);
-	  tc_log_info (MOD_NAME, "           verbose = %d", mfd->verbose);
-	}
+    return TC_OK;
+}
 
-	/* fetch memory */
+#undef FREE_BUF
 
-	mfd->buf =  tc_bufalloc (width*height*3);
-	mfd->prevFrame =  tc_bufalloc (width*height*3);
+/*************************************************************************/
 
-	msize = width*height + 4*(width+PAD) + PAD*height;
-	mfd->movingY = (unsigned char *) tc_bufalloc(sizeof(unsigned char)*msize);
-	mfd->fmovingY = (unsigned char *) tc_bufalloc(sizeof(unsigned char)*msize);
+/**
+ * smartyuv_configure:  Configure this instance of the module.  See
+ * tcmodule-data.h for function details.
+ */
 
-	msize = width*height/4 + 4*(width+PAD) + PAD*height;
-	mfd->movingU  = (unsigned char *) tc_bufalloc(sizeof(unsigned char)*msize);
-	mfd->movingV  = (unsigned char *) tc_bufalloc(sizeof(unsigned char)*msize);
-	mfd->fmovingU = (unsigned char *) tc_bufalloc(sizeof(unsigned char)*msize);
-	mfd->fmovingV = (unsigned char *) tc_bufalloc(sizeof(unsigned char)*msize);
+static int smartyuv_configure(TCModuleInstance *self,
+                              const char *options,
+                              TCJob *vob,
+                              TCModuleExtraData *xdata[])
+{
+    SmartYUVPrivateData *pd = NULL;
+    int width, height, msize;
+
+    TC_MODULE_SELF_CHECK(self, "configure");
+
+    pd = self->userdata;
+
+    width  = vob->im_v_width;
+    height = vob->im_v_height;
+
+    /* default values */
+    pd->motionOnly     = 0;
+    pd->threshold      = LUMA_THRESHOLD;
+    pd->chromathres    = CHROMA_THRESHOLD;
+    pd->scenethreshold = SCENE_THRESHOLD;
+    pd->diffmode       = FRAME_ONLY;
+    pd->codec          = vob->im_v_codec;
+    pd->highq          = 1;
+    pd->cubic          = 1;
+    pd->doChroma       = 1;
+    pd->Blend          = 1;
+    pd->verbose        = 0;
+    pd->counter        = 0;
+
+    if (pd->codec != TC_CODEC_YUV420P) {
+        tc_log_error(MOD_NAME, "This filter is only capable of YUV mode");
+        return TC_ERROR;
+    }
 
-	if ( !mfd->movingY || !mfd->movingU || !mfd->movingV || !mfd->fmovingY ||
-	      !mfd->fmovingU || !mfd->fmovingV || !mfd->buf || !mfd->prevFrame) {
-	    tc_log_msg(MOD_NAME, "Memory allocation error");
-	    return -1;
-	}
+    if (options != NULL) {
+        if (verbose) {
+            tc_log_info(MOD_NAME, "options=%s", options);
+        }
 
-	memset(mfd->prevFrame, BLACK_BYTE_Y, width*height);
-	memset(mfd->prevFrame+width*height, BLACK_BYTE_UV, width*height/2);
-
-	memset(mfd->buf, BLACK_BYTE_Y, width*height);
-	memset(mfd->buf+width*height, BLACK_BYTE_UV, width*height/2);
-
-	msize = width*height + 4*(width+PAD) + PAD*height;
-	memset(mfd->movingY,  0, msize);
-	memset(mfd->fmovingY, 0, msize);
-
-	msize = width*height/4 + 4*(width+PAD) + PAD*height;
-	memset(mfd->movingU,  0, msize);
-	memset(mfd->movingV,  0, msize);
-	memset(mfd->fmovingU, 0, msize);
-	memset(mfd->fmovingV, 0, msize);
-
-	// Optimisation
-	// For the motion maps a little bit more than the needed memory is
-	// allocated. This is done, because than we don't have to use
-	// conditional borders int the erode and dilate routines. 2 extra lines
-	// on top and bottom and 2 pixels left and right for each line.
-	// This is also the reason for the w+4's all over the place.
-	//
-	// This gives an speedup factor in erode+denoise of about 3.
-	//
-	// A lot of brain went into the optimisations, here are some numbers of
-	// the separate steps. Note, to get these numbers I used the rdtsc
-	// instruction to read the CPU cycle counter in seperate programms:
-	// o  Motion map creation
-	//      orig: 26.283.387 Cycles
-	//       now:  8.991.686 Cycles
-	//       mmx:  5.062.952
-	// o  Erode+dilate
-	//      orig: 55.847.077
-	//       now: 21.764.997
-	//  Erodemmx: 18.765.878
-	// o  Blending
-	//      orig: 8.162.287
-	//       now: 5.384.433
-	//       mmx: 4.569.875
-	//   new mmx: 3.656.537
-	// o  Cubic interpolation
-	//      orig: 7.487.338
-	//       now: 6.684.908
-	//      more: 3.554.580
-	//
-	// Overall improvement in transcode:
-	// 11.57 -> 22.78 frames per second for the test clip.
-	//
-
-	// filter init ok.
-
-	if(verbose) tc_log_info(MOD_NAME,
-#ifdef HAVE_ASM_MMX
-		"(MMX) "
-#endif
-#ifdef CAN_COMPILE_C_ALTIVEC
-		"(ALTIVEC) "
-#endif
-		"%s %s", MOD_VERSION, MOD_CAP);
+        optstr_get(options, "motionOnly",  "%d", &pd->motionOnly    );
+        optstr_get(options, "threshold",   "%d", &pd->threshold     );
+        optstr_get(options, "chromathres", "%d", &pd->chromathres   );
+        optstr_get(options, "Blend",       "%d", &pd->Blend         );
+        optstr_get(options, "scenethres",  "%d", &pd->scenethreshold);
+        optstr_get(options, "highq",       "%d", &pd->highq         );
+        optstr_get(options, "cubic",       "%d", &pd->cubic         );
+        optstr_get(options, "diffmode",    "%d", &pd->diffmode      );
+        optstr_get(options, "doChroma",    "%d", &pd->doChroma      );
+        optstr_get(options, "verbose",     "%d", &pd->verbose       );
+
+        if (optstr_lookup(options, "help") != NULL) {
+            tc_log_info(MOD_NAME, "(%s) help\n%s", MOD_CAP, smartyuv_help);
+        }
+    }
 
-	return 0;
+    if (verbose > 1) {
+        tc_log_info(MOD_NAME, " Smart YUV Deinterlacer Test Filter"
+                              " Settings (%dx%d):", width, height);
+        tc_log_info(MOD_NAME, "        motionOnly = %d", pd->motionOnly);
+        tc_log_info(MOD_NAME, "          diffmode = %d", pd->diffmode);
+        tc_log_info(MOD_NAME, "         threshold = %d", pd->threshold);
+        tc_log_info(MOD_NAME, "       chromathres = %d", pd->chromathres);
+        tc_log_info(MOD_NAME, "        scenethres = %d", pd->scenethreshold);
+        tc_log_info(MOD_NAME, "             cubic = %d", pd->cubic);
+        tc_log_info(MOD_NAME, "             highq = %d", pd->highq);
+        tc_log_info(MOD_NAME, "             Blend = %d", pd->Blend);
+        tc_log_info(MOD_NAME, "          doChroma = %d", pd->doChroma);
+        tc_log_info(MOD_NAME, "           verbose = %d", pd->verbose);
+    }
 
-  } /* TC_FILTER_INIT */
+    /* fetch memory */
 
+    pd->buf       = tc_bufalloc(width*height*3);
+    pd->prevFrame = tc_bufalloc(width*height*3);
 
-  if(ptr->tag & TC_FILTER_GET_CONFIG) {
-      char buf[255];
-      optstr_filter_desc (options, MOD_NAME, MOD_CAP, MOD_VERSION, MOD_AUTHOR, "VYE", "1");
+    msize = width*height + 4*(width+PAD) + PAD*height;
+    pd->movingY  = tc_bufalloc(sizeof(unsigned char)*msize);
+    pd->fmovingY = tc_bufalloc(sizeof(unsigned char)*msize);
 
-      tc_snprintf (buf, sizeof(buf), "%d", mfd->motionOnly);
-      optstr_param (options, "motionOnly", "Show motion areas only, blacking out static areas" ,"%d", buf, "0", "1");
-      tc_snprintf (buf, sizeof(buf), "%d", mfd->diffmode);
-      optstr_param (options, "diffmode", "Motion Detection (0=frame, 1=field, 2=both)", "%d", buf, "0", "2" );
-      tc_snprintf (buf, sizeof(buf), "%d", mfd->threshold);
-      optstr_param (options, "threshold", "Motion Threshold (luma)", "%d", buf, "0", "255" );
-      tc_snprintf (buf, sizeof(buf), "%d", mfd->chromathres);
-      optstr_param (options, "chromathres", "Motion Threshold (chroma)", "%d", buf, "0", "255" );
-      tc_snprintf (buf, sizeof(buf), "%d", mfd->scenethreshold);
-      optstr_param (options, "scenethres", "Threshold for detecting scenechanges", "%d", buf, "0", "255" );
-      tc_snprintf (buf, sizeof(buf), "%d", mfd->highq);
-      optstr_param (options, "highq", "High-Quality processing (motion Map denoising)", "%d", buf, "0", "1" );
-      tc_snprintf (buf, sizeof(buf), "%d", mfd->cubic);
-      optstr_param (options, "cubic", "Do cubic interpolation", "%d", buf, "0", "1" );
-      tc_snprintf (buf, sizeof(buf), "%d", mfd->Blend);
-      optstr_param (options, "Blend", "Blend the frames for deinterlacing", "%d", buf, "0", "1" );
-      tc_snprintf (buf, sizeof(buf), "%d", mfd->doChroma);
-      optstr_param (options, "doChroma", "Enable chroma processing (slower but more accurate)", "%d", buf, "0", "1" );
-      tc_snprintf (buf, sizeof(buf), "%d", mfd->verbose);
-      optstr_param (options, "verbose", "Verbose mode", "%d", buf, "0", "1" );
+    msize = width*height/4 + 4*(width+PAD) + PAD*height;
+    pd->movingU  = tc_bufalloc(sizeof(unsigned char)*msize);
+    pd->movingV  = tc_bufalloc(sizeof(unsigned char)*msize);
+    pd->fmovingU = tc_bufalloc(sizeof(unsigned char)*msize);
+    pd->fmovingV = tc_bufalloc(sizeof(unsigned char)*msize);
 
-      return (0);
-  }
+    if (!pd->movingY || !pd->movingU || !pd->movingV || !pd->fmovingY
+     || !pd->fmovingU || !pd->fmovingV || !pd->buf || !pd->prevFrame) {
+        tc_log_error(MOD_NAME, "Memory allocation error");
+        smartyuv_stop(self);
+        return TC_ERROR;
+    }
 
-  if(ptr->tag & TC_FILTER_CLOSE) {
+    memset(pd->prevFrame, BLACK_BYTE_Y, width*height);
+    memset(pd->prevFrame+width*height, BLACK_BYTE_UV, width*height/2);
 
-	if (!mfd)
-		return 0;
+    memset(pd->buf, BLACK_BYTE_Y, width*height);
+    memset(pd->buf+width*height, BLACK_BYTE_UV, width*height/2);
 
-	tc_buffree (mfd->buf);
-	mfd->buf = NULL;
+    msize = width*height + 4*(width+PAD) + PAD*height;
+    memset(pd->movingY,  0, msize);
+    memset(pd->fmovingY, 0, msize);
 
-	tc_buffree (mfd->prevFrame);
-	mfd->prevFrame = NULL;
+    msize = width*height/4 + 4*(width+PAD) + PAD*height;
+    memset(pd->movingU,  0, msize);
+    memset(pd->movingV,  0, msize);
+    memset(pd->fmovingU, 0, msize);
+    memset(pd->fmovingV, 0, msize);
 
-	tc_buffree (mfd->movingY);
-	mfd->movingY = NULL;
-	tc_buffree (mfd->movingU);
-	mfd->movingU = NULL;
-	tc_buffree (mfd->movingV);
-	mfd->movingV = NULL;
+    /*
+     * Optimisation
+     * For the motion maps a little bit more than the needed memory is
+     * allocated. This is done, because than we don't have to use
+     * conditional borders int the erode and dilate routines. 2 extra lines
+     * on top and bottom and 2 pixels left and right for each line.
+     * This is also the reason for the w+4's all over the place.
+     *
+     * This gives an speedup factor in erode+denoise of about 3.
+     *
+     * A lot of brain went into the optimisations, here are some numbers of
+     * the separate steps. Note, to get these numbers I used the rdtsc
+     * instruction to read the CPU cycle counter in seperate programms:
+     * o  Motion map creation
+     *      orig: 26.283.387 Cycles
+     *       now:  8.991.686 Cycles
+     *       mmx:  5.062.952
+     * o  Erode+dilate
+     *      orig: 55.847.077
+     *       now: 21.764.997
+     *  Erodemmx: 18.765.878
+     * o  Blending
+     *      orig: 8.162.287
+     *       now: 5.384.433
+     *       mmx: 4.569.875
+     *   new mmx: 3.656.537
+     * o  Cubic interpolation
+     *      orig: 7.487.338
+     *       now: 6.684.908
+     *      more: 3.554.580
+     *
+     * Overall improvement in transcode:
+     * 11.57 -> 22.78 frames per second for the test clip.
+     */
+
+    return TC_OK;
+}
 
-	tc_buffree (mfd->fmovingY);
-	mfd->fmovingY = NULL;
-	tc_buffree (mfd->fmovingU);
-	mfd->fmovingU = NULL;
-	tc_buffree (mfd->fmovingV);
-	mfd->fmovingV = NULL;
+/*************************************************************************/
 
-	if (mfd)
-		free(mfd);
+/**
+ * smartyuv_inspect:  Return the value of an option in this instance of
+ * the module.  See tcmodule-data.h for function details.
+ */
 
-	return 0;
+#define INSPECT_PARAM(NAME, FIELD) do { \
+    if (optstr_lookup(param, NAME)) { \
+        tc_snprintf(pd->conf_str, sizeof(pd->conf_str), \
+                    "%s=%i", NAME, pd->FIELD); \
+        *value = pd->conf_str; \
+    } \
+} while (0)
 
-  } /* TC_FILTER_CLOSE */
+static int smartyuv_inspect(TCModuleInstance *self,
+                            const char *param, const char **value)
+{
+    SmartYUVPrivateData *pd = NULL;
 
-///////////////////////////////////////////////////////////////////////////
+    TC_MODULE_SELF_CHECK(self,  "inspect");
+    TC_MODULE_SELF_CHECK(param, "inspect");
+
+    pd = self->userdata;
+
+    if (optstr_lookup(param, "help")) {
+        *value = smartyuv_help;
+    }
+
+    INSPECT_PARAM("motionOnly",  motionOnly);
+    INSPECT_PARAM("diffmode",    diffmode);
+    INSPECT_PARAM("threshold",   threshold);
+    INSPECT_PARAM("chromathres", chromathres);
+    INSPECT_PARAM("scenethres",  scenethreshold);
+    INSPECT_PARAM("highq",       highq);
+    INSPECT_PARAM("cubic",       cubic);
+    INSPECT_PARAM("Blend",       Blend);
+    INSPECT_PARAM("doChroma",    doChroma);
+    INSPECT_PARAM("verbose",     verbose);
+
+    return TC_OK;
+}
+
+#undef INSPECT_PARAM
+
+/*************************************************************************/
+
+/**
+ * smartyuv_filter_video:  deinterlace the moving areas of a frame.
+ * See tcmodule-data.h for function details.
+ */
+
+static int smartyuv_filter_video(TCModuleInstance *self,
+                                 vframe_list_t *frame)
+{
+    SmartYUVPrivateData *pd = NULL;
+    int U, V, w2, h2, msize, off;
+
+    TC_MODULE_SELF_CHECK(self,  "filter");
+    TC_MODULE_SELF_CHECK(frame, "filter");
+
+    pd = self->userdata;
+
+    U     = frame->v_width*frame->v_height;
+    V     = frame->v_width*frame->v_height*5/4;
+    w2    = frame->v_width/2;
+    h2    = frame->v_height/2;
+    msize = frame->v_width*frame->v_height
+            + 4*(frame->v_width+PAD) + PAD*frame->v_height;
+    off   = 2*(frame->v_width+PAD)+PAD/2;
+
+    memset(pd->movingY,  0, msize);
+    memset(pd->fmovingY, 0, msize);
+
+    smartyuv_core(pd, (char *)frame->video_buf, pd->buf, pd->prevFrame,
+                  frame->v_width, frame->v_height,
+                  frame->v_width, frame->v_width,
+                  pd->movingY+off, pd->fmovingY+off,
+                  clamp_Y, pd->threshold);
+
+    if (pd->doChroma) {
+        msize = frame->v_width*frame->v_height/4
+                + 4*(frame->v_width+PAD) + PAD*frame->v_height;
+        off   = 2*(frame->v_width/2+PAD)+PAD/2;
+
+        memset(pd->movingU,  0, msize);
+        memset(pd->fmovingU, 0, msize);
+        memset(pd->movingV,  0, msize);
+        memset(pd->fmovingV, 0, msize);
+
+        smartyuv_core(pd, (char *)frame->video_buf+U, pd->buf+U,
+                      pd->prevFrame+U, w2, h2, w2, w2,
+                      pd->movingU+off, pd->fmovingU+off,
+                      clamp_UV, pd->chromathres);
+
+        smartyuv_core(pd, (char *)frame->video_buf+V, pd->buf+V,
+                      pd->prevFrame+V, w2, h2, w2, w2,
+                      pd->movingV+off, pd->fmovingV+off,
+                      clamp_UV, pd->chromathres);
+    } else {
+        //pass through
+        ac_memcpy(pd->buf+U, frame->video_buf+U,
+                  frame->v_width*frame->v_height/2);
+    }
+
+    ac_memcpy(frame->video_buf, pd->buf, frame->video_size);
+
+    return TC_OK;
+}
+
+/*************************************************************************/
 
-  //if(ptr->tag & TC_PRE_S_PROCESS && ptr->tag & TC_VIDEO && !(ptr->attributes & TC_FRAME_IS_SKIPPED)) {
-  if(ptr->tag & TC_PRE_M_PROCESS && ptr->tag & TC_VIDEO && !(ptr->attributes & TC_FRAME_IS_SKIPPED)) {
-
-	  int U  = ptr->v_width*ptr->v_height;
-	  int V  = ptr->v_width*ptr->v_height*5/4;
-	  int w2 = ptr->v_width/2;
-	  int h2 = ptr->v_height/2;
-	  int msize = ptr->v_width*ptr->v_height + 4*(ptr->v_width+PAD) + PAD*ptr->v_height;
-	  int off = 2*(ptr->v_width+PAD)+PAD/2;
-
-	  memset(mfd->movingY,  0, msize);
-	  memset(mfd->fmovingY, 0, msize);
-	  /*
-	  */
-
-
-	  smartyuv_core(ptr->video_buf, mfd->buf, mfd->prevFrame,
-		        ptr->v_width, ptr->v_height, ptr->v_width, ptr->v_width,
-		        mfd->movingY+off, mfd->fmovingY+off, clamp_Y, mfd->threshold);
-
-
-	  if (mfd->doChroma) {
-	      msize = ptr->v_width*ptr->v_height/4 + 4*(ptr->v_width+PAD) + PAD*ptr->v_height;
-	      off = 2*(ptr->v_width/2+PAD)+PAD/2;
-
-	      memset(mfd->movingU,  0, msize);
-	      memset(mfd->fmovingU, 0, msize);
-	      memset(mfd->movingV,  0, msize);
-	      memset(mfd->fmovingV, 0, msize);
-	      /*
-	      */
-
-	      smartyuv_core(ptr->video_buf+U, mfd->buf+U, mfd->prevFrame+U,
-			  w2, h2, w2, w2,
-			  mfd->movingU+off, mfd->fmovingU+off, clamp_UV, mfd->chromathres);
-
-	      smartyuv_core(ptr->video_buf+V, mfd->buf+V, mfd->prevFrame+V,
-			  w2, h2, w2, w2,
-			  mfd->movingV+off, mfd->fmovingV+off, clamp_UV, mfd->chromathres);
-	  } else {
-	      //pass through
-	      ac_memcpy(mfd->buf+U, ptr->video_buf+U, ptr->v_width*ptr->v_height/2);
-	      //memset(mfd->buf+U, BLACK_BYTE_UV, ptr->v_width*ptr->v_height/2);
-	  }
-
-	  /*
-	  memset(mfd->buf, BLACK_BYTE_Y, ptr->v_width*ptr->v_height);
-	  memset(mfd->buf+U, BLACK_BYTE_UV, ptr->v_width*ptr->v_height/2);
-			  */
-
-	  ac_memcpy (ptr->video_buf, mfd->buf, ptr->video_size);
-
-	  return 0;
-  }
-  return 0;
+static const TCCodecID smartyuv_codecs_video_in[] = {
+    TC_CODEC_YUV420P, TC_CODEC_ERROR
+};
+static const TCCodecID smartyuv_codecs_video_out[] = {
+    TC_CODEC_YUV420P, TC_CODEC_ERROR
+};
+TC_MODULE_AUDIO_UNSUPPORTED(smartyuv);
+TC_MODULE_FILTER_FORMATS(smartyuv);
+
+TC_MODULE_INFO(smartyuv);
+
+static const TCModuleClass smartyuv_class = {
+    TC_MODULE_CLASS_HEAD(smartyuv),
+
+    .init         = smartyuv_init,
+    .fini         = smartyuv_fini,
+    .configure    = smartyuv_configure,
+    .stop         = smartyuv_stop,
+    .inspect      = smartyuv_inspect,
+
+    .filter_video = smartyuv_filter_video,
+};
+
+TC_MODULE_ENTRY_POINT(smartyuv)
+
+/*************************************************************************/
+
+static int smartyuv_get_config(TCModuleInstance *self, char *options)
+{
+    SmartYUVPrivateData *pd = NULL;
+    char buf[TC_BUF_MIN];
+
+    TC_MODULE_SELF_CHECK(self, "get_config");
+
+    pd = self->userdata;
+
+    optstr_filter_desc(options, MOD_NAME, MOD_CAP, MOD_VERSION,
+                       MOD_AUTHOR, "VYE", "1");
+
+    tc_snprintf(buf, sizeof(buf), "%d", pd->motionOnly);
+    optstr_param(options, "motionOnly",
+                 "Show motion areas only, blacking out static areas",
+                 "%d", buf, "0", "1");
+    tc_snprintf(buf, sizeof(buf), "%d", pd->diffmode);
+    optstr_param(options, "diffmode",
+                 "Motion Detection (0=frame, 1=field, 2=both)",
+                 "%d", buf, "0", "2");
+    tc_snprintf(buf, sizeof(buf), "%d", pd->threshold);
+    optstr_param(options, "threshold", "Motion Threshold (luma)",
+                 "%d", buf, "0", "255");
+    tc_snprintf(buf, sizeof(buf), "%d", pd->chromathres);
+    optstr_param(options, "chromathres", "Motion Threshold (chroma)",
+                 "%d", buf, "0", "255");
+    tc_snprintf(buf, sizeof(buf), "%d", pd->scenethreshold);
+    optstr_param(options, "scenethres",
+                 "Threshold for detecting scenechanges",
+                 "%d", buf, "0", "255");
+    tc_snprintf(buf, sizeof(buf), "%d", pd->highq);
+    optstr_param(options, "highq",
+                 "High-Quality processing (motion Map denoising)",
+                 "%d", buf, "0", "1");
+    tc_snprintf(buf, sizeof(buf), "%d", pd->cubic);
+    optstr_param(options, "cubic", "Do cubic interpolation",
+                 "%d", buf, "0", "1");
+    tc_snprintf(buf, sizeof(buf), "%d", pd->Blend);
+    optstr_param(options, "Blend", "Blend the frames for deinterlacing",
+                 "%d", buf, "0", "1");
+    tc_snprintf(buf, sizeof(buf), "%d", pd->doChroma);
+    optstr_param(options, "doChroma",
+                 "Enable chroma processing (slower but more accurate)",
+                 "%d", buf, "0", "1");
+    tc_snprintf(buf, sizeof(buf), "%d", pd->verbose);
+    optstr_param(options, "verbose", "Verbose mode",
+                 "%d", buf, "0", "1");
+
+    return TC_OK;
 }
 
+static int smartyuv_process(TCModuleInstance *self, frame_list_t *frame)
+{
+    TC_MODULE_SELF_CHECK(self, "process");
+
+    if ((frame->tag & TC_PRE_M_PROCESS) && (frame->tag & TC_VIDEO)
+     && !(frame->attributes & TC_FRAME_IS_SKIPPED)) {
+        return smartyuv_filter_video(self, (vframe_list_t*)frame);
+    }
+    return TC_OK;
+}
+
+/*************************************************************************/
+
+/* Old-fashioned module interface. */
+
+TC_FILTER_OLDINTERFACE_M(smartyuv)
+
+/*************************************************************************/
+
+/*
+ * Local variables:
+ *   c-file-style: "stroustrup"
+ *   c-file-offsets: ((case-label . *) (statement-case-intro . *))
+ *   indent-tabs-mode: nil
+ * End:
+ *
+ * vim: expandtab shiftwidth=4:
+ */
@@ -22,94 +22,140 @@
  */
 
 #define MOD_NAME    "filter_smooth.so"
-#define MOD_VERSION "v0.2.3 (2003-03-27)"
+#define MOD_VERSION "v0.3.0 (2026-10-18)"
 #define MOD_CAP     "(single-frame) smoothing plugin"
 #define MOD_AUTHOR  "Chad Page"
 
 #include "src/transcode.h"
 #include "src/filter.h"
 #include "libtcutil/optstr.h"
+#include "libtcutil/tcthread.h"
 
 /* FIXME: this uses the filter ID as an index--the ID can grow
  * arbitrarily large, so this needs to be fixed */
 static unsigned char *tbuf[100];
 
-static void smooth_yuv(unsigned char *buf, int width, int height, int maxdiff,
-		       int maxldiff, int maxdist, float level, int instance)
-{
-	int x, y, pu, cpu, cdiff;
-	int xa, ya, oval, ldiff;
-	unsigned char *bufcr, *bufcb;
-	unsigned char *tbufcr, *tbufcb, *ltbuf;
-	float dist, ratio, nval;
-
-	ltbuf = tbuf[instance];
-	tbufcb = &ltbuf[width * height];
-	tbufcr = &tbufcb[(width/2) * (height/2)];
-
-	ac_memcpy(ltbuf, buf, (width * height) * 3 / 2);
+typedef struct {
+	unsigned char *buf, *ltbuf, *tbufcb, *tbufcr;
+	int width, height, maxdiff, maxldiff, maxdist;
+	float level;
+} SmoothPlane;
 
-	bufcb = &buf[width * height];
-	bufcr = &bufcb[(width/2) * (height/2)];
-
-
-	/* First pass - horizontal */
+/*
+ * Each pixel is blended in turn with the neighbours (at increasing
+ * offsets, and always the next one) close enough to it in color and
+ * luma. This is done one offset at a time for a whole row, which
+ * keeps the order of the operations on each pixel.
+ */
 
-	for (y = 0; y < (height); y++) {
-		for (x = 0; x < width; x++) {
-			pu = ((y * width) / 2) + (x / 2);
-			nval = ((float)buf[x + (y * width)]);
-			oval = buf[x + (y * width)];
-			for (xa = x - maxdist; (xa <= (x + maxdist)) && (xa < width); xa++) {
-				if (xa < 0) xa = 0;
-				if (xa == x) xa++;
-				cpu = ((y * width) / 2) + (xa / 2);
+static void smooth_rows_h(void *datum, int band, int first, int last)
+{
+	const SmoothPlane *sp = datum;
+	const int width = sp->width;
+	const unsigned char *tbufcb = sp->tbufcb, *tbufcr = sp->tbufcr;
+	float nval[TC_MAX_V_FRAME_WIDTH];
+	int x, y, o, x0, x1, pu, cpu, cdiff, ldiff;
+	float dist, ratio;
+
+	for (y = first; y < last; y++) {
+		unsigned char *row = &sp->buf[y * width];
+		const unsigned char *lrow = &sp->ltbuf[y * width];
+
+		for (x = 0; x < width; x++)
+			nval[x] = ((float)row[x]);
+		for (o = -sp->maxdist; (o <= sp->maxdist) || (o == 1); o++) {
+			if (o == 0)
+				continue;
+			x0 = (o < 0) ? -o : 0;
+			x1 = (o > 1) ? width - o : width;
+			dist = abs(o);
+			ratio = sp->level / dist;
+			for (x = x0; x < x1; x++) {
+				pu = ((y * width) / 2) + (x / 2);
+				cpu = ((y * width) / 2) + ((x + o) / 2);
 				cdiff = abs(tbufcr[pu] - tbufcr[cpu]);
 				cdiff += abs(tbufcb[pu] - tbufcb[cpu]);
-
-				/* If color difference not too great, average the pixel according to distance */
-				ldiff = abs(ltbuf[xa + (y * width)] - oval);
-				if ((cdiff < maxdiff) && (ldiff < maxldiff)) {
-					dist = abs(xa - x);
-					ratio = level / dist;
-					nval = nval * (1 - ratio);
-					nval += ((float)ltbuf[xa + (y * width)]) * ratio;
+				ldiff = abs(lrow[x + o] - lrow[x]);
+				if ((cdiff < sp->maxdiff) && (ldiff < sp->maxldiff)) {
+					nval[x] = nval[x] * (1 - ratio);
+					nval[x] += ((float)lrow[x + o]) * ratio;
 				}
 			}
-			buf[x + (y * width)] = (unsigned char)(nval + 0.5);
 		}
+		for (x = 0; x < width; x++)
+			row[x] = (unsigned char)(nval[x] + 0.5);
 	}
+}
 
-	/* Second pass - vertical lines */
-
-	ac_memcpy(ltbuf, buf, (width * height) * 3 / 2);
-
-	for (y = 0; y < (height); y++) {
-		for (x = 0; x < width; x++) {
-			pu = ((y * width) / 2) + (x / 2);
-			nval = ((float)buf[x + (y * width)]);
-			oval = buf[x + (y * width)];
-			for (ya = y - maxdist; (ya <= (y + maxdist)) && (ya < height); ya++) {
-				if (ya < 0) ya = 0;
-				if (ya == y) ya++;
-				cpu = ((ya * width) / 2) + (x / 2);
+static void smooth_rows_v(void *datum, int band, int first, int last)
+{
+	const SmoothPlane *sp = datum;
+	const int width = sp->width;
+	const unsigned char *tbufcb = sp->tbufcb, *tbufcr = sp->tbufcr;
+	const unsigned char *nrow;
+	float nval[TC_MAX_V_FRAME_WIDTH];
+	int x, y, o, pu, cpu, cdiff, ldiff;
+	float dist, ratio;
+
+	for (y = first; y < last; y++) {
+		unsigned char *row = &sp->buf[y * width];
+		const unsigned char *lrow = &sp->ltbuf[y * width];
+
+		for (x = 0; x < width; x++)
+			nval[x] = ((float)row[x]);
+		for (o = -sp->maxdist; (o <= sp->maxdist) || (o == 1); o++) {
+			if (o == 0 || y + o < 0 || (o > 1 && y + o >= sp->height))
+				continue;
+			nrow = &sp->ltbuf[(y + o) * width];
+			dist = abs(o);
+			ratio = sp->level / dist;
+			for (x = 0; x < width; x++) {
+				pu = ((y * width) / 2) + (x / 2);
+				cpu = (((y + o) * width) / 2) + (x / 2);
 				cdiff = abs(tbufcr[pu] - tbufcr[cpu]);
 				cdiff += abs(tbufcb[pu] - tbufcb[cpu]);
-
-				/* If color difference not too great, average the pixel according to distance */
-				ldiff = abs(ltbuf[x + (ya * width)] - oval);
-				if ((cdiff < maxdiff) && (ldiff < maxldiff)) {
-					dist = abs(ya - y);
-					ratio = level / dist;
-					nval = nval * (1 - ratio);
-					nval += ((float)ltbuf[x + (ya * width)]) * ratio;
+				ldiff = abs(nrow[x] - lrow[x]);
+				if ((cdiff < sp->maxdiff) && (ldiff < sp->maxldiff)) {
+					nval[x] = nval[x] * (1 - ratio);
+					nval[x] += ((float)nrow[x]) * ratio;
 				}
 			}
-			buf[x + (y * width)] = (unsigned char)(nval + 0.5);
 		}
+		for (x = 0; x < width; x++)
+			row[x] = (unsigned char)(nval[x] + 0.5);
 	}
 }
 
+static void smooth_yuv(unsigned char *buf, int width, int height, int maxdiff,
+		       int maxldiff, int maxdist, float level, int threads,
+		       int instance)
+{
+	SmoothPlane sp;
+
+	sp.buf = buf;
+	sp.ltbuf = tbuf[instance];
+	sp.tbufcb = &sp.ltbuf[width * height];
+	sp.tbufcr = &sp.tbufcb[(width/2) * (height/2)];
+	sp.width = width;
+	sp.height = height;
+	sp.maxdiff = maxdiff;
+	sp.maxldiff = maxldiff;
+	sp.maxdist = maxdist;
+	sp.level = level;
+
+	ac_memcpy(sp.ltbuf, buf, (width * height) * 3 / 2);
+
+	/* First pass - horizontal */
+
+	tc_thread_bands(threads, height, smooth_rows_h, &sp);
+
+	/* Second pass - vertical lines */
+
+	ac_memcpy(sp.ltbuf, buf, (width * height) * 3 / 2);
+
+	tc_thread_bands(threads, height, smooth_rows_v, &sp);
+}
+
 /*-------------------------------------------------
  *
  * single function interface
@@ -122,7 +168,7 @@ int tc_filter(frame_list_t *ptr_, char *options)
   static vob_t *vob=NULL;
   /* FIXME: these use the filter ID as an index--the ID can grow
    * arbitrarily large, so this needs to be fixed */
-  static int cdiff[100], ldiff[100], range[100];
+  static int cdiff[100], ldiff[100], range[100], threads[100];
   static float strength[100];
   int instance = ptr->filter_id;
 
@@ -151,6 +197,9 @@ int tc_filter(frame_list_t *ptr_, char *options)
       tc_snprintf (buf, 32, "%d", range[instance]);
       optstr_param (options, "range",    "Search Range",                    "%d", buf, "0", "16");
 
+      tc_snprintf (buf, 32, "%d", threads[instance]);
+      optstr_param (options, "threads",  "Row bands filtered in parallel",  "%d", buf, "1", "16");
+
 	return 0;
   }
 
@@ -172,6 +221,7 @@ int tc_filter(frame_list_t *ptr_, char *options)
     cdiff[instance] = 6;		/* Max difference in UV values */
     ldiff[instance] = 8;		/* Max difference in Y value */
     range[instance] = 4;		/* Search range */
+    threads[instance] = 1;		/* Row bands filtered in parallel */
 
     if (options != NULL) {
     	if(verbose) tc_log_info(MOD_NAME, "options=%s", options);
@@ -180,10 +230,12 @@ int tc_filter(frame_list_t *ptr_, char *options)
 	optstr_get (options, "cdiff",  "%d", &cdiff[instance]);
 	optstr_get (options, "ldiff",  "%d", &ldiff[instance]);
 	optstr_get (options, "range",  "%d", &range[instance]);
+	optstr_get (options, "threads",  "%d", &threads[instance]);
     }
 
     tbuf[instance] = tc_malloc(SIZE_RGB_FRAME);
     if (strength[instance]> 0.9) strength[instance] = 0.9;
+    threads[instance] = TC_CLAMP(threads[instance], 1, TC_THREAD_MAX_BANDS);
     memset(tbuf[instance], 0, SIZE_RGB_FRAME);
 
     if (vob->im_v_codec == TC_CODEC_RGB24) {
@@ -224,7 +276,8 @@ int tc_filter(frame_list_t *ptr_, char *options)
 
 	if (vob->im_v_codec == TC_CODEC_YUV420P)
 		smooth_yuv(ptr->video_buf, ptr->v_width, ptr->v_height, cdiff[instance],
-		    ldiff[instance], range[instance], strength[instance], instance);
+		    ldiff[instance], range[instance], strength[instance],
+		    threads[instance], instance);
 
   }
 
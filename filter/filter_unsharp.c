@@ -18,7 +18,7 @@
 */
 
 #define MOD_NAME      "filter_unsharp.so"
-#define MOD_VERSION   "v1.0.1 (2003-10-27)"
+#define MOD_VERSION   "v1.1.0 (2026-10-18)"
 #define MOD_CAP       "unsharp mask & gaussian blur"
 #define MOD_AUTHOR    "Rmi Guyomarch"
 
@@ -26,6 +26,7 @@
 #include "src/filter.h"
 #include "libtc/libtc.h"
 #include "libtcutil/optstr.h"
+#include "libtcutil/tcthread.h"
 
 #include <math.h>
 
@@ -38,15 +39,26 @@
 typedef struct FilterParam {
     int msizeX, msizeY;
     double amount;
-    uint32_t *SC[MAX_MATRIX_SIZE-1];
+    uint32_t kernelX[MAX_MATRIX_SIZE];
+    uint32_t kernelY[MAX_MATRIX_SIZE];
 } FilterParam;
 
 typedef struct vf_priv_s {
     FilterParam lumaParam;
     FilterParam chromaParam;
     int pre;
+    int threads;
+    uint32_t *tmp[TC_THREAD_MAX_BANDS];  // per band: column sums + blur
 } MyFilterData;
 
+typedef struct UnsharpPlane {
+    uint8_t *dst;
+    const uint8_t *src;
+    int stride, width, height;
+    const FilterParam *fp;
+    uint32_t * const *tmp;
+} UnsharpPlane;
+
 
 //===========================================================================//
 
@@ -58,13 +70,34 @@ Frederick M. Waltz and John W. V. Miller
 SPIE Conf. on Machine Vision Systems for Inspection and Metrology VII
 Originally published Boston, Nov 98
 
+The state machine adds up each msizeX x msizeY neighbourhood (edges
+replicated) with binomial weights; here the same sums are done as a
+vertical and then a horizontal weighted sum of rows, so the frame can
+be split in bands of rows. The sums wrap around like the original ones
+did, the result is the same.
+
 */
 
-static void unsharp( uint8_t *dst, uint8_t *src, int dstStride, int srcStride, int width, int height, FilterParam *fp ) {
+static void binomial( uint32_t *kernel, int size ) {
+
+    int i, j;
+
+    kernel[0] = 1;
+    for( i=1; i<size; i++ ) {
+	kernel[i] = 1;
+	for( j=i-1; j>0; j-- )
+	    kernel[j] += kernel[j-1];
+    }
+}
+
+static void unsharp_rows( void *datum, int band, int first, int last ) {
 
-    uint32_t **SC = fp->SC;
-    uint32_t SR[MAX_MATRIX_SIZE-1], Tmp1, Tmp2;
-    uint8_t* src2 = src; // avoid gcc warning
+    const UnsharpPlane *pl = datum;
+    const FilterParam *fp = pl->fp;
+    const uint8_t *rows[MAX_MATRIX_SIZE];
+    const uint32_t *cols[MAX_MATRIX_SIZE];
+    uint32_t *col = pl->tmp[band];
+    uint32_t *sum = col + pl->width + MAX_MATRIX_SIZE;
 
     int32_t res;
     int x, y, z;
@@ -74,48 +107,49 @@ static void unsharp( uint8_t *dst, uint8_t *src, int dstStride, int srcStride, i
     int scalebits = (stepsX+stepsY)*2;
     int32_t halfscale = 1 << ((stepsX+stepsY)*2-1);
 
-    if( !fp->amount ) {
-	if( src == dst )
-	    return;
-	if( dstStride == srcStride )
-	    ac_memcpy( dst, src, srcStride*height );
-	else
-	    for( y=0; y<height; y++, dst+=dstStride, src+=srcStride )
-		ac_memcpy( dst, src, width );
-	return;
-    }
+    for( z=0; z<fp->msizeX; z++ )
+	cols[z] = col + z;
 
-    for( y=0; y<2*stepsY; y++ )
-	memset( SC[y], 0, sizeof(SC[y][0]) * (width+2*stepsX) );
-
-    for( y=-stepsY; y<height+stepsY; y++ ) {
-	if( y < height ) src2 = src;
-	memset( SR, 0, sizeof(SR[0]) * (2*stepsX-1) );
-	for( x=-stepsX; x<width+stepsX; x++ ) {
-	    Tmp1 = x<=0 ? src2[0] : x>=width ? src2[width-1] : src2[x];
-	    for( z=0; z<stepsX*2; z+=2 ) {
-		Tmp2 = SR[z+0] + Tmp1; SR[z+0] = Tmp1;
-		Tmp1 = SR[z+1] + Tmp2; SR[z+1] = Tmp2;
-	    }
-	    for( z=0; z<stepsY*2; z+=2 ) {
-		Tmp2 = SC[z+0][x+stepsX] + Tmp1; SC[z+0][x+stepsX] = Tmp1;
-		Tmp1 = SC[z+1][x+stepsX] + Tmp2; SC[z+1][x+stepsX] = Tmp2;
-	    }
-	    if( x>=stepsX && y>=stepsY ) {
-		uint8_t* srx = src - stepsY*srcStride + x - stepsX;
-		uint8_t* dsx = dst - stepsY*dstStride + x - stepsX;
-
-		res = (int32_t)*srx + ( ( ( (int32_t)*srx - (int32_t)((Tmp1+halfscale) >> scalebits) ) * amount ) >> 16 );
-		*dsx = res>255 ? 255 : res<0 ? 0 : (uint8_t)res;
-	    }
+    for( y=first; y<last; y++ ) {
+	const uint8_t* srx = pl->src + y*pl->stride;
+	uint8_t* dsx = pl->dst + y*pl->stride;
+
+	for( z=0; z<fp->msizeY; z++ )
+	    rows[z] = pl->src + TC_CLAMP(y-stepsY+z, 0, pl->height-1)*pl->stride;
+	ac_rows_convolve( rows, fp->kernelY, fp->msizeY, col+stepsX, pl->width );
+	for( x=0; x<stepsX; x++ ) {
+	    col[x] = col[stepsX];
+	    col[stepsX+pl->width+x] = col[stepsX+pl->width-1];
 	}
-	if( y >= 0 ) {
-	    dst += dstStride;
-	    src += srcStride;
+	ac_rows_convolve32( cols, fp->kernelX, fp->msizeX, sum, pl->width );
+
+	for( x=0; x<pl->width; x++ ) {
+	    res = (int32_t)srx[x] + ( ( ( (int32_t)srx[x] - (int32_t)((sum[x]+halfscale) >> scalebits) ) * amount ) >> 16 );
+	    dsx[x] = res>255 ? 255 : res<0 ? 0 : (uint8_t)res;
 	}
     }
 }
 
+static void unsharp( uint8_t *dst, uint8_t *src, int stride, int width, int height, FilterParam *fp, MyFilterData *mfd ) {
+
+    UnsharpPlane pl;
+
+    if( !fp->amount ) {
+	if( src != dst )
+	    ac_memcpy( dst, src, stride*height );
+	return;
+    }
+
+    pl.dst    = dst;
+    pl.src    = src;
+    pl.stride = stride;
+    pl.width  = width;
+    pl.height = height;
+    pl.fp     = fp;
+    pl.tmp    = mfd->tmp;
+    tc_thread_bands( mfd->threads, height, unsharp_rows, &pl );
+}
+
 //===========================================================================//
 
 static void help_optstr(void)
@@ -144,6 +178,7 @@ static void help_optstr(void)
 "    luma_matrix : Luma search matrix size (%dx%d)\n"
 "  chroma_matrix : Chroma search matrix size (%dx%d)\n"
 "              pre : run as a pre filter (0)\n"
+"          threads : filter that many row bands in parallel (1)\n"
 		 , MOD_CAP,
 		 0.0,
 		 0, 0,
@@ -184,6 +219,8 @@ int tc_filter(frame_list_t *ptr_, char *options)
 
       optstr_param (options, "pre", "run as a pre filter", "%d", "0", "0", "1" );
 
+      optstr_param (options, "threads", "row bands filtered in parallel", "%d", "1", "1", "16" );
+
       return 0;
   }
 
@@ -197,7 +234,7 @@ int tc_filter(frame_list_t *ptr_, char *options)
   if(ptr->tag & TC_FILTER_INIT) {
 
     int width, height;
-    int z, stepsX, stepsY;
+    int z;
     FilterParam *fp;
     char *effect;
     double amount=0.0;
@@ -229,6 +266,7 @@ int tc_filter(frame_list_t *ptr_, char *options)
 	optstr_get (options, "chroma",         "%lf",   &mfd->chromaParam.amount);
 	optstr_get (options, "chroma_matrix",  "%dx%d", &mfd->chromaParam.msizeX, &mfd->chromaParam.msizeY);
 	optstr_get (options, "pre",            "%d",    &mfd->pre);
+	optstr_get (options, "threads",        "%d",    &mfd->threads);
 
 	if (amount!=0.0 && msizeX && msizeY) {
 
@@ -265,24 +303,20 @@ int tc_filter(frame_list_t *ptr_, char *options)
     effect = fp->amount == 0 ? "don't touch" : fp->amount < 0 ? "blur" : "sharpen";
     tc_log_info(MOD_NAME, "unsharp: %dx%d:%0.2f (%s luma)",
                     fp->msizeX, fp->msizeY, fp->amount, effect );
-    memset( fp->SC, 0, sizeof( fp->SC ) );
-    stepsX = fp->msizeX/2;
-    stepsY = fp->msizeY/2;
-    for( z=0; z<2*stepsY; z++ )
-        {
-	fp->SC[z] = tc_bufalloc(sizeof(*(fp->SC[z])) * (width+2*stepsX));
-        }
+    binomial( fp->kernelX, fp->msizeX );
+    binomial( fp->kernelY, fp->msizeY );
 
     fp = &mfd->chromaParam;
     effect = fp->amount == 0 ? "don't touch" : fp->amount < 0 ? "blur" : "sharpen";
     tc_log_info(MOD_NAME, "unsharp: %dx%d:%0.2f (%s chroma)",
                     fp->msizeX, fp->msizeY, fp->amount, effect );
-    memset( fp->SC, 0, sizeof( fp->SC ) );
-    stepsX = fp->msizeX/2;
-    stepsY = fp->msizeY/2;
-    for( z=0; z<2*stepsY; z++ )
+    binomial( fp->kernelX, fp->msizeX );
+    binomial( fp->kernelY, fp->msizeY );
+
+    mfd->threads = TC_CLAMP(mfd->threads, 1, TC_THREAD_MAX_BANDS);
+    for( z=0; z<mfd->threads; z++ )
         {
-	fp->SC[z] = tc_bufalloc(sizeof(*(fp->SC[z])) * (width+2*stepsX));
+	mfd->tmp[z] = tc_bufalloc(sizeof(*(mfd->tmp[z])) * 2*(width+MAX_MATRIX_SIZE));
         }
 
 
@@ -293,19 +327,12 @@ int tc_filter(frame_list_t *ptr_, char *options)
 
   if (ptr->tag & TC_FILTER_CLOSE) {
       unsigned int z;
-      FilterParam *fp;
 
       if( !mfd ) return -1;
 
-      fp = &mfd->lumaParam;
-      for( z=0; z<sizeof(fp->SC)/sizeof(fp->SC[0]); z++ ) {
-          tc_buffree(fp->SC[z]);
-	  fp->SC[z] = NULL;
-      }
-      fp = &mfd->chromaParam;
-      for( z=0; z<sizeof(fp->SC)/sizeof(fp->SC[0]); z++ ) {
-          tc_buffree(fp->SC[z]);
-	  fp->SC[z] = NULL;
+      for( z=0; z<sizeof(mfd->tmp)/sizeof(mfd->tmp[0]); z++ ) {
+          tc_buffree(mfd->tmp[z]);
+	  mfd->tmp[z] = NULL;
       }
 
       free( mfd );
@@ -328,11 +355,11 @@ int tc_filter(frame_list_t *ptr_, char *options)
 
       ac_memcpy (buffer, ptr->video_buf, ptr->video_size);
 
-      unsharp( ptr->video_buf, buffer, ptr->v_width, ptr->v_width, ptr->v_width,   ptr->v_height,   &mfd->lumaParam );
+      unsharp( ptr->video_buf, buffer, ptr->v_width, ptr->v_width,   ptr->v_height,   &mfd->lumaParam, mfd );
 
-      unsharp( ptr->video_buf+off, buffer+off, w2, w2, w2, h2, &mfd->chromaParam );
+      unsharp( ptr->video_buf+off, buffer+off, w2, w2, h2, &mfd->chromaParam, mfd );
 
-      unsharp( ptr->video_buf+5*off/4, buffer+5*off/4, w2, w2, w2, h2, &mfd->chromaParam );
+      unsharp( ptr->video_buf+5*off/4, buffer+5*off/4, w2, w2, h2, &mfd->chromaParam, mfd );
 
       return 0;
   }
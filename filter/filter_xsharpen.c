@@ -29,7 +29,7 @@
  */
 
 #define MOD_NAME    "filter_xharpen.so"
-#define MOD_VERSION "(1.1.0) (2009-02-07)"
+#define MOD_VERSION "(1.2.0) (2026-10-18)"
 #define MOD_CAP     "VirtualDub's XSharpen Filter"
 #define MOD_AUTHOR  "Donald Graft, Tilmann Bitterberg"
 
@@ -49,6 +49,7 @@
 #include "src/filter.h"
 #include "libtc/libtc.h"
 #include "libtcutil/optstr.h"
+#include "libtcutil/tcthread.h"
 #include "libtcmodule/tcmodule-plugin.h"
 #include "aclib/imgconvert.h"
 
@@ -81,7 +82,10 @@ static const char xsharpen_help[] = ""
     "   dimmest pixel to be mapped. If a pixel is more than threshold away\n"
     "   from the brightest or dimmest pixel, it is not mapped.  Thus, as\n"
     "   the threshold is reduced, pixels in the mid range start to be\n"
-    "   spared.\n";
+    "   spared.\n"
+    "\n"
+    "   Threads 'threads' (1-16) [1]\n"
+    "   Process the frame in that many bands of rows in parallel.\n";
 
 /*************************************************************************/
 
@@ -92,6 +96,7 @@ struct myfilterdata_ {
     int         strength;
     int         strengthInv;
     int         threshold;
+    int         threads;
     int         srcPitch;
     int         dstPitch;
     int         codec;
@@ -100,6 +105,8 @@ struct myfilterdata_ {
 
     int (*filter_frame)(XsharpenPrivateData *mfd, vframe_list_t *frame);
     uint8_t *dst_buf;
+    uint8_t *luma;  /* RGB: luma plane */
+    uint8_t *tmp;   /* 4 rows per band */
 };
 
 /* forward declarations */
@@ -158,12 +165,19 @@ static int xsharpen_configure(TCModuleInstance *self,
     mfd->strength       = 200; /* 255 is too much */
     mfd->strengthInv    = 255 - mfd->strength;
     mfd->threshold      = 255;
+    mfd->threads        = 1;
     mfd->srcPitch       = 0;
     mfd->dstPitch       = 0;
     mfd->dst_buf        = NULL;
+    mfd->luma           = NULL;
 
     switch (mfd->codec) {
       case TC_CODEC_RGB24:
+        mfd->luma = tc_malloc(width*height);
+        if (!mfd->luma) {
+            tc_log_error(MOD_NAME, "cannot allocate internal luma buffer");
+            return TC_ERROR;
+        }
         mfd->filter_frame = xsharpen_rgb_frame;
         break;
       case TC_CODEC_YUV420P:
@@ -182,13 +196,16 @@ static int xsharpen_configure(TCModuleInstance *self,
     if (options) {
         optstr_get(options, "strength",  "%d", &mfd->strength);
         optstr_get(options, "threshold", "%d", &mfd->threshold);
+        optstr_get(options, "threads",   "%d", &mfd->threads);
     }
     mfd->strengthInv    = 255 - mfd->strength;
+    mfd->threads        = TC_CLAMP(mfd->threads, 1, TC_THREAD_MAX_BANDS);
 
     if (verbose > TC_INFO) {
         tc_log_info(MOD_NAME, " XSharpen Filter Settings (%dx%d):", width,height);
         tc_log_info(MOD_NAME, "          strength = %d", mfd->strength);
         tc_log_info(MOD_NAME, "         threshold = %d", mfd->threshold);
+        tc_log_info(MOD_NAME, "           threads = %d", mfd->threads);
     }
 
     /* fetch memory */
@@ -204,6 +221,12 @@ static int xsharpen_configure(TCModuleInstance *self,
         return TC_ERROR;
     }
 
+    mfd->tmp = tc_malloc(mfd->threads * 4 * width);
+    if (!mfd->tmp) {
+        tc_log_error(MOD_NAME, "No memory at %d!", __LINE__);
+        return TC_ERROR;
+    }
+
     mfd->tcvhandle = tcv_init();
 
     return TC_OK;
@@ -228,6 +251,14 @@ static int xsharpen_stop(TCModuleInstance *self)
         tc_free(mfd->dst_buf);
     mfd->dst_buf = NULL;
 
+    if (mfd->luma)
+        tc_free(mfd->luma);
+    mfd->luma = NULL;
+
+    if (mfd->tmp)
+        tc_free(mfd->tmp);
+    mfd->tmp = NULL;
+
     if (mfd->convertFrameIn)
         tc_free(mfd->convertFrameIn);
     mfd->convertFrameIn = NULL;
@@ -274,119 +305,120 @@ static int xsharpen_inspect(TCModuleInstance *self,
                     "threshold=%d", mfd->threshold);
         *value = mfd->conf_str;
     }
+    if (optstr_lookup(param, "threads")) {
+        tc_snprintf(mfd->conf_str, sizeof(mfd->conf_str),
+                    "threads=%d", mfd->threads);
+        *value = mfd->conf_str;
+    }
 
     return TC_OK;
 }
 
 /*************************************************************************/
 
-#define UPDATE_RGB_RANGE(p, luma) do { \
-    if (luma > lumamax) { \
-        lumamax = luma; \
-        max = p; \
-    } \
-    if (luma < lumamin) { \
-        lumamin = luma; \
-        min = p; \
-    } \
-} while (0)
-
-#define SEARCH_RGB_LUMA(PTR, X) do { \
-    p = ((Pixel32 *)(PTR))[(X)-1]; \
-    luma = p >> 24; \
-    UPDATE_RGB_RANGE(p, luma); \
-    \
-    p = ((Pixel32 *)(PTR))[(X)]; \
-    luma = p >> 24; \
-    UPDATE_RGB_RANGE(p, luma); \
-    \
-    p = ((Pixel32 *)(PTR))[(X)+1]; \
-    luma = p >> 24; \
-    UPDATE_RGB_RANGE(p, luma); \
-} while (0)
+/*
+ * Both paths split the frame in bands of rows. The brightest and dimmest
+ * luma of the 3x3 window around each pixel come from row-wise minimum
+ * and maximum over three rows, then over three columns.
+ */
 
+typedef struct xsharpenframe_ XsharpenFrame;
+struct xsharpenframe_ {
+    const XsharpenPrivateData *mfd;
+    const void                *src;
+    void                      *dst;
+    uint8_t                   *luma;
+    int                       width;
+    int                       height;
+};
 
-static int xsharpen_rgb_frame(XsharpenPrivateData *mfd, vframe_list_t *frame)
+/* Minimum and maximum of the 3x3 windows around the pixels 1..width-2
+   of the luma row `lrow', to lumamin/lumamax[1..width-2]. */
+static void xsharpen_range(const XsharpenPrivateData *mfd, int band,
+                           const uint8_t *lrow, int width,
+                           uint8_t **lumamin, uint8_t **lumamax)
 {
-    const PixDim    width  = frame->v_width;
-    const PixDim    height = frame->v_height;
-    Pixel32         *src= NULL, *dst = NULL;
-    int             x, y;
-    int             r, g, b, R, G, B;
-    Pixel32         p, min=1000, max=-1;
-    int             luma, lumac, lumamax, lumamin, mindiff, maxdiff;
-    const int       srcpitch = frame->v_width*sizeof(Pixel32);
-    const int       dstpitch = frame->v_width*sizeof(Pixel32);
-
-    Pixel32 *dst_buf = NULL;
-    Pixel32 *src_buf = NULL;
-
-    tcv_convert(mfd->tcvhandle, frame->video_buf,
-                (uint8_t *)mfd->convertFrameIn, frame->v_width, frame->v_height,
-                IMG_RGB24, IMG_BGRA32);
-
-    src_buf = mfd->convertFrameIn;
-    dst_buf = mfd->convertFrameOut;
+    uint8_t *rowmin = mfd->tmp + band * 4 * width;
+    uint8_t *rowmax = rowmin + width;
+    const uint8_t *rows[3];
+
+    *lumamin = rowmax + width;
+    *lumamax = *lumamin + width;
+
+    rows[0] = lrow - width;
+    rows[1] = lrow;
+    rows[2] = lrow + width;
+    ac_rows_min(rows, 3, rowmin, width);
+    ac_rows_max(rows, 3, rowmax, width);
+
+    rows[0] = rowmin;
+    rows[1] = rowmin + 1;
+    rows[2] = rowmin + 2;
+    ac_rows_min(rows, 3, *lumamin + 1, width - 2);
+    rows[0] = rowmax;
+    rows[1] = rowmax + 1;
+    rows[2] = rowmax + 2;
+    ac_rows_max(rows, 3, *lumamax + 1, width - 2);
+}
 
-    /* First copy through the four border lines. */
-    src = src_buf;
-    dst = dst_buf;
-    for (x = 0; x < width; x++){
-        dst[x] = src[x];
-    }
-    src = (Pixel *)((char *)src_buf + (height - 1) * srcpitch);
-    dst = (Pixel *)((char *)dst_buf + (height - 1) * dstpitch);
-    for (x = 0; x < width; x++){
-        dst[x] = src[x];
-    }
-    src = src_buf;
-    dst = dst_buf;
-    for (y = 0; y < height; y++){
-        dst[0] = src[0];
-        dst[width-1] = src[width-1];
-        src = (Pixel *)((char *)src + srcpitch);
-        dst = (Pixel *)((char *)dst + dstpitch);
+/* Calculate and store the pixel luminances. */
+static void xsharpen_luma_rows(void *datum, int band, int first, int last)
+{
+    const XsharpenFrame *fr = datum;
+    const Pixel32 *src = (const Pixel32 *)fr->src + first * fr->width;
+    uint8_t *luma = fr->luma + first * fr->width;
+    int i, r, g, b;
+
+    for (i = 0; i < (last - first) * fr->width; i++) {
+        r = (src[i] >> 16) & 0xff;
+        g = (src[i] >> 8) & 0xff;
+        b = src[i] & 0xff;
+        luma[i] = (55 * r + 182 * g + 19 * b) >> 8;
     }
+}
 
-    /* Now calculate and store the pixel luminances for the remaining pixels. */
-    src = src_buf;
-    for (y = 0; y < height; y++){
-        for (x = 0; x < width; x++){
-            r = (src[x] >> 16) & 0xff;
-            g = (src[x] >> 8) & 0xff;
-            b = src[x] & 0xff;
-            luma = (55 * r + 182 * g + 19 * b) >> 8;
-            src[x] &= 0x00ffffff;
-            src[x] |= (luma << 24);
+/* The first pixel of the 3x3 window around src[x] (in the order the
+   original search went) with the given luma, with its luma in the top
+   byte. */
+static Pixel32 xsharpen_pick(const Pixel32 *src, const uint8_t *lrow,
+                             int width, int x, int luma)
+{
+    int dx, dy;
+
+    for (dy = -width; dy <= width; dy += width) {
+        for (dx = -1; dx <= 1; dx++) {
+            if (lrow[dy + x + dx] == luma) {
+                return (src[dy + x + dx] & 0x00ffffff) | ((Pixel32)luma << 24);
+            }
         }
-        src = (Pixel *)((char *)src + srcpitch);
     }
+    return src[x];  /* not reached */
+}
 
-    /* Finally run the 3x3 rank-order sharpening kernel over the pixels. */
-    src = (Pixel *)((char *)src_buf + srcpitch);
-    dst = (Pixel *)((char *)dst_buf + dstpitch);
-    for (y = 1; y < height - 1; y++){
-        for (x = 1; x < width - 1; x++){
-            /* Find the brightest and dimmest pixels in the 3x3 window
-            surrounding the current pixel. */
-            lumamax = -1;
-            lumamin = 1000;
-
-            SEARCH_RGB_LUMA(((char *)src - srcpitch), x);
-
-            p = src[x-1];
-            luma = p >> 24;
-            UPDATE_RGB_RANGE(p, luma);
+/* Run the 3x3 rank-order sharpening kernel over the pixels. */
+static void xsharpen_rgb_rows(void *datum, int band, int first, int last)
+{
+    const XsharpenFrame *fr = datum;
+    const XsharpenPrivateData *mfd = fr->mfd;
+    const PixDim    width  = fr->width;
+    const Pixel32   *src = NULL;
+    Pixel32         *dst = NULL;
+    const uint8_t   *lrow = NULL;
+    uint8_t         *lumamin, *lumamax;
+    int             x, y;
+    int             r, g, b, R, G, B;
+    Pixel32         p;
+    int             lumac, mindiff, maxdiff;
 
-            p = src[x];
-            lumac = luma = p >> 24;
-            UPDATE_RGB_RANGE(p, luma);
+    for (y = TC_MAX(first, 1); y < TC_MIN(last, fr->height - 1); y++) {
+        src  = (const Pixel32 *)fr->src + y * width;
+        dst  = (Pixel32 *)fr->dst + y * width;
+        lrow = fr->luma + y * width;
 
-            p = src[x+1];
-            luma = p >> 24;
-            UPDATE_RGB_RANGE(p, luma);
+        xsharpen_range(mfd, band, lrow, width, &lumamin, &lumamax);
 
-            SEARCH_RGB_LUMA(((char *)src + srcpitch), x);
+        for (x = 1; x < width - 1; x++){
+            lumac = lrow[x];
 
             /* Determine whether the current pixel is closer to the
                brightest or the dimmest pixel. Then compare the current
@@ -395,15 +427,15 @@ static int xsharpen_rgb_frame(XsharpenPrivateData *mfd, vframe_list_t *frame)
                otherwise pass it through. */
             p = -1;
             if (mfd->strength != 0){
-                mindiff = lumac - lumamin;
-                maxdiff = lumamax - lumac;
+                mindiff = lumac - lumamin[x];
+                maxdiff = lumamax[x] - lumac;
                 if (mindiff > maxdiff) {
                     if (maxdiff < mfd->threshold) {
-                        p = max;
+                        p = xsharpen_pick(src, lrow, width, x, lumamax[x]);
                     }
                 } else {
                     if (mindiff < mfd->threshold) {
-                        p = min;
+                        p = xsharpen_pick(src, lrow, width, x, lumamin[x]);
                     }
                 }
             }
@@ -422,91 +454,84 @@ static int xsharpen_rgb_frame(XsharpenPrivateData *mfd, vframe_list_t *frame)
                 dst[x] = (r << 16) | (g << 8) | b;
             }
         }
-        src = (Pixel *)((char *)src + srcpitch);
-        dst = (Pixel *)((char *)dst + dstpitch);
     }
+}
 
-    tcv_convert(mfd->tcvhandle, (uint8_t *)mfd->convertFrameOut,
-                frame->video_buf, frame->v_width, frame->v_height,
-                IMG_BGRA32, IMG_RGB24);
+static int xsharpen_rgb_frame(XsharpenPrivateData *mfd, vframe_list_t *frame)
+{
+    const PixDim    width  = frame->v_width;
+    const PixDim    height = frame->v_height;
+    Pixel32         *src= NULL, *dst = NULL;
+    int             x, y;
+    Pixel32         *dst_buf = NULL;
+    Pixel32         *src_buf = NULL;
+    XsharpenFrame   fr;
 
-    return TC_OK;
-}
+    tcv_convert(mfd->tcvhandle, frame->video_buf,
+                (uint8_t *)mfd->convertFrameIn, frame->v_width, frame->v_height,
+                IMG_RGB24, IMG_BGRA32);
 
-#undef UPDATE_RGB_RANGE
+    src_buf = mfd->convertFrameIn;
+    dst_buf = mfd->convertFrameOut;
 
-#define UPDATE_YUV_RANGE(luma) do { \
-    if (luma > lumamax) { \
-        lumamax = luma; \
-    } \
-    if (luma < lumamin) { \
-        lumamin = luma; \
-    } \
-} while (0)
+    /* First copy through the four border lines. */
+    src = src_buf;
+    dst = dst_buf;
+    for (x = 0; x < width; x++){
+        dst[x] = src[x];
+    }
+    src = src_buf + (height - 1) * width;
+    dst = dst_buf + (height - 1) * width;
+    for (x = 0; x < width; x++){
+        dst[x] = src[x];
+    }
+    src = src_buf;
+    dst = dst_buf;
+    for (y = 0; y < height; y++){
+        dst[0] = src[0];
+        dst[width-1] = src[width-1];
+        src += width;
+        dst += width;
+    }
 
+    fr.mfd    = mfd;
+    fr.src    = src_buf;
+    fr.dst    = dst_buf;
+    fr.luma   = mfd->luma;
+    fr.width  = width;
+    fr.height = height;
+    tc_thread_bands(mfd->threads, height, xsharpen_luma_rows, &fr);
+    tc_thread_bands(mfd->threads, height, xsharpen_rgb_rows, &fr);
 
-#define SEARCH_YUV_LUMA(PTR, X) do { \
-    luma = (PTR)[(X)-1] & 0xff; \
-    UPDATE_YUV_RANGE(luma); \
-    luma = (PTR)[(X)]   & 0xff; \
-    UPDATE_YUV_RANGE(luma); \
-    luma = (PTR)[(X)+1] & 0xff; \
-    UPDATE_YUV_RANGE(luma); \
-} while (0)
+    tcv_convert(mfd->tcvhandle, (uint8_t *)mfd->convertFrameOut,
+                frame->video_buf, frame->v_width, frame->v_height,
+                IMG_BGRA32, IMG_RGB24);
 
+    return TC_OK;
+}
 
-static int xsharpen_yuv_frame(XsharpenPrivateData *mfd, vframe_list_t *frame)
+/* Run the 3x3 rank-order sharpening kernel over the luma. */
+static void xsharpen_yuv_rows(void *datum, int band, int first, int last)
 {
-    const PixDim       width = frame->v_width;
-    const PixDim       height = frame->v_height;
-    char              *src, *dst;
+    const XsharpenFrame *fr = datum;
+    const XsharpenPrivateData *mfd = fr->mfd;
+    const PixDim       width = fr->width;
+    const uint8_t     *src;
+    uint8_t           *dst;
+    uint8_t           *lumamin, *lumamax;
     int                x, y;
-    int                luma = 0, lumac = 0, lumamax, lumamin;
-    int                p, mindiff, maxdiff;
-    const int          srcpitch = frame->v_width;
-    const int          dstpitch = frame->v_width;
+    int                lumac, p, mindiff, maxdiff;
 
-    char *src_buf = frame->video_buf;
+    for (y = TC_MAX(first, 1); y < TC_MIN(last, fr->height - 1); y++) {
+        src = (const uint8_t *)fr->src + y * width;
+        dst = (uint8_t *)fr->dst + y * width;
 
-    /* First copy through the four border lines. */
-    /* first */
-    src = src_buf;
-    dst = mfd->dst_buf;
-    ac_memcpy(dst, src, width);
+        xsharpen_range(mfd, band, src, width, &lumamin, &lumamax);
 
-    /* last */
-    src = src_buf+srcpitch*(height-1);
-    dst = mfd->dst_buf+dstpitch*(height-1);
-    ac_memcpy(dst, src, width);
-
-    /* copy Cb and Cr */
-    ac_memcpy(mfd->dst_buf+dstpitch*height,
-              src_buf+srcpitch*height,
-              width*height>>1);
-
-    src = src_buf;
-    dst = mfd->dst_buf;
-    for (y = 0; y < height; y++){
-        *dst = *src;
-        *(dst+width-1) = *(src+width-1);
-        dst += dstpitch;
-        src += srcpitch;
-    }
-
-    src = src_buf + srcpitch;
-    dst = mfd->dst_buf + dstpitch;
-
-    /* Finally run the 3x3 rank-order sharpening kernel over the pixels. */
-    for (y = 1; y < height - 1; y++){
+        dst[0] = src[0];
+        dst[width-1] = src[width-1];
         for (x = 1; x < width - 1; x++){
-            /* Find the brightest and dimmest pixels in the 3x3 window
-               surrounding the current pixel. */
-            lumamax = -1000;
-            lumamin = 1000;
-
-            SEARCH_YUV_LUMA((src - srcpitch), x);
-            SEARCH_YUV_LUMA( src,             x);
-            SEARCH_YUV_LUMA((src + srcpitch), x);
+            lumac = src[x];
 
             /* Determine whether the current pixel is closer to the
                brightest or the dimmest pixel. Then compare the current
@@ -516,31 +541,48 @@ static int xsharpen_yuv_frame(XsharpenPrivateData *mfd, vframe_list_t *frame)
 
             p = -1;
             if (mfd->strength != 0){
-                mindiff = lumac   - lumamin;
-                maxdiff = lumamax - lumac;
+                mindiff = lumac      - lumamin[x];
+                maxdiff = lumamax[x] - lumac;
                 if (mindiff > maxdiff){
                     if (maxdiff < mfd->threshold)
-                    p = lumamax & 0xff;
+                    p = lumamax[x];
                 } else {
                     if (mindiff < mfd->threshold)
-                    p = lumamin & 0xff;
+                    p = lumamin[x];
                 }
             }
             if (p == -1) {
                 dst[x] = src[x];
             } else {
                 int t;
-                lumac = src[x] & 0xff;
                 t = ((mfd->strength*p + mfd->strengthInv*lumac)/255) & 0xff;
                 t = TC_CLAMP(t, 16, 240);
                 dst[x] = t & 0xff;
             }
         }
-        src += srcpitch;
-        dst += dstpitch;
     }
+}
 
-    ac_memcpy(frame->video_buf, mfd->dst_buf, width*height*3/2);
+static int xsharpen_yuv_frame(XsharpenPrivateData *mfd, vframe_list_t *frame)
+{
+    const PixDim       width = frame->v_width;
+    const PixDim       height = frame->v_height;
+    XsharpenFrame      fr;
+
+    /* The borders and the chroma are left alone: only the inner luma
+       rows are sharpened in dst_buf and copied back. */
+    fr.mfd    = mfd;
+    fr.src    = frame->video_buf;
+    fr.dst    = mfd->dst_buf;
+    fr.luma   = NULL;
+    fr.width  = width;
+    fr.height = height;
+    tc_thread_bands(mfd->threads, height, xsharpen_yuv_rows, &fr);
+
+    if (height > 2) {
+        ac_memcpy(frame->video_buf + width, mfd->dst_buf + width,
+                  width * (height - 2));
+    }
     return TC_OK;
 }
 
@@ -616,6 +658,10 @@ static int xsharpen_get_config(TCModuleInstance *self, char *options)
         "How close a pixel must be to the brightest or dimmest pixel to be mapped",
         "%d", buf, "0", "255");
 
+    tc_snprintf(buf, sizeof(buf), "%d", mfd->threads);
+    optstr_param(options, "threads", "Bands of rows processed in parallel",
+                 "%d", buf, "1", "16");
+
     return TC_OK;
 }
 
@@ -25,7 +25,7 @@
  */
 
 #define MOD_NAME    "filter_transform.so"
-#define MOD_VERSION "v0.77 (2010-05-02)"
+#define MOD_VERSION "v0.78 (2026-10-18)"
 #define MOD_CAP     "transforms each frame according to transformations\n\
  given in an input file (e.g. translation, rotate) see also filter stabilize"
 #define MOD_AUTHOR  "Georg Martius"
@@ -40,7 +40,10 @@
 #include "libtc/libtc.h"
 #include "libtc/tccodecs.h"
 #include "libtcutil/optstr.h"
+#include "libtcutil/tcthread.h"
 #include "libtcmodule/tcmodule-plugin.h"
+#include "libtcvideo/tcvideo.h"
+#include "aclib/ac.h"
 
 #include "transform.h"
 
@@ -90,6 +93,9 @@ typedef struct {
     int optzoom;      // 1: determine optimal zoom, 0: nothing
     int interpoltype; // type of interpolation: 0->Zero,1->Lin,2->BiLin,3->Sqr
     double sharpen;   // amount of sharpening
+    int threads;      // number of row bands transformed in parallel
+
+    TCVHandle tcvhandle; // for the bi-linear transformation
 
     char input[TC_BUF_LINE];
     FILE* f;
@@ -125,6 +131,7 @@ static const char transform_help[] = ""
     "                3: quadratic 4: bi-cubic\n"
     "    'sharpen'   amount of sharpening: 0: no sharpening (def: 0.8)\n"
     "                uses filter unsharp with 5x5 matrix\n"
+    "    'threads'   row bands transformed in parallel (def: 1)\n"
     "    'help'      print this help message\n";
 
 /* forward declarations, please look below for documentation*/
@@ -340,6 +347,110 @@ void interpolateN(unsigned char *rv, float x, float y,
 }
 
 
+/* one plane to transform with tcv_affine(), in bands of rows */
+typedef struct {
+    TCVHandle handle;
+    const unsigned char *src;
+    unsigned char *dest;
+    int width_src, height_src;
+    int width_dest, height_dest;
+    int N;             // bytes per pixel
+    double matrix[6];  // destination to source coordinates
+    int fill;          // value outside the source, -1: keep destination
+} TransformPlane;
+
+static void transform_rows(void *datum, int band, int first, int last)
+{
+    const TransformPlane *pl = datum;
+    tcv_affine(pl->handle, pl->src, pl->width_src, pl->height_src, pl->N,
+               pl->dest, pl->width_dest, pl->height_dest,
+               pl->matrix, pl->fill, first, last);
+}
+
+/** 
+ * transform_plane: rotates, scales and translates one plane with
+ *  bi-linear interpolation, computing the source coordinates
+ *      p_s = M^{-1}(p_d - c_d) + c_s
+ *  incrementally in fixed point (see transformYUV)
+ *
+ * Parameters:
+ *             td: private data structure of this filter
+ *        src,dest: source and destination plane
+ *  width,height_*: dimensions of the source and destination plane
+ *               N: bytes per pixel
+ *  zcos_a, zsin_a: scaled cos and sin of the rotation angle
+ *        c_d_x/y: destination center
+ *        c_s_x/y: source center (minus translation)
+ *            fill: value outside the source, -1: keep destination
+ * Return value:  None
+ */
+static void transform_plane(TransformData* td, 
+                            const unsigned char *src, 
+                            int width_src, int height_src,
+                            unsigned char *dest, 
+                            int width_dest, int height_dest, int N,
+                            float zcos_a, float zsin_a, 
+                            float c_d_x, float c_d_y, 
+                            float c_s_x, float c_s_y, int fill)
+{
+    TransformPlane pl;
+    pl.handle      = td->tcvhandle;
+    pl.src         = src;
+    pl.dest        = dest;
+    pl.width_src   = width_src;
+    pl.height_src  = height_src;
+    pl.width_dest  = width_dest;
+    pl.height_dest = height_dest;
+    pl.N           = N;
+    pl.fill        = fill;
+    pl.matrix[0]   =  zcos_a;
+    pl.matrix[1]   =  zsin_a;
+    pl.matrix[2]   = -zcos_a * c_d_x - zsin_a * c_d_y + c_s_x;
+    pl.matrix[3]   = -zsin_a;
+    pl.matrix[4]   =  zcos_a;
+    pl.matrix[5]   =  zsin_a * c_d_x - zcos_a * c_d_y + c_s_y;
+    tc_thread_bands(td->threads, height_dest, transform_rows, &pl);
+}
+
+/** 
+ * shift_plane: translates one plane by whole pixels
+ *
+ * Parameters:
+ *        src,dest: source and destination plane
+ *  width,height_*: dimensions of the source and destination plane
+ *               N: bytes per pixel
+ *           tx,ty: translation
+ *            fill: value outside the source, -1: keep destination
+ * Return value:  None
+ */
+static void shift_plane(const unsigned char *src, 
+                        int width_src, int height_src,
+                        unsigned char *dest, 
+                        int width_dest, int height_dest, int N,
+                        int tx, int ty, int fill)
+{
+    int y;
+    /* destination columns with a source pixel */
+    int x_s = TC_MAX(tx, 0);
+    int x_e = TC_MIN(width_src + tx, width_dest);
+
+    for (y = 0; y < height_dest; y++) {
+        unsigned char* row = dest + y * width_dest * N;
+        int y_s = y - ty;
+        if (y_s < 0 || y_s >= height_src || x_s >= x_e) {
+            if (fill >= 0)
+                memset(row, fill, width_dest * N);
+            continue;
+        }
+        if (fill >= 0) {
+            memset(row, fill, x_s * N);
+            memset(row + x_e * N, fill, (width_dest - x_e) * N);
+        }
+        ac_memcpy(row + x_s * N, src + (y_s * width_src + x_s - tx) * N,
+                  (x_e - x_s) * N);
+    }
+}
+
 /** 
  * transformRGB: applies current transformation to frame
  * Parameters:
@@ -352,7 +463,6 @@ void interpolateN(unsigned char *rv, float x, float y,
 int transformRGB(TransformData* td)
 {
     Transform t;
-    int x = 0, y = 0, z = 0;
     unsigned char *D_1, *D_2;
     t = td->trans[td->current_trans];
   
@@ -373,42 +483,17 @@ int transformRGB(TransformData* td)
      */
     /* All 3 channels */
     if (fabs(t.alpha) > td->rotation_threshhold) {
-        for (x = 0; x < td->width_dest; x++) {
-            for (y = 0; y < td->height_dest; y++) {
-                float x_d1 = (x - c_d_x);
-                float y_d1 = (y - c_d_y);
-                float x_s  =  cos(-t.alpha) * x_d1 
-                    + sin(-t.alpha) * y_d1 + c_s_x -t.x;
-                float y_s  = -sin(-t.alpha) * x_d1 
-                    + cos(-t.alpha) * y_d1 + c_s_y -t.y;                
-                for (z = 0; z < 3; z++) { // iterate over colors 
-                    unsigned char* dest = &D_2[(x + y * td->width_dest)*3+z];
-                    interpolateN(dest, x_s, y_s, D_1, 
-                                 td->width_src, td->height_src, 
-                                 3, z, td->crop ? 16 : *dest);
-                }
-            }
-        }
+        transform_plane(td, D_1, td->width_src, td->height_src,
+                        D_2, td->width_dest, td->height_dest, 3,
+                        cos(-t.alpha), sin(-t.alpha), c_d_x, c_d_y,
+                        c_s_x - t.x, c_s_y - t.y, td->crop ? 16 : -1);
      }else { 
         /* no rotation, just translation 
          *(also no interpolation, since no size change (so far) 
          */
-        int round_tx = myround(t.x);
-        int round_ty = myround(t.y);
-        for (x = 0; x < td->width_dest; x++) {
-            for (y = 0; y < td->height_dest; y++) {
-                for (z = 0; z < 3; z++) { // iterate over colors
-                    short p = PIXELN(D_1, x - round_tx, y - round_ty, 
-                                     td->width_src, td->height_src, 3, z, -1);
-                    if (p == -1) {
-                        if (td->crop == 1)
-                            D_2[(x + y * td->width_dest)*3+z] = 16;
-                    } else {
-                        D_2[(x + y * td->width_dest)*3+z] = (unsigned char)p;
-                    }
-                }
-            }
-        }
+        shift_plane(D_1, td->width_src, td->height_src,
+                    D_2, td->width_dest, td->height_dest, 3,
+                    myround(t.x), myround(t.y), td->crop == 1 ? 16 : -1);
     }
     return 1;
 }
@@ -454,7 +539,14 @@ int transformYUV(TransformData* td)
      *      p_s = M^{-1}(p_d - c_d - t) + c_s
      */
     /* Luminance channel */
-    if (fabs(t.alpha) > td->rotation_threshhold || t.zoom != 0) {
+    if ((fabs(t.alpha) > td->rotation_threshhold || t.zoom != 0)
+        && td->interpoltype == 2) {
+        /* bi-linear: fixed point, SIMD and threads */
+        transform_plane(td, Y_1, td->width_src, td->height_src,
+                        Y_2, td->width_dest, td->height_dest, 1,
+                        zcos_a, zsin_a, c_d_x, c_d_y, 
+                        c_s_x - t.x, c_s_y - t.y, td->crop ? 16 : -1);
+    } else if (fabs(t.alpha) > td->rotation_threshhold || t.zoom != 0) {
         for (x = 0; x < td->width_dest; x++) {
             for (y = 0; y < td->height_dest; y++) {
                 float x_d1 = (x - c_d_x);
@@ -473,20 +565,9 @@ int transformYUV(TransformData* td)
         /* no rotation, no zooming, just translation 
          *(also no interpolation, since no size change) 
          */
-        int round_tx = myround(t.x);
-        int round_ty = myround(t.y);
-        for (x = 0; x < td->width_dest; x++) {
-            for (y = 0; y < td->height_dest; y++) {
-                short p = PIXEL(Y_1, x - round_tx, y - round_ty, 
-                                td->width_src, td->height_src, -1);
-                if (p == -1) {
-                    if (td->crop == 1)
-                        Y_2[x + y * td->width_dest] = 16;
-                } else {
-                    Y_2[x + y * td->width_dest] = (unsigned char)p;
-                }
-            }
-        }
+        shift_plane(Y_1, td->width_src, td->height_src,
+                    Y_2, td->width_dest, td->height_dest, 1,
+                    myround(t.x), myround(t.y), td->crop == 1 ? 16 : -1);
     }
 
     /* Color channels */
@@ -494,7 +575,17 @@ int transformYUV(TransformData* td)
     int wd2 = td->width_dest/2;
     int hs2 = td->height_src/2;
     int hd2 = td->height_dest/2;
-    if (fabs(t.alpha) > td->rotation_threshhold || t.zoom != 0) {
+    if ((fabs(t.alpha) > td->rotation_threshhold || t.zoom != 0)
+        && td->interpoltype == 2) {
+        transform_plane(td, Cr_1, ws2, hs2, Cr_2, wd2, hd2, 1,
+                        zcos_a, zsin_a, c_d_x/2, c_d_y/2, 
+                        (c_s_x - t.x)/2, (c_s_y - t.y)/2, 
+                        td->crop ? 128 : -1);
+        transform_plane(td, Cb_1, ws2, hs2, Cb_2, wd2, hd2, 1,
+                        zcos_a, zsin_a, c_d_x/2, c_d_y/2, 
+                        (c_s_x - t.x)/2, (c_s_y - t.y)/2, 
+                        td->crop ? 128 : -1);
+    } else if (fabs(t.alpha) > td->rotation_threshhold || t.zoom != 0) {
         for (x = 0; x < wd2; x++) {
             for (y = 0; y < hd2; y++) {
                 float x_d1 = x - (c_d_x)/2;
@@ -514,23 +605,10 @@ int transformYUV(TransformData* td)
     } else { // no rotation, no zoom, no interpolation, just translation 
         int round_tx2 = myround(t.x/2.0);
         int round_ty2 = myround(t.y/2.0);        
-        for (x = 0; x < wd2; x++) {
-            for (y = 0; y < hd2; y++) {
-                short cr = PIXEL(Cr_1, x - round_tx2, y - round_ty2, 
-                                 wd2, hd2, -1);
-                short cb = PIXEL(Cb_1, x - round_tx2, y - round_ty2, 
-                                 wd2, hd2, -1);
-                if (cr == -1) {
-                    if (td->crop==1) { 
-                        Cr_2[x + y * wd2] = 128;
-                        Cb_2[x + y * wd2] = 128;
-                    }
-                } else {
-                    Cr_2[x + y * wd2] = (unsigned char)cr;
-                    Cb_2[x + y * wd2] = (unsigned char)cb;
-                }
-            }
-        }
+        shift_plane(Cr_1, wd2, hd2, Cr_2, wd2, hd2, 1,
+                    round_tx2, round_ty2, td->crop == 1 ? 128 : -1);
+        shift_plane(Cb_1, wd2, hd2, Cb_2, wd2, hd2, 1,
+                    round_tx2, round_ty2, td->crop == 1 ? 128 : -1);
     }
     return 1;
 }
@@ -755,6 +833,12 @@ static int transform_init(TCModuleInstance *self, uint32_t features)
         tc_log_error(MOD_NAME, "init: out of memory!");
         return TC_ERROR;
     }
+    td->tcvhandle = tcv_init();
+    if (!td->tcvhandle) {
+        tc_log_error(MOD_NAME, "tcv_init() failed");
+        tc_free(td);
+        return TC_ERROR;
+    }
     self->userdata = td;
     if (verbose) {
         tc_log_info(MOD_NAME, "%s %s", MOD_VERSION, MOD_CAP);
@@ -834,6 +918,7 @@ static int transform_configure(TCModuleInstance *self,
     td->optzoom = 1;
     td->interpoltype = 2; // bi-linear
     td->sharpen = 0.8;
+    td->threads = 1;
   
     if (options != NULL) {
         optstr_get(options, "input", "%[^:]", (char*)&td->input);
@@ -864,8 +949,10 @@ static int transform_configure(TCModuleInstance *self,
         optstr_get(options, "optzoom"  , "%d", &td->optzoom);
         optstr_get(options, "interpol" , "%d", &td->interpoltype);
         optstr_get(options, "sharpen"  , "%lf",&td->sharpen);
+        optstr_get(options, "threads"  , "%d", &td->threads);
     }
     td->interpoltype = TC_MIN(td->interpoltype,4);
+    td->threads = TC_CLAMP(td->threads, 1, TC_THREAD_MAX_BANDS);
     if (verbose) {
         tc_log_info(MOD_NAME, "Image Transformation/Stabilization Settings:");
         tc_log_info(MOD_NAME, "    input     = %s", td->input);
@@ -884,6 +971,7 @@ static int transform_configure(TCModuleInstance *self,
         tc_log_info(MOD_NAME, "    interpol  = %s", 
                     interpoltypes[td->interpoltype]);
         tc_log_info(MOD_NAME, "    sharpen   = %f", td->sharpen);
+        tc_log_info(MOD_NAME, "    threads   = %d", td->threads);
     }
   
     if (td->maxshift > td->width_dest/2
@@ -966,6 +1054,7 @@ static int transform_fini(TCModuleInstance *self)
     TransformData *td = NULL;
     TC_MODULE_SELF_CHECK(self, "fini");
     td = self->userdata;
+    tcv_free(td->tcvhandle);
     tc_free(td);
     self->userdata = NULL;
     return TC_OK;
@@ -1031,6 +1120,7 @@ static int transform_inspect(TCModuleInstance *self,
     CHECKPARAM("optzoom",  "optzoom=%i",   td->optzoom);
     CHECKPARAM("zoom",     "zoom=%f",      td->zoom);
     CHECKPARAM("sharpen",  "sharpen=%f",   td->sharpen);
+    CHECKPARAM("threads",  "threads=%d",   td->threads);
         
     return TC_OK;
 };
@@ -1091,7 +1181,6 @@ TC_FILTER_OLDINTERFACE(transform)
 /*
   TODO:
   - add also linear interapolation
-  - check for optimization, e.g. mmx stuff
 */
 
 /*
@@ -37,5 +37,5 @@ typedef struct {
 void filterDScaler_SSE(TDeinterlaceInfo*, int, int);
 void filterDScaler_3DNOW(TDeinterlaceInfo*, int, int);
 void filterDScaler_MMX(TDeinterlaceInfo*, int, int);
-//void filterDScaler_SSE2(TDeinterlaceInfo*, int, int);
+void filterDScaler_SSE2(TDeinterlaceInfo*, int, int, int);
 
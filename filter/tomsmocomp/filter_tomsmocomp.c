@@ -25,7 +25,7 @@
  */
 
 #define MOD_NAME    "filter_tomsmocomp.so"
-#define MOD_VERSION "v0.1 (2004-07-31)"
+#define MOD_VERSION "v0.2 (2026-10-18)"
 #define MOD_CAP     "Tom's MoComp deinterlacing filter"
 #define MOD_AUTHOR  "Tom Barry et al."
 
@@ -50,7 +50,8 @@ static void help_optstr (void) {
 "\n"
 "  TomsMoComp should run on all MMX machines or higher. It has also has\n"
 "  some added code for 3DNOW instructions for when it is running on a\n"
-"  K6-II or higher and some SSEMMX for P3 & Athlon.\n"
+"  K6-II or higher and some SSEMMX for P3 & Athlon. On x86-64 it uses\n"
+"  SSE2, and can split the frame across several threads.\n"
 "\n"
 "* Options:\n"
 "  topfirst - assume the top field, lines 0,2,4,... should be displayed\n"
@@ -71,7 +72,10 @@ static void help_optstr (void) {
 "    (0 / 1)  Default: 0\n"
 "\n"
 "  cpuflags - Manually set CPU capabilities (expert only) (hex)\n"
-"    (0x08 MMX  0x20 3DNOW  0x80 SSE)  Default: autodetect\n"
+"    (0x08 MMX  0x20 3DNOW  0x80 SSE  0x100 SSE2)  Default: autodetect\n"
+"\n"
+"  threads - bands of lines deinterlaced in parallel (SSE2 only)\n"
+"    (1 .. 16)  Default: 1\n"
 "\n"
 "* Known issues and limitations:\n"
 "  1) Assumes YUV (YUY2 or YV12) Frame Based input.\n"
@@ -112,6 +116,13 @@ static void do_deinterlace (tomsmocomp_t *tmc) {
     }
 
     /* Call dscaler code */
+#ifdef ARCH_X86_64
+    if (tmc->cpuflags & AC_SSE2) {
+	filterDScaler_SSE2 (&tmc->DSinfo,
+			    tmc->SearchEffort, tmc->UseStrangeBob,
+			    tmc->threads);
+    } else
+#else
 #ifdef HAVE_ASM_SSE
     if (tmc->cpuflags & AC_SSE) {
 	filterDScaler_SSE (&tmc->DSinfo,
@@ -130,6 +141,7 @@ static void do_deinterlace (tomsmocomp_t *tmc) {
 			   tmc->SearchEffort, tmc->UseStrangeBob);
     } else
 #endif
+#endif /* ARCH_X86_64 */
     {
 	assert (0);
     }
@@ -173,6 +185,7 @@ int tc_filter(frame_list_t *ptr_, char *options)
 	tmc->SearchEffort   = 11;
 	tmc->UseStrangeBob  = 0;
 	tmc->TopFirst       = 1;
+	tmc->threads        = 1;
 
 	/* video parameters */
 	switch (vob->im_v_codec) {
@@ -201,12 +214,28 @@ int tc_filter(frame_list_t *ptr_, char *options)
 			&tmc->UseStrangeBob);
 	    optstr_get (options, "cpuflags",  "%x",
 			&tmc->cpuflags);
+	    optstr_get (options, "threads",  "%d",
+			&tmc->threads);
 
 	    if (optstr_lookup(options, "help")) {
 		help_optstr ();
 	    }
 	}
 
+	tmc->threads = TC_CLAMP (tmc->threads, 1, TC_THREAD_MAX_BANDS);
+
+#ifdef ARCH_X86_64
+	if (! (tmc->cpuflags & AC_SSE2) || tmc->width < 16) {
+	    tc_log_error (MOD_NAME, "needs SSE2 and a width of at least 16");
+	    return -1;
+	}
+#else
+	if (! (tmc->cpuflags & (AC_SSE|AC_3DNOW|AC_MMX))) {
+	    tc_log_error (MOD_NAME, "needs at least MMX");
+	    return -1;
+	}
+#endif
+
 	/* frame memory */
 	if (! (tmc->framePrev = calloc (1, tmc->size)) ||
 	    ! (tmc->frameIn   = calloc (1, tmc->size)) ||
@@ -229,11 +258,13 @@ int tc_filter(frame_list_t *ptr_, char *options)
 	    tc_log_info(MOD_NAME, "topfirst %s,  searcheffort %d,  usestrangebob %s",
 		   tmc->TopFirst ? "True":"False", tmc->SearchEffort,
 		   tmc->UseStrangeBob ? "True":"False");
-	    tc_log_info(MOD_NAME, "cpuflags%s%s%s%s",
+	    tc_log_info(MOD_NAME, "cpuflags%s%s%s%s%s,  threads %d",
+		   tmc->cpuflags & AC_SSE2 ? " SSE2":"",
 		   tmc->cpuflags & AC_SSE ? " SSE":"",
 		   tmc->cpuflags & AC_3DNOW ? " 3DNOW":"",
 		   tmc->cpuflags & AC_MMX ? " MMX":"",
-		   !(tmc->cpuflags & (AC_SSE|AC_3DNOW|AC_MMX)) ? " None":"");
+		   !(tmc->cpuflags & (AC_SSE2|AC_SSE|AC_3DNOW|AC_MMX))
+		   ? " None":"", tmc->threads);
 	}
 
 	return 0;
@@ -267,7 +298,9 @@ int tc_filter(frame_list_t *ptr_, char *options)
 	tc_snprintf (buf, sizeof(buf), "%d", tmc->UseStrangeBob);
 	optstr_param (options, "usestrangebob", "?Unknown?" ,"%d", buf, "0", "1");
 	tc_snprintf (buf, sizeof(buf), "%02x", tmc->cpuflags);
-	optstr_param (options, "cpuflags", "Manual specification of CPU capabilities" ,"%x", buf, "00", "ff");
+	optstr_param (options, "cpuflags", "Manual specification of CPU capabilities" ,"%x", buf, "00", "1ff");
+	tc_snprintf (buf, sizeof(buf), "%d", tmc->threads);
+	optstr_param (options, "threads", "Bands of lines deinterlaced in parallel" ,"%d", buf, "1", "16");
     }
 
     //----------------------------------
@@ -27,6 +27,7 @@
 #include "filter.h"
 #include "libtc/libtc.h"
 #include "libtcutil/optstr.h"
+#include "libtcutil/tcthread.h"
 #include "libtcvideo/tcvideo.h"
 
 #include <stdint.h>
@@ -39,6 +40,7 @@ typedef struct {
     int SearchEffort;
     int UseStrangeBob;
     int TopFirst;
+    int threads;
 
     int codec;
     int cpuflags;
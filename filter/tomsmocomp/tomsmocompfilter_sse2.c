@@ -0,0 +1,406 @@
+/*
+ *  tomsmocompfilter_sse2.c
+ *
+ *  TomsMoComp algorithm taken from DScaler.
+ *  Copyright (c) 2002 Tom Barry.  All rights reserved.
+ *
+ *  The search loops of SearchLoopTop.inc, WierdBob.inc, StrangeBob.inc,
+ *  the SearchLoop*A*.inc searches and SearchLoopBottom.inc, written
+ *  with SSE2 intrinsics for x86-64, 16 bytes (8 YUY2 pixels) at a time.
+ *  The result is the same as the SSE (and 3DNow!) versions'.
+ *
+ *  This file is part of transcode, a video stream processing tool
+ *
+ *  transcode is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  transcode is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with GNU Make; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ */
+
+#include "dscaler_interface.h"
+#include "libtcutil/tcthread.h"
+
+#ifdef ARCH_X86_64
+
+#include <emmintrin.h>
+
+/* The searches done by each search effort, in this order */
+#define SEARCH_ODDA6    0x0001  /* odd pels 3 to the left and right */
+#define SEARCH_ODDA4    0x0002  /* odd pels 1 to the left and right, diag. */
+#define SEARCH_ODDA2    0x0004  /* odd pels 1 to the left and right */
+#define SEARCH_ODDAH2   0x0008  /* the same, with vertical half pels */
+#define SEARCH_EDGEA8   0x0010  /* even pels 4 to the left and right */
+#define SEARCH_EDGEA    0x0020  /* even pels 2 to the left and right */
+#define SEARCH_VAH      0x0040  /* vertical line, with half pels */
+#define SEARCH_VA       0x0080  /* vertical line */
+#define SEARCH_0A       0x0100  /* center pixel */
+
+#define SEARCH_ODDA     (SEARCH_ODDA4 | SEARCH_ODDA2)
+
+static const struct {
+    int effort;         /* highest SearchEffort using these searches */
+    int searches;
+} search_efforts[] = {
+    {  0, 0 },          /* no search at all: just the bob */
+    {  1, SEARCH_0A },
+    {  3, SEARCH_ODDA2 | SEARCH_0A },
+    {  5, SEARCH_ODDA2 | SEARCH_ODDAH2 | SEARCH_0A },
+    {  9, SEARCH_ODDA | SEARCH_VA | SEARCH_0A },
+    { 11, SEARCH_ODDA | SEARCH_ODDAH2 | SEARCH_VA | SEARCH_0A },
+    { 13, SEARCH_ODDA | SEARCH_ODDAH2 | SEARCH_VAH | SEARCH_VA | SEARCH_0A },
+    { 15, SEARCH_ODDA | SEARCH_EDGEA | SEARCH_VA | SEARCH_0A },
+    { 19, SEARCH_ODDA | SEARCH_ODDAH2 | SEARCH_EDGEA | SEARCH_VAH
+          | SEARCH_VA | SEARCH_0A },
+    { 21, SEARCH_ODDA6 | SEARCH_ODDA | SEARCH_EDGEA | SEARCH_VA
+          | SEARCH_0A },
+    { -1, SEARCH_ODDA6 | SEARCH_ODDA | SEARCH_EDGEA8 | SEARCH_EDGEA
+          | SEARCH_VA | SEARCH_0A },
+};
+
+typedef struct {
+    const uint8_t *pCopySrc, *pCopySrcP;    /* field copied */
+    const uint8_t *pWeaveSrc, *pWeaveSrcP;  /* field interpolated */
+    const uint8_t *pBobBase, *pBobBaseP;    /* copied line above line 1 */
+    uint8_t *pCopyDest, *pWeaveDest;
+    long src_pitch;
+    long dst_pitch2;
+    int rowsize;
+    int FldHeight;
+    int searches;
+    int UseStrangeBob;
+    MEMCPY_FUNC *pMemcpy;
+} TMCFields;
+
+/*************************************************************************/
+
+#define LOAD(p)         _mm_loadu_si128((const __m128i *)(p))
+#define ZERO            _mm_setzero_si128()
+#define BYTES(b)        _mm_set1_epi8((char)(b))
+#define ABSDIFF(a, b)   _mm_or_si128(_mm_subs_epu8(a, b), _mm_subs_epu8(b, a))
+#define IS_ZERO(a)      _mm_cmpeq_epi8(a, ZERO)
+#define SELECT(m, a, b) _mm_or_si128(_mm_and_si128(m, a), \
+                                     _mm_andnot_si128(m, b))
+
+/* Luma bytes of YUY2 */
+#define YMASK           _mm_set1_epi16(0x00FF)
+#define UVMASK          _mm_set1_epi16((short)0xFF00)
+
+/*
+ * MERGE4PIXavg: average `a' and `b' and keep it as the best weave where
+ * they are closer than the best so far, ties going to the new pair.
+ */
+static inline void merge(__m128i a, __m128i b, __m128i *best, __m128i *diffs)
+{
+    __m128i diff = ABSDIFF(a, b);
+    __m128i better = IS_ZERO(_mm_subs_epu8(diff, *diffs));
+
+    *best  = SELECT(better, _mm_avg_epu8(a, b), *best);
+    *diffs = SELECT(better, diff, *diffs);
+}
+
+/* MERGE4PIXavgH: the same with the vertical half pels a1/a2 and b1/b2 */
+static inline void merge_h(__m128i a1, __m128i a2, __m128i b1, __m128i b2,
+                           __m128i *best, __m128i *diffs)
+{
+    merge(_mm_avg_epu8(a1, a2), _mm_avg_epu8(b1, b2), best, diffs);
+}
+
+/*
+ * StrangeBob.inc, one condition: where |x - y| <= DiffThres and `far'
+ * (ff or 00), take avg(x, y) as the bob value.
+ */
+static inline void strange_bob_pair(__m128i x, __m128i y, __m128i far,
+                                    __m128i *found, __m128i *bob,
+                                    __m128i *diffs)
+{
+    __m128i diff = ABSDIFF(x, y);
+    __m128i cond = _mm_and_si128(IS_ZERO(_mm_subs_epu8(diff, BYTES(0x0F))),
+                                 far);
+    __m128i keep = _mm_xor_si128(cond, *found);
+
+    *bob   = _mm_or_si128(_mm_and_si128(keep, *bob),
+                          _mm_and_si128(cond, _mm_avg_epu8(x, y)));
+    *diffs = _mm_or_si128(_mm_and_si128(keep, *diffs),
+                          _mm_and_si128(cond, diff));
+    *found = _mm_or_si128(_mm_and_si128(keep, *found), cond);
+}
+
+/* ff where |x - y| > DiffThres */
+static inline __m128i far_apart(__m128i x, __m128i y)
+{
+    return _mm_cmpeq_epi8(IS_ZERO(_mm_subs_epu8(ABSDIFF(x, y),
+                                                BYTES(0x0F))),
+                          ZERO);
+}
+
+/*
+ * One 16 byte chunk of a weave line: pBob and pBob + pitch are the copied
+ * lines above and below, pSrc the weave line above, all at the chunk;
+ * the P pointers the same lines of the previous frame.
+ */
+static inline __m128i search_pixels(const TMCFields *f,
+                                    const uint8_t *pBob,
+                                    const uint8_t *pBobP,
+                                    const uint8_t *pSrc,
+                                    const uint8_t *pSrcP)
+{
+    const long pitch = f->src_pitch;
+    const uint8_t *pBob1 = pBob + pitch;
+    __m128i b = LOAD(pBob), e = LOAD(pBob1);
+    __m128i bob, diffs, weave = ZERO, found = ZERO;
+    __m128i lo, hi, min_vals, max_vals, still, better, out;
+
+    /* the bob value, from the current field only:
+     *   j a b c k
+     *       x
+     *   m d e f n
+     */
+    if (f->UseStrangeBob) {
+        bob = ZERO;
+        diffs = ZERO;
+        strange_bob_pair(LOAD(pBob - 4), LOAD(pBob1 + 4),      /* j, n */
+                         far_apart(LOAD(pBob - 2), LOAD(pBob1 - 4)),
+                         &found, &bob, &diffs);
+        strange_bob_pair(LOAD(pBob + 4), LOAD(pBob1 - 4),      /* k, m */
+                         far_apart(LOAD(pBob + 2), LOAD(pBob1 + 4)),
+                         &found, &bob, &diffs);
+        strange_bob_pair(LOAD(pBob + 2), LOAD(pBob1 - 2),      /* c, d */
+                         far_apart(b, LOAD(pBob1 + 2)),
+                         &found, &bob, &diffs);
+        strange_bob_pair(LOAD(pBob - 2), LOAD(pBob1 + 2),      /* a, f */
+                         far_apart(b, LOAD(pBob1 - 2)),
+                         &found, &bob, &diffs);
+        found = _mm_and_si128(found, YMASK);
+        bob   = _mm_and_si128(bob, YMASK);
+        diffs = _mm_and_si128(diffs, YMASK);
+        strange_bob_pair(b, e, _mm_cmpeq_epi8(ZERO, ZERO),     /* b, e */
+                         &found, &bob, &diffs);
+    } else {
+        __m128i a = LOAD(pBob - 2), f1 = LOAD(pBob1 + 2);
+        bob = _mm_avg_epu8(a, f1);
+        diffs = ABSDIFF(a, f1);
+        merge(LOAD(pBob + 2), LOAD(pBob1 - 2), &bob, &diffs);  /* c, d */
+        diffs = _mm_or_si128(diffs, UVMASK);
+        merge(LOAD(pBob - 4), LOAD(pBob1 + 4), &bob, &diffs);  /* j, n */
+        merge(LOAD(pBob + 4), LOAD(pBob1 - 4), &bob, &diffs);  /* k, m */
+    }
+
+    /* clip the bob between b and e, and the final result between them
+     * too unless the top or bottom pixel moved */
+    lo = _mm_min_epu8(b, e);
+    hi = _mm_max_epu8(b, e);
+    bob = _mm_min_epu8(_mm_max_epu8(bob, lo), hi);
+    if (f->searches) {
+        __m128i moved = _mm_max_epu8(ABSDIFF(e, LOAD(pBobP + pitch)),
+                                     ABSDIFF(b, LOAD(pBobP)));
+        moved = _mm_subs_epu8(moved, BYTES(f->UseStrangeBob ? 0x0F : 0x04));
+        still = IS_ZERO(moved);
+        min_vals = _mm_subs_epu8(lo, still);
+        max_vals = _mm_adds_epu8(hi, still);
+    }
+
+    /* avg(b, e) where it is better, or no StrangeBob condition held */
+    better = IS_ZERO(_mm_subs_epu8(ABSDIFF(b, e), diffs));
+    if (f->UseStrangeBob) {
+        better = _mm_or_si128(better, _mm_andnot_si128(found, BYTES(0xFF)));
+    }
+    bob   = SELECT(better, _mm_avg_epu8(b, e), bob);
+    diffs = SELECT(better, ABSDIFF(b, e), diffs);
+
+    if (!f->searches) {
+        return bob;
+    }
+
+    /* now the weave: the best average of a pair of pixels of the two
+     * fields, symmetric about the pixel; the odd addresses don't give
+     * good chroma, so that is reset before the even ones */
+    {
+        const uint8_t *pSrc1 = pSrc + pitch, *pSrc2 = pSrc + 2*pitch;
+        const uint8_t *pSrcP1 = pSrcP + pitch, *pSrcP2 = pSrcP + 2*pitch;
+        const int s = f->searches;
+        __m128i bobdiffs = diffs;
+
+        diffs = BYTES(0xFF);
+
+#define MERGE(p, q) merge(LOAD(p), LOAD(q), &weave, &diffs)
+#define MERGE_DIAGONALS(n) do {                                         \
+    MERGE(pSrcP - (n), pSrc2 + (n));        /* up left, down right */   \
+    MERGE(pSrcP + (n), pSrc2 - (n));        /* up right, down left */   \
+    MERGE(pSrcP1 - (n), pSrc1 + (n));       /* left, right */           \
+    MERGE(pSrcP1 + (n), pSrc1 - (n));       /* right, left */           \
+    MERGE(pSrcP2 - (n), pSrc + (n));        /* down left, up right */   \
+    MERGE(pSrcP2 + (n), pSrc - (n));        /* down right, up left */   \
+} while (0)
+
+        if (s & SEARCH_ODDA6) {
+            MERGE_DIAGONALS(6);
+        }
+        if (s & SEARCH_ODDA4) {
+            MERGE(pSrcP - 2, pSrc2 + 2);
+            MERGE(pSrcP + 2, pSrc2 - 2);
+            MERGE(pSrcP2 - 2, pSrc + 2);
+            MERGE(pSrcP2 + 2, pSrc - 2);
+        }
+        if (s & SEARCH_ODDA2) {
+            MERGE(pSrcP1 - 2, pSrc1 + 2);
+            MERGE(pSrcP1 + 2, pSrc1 - 2);
+        }
+        if (s & SEARCH_ODDAH2) {
+            merge_h(LOAD(pSrcP1 - 2), LOAD(pSrcP1),
+                    LOAD(pSrc1), LOAD(pSrc1 + 2), &weave, &diffs);
+            merge_h(LOAD(pSrcP1 + 2), LOAD(pSrcP1),
+                    LOAD(pSrc1), LOAD(pSrc1 - 2), &weave, &diffs);
+        }
+        diffs = _mm_or_si128(diffs, UVMASK);    /* RESET_CHROMA */
+        if (s & SEARCH_EDGEA8) {
+            MERGE_DIAGONALS(8);
+        }
+        if (s & SEARCH_EDGEA) {
+            MERGE_DIAGONALS(4);
+        }
+        if (s & SEARCH_VAH) {
+            merge_h(LOAD(pSrcP2), LOAD(pSrcP1),
+                    LOAD(pSrc1), LOAD(pSrc), &weave, &diffs);
+            merge_h(LOAD(pSrcP), LOAD(pSrcP1),
+                    LOAD(pSrc1), LOAD(pSrc2), &weave, &diffs);
+        }
+        if (s & SEARCH_VA) {
+            MERGE(pSrcP2, pSrc);                /* down, up */
+            MERGE(pSrcP, pSrc2);                /* up, down */
+        }
+        /* the center, biased toward no motion */
+        diffs = _mm_adds_epu8(diffs, BYTES(0x01));
+        MERGE(pSrcP1, pSrc1);
+
+#undef MERGE_DIAGONALS
+#undef MERGE
+
+        /* the weave if it is about as good as the bob, forgiving the
+         * weave up to 10 of the bob uncertainty and 4 more */
+        bobdiffs = _mm_min_epu8(bobdiffs, BYTES(0x0A));
+        diffs = _mm_subs_epu8(_mm_subs_epu8(diffs, bobdiffs), BYTES(0x04));
+        out = SELECT(IS_ZERO(diffs), weave, bob);
+    }
+
+    /* but clip to catch the stray error */
+    out = _mm_min_epu8(out, max_vals);
+    return _mm_max_epu8(out, min_vals);
+}
+
+/*************************************************************************/
+
+/* Interpolates the weave lines first..last-1 of the frame. */
+static void search_lines(void *datum, int band, int first, int last)
+{
+    const TMCFields *f = datum;
+    const long pitch = f->src_pitch;
+    int y;
+
+    for (y = first; y < last; y++) {
+        const uint8_t *pCopy = f->pCopySrc + y*pitch;
+        uint8_t *pWeaveDest = f->pWeaveDest + y*f->dst_pitch2;
+
+        f->pMemcpy(f->pCopyDest + y*f->dst_pitch2, pCopy, f->rowsize);
+
+        if (y == 0 || y == f->FldHeight - 1) {
+            /* 1st and last weave lines are just copied */
+            f->pMemcpy(pWeaveDest, pCopy, f->rowsize);
+        } else {
+            const uint8_t *pBob  = f->pBobBase  + (y-1)*pitch;
+            const uint8_t *pBobP = f->pBobBaseP + (y-1)*pitch;
+            const uint8_t *pSrc  = f->pWeaveSrc  + (y-1)*pitch;
+            const uint8_t *pSrcP = f->pWeaveSrcP + (y-1)*pitch;
+            const int Last8 = f->rowsize - 8;
+            __m128i bob;
+            int x;
+
+            /* simple bob first and last 8 bytes */
+            bob = _mm_avg_epu8(_mm_loadl_epi64((const __m128i *)pBob),
+                               _mm_loadl_epi64((const __m128i *)
+                                               (pBob + pitch)));
+            _mm_storel_epi64((__m128i *)pWeaveDest, bob);
+            bob = _mm_avg_epu8(_mm_loadl_epi64((const __m128i *)
+                                               (pBob + Last8)),
+                               _mm_loadl_epi64((const __m128i *)
+                                               (pBob + Last8 + pitch)));
+            _mm_storel_epi64((__m128i *)(pWeaveDest + Last8), bob);
+
+            /* then the middle, 16 bytes at a time; the last chunk may
+             * overlap the one before (each only depends on the source) */
+            for (x = 8; x < Last8; x += 16) {
+                if (x + 16 > Last8) {
+                    x = Last8 - 16;
+                }
+                _mm_storeu_si128((__m128i *)(pWeaveDest + x),
+                                 search_pixels(f, pBob + x, pBobP + x,
+                                               pSrc + x, pSrcP + x));
+            }
+        }
+    }
+}
+
+void filterDScaler_SSE2(TDeinterlaceInfo *pInfo, int SearchEffort,
+                        int UseStrangeBob, int threads)
+{
+    TMCFields f;
+    int i;
+
+    f.src_pitch     = pInfo->InputPitch;
+    f.dst_pitch2    = 2 * pInfo->OverlayPitch;
+    f.rowsize       = pInfo->LineLength;
+    f.FldHeight     = pInfo->FieldHeight;
+    f.UseStrangeBob = UseStrangeBob;
+    f.pMemcpy       = pInfo->pMemcpy;
+
+    f.pCopySrc   = pInfo->PictureHistory[1]->pData;
+    f.pCopySrcP  = pInfo->PictureHistory[3]->pData;
+    f.pWeaveSrc  = pInfo->PictureHistory[0]->pData;
+    f.pWeaveSrcP = pInfo->PictureHistory[2]->pData;
+
+    if (pInfo->PictureHistory[0]->Flags & PICTURE_INTERLACED_ODD) {
+        // odd field: copy the even field and weave the odd one
+        f.pCopyDest  = pInfo->Overlay;
+        f.pWeaveDest = pInfo->Overlay + pInfo->OverlayPitch;
+        f.pBobBase   = f.pCopySrc + f.src_pitch;
+        f.pBobBaseP  = f.pCopySrcP + f.src_pitch;
+    } else {
+        // even field: copy the odd field and weave the even one
+        f.pCopyDest  = pInfo->Overlay + pInfo->OverlayPitch;
+        f.pWeaveDest = pInfo->Overlay;
+        f.pBobBase   = f.pCopySrc;
+        f.pBobBaseP  = f.pCopySrcP;
+    }
+
+    for (i = 0; search_efforts[i].effort >= 0; i++) {
+        if (SearchEffort <= search_efforts[i].effort) {
+            break;
+        }
+    }
+    f.searches = search_efforts[i].searches;
+
+    tc_thread_bands(threads, f.FldHeight, search_lines, &f);
+}
+
+#endif  /* ARCH_X86_64 */
+
+/*************************************************************************/
+
+/*
+ * Local variables:
+ *   c-file-style: "stroustrup"
+ *   c-file-offsets: ((case-label . *) (statement-case-intro . *))
+ *   indent-tabs-mode: nil
+ * End:
+ *
+ * vim: expandtab shiftwidth=4:
+ */
@@ -1,4 +1,5 @@
 #include "src/transcode.h"
+#include "libtcutil/tcthread.h"
 
 #include <unistd.h>
 #include <string.h>
@@ -11,9 +12,13 @@
 #include "denoise.h"
 
 extern struct DNSR_GLOBAL denoiser;
-extern struct DNSR_VECTOR vector;
-extern struct DNSR_VECTOR varray44[8];
-extern struct DNSR_VECTOR varray22[8];
+
+/* the frame being searched, split in horizontal stripes of blocks */
+struct DNSR_BANDS
+{
+  int       yoff;                            /* first line of the image */
+  uint32_t  bad_vector[TC_THREAD_MAX_BANDS]; /* bad matches, per band    */
+};
 
 /* pointer on optimized deinterlacer
  * defined in deinterlace.c
@@ -200,12 +205,12 @@ low_contrast_block (int x, int y)
 }
 
 void
-move_block (int x, int y)
+move_block (struct DNSR_VECTOR *vector, int x, int y)
 {
-  int qx = vector.x/2;
-  int qy = vector.y/2;
-  int sx = vector.x-(qx<<1);
-  int sy = vector.y-(qy<<1);
+  int qx = vector->x/2;
+  int qy = vector->y/2;
+  int sx = vector->x-(qx<<1);
+  int sy = vector->y-(qy<<1);
   int dx,dy;
   uint16_t w = denoiser.frame.w;
 
@@ -588,10 +593,101 @@ sharpen_frame(void)
   }
 }
 
+/*****************************************************************************
+ * motion compensate all the blocks of one band.                             *
+ * Bands only write their own blocks of frame.tmp and of the current vector  *
+ * field, and predictors come from the left neighbour or from the last       *
+ * frame, so the result does not depend on the number of bands.              *
+ *****************************************************************************/
+
+static void
+search_band (void *datum, int band, int first, int last)
+{
+  struct DNSR_BANDS  *bands = datum;
+  struct DNSR_VECTOR *cur  = denoiser.vfield[denoiser.vfield_cur];
+  struct DNSR_VECTOR *last_field = denoiser.vfield[denoiser.vfield_cur^1];
+  struct DNSR_VECTOR  vector;
+  struct DNSR_VECTOR  pred[3];
+  int bw = (denoiser.frame.w+7)/8;
+  int bh = (denoiser.frame.h+7)/8;
+  int y0 = bands->yoff + 8*first;
+  int y1 = bands->yoff + 8*last;
+  int npred;
+  int b;
+  uint16_t x,y;
+
+  for(y=y0;y<y1;y+=8) {
+    for(x=0;x<denoiser.frame.w;x+=8)
+    {
+      b = ((y-bands->yoff)/8)*bw + x/8;
+
+      vector.x=0;
+      vector.y=0;
+      vector.SAD=0;
+
+      if( !low_contrast_block(x,y) &&
+        x>(denoiser.border.x) && y>(denoiser.border.y+32) &&
+        x<(denoiser.border.x+denoiser.border.w) && y<(denoiser.border.y+32+denoiser.border.h)
+        )
+      {
+        if(denoiser.predict)
+        {
+          npred=0;
+          if(x>0)
+            pred[npred++]=cur[b-1];
+          pred[npred++]=last_field[b];
+          if(b+bw<bw*bh)
+            pred[npred++]=last_field[b+bw];
+          mb_search_44_pred(&vector,x,y,pred,npred);
+        }
+        else
+          mb_search_44(&vector,x,y);
+        mb_search_22(&vector,x,y);
+        mb_search_11(&vector,x,y);
+        if (mb_search_00(&vector,x,y) > denoiser.block_thres) bands->bad_vector[band]++;
+      }
+
+      if  ( !( (vector.x+x)>0 &&
+	       (vector.x+x)<W &&
+	       (vector.y+y)>32 &&
+	       (vector.y+y)<(32+H) ) )
+      {
+        vector.x=0;
+        vector.y=0;
+      }
+      move_block(&vector,x,y);
+      cur[b]=vector;
+    }
+  }
+}
+
+/*****************************************************************************
+ * split the frame in row bands and search them in parallel.                 *
+ * Returns the number of blocks where motion estimation failed.              *
+ *****************************************************************************/
+
+static uint32_t
+search_frame (int yoff)
+{
+  struct DNSR_BANDS bands;
+  int rows = (denoiser.frame.h+7)/8;
+  int n, i;
+  uint32_t bad_vector = 0;
+
+  bands.yoff = yoff;
+  memset(bands.bad_vector, 0, sizeof(bands.bad_vector));
+
+  n = tc_thread_bands(denoiser.threads, rows, search_band, &bands);
+  for(i=0;i<n;i++)
+    bad_vector += bands.bad_vector[i];
+
+  denoiser.vfield_cur ^= 1;
+  return bad_vector;
+}
+
 void
 denoise_frame(void)
 {
-  uint16_t x,y;
   uint32_t bad_vector = 0;
 
   /* adjust contrast for luma and chroma */
@@ -612,38 +708,7 @@ denoise_frame(void)
     subsample_frame (denoiser.frame.sub2avg,denoiser.frame.avg);
     subsample_frame (denoiser.frame.sub4avg,denoiser.frame.sub2avg);
 
-    for(y=32;y<(denoiser.frame.h+32);y+=8) {
-      for(x=0;x<denoiser.frame.w;x+=8)
-      {
-        vector.x=0;
-        vector.y=0;
-
-        if( !low_contrast_block(x,y) &&
-          x>(denoiser.border.x) && y>(denoiser.border.y+32) &&
-          x<(denoiser.border.x+denoiser.border.w) && y<(denoiser.border.y+32+denoiser.border.h)
-          )
-        {
-        mb_search_44(x,y);
-        mb_search_22(x,y);
-        mb_search_11(x,y);
-        if (mb_search_00(x,y) > denoiser.block_thres) bad_vector++;
-        }
-
-        if  ( (vector.x+x)>0 &&
-	            (vector.x+x)<W &&
-	            (vector.y+y)>32 &&
-	            (vector.y+y)<(32+H) )
-        {
-    	    move_block(x,y);
-        }
-        else
-        {
-          vector.x=0;
-          vector.y=0;
-    	    move_block(x,y);
-        }
-      }
-    }
+    bad_vector = search_frame(32);
 
     /* scene change? */
     if ( denoiser.do_reset &&
@@ -680,37 +745,7 @@ denoise_frame(void)
       /* if lines are twice as wide as normal the offset is only 16 lines
        * despite 32 in progressive mode...
        */
-      for(y=16;y<(denoiser.frame.h+16);y+=8)
-        for(x=0;x<denoiser.frame.w;x+=8)
-        {
-          vector.x=0;
-          vector.y=0;
-
-          if(!low_contrast_block(x,y) &&
-            x>(denoiser.border.x) && y>(denoiser.border.y+32) &&
-            x<(denoiser.border.x+denoiser.border.w) && y<(denoiser.border.y+32+denoiser.border.h)
-            )
-          {
-          mb_search_44(x,y);
-          mb_search_22(x,y);
-          mb_search_11(x,y);
-          mb_search_00(x,y);
-          }
-
-          if  ( (vector.x+x)>0 &&
-	            (vector.x+x)<W &&
-	            (vector.y+y)>32 &&
-	            (vector.y+y)<(32+H) )
-          {
-    	      move_block(x,y);
-          }
-          else
-          {
-            vector.x=0;
-            vector.y=0;
-    	      move_block(x,y);
-          }
-        }
+      search_frame(16);
 
       /* process the fields in one image again */
       denoiser.frame.h *= 2;
@@ -2,7 +2,8 @@ void denoise_frame(void);
 void black_border (void);
 void contrast_frame (void);
 int  low_contrast_block (int x, int y);
-void move_block (int x, int y);
+struct DNSR_VECTOR;
+void move_block (struct DNSR_VECTOR *vector, int x, int y);
 void average_frame (void);
 void difference_frame (void);
 void correct_frame2 (void);
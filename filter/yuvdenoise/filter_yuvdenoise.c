@@ -23,7 +23,7 @@
  */
 
 #define MOD_NAME    "filter_yuvdenoise.so"
-#define MOD_VERSION "v0.2.1 (2003-11-26)"
+#define MOD_VERSION "v0.3.0 (2026-10-18)"
 #define MOD_CAP     "mjpegs YUV denoiser"
 #define MOD_AUTHOR  "Stefan Fendt, Tilmann Bitterberg"
 
@@ -142,6 +142,12 @@ int tc_filter(frame_list_t *ptr_, char *options)
 	denoiser.border.x, denoiser.border.y, denoiser.border.w, denoiser.border.h);
       optstr_param (options, "border",         "Active image area", "%dx%d-%dx%d", buf, "0", "W", "0", "H", "0", "W", "0", "H");
 
+      tc_snprintf (buf, sizeof(buf), "%d", denoiser.predict);
+      optstr_param (options, "predict",        "Seed motion search with neighbour vectors", "%d", buf, "0", "1" );
+
+      tc_snprintf (buf, sizeof(buf), "%d", denoiser.threads);
+      optstr_param (options, "threads",        "Row bands searched in parallel", "%d", buf, "1", "16" );
+
       optstr_param (options, "pre",   "run this filter as a pre-processing filter","%d", "0", "0", "1"  );
 
 
@@ -184,6 +190,10 @@ int tc_filter(frame_list_t *ptr_, char *options)
     denoiser.increment_cb    = 2;
     denoiser.increment_cr    = 2; /* maybe more? */
 
+    denoiser.predict         = 1;
+    denoiser.threads         = 1;
+    denoiser.vfield_cur      = 0;
+
 
     /* process commandline */
     if (options) {
@@ -204,6 +214,8 @@ int tc_filter(frame_list_t *ptr_, char *options)
 	if (optstr_get (options, "do_reset",       "%d", &t1) >= 0) denoiser.do_reset=t1;
 	if (optstr_get (options, "increment_cr",   "%d", &t1) >= 0) denoiser.increment_cr=t1;
 	if (optstr_get (options, "increment_cb",   "%d", &t1) >= 0) denoiser.increment_cb=t1;
+	if (optstr_get (options, "predict",        "%d", &t1) >= 0) denoiser.predict = t1&0xff;
+	if (optstr_get (options, "threads",        "%d", &t1) >= 0) denoiser.threads = t1&0xff;
 
 	if (optstr_get (options, "border",         "%dx%d-%dx%d", &t1, &t2, &t3, &t4) >= 0) {
 	    denoiser.border.x = t1&0xffff; denoiser.border.y = t2&0xffff;
@@ -221,6 +233,12 @@ int tc_filter(frame_list_t *ptr_, char *options)
         } else if(denoiser.radius>24) {
   	      tc_log_warn (MOD_NAME, "Maximum suggested search radius is 24 pixel.");
         }
+        if(denoiser.threads<1) {
+          denoiser.threads=1;
+        } else if(denoiser.threads>DNSR_MAX_THREADS) {
+          denoiser.threads=DNSR_MAX_THREADS;
+  	      tc_log_warn (MOD_NAME, "Maximum allowed threads are %d.", DNSR_MAX_THREADS);
+        }
         if(denoiser.delay<1) {
           denoiser.delay=1;
   	      tc_log_warn (MOD_NAME, "Minimum allowed frame delay is 1.");
@@ -386,9 +404,9 @@ int tc_filter(frame_list_t *ptr_, char *options)
 }
 
 
-static uint8_t *alloc_buf(size_t size)
+static void *alloc_buf(size_t size)
 {
-  uint8_t *ret = (uint8_t *)malloc(size);
+  void *ret = malloc(size);
   if( ret == NULL )
     tc_log_error(MOD_NAME, "Out of memory: could not allocate buffer" );
   return ret;
@@ -400,6 +418,7 @@ void allc_buffers(void)
 {
   int luma_buffsize = denoiser.frame.w * denoiser.frame.h;
   int chroma_buffsize = (denoiser.frame.w * denoiser.frame.h) / 4;
+  int vfield_size;
 
   /* now, the MC-functions really(!) do go beyond the vertical
    * frame limits so we need to make the buffers larger to avoid
@@ -454,6 +473,16 @@ void allc_buffers(void)
   denoiser.frame.sub4avg[Yy] = alloc_buf (luma_buffsize);
   denoiser.frame.sub4avg[Cr] = alloc_buf (chroma_buffsize);
   denoiser.frame.sub4avg[Cb] = alloc_buf (chroma_buffsize);
+
+  /* enough blocks for both progressive and interlaced (field) layout */
+  vfield_size = ((denoiser.frame.w+7)/8) * 2 * ((denoiser.frame.h+7)/8 + 1)
+                * sizeof(struct DNSR_VECTOR);
+  denoiser.vfield[0] = alloc_buf (vfield_size);
+  denoiser.vfield[1] = alloc_buf (vfield_size);
+  if (denoiser.vfield[0] && denoiser.vfield[1]) {
+    memset (denoiser.vfield[0], 0, vfield_size);
+    memset (denoiser.vfield[1], 0, vfield_size);
+  }
 }
 
 
@@ -490,6 +519,12 @@ void free_buffers(void)
       denoiser.frame.sub4ref[i] = NULL;
       denoiser.frame.sub4avg[i] = NULL;
     }
+
+  for (i = 0; i < 2; i++)
+    {
+      free (denoiser.vfield[i]);
+      denoiser.vfield[i] = NULL;
+    }
 }
 
 // ***
@@ -518,16 +553,24 @@ void print_settings(void)
     tc_log_info(MOD_NAME, " SceneChange Reset: %s\n",(denoiser.do_reset==0)? "Off":"On");
     tc_log_info(MOD_NAME, " increment_cr     : %d\n",denoiser.increment_cr);
     tc_log_info(MOD_NAME, " increment_cb     : %d\n",denoiser.increment_cb);
+    tc_log_info(MOD_NAME, " Predictive search: %s\n",(denoiser.predict==0)? "Off":"On");
+    tc_log_info(MOD_NAME, " Search threads   : %d\n",denoiser.threads);
     tc_log_info(MOD_NAME, " \n");
 
 }
 
 void turn_on_accels(void)
 {
-/* XXX: very weird effects, #undef'ed in global.h -- tibit */
-#ifdef HAVE_ASM_MMX
   uint32_t CPU_CAP = tc_get_session()->acceleration; /* XXX ugly */
+  const char *accel = NULL;
 
+  calc_SAD    = &calc_SAD_noaccel;
+  calc_SAD_uv = &calc_SAD_uv_noaccel;
+  calc_SAD_half = &calc_SAD_half_noaccel;
+  deinterlace = &deinterlace_noaccel;
+
+/* the MMX routines use 32-bit addressing, they are empty on x86-64 */
+#if defined(HAVE_ASM_MMX) && defined(ARCH_X86)
   if( (CPU_CAP & AC_MMXEXT)!=0 ||
       (CPU_CAP & AC_SSE   )!=0
     ) /* MMX+SSE */
@@ -536,8 +579,7 @@ void turn_on_accels(void)
     calc_SAD_uv = &calc_SAD_uv_mmxe;
     calc_SAD_half = &calc_SAD_half_mmxe;
     deinterlace = &deinterlace_mmx;
-    if (filter_verbose)
-	tc_log_info(MOD_NAME, "Using extended MMX SIMD optimisations.");
+    accel = "extended MMX";
   }
   else
     if( (CPU_CAP & AC_MMX)!=0 ) /* MMX */
@@ -546,19 +588,26 @@ void turn_on_accels(void)
       calc_SAD_uv = &calc_SAD_uv_mmx;
       calc_SAD_half = &calc_SAD_half_mmx;
       deinterlace = &deinterlace_mmx;
-      if (filter_verbose)
-	  tc_log_info(MOD_NAME, "Using MMX SIMD optimisations.");
+      accel = "MMX";
     }
-    else
 #endif
-    {
-      calc_SAD    = &calc_SAD_noaccel;
-      calc_SAD_uv = &calc_SAD_uv_noaccel;
-      calc_SAD_half = &calc_SAD_half_noaccel;
-      deinterlace = &deinterlace_noaccel;
-      if (filter_verbose)
-	  tc_log_info(MOD_NAME, "Sorry, no SIMD optimisations available.");
-    }
+
+#if defined(HAVE_ASM_SSE2) && (defined(ARCH_X86) || defined(ARCH_X86_64))
+  if( (CPU_CAP & AC_SSE2)!=0 ) /* SSE2, SAD only */
+  {
+    calc_SAD    = &calc_SAD_sse2;
+    calc_SAD_uv = &calc_SAD_uv_sse2;
+    calc_SAD_half = &calc_SAD_half_sse2;
+    accel = "SSE2";
+  }
+#endif
+
+  if (filter_verbose) {
+    if (accel)
+      tc_log_info(MOD_NAME, "Using %s SIMD optimisations.", accel);
+    else
+      tc_log_info(MOD_NAME, "Sorry, no SIMD optimisations available.");
+  }
 }
 
 void
@@ -628,7 +677,15 @@ display_help(void)
 "\n"
 "increment_cb <-128..127> Increment Cb with a constant (default=%d)\n"
 "\n"
-"increment_cr <-128..127> Increment Cr with a constant (default=%d)\n",
+"increment_cr <-128..127> Increment Cr with a constant (default=%d)\n"
+"\n"
+"predict <0..1>     [1]: start the motion search from the vectors of the\n"
+"                        neighbour blocks, search exhaustively only where\n"
+"                        they do not match (default)\n"
+"                   [0]: always search the whole radius\n"
+"\n"
+"threads <1..16>    Search that many row bands of the frame in parallel.\n"
+"                   (default=%d)\n",
 		denoiser.threshold,
 		denoiser.delay,
 		denoiser.radius,
@@ -643,8 +700,9 @@ display_help(void)
 		denoiser.do_reset,
 		denoiser.block_thres,
 		denoiser.scene_thres,
+		denoiser.increment_cb,
 		denoiser.increment_cr,
-		denoiser.increment_cb
+		denoiser.threads
 		);
 }
 
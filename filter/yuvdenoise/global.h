@@ -31,6 +31,16 @@
 // should always be defined
 #define HAVE_FILTER_IO_BUF
 
+struct DNSR_VECTOR
+{
+  int8_t  x;
+  int8_t  y;
+  uint32_t SAD;
+};
+
+/* upper limit for the number of row bands searched in parallel */
+#define DNSR_MAX_THREADS 16
+
 struct DNSR_GLOBAL
   {
     /* denoiser mode */
@@ -67,6 +77,14 @@ struct DNSR_GLOBAL
     int32_t   increment_cr;
     int32_t   increment_cb;
 
+    /* Motion search */
+    uint8_t   predict;   /* seed the search with neighbour vectors */
+    uint8_t   threads;   /* row bands searched in parallel */
+
+    /* vectors found for every block, in the current and last frame */
+    struct DNSR_VECTOR *vfield[2];
+    int32_t   vfield_cur;
+
     /* Frame information */
     struct
     {
@@ -97,11 +115,4 @@ struct DNSR_GLOBAL
 
   };
 
-struct DNSR_VECTOR
-{
-  int8_t  x;
-  int8_t  y;
-  uint32_t SAD;
-};
-
 #endif
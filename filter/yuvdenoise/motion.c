@@ -22,9 +22,10 @@ uint32_t (*calc_SAD_half)    (uint8_t * , uint8_t * ,uint8_t *);
 /* global denoiser structure defined in main.c and global.h */
 extern struct DNSR_GLOBAL denoiser;
 
-struct DNSR_VECTOR vector;
-struct DNSR_VECTOR varray44[8];
-struct DNSR_VECTOR varray22[8];
+/* The search functions below do not keep any state of their own: the
+ * vector being refined is passed in by the caller, so several row bands
+ * of the same frame can be searched concurrently (see denoise.c).
+ */
 
 /*****************************************************************************
  * generate a lowpassfiltered and subsampled copy                            *
@@ -141,7 +142,7 @@ calc_SAD_noaccel (uint8_t * frm, uint8_t * ref)
 uint32_t
 calc_SAD_mmx (uint8_t * frm, uint8_t * ref)
 {
-  static uint16_t a[4];
+  uint16_t a[4] = { 0, 0, 0, 0 };
 
 #ifdef ARCH_X86
 #ifdef HAVE_ASM_MMX
@@ -185,7 +186,7 @@ calc_SAD_mmx (uint8_t * frm, uint8_t * ref)
 uint32_t
 calc_SAD_mmxe (uint8_t * frm, uint8_t * ref)
 {
-  static uint32_t a;
+  uint32_t a = 0;
 
 #ifdef ARCH_X86
 #ifdef HAVE_ASM_MMX
@@ -243,7 +244,7 @@ calc_SAD_uv_noaccel (uint8_t * frm, uint8_t * ref)
 uint32_t
 calc_SAD_uv_mmx (uint8_t * frm, uint8_t * ref)
 {
-  static uint16_t a[4];
+  uint16_t a[4] = { 0, 0, 0, 0 };
 
 #ifdef ARCH_X86
 #ifdef HAVE_ASM_MMX
@@ -286,7 +287,7 @@ calc_SAD_uv_mmx (uint8_t * frm, uint8_t * ref)
 uint32_t
 calc_SAD_uv_mmxe (uint8_t * frm, uint8_t * ref)
 {
-  static uint32_t a;
+  uint32_t a = 0;
 
 #ifdef ARCH_X86
 #ifdef HAVE_ASM_MMX
@@ -344,7 +345,7 @@ calc_SAD_half_noaccel (uint8_t * ref, uint8_t * frm1, uint8_t * frm2)
 uint32_t
 calc_SAD_half_mmx (uint8_t * ref, uint8_t * frm1, uint8_t * frm2)
 {
-  static uint32_t a;
+  uint32_t a = 0;
 #ifdef ARCH_X86
 #ifdef HAVE_ASM_MMX
 
@@ -393,7 +394,7 @@ calc_SAD_half_mmx (uint8_t * ref, uint8_t * frm1, uint8_t * frm2)
 uint32_t
 calc_SAD_half_mmxe (uint8_t * ref, uint8_t * frm1, uint8_t * frm2)
 {
-  static uint32_t a;
+  uint32_t a = 0;
 
 #ifdef ARCH_X86
 #ifdef HAVE_ASM_MMX
@@ -422,6 +423,157 @@ calc_SAD_half_mmxe (uint8_t * ref, uint8_t * frm1, uint8_t * frm2)
   return a;
 }
 
+
+/*********************************************************************
+ *                                                                   *
+ * SAD-function for Y with SSE2                                      *
+ * (two lines per register, works on x86 and x86-64)                 *
+ *                                                                   *
+ *********************************************************************/
+
+uint32_t
+calc_SAD_sse2 (uint8_t * frm, uint8_t * ref)
+{
+  uint32_t a = 0;
+
+#if defined(HAVE_ASM_SSE2) && (defined(ARCH_X86) || defined(ARCH_X86_64))
+  intptr_t w = denoiser.frame.w;
+
+  __asm__ __volatile__
+    (
+    " pxor         %%xmm0 , %%xmm0;        /* clear xmm0                                         */\n"
+    " .rept 4                     ;        /* Loop for 8 lines, two at a time                    */\n"
+    " movq        (%1)    , %%xmm1;        /* 8 Pixels from filtered frame to xmm1 (low)         */\n"
+    " movhps      (%1,%3) , %%xmm1;        /* 8 Pixels from next line to xmm1 (high)             */\n"
+    " movq        (%2)    , %%xmm2;        /* 8 Pixels from reference frame to xmm2 (low)        */\n"
+    " movhps      (%2,%3) , %%xmm2;        /* 8 Pixels from next line to xmm2 (high)             */\n"
+    " psadbw       %%xmm2 , %%xmm1;        /* two partial differences to xmm1                    */\n"
+    " paddd        %%xmm1 , %%xmm0;        /* add result to xmm0                                 */\n"
+    " lea         (%1,%3,2), %1   ;        /* add two framewidths to frameaddress                */\n"
+    " lea         (%2,%3,2), %2   ;        /* add two framewidths to frameaddress                */\n"
+    " .endr                       ;        /* end loop                                           */\n"
+    " movhlps      %%xmm0 , %%xmm1;        /* fold the two partial sums ...                      */\n"
+    " paddd        %%xmm1 , %%xmm0;        /*                                                    */\n"
+    " movd         %%xmm0 , %0    ;        /* make xmm0 available to gcc ...                     */\n"
+    :"=r" (a), "+r" (frm), "+r" (ref)
+    :"r" (w)
+    :"xmm0", "xmm1", "xmm2", "memory"
+    );
+#endif
+  return a;
+}
+
+/*********************************************************************
+ *                                                                   *
+ * SAD-function for UV with SSE2                                     *
+ * (the whole 4x4 block fits in a single register)                   *
+ *                                                                   *
+ *********************************************************************/
+
+uint32_t
+calc_SAD_uv_sse2 (uint8_t * frm, uint8_t * ref)
+{
+  uint32_t a = 0;
+
+#if defined(HAVE_ASM_SSE2) && (defined(ARCH_X86) || defined(ARCH_X86_64))
+  intptr_t w = denoiser.frame.w/2;
+
+  __asm__ __volatile__
+    (
+    " movd        (%1)    , %%xmm1;        /* 4 Pixels of line 0 from filtered frame             */\n"
+    " movd        (%1,%3) , %%xmm3;        /* 4 Pixels of line 1 from filtered frame             */\n"
+    " punpckldq    %%xmm3 , %%xmm1;        /* lines 0-1 in the low quadword of xmm1              */\n"
+    " lea         (%1,%3,2), %1   ;        /* add two framewidths to frameaddress                */\n"
+    " movd        (%1)    , %%xmm3;        /* 4 Pixels of line 2 from filtered frame             */\n"
+    " movd        (%1,%3) , %%xmm4;        /* 4 Pixels of line 3 from filtered frame             */\n"
+    " punpckldq    %%xmm4 , %%xmm3;        /*                                                    */\n"
+    " punpcklqdq   %%xmm3 , %%xmm1;        /* whole 4x4 block of filtered frame in xmm1          */\n"
+    " movd        (%2)    , %%xmm2;        /* same for the reference frame into xmm2             */\n"
+    " movd        (%2,%3) , %%xmm3;        /*                                                    */\n"
+    " punpckldq    %%xmm3 , %%xmm2;        /*                                                    */\n"
+    " lea         (%2,%3,2), %2   ;        /*                                                    */\n"
+    " movd        (%2)    , %%xmm3;        /*                                                    */\n"
+    " movd        (%2,%3) , %%xmm4;        /*                                                    */\n"
+    " punpckldq    %%xmm4 , %%xmm3;        /*                                                    */\n"
+    " punpcklqdq   %%xmm3 , %%xmm2;        /*                                                    */\n"
+    " psadbw       %%xmm2 , %%xmm1;        /* two partial differences to xmm1                    */\n"
+    " movhlps      %%xmm1 , %%xmm0;        /* fold the two partial sums ...                      */\n"
+    " paddd        %%xmm0 , %%xmm1;        /*                                                    */\n"
+    " movd         %%xmm1 , %0    ;        /* make xmm1 available to gcc ...                     */\n"
+    :"=r" (a), "+r" (frm), "+r" (ref)
+    :"r" (w)
+    :"xmm0", "xmm1", "xmm2", "xmm3", "xmm4", "memory"
+    );
+#endif
+  return a;
+}
+
+/*********************************************************************
+ *                                                                   *
+ * halfpel SAD-function for Y with SSE2                              *
+ *                                                                   *
+ *********************************************************************/
+
+uint32_t
+calc_SAD_half_sse2 (uint8_t * ref, uint8_t * frm1, uint8_t * frm2)
+{
+  uint32_t a = 0;
+
+#if defined(HAVE_ASM_SSE2) && (defined(ARCH_X86) || defined(ARCH_X86_64))
+  intptr_t w = denoiser.frame.w;
+
+  __asm__ __volatile__
+    (
+    " pxor         %%xmm0 , %%xmm0;        /* clear xmm0                                         */\n"
+    " .rept 4                     ;        /* Loop for 8 lines, two at a time                    */\n"
+    " movq        (%1)    , %%xmm1;        /* 8+8 Pixels from filtered frame to xmm1             */\n"
+    " movhps      (%1,%4) , %%xmm1;        /*                                                    */\n"
+    " movq        (%2)    , %%xmm2;        /* 8+8 Pixels from filtered frame (displaced)         */\n"
+    " movhps      (%2,%4) , %%xmm2;        /*                                                    */\n"
+    " movq        (%3)    , %%xmm3;        /* 8+8 Pixels from reference frame to xmm3            */\n"
+    " movhps      (%3,%4) , %%xmm3;        /*                                                    */\n"
+    " pavgb        %%xmm2 , %%xmm1;        /* average source pixels                              */\n"
+    " psadbw       %%xmm3 , %%xmm1;        /* two partial differences to xmm1                    */\n"
+    " paddd        %%xmm1 , %%xmm0;        /* add result to xmm0                                 */\n"
+    " lea         (%1,%4,2), %1   ;        /* add two framewidths to frameaddress                */\n"
+    " lea         (%2,%4,2), %2   ;        /*                                                    */\n"
+    " lea         (%3,%4,2), %3   ;        /*                                                    */\n"
+    " .endr                       ;        /* end loop                                           */\n"
+    " movhlps      %%xmm0 , %%xmm1;        /* fold the two partial sums ...                      */\n"
+    " paddd        %%xmm1 , %%xmm0;        /*                                                    */\n"
+    " movd         %%xmm0 , %0    ;        /* make xmm0 available to gcc ...                     */\n"
+    :"=r" (a), "+r" (frm1), "+r" (frm2), "+r" (ref)
+    :"r" (w)
+    :"xmm0", "xmm1", "xmm2", "xmm3", "memory"
+    );
+#endif
+  return a;
+}
+
+/*********************************************************************
+ *                                                                   *
+ * Full cost of a candidate vector in 4 times subsampled frames      *
+ * (used by the predictive search)                                   *
+ *                                                                   *
+ *********************************************************************/
+
+static uint32_t
+calc_SAD_44 (int32_t ref_offset, int32_t ref_offset_uv, int16_t xx, int16_t yy)
+{
+  int32_t  avg_offset    = ref_offset+xx+yy*denoiser.frame.w;
+  int32_t  avg_offset_uv = ref_offset_uv+(xx>>1)+((yy>>1)*(denoiser.frame.w>>1));
+  uint32_t SAD;
+
+  SAD  = calc_SAD ( denoiser.frame.sub4ref[Yy]+ref_offset,
+                    denoiser.frame.sub4avg[Yy]+avg_offset );
+  SAD += calc_SAD_uv ( denoiser.frame.sub4ref[Cr]+ref_offset_uv,
+                       denoiser.frame.sub4avg[Cr]+avg_offset_uv );
+  SAD += calc_SAD_uv ( denoiser.frame.sub4ref[Cb]+ref_offset_uv,
+                       denoiser.frame.sub4avg[Cb]+avg_offset_uv );
+
+  return SAD + xx*xx + yy*yy; /* favour center matches... */
+}
+
 /*********************************************************************
  *                                                                   *
  * Estimate Motion Vectors in 4 times subsampled frames              *
@@ -429,7 +581,7 @@ calc_SAD_half_mmxe (uint8_t * ref, uint8_t * frm1, uint8_t * frm2)
  *********************************************************************/
 
 void
-mb_search_44 (uint16_t x, uint16_t y)
+mb_search_44 (struct DNSR_VECTOR *vector, uint16_t x, uint16_t y)
 {
   uint32_t best_SAD=0x00ffffff;
   uint32_t SAD=0x00ffffff;
@@ -443,14 +595,6 @@ mb_search_44 (uint16_t x, uint16_t y)
   int16_t  xx;
   int16_t  yy;
 
-  SAD = calc_SAD ( denoiser.frame.sub4ref[Yy]+MB_ref_offset,
-                   denoiser.frame.sub4avg[Yy]+MB_ref_offset );
-
-  SAD += calc_SAD_uv ( denoiser.frame.sub4ref[Cr]+MB_ref_offset_uv,
-                       denoiser.frame.sub4avg[Cr]+MB_ref_offset_uv );
-  SAD += calc_SAD_uv ( denoiser.frame.sub4ref[Cb]+MB_ref_offset_uv,
-                       denoiser.frame.sub4avg[Cb]+MB_ref_offset_uv );
-
   for(yy=-radius;yy<radius;yy++) {
     for(xx=-radius;xx<radius;xx++)
     {
@@ -476,11 +620,99 @@ mb_search_44 (uint16_t x, uint16_t y)
       {
         best_SAD = SAD;
 
-        vector.x = xx;
-        vector.y = yy;
+        vector->x = xx;
+        vector->y = yy;
+      }
+    }
+  }
+}
+
+/*********************************************************************
+ *                                                                   *
+ * Predictive search in 4 times subsampled frames:                   *
+ * try the zero vector and the given predictors (half-pel vectors    *
+ * of neighbour blocks), then refine the best one with a small       *
+ * diamond. Falls back to mb_search_44 if nothing matches well.      *
+ *                                                                   *
+ *********************************************************************/
+
+static const int8_t diamond_x[4] = { 1, -1, 0,  0 };
+static const int8_t diamond_y[4] = { 0,  0, 1, -1 };
+
+void
+mb_search_44_pred (struct DNSR_VECTOR *vector, uint16_t x, uint16_t y,
+                   const struct DNSR_VECTOR *pred, int npred)
+{
+  int16_t  radius = denoiser.radius>>2;       /* search radius /4 in pixels */
+  int32_t  MB_ref_offset = denoiser.frame.w * (y>>2) + (x>>2);
+  int32_t  MB_ref_offset_uv = (denoiser.frame.w>>1) * (y>>3) + (x>>3);
+  uint32_t best_SAD;
+  uint32_t SAD;
+  int16_t  bx = 0;
+  int16_t  by = 0;
+  int16_t  cx;
+  int16_t  cy;
+  int      i;
+  int      step;
+  int      moved;
+
+  best_SAD = calc_SAD_44 (MB_ref_offset, MB_ref_offset_uv, 0, 0);
+
+  for(i=0;i<npred;i++)
+  {
+    /* half-pel full resolution -> 4 times subsampled */
+    cx = pred[i].x/8;
+    cy = pred[i].y/8;
+    cx = (cx< -radius)? -radius : (cx>=radius)? radius-1 : cx;
+    cy = (cy< -radius)? -radius : (cy>=radius)? radius-1 : cy;
+
+    if(cx==bx && cy==by)
+      continue;
+
+    SAD = calc_SAD_44 (MB_ref_offset, MB_ref_offset_uv, cx, cy);
+    if(SAD<best_SAD)
+    {
+      best_SAD = SAD;
+      bx = cx;
+      by = cy;
+    }
+  }
+
+  /* the predictors are of no use here, search the whole area */
+  if(best_SAD > 96*denoiser.threshold)
+  {
+    mb_search_44 (vector, x, y);
+    return;
+  }
+
+  for(step=0;step<radius;step++)
+  {
+    int16_t ox = bx;
+    int16_t oy = by;
+
+    moved = 0;
+    for(i=0;i<4;i++)
+    {
+      cx = ox+diamond_x[i];
+      cy = oy+diamond_y[i];
+      if(cx< -radius || cx>=radius || cy< -radius || cy>=radius)
+        continue;
+
+      SAD = calc_SAD_44 (MB_ref_offset, MB_ref_offset_uv, cx, cy);
+      if(SAD<best_SAD)
+      {
+        best_SAD = SAD;
+        bx = cx;
+        by = cy;
+        moved = 1;
       }
     }
+    if(!moved)
+      break;
   }
+
+  vector->x = bx;
+  vector->y = by;
 }
 
 /*********************************************************************
@@ -490,7 +722,7 @@ mb_search_44 (uint16_t x, uint16_t y)
  *********************************************************************/
 
 void
-mb_search_22 (uint16_t x, uint16_t y)
+mb_search_22 (struct DNSR_VECTOR *vector, uint16_t x, uint16_t y)
 {
   uint32_t best_SAD=0x00ffffff;
   uint32_t SAD=0x00ffffff;
@@ -502,8 +734,8 @@ mb_search_22 (uint16_t x, uint16_t y)
   int32_t  last_uv_offset=0;
   int16_t  xx;
   int16_t  yy;
-  int16_t  vx=vector.x<<1;
-  int16_t  vy=vector.y<<1;
+  int16_t  vx=vector->x<<1;
+  int16_t  vy=vector->y<<1;
 
   /* motion-vectors from 44 can/will be wrong by +/- 3 pixels */
 
@@ -530,13 +762,8 @@ mb_search_22 (uint16_t x, uint16_t y)
       {
         best_SAD = SAD;
 
-        varray22[2]=varray22[1];
-        varray22[1]=varray22[0];
-
-        varray22[0].x = xx+vx;
-        varray22[0].y = yy+vy;
-        vector.x = xx+vx;
-        vector.y = yy+vy;
+        vector->x = xx+vx;
+        vector->y = yy+vy;
       }
     }
 }
@@ -550,7 +777,7 @@ mb_search_22 (uint16_t x, uint16_t y)
  *********************************************************************/
 
 void
-mb_search_11 (uint16_t x, uint16_t y)
+mb_search_11 (struct DNSR_VECTOR *vector, uint16_t x, uint16_t y)
 {
   uint32_t best_SAD = 0x00ffffff;
   uint32_t SAD=0x00ffffff;
@@ -558,8 +785,8 @@ mb_search_11 (uint16_t x, uint16_t y)
   int32_t  MB_avg_offset;
   int16_t  xx;
   int16_t  yy;
-  int16_t  vx=vector.x<<1;
-  int16_t  vy=vector.y<<1;
+  int16_t  vx=vector->x<<1;
+  int16_t  vy=vector->y<<1;
 
   /* motion-vectors from 22 can/will be wrong by +/- 2 pixels */
 
@@ -574,9 +801,9 @@ mb_search_11 (uint16_t x, uint16_t y)
       if(SAD<best_SAD)
       {
         best_SAD = SAD;
-        vector.SAD = SAD;
-        vector.x = xx+vx;
-        vector.y = yy+vy;
+        vector->SAD = SAD;
+        vector->x = xx+vx;
+        vector->y = yy+vy;
       }
     }
 
@@ -587,9 +814,9 @@ mb_search_11 (uint16_t x, uint16_t y)
 
   if(SAD<=best_SAD)
   {
-    vector.x = 0;
-    vector.y = 0;
-    vector.SAD = SAD;
+    vector->x = 0;
+    vector->y = 0;
+    vector->SAD = SAD;
   }
 }
 
@@ -601,7 +828,7 @@ mb_search_11 (uint16_t x, uint16_t y)
  *********************************************************************/
 
 uint32_t
-mb_search_00 (uint16_t x, uint16_t y)
+mb_search_00 (struct DNSR_VECTOR *vector, uint16_t x, uint16_t y)
 {
   uint32_t best_SAD = 0x00ffffff;
   uint32_t SAD;
@@ -610,8 +837,8 @@ mb_search_00 (uint16_t x, uint16_t y)
   int32_t  MB_avg_offset2;
   int16_t  xx;
   int16_t  yy;
-  int16_t  vx=vector.x;
-  int16_t  vy=vector.y;
+  int16_t  vx=vector->x;
+  int16_t  vy=vector->y;
 
   MB_avg_offset1=MB_ref_offset+(vx)+((vy)*denoiser.frame.w);
 
@@ -627,8 +854,8 @@ mb_search_00 (uint16_t x, uint16_t y)
       if(SAD<best_SAD)
       {
         best_SAD = SAD;
-        vector.x = xx+vx*2;
-        vector.y = yy+vy*2;
+        vector->x = xx+vx*2;
+        vector->y = yy+vy*2;
       }
     }
   return best_SAD;
@@ -2,18 +2,24 @@
 void
 subsample_frame (uint8_t * dst[3], uint8_t * src[3]);
 
-/* search steps */
+/* search steps, refining the vector passed in */
+struct DNSR_VECTOR;
+
+void
+mb_search_44 (struct DNSR_VECTOR *vector, uint16_t x, uint16_t y);
+
 void
-mb_search_44 (uint16_t x, uint16_t y);
+mb_search_44_pred (struct DNSR_VECTOR *vector, uint16_t x, uint16_t y,
+                   const struct DNSR_VECTOR *pred, int npred);
 
 void
-mb_search_22 (uint16_t x, uint16_t y);
+mb_search_22 (struct DNSR_VECTOR *vector, uint16_t x, uint16_t y);
 
 void
-mb_search_11 (uint16_t x, uint16_t y);
+mb_search_11 (struct DNSR_VECTOR *vector, uint16_t x, uint16_t y);
 
 uint32_t
-mb_search_00 (uint16_t x, uint16_t y);
+mb_search_00 (struct DNSR_VECTOR *vector, uint16_t x, uint16_t y);
 
 /* no accel */
 uint32_t
@@ -45,3 +51,12 @@ calc_SAD_uv_mmx (uint8_t * frm, uint8_t * ref);
 uint32_t
 calc_SAD_half_mmx (uint8_t * ref, uint8_t * frm1, uint8_t * frm2);
 
+/* SSE2 */
+uint32_t
+calc_SAD_sse2 (uint8_t * frm, uint8_t * ref);
+
+uint32_t
+calc_SAD_uv_sse2 (uint8_t * frm, uint8_t * ref);
+
+uint32_t
+calc_SAD_half_sse2 (uint8_t * ref, uint8_t * frm1, uint8_t * frm2);
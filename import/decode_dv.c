@@ -13,6 +13,7 @@
 #include "libtcvideo/tcvideo.h"
 #include "ioaux.h"  /* for import_exit() prototype */
 #include "tc.h"  /* for function prototypes */
+#include "libtcutil/tcthread.h"
 
 #ifdef HAVE_LIBDV
 # include <libdv/dv.h>
@@ -193,6 +194,260 @@ static int check_yuy2(void)
     return -1;
 }
 
+/*************************************************************************/
+
+/**
+ * set_quality:  Internal routine to translate the tcdecode quality level
+ * into libdv decoder flags.
+ *
+ * Parameters:
+ *     decoder: DV decoder to set up.
+ *     quality: Quality level (1=fastest, 5=best).
+ * Return value:
+ *     None.
+ */
+
+static void set_quality(dv_decoder_t *decoder, int quality)
+{
+    switch (quality) {
+        case 1:  decoder->quality = DV_QUALITY_FASTEST;                 break;
+        case 2:  decoder->quality = DV_QUALITY_AC_1;                    break;
+        case 3:  decoder->quality = DV_QUALITY_AC_2;                    break;
+        case 4:  decoder->quality = DV_QUALITY_AC_1 | DV_QUALITY_COLOR; break;
+        case 5:
+        default: decoder->quality = DV_QUALITY_BEST;                    break;
+    }
+}
+
+/*************************************************************************/
+
+/* Video format parameters shared by all the decoding threads */
+typedef struct {
+    ImageFormat srcfmt, destfmt;
+    dv_color_space_t colorspace;
+    int width, height;
+    int linesize[3], planesize[3];
+    int video_conv_linesize[3];
+} DVVideoFormat;
+
+/* A frame being decoded by a thread; every one has its own decoder */
+typedef struct {
+    const DVVideoFormat *fmt;
+    dv_decoder_t *decoder;
+    TCVHandle tcvhandle;
+    TCThread thread;
+    uint8_t *framebuf;
+    uint8_t *video[3];
+    uint8_t *video_conv_buf[3];
+    int started;
+    int error;
+} DVFrameJob;
+
+/**
+ * decode_video_frame:  Decode a DV frame (whose header was already
+ * parsed by the job decoder) into the job video buffers.  Runs in a
+ * decoding thread.
+ *
+ * Parameters:
+ *        td: Thread data (unused).
+ *     datum: Pointer to the DVFrameJob to process.
+ * Return value:
+ *     TC_OK (errors are reported in the job).
+ */
+
+static int decode_video_frame(TCThreadData *td, void *datum)
+{
+    DVFrameJob *job = datum;
+    const DVVideoFormat *fmt = job->fmt;
+
+    if (fmt->srcfmt == fmt->destfmt) {
+        dv_decode_full_frame(job->decoder, job->framebuf, fmt->colorspace,
+                             job->video, (int *)fmt->linesize);
+        job->error = 0;
+    } else {
+        dv_decode_full_frame(job->decoder, job->framebuf, fmt->colorspace,
+                             job->video_conv_buf,
+                             (int *)fmt->video_conv_linesize);
+        job->error = !tcv_convert(job->tcvhandle, job->video_conv_buf[0],
+                                  job->video[0], fmt->width, fmt->height,
+                                  fmt->srcfmt, fmt->destfmt);
+    }
+    return TC_OK;
+}
+
+static void free_frame_jobs(DVFrameJob *jobs, int njobs)
+{
+    int i;
+
+    for (i = 0; i < njobs; i++) {
+        if (jobs[i].decoder)
+            dv_decoder_free(jobs[i].decoder);
+        if (jobs[i].tcvhandle)
+            tcv_free(jobs[i].tcvhandle);
+        tc_buffree(jobs[i].framebuf);
+        tc_buffree(jobs[i].video[0]);
+        tc_buffree(jobs[i].video_conv_buf[0]);
+    }
+}
+
+static int alloc_frame_jobs(DVFrameJob *jobs, int njobs,
+                            const DVVideoFormat *fmt, int quality)
+{
+    int i, w = fmt->width, h = fmt->height;
+
+    memset(jobs, 0, njobs * sizeof(DVFrameJob));
+    for (i = 0; i < njobs; i++) {
+        DVFrameJob *job = &jobs[i];
+
+        job->fmt = fmt;
+        job->decoder = dv_decoder_new(1, 0, 0);
+        job->tcvhandle = tcv_init();
+        job->framebuf = tc_bufalloc(DV_FRAME_SIZE_625_50);
+        job->video[0] = tc_bufalloc(fmt->planesize[0] + fmt->planesize[1]
+                                    + fmt->planesize[2]);
+        job->video_conv_buf[0] = tc_bufalloc(w * h * 2);
+        if (!job->decoder || !job->tcvhandle || !job->framebuf
+         || !job->video[0] || !job->video_conv_buf[0]) {
+            free_frame_jobs(jobs, i + 1);
+            return -1;
+        }
+        set_quality(job->decoder, quality);
+        job->video[1] = job->video[0] + fmt->planesize[0];
+        job->video[2] = job->video[1] + fmt->planesize[1];
+        job->video_conv_buf[1] = job->video_conv_buf[0] + w * h;
+        job->video_conv_buf[2] = job->video_conv_buf[1] + (w/2) * h;
+    }
+    return 0;
+}
+
+/**
+ * read_frame:  Read the next DV frame from the input stream and parse
+ * its header, skipping unparseable frames.
+ *
+ * Parameters:
+ *      decode: Pointer to decoding parameter structure.
+ *     decoder: Decoder to parse the header with.
+ *    framebuf: Buffer for the frame data.
+ *       ispal: Whether the stream is 625/50 (nonzero) or 525/60 (zero).
+ * Return value:
+ *      1 if a frame was read, 0 at end of stream, -1 on error.
+ */
+
+static int read_frame(decode_t *decode, dv_decoder_t *decoder,
+                      uint8_t *framebuf, int ispal)
+{
+    int toread = ispal ? DV_FRAME_SIZE_625_50 : DV_FRAME_SIZE_525_60;
+
+    for (;;) {
+        if (tc_pread(decode->fd_in, framebuf, toread) != toread) {
+            if (verbose & TC_DEBUG)
+                tc_log_info(__FILE__, "End of stream reached.");
+            return 0;
+        }
+        if (dv_parse_header(decoder, framebuf) >= 0)
+            break;
+        tc_log_warn(__FILE__, "Unable to parse frame header, skipping...");
+    }
+    /* Sanity check: make sure it's the same video system */
+    if (decoder->system != (ispal ? DV_SYSTEM_625_50 : DV_SYSTEM_525_60)) {
+        tc_log_error(__FILE__, "Video system (NTSC/PAL) changed"
+                     " midstream!  Aborting.");
+        return -1;
+    }
+    return 1;
+}
+
+/**
+ * decode_dv_threaded:  Video decoding loop using decode->threads
+ * threads.  DV frames are all intra coded, so a batch of them is read,
+ * decoded in parallel (one libdv decoder per thread) and then written
+ * out in the original order.
+ *
+ * Parameters:
+ *       decode: Pointer to decoding parameter structure.
+ *          fmt: Video format parameters.
+ *     framebuf: First frame of the stream, already read and parsed.
+ *        ispal: Whether the stream is 625/50 (nonzero) or 525/60 (zero).
+ * Return value:
+ *     Nonzero on error, zero otherwise.
+ */
+
+static int decode_dv_threaded(decode_t *decode, const DVVideoFormat *fmt,
+                              const uint8_t *framebuf, int ispal)
+{
+    DVFrameJob jobs[TC_IMPORT_THREADS_MAX];
+    int njobs = TC_MIN(decode->threads, TC_IMPORT_THREADS_MAX);
+    int i, n, ret = 1, error = 0;
+
+    if (alloc_frame_jobs(jobs, njobs, fmt, decode->quality) < 0) {
+        tc_log_error(__FILE__, "No memory for decoding threads!");
+        return 1;
+    }
+    if (verbose & TC_DEBUG)
+        tc_log_info(__FILE__, "decoding video in %d threads", njobs);
+
+    ac_memcpy(jobs[0].framebuf, framebuf,
+              ispal ? DV_FRAME_SIZE_625_50 : DV_FRAME_SIZE_525_60);
+    dv_parse_header(jobs[0].decoder, jobs[0].framebuf);
+    n = 1;
+
+    for (;;) {
+        while (n < njobs) {
+            ret = read_frame(decode, jobs[n].decoder, jobs[n].framebuf,
+                             ispal);
+            if (ret <= 0)
+                break;
+            n++;
+        }
+        if (ret < 0) {
+            error = 1;
+            break;
+        }
+        if (n == 0)
+            break;
+
+        /* The last frame is decoded here, no need for another thread */
+        for (i = 0; i < n - 1; i++) {
+            tc_thread_init(&jobs[i].thread, "dv decode");
+            jobs[i].started = (tc_thread_start(&jobs[i].thread,
+                                               decode_video_frame,
+                                               &jobs[i]) == TC_OK);
+            if (!jobs[i].started)
+                decode_video_frame(NULL, &jobs[i]);
+        }
+        decode_video_frame(NULL, &jobs[n - 1]);
+        for (i = 0; i < n - 1; i++) {
+            if (jobs[i].started)
+                tc_thread_wait(&jobs[i].thread, NULL);
+        }
+
+        for (i = 0; i < n && !error; i++) {
+            if (jobs[i].error) {
+                tc_log_error(__FILE__, "Image format conversion failed!");
+                error = 1;
+            } else if ((fmt->planesize[0]
+                     && tc_pwrite(decode->fd_out, jobs[i].video[0],
+                                  fmt->planesize[0]) != fmt->planesize[0])
+                    || (fmt->planesize[1]
+                     && tc_pwrite(decode->fd_out, jobs[i].video[1],
+                                  fmt->planesize[1]) != fmt->planesize[1])
+                    || (fmt->planesize[2]
+                     && tc_pwrite(decode->fd_out, jobs[i].video[2],
+                                  fmt->planesize[2]) != fmt->planesize[2])
+            ) {
+                tc_log_error(__FILE__, "Write failed: %s", strerror(errno));
+                error = 1;
+            }
+        }
+        if (error || ret == 0)
+            break;
+        n = 0;
+    }
+
+    free_frame_jobs(jobs, njobs);
+    return error;
+}
+
 #endif  // HAVE_LIBDV
 
 /*************************************************************************/
@@ -259,14 +514,7 @@ void decode_dv(decode_t *decode)
         import_exit(1);
         return;
     }
-    switch (decode->quality) {
-        case 1:  decoder->quality = DV_QUALITY_FASTEST;                 break;
-        case 2:  decoder->quality = DV_QUALITY_AC_1;                    break;
-        case 3:  decoder->quality = DV_QUALITY_AC_2;                    break;
-        case 4:  decoder->quality = DV_QUALITY_AC_1 | DV_QUALITY_COLOR; break;
-        case 5:
-        default: decoder->quality = DV_QUALITY_BEST;                    break;
-    }
+    set_quality(decoder, decode->quality);
 
     /**** Set up image formats and line size per plane (*16) ****/
 
@@ -413,6 +661,25 @@ void decode_dv(decode_t *decode)
         }
     }
 
+    /**** Video frames are independent, decode them in parallel ****/
+
+    if (decode->threads > 1 && decode->format != TC_CODEC_PCM) {
+        DVVideoFormat fmt;
+
+        fmt.srcfmt     = srcfmt;
+        fmt.destfmt    = destfmt;
+        fmt.colorspace = colorspace;
+        fmt.width      = decoder->width;
+        fmt.height     = decoder->height;
+        memcpy(fmt.linesize, linesize, sizeof(linesize));
+        memcpy(fmt.planesize, planesize, sizeof(planesize));
+        memcpy(fmt.video_conv_linesize, video_conv_linesize,
+               sizeof(video_conv_linesize));
+
+        error = decode_dv_threaded(decode, &fmt, framebuf, ispal);
+        goto done;
+    }
+
     /**** Decoding loop ****/
 
     for (;;) {
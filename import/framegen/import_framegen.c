@@ -41,14 +41,14 @@
  *%* #INPUT
  *%*
  *%* OUTPUT
- *%*   YUV420P, PCM
+ *%*   YUV420P, YUV422P, RGB24, PCM
  *%*
  *%* #OPTION
  *%*/
 
 /*
  * TODO (unordered):
- * - add more generators (at least a video/RGB one)
+ * - add more generators
  * - review internal generator API
  * -- to emit cooked frames instead of raw bytes it is better?
  * -- need to explicitely separate A/V generators?
@@ -131,13 +131,14 @@ static int framegen_pink_noise_get_data(TCFrameGenSource *handle,
 {
     PinkNoiseData *PN = handle->priv;
     int16_t *samples = (int16_t*)data;
-    int i;
+    int i, count = maxdata / sizeof(int16_t);
 
-    for (i = 0; i < maxdata; i++) {
+    for (i = 0; i < count; i++) {
         int32_t res = generate_pink_noise_sample(&(PN->pink)) * 0x03fffffff; /* Don't use MAX volume */
         samples[i]  = res >> 16;
     }
 
+    *datalen = count * sizeof(int16_t);
     return TC_OK;
 }
 
@@ -184,54 +185,98 @@ struct colorwavedata_ {
     int         width;
     int         height;
     int         index;
+    ImageFormat format;
+    int         size;
+    uint8_t     *buf;       /* YUV420P scratch, if converting */
 };
 
-static int framegen_color_wave_get_data(TCFrameGenSource *handle,
-                                        uint8_t *data, int maxdata, int *datalen)
-
+/* the wave is always drawn in YUV420P, then converted if needed */
+static void framegen_color_wave_draw(ColorWaveData *CW, uint8_t *data)
 {
-    ColorWaveData *CW = handle->priv;
     uint8_t *planes[3] = { NULL, NULL, NULL };
-    int size = CW->width * CW->height * 3 / 2;
     int x, y;
 
-    if (maxdata < size) {
-        return TC_ERROR;
-    }
-
     YUV_INIT_PLANES(planes, data, IMG_YUV_DEFAULT, CW->width, CW->height);
 
-    memset(data, 0x80, size); /* FIXME */
-
     for (y = 0; y < CW->height; y++) {
         for (x = 0; x < CW->width; x++) {
             planes[0][y * CW->width + x] = x + y + CW->index * 3;
         }
     }
 
-	for (y = 0; y < CW->height/2; y++) {
+    for (y = 0; y < CW->height/2; y++) {
         for (x = 0; x < CW->width/2; x++) {
             planes[1][y * CW->width/2 + x] = 128 + y + CW->index * 2;
             planes[2][y * CW->width/2 + x] = 64  + x + CW->index * 5;
          }
     }
-    
+}
+
+static int framegen_color_wave_get_data(TCFrameGenSource *handle,
+                                        uint8_t *data, int maxdata, int *datalen)
+
+{
+    ColorWaveData *CW = handle->priv;
+
+    if (maxdata < CW->size) {
+        return TC_ERROR;
+    }
+
+    if (CW->buf == NULL) {
+        framegen_color_wave_draw(CW, data);
+    } else {
+        uint8_t *src[3] = { NULL, NULL, NULL };
+        uint8_t *dst[3] = { NULL, NULL, NULL };
+
+        framegen_color_wave_draw(CW, CW->buf);
+        YUV_INIT_PLANES(src, CW->buf, IMG_YUV_DEFAULT, CW->width, CW->height);
+        YUV_INIT_PLANES(dst, data, CW->format, CW->width, CW->height);
+        if (!ac_imgconvert(src, IMG_YUV_DEFAULT, dst, CW->format,
+                           CW->width, CW->height)) {
+            return TC_ERROR;
+        }
+    }
+
     CW->index++;
-    *datalen = size;
+    *datalen = CW->size;
 
     return TC_OK;
 }
 
+static int framegen_color_wave_close(TCFrameGenSource *handle)
+{
+    ColorWaveData *CW = handle->priv;
+
+    tc_free(CW->buf);
+    return framegen_generic_close(handle);
+}
+
 static int framegen_color_wave_init(ColorWaveData *CW, TCJob *vob)
 {
-    int ret = TC_ERROR;
-    if (vob->im_v_codec == TC_CODEC_YUV420P) {
-        CW->index   = 0;
-        CW->width   = vob->im_v_width;
-        CW->height  = vob->im_v_height;
-        ret         = TC_OK;
+    CW->index   = 0;
+    CW->width   = vob->im_v_width;
+    CW->height  = vob->im_v_height;
+    CW->buf     = NULL;
+
+    switch (vob->im_v_codec) {
+      case TC_CODEC_YUV420P:
+        CW->format = IMG_YUV420P;
+        CW->size   = CW->width * CW->height * 3 / 2;
+        return TC_OK;
+      case TC_CODEC_YUV422P:
+        CW->format = IMG_YUV422P;
+        CW->size   = CW->width * CW->height * 2;
+        break;
+      case TC_CODEC_RGB24:
+        CW->format = IMG_RGB24;
+        CW->size   = CW->width * CW->height * 3;
+        break;
+      default:
+        return TC_ERROR;
     }
-    return ret;
+
+    CW->buf = tc_malloc(CW->width * CW->height * 3 / 2);
+    return (CW->buf != NULL) ?TC_OK :TC_ERROR;
 }
 
 static TCFrameGenSource *tc_framegen_source_open_video_color_wave(TCJob *vob,
@@ -252,7 +297,7 @@ static TCFrameGenSource *tc_framegen_source_open_video_color_wave(TCJob *vob,
             FG->media       = "video";
 
             FG->get_data    = framegen_color_wave_get_data;
-            FG->close       = framegen_generic_close;
+            FG->close       = framegen_color_wave_close;
         }
     }
     return FG;
@@ -401,7 +446,7 @@ static int tc_framegen_read_audio(TCModuleInstance *self,
 TC_MODULE_DEMUX_FORMATS_CODECS(tc_framegen);
 
 static const TCCodecID tc_framegen_codecs_video_out[] = { 
-    TC_CODEC_YUV420P, TC_CODEC_ERROR,
+    TC_CODEC_YUV420P, TC_CODEC_YUV422P, TC_CODEC_RGB24, TC_CODEC_ERROR,
 };
 
 static const TCCodecID tc_framegen_codecs_audio_out[] = { 
@@ -437,10 +482,10 @@ TC_MODULE_ENTRY_POINT(tc_framegen)
 static TCFrameGenPrivateData mod_framegen;
 
 static int verbose_flag = TC_QUIET;
-static int capability_flag = TC_CAP_YUV|TC_CAP_PCM;
+static int capability_flag = TC_CAP_YUV|TC_CAP_YUV422|TC_CAP_RGB|TC_CAP_PCM;
 
 #define MOD_PRE     framegen
-#define MOD_CODEC   "(video) YUV | (audio) PCM"
+#define MOD_CODEC   "(video) YUV | YUV422 | RGB | (audio) PCM"
 
 #include "import_def.h"
 
@@ -39,6 +39,10 @@
 #define MOD_decode static int RENAME(MOD_PRE, _decode) (transfer_t *param, vob_t *vob)
 #define MOD_close  static int RENAME(MOD_PRE, _close) (transfer_t *param)
 
+/* split decoding, see TC_CAP_SPLIT; define MOD_SPLIT to enable */
+#define MOD_read   static int RENAME(MOD_PRE, _read) (transfer_t *param, vob_t *vob)
+#define MOD_unpack static int RENAME(MOD_PRE, _unpack) (transfer_t *param, vob_t *vob)
+
 
 //extern int verbose_flag;
 //extern int capability_flag;
@@ -67,6 +71,10 @@ MOD_name
 MOD_open;
 MOD_decode;
 MOD_close;
+#ifdef MOD_SPLIT
+MOD_read;
+MOD_unpack;
+#endif
 
 /* ------------------------------------------------------------
  *
@@ -96,6 +104,16 @@ int tc_import(int opt, void *para1, void *para2)
 
       return RENAME(MOD_PRE, _close)((transfer_t *) para1);
 
+#ifdef MOD_SPLIT
+  case TC_IMPORT_READ:
+
+      return RENAME(MOD_PRE, _read)((transfer_t *) para1, (vob_t *) para2);
+
+  case TC_IMPORT_UNPACK:
+
+      return RENAME(MOD_PRE, _unpack)((transfer_t *) para1, (vob_t *) para2);
+#endif
+
   default:
       return(TC_IMPORT_UNKNOWN);
   }
@@ -57,6 +57,7 @@ MOD_open
 
   char cat_buf[TC_BUF_MAX];
   char yuv_buf[16];
+  char thr_buf[16] = "";
   long sret;
 
   if(param->flag == TC_VIDEO) {
@@ -83,6 +84,10 @@ MOD_open
         tc_snprintf(yuv_buf, 16, "-y yuv420p -Y") :
         tc_snprintf(yuv_buf, 16, "-y yuv420p");
 
+    // DV frames are intra-only: let tcdecode use many threads
+    if (vob->im_v_threads > 1)
+        tc_snprintf(thr_buf, 16, " -T %d", vob->im_v_threads);
+
     param->fd = NULL;
     yuv422_mode = 0;
 
@@ -91,9 +96,9 @@ MOD_open
     case TC_CODEC_RGB24:
 
       sret = tc_snprintf(import_cmd_buf, TC_BUF_MAX,
-                      "%s -i \"%s\" -d %d | %s -x dv -y rgb -d %d -Q %d",
+                      "%s -i \"%s\" -d %d | %s -x dv -y rgb -d %d -Q %d%s",
                       cat_buf, vob->video_in_file, vob->verbose,
-                      TCDECODE_EXE, vob->verbose, vob->quality);
+                      TCDECODE_EXE, vob->verbose, vob->quality, thr_buf);
       if (sret < 0)
           return(TC_IMPORT_ERROR);
 
@@ -107,9 +112,9 @@ MOD_open
     case TC_CODEC_YUV420P:
 
       sret = tc_snprintf(import_cmd_buf, TC_BUF_MAX,
-			 "%s -i \"%s\" -d %d | %s -x dv %s -d %d -Q %d",
+			 "%s -i \"%s\" -d %d | %s -x dv %s -d %d -Q %d%s",
 			 cat_buf, vob->video_in_file, vob->verbose,
-             TCDECODE_EXE, yuv_buf, vob->verbose, vob->quality);
+             TCDECODE_EXE, yuv_buf, vob->verbose, vob->quality, thr_buf);
       if (sret < 0)
 	return(TC_IMPORT_ERROR);
 
@@ -129,9 +134,9 @@ MOD_open
 
       sret = tc_snprintf(import_cmd_buf, TC_BUF_MAX,
 			 "%s -i \"%s\" -d %d |"
-			 " %s -x dv -y yuy2 -d %d -Q %d",
+			 " %s -x dv -y yuy2 -d %d -Q %d%s",
 			 cat_buf, vob->video_in_file, vob->verbose,
-             TCDECODE_EXE, vob->verbose, vob->quality);
+             TCDECODE_EXE, vob->verbose, vob->quality, thr_buf);
       if (sret < 0)
         return(TC_IMPORT_ERROR);
 
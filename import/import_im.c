@@ -60,6 +60,12 @@
  *%* OPTION
  *%*   noseq (flag)
  *%*     disable internal auto loading of images with similar names.
+ *%*
+ *%* OPTION
+ *%*   prefetch (integer)
+ *%*     decode up to this many images ahead of the current one, using
+ *%*     --import_threads threads (default: twice the number of threads
+ *%*     if --import_threads is greater than 1, else 0: no read-ahead).
  *%*/
 
 static int verbose_flag = TC_QUIET;
@@ -71,6 +77,7 @@ static int capability_flag = TC_CAP_RGB|TC_CAP_YUV|TC_CAP_VID;
 #include <time.h>
 #include <sys/types.h>
 #include <regex.h>
+#include <unistd.h>
 
 
 typedef struct tcimprivatedata_ TCIMPrivateData;
@@ -87,6 +94,7 @@ struct tcimprivatedata_ {
     int             first_frame;
     int             current_frame;
     int             decoded_frame;
+    int             queued_frame;
     int             total_frame;
 
     int             pad;
@@ -96,6 +104,10 @@ struct tcimprivatedata_ {
      * by core option --multi_input
      */
     int             auto_seq_read;
+
+    TCMagickReader  *reader;    /* read-ahead decoding, if enabled */
+    int             prefetch;
+    int             seq_end;    /* no more images to queue */
 };
 
 static TCIMPrivateData IM;
@@ -110,11 +122,79 @@ static void tc_im_defaults(TCIMPrivateData *pd)
     pd->first_frame     = 0;
     pd->current_frame   = 0;
     pd->decoded_frame   = 0;
+    pd->queued_frame    = 0;
     pd->total_frame     = 0;
     pd->width           = 0;
     pd->height          = 0;
     pd->pad             = 0;
     pd->auto_seq_read   = TC_TRUE; 
+    pd->reader          = NULL;
+    pd->prefetch        = 0;
+    pd->seq_end         = TC_FALSE;
+}
+
+/* name of the image for the current frame; to be tc_free()'d */
+static char *tc_im_filename(TCIMPrivateData *pd, const char *video_in_file)
+{
+    char *frame = NULL, *filename = NULL;
+    int slen;
+
+    if (!pd->auto_seq_read) {
+        return tc_strdup(video_in_file);
+    }
+
+    slen = strlen(pd->head) + pd->pad + strlen(pd->tail) + 1;
+    filename = tc_malloc(slen);
+    if (filename == NULL) {
+        return NULL;
+    }
+    if (pd->pad) {
+        char framespec[10] = { '\0' };
+        frame = tc_malloc(pd->pad+1);
+        tc_snprintf(framespec, 10, "%%0%dd", pd->pad);
+        tc_snprintf(frame, pd->pad+1, framespec, pd->current_frame);
+        frame[pd->pad] = '\0';
+    } else if (pd->first_frame >= 0) {
+        frame = tc_malloc(10);
+        tc_snprintf(frame, 10, "%d", pd->current_frame);
+    }
+    strlcpy(filename, pd->head, slen);
+    if (frame != NULL) {
+        strlcat(filename, frame, slen);
+        tc_free(frame);
+    }
+    strlcat(filename, pd->tail, slen);
+    return filename;
+}
+
+/*
+ * keep the read-ahead queue full; the sequence ends at the first
+ * image which can't be read, as in the synchronous mode.
+ */
+static void tc_im_prefetch(TCIMPrivateData *pd, const char *video_in_file)
+{
+    while (!pd->seq_end
+      && tc_magick_reader_pending(pd->reader) < pd->prefetch) {
+        char *filename = NULL;
+
+        if (!pd->auto_seq_read && pd->queued_frame > 0) {
+            pd->seq_end = TC_TRUE;
+            break;
+        }
+        filename = tc_im_filename(pd, video_in_file);
+        if (filename == NULL || access(filename, R_OK) != 0) {
+            if (filename != NULL && pd->queued_frame == 0) {
+                tc_log_error(MOD_NAME, "can't read image %s", filename);
+            }
+            pd->seq_end = TC_TRUE;
+        } else if (tc_magick_reader_push(pd->reader, filename) != TC_OK) {
+            pd->seq_end = TC_TRUE;
+        } else {
+            pd->current_frame++;
+            pd->queued_frame++;
+        }
+        tc_free(filename);
+    }
 }
 
 /* ------------------------------------------------------------
@@ -224,6 +304,9 @@ MOD_open
             tc_free(frame);
         }
 
+        if (vob->im_v_threads > 1) {
+            IM.prefetch = 2 * vob->im_v_threads;
+        }
         if (vob->im_v_string != NULL) {
             if (optstr_lookup(vob->im_v_string, "noseq")) {
                 IM.auto_seq_read = TC_FALSE;
@@ -231,6 +314,7 @@ MOD_open
                     tc_log_info(MOD_NAME, "automagic image sequential read disabled");
                 }
             }
+            optstr_get(vob->im_v_string, "prefetch", "%i", &IM.prefetch);
         }
  
         IM.current_frame = IM.first_frame;
@@ -249,6 +333,30 @@ MOD_open
             }
         }
 
+        if (IM.prefetch > 0) {
+            ImageFormat format = IMG_RGB24;
+
+            if (vob->im_v_codec == TC_CODEC_YUV420P) {
+                format = IMG_YUV420P;
+            } else if (vob->im_v_codec == TC_CODEC_YUV422P) {
+                format = IMG_YUV422P;
+            }
+            IM.reader = tc_magick_reader_new(IM.width, IM.height, format,
+                                             TC_MAX(vob->im_v_threads, 1),
+                                             IM.prefetch);
+            if (IM.reader == NULL) {
+                tc_log_error(MOD_NAME, "cannot create read-ahead reader");
+                tcv_free(IM.tcvhandle);
+                IM.tcvhandle = 0;
+                return TC_ERROR;
+            }
+            if (verbose >= TC_INFO) {
+                tc_log_info(MOD_NAME, "reading %i images ahead with %i"
+                                      " thread(s)", IM.prefetch,
+                            TC_MAX(vob->im_v_threads, 1));
+            }
+        }
+
         return TC_OK;
     }
 
@@ -264,75 +372,65 @@ MOD_open
 
 MOD_decode
 {
-    char *frame = NULL, *filename = NULL;
-    int slen, ret;
+    char *filename = NULL;
+    int ret;
 
     if (param->flag == TC_AUDIO) {
         return TC_OK;
     }
 
     if (param->flag == TC_VIDEO) {
-        if (!IM.auto_seq_read) {
-            if (IM.decoded_frame > 0) {
-                return TC_ERROR;
+        if (IM.reader != NULL) {
+            tc_im_prefetch(&IM, vob->video_in_file);
+            ret = tc_magick_reader_pop(IM.reader, param->buffer,
+                                       &param->size);
+            if (ret != TC_OK) {
+                return ret;
             }
-            filename = tc_strdup(vob->video_in_file);
+            /* let the workers go on while this frame is processed */
+            tc_im_prefetch(&IM, vob->video_in_file);
         } else {
-            // build the filename for the current frame
-            slen = strlen(IM.head) + IM.pad + strlen(IM.tail) + 1;
-            filename = tc_malloc(slen);
-            if (IM.pad) {
-                char framespec[10] = { '\0' };
-                frame = tc_malloc(IM.pad+1);
-                tc_snprintf(framespec, 10, "%%0%dd", IM.pad);
-                tc_snprintf(frame, IM.pad+1, framespec, IM.current_frame);
-                frame[IM.pad] = '\0';
-            } else if (IM.first_frame >= 0) {
-                frame = tc_malloc(10);
-                tc_snprintf(frame, 10, "%d", IM.current_frame);
+            if (!IM.auto_seq_read && IM.decoded_frame > 0) {
+                return TC_ERROR;
             }
-            strlcpy(filename, IM.head, slen);
-            if (frame != NULL) {
-                strlcat(filename, frame, slen);
-                tc_free(frame);
-                frame = NULL;
+            filename = tc_im_filename(&IM, vob->video_in_file);
+            if (filename == NULL) {
+                return TC_ERROR;
             }
-            strlcat(filename, IM.tail, slen);
-        }
 
-        ret = tc_magick_filein(&IM.magick, filename);
-        if (ret != TC_OK) {
-            return ret;
-        }
+            ret = tc_magick_filein(&IM.magick, filename);
+            tc_free(filename);
+            if (ret != TC_OK) {
+                return ret;
+            }
 
-        ret = tc_magick_RGBout(&IM.magick, 
-                               IM.width, IM.height, param->buffer); 
-        /* param->size already set correctly by caller */
-        if (ret != TC_OK) {
-            return ret;
-        }
+            ret = tc_magick_RGBout(&IM.magick, 
+                                   IM.width, IM.height, param->buffer); 
+            /* param->size already set correctly by caller */
+            if (ret != TC_OK) {
+                return ret;
+            }
 
-        if (vob->im_v_codec == TC_CODEC_YUV420P) {
-            tcv_convert(IM.tcvhandle, param->buffer, param->buffer,
-                        vob->im_v_width, vob->im_v_height,
-                        IMG_RGB24, IMG_YUV420P);
-            param->size = vob->im_v_width * vob->im_v_height
-                        + 2 * (vob->im_v_width/2) * (vob->im_v_height/2);
-        } else if (vob->im_v_codec == TC_CODEC_YUV422P) {
-            tcv_convert(IM.tcvhandle, param->buffer, param->buffer,
-                        vob->im_v_width, vob->im_v_height,
-                        IMG_RGB24, IMG_YUV422P);
-            param->size = vob->im_v_width * vob->im_v_height
-                        + 2 * (vob->im_v_width/2) * vob->im_v_height;
+            if (vob->im_v_codec == TC_CODEC_YUV420P) {
+                tcv_convert(IM.tcvhandle, param->buffer, param->buffer,
+                            vob->im_v_width, vob->im_v_height,
+                            IMG_RGB24, IMG_YUV420P);
+                param->size = vob->im_v_width * vob->im_v_height
+                            + 2 * (vob->im_v_width/2) * (vob->im_v_height/2);
+            } else if (vob->im_v_codec == TC_CODEC_YUV422P) {
+                tcv_convert(IM.tcvhandle, param->buffer, param->buffer,
+                            vob->im_v_width, vob->im_v_height,
+                            IMG_RGB24, IMG_YUV422P);
+                param->size = vob->im_v_width * vob->im_v_height
+                            + 2 * (vob->im_v_width/2) * vob->im_v_height;
+            }
+            IM.current_frame++;
         }
 
         param->attributes |= TC_FRAME_IS_KEYFRAME;
 
         IM.total_frame++;
-        IM.current_frame++;
         IM.decoded_frame++;
-    
-        tc_free(filename);
 
         return TC_OK;
     }
@@ -359,6 +457,8 @@ MOD_close
             pclose(param->fd);
             param->fd = NULL;
         }
+        tc_magick_reader_del(IM.reader);
+        IM.reader = NULL;
         tcv_free(IM.tcvhandle);
         IM.tcvhandle = 0;
         tc_free(IM.head);
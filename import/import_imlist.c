@@ -28,6 +28,7 @@
 #define MOD_CODEC   "(video) RGB"
 
 #include "src/transcode.h"
+#include "libtcutil/optstr.h"
 #include "libtcext/tc_magick.h"
 #include "libtcvideo/tcvideo.h"
 
@@ -46,11 +47,37 @@ struct tcimprivatedata_ {
     int             width;
     int             height;
     FILE            *fd;
+
+    TCMagickReader  *reader;    /* read-ahead decoding, if enabled */
+    int             prefetch;
 };
 
 static TCIMPrivateData IM;
 
 
+/* read a filename from the list; FALSE at the end of the list */
+static int tc_imlist_next(TCIMPrivateData *pd, char *filename, size_t size)
+{
+    if (fgets(filename, size, pd->fd) == NULL) {
+        return TC_FALSE;
+    }
+    filename[size-1] = '\0'; /* enforce */
+    tc_strstrip(filename);
+    return TC_TRUE;
+}
+
+/* keep the read-ahead queue full */
+static void tc_imlist_prefetch(TCIMPrivateData *pd)
+{
+    char filename[PATH_MAX+1];
+
+    while (tc_magick_reader_pending(pd->reader) < pd->prefetch
+        && tc_imlist_next(pd, filename, sizeof(filename))) {
+        tc_magick_reader_push(pd->reader, filename);
+    }
+}
+
+
 /* ------------------------------------------------------------
  *
  * open stream
@@ -112,6 +139,33 @@ MOD_open
             return ret;
         }
 
+        IM.reader   = NULL;
+        IM.prefetch = (vob->im_v_threads > 1) ?(2 * vob->im_v_threads) :0;
+        if (vob->im_v_string != NULL) {
+            optstr_get(vob->im_v_string, "prefetch", "%i", &IM.prefetch);
+        }
+        if (IM.prefetch > 0) {
+            ImageFormat format = IMG_RGB24;
+
+            if (vob->im_v_codec == TC_CODEC_YUV420P) {
+                format = IMG_YUV420P;
+            } else if (vob->im_v_codec == TC_CODEC_YUV422P) {
+                format = IMG_YUV422P;
+            }
+            IM.reader = tc_magick_reader_new(IM.width, IM.height, format,
+                                             TC_MAX(vob->im_v_threads, 1),
+                                             IM.prefetch);
+            if (IM.reader == NULL) {
+                tc_log_error(MOD_NAME, "cannot create read-ahead reader");
+                tc_magick_fini(&IM.magick);
+                fclose(IM.fd);
+                IM.fd = NULL;
+                tcv_free(IM.tcvhandle);
+                IM.tcvhandle = 0;
+                return TC_ERROR;
+            }
+        }
+
         return TC_OK;
     }
 
@@ -135,12 +189,23 @@ MOD_decode
     }
 
     if (param->flag == TC_VIDEO) {
-        // read a filename from the list
-        if (fgets(filename, PATH_MAX, IM.fd) == NULL) {
+        if (IM.reader != NULL) {
+            tc_imlist_prefetch(&IM);
+            ret = tc_magick_reader_pop(IM.reader, param->buffer,
+                                       &param->size);
+            if (ret != TC_OK) {
+                return ret;
+            }
+            /* let the workers go on while this frame is processed */
+            tc_imlist_prefetch(&IM);
+
+            param->attributes |= TC_FRAME_IS_KEYFRAME;
+            return TC_OK;
+        }
+
+        if (!tc_imlist_next(&IM, filename, sizeof(filename))) {
             return TC_ERROR;
         }
-        filename[PATH_MAX] = '\0'; /* enforce */
-        tc_strstrip(filename);
 
         ret = tc_magick_filein(&IM.magick, filename);
         if (ret != TC_OK) {
@@ -187,6 +252,9 @@ MOD_close
     }
 
     if (param->flag == TC_VIDEO) {
+        tc_magick_reader_del(IM.reader);
+        IM.reader = NULL;
+
         if (IM.fd != NULL) {
             fclose(IM.fd);
             IM.fd = NULL;
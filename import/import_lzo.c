@@ -31,9 +31,10 @@
 
 static int verbose_flag = TC_QUIET;
 static int capability_flag = TC_CAP_PCM | TC_CAP_YUV | TC_CAP_RGB |
-                             TC_CAP_AUD | TC_CAP_VID;
+                             TC_CAP_AUD | TC_CAP_VID | TC_CAP_SPLIT;
 
 #define MOD_PRE lzo
+#define MOD_SPLIT
 #include "import_def.h"
 
 
@@ -46,10 +47,9 @@ static int aframe_count=0, vframe_count=0;
 
 #define BUFFER_SIZE SIZE_RGB_FRAME<<1
 
-static int r;
 static lzo_byte *out;
 static lzo_byte *wrkmem;
-static lzo_uint out_len;
+static long out_len;
 
 static int done_seek=0;
 
@@ -143,11 +143,117 @@ MOD_open
  *
  * ------------------------------------------------------------*/
 
-MOD_decode
+/*
+ * lzo_unpack: decompress a video chunk; it touches no module state,
+ * so it can run in parallel on different chunks (TC_IMPORT_UNPACK).
+ */
+static int lzo_unpack(lzo_bytep chunk, long chunk_len,
+                      uint8_t *buffer, int *size)
+{
+    lzo_uint len = 0;
+    int ret;
+
+    if (video_codec == TC_CODEC_LZO1) {
+        ret = lzo1x_decompress(chunk, chunk_len, buffer, &len, NULL);
+    } else {
+        tc_lzo_header_t *h = (tc_lzo_header_t *)chunk;
+        lzo_bytep compdata = chunk + sizeof(*h);
+        int compsize = chunk_len - sizeof(*h);
+
+        if (chunk_len < sizeof(*h) || h->magic != video_codec) {
+            tc_log_warn(MOD_NAME, "frame with invalid magic 0x%08X",
+                        (chunk_len < sizeof(*h)) ?0 :h->magic);
+            return TC_IMPORT_ERROR;
+        }
+        if (h->flags & TC_LZO_NOT_COMPRESSIBLE) {
+            ac_memcpy(buffer, compdata, compsize);
+            len = compsize;
+            ret = LZO_E_OK;
+        } else {
+            ret = lzo1x_decompress(compdata, compsize, buffer, &len, NULL);
+        }
+    }
+
+    if (ret != LZO_E_OK) {
+        /* this should NEVER happen */
+        tc_log_warn(MOD_NAME, "internal error - decompression failed: %d",
+                    ret);
+        return TC_IMPORT_ERROR;
+    }
+    if (verbose & TC_DEBUG) {
+        tc_log_info(MOD_NAME, "decompressed %lu bytes into %lu bytes",
+                    (unsigned long)chunk_len, (unsigned long)len);
+    }
+    *size = len;
+    return TC_IMPORT_OK;
+}
+
+/* ------------------------------------------------------------
+ *
+ * read video chunk (split decoding)
+ *
+ * ------------------------------------------------------------*/
+
+MOD_read
+{
+  int key = 0;
+  long len;
+
+  if (param->flag != TC_VIDEO || avifile2 == NULL)
+    return(TC_IMPORT_ERROR);
+
+  if (avifile2->video_pos >= avifile2->video_frames) {
+    param->size = 0;          /* end of stream, see TC_IMPORT_READ */
+    return(TC_IMPORT_ERROR);
+  }
+
+  len = AVI_frame_size(avifile2, avifile2->video_pos);
+  if (len > param->size) {
+    param->size = len;        /* the caller can retry with more room */
+    return(TC_IMPORT_ERROR);
+  }
+
+  len = AVI_read_frame(avifile2, (char *)param->buffer, &key);
+  if (len <= 0) {
+    if(verbose & TC_DEBUG) AVI_print_error("AVI read video frame");
+    return(TC_IMPORT_ERROR);
+  }
+
+  if(verbose & TC_STATS && key)
+    tc_log_info(MOD_NAME, "keyframe %d", vframe_count);
+
+  param->size = len;
+  if(key) param->attributes |= TC_FRAME_IS_KEYFRAME;
+
+  ++vframe_count;
+
+  return(TC_IMPORT_OK);
+}
+
+/* ------------------------------------------------------------
+ *
+ * decode video chunk (split decoding, reentrant)
+ *
+ * ------------------------------------------------------------*/
+
+MOD_unpack
 {
+  if (param->flag != TC_VIDEO)
+    return(TC_IMPORT_ERROR);
+
+  return lzo_unpack(param->buffer2, param->size,
+                    param->buffer, &param->size);
+}
+
+/* ------------------------------------------------------------
+ *
+ * decode  stream
+ *
+ * ------------------------------------------------------------*/
 
+MOD_decode
+{
   int key;
-  lzo_uint size;
   long bytes_read=0;
 
   if(param->flag == TC_VIDEO) {
@@ -156,7 +262,7 @@ MOD_decode
       return(TC_IMPORT_OK);
     }
 
-    out_len = AVI_read_frame(avifile2, out, &key);
+    out_len = AVI_read_frame(avifile2, (char *)out, &key);
 
     if(verbose & TC_STATS && key)
       tc_log_info(MOD_NAME, "keyframe %d", vframe_count);
@@ -166,36 +272,9 @@ MOD_decode
       return(TC_IMPORT_ERROR);
     }
 
-    if (video_codec == TC_CODEC_LZO1) {
-      r = lzo1x_decompress(out, out_len, param->buffer, &size, wrkmem);
-    } else {
-      tc_lzo_header_t *h = (tc_lzo_header_t *)out;
-      uint8_t *compdata = out + sizeof(*h);
-      int compsize = out_len - sizeof(*h);
-      if (h->magic != video_codec) {
-          tc_log_warn(MOD_NAME, "frame with invalid magic 0x%08X", h->magic);
-	      return (TC_IMPORT_ERROR);
-      }
-      if (h->flags & TC_LZO_NOT_COMPRESSIBLE) {
-          ac_memcpy(param->buffer, compdata, compsize);
-	      size = compsize;
-	      r = LZO_E_OK;
-      } else {
-	      r = lzo1x_decompress(compdata, compsize, param->buffer, &size, wrkmem);
-      }
-    }
-
-    if (r == LZO_E_OK) {
-      if(verbose & TC_DEBUG)
-	      tc_log_info(MOD_NAME, "decompressed %lu bytes into %lu bytes",
-		              (long) out_len, (long) param->size);
-    } else {
-      /* this should NEVER happen */
-      tc_log_warn(MOD_NAME, "internal error - decompression failed: %d", r);
+    if (lzo_unpack(out, out_len, param->buffer, &param->size) != TC_IMPORT_OK)
       return(TC_IMPORT_ERROR);
-    }
 
-    param->size = size;
     //transcode v.0.5.0-pre8 addition
     if(key) param->attributes |= TC_FRAME_IS_KEYFRAME;
 
@@ -26,6 +26,7 @@
 */
 
 #include "RTjpegN.h"
+#include "aclib/ac.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -300,10 +301,12 @@ fprintf(stderr, "\n\n");
 }
 
 /* +++++++++++++++++++++++++++++++++++++++++++++++++++*/
-/* Stream to Block  (decoding)                        */
-/*                                                    */
+/* Stream to Levels (decoding, no dequantization)     */
+/* *last gets the zigzag position of the last coded   */
+/* coefficient, 0 for DC only blocks                  */
 
-static int RTjpeg_s2b(int16_t *data, int8_t *strm, uint8_t bt8, uint32_t *qtbl)
+static int RTjpeg_s2l(int16_t *data, const int8_t *strm, uint8_t bt8,
+                      int *last)
 {
  int ci;
  register int co;
@@ -311,19 +314,18 @@ static int RTjpeg_s2b(int16_t *data, int8_t *strm, uint8_t bt8, uint32_t *qtbl)
  register unsigned char bitten;
  register unsigned char bitoff;
 
+ /* uncoded coefficients are zero */
+ memset(data, 0, 64*sizeof(int16_t));
+
  /* first byte always read */
  i=RTjpeg_ZZ[0];
- data[i]=((uint8_t)strm[0])*qtbl[i];
+ data[i]=(uint8_t)strm[0];
 
  /* we start at the behind */
 
  bitten = ((unsigned char)strm[1]) >> 2;
- co = 63;
- for(; co > bitten; co--) {
-
-   data[RTjpeg_ZZ[co]] = 0;
-
- }
+ *last = bitten;
+ co = bitten;
 
  if (co==0) {
    ci = 2;
@@ -343,13 +345,13 @@ static int RTjpeg_s2b(int16_t *data, int8_t *strm, uint8_t bt8, uint32_t *qtbl)
 
   switch( bitten ) {
   case 0x03:
-    data[i]= -qtbl[i];
+    data[i]= -1;
     break;
   case 0x02:
     goto FUSSWEG;
     break;
   case 0x01:
-    data[i]= qtbl[i];
+    data[i]= 1;
     break;
   case 0x00:
     data[i]= 0;
@@ -408,7 +410,7 @@ FUSSWEG:
   }
   /* the unsigned char bitten now is a valid signed char */
 
-  data[i]=((signed char)bitten)*qtbl[i];
+  data[i]=(signed char)bitten;
 
   if( bitoff == 0 ) {
     bitoff = 8;
@@ -428,7 +430,7 @@ STRASSE:
 
  for(; co>0; co--) {
   i=RTjpeg_ZZ[co];
-  data[i]=strm[ci++]*qtbl[i];
+  data[i]=strm[ci++];
  }
 
  /* ci now is the count, because it points to next element => no incrementing */
@@ -446,6 +448,20 @@ fprintf(stderr, "\n\n");
  return ci;
 }
 
+/* +++++++++++++++++++++++++++++++++++++++++++++++++++*/
+/* Stream to Block  (decoding)                        */
+/*                                                    */
+
+static int RTjpeg_s2b(int16_t *data, int8_t *strm, uint8_t bt8, uint32_t *qtbl)
+{
+ int i, last, ci;
+
+ ci=RTjpeg_s2l(data, strm, bt8, &last);
+ for(i=0; i<64; i++)
+  data[i]=data[i]*qtbl[i];
+ return ci;
+}
+
 #else
 
 static int RTjpeg_b2s(int16_t *data, int8_t *strm, uint8_t bt8)
@@ -507,18 +523,19 @@ static int RTjpeg_b2s(int16_t *data, int8_t *strm, uint8_t bt8)
  return (int)co;
 }
 
-static int RTjpeg_s2b(int16_t *data, int8_t *strm, uint8_t bt8, uint32_t *qtbl)
+static int RTjpeg_s2l(int16_t *data, const int8_t *strm, uint8_t bt8,
+                      int *last)
 {
  int ci=1, co=1, tmp;
  register int i;
 
  i=RTjpeg_ZZ[0];
- data[i]=((uint8_t)strm[0])*qtbl[i];
+ data[i]=(uint8_t)strm[0];
 
  for(co=1; co<=bt8; co++)
  {
   i=RTjpeg_ZZ[co];
-  data[i]=strm[ci++]*qtbl[i];
+  data[i]=strm[ci++];
  }
 
  for(; co<64; co++)
@@ -531,12 +548,23 @@ static int RTjpeg_s2b(int16_t *data, int8_t *strm, uint8_t bt8, uint32_t *qtbl)
   } else
   {
    i=RTjpeg_ZZ[co];
-   data[i]=strm[ci]*qtbl[i];
+   data[i]=strm[ci];
   }
   ci++;
  }
+ *last=63; /* not tracked */
  return (int)ci;
 }
+
+static int RTjpeg_s2b(int16_t *data, int8_t *strm, uint8_t bt8, uint32_t *qtbl)
+{
+ int i, last, ci;
+
+ ci=RTjpeg_s2l(data, strm, bt8, &last);
+ for(i=0; i<64; i++)
+  data[i]=data[i]*qtbl[i];
+ return ci;
+}
 #endif
 
 #if defined(MMX)
@@ -2857,9 +2885,9 @@ void RTjpeg_init_decompress(uint32_t *buf, int width, int height)
 int RTjpeg_compressYUV420(int8_t *sp, unsigned char *bp)
 {
  int8_t * sb;
- register int8_t * bp1 = bp + (RTjpeg_width<<3);
- register int8_t * bp2 = bp + RTjpeg_Ysize;
- register int8_t * bp3 = bp2 + (RTjpeg_Csize>>1);
+ register uint8_t * bp1 = bp + (RTjpeg_width<<3);
+ register uint8_t * bp2 = bp + RTjpeg_Ysize;
+ register uint8_t * bp3 = bp2 + (RTjpeg_Csize>>1);
  register int i, j, k;
 
 #ifdef MMX
@@ -2911,8 +2939,8 @@ int RTjpeg_compressYUV420(int8_t *sp, unsigned char *bp)
 int RTjpeg_compressYUV422(int8_t *sp, unsigned char *bp)
 {
  int8_t * sb;
- register int8_t * bp2 = bp + RTjpeg_Ysize;
- register int8_t * bp3 = bp2 + RTjpeg_Csize;
+ register uint8_t * bp2 = bp + RTjpeg_Ysize;
+ register uint8_t * bp3 = bp2 + RTjpeg_Csize;
  register int i, j, k;
 
 #ifdef MMX
@@ -2982,8 +3010,8 @@ int RTjpeg_compress8(int8_t *sp, unsigned char *bp)
 
 void RTjpeg_decompressYUV422(int8_t *sp, uint8_t *bp)
 {
- register int8_t * bp2 = bp + RTjpeg_Ysize;
- register int8_t * bp3 = bp2 + (RTjpeg_Csize);
+ register uint8_t * bp2 = bp + RTjpeg_Ysize;
+ register uint8_t * bp3 = bp2 + (RTjpeg_Csize);
  int i, j,k;
 
 #ifdef MMX
@@ -3030,9 +3058,9 @@ void RTjpeg_decompressYUV422(int8_t *sp, uint8_t *bp)
 
 void RTjpeg_decompressYUV420(int8_t *sp, uint8_t *bp)
 {
- register int8_t * bp1 = bp + (RTjpeg_width<<3);
- register int8_t * bp2 = bp + RTjpeg_Ysize;
- register int8_t * bp3 = bp2 + (RTjpeg_Csize>>1);
+ register uint8_t * bp1 = bp + (RTjpeg_width<<3);
+ register uint8_t * bp2 = bp + RTjpeg_Ysize;
+ register uint8_t * bp3 = bp2 + (RTjpeg_Csize>>1);
  int i, j,k;
 
 #ifdef MMX
@@ -3112,6 +3140,413 @@ void RTjpeg_decompress8(int8_t *sp, uint8_t *bp)
  }
 }
 
+/*
+
+Context based decoder
+
+The functions above keep the decoder state in globals, so only one
+stream at a time can be decoded. RTjpegDecoder holds it all, and splits
+decoding in two steps: the bitstream is parsed (sequentially, blocks
+have variable length) into quantized levels, then the macroblock rows
+are dequantized and transformed, possibly by several threads at once.
+
+*/
+
+#define RTJPEG_BLOCK_SKIP   0   /* not coded, leave the output alone */
+#define RTJPEG_BLOCK_DC     1   /* flat block */
+#define RTJPEG_BLOCK_FULL   2
+
+struct RTjpeg_decoder_ {
+ int width, height;
+ int mbw, mbh;          /* 16x16 macroblocks per row and column */
+ uint8_t lb8, cb8;
+ int sse2;
+ /* dequantization, AAN scaled (see RTjpeg_idct_init); only the low 16
+    bits matter as coefficients are int16_t */
+ int16_t liqt[64], ciqt[64];
+ int16_t *levels;       /* 6 blocks of 64 per macroblock, stream order */
+ uint8_t *type;         /* RTJPEG_BLOCK_* for each block */
+};
+
+static void RTjpeg_idct_dc(uint8_t *odata, int16_t dc, int rskip)
+{
+  int16_t v = DESCALE(dc);
+  int ctr;
+
+  v = RL(v);
+  for (ctr = 0; ctr < 8; ctr++)
+    memset(odata + ctr*rskip, v, 8);
+}
+
+static void RTjpeg_idct_c(uint8_t *odata, const int16_t *levels,
+                          const int16_t *qtbl, int rskip)
+{
+  int16_t data[64];
+  int i;
+
+  for (i = 0; i < 64; i++)
+    data[i] = levels[i] * qtbl[i];
+  RTjpeg_idct(odata, data, rskip);
+}
+
+#if defined(HAVE_ASM_SSE2) && defined(ARCH_X86_64)
+
+/*
+ * Same arithmetic as the C RTjpeg_idct (so same output, bit by bit),
+ * on four columns/rows at once in 32 bit lanes. SSE2 has no 32 bit
+ * multiply, so pmuludq is used on even and odd lanes; the low halves
+ * of the products don't care about the sign.
+ */
+
+#define RTJPEG_SSE2_CONST4(v) { v, v, v, v }
+static const int32_t RTjpeg_sse2_round[4] __attribute__((aligned(16)))
+    = RTJPEG_SSE2_CONST4(128);
+static const int32_t RTjpeg_sse2_four[4] __attribute__((aligned(16)))
+    = RTJPEG_SSE2_CONST4(4);
+static const int32_t RTjpeg_sse2_1_082[4] __attribute__((aligned(16)))
+    = RTJPEG_SSE2_CONST4(FIX_1_082392200);
+static const int32_t RTjpeg_sse2_1_414[4] __attribute__((aligned(16)))
+    = RTJPEG_SSE2_CONST4(FIX_1_414213562);
+static const int32_t RTjpeg_sse2_1_847[4] __attribute__((aligned(16)))
+    = RTJPEG_SSE2_CONST4(FIX_1_847759065);
+static const int32_t RTjpeg_sse2_m2_613[4] __attribute__((aligned(16)))
+    = RTJPEG_SSE2_CONST4(-FIX_2_613125930);
+static const int16_t RTjpeg_sse2_min[8] __attribute__((aligned(16)))
+    = { 16, 16, 16, 16, 16, 16, 16, 16 };
+static const int16_t RTjpeg_sse2_max[8] __attribute__((aligned(16)))
+    = { 235, 235, 235, 235, 235, 235, 235, 235 };
+
+/* xmm<r> = MULTIPLY(xmm<r>, k); clobbers xmm10 */
+#define RTJPEG_SSE2_MUL(r, k)                           \
+    "movdqa     %%xmm" #r ", %%xmm10            \n\t"   \
+    "psrlq      $32, %%xmm10                    \n\t"   \
+    "pmuludq    " k ", %%xmm" #r "              \n\t"   \
+    "pmuludq    " k ", %%xmm10                  \n\t"   \
+    "pshufd     $0x08, %%xmm" #r ", %%xmm" #r " \n\t"   \
+    "pshufd     $0x08, %%xmm10, %%xmm10         \n\t"   \
+    "punpckldq  %%xmm10, %%xmm" #r "            \n\t"   \
+    "paddd      %[round], %%xmm" #r "           \n\t"   \
+    "psrad      $8, %%xmm" #r "                 \n\t"
+
+/* one 1-D pass, xmm0..7 -> xmm0..7; clobbers xmm8..10 */
+#define RTJPEG_SSE2_IDCT_1D                                             \
+    /* even part: xmm0 = tmp0, xmm8 = tmp1, xmm2 = tmp2, xmm4 = tmp3 */ \
+    "movdqa     %%xmm0, %%xmm8          \n\t"                           \
+    "paddd      %%xmm4, %%xmm0          \n\t"                           \
+    "psubd      %%xmm4, %%xmm8          \n\t"                           \
+    "movdqa     %%xmm2, %%xmm9          \n\t"                           \
+    "paddd      %%xmm6, %%xmm2          \n\t"                           \
+    "psubd      %%xmm6, %%xmm9          \n\t"                           \
+    RTJPEG_SSE2_MUL(9, "%[c1_414]")                                     \
+    "psubd      %%xmm2, %%xmm9          \n\t"                           \
+    "movdqa     %%xmm0, %%xmm4          \n\t"                           \
+    "paddd      %%xmm2, %%xmm0          \n\t"                           \
+    "psubd      %%xmm2, %%xmm4          \n\t"                           \
+    "movdqa     %%xmm8, %%xmm2          \n\t"                           \
+    "paddd      %%xmm9, %%xmm8          \n\t"                           \
+    "psubd      %%xmm9, %%xmm2          \n\t"                           \
+    /* odd part: xmm7 = tmp7, xmm6 = tmp6, xmm1 = tmp5, xmm3 = tmp4 */  \
+    "movdqa     %%xmm5, %%xmm6          \n\t"                           \
+    "paddd      %%xmm3, %%xmm5          \n\t"                           \
+    "psubd      %%xmm3, %%xmm6          \n\t"                           \
+    "movdqa     %%xmm1, %%xmm3          \n\t"                           \
+    "paddd      %%xmm7, %%xmm1          \n\t"                           \
+    "psubd      %%xmm7, %%xmm3          \n\t"                           \
+    "movdqa     %%xmm1, %%xmm7          \n\t"                           \
+    "paddd      %%xmm5, %%xmm7          \n\t"                           \
+    "psubd      %%xmm5, %%xmm1          \n\t"                           \
+    RTJPEG_SSE2_MUL(1, "%[c1_414]")                                     \
+    "movdqa     %%xmm6, %%xmm5          \n\t"                           \
+    "paddd      %%xmm3, %%xmm5          \n\t"                           \
+    RTJPEG_SSE2_MUL(5, "%[c1_847]")                                     \
+    RTJPEG_SSE2_MUL(3, "%[c1_082]")                                     \
+    "psubd      %%xmm5, %%xmm3          \n\t"                           \
+    RTJPEG_SSE2_MUL(6, "%[cm2_613]")                                    \
+    "paddd      %%xmm5, %%xmm6          \n\t"                           \
+    "psubd      %%xmm7, %%xmm6          \n\t"                           \
+    "psubd      %%xmm6, %%xmm1          \n\t"                           \
+    "paddd      %%xmm1, %%xmm3          \n\t"                           \
+    /* butterflies, back in order */                                   \
+    "movdqa     %%xmm0, %%xmm9          \n\t"                           \
+    "paddd      %%xmm7, %%xmm0          \n\t"                           \
+    "psubd      %%xmm7, %%xmm9          \n\t"                           \
+    "movdqa     %%xmm8, %%xmm7          \n\t"                           \
+    "psubd      %%xmm6, %%xmm7          \n\t"                           \
+    "paddd      %%xmm6, %%xmm8          \n\t"                           \
+    "movdqa     %%xmm2, %%xmm5          \n\t"                           \
+    "psubd      %%xmm1, %%xmm5          \n\t"                           \
+    "paddd      %%xmm1, %%xmm2          \n\t"                           \
+    "movdqa     %%xmm4, %%xmm10         \n\t"                           \
+    "paddd      %%xmm3, %%xmm4          \n\t"                           \
+    "psubd      %%xmm3, %%xmm10         \n\t"                           \
+    "movdqa     %%xmm10, %%xmm3         \n\t"                           \
+    "movdqa     %%xmm8, %%xmm1          \n\t"                           \
+    "movdqa     %%xmm7, %%xmm6          \n\t"                           \
+    "movdqa     %%xmm9, %%xmm7          \n\t"
+
+/* 4x4 transpose of xmm<a>..xmm<d>, to xmm<a>, xmm<b>, xmm<t1>, xmm<d> */
+#define RTJPEG_SSE2_TRANSPOSE(a, b, c, d, t1, t2)       \
+    "movdqa     %%xmm" #a ", %%xmm" #t1 "       \n\t"   \
+    "punpckldq  %%xmm" #b ", %%xmm" #a "        \n\t"   \
+    "punpckhdq  %%xmm" #b ", %%xmm" #t1 "       \n\t"   \
+    "movdqa     %%xmm" #c ", %%xmm" #t2 "       \n\t"   \
+    "punpckldq  %%xmm" #d ", %%xmm" #c "        \n\t"   \
+    "punpckhdq  %%xmm" #d ", %%xmm" #t2 "       \n\t"   \
+    "movdqa     %%xmm" #a ", %%xmm" #b "        \n\t"   \
+    "punpcklqdq %%xmm" #c ", %%xmm" #a "        \n\t"   \
+    "punpckhqdq %%xmm" #c ", %%xmm" #b "        \n\t"   \
+    "movdqa     %%xmm" #t1 ", %%xmm" #d "       \n\t"   \
+    "punpcklqdq %%xmm" #t2 ", %%xmm" #t1 "      \n\t"   \
+    "punpckhqdq %%xmm" #t2 ", %%xmm" #d "       \n\t"
+
+/* 4 levels of row k, dequantized and widened to 32 bit */
+#define RTJPEG_SSE2_LOAD(k)                                     \
+    "movq       " #k "*16(%[in]), %%xmm" #k "           \n\t"   \
+    "movq       " #k "*16(%[q]), %%xmm8                 \n\t"   \
+    "pmullw     %%xmm8, %%xmm" #k "                     \n\t"   \
+    "punpcklwd  %%xmm" #k ", %%xmm" #k "                \n\t"   \
+    "psrad      $16, %%xmm" #k "                        \n\t"
+
+/* DESCALE, then truncated to 16 bit like the C version does */
+#define RTJPEG_SSE2_DESCALE(k)                                  \
+    "paddd      %[four], %%xmm" #k "                    \n\t"   \
+    "psrad      $3, %%xmm" #k "                         \n\t"   \
+    "pslld      $16, %%xmm" #k "                        \n\t"   \
+    "psrad      $16, %%xmm" #k "                        \n\t"
+
+/* two halves of a row to 8 clipped pixels */
+#define RTJPEG_SSE2_STORE(lo, hi)                               \
+    "packssdw   %%xmm" #hi ", %%xmm" #lo "              \n\t"   \
+    "pmaxsw     %[min], %%xmm" #lo "                    \n\t"   \
+    "pminsw     %[max], %%xmm" #lo "                    \n\t"   \
+    "packuswb   %%xmm" #lo ", %%xmm" #lo "              \n\t"   \
+    "movq       %%xmm" #lo ", (%[out])                  \n\t"   \
+    "add        %[stride], %[out]                       \n\t"
+
+#define RTJPEG_SSE2_CONSTANTS                                   \
+      [round]   "m" (*RTjpeg_sse2_round),                       \
+      [c1_082]  "m" (*RTjpeg_sse2_1_082),                       \
+      [c1_414]  "m" (*RTjpeg_sse2_1_414),                       \
+      [c1_847]  "m" (*RTjpeg_sse2_1_847),                       \
+      [cm2_613] "m" (*RTjpeg_sse2_m2_613)
+
+static void RTjpeg_idct_sse2(uint8_t *odata, const int16_t *levels,
+                             const int16_t *qtbl, int rskip)
+{
+  /* column pass output, transposed: ws[column*8 + row] */
+  int32_t ws[64] __attribute__((aligned(16)));
+  intptr_t stride = rskip;
+  uint8_t *out;
+  int h;
+
+  for (h = 0; h < 2; h++) {  /* columns 4h..4h+3 */
+    __asm__ __volatile__(
+      RTJPEG_SSE2_LOAD(0) RTJPEG_SSE2_LOAD(1)
+      RTJPEG_SSE2_LOAD(2) RTJPEG_SSE2_LOAD(3)
+      RTJPEG_SSE2_LOAD(4) RTJPEG_SSE2_LOAD(5)
+      RTJPEG_SSE2_LOAD(6) RTJPEG_SSE2_LOAD(7)
+      RTJPEG_SSE2_IDCT_1D
+      RTJPEG_SSE2_TRANSPOSE(0, 1, 2, 3, 8, 9)
+      "movdqa   %%xmm0,   0(%[ws])      \n\t"
+      "movdqa   %%xmm1,  32(%[ws])      \n\t"
+      "movdqa   %%xmm8,  64(%[ws])      \n\t"
+      "movdqa   %%xmm3,  96(%[ws])      \n\t"
+      RTJPEG_SSE2_TRANSPOSE(4, 5, 6, 7, 8, 9)
+      "movdqa   %%xmm4,  16(%[ws])      \n\t"
+      "movdqa   %%xmm5,  48(%[ws])      \n\t"
+      "movdqa   %%xmm8,  80(%[ws])      \n\t"
+      "movdqa   %%xmm7, 112(%[ws])      \n\t"
+      :
+      : [in] "r" (levels + 4*h), [q] "r" (qtbl + 4*h),
+        [ws] "r" (ws + 32*h),
+        RTJPEG_SSE2_CONSTANTS
+      : "xmm0", "xmm1", "xmm2", "xmm3", "xmm4", "xmm5", "xmm6", "xmm7",
+        "xmm8", "xmm9", "xmm10", "memory");
+  }
+
+  for (h = 0; h < 2; h++) {  /* rows 4h..4h+3 */
+    out = odata + 4*h*rskip;
+    __asm__ __volatile__(
+      "movdqa      0(%[ws]), %%xmm0     \n\t"
+      "movdqa     32(%[ws]), %%xmm1     \n\t"
+      "movdqa     64(%[ws]), %%xmm2     \n\t"
+      "movdqa     96(%[ws]), %%xmm3     \n\t"
+      "movdqa    128(%[ws]), %%xmm4     \n\t"
+      "movdqa    160(%[ws]), %%xmm5     \n\t"
+      "movdqa    192(%[ws]), %%xmm6     \n\t"
+      "movdqa    224(%[ws]), %%xmm7     \n\t"
+      RTJPEG_SSE2_IDCT_1D
+      RTJPEG_SSE2_DESCALE(0) RTJPEG_SSE2_DESCALE(1)
+      RTJPEG_SSE2_DESCALE(2) RTJPEG_SSE2_DESCALE(3)
+      RTJPEG_SSE2_DESCALE(4) RTJPEG_SSE2_DESCALE(5)
+      RTJPEG_SSE2_DESCALE(6) RTJPEG_SSE2_DESCALE(7)
+      RTJPEG_SSE2_TRANSPOSE(0, 1, 2, 3, 8, 9)
+      RTJPEG_SSE2_TRANSPOSE(4, 5, 6, 7, 9, 10)
+      RTJPEG_SSE2_STORE(0, 4)
+      RTJPEG_SSE2_STORE(1, 5)
+      RTJPEG_SSE2_STORE(8, 9)
+      RTJPEG_SSE2_STORE(3, 7)
+      : [out] "+r" (out)
+      : [ws] "r" (ws + 4*h), [stride] "r" (stride),
+        [four] "m" (*RTjpeg_sse2_four),
+        [min] "m" (*RTjpeg_sse2_min), [max] "m" (*RTjpeg_sse2_max),
+        RTJPEG_SSE2_CONSTANTS
+      : "xmm0", "xmm1", "xmm2", "xmm3", "xmm4", "xmm5", "xmm6", "xmm7",
+        "xmm8", "xmm9", "xmm10", "memory");
+  }
+}
+
+#endif  /* HAVE_ASM_SSE2 && ARCH_X86_64 */
+
+RTjpegDecoder *RTjpeg_decoder_new(const uint32_t *buf, int width, int height,
+                                  int accel)
+{
+ RTjpegDecoder *dec;
+ int i, blocks;
+
+ if(width<16 || height<16 || (width&15) || (height&15))
+  return NULL;
+ dec=calloc(1, sizeof(RTjpegDecoder));
+ if(!dec)
+  return NULL;
+
+ dec->width=width;
+ dec->height=height;
+ dec->mbw=width>>4;
+ dec->mbh=height>>4;
+ blocks=dec->mbw*dec->mbh*6;
+ dec->levels=malloc(blocks*64*sizeof(int16_t));
+ dec->type=malloc(blocks);
+ if(!dec->levels || !dec->type)
+ {
+  RTjpeg_decoder_free(dec);
+  return NULL;
+ }
+
+ /* same as RTjpeg_init_decompress + RTjpeg_idct_init */
+ for(i=0; i<64; i++)
+ {
+  dec->liqt[i]=(int16_t)(((uint64_t)buf[i]*RTjpeg_aan_tab[i])>>32);
+  dec->ciqt[i]=(int16_t)(((uint64_t)buf[i+64]*RTjpeg_aan_tab[i])>>32);
+ }
+ dec->lb8=0;
+ while(dec->lb8<63 && buf[RTjpeg_ZZ[++dec->lb8]]<=8);
+ dec->lb8--;
+ dec->cb8=0;
+ while(dec->cb8<63 && buf[64+RTjpeg_ZZ[++dec->cb8]]<=8);
+ dec->cb8--;
+
+#if defined(HAVE_ASM_SSE2) && defined(ARCH_X86_64)
+ dec->sse2=(accel & AC_SSE2) ?1 :0;
+#endif
+ return dec;
+}
+
+void RTjpeg_decoder_free(RTjpegDecoder *dec)
+{
+ if(dec)
+ {
+  free(dec->levels);
+  free(dec->type);
+  free(dec);
+ }
+}
+
+int RTjpeg_decoder_rows(const RTjpegDecoder *dec)
+{
+ return dec->mbh;
+}
+
+int RTjpeg_decoder_parseYUV420(RTjpegDecoder *dec, const int8_t *sp, int len)
+{
+ const int8_t *start=sp, *end=sp+len;
+ int16_t *levels=dec->levels;
+ int b, last, blocks=dec->mbw*dec->mbh*6;
+
+ for(b=0; b<blocks; b++, levels+=64)
+ {
+  if(sp>=end)
+   break;
+  if(*sp==-1)
+  {
+   dec->type[b]=RTJPEG_BLOCK_SKIP;
+   sp++;
+   continue;
+  }
+  /* four luma blocks, then Cb and Cr */
+  sp+=RTjpeg_s2l(levels, sp, (b%6<4) ?dec->lb8 :dec->cb8, &last);
+  dec->type[b]=(last==0) ?RTJPEG_BLOCK_DC :RTJPEG_BLOCK_FULL;
+ }
+ if(sp>end)  /* the last block was truncated */
+  b--;
+ if(b<blocks)
+ {
+  memset(dec->type+b, RTJPEG_BLOCK_SKIP, blocks-b);
+  return -1;
+ }
+ return (int)(sp-start);
+}
+
+void RTjpeg_decoder_idctYUV420(const RTjpegDecoder *dec, uint8_t *bp,
+                               int first, int last)
+{
+ const int width=dec->width, cwidth=dec->width>>1;
+ uint8_t *bp2=bp+width*dec->height;
+ uint8_t *bp3=bp2+(width*dec->height>>2);
+ void (*idct)(uint8_t *odata, const int16_t *levels,
+              const int16_t *qtbl, int rskip)=RTjpeg_idct_c;
+ int i, j, k, b;
+
+#if defined(HAVE_ASM_SSE2) && defined(ARCH_X86_64)
+ if(dec->sse2)
+  idct=RTjpeg_idct_sse2;
+#endif
+
+ for(i=first; i<last; i++)
+ {
+  b=i*dec->mbw*6;
+  for(j=0; j<dec->mbw; j++)
+  {
+   uint8_t *dst[6];
+   int skip[6];
+
+   dst[0]=bp+(i<<4)*width+(j<<4);
+   dst[1]=dst[0]+8;
+   dst[2]=dst[0]+(width<<3);
+   dst[3]=dst[2]+8;
+   dst[4]=bp2+(i<<3)*cwidth+(j<<3);
+   dst[5]=bp3+(i<<3)*cwidth+(j<<3);
+   skip[0]=skip[1]=skip[2]=skip[3]=width;
+   skip[4]=skip[5]=cwidth;
+
+   for(k=0; k<6; k++, b++)
+   {
+    const int16_t *levels=dec->levels+b*64;
+    const int16_t *qtbl=(k<4) ?dec->liqt :dec->ciqt;
+
+    switch(dec->type[b])
+    {
+     case RTJPEG_BLOCK_DC:
+      RTjpeg_idct_dc(dst[k], levels[0]*qtbl[0], skip[k]);
+      break;
+     case RTJPEG_BLOCK_FULL:
+      idct(dst[k], levels, qtbl, skip[k]);
+      break;
+     default: /* skipped */
+      break;
+    }
+   }
+  }
+ }
+}
+
+void RTjpeg_decoder_decompressYUV420(RTjpegDecoder *dec, const int8_t *sp,
+                                     int len, uint8_t *bp)
+{
+ RTjpeg_decoder_parseYUV420(dec, sp, len);
+ RTjpeg_decoder_idctYUV420(dec, bp, 0, dec->mbh);
+}
+
 /*
 External Function
 
@@ -3210,9 +3645,9 @@ int RTjpeg_mcompressYUV420(int8_t *sp, unsigned char *bp, uint16_t lmask, uint16
 {
  int8_t * sb;
 //rh int16_t *block;
- register int8_t * bp1 = bp + (RTjpeg_width<<3);
- register int8_t * bp2 = bp + RTjpeg_Ysize;
- register int8_t * bp3 = bp2 + (RTjpeg_Csize>>1);
+ register uint8_t * bp1 = bp + (RTjpeg_width<<3);
+ register uint8_t * bp2 = bp + RTjpeg_Ysize;
+ register uint8_t * bp3 = bp2 + (RTjpeg_Csize>>1);
  register int i, j, k;
 
 #ifdef MMX
@@ -3302,8 +3737,8 @@ int RTjpeg_mcompressYUV422(int8_t *sp, unsigned char *bp, uint16_t lmask, uint16
 {
  int8_t * sb;
  int16_t *block;
- register int8_t * bp2;
- register int8_t * bp3;
+ register uint8_t * bp2;
+ register uint8_t * bp3;
  register int i, j, k;
 
 #ifdef MMX
@@ -51,4 +51,34 @@ extern void RTjpeg_yuvrgb16(uint8_t *buf, uint8_t *rgb, int stride);
 extern void RTjpeg_yuvrgb24(uint8_t *buf, uint8_t *rgb, int stride);
 extern void RTjpeg_yuvrgb32(uint8_t *buf, uint8_t *rgb, int stride);
 
+/*
+ * Context based decoder (YUV420 only). Unlike the functions above it
+ * keeps no global state, so several streams can be decoded at once.
+ * A frame is decoded in two steps: RTjpeg_decoder_parseYUV420 reads the
+ * whole bitstream, then RTjpeg_decoder_idctYUV420 reconstructs a range
+ * of 16 lines high macroblock rows. The latter can run concurrently on
+ * disjoint ranges, between two parses.
+ *
+ * RTjpeg_decoder_new takes the 128 quantizer values of the stream (as
+ * RTjpeg_init_decompress does) and the aclib AC_* flags of the
+ * accelerations to use; it returns NULL if the size is not a multiple
+ * of 16 or on memory shortage.
+ * RTjpeg_decoder_parseYUV420 returns the number of bytes used, or -1 if
+ * the frame is truncated (the missing blocks are then left untouched).
+ * It may read up to one block past `len' before noticing.
+ * Like RTjpeg_decompressYUV420, blocks not coded in the stream
+ * (motion compressed ones) are not written at all.
+ */
+typedef struct RTjpeg_decoder_ RTjpegDecoder;
 
+extern RTjpegDecoder *RTjpeg_decoder_new(const uint32_t *buf,
+                                         int width, int height, int accel);
+extern void RTjpeg_decoder_free(RTjpegDecoder *dec);
+extern int RTjpeg_decoder_rows(const RTjpegDecoder *dec);
+extern int RTjpeg_decoder_parseYUV420(RTjpegDecoder *dec,
+                                      const int8_t *sp, int len);
+extern void RTjpeg_decoder_idctYUV420(const RTjpegDecoder *dec, uint8_t *bp,
+                                      int first, int last);
+extern void RTjpeg_decoder_decompressYUV420(RTjpegDecoder *dec,
+                                            const int8_t *sp, int len,
+                                            uint8_t *bp);
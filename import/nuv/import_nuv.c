@@ -12,13 +12,14 @@
 #include "libtc/libtc.h"
 #include "libtcmodule/tcmodule-plugin.h"
 #include "libtcutil/optstr.h"
+#include "libtcutil/tcthread.h"
 #include "aclib/ac.h"
 #include "nuppelvideo.h"
 #include "RTjpegN.h"
 #include "libtcext/tc_lzo.h"
 
 #define MOD_NAME        "import_nuv.so"
-#define MOD_VERSION     "v0.9 (2006-06-03)"
+#define MOD_VERSION     "v0.10 (2026-10-18)"
 #define MOD_CAP         "Imports NuppelVideo streams"
 #define MOD_AUTHOR      "Andrew Church"
 
@@ -42,7 +43,8 @@ typedef struct {
     double audiorate;    // Actual audio rate (from SA frame)
     double audiofrac;    // Saved fractional position (for resampling)
     uint32_t cdata[128]; // Compressor data (from DR frame)
-    int dec_initted;     // Decompressor initted?
+    RTjpegDecoder *dec;  // Decompressor, NULL until the first frame
+    int threads;         // Threads reconstructing an RTjpeg frame
 
     // Previous video frame, for frame cloning
     uint8_t saved_vframe[TC_MAX_V_FRAME_WIDTH*TC_MAX_V_FRAME_HEIGHT*3];
@@ -54,6 +56,15 @@ typedef struct {
 /* NuppelVideo always uses 44100 sps */
 #define NUV_ARATE   44100
 
+/* Upper limit for the threads option */
+#define NUV_MAX_THREADS TC_THREAD_MAX_BANDS
+
+/* An RTjpeg frame being reconstructed in bands of macroblock rows */
+typedef struct {
+    const RTjpegDecoder *dec;
+    uint8_t *buf;
+} NuvFrame;
+
 /*************************************************************************/
 /*************************************************************************/
 
@@ -79,7 +90,8 @@ static int nuv_init(TCModuleInstance *self, uint32_t features)
         return TC_ERROR;
     }
     pd->fd = -1;
-    pd->dec_initted = 0;
+    pd->dec = NULL;
+    pd->threads = 1;
 
     if (verbose) {
         tc_log_info(MOD_NAME, "%s %s", MOD_VERSION, MOD_CAP);
@@ -107,6 +119,7 @@ static int nuv_fini(TCModuleInstance *self)
         close(pd->fd);
         pd->fd = -1;
     }
+    RTjpeg_decoder_free(pd->dec);
 
     tc_free(self->userdata);
     self->userdata = NULL;
@@ -131,6 +144,12 @@ static int nuv_configure(TCModuleInstance *self, const char *options,
 
     pd = self->userdata;
 
+    pd->threads = TC_MAX(vob->im_v_threads, 1);
+    if (options) {
+        optstr_get(options, "threads", "%i", &pd->threads);
+    }
+    pd->threads = TC_CLAMP(pd->threads, 1, NUV_MAX_THREADS);
+
     // FIXME: is this a good place for open()?  And how do we know which
     // file (video or audio) to open?
     pd->fd = open(filename, O_RDONLY);
@@ -191,7 +210,8 @@ static int nuv_stop(TCModuleInstance *self)
         close(pd->fd);
         pd->fd = -1;
     }
-    pd->dec_initted = 0;
+    RTjpeg_decoder_free(pd->dec);
+    pd->dec = NULL;
 
     return TC_OK;
 }
@@ -219,7 +239,11 @@ static int nuv_inspect(TCModuleInstance *self,
         tc_snprintf(buf, sizeof(buf),
                     "Overview:\n"
                     "    Decodes NuppelVideo streams.\n"
-                    "Options available: None.\n");
+                    "Options available:\n"
+                    "    threads=N  threads reconstructing each RTjpeg"
+                    " frame\n"
+                    "               (default: --import_threads, max %i)\n",
+                    NUV_MAX_THREADS);
        *value = buf;
     }
     return TC_IMPORT_OK;
@@ -435,6 +459,42 @@ static int nuv_demultiplex(TCModuleInstance *self,
 
 /*************************************************************************/
 
+/**
+ * nuv_band:  Reconstruct a band of macroblock rows of the last parsed
+ * RTjpeg frame.  Called by tc_thread_bands().
+ */
+
+static void nuv_band(void *datum, int band, int first, int last)
+{
+    NuvFrame *frame = datum;
+
+    RTjpeg_decoder_idctYUV420(frame->dec, frame->buf, first, last);
+}
+
+/**
+ * nuv_decode_rtjpeg:  Decode an RTjpeg frame.  The bitstream is parsed
+ * in this thread (blocks have variable length), then the frame is cut
+ * in pd->threads bands of macroblock rows, reconstructed in parallel.
+ */
+
+static void nuv_decode_rtjpeg(PrivateData *pd, const uint8_t *encoded_frame,
+                              int in_framesize, uint8_t *outbuf)
+{
+    NuvFrame frame;
+
+    if (RTjpeg_decoder_parseYUV420(pd->dec, (const int8_t *)encoded_frame,
+                                   in_framesize) < 0) {
+        tc_log_warn(MOD_NAME, "Truncated RTjpeg frame");
+    }
+
+    frame.dec = pd->dec;
+    frame.buf = outbuf;
+    tc_thread_bands(pd->threads, RTjpeg_decoder_rows(pd->dec), nuv_band,
+                    &frame);
+}
+
+/*************************************************************************/
+
 /**
  * nuv_decode_video:  Decode a frame of data.  See tcmodule-data.h for
  * function details.
@@ -454,12 +514,21 @@ static int nuv_decode_video(TCModuleInstance *self,
 
     pd = self->userdata;
 
-    if (!pd->dec_initted) {
+    if (!pd->dec) {
         pd->width  = inframe->video_buf[0]<<8 | inframe->video_buf[1];
         pd->height = inframe->video_buf[2]<<8 | inframe->video_buf[3];
-        RTjpeg_init_decompress((uint32_t *)(inframe->video_buf+5),
-                               pd->width, pd->height);
-        pd->dec_initted = 1;
+        pd->dec = RTjpeg_decoder_new((uint32_t *)(inframe->video_buf+5),
+                                     pd->width, pd->height,
+                                     tc_get_session()->acceleration);
+        if (!pd->dec) {
+            tc_log_error(MOD_NAME, "Unable to create the RTjpeg decoder"
+                         " (%ix%i)", pd->width, pd->height);
+            return TC_ERROR;
+        }
+        if (verbose & TC_DEBUG) {
+            tc_log_info(MOD_NAME, "decoding with %i thread(s)",
+                        pd->threads);
+        }
     }
 
     comptype = inframe->video_buf[4];
@@ -499,7 +568,8 @@ static int nuv_decode_video(TCModuleInstance *self,
         break;
 
       case '1':  // RTjpeg-compressed data
-        RTjpeg_decompressYUV420((int8_t *)encoded_frame, outframe->video_buf);
+        nuv_decode_rtjpeg(pd, encoded_frame, in_framesize,
+                          outframe->video_buf);
         break;
 
       case 'N':  // Black frame
@@ -119,6 +119,7 @@ static void usage(int status)
     fprintf(stderr,"    -A n              A52 decoder flag [0]\n");
     fprintf(stderr,"    -C s,e            decode only from start to end ((V) frames/(A) bytes) [all]\n");
     fprintf(stderr,"    -Y                use libdv YUY2 decoder mode\n");
+    fprintf(stderr,"    -T n              decode video in n threads (dv only) [1]\n");
     fprintf(stderr,"    -z r              convert zero padding to silence\n");
     fprintf(stderr,"    -X type[,type]    override CPU acceleration flags (for debugging)\n");
     fprintf(stderr,"    -v                print version\n");
@@ -153,10 +154,11 @@ int main(int argc, char *argv[])
     decode.frame_limit[0] = 0;
     decode.frame_limit[1] = LONG_MAX;
     decode.accel   = AC_ALL;
+    decode.threads = 1;
 
     libtc_init(&argc, &argv);
 
-    while ((ch = getopt(argc, argv, "Q:t:d:x:i:a:g:vy:s:YC:A:X:z:?h")) != -1) {
+    while ((ch = getopt(argc, argv, "Q:t:d:x:i:a:g:vy:s:YT:C:A:X:z:?h")) != -1) {
         switch (ch) {
           case 'i':
             CHECK_OPT;
@@ -198,6 +200,12 @@ int main(int argc, char *argv[])
           case 'Y':
             decode.dv_yuy2_mode=1;
             break;
+          case 'T':
+            CHECK_OPT;
+            decode.threads = atoi(optarg);
+            if (decode.threads < 1 || decode.threads > TC_IMPORT_THREADS_MAX)
+                usage(EXIT_FAILURE);
+            break;
           case 's':
             CHECK_OPT;
 	        if (3 != sscanf(optarg,"%lf,%lf,%lf",
@@ -473,6 +473,9 @@ static void info_teardown(info_t *ipipe)
  */
 typedef void (*InfoDumpFn)(info_t *ipipe);
 
+/* used for the records of sources which can't be probed */
+static ProbeInfo empty_probe_info;
+
 /*
  * dump_info_binary:
  *
@@ -495,6 +498,28 @@ static void dump_info_binary(info_t *ipipe)
               sizeof(ProbeInfo));
 }
 
+/*
+ * dump_record_binary:
+ *
+ *      multiple sources variant of dump_info_binary: dump the probing
+ *      status (as int32_t, 0 means succesfull) followed by the ProbeInfo
+ *      structure (zeroed if probing failed). The pid is dumped just once
+ *      before all the records.
+ *
+ * Parameters:
+ *      ipipe: info_t structure holding the ProbeInfo data to dump.
+ * Return Value:
+ *      None
+ */
+static void dump_record_binary(info_t *ipipe)
+{
+    int32_t error = ipipe->error;
+    const ProbeInfo *pi = (error == 0) ?ipipe->probe_info :&empty_probe_info;
+
+    tc_pwrite(STDOUT_FILENO, (uint8_t *) &error, sizeof(error));
+    tc_pwrite(STDOUT_FILENO, (uint8_t *) pi, sizeof(ProbeInfo));
+}
+
 
 #define PROBED_NEW  "(*)"   /* value different from tc's defaults */
 #define PROBED_STD  ""      /* value equals to tc's defaults */
@@ -786,6 +811,30 @@ static void dump_info_raw(info_t *ipipe)
     printf("ID_LENGTH=%.2f\n", duration);
 }
 
+/*
+ * dump_record_raw:
+ *
+ *      multiple sources variant of dump_info_raw: the fields of each
+ *      source are followed by ID_PROBE_ERROR (0 means succesfull) and
+ *      by an empty line, which terminates the record.
+ *      For sources which can't be probed only ID_FILENAME and
+ *      ID_PROBE_ERROR are printed.
+ *
+ * Parameters:
+ *      ipipe: info_t structure holding the ProbeInfo data to dump.
+ * Return Value:
+ *      None
+ */
+static void dump_record_raw(info_t *ipipe)
+{
+    if (ipipe->error == 0) {
+        dump_info_raw(ipipe);
+    } else {
+        printf("ID_FILENAME=\"%s\"\n", ipipe->name);
+    }
+    printf("ID_PROBE_ERROR=%i\n\n", ipipe->error);
+}
+
 /*
  * dump_info_new:
  *      dump a ProbeInfo structure in new, better
@@ -911,7 +960,7 @@ static void usage(int status)
 {
     version();
 
-    printf("Usage: %s [options] [-]\n", EXE);
+    printf("Usage: %s [options] [-|file ...]\n", EXE);
     printf("    -i name        input file/directory/device/host"
                     " name [stdin]\n");
     printf("    -B             binary output to stdout"
@@ -928,6 +977,8 @@ static void usage(int status)
     printf("    -f seekfile    seek/index file [off]\n");
     printf("    -d verbosity   verbosity mode [1]\n");
     printf("    -v             print version\n");
+    printf("\nWhen more files are given, they are all probed in a single"
+           " run.\nWith -B or -R, a record is produced for each file.\n");
 
     exit(status);
 }
@@ -936,6 +987,69 @@ static void usage(int status)
  * universal probing code frontend
  * ------------------------------------------------------------*/
 
+/*
+ * probe_source_list:
+ *
+ *      probe a list of sources in a single run, in the given order,
+ *      saving a fork and exec for each one (think about scanning a
+ *      directory holding thousands of clips).
+ *      A source which can't be probed doesn't stop the scan; in binary
+ *      and raw mode a record is produced anyway, carrying the error
+ *      code, so each record can be matched with its source.
+ *
+ * Parameters:
+ *               proto: info_t structure already initialized with the
+ *                      settings common to all sources.
+ *               names: array of source names.
+ *               count: number of entries in `names'.
+ *   skip, mplayer_probe,
+ *            want_dvd: see info_setup.
+ *      output_handler: dump function selected by user.
+ * Return Value:
+ *      0 if all sources were probed succesfully, the error code of the
+ *      last failed one otherwise.
+ */
+static int probe_source_list(const info_t *proto,
+                             const char **names, int count,
+                             int skip, int mplayer_probe, int want_dvd,
+                             InfoDumpFn output_handler)
+{
+    int i, ret = 0;
+
+    if (output_handler == dump_info_binary) {
+        pid_t pid = getpid();
+        tc_pwrite(STDOUT_FILENO, (uint8_t *) &pid, sizeof(pid_t));
+        output_handler = dump_record_binary;
+    } else if (output_handler == dump_info_raw) {
+        output_handler = dump_record_raw;
+    }
+
+    for (i = 0; i < count; i++) {
+        info_t ipipe = *proto;
+
+        ipipe.name = names[i];
+        if (info_setup(&ipipe, skip, mplayer_probe, want_dvd)
+          == TC_IMPORT_OK) {
+            probe_stream(&ipipe);
+        } else {
+            ipipe.error = 1;
+        }
+
+        if (ipipe.error == 0
+         || output_handler == dump_record_binary
+         || output_handler == dump_record_raw) {
+            output_handler(&ipipe);
+        } else if (verbose) {
+            tc_log_error(EXE, "failed to probe source '%s'", ipipe.name);
+        }
+        if (ipipe.error != 0) {
+            ret = ipipe.error;
+        }
+        info_teardown(&ipipe);
+    }
+    return ret;
+}
+
 /* very basic option sanity check */
 #define VALIDATE_OPTION \
     if (optarg[0]=='-') { \
@@ -1032,10 +1146,34 @@ int main(int argc, char *argv[])
     }
 
     if (optind < argc) {
-        if (strcmp(argv[optind],"-") != 0) {
-            usage(EXIT_FAILURE);
+        if (argc - optind == 1 && strcmp(argv[optind], "-") == 0) {
+            ipipe.stype = TC_STYPE_STDIN;
+        } else {
+            /* multiple sources mode, -i source (if any) comes first */
+            const char **names = tc_malloc((argc - optind + 1)
+                                           * sizeof(const char *));
+            int count = 0;
+
+            if (names == NULL) {
+                tc_log_error(EXE, "out of memory");
+                exit(1);
+            }
+            if (name != NULL) {
+                names[count++] = name;
+            }
+            while (optind < argc) {
+                names[count++] = argv[optind++];
+            }
+            ipipe.verbose = verbose;
+            ipipe.fd_out = STDOUT_FILENO;
+            ipipe.codec = TC_CODEC_UNKNOWN;
+
+            ret = probe_source_list(&ipipe, names, count, skip,
+                                    mplayer_probe, want_dvd,
+                                    output_handler);
+            tc_free(names);
+            return ret;
         }
-        ipipe.stype = TC_STYPE_STDIN;
     }
 
     /* assume defaults */
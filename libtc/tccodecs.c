@@ -42,6 +42,12 @@ static const TCCodecInfo tc_codecs_info[] = {
                            "YUV422P",                0, TC_VIDEO },
     { TC_CODEC_YUY2,       "yuy2",        "YUY2",
                            "YUY2",                   0, TC_VIDEO },
+    { TC_CODEC_YUV420P10,  "yuv420p10",   NULL,
+                           "YUV420P 10 bit",         0, TC_VIDEO },
+    { TC_CODEC_YUV422P10,  "yuv422p10",   NULL,
+                           "YUV422P 10 bit",         0, TC_VIDEO },
+    { TC_CODEC_YUV444P16,  "yuv444p16",   NULL,
+                           "YUV444P 16 bit",         0, TC_VIDEO },
     /* video codecs */
     // XXX: right fcc?
     { TC_CODEC_MPEG1VIDEO, "mpeg1video",  "mpg1",
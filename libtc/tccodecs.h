@@ -39,6 +39,10 @@ typedef enum {
     TC_CODEC_UYVY       = 0x59565955,
     TC_CODEC_YUV2       = 0x32565559,
     TC_CODEC_YUY2       = 0x32595559,
+    /* high bit depth planar YUV, samples in native-endian 16-bit words */
+    TC_CODEC_YUV420P10  = 0x0A0B3359,
+    TC_CODEC_YUV422P10  = 0x0A0A3359,
+    TC_CODEC_YUV444P16  = 0x10003359,
 
     /* ok, now the real codecs */
     TC_CODEC_PCM        = 0x00000001, /* incidental */
@@ -28,6 +28,7 @@
 #include "libtcutil/memutils.h"
 #include "libtcutil/logging.h"
 #include "libtcutil/common.h"
+#include "libtcutil/tcthread.h"
 
 #include "mediainfo.h"
 #include "tcframes.h"
@@ -52,6 +53,22 @@ int tc_video_planes_size(size_t psizes[3],
         psizes[1] = width * height / 4;
         psizes[2] = width * height / 4;
         break;
+      /* the high bit depth ones take two bytes per sample */
+      case TC_CODEC_YUV444P16:
+        psizes[0] = width * height * 2;
+        psizes[1] = width * height * 2;
+        psizes[2] = width * height * 2;
+        break;
+      case TC_CODEC_YUV422P10:
+        psizes[0] = width * height * 2;
+        psizes[1] = width * height;
+        psizes[2] = width * height;
+        break;
+      case TC_CODEC_YUV420P10:
+        psizes[0] = width * height * 2;
+        psizes[1] = width * height / 2;
+        psizes[2] = width * height / 2;
+        break;
       default: /* unknown */
         psizes[0] = 0;
         psizes[1] = 0;
@@ -88,8 +105,240 @@ size_t tc_audio_frame_size(double samples, int channels,
 
 #undef TRUNC_VALUE
 
+void tc_borrow_video_frame(TCFrameVideo *dst, const TCFrameVideo *src)
+{
+    dst->video_buf   = src->video_buf;
+    dst->video_len   = src->video_len;
+    dst->attributes |= TC_FRAME_IS_BORROWED;
+}
+
+void tc_borrow_audio_frame(TCFrameAudio *dst, const TCFrameAudio *src)
+{
+    dst->audio_buf   = src->audio_buf;
+    dst->audio_len   = src->audio_len;
+    dst->attributes |= TC_FRAME_IS_BORROWED;
+}
+
+/*************************************************************************/
+
+/* Payloads nobody refers to anymore keep their buffer, ready to be given
+ * to a frame in exchange for its own one; up to this many are kept. */
+#define TC_PAYLOAD_SPARES_MAX   32
+
+static TCMutex payload_lock = { PTHREAD_MUTEX_INITIALIZER };
+static TCFramePayload *payload_spares = NULL;
+static int payload_spare_count = 0;
+
+/* Gets a payload with a buffer of at least `size' bytes and a single
+ * reference; payload_lock must be held. */
+static TCFramePayload *payload_get(int size)
+{
+    TCFramePayload *pl = NULL, **prev = &payload_spares;
+
+    for (pl = payload_spares; pl != NULL; prev = &pl->next, pl = pl->next) {
+        if (pl->size >= size) {
+            *prev = pl->next;
+            payload_spare_count--;
+            break;
+        }
+    }
+    if (pl == NULL) {
+        pl = tc_malloc(sizeof(TCFramePayload));
+        if (pl == NULL) {
+            return NULL;
+        }
+        pl->data = tc_bufalloc(size);
+        if (pl->data == NULL) {
+            tc_free(pl);
+            return NULL;
+        }
+        pl->size = size;
+    }
+    pl->refs = 1;
+    pl->next = NULL;
+    return pl;
+}
+
+/* Index of the internal buffer `buf' is, or -1 if it is a foreign one. */
+static int video_buf_index(const TCFrameVideo *ptr, const uint8_t *buf)
+{
+    if (buf != NULL && buf == ptr->internal_video_buf_0) {
+        return 0;
+    }
+    if (buf != NULL && buf == ptr->internal_video_buf_1) {
+        return 1;
+    }
+    return -1;
+}
+
+/* The internal buffer the frame works in (the other one is `free'). */
+static uint8_t *own_video_buf(const TCFrameVideo *ptr)
+{
+    return (ptr->free == 0) ? ptr->internal_video_buf_1
+                            : ptr->internal_video_buf_0;
+}
+
+#ifdef STATBUFFER
+/* Replaces the internal buffer `n', keeping the plane pointers in place;
+ * returns the old one. */
+static uint8_t *swap_video_buf(TCFrameVideo *ptr, int n, uint8_t *buf)
+{
+    uint8_t *old = (n == 0) ? ptr->internal_video_buf_0
+                            : ptr->internal_video_buf_1;
+
+    ptr->video_buf_RGB[n] = buf + (ptr->video_buf_RGB[n] - old);
+    ptr->video_buf_Y[n]   = buf + (ptr->video_buf_Y[n]   - old);
+    ptr->video_buf_U[n]   = buf + (ptr->video_buf_U[n]   - old);
+    ptr->video_buf_V[n]   = buf + (ptr->video_buf_V[n]   - old);
+    if (ptr->video_buf2 == old) {
+        ptr->video_buf2 = buf;
+    }
+    if (n == 0) {
+        ptr->internal_video_buf_0 = buf;
+    } else {
+        ptr->internal_video_buf_1 = buf;
+    }
+    return old;
+}
+#endif
+
+TCFramePayload *tc_hold_video_frame(TCFrameVideo *ptr)
+{
+    TCFramePayload *pl = NULL;
+    int size = (ptr->video_buf_size > 0) ?ptr->video_buf_size :ptr->video_size;
+    int n = video_buf_index(ptr, ptr->video_buf);
+
+    tc_mutex_lock(&payload_lock);
+    if (ptr->payload != NULL) {
+        pl = ptr->payload;
+        pl->refs++;
+        tc_mutex_unlock(&payload_lock);
+        return pl;
+    }
+    pl = payload_get(size);
+    if (pl != NULL) {
+        pl->refs++;  /* the frame shows it too */
+    }
+    tc_mutex_unlock(&payload_lock);
+    if (pl == NULL) {
+        return NULL;
+    }
+
+#ifdef STATBUFFER
+    if (n >= 0 && ptr->video_buf_size > 0) {
+        /* the spare buffer is at least as large as the frame ones */
+        pl->data = swap_video_buf(ptr, n, pl->data);
+        pl->size = ptr->video_buf_size;
+    } else
+#endif
+    {
+        memcpy(pl->data, ptr->video_buf, ptr->video_size);
+    }
+    ptr->video_buf = pl->data;
+    ptr->payload   = pl;
+    return pl;
+}
+
+void tc_share_video_frame(TCFrameVideo *ptr, TCFramePayload *pl)
+{
+    if (ptr->payload != pl) {
+        tc_mutex_lock(&payload_lock);
+        pl->refs++;
+        tc_mutex_unlock(&payload_lock);
+
+        tc_release_payload(ptr->payload);
+        ptr->payload = pl;
+    }
+    ptr->video_buf = pl->data;
+}
+
+void tc_unshare_video_frame(TCFrameVideo *ptr)
+{
+    TCFramePayload *pl = ptr->payload;
+    uint8_t *own = NULL;
+    int exchange = TC_FALSE;
+
+    if (pl == NULL) {
+        return;
+    }
+    ptr->payload = NULL;
+    if (ptr->video_buf != pl->data) {
+        /* already working in its own buffer */
+        tc_release_payload(pl);
+        return;
+    }
+    own = own_video_buf(ptr);
+
+#ifdef STATBUFFER
+    tc_mutex_lock(&payload_lock);
+    /* nobody else can take a reference if this frame has the last one */
+    exchange = (pl->refs == 1 && ptr->video_buf_size > 0
+                && pl->size >= ptr->video_buf_size
+                && video_buf_index(ptr, own) >= 0);
+    tc_mutex_unlock(&payload_lock);
+    if (exchange) {
+        pl->data = swap_video_buf(ptr, video_buf_index(ptr, own), pl->data);
+        pl->size = ptr->video_buf_size;
+    }
+#endif
+    if (!exchange) {
+        memcpy(own, pl->data, ptr->video_size);
+        ptr->video_buf = own;
+    }
+    tc_release_payload(pl);
+}
+
+void tc_release_payload(TCFramePayload *pl)
+{
+    if (pl == NULL) {
+        return;
+    }
+    tc_mutex_lock(&payload_lock);
+    if (--pl->refs > 0) {
+        pl = NULL;
+    } else if (payload_spare_count < TC_PAYLOAD_SPARES_MAX) {
+        pl->next = payload_spares;
+        payload_spares = pl;
+        payload_spare_count++;
+        pl = NULL;
+    }
+    tc_mutex_unlock(&payload_lock);
+
+    if (pl != NULL) {
+        tc_buffree(pl->data);
+        tc_free(pl);
+    }
+}
+
+/*************************************************************************/
+
+void tc_restore_video_frame(TCFrameVideo *ptr)
+{
+    if (ptr->payload != NULL) {
+        tc_release_payload(ptr->payload);
+        ptr->payload     = NULL;
+        ptr->video_buf   = own_video_buf(ptr);
+        ptr->video_len   = 0;
+    }
+    if (ptr->attributes & TC_FRAME_IS_BORROWED) {
+        ptr->video_buf   = ptr->internal_video_buf_0;
+        ptr->video_len   = 0;
+        ptr->attributes &= ~TC_FRAME_IS_BORROWED;
+    }
+}
+
+void tc_restore_audio_frame(TCFrameAudio *ptr)
+{
+    if (ptr->attributes & TC_FRAME_IS_BORROWED) {
+        ptr->audio_buf   = ptr->internal_audio_buf;
+        ptr->audio_len   = 0;
+        ptr->attributes &= ~TC_FRAME_IS_BORROWED;
+    }
+}
+
 void tc_reset_video_frame(TCFrameVideo *ptr)
 {
+    tc_restore_video_frame(ptr);
     ptr->attributes = 0;
     ptr->timestamp  = 0;
     ptr->video_len  = 0;
@@ -97,6 +346,7 @@ void tc_reset_video_frame(TCFrameVideo *ptr)
 
 void tc_reset_audio_frame(TCFrameAudio *ptr)
 {
+    tc_restore_audio_frame(ptr);
     ptr->attributes = 0;
     ptr->timestamp  = 0;
     ptr->audio_len  = 0;
@@ -227,6 +477,7 @@ TCFrameVideo *tc_alloc_video_frame(size_t size, int partial)
             vptr->internal_video_buf_1 = NULL;
         }
         vptr->video_size = size;
+        vptr->video_buf_size = size;
 #endif /* STATBUFFER */
     }
     return vptr;
@@ -257,6 +508,7 @@ TCFrameAudio *tc_alloc_audio_frame(size_t size)
 void tc_del_video_frame(TCFrameVideo *vptr)
 {
     if (vptr != NULL) {
+        tc_restore_video_frame(vptr);
 #ifdef STATBUFFER
         if (vptr->internal_video_buf_1 != NULL) {
             tc_buffree(vptr->internal_video_buf_1);
@@ -282,6 +534,19 @@ void tc_del_audio_frame(TCFrameAudio *aptr)
 #define BLACK_Y         (0)
 #define BLACK_UV        (128)
 #define BLACK_RGB       (0)
+#define BLACK_UV_10     (512)
+#define BLACK_UV_16     (32768)
+
+/* fills `size' bytes of 16-bit samples with `value' */
+static void fill_samples16(uint8_t *buf, uint16_t value, size_t size)
+{
+    uint16_t *samples = (uint16_t *)buf;
+    size_t i;
+
+    for (i = 0; i < size / 2; i++) {
+        samples[i] = value;
+    }
+}
 
 void tc_blank_video_frame(TCFrameVideo *ptr)
 {
@@ -302,6 +567,17 @@ void tc_blank_video_frame(TCFrameVideo *ptr)
             memset(ptr->video_buf,             BLACK_Y,  psizes[0]            );
             memset(ptr->video_buf + psizes[0], BLACK_UV, psizes[1] + psizes[2]);
             break;
+          case TC_CODEC_YUV420P10:
+          case TC_CODEC_YUV422P10:
+            memset(ptr->video_buf, BLACK_Y, psizes[0]);
+            fill_samples16(ptr->video_buf + psizes[0], BLACK_UV_10,
+                           psizes[1] + psizes[2]);
+            break;
+          case TC_CODEC_YUV444P16:
+            memset(ptr->video_buf, BLACK_Y, psizes[0]);
+            fill_samples16(ptr->video_buf + psizes[0], BLACK_UV_16,
+                           psizes[1] + psizes[2]);
+            break;
           default:
             tc_log_warn(__FILE__, "tc_blank_video_frame():"
                         " format %s (0x%X) not yet supported",
@@ -253,7 +253,8 @@ void tc_blank_audio_frame(TCFrameAudio *ptr);
 /*
  * tc_reset_{video,audio}_frame:
  *      reset the frame attributes. Lightweight reinitialization.
- *      Pulled by libtcexport needs.
+ *      Pulled by libtcexport needs. A borrowed or shared payload
+ *      (see below) is given back first.
  *      It will probably be merged into tc_init_{video,audio}_frame
  *      in a future release.
  *
@@ -265,5 +266,123 @@ void tc_blank_audio_frame(TCFrameAudio *ptr);
 void tc_reset_video_frame(TCFrameVideo *ptr);
 void tc_reset_audio_frame(TCFrameAudio *ptr);
 
+/*
+ * tc_borrow_{video,audio}_frame:
+ *      make a frame refer to the payload of another one instead of
+ *      copying it, marking it with TC_FRAME_IS_BORROWED. This is meant
+ *      for passthrough encoders: the export layer guarantees that the
+ *      source frame lives until the borrowing frame is multiplexed,
+ *      and gives the payload back right after (see below).
+ *      Only the buffer pointer and the data length are taken;
+ *      use vframe_copy/aframe_copy with copy_data=0 for the rest.
+ *
+ * Parameters:
+ *     dst: frame borrowing the payload.
+ *     src: frame owning the payload.
+ * Return Value:
+ *     None.
+ */
+void tc_borrow_video_frame(TCFrameVideo *dst, const TCFrameVideo *src);
+void tc_borrow_audio_frame(TCFrameAudio *dst, const TCFrameAudio *src);
+
+/*
+ * tc_restore_{video,audio}_frame:
+ *      give back a borrowed or shared payload: make the frame use its
+ *      own buffer again (emptied). Does nothing if the frame owns its
+ *      payload.
+ *      The frame must have been created by tc_new_{video,audio}_frame.
+ *
+ * Parameters:
+ *     ptr: pointer to frame to restore.
+ * Return Value:
+ *     None.
+ */
+void tc_restore_video_frame(TCFrameVideo *ptr);
+void tc_restore_audio_frame(TCFrameAudio *ptr);
+
+/*************************************************************************/
+
+/*
+ * Shared video payloads.
+ *
+ * A filter which needs to keep a picture around, or to emit again a
+ * picture it saw earlier, can take a reference on the payload of a
+ * frame instead of copying it, and later make any frame show that
+ * payload. A frame showing a payload is "shared" (its `payload' field
+ * is not NULL): the data is read-only, and whoever wants to write into
+ * it must call tc_unshare_video_frame first (copy-on-write).
+ * tc_filter_process does that before handing a shared frame to a filter
+ * which did not declare the "S" capability (see optstr_filter_desc),
+ * and so do the core video transformations; encoders which convert
+ * their input in place must do it by themselves.
+ *
+ * A shared frame gives the payload back when it is restored (see
+ * above), which the framebuffer does when the frame returns to the pool.
+ */
+
+typedef struct tcframepayload_ TCFramePayload;
+struct tcframepayload_ {
+    uint8_t *data;         /* the picture; read-only while shared */
+    int size;              /* allocated size of the buffer */
+
+    int refs;              /* private */
+    TCFramePayload *next;  /* private */
+};
+
+/*
+ * tc_hold_video_frame:
+ *      take a reference on the picture shown by a frame. If the frame
+ *      owns it, the buffer itself becomes the payload (the frame gets a
+ *      spare one in exchange) and the frame goes on showing it as
+ *      shared, so nothing is copied.
+ *
+ * Parameters:
+ *     ptr: frame showing the picture to keep.
+ * Return Value:
+ *     a payload reference, to be given back using tc_release_payload,
+ *     or NULL on allocation failure.
+ */
+TCFramePayload *tc_hold_video_frame(TCFrameVideo *ptr);
+
+/*
+ * tc_share_video_frame:
+ *      make a frame show a payload, which gets one more reference. The
+ *      previously shown payload, if any, is given back. Only the buffer
+ *      pointer is changed.
+ *
+ * Parameters:
+ *     ptr: frame to update.
+ *      pl: payload to show.
+ * Return Value:
+ *     None.
+ */
+void tc_share_video_frame(TCFrameVideo *ptr, TCFramePayload *pl);
+
+/*
+ * tc_unshare_video_frame:
+ *      make a frame own the picture it shows, so it can be modified.
+ *      The payload is copied into the frame buffer, unless nobody else
+ *      refers to it (the buffers are just exchanged back) or the frame
+ *      shows its own buffer already. Does nothing on unshared frames.
+ *
+ * Parameters:
+ *     ptr: frame to make writable.
+ * Return Value:
+ *     None.
+ */
+void tc_unshare_video_frame(TCFrameVideo *ptr);
+
+/*
+ * tc_release_payload:
+ *      give back a reference obtained by tc_hold_video_frame.
+ *      Buffers of payloads no longer referenced are recycled.
+ *
+ * Parameters:
+ *     pl: payload reference to give back (NULL is accepted).
+ * Return Value:
+ *     None.
+ */
+void tc_release_payload(TCFramePayload *pl);
+
 
 #endif  /* TCFRAMES_H */
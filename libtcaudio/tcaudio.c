@@ -11,6 +11,7 @@
 #include "tcaudio.h"
 
 #include "libtc/libtc.h"
+#include "aclib/ac.h"
 
 #include <math.h>
 
@@ -23,6 +24,7 @@
 struct tcahandle_ {
     AudioFormat format;            /* Sample format */
     int bits, issigned, msbfirst;  /* Information about sample format */
+    int accel;                     /* AC_* flags usable by this handle */
 };
 
 /*************************************************************************/
@@ -33,6 +35,10 @@ static int tca_get_format_info(AudioFormat format, int *bits_ret,
                                int *issigned_ret, int *msbfirst_ret);
 static int tca_convert(const char *funcname, TCAHandle handle, void *buf,
                        int len, AudioFormat srcfmt, AudioFormat destfmt);
+#if defined(HAVE_ASM_SSE2) && defined(ARCH_X86_64)
+static int tca_amplify_ramp_sse2(int16_t *buf, int count, int chans,
+                                 float scale, float step);
+#endif
 
 /*************************************************************************/
 /*************************************************************************/
@@ -70,6 +76,7 @@ TCAHandle tca_init(AudioFormat format)
     handle->bits     = bits;
     handle->issigned = issigned;
     handle->msbfirst = msbfirst;
+    handle->accel    = AC_NONE;
     return handle;
 }
 
@@ -91,6 +98,27 @@ void tca_free(TCAHandle handle)
 
 /*************************************************************************/
 
+/**
+ * tca_set_accel:  Select the CPU acceleration features tcaudio functions
+ * may use with the given handle (by default, none).  Accelerated
+ * routines give the same results as the plain C ones.
+ *
+ * Parameters: handle: tcaudio handle.
+ *              accel: Set of AC_* flags (see aclib/ac.h), usually the
+ *                     ones transcode was told to use.
+ * Return value: None.
+ * Preconditions: handle != 0: handle was returned by tca_init()
+ * Postconditions: None.
+ */
+
+void tca_set_accel(TCAHandle handle, int accel)
+{
+    if (handle)
+        handle->accel = accel;
+}
+
+/*************************************************************************/
+
 /**
  * tca_convert_from:  Convert the given audio buffer from another sample
  * format to the format given in tca_init().
@@ -208,6 +236,118 @@ int tca_amplify(TCAHandle handle, void *buf, int len, double scale,
 
 /*************************************************************************/
 
+/**
+ * tca_amplify_ramp:  Amplify the given audio buffer by a scale factor
+ * which changes linearly from `scale_from' at the first sample to
+ * `scale_to' at the sample following the buffer, so that consecutive
+ * buffers amplified with matching factors join without a step.  All the
+ * channels of a sample share the same factor.  Samples are clipped to
+ * the sample format's amplitude range; if `nclip_ret' is not NULL, the
+ * number of clipped samples is stored there (unmodified on error).
+ *
+ * The computation is done in single precision and rounded to the nearest
+ * value (ties to even), so that the accelerated version gives exactly
+ * the same results as the C one.
+ *
+ * Parameters:     handle: tcaudio handle.
+ *                    buf: Audio data buffer.
+ *                    len: Audio data length, in samples per channel.
+ *                  chans: Number of interleaved channels.
+ *             scale_from: Factor for the first sample.
+ *               scale_to: Factor for the sample following the buffer.
+ *              nclip_ret: Variable to store number of clipped samples in,
+ *                         or NULL if this value is not required.
+ * Return value: Nonzero on success, zero on error (invalid parameters).
+ * Preconditions: handle != 0: handle was returned by tca_init()
+ * Postconditions: None.
+ */
+
+int tca_amplify_ramp(TCAHandle handle, void *buf, int len, int chans,
+                     double scale_from, double scale_to, int *nclip_ret)
+{
+    float scale, step;
+    int nclip, min, max, i;
+
+    if (!handle || !buf || len < 0 || chans < 1) {
+        tc_log_error("libtcaudio", "tca_amplify_ramp: invalid parameters!");
+        return 0;
+    }
+    if (handle->bits != 8 && handle->bits != 16) {
+        tc_log_error("libtcaudio", "tca_amplify_ramp: %d-bit samples not"
+                     " supported", handle->bits);
+        return 0;
+    }
+    if (len == 0) {
+        if (nclip_ret)
+            *nclip_ret = 0;
+        return 1;
+    }
+    scale = scale_from;
+    step  = (scale_to - scale_from) / len;
+    nclip = 0;
+    i     = 0;
+
+#if defined(HAVE_ASM_SSE2) && defined(ARCH_X86_64)
+    /* Native signed 16-bit samples, with the products in 32-bit range */
+    if ((handle->accel & AC_SSE2) && handle->bits == 16
+     && handle->issigned && !handle->msbfirst
+     && (chans == 1 || chans == 2)
+     && fabs(scale_from) < 32768 && fabs(scale_to) < 32768
+    ) {
+        i = (len * chans) & ~3;
+        if (i > 0)
+            nclip = tca_amplify_ramp_sse2(buf, i, chans, scale, step);
+    }
+#endif
+
+    max = (handle->bits == 8) ? 0x7F : 0x7FFF;
+    min = -max - 1;
+    for (; i < len * chans; i++) {
+        float v;
+        int32_t s, r;
+
+        if (handle->bits == 8) {
+            s = ((uint8_t *)buf)[i] - (handle->issigned ? 0 : 0x80);
+            if (handle->issigned)
+                s = (int8_t)s;
+        } else {
+            const uint8_t *p = (uint8_t *)buf + i*2;
+            s = handle->msbfirst ? p[0]<<8 | p[1] : p[1]<<8 | p[0];
+            if (handle->issigned)
+                s = (int16_t)s;
+            else
+                s -= 0x8000;
+        }
+
+        v = (float)s * (scale + step * (float)(i / chans));
+        if (v >= max + 0.5f) {
+            r = max;
+            nclip++;
+        } else if (v < min - 0.5f) {
+            r = min;
+            nclip++;
+        } else {
+            r = lrintf(v);
+        }
+
+        if (handle->bits == 8) {
+            ((uint8_t *)buf)[i] = r + (handle->issigned ? 0 : 0x80);
+        } else {
+            uint8_t *p = (uint8_t *)buf + i*2;
+            if (!handle->issigned)
+                r += 0x8000;
+            p[handle->msbfirst ? 0 : 1] = r >> 8;
+            p[handle->msbfirst ? 1 : 0] = r & 0xFF;
+        }
+    }
+
+    if (nclip_ret)
+        *nclip_ret = nclip;
+    return 1;
+}
+
+/*************************************************************************/
+
 /**
  * tca_mono_to_stereo:  Convert monaural audio data to stereo by
  * duplicating the data into both stereo channels.
@@ -426,6 +566,88 @@ static int tca_convert(const char *funcname, TCAHandle handle, void *buf,
     return 1;
 }
 
+#if defined(HAVE_ASM_SSE2) && defined(ARCH_X86_64)
+
+/**
+ * tca_amplify_ramp_sse2:  SSE2 version of the tca_amplify_ramp() loop for
+ * native signed 16-bit samples, four samples at a time.  The factor of
+ * each sample is computed from its sample index exactly as the C loop
+ * does; CVTPS2DQ rounds like lrintf() in the default rounding mode, and
+ * PACKSSDW saturates like the C clipping.
+ *
+ * Parameters:   buf: Audio data buffer.
+ *             count: Number of samples (all channels) to process; must be
+ *                    a multiple of 4.
+ *             chans: Number of interleaved channels (1 or 2).
+ *             scale: Factor for the first sample.
+ *              step: Factor increment per sample and channel.
+ * Return value: Number of clipped samples.
+ * Preconditions: buf != NULL
+ *                count > 0
+ * Postconditions: None.
+ */
+
+static const int32_t ramp_index_mono[4] __attribute__((aligned(16)))
+    = { 0, 1, 2, 3 };
+static const int32_t ramp_index_stereo[4] __attribute__((aligned(16)))
+    = { 0, 0, 1, 1 };
+static const int32_t ramp_s16_max[4] __attribute__((aligned(16)))
+    = { 0x7FFF, 0x7FFF, 0x7FFF, 0x7FFF };
+static const int32_t ramp_s16_min[4] __attribute__((aligned(16)))
+    = { -0x8000, -0x8000, -0x8000, -0x8000 };
+
+static int tca_amplify_ramp_sse2(int16_t *buf, int count, int chans,
+                                 float scale, float step)
+{
+    int32_t clips[4] __attribute__((aligned(16)));
+    long index = 0;
+
+    __asm__ __volatile__(
+        "movd %[scale], %%xmm5                                  \n\
+        pshufd $0, %%xmm5, %%xmm5                               \n\
+        movd %[step], %%xmm6                                    \n\
+        pshufd $0, %%xmm6, %%xmm6                               \n\
+        pxor %%xmm7, %%xmm7                                     \n\
+        0:                                                      \n\
+        movq (%[buf]), %%xmm0           # sign-extend 4 samples \n\
+        punpcklwd %%xmm0, %%xmm0                                \n\
+        psrad $16, %%xmm0                                       \n\
+        cvtdq2ps %%xmm0, %%xmm0                                 \n\
+        movd %k[index], %%xmm1          # scale + step*index    \n\
+        pshufd $0, %%xmm1, %%xmm1                               \n\
+        paddd (%[lanes]), %%xmm1                                \n\
+        cvtdq2ps %%xmm1, %%xmm1                                 \n\
+        mulps %%xmm6, %%xmm1                                    \n\
+        addps %%xmm5, %%xmm1                                    \n\
+        mulps %%xmm1, %%xmm0                                    \n\
+        cvtps2dq %%xmm0, %%xmm0                                 \n\
+        movdqa %%xmm0, %%xmm2           # count the clipped ones\n\
+        pcmpgtd %[max], %%xmm2                                  \n\
+        psubd %%xmm2, %%xmm7                                    \n\
+        movdqa %[min], %%xmm3                                   \n\
+        pcmpgtd %%xmm0, %%xmm3                                  \n\
+        psubd %%xmm3, %%xmm7                                    \n\
+        packssdw %%xmm0, %%xmm0                                 \n\
+        movq %%xmm0, (%[buf])                                   \n\
+        add $8, %[buf]                                          \n\
+        add %[advance], %[index]                                \n\
+        sub $4, %[count]                                        \n\
+        jnz 0b                                                  \n\
+        movdqa %%xmm7, %[clips]                                 \n"
+        : [buf] "+r" (buf), [count] "+r" (count), [index] "+r" (index),
+          [clips] "=m" (*(int32_t (*)[4])clips)
+        : [scale] "m" (scale), [step] "m" (step),
+          [lanes] "r" (chans == 2 ? ramp_index_stereo : ramp_index_mono),
+          [advance] "r" ((long)(4 / chans)),
+          [max] "m" (*ramp_s16_max), [min] "m" (*ramp_s16_min)
+        : "xmm0", "xmm1", "xmm2", "xmm3", "xmm5", "xmm6", "xmm7",
+          "memory", "cc"
+    );
+    return clips[0] + clips[1] + clips[2] + clips[3];
+}
+
+#endif  /* HAVE_ASM_SSE2 && ARCH_X86_64 */
+
 /*************************************************************************/
 /*************************************************************************/
 
@@ -47,6 +47,8 @@ TCAHandle tca_init(AudioFormat format);
 
 void tca_free(TCAHandle handle);
 
+void tca_set_accel(TCAHandle handle, int accel);
+
 int tca_convert_from(TCAHandle handle, void *buf, int len, AudioFormat srcfmt);
 
 int tca_convert_to(TCAHandle handle, void *buf, int len, AudioFormat destfmt);
@@ -54,6 +56,9 @@ int tca_convert_to(TCAHandle handle, void *buf, int len, AudioFormat destfmt);
 int tca_amplify(TCAHandle handle, void *buf, int len, double scale,
                 int *nclip_ret);
 
+int tca_amplify_ramp(TCAHandle handle, void *buf, int len, int chans,
+                     double scale_from, double scale_to, int *nclip_ret);
+
 int tca_mono_to_stereo(TCAHandle handle, void *buf, int len);
 
 int tca_stereo_to_mono(TCAHandle handle, void *buf, int len);
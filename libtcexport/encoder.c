@@ -31,7 +31,9 @@
 
 
 #include <stdint.h>
+#include <string.h>
 
+#include "aclib/ac.h"
 #include "tccore/tc_defaults.h"
 
 #include "encoder.h"
@@ -47,6 +49,9 @@ int tc_encoder_init(TCEncoder *enc,
     enc->aud_mod    = NULL;
     enc->vid_mod    = NULL;
     enc->processed  = 0;
+    enc->repeat     = TC_FALSE;
+    enc->last_buf   = NULL;
+    enc->last_size  = 0;
 
     return TC_OK;
 }
@@ -54,7 +59,9 @@ int tc_encoder_init(TCEncoder *enc,
 
 int tc_encoder_fini(TCEncoder *enc)
 {
-    /* do nothing (...yet) succesfully. */
+    tc_free(enc->last_buf);
+    enc->last_buf  = NULL;
+    enc->last_size = 0;
     return TC_OK;
 }
 
@@ -168,24 +175,65 @@ int tc_encoder_close(TCEncoder *enc)
 }
 
 
+/*
+ * A clone of the frame encoded just before is a repeat if nothing touched
+ * it since. Only the frames which are going to be cloned are kept for
+ * the comparison, so the other ones cost nothing.
+ */
+static int encoder_is_repeat(TCEncoder *enc, const TCFrameVideo *vin)
+{
+    int repeat = 0;
+
+    if ((vin->attributes & TC_FRAME_WAS_CLONED)
+     && enc->last_size > 0 && enc->last_size == vin->video_size) {
+        repeat = (memcmp(enc->last_buf, vin->video_buf,
+                         vin->video_size) == 0);
+    }
+
+    if (!(vin->attributes & TC_FRAME_IS_CLONED)) {
+        enc->last_size = 0;
+    } else if (!repeat) {
+        uint8_t *buf = tc_realloc(enc->last_buf, vin->video_size);
+        if (buf == NULL) {
+            enc->last_size = 0; /* just no repeats */
+        } else {
+            ac_memcpy(buf, vin->video_buf, vin->video_size);
+            enc->last_buf  = buf;
+            enc->last_size = vin->video_size;
+        }
+    }
+    return repeat;
+}
+
 int tc_encoder_process(TCEncoder *enc,
                        TCFrameVideo *vin, TCFrameVideo *vout,
                        TCFrameAudio *ain, TCFrameAudio *aout)
 {
+    const uint32_t keep = TC_FRAME_IS_CLONED | TC_FRAME_WAS_CLONED;
     int video_delayed = 0;
     int ret, result = TC_OK;
+    uint64_t start;
 
     CLEAN(enc);
-    /* remove spurious attributes */
-    vin->attributes = 0;
-    ain->attributes = 0;
+    /* remove spurious attributes; the clone marks are for the frame
+     * source, which reinjects the cloned frames once encoded */
+    vin->attributes &= keep;
+    ain->attributes &= keep;
+
+    if (enc->repeat && encoder_is_repeat(enc, vin)) {
+        vin->attributes |= TC_FRAME_IS_REPEAT;
+    }
 
     /* step 1: encode video */
+    start = tc_latency_now();
     ret = tc_module_encode_video(enc->vid_mod, vin, vout);
+    tc_latency_record(TC_LATENCY_VIDEO_ENCODE, start);
+    vin->attributes &= ~TC_FRAME_IS_REPEAT;
     if (ret == TC_OK) {
         SETOK(enc, TC_VIDEO);
     } else {
         tc_log_error(__FILE__, "error encoding video frame");
+        tc_restore_video_frame(vout); /* won't reach the muxer */
         result = TC_ERROR;
     }
     if (vin->attributes & TC_FRAME_IS_DELAYED) {
@@ -198,11 +246,14 @@ int tc_encoder_process(TCEncoder *enc,
         ain->attributes |= TC_FRAME_IS_CLONED;
         tc_log_info(__FILE__, "Delaying audio");
     } else {
+        start = tc_latency_now();
         ret = tc_module_encode_audio(enc->aud_mod, ain, aout);
+        tc_latency_record(TC_LATENCY_AUDIO_ENCODE, start);
         if (ret == TC_OK) {
             SETOK(enc, TC_AUDIO);
         } else {
             tc_log_error(__FILE__, "error encoding audio frame");
+            tc_restore_audio_frame(aout);
             result = TC_ERROR;
         }
     }
@@ -51,6 +51,10 @@ struct tcencoder_ {
 
     TCModule        vid_mod;
     TCModule        aud_mod;
+
+    int             repeat;     /* mark repeated frames? see below */
+    uint8_t         *last_buf;  /* last video frame going to be cloned */
+    int             last_size;  /* 0 if none */
 };
 
 /*************************************************************************/
@@ -74,6 +78,26 @@ int tc_encoder_open(TCEncoder *enc,
                     TCModuleExtraData *vid_xdata,
                     TCModuleExtraData *aud_xdata);
 
+/*
+ * tc_encoder_process:
+ *      Encode a video and an audio frame.
+ *
+ *      If enc->repeat is set (the video encoder and the multiplexor both
+ *      advertise TC_MODULE_FLAG_REPEAT), a cloned video frame with the
+ *      same content of the one encoded just before is passed to the video
+ *      encoder with TC_FRAME_IS_REPEAT set. The encoder can then return
+ *      an empty vout with TC_FRAME_IS_REPEAT set, to be stored by the
+ *      multiplexor as a repeat of the previous frame, or just encode it
+ *      as usual.
+ * Parameters:
+ *      enc: Pointer to an encoder instance.
+ *      vin: Pointer to the video frame to encode.
+ *      vout: Pointer to a video frame buffer to receive encoded data.
+ *      ain: Pointer to the audio frame to encode.
+ *      aout: Pointer to a audio frame buffer to receive encoded data.
+ * Return Value:
+ *      TC_OK on success, TC_ERROR on error.
+ */
 int tc_encoder_process(TCEncoder *enc,
                        TCFrameVideo *vin, TCFrameVideo *vout,
                        TCFrameAudio *ain, TCFrameAudio *aout);
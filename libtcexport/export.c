@@ -29,8 +29,10 @@
 
 #include "libtcutil/tcthread.h"
 
+#include "aclib/ac.h"
 #include "libtc/libtc.h"
 #include "libtc/tcframes.h"
+#include "libtcvideo/tcvideo.h"
 #include "tccore/tc_defaults.h"
 #include "export.h"
 #include "export_profile.h"
@@ -178,10 +180,77 @@ static void export_update_formats(TCJob *job,
 static int alloc_buffers(TCExportData *data);
 static void free_buffers(TCExportData *data);
 
+/* secondary outputs */
+static int outputs_dispatch(TCExportData *data);
+static int outputs_sync(TCExportData *data);
+
 
 /*************************************************************************/
 /* real encoder code                                                     */
 
+/*
+ * A secondary output encodes the same frames of the main one, through
+ * its own (optional) scaling step, encoder and multiplexor, each output
+ * in its own thread.
+ * Every output has a short queue of frames to encode. The picture of
+ * the frames acquired from the TCFrameSource is shared by reference
+ * (see TCFramePayload in tcframes.h): the queued frames hold a payload
+ * reference, so nothing is copied and the frame can go back to the
+ * source as soon as the main output is done with it. Audio frames are
+ * small, so each queue slot keeps its own copy.
+ * The main output only waits when the queue of an output is full,
+ * which keeps a slow output from falling behind without bounds.
+ */
+
+/* frames an output can lag behind the main one */
+#define OUTPUT_QUEUE_LEN    4
+
+typedef struct tcoutputslot_ TCOutputSlot;
+struct tcoutputslot_ {
+    TCFramePayload      *video; /* picture of the main output */
+    int                 id;
+    int                 attributes;
+    int                 v_codec;
+    int                 v_bpp;
+    int                 video_size;
+    TCFrameAudio        *audio; /* private copy */
+};
+
+typedef struct tcexportoutput_ TCExportOutput;
+struct tcexportoutput_ {
+    TCJob               job;    /* copy of the main job, with overrides */
+    char                **pieces; /* owns all the strings below */
+
+    const char          *file;
+    const char          *a_mod;
+    const char          *v_mod;
+    const char          *m_mod;
+    const char          *a_opts;
+    const char          *v_opts;
+    const char          *m_opts;
+    int                 width;  /* 0: same as the main output */
+    int                 height;
+
+    TCVHandle           tcvhandle;
+    TCFrameVideo        *input; /* shows the queued picture, or scales it */
+    TCFramePair         priv;
+    int                 video_max;
+    int                 audio_max;
+
+    TCEncoder           enc;
+    TCMultiplexor       mux;
+
+    TCModuleExtraData   vid_xdata;
+    TCModuleExtraData   aud_xdata;
+
+    TCOutputSlot        queue[OUTPUT_QUEUE_LEN];
+    int                 head;    /* frame being encoded, if any */
+    int                 count;   /* queued frames, including that one */
+
+    TCThread            thread;
+    int                 error;
+};
+
 
 struct tcexportdata_ {
     TCRunControl        *run_control;
@@ -218,6 +287,14 @@ struct tcexportdata_ {
     int                 has_aux;
     int                 progress_meter;
     int                 cluster_mode;
+
+    TCExportOutput      outputs[TC_EXPORT_OUTPUTS_MAX];
+    int                 output_num;
+    int                 outputs_running;
+    int                 outputs_quit;
+
+    TCMutex             output_lock;
+    TCCondition         output_cond;
 };
 
 /* for the remaining fields, we're fine with 0/NULL */
@@ -236,6 +313,9 @@ static TCExportData expdata = {
     .has_aux            = 0,
     .progress_meter     = 1,
     .cluster_mode       = 0,
+
+    .output_num         = 0,
+    .outputs_running    = 0,
 };
 
 
@@ -376,15 +456,21 @@ int tc_export_frames(int frame_id, TCFrameVideo *vframe, TCFrameAudio *aframe)
     tc_reset_video_frame(expdata.priv.video);
     tc_reset_audio_frame(expdata.priv.audio);
 
-    ret = tc_encoder_process(&expdata.enc,
-                             expdata.input.video, expdata.priv.video,
-                             expdata.input.audio, expdata.priv.audio);
+    ret = outputs_dispatch(&expdata);
+    if (ret == TC_OK) {
+        ret = tc_encoder_process(&expdata.enc,
+                                 expdata.input.video, expdata.priv.video,
+                                 expdata.input.audio, expdata.priv.audio);
+    }
     if (ret != TC_OK) {
         expdata.error_flag = 1;
     } else {
+        uint64_t start = tc_latency_now();
+
         ret = tc_multiplexor_export(&expdata.mux,
                                     expdata.priv.video,
                                     expdata.priv.audio);
+        tc_latency_record(TC_LATENCY_MUX, start);
 
         if (ret != TC_OK) {
             expdata.error_flag = 1;
@@ -427,6 +513,511 @@ int tc_export_frames(int frame_id, TCFrameVideo *vframe, TCFrameAudio *aframe)
 } while (0)
 
 
+/*************************************************************************/
+/* secondary outputs                                                     */
+
+/* in the form "file[,V=mod[=opts]][,A=mod[=opts]][,M=mod[=opts]][,Z=WxH]" */
+static int output_parse(TCExportOutput *out, const char *desc)
+{
+    size_t i = 0, num = 0;
+
+    out->pieces = tc_strsplit(desc, ',', &num);
+    if (out->pieces == NULL || num == 0 || *out->pieces[0] == '\0') {
+        tc_log_error(__FILE__, "missing file name for output '%s'", desc);
+        return TC_ERROR;
+    }
+    out->file = out->pieces[0];
+
+    for (i = 1; i < num; i++) {
+        char *arg = out->pieces[i], *opts = NULL;
+
+        if (arg[0] == '\0' || arg[1] != '=' || arg[2] == '\0') {
+            goto bad_arg;
+        }
+        opts = strchr(arg + 2, '=');
+        if (opts != NULL) {
+            *opts++ = '\0';
+        }
+        switch (arg[0]) {
+          case 'V':
+            out->v_mod  = arg + 2;
+            out->v_opts = opts;
+            break;
+          case 'A':
+            out->a_mod  = arg + 2;
+            out->a_opts = opts;
+            break;
+          case 'M':
+            out->m_mod  = arg + 2;
+            out->m_opts = opts;
+            break;
+          case 'Z':
+            if (opts != NULL
+             || sscanf(arg + 2, "%ix%i", &out->width, &out->height) != 2
+             || out->width <= 0 || out->height <= 0
+             || out->width > TC_MAX_V_FRAME_WIDTH
+             || out->height > TC_MAX_V_FRAME_HEIGHT) {
+                goto bad_arg;
+            }
+            break;
+          default:
+            goto bad_arg;
+        }
+    }
+    return TC_OK;
+
+bad_arg:
+    tc_log_error(__FILE__, "bad argument '%s' for output '%s'",
+                 out->pieces[i], out->file);
+    return TC_ERROR;
+}
+
+/* plane layout of the formats we know how to scale */
+static int output_layout(int format, int *nplanes, int *Bpp,
+                         int *wdiv, int *hdiv)
+{
+    *nplanes = 3;
+    *Bpp     = 1;
+    *wdiv    = 2;
+    *hdiv    = 2;
+
+    switch (format) {
+      case TC_CODEC_YUV420P:
+        return TC_OK;
+      case TC_CODEC_YUV422P:
+        *hdiv = 1;
+        return TC_OK;
+      case TC_CODEC_RGB24:
+        *nplanes = 1;
+        *Bpp     = 3;
+        *wdiv    = 1;
+        *hdiv    = 1;
+        return TC_OK;
+    }
+    return TC_ERROR;
+}
+
+/* repeated frames can be marked only if both ends know what to do */
+static void export_setup_repeat(TCEncoder *enc, TCMultiplexor *mux)
+{
+    const TCModuleInfo *vinfo = tc_module_get_info(enc->vid_mod);
+    const TCModuleInfo *minfo = tc_module_get_info(mux->mux_main);
+
+    enc->repeat = ((vinfo->flags & TC_MODULE_FLAG_REPEAT)
+                && (minfo->flags & TC_MODULE_FLAG_REPEAT));
+    tc_debug(TC_DEBUG_MODULES, "repeated frames %s",
+             (enc->repeat) ?"signaled" :"encoded");
+}
+
+static int output_setup(TCExportOutput *out, const char *a_mod,
+                        const char *v_mod, const char *m_mod)
+{
+    TCJob *job = &out->job;
+    int ret, match, nplanes, Bpp, wdiv, hdiv;
+
+    /* settle the job description of this output */
+    *job = *expdata.job;
+    job->video_out_file  = out->file;
+    job->audio_out_file  = NULL;
+    job->audio_file_flag = 0;
+    /* options of the main output make sense only for the same module */
+    if (out->v_mod != NULL) {
+        job->ex_v_string = (char *)out->v_opts;
+    }
+    if (out->a_mod != NULL) {
+        job->ex_a_string = (char *)out->a_opts;
+    }
+    if (out->m_mod != NULL) {
+        job->ex_m_string = (char *)out->m_opts;
+    }
+    if (out->width == job->ex_v_width && out->height == job->ex_v_height) {
+        out->width  = 0; /* nothing to scale */
+        out->height = 0;
+    }
+    if (out->width > 0) {
+        ret = output_layout(job->im_v_codec, &nplanes, &Bpp, &wdiv, &hdiv);
+        if (ret != TC_OK) {
+            tc_log_error(__FILE__, "output %s: can't scale %s frames"
+                                   " (only yuv420p, yuv422p and rgb24)",
+                         out->file, tc_codec_to_string(job->im_v_codec));
+            return TC_ERROR;
+        }
+        RETURN_IF_FALSE(out->width % wdiv == 0 && out->height % hdiv == 0,
+                        "output size not compatible with frame format");
+
+        job->ex_v_width  = out->width;
+        job->ex_v_height = out->height;
+        job->ex_v_size   = tc_video_frame_size(out->width, out->height,
+                                               job->im_v_codec);
+    }
+
+    ret = tc_encoder_setup(&out->enc, (out->v_mod) ?out->v_mod :v_mod,
+                                      (out->a_mod) ?out->a_mod :a_mod);
+    RETURN_IF_ERROR(ret, "output encoder setup failed");
+
+    ret = tc_multiplexor_setup(&out->mux, (out->m_mod) ?out->m_mod :m_mod,
+                               NULL);
+    RETURN_IF_ERROR(ret, "output multiplexor setup failed");
+
+    export_update_formats(job,
+                          tc_module_get_info(out->enc.vid_mod),
+                          tc_module_get_info(out->enc.aud_mod));
+
+    match = tc_module_match(job->ex_a_codec, TC_AUDIO,
+                            out->enc.aud_mod, out->mux.mux_main);
+    RETURN_IF_FALSE(match, "output audio encoder incompatible "
+                           "with multiplexor");
+
+    match = tc_module_match(job->ex_v_codec, TC_VIDEO,
+                            out->enc.vid_mod, out->mux.mux_main);
+    RETURN_IF_FALSE(match, "output video encoder incompatible "
+                           "with multiplexor");
+    export_setup_repeat(&out->enc, &out->mux);
+
+    tc_debug(TC_DEBUG_MODULES, "output %s: %ix%i", out->file,
+             job->ex_v_width, job->ex_v_height);
+    return TC_OK;
+}
+
+static int output_alloc_buffers(TCExportOutput *out)
+{
+    const TCFrameSpecs *specs = expdata.specs;
+    int width  = TC_MAX(specs->width,  out->job.ex_v_width);
+    int height = TC_MAX(specs->height, out->job.ex_v_height);
+    int i;
+
+    if (out->width > 0) {
+        out->tcvhandle = tcv_init();
+        if (out->tcvhandle == NULL) {
+            goto no_handle;
+        }
+    }
+    out->input = tc_new_video_frame(width, height, specs->format, TC_FALSE);
+    if (out->input == NULL) {
+        goto no_input_vframe;
+    }
+    out->video_max = out->input->video_size;
+    for (i = 0; i < OUTPUT_QUEUE_LEN; i++) {
+        out->queue[i].video = NULL;
+        out->queue[i].audio = tc_new_audio_frame(specs->samples,
+                                                 specs->channels,
+                                                 specs->bits);
+        if (out->queue[i].audio == NULL) {
+            goto no_input_aframe;
+        }
+    }
+    out->audio_max = out->queue[0].audio->audio_size;
+
+    out->priv.video = tc_new_video_frame(width, height,
+                                         specs->format, TC_FALSE);
+    if (out->priv.video == NULL) {
+        goto no_vframe;
+    }
+    out->priv.audio = tc_new_audio_frame(specs->samples, specs->channels,
+                                         specs->bits);
+    if (out->priv.audio == NULL) {
+        goto no_aframe;
+    }
+    return TC_OK;
+
+no_aframe:
+    tc_del_video_frame(out->priv.video);
+no_vframe:
+    i = OUTPUT_QUEUE_LEN;
+no_input_aframe:
+    while (i-- > 0) {
+        tc_del_audio_frame(out->queue[i].audio);
+    }
+    tc_del_video_frame(out->input);
+no_input_vframe:
+    if (out->tcvhandle != NULL) {
+        tcv_free(out->tcvhandle);
+        out->tcvhandle = NULL;
+    }
+no_handle:
+    return TC_ERROR;
+}
+
+static void output_free_buffers(TCExportOutput *out)
+{
+    int i;
+
+    for (i = 0; i < OUTPUT_QUEUE_LEN; i++) {
+        tc_release_payload(out->queue[i].video); /* if never encoded */
+        out->queue[i].video = NULL;
+        tc_del_audio_frame(out->queue[i].audio);
+    }
+    tc_reset_video_frame(out->input);
+    tc_del_video_frame(out->input);
+    tc_del_video_frame(out->priv.video);
+    tc_del_audio_frame(out->priv.audio);
+    if (out->tcvhandle != NULL) {
+        tcv_free(out->tcvhandle);
+        out->tcvhandle = NULL;
+    }
+}
+
+static int output_scale(TCExportOutput *out, uint8_t *src, uint8_t *dst)
+{
+    int i, ret, nplanes, Bpp, wdiv, hdiv;
+
+    /* unsupported formats are rejected by output_setup */
+    ret = output_layout(out->job.im_v_codec, &nplanes, &Bpp, &wdiv, &hdiv);
+    if (ret != TC_OK) {
+        return TC_ERROR;
+    }
+
+    for (i = 0; i < nplanes; i++) {
+        int w  = expdata.job->ex_v_width;
+        int h  = expdata.job->ex_v_height;
+        int nw = out->job.ex_v_width;
+        int nh = out->job.ex_v_height;
+
+        if (i > 0) {
+            w  /= wdiv;
+            h  /= hdiv;
+            nw /= wdiv;
+            nh /= hdiv;
+        }
+        if (!tcv_zoom(out->tcvhandle, src, dst, w, h, Bpp, nw, nh,
+                      out->job.zoom_filter)) {
+            return TC_ERROR;
+        }
+        src += w  * h  * Bpp;
+        dst += nw * nh * Bpp;
+    }
+    return TC_OK;
+}
+
+/* queue the current frames of the main output; output_lock must be held */
+static int output_queue(TCExportOutput *out,
+                        TCFrameVideo *vin, TCFrameAudio *ain)
+{
+    TCOutputSlot *slot = &out->queue[(out->head + out->count)
+                                     % OUTPUT_QUEUE_LEN];
+    TCFrameAudio *aout = slot->audio;
+
+    if (out->tcvhandle == NULL && vin->video_size > out->video_max) {
+        tc_log_error(__FILE__, "output %s: video frame too large"
+                               " (%i > %i bytes)",
+                     out->file, vin->video_size, out->video_max);
+        return TC_ERROR;
+    }
+    if (ain->audio_size > out->audio_max) {
+        tc_log_error(__FILE__, "output %s: audio frame too large"
+                               " (%i > %i bytes)",
+                     out->file, ain->audio_size, out->audio_max);
+        return TC_ERROR;
+    }
+
+    slot->video = tc_hold_video_frame(vin);
+    if (slot->video == NULL) {
+        tc_log_error(__FILE__, "output %s: can't share video frame",
+                     out->file);
+        return TC_ERROR;
+    }
+    slot->id         = vin->id;
+    slot->attributes = vin->attributes;
+    slot->v_codec    = vin->v_codec;
+    slot->v_bpp      = vin->v_bpp;
+    slot->video_size = vin->video_size;
+
+    aout->id         = ain->id;
+    aout->attributes = ain->attributes;
+    aout->a_codec    = ain->a_codec;
+    aout->a_rate     = ain->a_rate;
+    aout->a_bits     = ain->a_bits;
+    aout->a_chan     = ain->a_chan;
+    aout->audio_size = ain->audio_size;
+    aout->audio_len  = TC_MIN(ain->audio_len, ain->audio_size);
+    ac_memcpy(aout->audio_buf, ain->audio_buf, aout->audio_size);
+
+    out->count++;
+    return TC_OK;
+}
+
+/* make the input frame show the queued picture, scaling it if needed */
+static int output_import(TCExportOutput *out, TCOutputSlot *slot)
+{
+    TCFrameVideo *vout = out->input;
+    int ret = TC_OK;
+
+    tc_reset_video_frame(vout);
+    vout->id         = slot->id;
+    vout->attributes = slot->attributes;
+    vout->v_codec    = slot->v_codec;
+    vout->v_bpp      = slot->v_bpp;
+    vout->v_width    = out->job.ex_v_width;
+    vout->v_height   = out->job.ex_v_height;
+    if (out->tcvhandle != NULL) {
+        vout->video_size = out->job.ex_v_size;
+        ret = output_scale(out, slot->video->data, vout->video_buf);
+    } else {
+        vout->video_size = slot->video_size;
+        tc_share_video_frame(vout, slot->video);
+    }
+    vout->video_len  = vout->video_size;
+    return ret;
+}
+
+static int output_encode(TCExportOutput *out, TCFrameAudio *ain)
+{
+    int ret;
+
+    tc_reset_video_frame(out->priv.video);
+    tc_reset_audio_frame(out->priv.audio);
+
+    ret = tc_encoder_process(&out->enc,
+                             out->input, out->priv.video,
+                             ain, out->priv.audio);
+    if (ret == TC_OK) {
+        uint64_t start = tc_latency_now();
+
+        ret = tc_multiplexor_export(&out->mux,
+                                    out->priv.video, out->priv.audio);
+        tc_latency_record(TC_LATENCY_MUX, start);
+    }
+    return ret;
+}
+
+static int output_worker(TCThreadData *td, void *datum)
+{
+    TCExportOutput *out = datum;
+    TCOutputSlot *slot = NULL;
+    int ret;
+
+    tc_mutex_lock(&expdata.output_lock);
+    for (;;) {
+        while (out->count == 0 && !expdata.outputs_quit) {
+            tc_condition_wait(&expdata.output_cond, &expdata.output_lock);
+        }
+        if (out->count == 0) {
+            break;
+        }
+        slot = &out->queue[out->head];
+        tc_mutex_unlock(&expdata.output_lock);
+
+        ret = output_import(out, slot);
+        if (ret == TC_OK) {
+            ret = output_encode(out, slot->audio);
+        }
+        if (ret != TC_OK) {
+            tc_log_error(__FILE__, "output %s: failed to encode frame",
+                         out->file);
+        }
+        /* multiplexed: the picture is no longer needed */
+        tc_reset_video_frame(out->priv.video);
+        tc_reset_video_frame(out->input);
+        tc_release_payload(slot->video);
+        slot->video = NULL;
+
+        tc_mutex_lock(&expdata.output_lock);
+        out->error = out->error || (ret != TC_OK);
+        out->head  = (out->head + 1) % OUTPUT_QUEUE_LEN;
+        out->count--;
+        tc_condition_broadcast(&expdata.output_cond);
+    }
+    tc_mutex_unlock(&expdata.output_lock);
+    return TC_OK;
+}
+
+static int outputs_start(TCExportData *data)
+{
+    int i;
+
+    data->outputs_quit    = TC_FALSE;
+    data->outputs_running = 0;
+
+    for (i = 0; i < data->output_num; i++) {
+        TCExportOutput *out = &data->outputs[i];
+
+        out->head  = 0;
+        out->count = 0;
+        out->error = TC_FALSE;
+
+        tc_thread_init(&out->thread, "export output");
+        if (tc_thread_start(&out->thread, output_worker, out) != TC_OK) {
+            tc_log_error(__FILE__, "can't start thread for output %s",
+                         out->file);
+            return TC_ERROR;
+        }
+        data->outputs_running++;
+    }
+    return TC_OK;
+}
+
+static void outputs_join(TCExportData *data)
+{
+    int i;
+
+    tc_mutex_lock(&data->output_lock);
+    data->outputs_quit = TC_TRUE;
+    tc_condition_broadcast(&data->output_cond);
+    tc_mutex_unlock(&data->output_lock);
+
+    for (i = 0; i < data->outputs_running; i++) {
+        tc_thread_wait(&data->outputs[i].thread, NULL);
+    }
+    data->outputs_running = 0;
+}
+
+/*
+ * wait until every output has room for `room' more frames
+ * (OUTPUT_QUEUE_LEN: until all of them are idle);
+ * output_lock must be held.
+ */
+static int outputs_wait_room(TCExportData *data, int room)
+{
+    int i, ret = TC_OK;
+
+    for (i = 0; i < data->output_num; i++) {
+        while (data->outputs[i].count > OUTPUT_QUEUE_LEN - room) {
+            tc_condition_wait(&data->output_cond, &data->output_lock);
+        }
+        if (data->outputs[i].error) {
+            ret = TC_ERROR;
+        }
+    }
+    return ret;
+}
+
+/*
+ * queue the current input frames to all the secondary outputs;
+ * waits only for an output whose queue is full.
+ */
+static int outputs_dispatch(TCExportData *data)
+{
+    int i, ret = TC_OK;
+
+    if (data->output_num == 0) {
+        return TC_OK;
+    }
+
+    tc_mutex_lock(&data->output_lock);
+    ret = outputs_wait_room(data, 1);
+    for (i = 0; ret == TC_OK && i < data->output_num; i++) {
+        ret = output_queue(&data->outputs[i],
+                           data->input.video, data->input.audio);
+    }
+    tc_condition_broadcast(&data->output_cond);
+    tc_mutex_unlock(&data->output_lock);
+    return ret;
+}
+
+/* wait for all the secondary outputs to finish the frames in flight */
+static int outputs_sync(TCExportData *data)
+{
+    int ret = TC_OK;
+
+    if (data->output_num > 0) {
+        tc_mutex_lock(&data->output_lock);
+        ret = outputs_wait_room(data, OUTPUT_QUEUE_LEN);
+        tc_mutex_unlock(&data->output_lock);
+    }
+    return ret;
+}
+
+
 /*************************************************************************/
 
 /*
@@ -549,21 +1140,34 @@ void tc_export_loop(TCFrameSource *fs, int frame_first, int frame_last)
 /*
  * new encoder module design principles
  * 1) keep it simple, stupid
- * 2) to have more than one encoder doesn't make sense in transcode, so
- * 3) new encoder will be monothread, like the old one
+ * 2) the main encoder is monothread, like the old one
+ * 3) secondary outputs get their own encoder, each in its own thread
  */
 
 /* FIXME: uint32_t VS int */
 void tc_export_rotation_limit_frames(int frames)
 {
-    if (frames > 0)
+    int i;
+
+    if (frames > 0) {
         tc_multiplexor_limit_frames(&expdata.mux, frames);
+        for (i = 0; i < expdata.output_num; i++) {
+            tc_multiplexor_limit_frames(&expdata.outputs[i].mux, frames);
+        }
+    }
 }
 
 void tc_export_rotation_limit_megabytes(int megabytes)
 {
-    if (megabytes > 0)
+    int i;
+
+    if (megabytes > 0) {
         tc_multiplexor_limit_megabytes(&expdata.mux, megabytes);
+        for (i = 0; i < expdata.output_num; i++) {
+            tc_multiplexor_limit_megabytes(&expdata.outputs[i].mux,
+                                           megabytes);
+        }
+    }
 }
 
 int tc_export_config(int verbose, int progress_meter, int cluster_mode)
@@ -584,8 +1188,12 @@ int tc_export_new(TCJob *job, TCFactory factory,
     expdata.specs       = specs;
     expdata.run_control = run_control;
     expdata.job         = job;
+    expdata.factory     = factory;
+    expdata.output_num  = 0;
 
     init_counters();
+    tc_mutex_init(&expdata.output_lock);
+    tc_condition_init(&expdata.output_cond);
 
     ret = tc_encoder_init(&expdata.enc, job, factory);
     RETURN_IF_ERROR(ret, "failed to initialize encoder");
@@ -598,7 +1206,17 @@ int tc_export_new(TCJob *job, TCFactory factory,
 
 int tc_export_del(void)
 {
-    int ret;
+    int i, ret;
+
+    for (i = 0; i < expdata.output_num; i++) {
+        TCExportOutput *out = &expdata.outputs[i];
+
+        tc_encoder_fini(&out->enc);
+        tc_multiplexor_fini(&out->mux);
+        tc_strfreev(out->pieces);
+        out->pieces = NULL;
+    }
+    expdata.output_num = 0;
 
     ret = tc_encoder_fini(&expdata.enc);
     RETURN_IF_ERROR(ret, "failed to finalize encoder");
@@ -609,10 +1227,37 @@ int tc_export_del(void)
     return tc_export_profile_fini();
 }
 
+int tc_export_add_output(const char *desc)
+{
+    TCExportOutput *out = NULL;
+    int ret;
+
+    RETURN_IF_FALSE(expdata.output_num < TC_EXPORT_OUTPUTS_MAX,
+                    "too many outputs");
+
+    out = &expdata.outputs[expdata.output_num];
+    memset(out, 0, sizeof(TCExportOutput));
+
+    ret = output_parse(out, desc);
+    if (ret == TC_OK) {
+        ret = tc_encoder_init(&out->enc, &out->job, expdata.factory);
+    }
+    if (ret == TC_OK) {
+        ret = tc_multiplexor_init(&out->mux, &out->job, expdata.factory);
+    }
+    if (ret != TC_OK) {
+        tc_strfreev(out->pieces);
+        out->pieces = NULL;
+        return TC_ERROR;
+    }
+    expdata.output_num++;
+    return TC_OK;
+}
+
 int tc_export_setup(const char *a_mod, const char *v_mod,
                     const char *m_mod, const char *m_mod_aux)
 {
-    int ret, match = 0;
+    int i, ret, match = 0;
 
     expdata.has_aux = TC_FALSE;
 
@@ -635,12 +1280,24 @@ int tc_export_setup(const char *a_mod, const char *v_mod,
                             expdata.enc.vid_mod, expdata.mux.mux_main);
     RETURN_IF_FALSE(match, "video encoder incompatible "
                            "with multiplexor");
+    export_setup_repeat(&expdata.enc, &expdata.mux);
+
+    for (i = 0; i < expdata.output_num; i++) {
+        ret = output_setup(&expdata.outputs[i], a_mod, v_mod, m_mod);
+        RETURN_IF_ERROR(ret, "output setup failed");
+    }
 
     return TC_OK; 
 }
 
 void tc_export_shutdown(void)
 {
+    int i;
+
+    for (i = 0; i < expdata.output_num; i++) {
+        tc_encoder_shutdown(&expdata.outputs[i].enc);
+        tc_multiplexor_shutdown(&expdata.outputs[i].mux);
+    }
     tc_encoder_shutdown(&expdata.enc);
     tc_multiplexor_shutdown(&expdata.mux);
 }
@@ -648,7 +1305,7 @@ void tc_export_shutdown(void)
 
 int tc_export_init(void)
 {
-    int ret = alloc_buffers(&expdata);
+    int i, ret = alloc_buffers(&expdata);
     if (ret != TC_OK) {
         tc_log_error(__FILE__, "can't allocate encoder buffers");
         return TC_ERROR;
@@ -662,21 +1319,57 @@ int tc_export_init(void)
     tc_debug(TC_DEBUG_PRIVATE,
              "Audio extradata codec = 0x%X", expdata.aud_xdata.codec);
 
-     return ret;
+    for (i = 0; ret == TC_OK && i < expdata.output_num; i++) {
+        TCExportOutput *out = &expdata.outputs[i];
+
+        ret = output_alloc_buffers(out);
+        if (ret != TC_OK) {
+            tc_log_error(__FILE__, "can't allocate buffers for output %s",
+                         out->file);
+            break;
+        }
+        ret = tc_encoder_open(&out->enc, &out->vid_xdata, &out->aud_xdata);
+    }
+    if (ret == TC_OK) {
+        ret = outputs_start(&expdata);
+    }
+    return ret;
 }
 
 int tc_export_open(void)
 {
-    return tc_multiplexor_open(&expdata.mux,
-                               expdata.job->video_out_file,
-                               expdata.job->audio_out_file,
-                               &expdata.vid_xdata,
-                               (expdata.has_aux) ?NULL :&expdata.aud_xdata);
+    int i, ret;
+
+    ret = tc_multiplexor_open(&expdata.mux,
+                              expdata.job->video_out_file,
+                              expdata.job->audio_out_file,
+                              &expdata.vid_xdata,
+                              (expdata.has_aux) ?NULL :&expdata.aud_xdata);
+
+    for (i = 0; ret == TC_OK && i < expdata.output_num; i++) {
+        TCExportOutput *out = &expdata.outputs[i];
+
+        ret = tc_multiplexor_open(&out->mux, out->job.video_out_file, NULL,
+                                  &out->vid_xdata, &out->aud_xdata);
+    }
+    return ret;
 }
 
 int tc_export_stop(void)
 {
-    int ret = tc_encoder_close(&expdata.enc);
+    int i, ret;
+
+    outputs_join(&expdata);
+    for (i = 0; i < expdata.output_num; i++) {
+        TCExportOutput *out = &expdata.outputs[i];
+
+        ret = tc_encoder_close(&out->enc);
+        if (ret == TC_OK) {
+            output_free_buffers(out);
+        }
+    }
+
+    ret = tc_encoder_close(&expdata.enc);
     if (ret == TC_OK) {
         free_buffers(&expdata);
     }
@@ -685,20 +1378,29 @@ int tc_export_stop(void)
 
 int tc_export_close(void)
 {
-    return tc_multiplexor_close(&expdata.mux);
+    int i, ret;
+
+    ret = outputs_sync(&expdata);
+    for (i = 0; i < expdata.output_num; i++) {
+        if (tc_multiplexor_close(&expdata.outputs[i].mux) != TC_OK) {
+            ret = TC_ERROR;
+        }
+    }
+    if (tc_multiplexor_close(&expdata.mux) != TC_OK) {
+        ret = TC_ERROR;
+    }
+    return ret;
 }
 
-/* DO NOT rotate here, this data belongs to current chunk */
-int tc_export_flush(void)
+static int export_flush(TCEncoder *enc, TCMultiplexor *mux,
+                        TCFramePair *priv)
 {
     int ret;
 
-    while ((ret = tc_encoder_flush(&expdata.enc,
-                                   expdata.priv.video,
-                                   expdata.priv.audio)) > 0) {
-        if (tc_multiplexor_write(&expdata.mux,
-                                 (ret & TC_VIDEO) ? expdata.priv.video : NULL,
-                                 (ret & TC_AUDIO) ? expdata.priv.audio : NULL)
+    while ((ret = tc_encoder_flush(enc, priv->video, priv->audio)) > 0) {
+        if (tc_multiplexor_write(mux,
+                                 (ret & TC_VIDEO) ? priv->video : NULL,
+                                 (ret & TC_AUDIO) ? priv->audio : NULL)
             == TC_ERROR)
         {
             tc_log_error(__FILE__, "write error while flushing data");
@@ -709,6 +1411,23 @@ int tc_export_flush(void)
     return ret < 0 ? TC_ERROR : TC_OK;
 }
 
+/* DO NOT rotate here, this data belongs to current chunk */
+int tc_export_flush(void)
+{
+    int i, ret;
+
+    ret = outputs_sync(&expdata);
+    for (i = 0; ret == TC_OK && i < expdata.output_num; i++) {
+        TCExportOutput *out = &expdata.outputs[i];
+
+        ret = export_flush(&out->enc, &out->mux, &out->priv);
+    }
+    if (ret == TC_OK) {
+        ret = export_flush(&expdata.enc, &expdata.mux, &expdata.priv);
+    }
+    return ret;
+}
+
 /*************************************************************************/
 
 /*
@@ -95,6 +95,25 @@ int tc_export_new(TCJob *vob, TCFactory factory,
 
 int tc_export_del(void);
 
+/*
+ * tc_export_add_output:
+ *     add a secondary output, which encodes the same frames of the
+ *     main one (optionally scaled) with its own encoder and multiplexor,
+ *     in a separate thread. Secondary outputs always mux audio and video
+ *     in the same file. Must be called before tc_export_setup.
+ *
+ * Parameters:
+ *     desc: description of the output in the form
+ *           "file[,V=module[=options]][,A=...][,M=...][,Z=WIDTHxHEIGHT]".
+ *           Missing modules are the same as the main output (options
+ *           too, unless the module is given); missing size means same
+ *           size as the main output.
+ * Return Value:
+ *     TC_OK: succesfull.
+ *     TC_ERROR: bad description or too many outputs (reason was logged).
+ */
+int tc_export_add_output(const char *desc);
+
 int tc_export_setup(const char *a_mod, const char *v_mod,
                     const char *m_mod, const char *m_mod_aux);
 
@@ -623,17 +623,36 @@ int tc_multiplexor_close(TCMultiplexor *mux)
 /*************************************************************************/
 
 /* write and rotate if needed */
+/*
+ * payloads borrowed by passthrough encoders (TC_FRAME_IS_BORROWED) are
+ * given back as soon as they are written: the frames owning them are
+ * released by the export loop right after.
+ */
+static int muxer_write(TCMultiplexor *mux, int can_rotate,
+                       TCFrameVideo *vframe, TCFrameAudio *aframe)
+{
+    int ret = mux->write(mux, can_rotate, vframe, aframe);
+
+    if (vframe) {
+        tc_restore_video_frame(vframe);
+    }
+    if (aframe) {
+        tc_restore_audio_frame(aframe);
+    }
+    return ret;
+}
+
 int tc_multiplexor_export(TCMultiplexor *mux,
                           TCFrameVideo *vframe, TCFrameAudio *aframe)
 {
-    return mux->write(mux, TC_TRUE, vframe, aframe);
+    return muxer_write(mux, TC_TRUE, vframe, aframe);
 }
 
 /* just write */
 int tc_multiplexor_write(TCMultiplexor *mux,
                          TCFrameVideo *vframe, TCFrameAudio *aframe)
 {
-    return mux->write(mux, TC_FALSE, vframe, aframe);
+    return muxer_write(mux, TC_FALSE, vframe, aframe);
 }
 
 /*************************************************************************/
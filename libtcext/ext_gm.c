@@ -87,6 +87,7 @@ int tc_magick_init(TCMagickContext *ctx, int quality)
 
     GetExceptionInfo(&ctx->exception_info);
     ctx->image_info = CloneImageInfo(NULL);
+    ctx->image = NULL;
 
     if (quality != TC_MAGICK_QUALITY_DEFAULT) {
         ctx->image_info->quality = quality;
@@ -173,6 +174,22 @@ int tc_magick_frameout(TCMagickContext *ctx, const char *format,
     return ret;
 }
 
+int tc_magick_fileout(TCMagickContext *ctx, const char *format,
+                      const char *filename)
+{
+    int ret = TC_OK;
+
+    strlcpy(ctx->image_info->magick, format, MaxTextExtent);
+    tc_snprintf(ctx->image->filename, MaxTextExtent, "%s:%s",
+                format, filename);
+
+    if (WriteImage(ctx->image_info, ctx->image) != MagickPass) {
+        CatchException(&ctx->image->exception);
+        ret = TC_ERROR;
+    }
+    return ret;
+}
+
 
 int tc_magick_RGBout(TCMagickContext *ctx, 
                      int width, int height, uint8_t *data)
@@ -193,6 +210,323 @@ int tc_magick_RGBout(TCMagickContext *ctx,
     return ret;
 }
 
+/*************************************************************************/
+/* read-ahead reader                                                     */
+/*************************************************************************/
+
+enum {
+    TC_MAGICK_SLOT_FREE = 0,
+    TC_MAGICK_SLOT_QUEUED,
+    TC_MAGICK_SLOT_BUSY,
+    TC_MAGICK_SLOT_DONE,
+};
+
+typedef struct tcmagickslot_ TCMagickSlot;
+struct tcmagickslot_ {
+    char            *filename;
+    uint8_t         *data;
+    int             state;
+    int             status;
+};
+
+typedef struct tcmagickworker_ TCMagickWorker;
+struct tcmagickworker_ {
+    TCMagickReader  *reader;
+    TCMagickContext magick;
+    uint8_t         *rgb;       /* RGBout buffer, if converting */
+    TCThread        thread;
+    int             ready;      /* magick context initialized */
+    int             running;
+};
+
+struct tcmagickreader_ {
+    int             width;
+    int             height;
+    ImageFormat     format;
+    int             size;
+
+    TCMagickSlot    *slots;     /* ring, in queueing order */
+    int             depth;
+    int             head;       /* oldest pending slot */
+    int             next;       /* next slot to be decoded */
+    int             pending;
+
+    TCMagickWorker  *workers;
+    int             nworkers;
+    int             quit;
+
+    TCMutex         lock;
+    TCCondition     cond;
+};
+
+static int magick_reader_decode(TCMagickWorker *worker, TCMagickSlot *slot)
+{
+    TCMagickReader *reader = worker->reader;
+    uint8_t *src[3] = { NULL, NULL, NULL };
+    uint8_t *dst[3] = { NULL, NULL, NULL };
+    int ret;
+
+    ret = tc_magick_filein(&worker->magick, slot->filename);
+    if (ret != TC_OK) {
+        return ret;
+    }
+    if (reader->format == IMG_RGB24) {
+        return tc_magick_RGBout(&worker->magick,
+                                reader->width, reader->height, slot->data);
+    }
+
+    ret = tc_magick_RGBout(&worker->magick,
+                           reader->width, reader->height, worker->rgb);
+    if (ret != TC_OK) {
+        return ret;
+    }
+    src[0] = worker->rgb;
+    YUV_INIT_PLANES(dst, slot->data, reader->format,
+                    reader->width, reader->height);
+    if (!ac_imgconvert(src, IMG_RGB24, dst, reader->format,
+                       reader->width, reader->height)) {
+        return TC_ERROR;
+    }
+    return TC_OK;
+}
+
+static int magick_reader_worker(TCThreadData *td, void *datum)
+{
+    TCMagickWorker *worker = datum;
+    TCMagickReader *reader = worker->reader;
+
+    tc_mutex_lock(&reader->lock);
+    while (TC_TRUE) {
+        TCMagickSlot *slot = &reader->slots[reader->next];
+
+        while (!reader->quit && slot->state != TC_MAGICK_SLOT_QUEUED) {
+            tc_condition_wait(&reader->cond, &reader->lock);
+            slot = &reader->slots[reader->next];
+        }
+        if (reader->quit) {
+            break;
+        }
+        /* claim it; slots are decoded in the order they were queued */
+        slot->state  = TC_MAGICK_SLOT_BUSY;
+        reader->next = (reader->next + 1) % reader->depth;
+        tc_mutex_unlock(&reader->lock);
+
+        slot->status = magick_reader_decode(worker, slot);
+
+        tc_mutex_lock(&reader->lock);
+        slot->state = TC_MAGICK_SLOT_DONE;
+        tc_condition_broadcast(&reader->cond);
+    }
+    tc_mutex_unlock(&reader->lock);
+    return TC_OK;
+}
+
+TCMagickReader *tc_magick_reader_new(int width, int height,
+                                     ImageFormat format,
+                                     int workers, int depth)
+{
+    TCMagickReader *reader = NULL;
+    int i;
+
+    if (width <= 0 || height <= 0 || workers < 1 || depth < 1) {
+        tc_log_error("tc_magick", "reader: bad parameters");
+        return NULL;
+    }
+    switch (format) {
+      case IMG_RGB24:
+        break;
+      case IMG_YUV420P:
+        if (width % 2 != 0 || height % 2 != 0) {
+            tc_log_error("tc_magick", "reader: odd size for YUV420P");
+            return NULL;
+        }
+        break;
+      case IMG_YUV422P:
+        if (width % 2 != 0) {
+            tc_log_error("tc_magick", "reader: odd width for YUV422P");
+            return NULL;
+        }
+        break;
+      default:
+        tc_log_error("tc_magick", "reader: unsupported pixel format");
+        return NULL;
+    }
+
+    reader = tc_zalloc(sizeof(TCMagickReader));
+    if (reader == NULL) {
+        goto nomem;
+    }
+    reader->width  = width;
+    reader->height = height;
+    reader->format = format;
+    reader->size   = width * height * 3;
+    if (format == IMG_YUV420P) {
+        reader->size = width * height + 2 * UV_PLANE_SIZE(format,
+                                                          width, height);
+    } else if (format == IMG_YUV422P) {
+        reader->size = width * height * 2;
+    }
+    tc_mutex_init(&reader->lock);
+    tc_condition_init(&reader->cond);
+
+    reader->depth = depth;
+    reader->slots = tc_zalloc(depth * sizeof(TCMagickSlot));
+    if (reader->slots == NULL) {
+        goto nomem;
+    }
+    for (i = 0; i < depth; i++) {
+        /* RGBout writes RGB24 even when the output is smaller */
+        reader->slots[i].data = tc_bufalloc(width * height * 3);
+        if (reader->slots[i].data == NULL) {
+            goto nomem;
+        }
+    }
+
+    reader->workers = tc_zalloc(workers * sizeof(TCMagickWorker));
+    if (reader->workers == NULL) {
+        goto nomem;
+    }
+    reader->nworkers = workers;
+    /* contexts are set up here, tc_magick_init isn't safe to race */
+    for (i = 0; i < workers; i++) {
+        TCMagickWorker *worker = &reader->workers[i];
+
+        worker->reader = reader;
+        if (format != IMG_RGB24) {
+            worker->rgb = tc_bufalloc(width * height * 3);
+            if (worker->rgb == NULL) {
+                goto nomem;
+            }
+        }
+        if (tc_magick_init(&worker->magick,
+                           TC_MAGICK_QUALITY_DEFAULT) != TC_OK) {
+            tc_magick_reader_del(reader);
+            return NULL;
+        }
+        worker->ready = TC_TRUE;
+    }
+    for (i = 0; i < workers; i++) {
+        TCMagickWorker *worker = &reader->workers[i];
+
+        tc_thread_init(&worker->thread, "magick reader");
+        if (tc_thread_start(&worker->thread, magick_reader_worker,
+                            worker) != TC_OK) {
+            tc_log_error("tc_magick", "reader: can't start worker thread");
+            tc_magick_reader_del(reader);
+            return NULL;
+        }
+        worker->running = TC_TRUE;
+    }
+    return reader;
+
+  nomem:
+    tc_log_error("tc_magick", "reader: out of memory");
+    tc_magick_reader_del(reader);
+    return NULL;
+}
+
+void tc_magick_reader_del(TCMagickReader *reader)
+{
+    int i;
+
+    if (reader == NULL) {
+        return;
+    }
+
+    tc_mutex_lock(&reader->lock);
+    reader->quit = TC_TRUE;
+    tc_condition_broadcast(&reader->cond);
+    tc_mutex_unlock(&reader->lock);
+
+    if (reader->workers != NULL) {
+        for (i = 0; i < reader->nworkers; i++) {
+            TCMagickWorker *worker = &reader->workers[i];
+
+            if (worker->running) {
+                tc_thread_wait(&worker->thread, NULL);
+            }
+            if (worker->ready) {
+                tc_magick_fini(&worker->magick);
+            }
+            tc_buffree(worker->rgb);
+        }
+        tc_free(reader->workers);
+    }
+    if (reader->slots != NULL) {
+        for (i = 0; i < reader->depth; i++) {
+            tc_free(reader->slots[i].filename);
+            tc_buffree(reader->slots[i].data);
+        }
+        tc_free(reader->slots);
+    }
+    tc_free(reader);
+}
+
+int tc_magick_reader_push(TCMagickReader *reader, const char *filename)
+{
+    TCMagickSlot *slot = NULL;
+    int ret = TC_ERROR;
+
+    tc_mutex_lock(&reader->lock);
+    if (reader->pending < reader->depth) {
+        slot = &reader->slots[(reader->head + reader->pending)
+                              % reader->depth];
+        slot->filename = tc_strdup(filename);
+        if (slot->filename != NULL) {
+            slot->state = TC_MAGICK_SLOT_QUEUED;
+            reader->pending++;
+            tc_condition_broadcast(&reader->cond);
+            ret = TC_OK;
+        }
+    }
+    tc_mutex_unlock(&reader->lock);
+    return ret;
+}
+
+int tc_magick_reader_pending(TCMagickReader *reader)
+{
+    int pending;
+
+    tc_mutex_lock(&reader->lock);
+    pending = reader->pending;
+    tc_mutex_unlock(&reader->lock);
+    return pending;
+}
+
+int tc_magick_reader_pop(TCMagickReader *reader, uint8_t *data, int *size)
+{
+    TCMagickSlot *slot = NULL;
+    int ret = TC_ERROR;
+
+    tc_mutex_lock(&reader->lock);
+    if (reader->pending > 0) {
+        slot = &reader->slots[reader->head];
+        while (slot->state != TC_MAGICK_SLOT_DONE) {
+            tc_condition_wait(&reader->cond, &reader->lock);
+        }
+        /* workers never touch a DONE slot: copy without the lock */
+        tc_mutex_unlock(&reader->lock);
+
+        ret = slot->status;
+        if (ret == TC_OK) {
+            ac_memcpy(data, slot->data, reader->size);
+            if (size != NULL) {
+                *size = reader->size;
+            }
+        }
+
+        tc_mutex_lock(&reader->lock);
+        tc_free(slot->filename);
+        slot->filename = NULL;
+        slot->state    = TC_MAGICK_SLOT_FREE;
+        reader->head   = (reader->head + 1) % reader->depth;
+        reader->pending--;
+    }
+    tc_mutex_unlock(&reader->lock);
+    return ret;
+}
+
+
 #endif
 
 /*************************************************************************/
@@ -22,6 +22,7 @@
 #define TC_MAGICK_H
 
 #include "libtc/tcframes.h"
+#include "aclib/imgconvert.h"
 
 #include <sys/types.h>
 #include <string.h>
@@ -152,6 +153,107 @@ int tc_magick_RGBout(TCMagickContext *ctx,
 int tc_magick_frameout(TCMagickContext *ctx, const char *format,
                        TCFrameVideo *frame);
 
+/*
+ * tc_magick_fileout:
+ *    encode an image and write it into a file.
+ *
+ * Parameters:
+ *         ctx: pointer to a GraphicsMagick context to use.
+ *      format: a string representing any image format recognized by
+ *              GraphicsMagick (passed in verbatim).
+ *    filename: path of the file to (over)write.
+ * Return Value:
+ *        TC_OK: on success.
+ *     TC_ERROR: otherwise. The error reason will be tc_log()'d out.
+ * Preconditions:
+ *     `ctx' already succesfully initialized.
+ */
+int tc_magick_fileout(TCMagickContext *ctx, const char *format,
+                      const char *filename);
+
+/*************************************************************************/
+
+/*
+ * TCMagickReader:
+ *     read-ahead decoding of image sequences. Filenames are queued in
+ *     order with tc_magick_reader_push; a pool of worker threads, each
+ *     one with its own GraphicsMagick context, loads and converts them
+ *     concurrently, and tc_magick_reader_pop hands out the decoded
+ *     frames in the same order they were queued.
+ *     The reader is meant to be driven by a single thread.
+ */
+typedef struct tcmagickreader_ TCMagickReader;
+
+/*
+ * tc_magick_reader_new:
+ *     create a reader and start its worker threads.
+ *
+ * Parameters:
+ *       width: width of the frames to emit.
+ *      height: height of the frames to emit.
+ *      format: pixel format of the frames to emit (IMG_RGB24,
+ *              IMG_YUV420P or IMG_YUV422P).
+ *     workers: number of decoding threads (>= 1).
+ *       depth: maximum number of images queued or decoded ahead (>= 1).
+ * Return Value:
+ *     a new reader, or NULL on error. The error reason will be
+ *     tc_log()'d out.
+ */
+TCMagickReader *tc_magick_reader_new(int width, int height,
+                                     ImageFormat format,
+                                     int workers, int depth);
+
+/*
+ * tc_magick_reader_del:
+ *     stop the worker threads and release a reader, discarding any
+ *     pending image.
+ *
+ * Parameters:
+ *     reader: the reader to release.
+ * Return Value:
+ *     None.
+ */
+void tc_magick_reader_del(TCMagickReader *reader);
+
+/*
+ * tc_magick_reader_push:
+ *     queue an image for decoding. Never blocks.
+ *
+ * Parameters:
+ *       reader: reader to use.
+ *     filename: path of the image to load (copied).
+ * Return Value:
+ *        TC_OK: on success.
+ *     TC_ERROR: the queue is full (see tc_magick_reader_pending).
+ */
+int tc_magick_reader_push(TCMagickReader *reader, const char *filename);
+
+/*
+ * tc_magick_reader_pending:
+ *     get the number of images queued and not yet popped.
+ *
+ * Parameters:
+ *     reader: reader to use.
+ * Return Value:
+ *     number of pending images, from 0 to the reader depth.
+ */
+int tc_magick_reader_pending(TCMagickReader *reader);
+
+/*
+ * tc_magick_reader_pop:
+ *     get the oldest pending image, waiting for it to be decoded.
+ *
+ * Parameters:
+ *     reader: reader to use.
+ *       data: pointer to a memory area to be filled with the raw frame.
+ *       size: if not NULL, set to the size of the raw frame in bytes.
+ * Return Value:
+ *        TC_OK: on success.
+ *     TC_ERROR: nothing pending, or the image failed to decode. The
+ *               image is removed from the queue anyway.
+ */
+int tc_magick_reader_pop(TCMagickReader *reader, uint8_t *data, int *size);
+
 
 #endif /* TC_MAGICK_H */
 
@@ -55,6 +55,11 @@
 /* module require extra internal buffering */ 
 #define TC_MODULE_FLAG_CONVERSION       0x00000010
 /* module requires an unavoidable csp conversion) */
+#define TC_MODULE_FLAG_REENTRANT        0x00000020
+/* module instance can process many frames concurrently */
+#define TC_MODULE_FLAG_REPEAT           0x00000040
+/* module can encode or store a video frame as a repeat of the previous
+   one (TC_FRAME_IS_REPEAT); see libtcexport/encoder.h */
 
 /*
  * this structure will hold all the interesting informations
@@ -230,6 +230,9 @@ const TCModuleClass *tc_plugin_setup(void);
                 return TC_ERROR; \
             } \
             return name ## _fini(&mod); \
+        \
+        } else if (frame->tag & TC_FILTER_DRAIN) { \
+            return TC_OK; /* nothing held back */ \
         } \
         \
         return name ## _process(&mod, frame); \
@@ -254,6 +257,7 @@ const TCModuleClass *tc_plugin_setup(void);
         if (frame->tag & TC_FILTER_INIT) { \
             TCModuleExtraData *xdata[] = { NULL, NULL }; \
             tc_log_info(MOD_NAME, "instance #%i", frame->filter_id); \
+            mod->id = frame->filter_id; \
             if (name ## _init(mod, TC_MODULE_FEATURE_FILTER) < 0) { \
                 return TC_ERROR; \
             } \
@@ -267,6 +271,9 @@ const TCModuleClass *tc_plugin_setup(void);
                 return TC_ERROR; \
             } \
             return name ## _fini(mod); \
+        \
+        } else if (frame->tag & TC_FILTER_DRAIN) { \
+            return TC_OK; /* nothing held back */ \
         } \
         \
         return name ## _process(mod, frame); \
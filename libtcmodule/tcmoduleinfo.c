@@ -192,7 +192,7 @@ void tc_module_info_log(const TCModuleInfo *info, int verbose)
         if (info->flags == TC_MODULE_FLAG_NONE) {
             strlcpy(buffer, "none", sizeof(buffer));
         } else {
-            tc_snprintf(buffer, sizeof(buffer), "%s%s%s%s",
+            tc_snprintf(buffer, sizeof(buffer), "%s%s%s%s%s%s",
                         (info->flags & TC_MODULE_FLAG_RECONFIGURABLE)
                             ?"reconfigurable " :"",
                         (info->flags & TC_MODULE_FLAG_DELAY)
@@ -200,7 +200,11 @@ void tc_module_info_log(const TCModuleInfo *info, int verbose)
                         (info->flags & TC_MODULE_FLAG_BUFFERING)
                             ?"buffering " :"",
                         (info->flags & TC_MODULE_FLAG_CONVERSION)
-                            ?"conversion " :"");
+                            ?"conversion " :"",
+                        (info->flags & TC_MODULE_FLAG_REENTRANT)
+                            ?"reentrant " :"",
+                        (info->flags & TC_MODULE_FLAG_REPEAT)
+                            ?"repeat " :"");
         }
         tc_log_info(info->name, "flags      : %s", buffer);
     }
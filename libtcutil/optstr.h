@@ -125,6 +125,8 @@ __attribute__((format(scanf,3,4)))
  *                   "M":  Can do Multiple Instances
  *                   "E":  Is a PRE filter
  *                   "O":  Is a POST filter
+ *                   "S":  Handles shared video frames (calls
+ *                         tc_unshare_video_frame before writing)
  *                   Valid examples:
  *                   "VR"  : Video and RGB
  *                   "VRY" : Video and YUV and RGB
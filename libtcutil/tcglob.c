@@ -97,6 +97,27 @@ int tc_glob_has_more(TCGlob *tcg)
     return (tcg->current < tcg->glob.gl_pathc) + (tcg->pattern != NULL);
 }
 
+int tc_glob_pending(TCGlob *tcg, const char * const **pathv)
+{
+    int count = 0;
+
+    if (tcg != NULL) {
+        if (tcg->current == -1) {
+            count = 1;
+            if (pathv != NULL) {
+                *pathv = &(tcg->pattern);
+            }
+        } else if (tcg->current < tcg->glob.gl_pathc) {
+            count = tcg->glob.gl_pathc - tcg->current;
+            if (pathv != NULL) {
+                *pathv = (const char * const *)tcg->glob.gl_pathv
+                         + tcg->current;
+            }
+        }
+    }
+    return count;
+}
+
 
 int tc_glob_close(TCGlob *tcg)
 {
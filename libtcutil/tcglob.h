@@ -90,6 +90,23 @@ const char *tc_glob_next(TCGlob *tcg);
 int tc_glob_has_more(TCGlob *tcg);
 
 
+/*
+ * tc_glob_pending:
+ *    peek at the pathnames not yet returned by tc_glob_next, without
+ *    consuming them; useful to do some work in advance (e.g. probing)
+ *    over the whole collection.
+ *
+ * Parameters:
+ *      tcg: pointer to TCGlob structure to be checked.
+ *    pathv: if not NULL, will be set to the array of pending pathnames,
+ *           in the same order tc_glob_next will return them. The array
+ *           is valid until tc_glob_close.
+ * Return Value:
+ *    the number of pending pathnames (0 if expansion ended).
+ */
+int tc_glob_pending(TCGlob *tcg, const char * const **pathv);
+
+
 /*
  * tc_glob_close:
  *    finalize a TCGlob structure and release all resources acquired via
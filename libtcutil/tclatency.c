@@ -0,0 +1,346 @@
+/*
+ * tclatency.c -- per-stage latency histograms for the frame hot path.
+ *
+ * This file is part of transcode, a video stream processing tool.
+ * transcode is free software, distributable under the terms of the GNU
+ * General Public License (version 2 or later).  See the file COPYING
+ * for details.
+ */
+
+#include "common.h"
+#include "memutils.h"
+#include "strutils.h"
+#include "logging.h"
+#include "tclatency.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+#include <sys/time.h>
+#include <time.h>
+
+/*************************************************************************/
+
+/*
+ * Log-linear bucketing: values below 2^(SUB_BITS+1) have a bucket each,
+ * then every power of two is split in SUB_COUNT buckets of equal width.
+ * Values beyond 2^MAX_MAGNITUDE ns are clamped into the last bucket.
+ */
+#define SUB_BITS        4
+#define SUB_COUNT       (1 << SUB_BITS)
+#define MAX_MAGNITUDE   40
+#define BUCKETS         ((MAX_MAGNITUDE - SUB_BITS + 1) * SUB_COUNT)
+
+#define STAGE_NAME_LEN  48
+
+typedef struct tclatencystage_ TCLatencyStage;
+struct tclatencystage_ {
+    uint64_t    count;
+    uint64_t    sum;
+    uint64_t    min;
+    uint64_t    max;
+    uint32_t    buckets[BUCKETS];
+};
+
+/* histograms of a single thread; written only by their owner */
+typedef struct tclatencyshard_ TCLatencyShard;
+struct tclatencyshard_ {
+    TCLatencyShard  *next;
+    TCLatencyStage  stages[TC_LATENCY_MAX_STAGES];
+};
+
+static int enabled = TC_FALSE;
+
+static pthread_mutex_t latency_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_once_t latency_once = PTHREAD_ONCE_INIT;
+static pthread_key_t shard_key;
+static TCLatencyShard *shards = NULL;  /* all shards ever created */
+
+static char stage_names[TC_LATENCY_MAX_STAGES][STAGE_NAME_LEN] = {
+    "video.read",
+    "video.decode",
+    "video.process",
+    "video.encode",
+    "audio.read",
+    "audio.decode",
+    "audio.process",
+    "audio.encode",
+    "mux",
+};
+static int stage_count = TC_LATENCY_STAGE_USER;
+
+/*************************************************************************/
+
+static void latency_setup(void)
+{
+    /* shards outlive their threads: they are needed for the final dump */
+    pthread_key_create(&shard_key, NULL);
+}
+
+static TCLatencyShard *latency_get_shard(void)
+{
+    TCLatencyShard *shard = pthread_getspecific(shard_key);
+
+    if (shard == NULL) {
+        shard = tc_zalloc(sizeof(TCLatencyShard));
+        if (shard != NULL) {
+            pthread_setspecific(shard_key, shard);
+
+            pthread_mutex_lock(&latency_lock);
+            shard->next = shards;
+            shards = shard;
+            pthread_mutex_unlock(&latency_lock);
+        }
+    }
+    return shard;
+}
+
+static int latency_bucket(uint64_t value)
+{
+    int msb = 0, shift = 0;
+
+    if (value < 2 * SUB_COUNT) {
+        return (int)value;
+    }
+    if (value >= ((uint64_t)1 << MAX_MAGNITUDE)) {
+        return BUCKETS - 1;
+    }
+#if defined(__GNUC__)
+    msb = 63 - __builtin_clzll(value);
+#else
+    for (msb = SUB_BITS + 1; (value >> (msb + 1)) != 0; msb++)
+        ; /* nothing */
+#endif
+    shift = msb - SUB_BITS;
+    return (shift + 1) * SUB_COUNT + (int)(value >> shift) - SUB_COUNT;
+}
+
+/* midpoint of the values falling into a bucket */
+static uint64_t latency_bucket_value(int bucket)
+{
+    int shift = 0;
+
+    if (bucket < 2 * SUB_COUNT) {
+        return (uint64_t)bucket;
+    }
+    shift = bucket / SUB_COUNT - 1;
+    return (((uint64_t)(bucket % SUB_COUNT + SUB_COUNT)) << shift)
+           + (((uint64_t)1 << shift) >> 1);
+}
+
+/*************************************************************************/
+
+void tc_latency_enable(int enable)
+{
+    pthread_once(&latency_once, latency_setup);
+    enabled = enable;
+}
+
+int tc_latency_stage_add(const char *name)
+{
+    int i, stage = -1;
+
+    pthread_mutex_lock(&latency_lock);
+    for (i = 0; i < stage_count; i++) {
+        if (strcmp(stage_names[i], name) == 0) {
+            stage = i;
+            break;
+        }
+    }
+    if (stage < 0 && stage_count < TC_LATENCY_MAX_STAGES) {
+        strlcpy(stage_names[stage_count], name, STAGE_NAME_LEN);
+        stage = stage_count++;
+    }
+    pthread_mutex_unlock(&latency_lock);
+
+    if (stage < 0) {
+        tc_log_warn(__FILE__, "too many stages, not timing '%s'", name);
+    }
+    return stage;
+}
+
+uint64_t tc_latency_now(void)
+{
+    if (!enabled) {
+        return 0;
+    } else {
+#if defined(HAVE_CLOCK_GETTIME) && defined(CLOCK_MONOTONIC)
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+#else
+        struct timeval tv;
+        gettimeofday(&tv, NULL);
+        return ((uint64_t)tv.tv_sec * 1000000 + tv.tv_usec) * 1000;
+#endif
+    }
+}
+
+void tc_latency_record(int stage, uint64_t start)
+{
+    TCLatencyShard *shard = NULL;
+    TCLatencyStage *st = NULL;
+    uint64_t now, value;
+
+    if (start == 0 || stage < 0 || stage >= TC_LATENCY_MAX_STAGES) {
+        return;  /* disabled (or was, when the stage started) */
+    }
+    now = tc_latency_now();
+    shard = latency_get_shard();
+    if (now == 0 || shard == NULL) {
+        return;
+    }
+
+    value = (now > start) ?(now - start) :0;
+    st = &shard->stages[stage];
+    if (st->count == 0 || value < st->min) {
+        st->min = value;
+    }
+    if (value > st->max) {
+        st->max = value;
+    }
+    st->count++;
+    st->sum += value;
+    st->buckets[latency_bucket(value)]++;
+}
+
+/*************************************************************************/
+
+/* merge the histograms of a stage from all threads */
+static void latency_merge(int stage, TCLatencyStage *total,
+                          uint64_t *buckets)
+{
+    const TCLatencyShard *shard = NULL;
+    int i;
+
+    memset(total, 0, sizeof(*total));
+    memset(buckets, 0, BUCKETS * sizeof(uint64_t));
+
+    for (shard = shards; shard != NULL; shard = shard->next) {
+        const TCLatencyStage *st = &shard->stages[stage];
+
+        if (st->count == 0) {
+            continue;
+        }
+        if (total->count == 0 || st->min < total->min) {
+            total->min = st->min;
+        }
+        total->max    = TC_MAX(total->max, st->max);
+        total->count += st->count;
+        total->sum   += st->sum;
+        for (i = 0; i < BUCKETS; i++) {
+            buckets[i] += st->buckets[i];
+        }
+    }
+}
+
+static double latency_percentile(const TCLatencyStage *total,
+                                 const uint64_t *buckets, double pct)
+{
+    uint64_t target = (uint64_t)(total->count * pct / 100.0 + 0.5);
+    uint64_t seen = 0, value = total->max;
+    int i;
+
+    target = TC_CLAMP(target, 1, total->count);
+    for (i = 0; i < BUCKETS; i++) {
+        seen += buckets[i];
+        if (seen >= target) {
+            value = latency_bucket_value(i);
+            break;
+        }
+    }
+    value = TC_CLAMP(value, total->min, total->max);
+    return value / 1000.0;
+}
+
+#define STAGE_JSON_LEN  384
+
+char *tc_latency_json(void)
+{
+    uint64_t *buckets = tc_malloc(BUCKETS * sizeof(uint64_t));
+    size_t size = (TC_LATENCY_MAX_STAGES + 1) * STAGE_JSON_LEN;
+    char *buf = tc_malloc(size);
+    const char *sep = "";
+    size_t len = 0;
+    int stage;
+
+    if (buckets == NULL || buf == NULL) {
+        tc_free(buckets);
+        tc_free(buf);
+        return NULL;
+    }
+
+    len += tc_snprintf(buf + len, size - len,
+                       "{\n  \"unit\": \"us\",\n  \"stages\": [");
+
+    pthread_mutex_lock(&latency_lock);
+    for (stage = 0; stage < stage_count; stage++) {
+        TCLatencyStage total;
+
+        latency_merge(stage, &total, buckets);
+        if (total.count == 0) {
+            continue;
+        }
+        len += tc_snprintf(buf + len, size - len,
+                           "%s\n    { \"name\": \"%s\", \"count\": %llu,"
+                           " \"min\": %.3f, \"mean\": %.3f,"
+                           " \"p50\": %.3f, \"p90\": %.3f,"
+                           " \"p99\": %.3f, \"p999\": %.3f,"
+                           " \"max\": %.3f }",
+                           sep, stage_names[stage],
+                           (unsigned long long)total.count,
+                           total.min / 1000.0,
+                           (double)total.sum / total.count / 1000.0,
+                           latency_percentile(&total, buckets, 50.0),
+                           latency_percentile(&total, buckets, 90.0),
+                           latency_percentile(&total, buckets, 99.0),
+                           latency_percentile(&total, buckets, 99.9),
+                           total.max / 1000.0);
+        sep = ",";
+    }
+    pthread_mutex_unlock(&latency_lock);
+
+    tc_snprintf(buf + len, size - len, "\n  ]\n}\n");
+    tc_free(buckets);
+    return buf;
+}
+
+int tc_latency_write(const char *path)
+{
+    char *json = tc_latency_json();
+    FILE *f = NULL;
+    int ret = TC_ERROR;
+
+    if (json == NULL) {
+        tc_log_error(__FILE__, "can't dump latency statistics");
+        return TC_ERROR;
+    }
+    f = fopen(path, "w");
+    if (f == NULL) {
+        tc_log_perror(__FILE__, path);
+    } else {
+        int err = (fputs(json, f) < 0);
+
+        if (fclose(f) != 0 || err) {
+            tc_log_error(__FILE__, "error writing latency statistics to %s",
+                         path);
+        } else {
+            ret = TC_OK;
+        }
+    }
+    tc_free(json);
+    return ret;
+}
+
+/*************************************************************************/
+
+/*
+ * Local variables:
+ *   c-file-style: "stroustrup"
+ *   c-file-offsets: ((case-label . *) (statement-case-intro . *))
+ *   indent-tabs-mode: nil
+ * End:
+ *
+ * vim: expandtab shiftwidth=4:
+ */
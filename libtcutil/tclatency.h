@@ -0,0 +1,140 @@
+/*
+ * tclatency.h -- per-stage latency histograms for the frame hot path.
+ *
+ * This file is part of transcode, a video stream processing tool.
+ * transcode is free software, distributable under the terms of the GNU
+ * General Public License (version 2 or later).  See the file COPYING
+ * for details.
+ */
+
+#ifndef TCLATENCY_H
+#define TCLATENCY_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ * Quick Summary:
+ *   each processing stage a frame goes through (import, filters,
+ *   internal processing, encoding, multiplexing) records the time it
+ *   took into a log-linear histogram (HDR-style: 16 sub-buckets for
+ *   each power of two, so values are kept with ~6% precision from 1ns
+ *   up to ~18 minutes).
+ *   Every thread records into its own set of histograms, so the hot
+ *   path takes no locks and shares no cache lines; sets are merged only
+ *   when statistics are dumped. A dump taken while frames are flowing
+ *   can be slightly inconsistent, but never wrong by more than the
+ *   frames in flight.
+ *
+ *   Recording is disabled by default; tc_latency_now() and
+ *   tc_latency_record() are then almost free.
+ *
+ *   Usage:
+ *       uint64_t t0 = tc_latency_now();
+ *       do_the_work();
+ *       tc_latency_record(TC_LATENCY_VIDEO_DECODE, t0);
+ */
+
+/* stages known in advance; others (filters) are added at runtime */
+enum {
+    TC_LATENCY_VIDEO_READ = 0,  /* reading frames from import pipe */
+    TC_LATENCY_VIDEO_DECODE,    /* decoding frames in import module */
+    TC_LATENCY_VIDEO_PROCESS,   /* process_vid_frame */
+    TC_LATENCY_VIDEO_ENCODE,
+    TC_LATENCY_AUDIO_READ,
+    TC_LATENCY_AUDIO_DECODE,
+    TC_LATENCY_AUDIO_PROCESS,
+    TC_LATENCY_AUDIO_ENCODE,
+    TC_LATENCY_MUX,
+    TC_LATENCY_STAGE_USER,      /* first stage for tc_latency_stage_add */
+};
+
+#define TC_LATENCY_MAX_STAGES   64
+
+/*
+ * tc_latency_enable:
+ *    turn on or off the recording of latencies. Should be called before
+ *    the processing threads start.
+ *
+ * Parameters:
+ *    enable: !0 to turn on recording, 0 to turn it off.
+ * Return Value:
+ *    None.
+ */
+void tc_latency_enable(int enable);
+
+/*
+ * tc_latency_stage_add:
+ *    register a new stage, or get the one already registered with the
+ *    same name.
+ *
+ * Parameters:
+ *    name: name of the stage, as it will appear in the dumps.
+ * Return Value:
+ *    >= 0: identifier of the stage, to use with tc_latency_record.
+ *      -1: too many stages.
+ */
+int tc_latency_stage_add(const char *name);
+
+/*
+ * tc_latency_now:
+ *    get the timestamp marking the start of a stage.
+ *
+ * Parameters:
+ *    None.
+ * Return Value:
+ *    monotonic time in nanoseconds, 0 if recording is disabled.
+ */
+uint64_t tc_latency_now(void);
+
+/*
+ * tc_latency_record:
+ *    account the time elapsed since `start' to the given stage, in the
+ *    histograms of the calling thread.
+ *
+ * Parameters:
+ *    stage: identifier of the stage.
+ *    start: timestamp got by tc_latency_now at the start of the stage.
+ * Return Value:
+ *    None.
+ */
+void tc_latency_record(int stage, uint64_t start);
+
+/*
+ * tc_latency_json:
+ *    dump the statistics of all the stages which recorded something,
+ *    as a JSON document: count, min, mean, max and some percentiles
+ *    (50, 90, 99, 99.9) for each stage, in microseconds.
+ *
+ * Parameters:
+ *    None.
+ * Return Value:
+ *    a string to be released with tc_free, NULL on error.
+ */
+char *tc_latency_json(void);
+
+/*
+ * tc_latency_write:
+ *    write the tc_latency_json document in a file.
+ *
+ * Parameters:
+ *    path: name of the file to (over)write.
+ * Return Value:
+ *    TC_OK: succesfull.
+ *    TC_ERROR: otherwise (reason was logged).
+ */
+int tc_latency_write(const char *path);
+
+#endif /* TCLATENCY_H */
+
+/*************************************************************************/
+
+/*
+ * Local variables:
+ *   c-file-style: "stroustrup"
+ *   c-file-offsets: ((case-label . *) (statement-case-intro . *))
+ *   indent-tabs-mode: nil
+ * End:
+ *
+ * vim: expandtab shiftwidth=4:
+ */
@@ -67,7 +67,12 @@ int tc_thread_start(TCThread *th, TCThreadBodyFn body, void *arg)
         tc_mutex_init(&(th->lock));
 
         err = pthread_create(&(th->tid), NULL, tc_thread_wrapper, th);
-        ret = TC_OK;
+        if (err) {
+            tc_log_error(__FILE__, "(%s) can't start thread: %s",
+                         th->data.name, strerror(err));
+        } else {
+            ret = TC_OK;
+        }
     }
     return ret;
 }
@@ -96,6 +101,151 @@ int tc_thread_wait(TCThread *th, int *th_ret)
 
 /*************************************************************************/
 
+/*
+ * Row bands run on a pool of worker threads started on first use and
+ * kept for the whole process, so a filter splitting every frame doesn't
+ * pay for creating and joining threads each time.  A call queues a job
+ * and then takes bands from it too, so bands the workers don't get to
+ * (or all of them, if no worker could be started) run in the caller.
+ * Several callers may use the pool at once.
+ */
+
+typedef struct tcbandjob_ TCBandJob;
+struct tcbandjob_ {
+    TCThreadBandFn  body;
+    void            *datum;
+    int             rows;
+    int             nbands;
+    int             next;       /* next band to hand out */
+    int             pending;    /* bands not finished yet */
+    TCBandJob       *queued;    /* next job in the queue */
+};
+
+static struct {
+    TCMutex     lock;
+    TCCondition work;           /* a job was queued */
+    TCCondition done;           /* a job finished */
+    TCBandJob   *head;          /* jobs with bands left to hand out */
+    TCBandJob   *tail;
+    int         nworkers;
+    TCThread    workers[TC_THREAD_MAX_BANDS - 1];
+} band_pool = {
+    .lock = { PTHREAD_MUTEX_INITIALIZER },
+    .work = { PTHREAD_COND_INITIALIZER },
+    .done = { PTHREAD_COND_INITIALIZER },
+};
+
+/* Takes the next band of `job', dropping the job from the queue when it
+ * has none left; returns the band, or -1. Called with the lock held. */
+static int band_take(TCBandJob *job)
+{
+    TCBandJob **link = &band_pool.head, *prev = NULL;
+    int band = -1;
+
+    if (job->next < job->nbands) {
+        band = job->next++;
+        if (job->next == job->nbands) {
+            /* the caller may finish its job ahead of older ones */
+            while (*link != job) {
+                prev = *link;
+                link = &prev->queued;
+            }
+            *link = job->queued;
+            if (band_pool.tail == job) {
+                band_pool.tail = prev;
+            }
+        }
+    }
+    return band;
+}
+
+/* Runs band `band' of `job' and accounts for it. Called with the lock
+ * held, which is released while the band runs. */
+static void band_run(TCBandJob *job, int band)
+{
+    tc_mutex_unlock(&band_pool.lock);
+    job->body(job->datum, band,
+              job->rows *  band      / job->nbands,
+              job->rows * (band + 1) / job->nbands);
+    tc_mutex_lock(&band_pool.lock);
+    if (--job->pending == 0) {
+        tc_condition_broadcast(&band_pool.done);
+    }
+}
+
+/* The workers live as long as the process. */
+static int band_worker(TCThreadData *td, void *arg)
+{
+    tc_mutex_lock(&band_pool.lock);
+    for (;;) {
+        TCBandJob *job = band_pool.head;
+        if (!job) {
+            tc_condition_wait(&band_pool.work, &band_pool.lock);
+        } else {
+            band_run(job, band_take(job));
+        }
+    }
+    return 0;
+}
+
+/* Makes sure `count' workers are running, as far as possible. Called
+ * with the lock held. */
+static void band_pool_grow(int count)
+{
+    while (band_pool.nworkers < count) {
+        TCThread *th = &band_pool.workers[band_pool.nworkers];
+
+        tc_thread_init(th, "band");
+        if (tc_thread_start(th, band_worker, NULL) != TC_OK) {
+            break;  /* the callers do the bands themselves */
+        }
+        pthread_detach(th->tid);
+        band_pool.nworkers++;
+    }
+}
+
+int tc_thread_bands(int nthreads, int rows, TCThreadBandFn body, void *datum)
+{
+    TCBandJob job;
+    int band, n = TC_CLAMP(nthreads, 1, TC_THREAD_MAX_BANDS);
+
+    n = TC_MAX(TC_MIN(n, rows), 1);
+    if (n == 1) {
+        body(datum, 0, 0, rows);
+        return n;
+    }
+
+    job.body    = body;
+    job.datum   = datum;
+    job.rows    = rows;
+    job.nbands  = n;
+    job.next    = 0;
+    job.pending = n;
+    job.queued  = NULL;
+
+    tc_mutex_lock(&band_pool.lock);
+    band_pool_grow(n - 1);
+    if (band_pool.tail) {
+        band_pool.tail->queued = &job;
+    } else {
+        band_pool.head = &job;
+    }
+    band_pool.tail = &job;
+    tc_condition_broadcast(&band_pool.work);
+
+    /* our own job is only dequeued once all of its bands are taken */
+    while ((band = band_take(&job)) >= 0) {
+        band_run(&job, band);
+    }
+    while (job.pending > 0) {
+        tc_condition_wait(&band_pool.done, &band_pool.lock);
+    }
+    tc_mutex_unlock(&band_pool.lock);
+    return n;
+}
+
+/*************************************************************************/
+
 int tc_mutex_init(TCMutex *m)
 {
     return pthread_mutex_init(&(m->m), NULL);
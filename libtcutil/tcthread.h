@@ -35,7 +35,8 @@
  */
 
 enum {
-    TC_THREAD_NAME_LEN = 16
+    TC_THREAD_NAME_LEN = 16,
+    TC_THREAD_MAX_BANDS = 16
 };
 
 
@@ -46,6 +47,8 @@ struct tcthreaddata_ {
 
 typedef int (*TCThreadBodyFn)(TCThreadData *td, void *datum);
 
+typedef void (*TCThreadBandFn)(void *datum, int band, int first, int last);
+
 typedef struct tcmutex_ TCMutex;
 struct tcmutex_ {
     pthread_mutex_t m;
@@ -78,6 +81,27 @@ int tc_thread_init(TCThread *th, const char *name);
 int tc_thread_start(TCThread *th, TCThreadBodyFn body, void *arg);
 int tc_thread_wait(TCThread *th, int *th_ret);
 
+/*
+ * tc_thread_bands:
+ *     split `rows' rows in (at most) `nthreads' bands of consecutive
+ *     rows and run `body' on each of them, all in parallel, on a pool
+ *     of worker threads kept from one call to the next; the calling
+ *     thread runs bands too, so all of them get done even if no worker
+ *     could be started. Returns when all are done.
+ *     Safe to call from several threads at once.
+ *
+ * Parameters:
+ *        nthreads: bands to run, clamped to 1..TC_THREAD_MAX_BANDS
+ *                  and to `rows'.
+ *            rows: rows to split.
+ *            body: called as body(datum, band, first, last) for rows
+ *                  first..last-1; band is 0..nthreads-1.
+ *           datum: opaque pointer passed to body.
+ * Return Value:
+ *     the number of bands run.
+ */
+int tc_thread_bands(int nthreads, int rows, TCThreadBandFn body, void *datum);
+
 int tc_mutex_init(TCMutex *m);
 int tc_mutex_lock(TCMutex *m);
 int tc_mutex_unlock(TCMutex *m);
@@ -30,6 +30,7 @@
 #include "optstr.h"
 #include "strutils.h"
 #include "tcglob.h"
+#include "tclatency.h"
 #include "tclist.h"
 #include "tctimer.h"
 #include "tcthread.h"
@@ -85,6 +85,7 @@ static void init_one_resize_table(struct resize_table_elem *table,
                                   int oldsize, int newsize);
 static void init_gamma_table(TCVHandle handle, double gamma);
 static void init_aa_table(TCVHandle handle, double aa_weight, double aa_bias);
+static void clip_fill(uint8_t *dest, int Bpp, int value, int count);
 
 /*************************************************************************/
 /*************************************************************************/
@@ -157,7 +158,8 @@ void tcv_free(TCVHandle handle)
  *     clip_left == 642
  *     clip_right == -4
  * then the result is a two-pixel-wide black frame (this is not considered
- * an error).
+ * an error).  A `Bpp' of 2 means one 16-bit sample per pixel, as in the
+ * planes of the high bit depth YUV formats.
  *
  * Parameters:      handle: tcvideo handle.
  *                     src: Source data plane.
@@ -169,7 +171,8 @@ void tcv_free(TCVHandle handle)
  *              clip_right: Number of pixels to clip from right edge.
  *                clip_top: Number of pixels to clip from top edge.
  *             clip_bottom: Number of pixels to clip from bottom edge.
- *             black_pixel: Value to be filled into expanded areas.
+ *             black_pixel: Value to be filled into expanded areas (a byte
+ *                          value, or a sample value if Bpp == 2).
  * Return value: Nonzero on success, zero on error (invalid parameters).
  * Preconditions: handle != 0: handle was returned by tcv_init()
  *                src != NULL: src[0]..src[width*height*Bpp-1] are readable
@@ -184,12 +187,13 @@ void tcv_free(TCVHandle handle)
 int tcv_clip(TCVHandle handle,
              uint8_t *src, uint8_t *dest, int width, int height, int Bpp,
              int clip_left, int clip_right, int clip_top, int clip_bottom,
-             uint8_t black_pixel)
+             int black_pixel)
 {
     int new_w, copy_w, copy_h, y;
 
 
-    if (!src || !dest || width <= 0 || height <= 0 || (Bpp != 1 && Bpp != 3)) {
+    if (!src || !dest || width <= 0 || height <= 0
+     || (Bpp != 1 && Bpp != 2 && Bpp != 3)) {
         tc_log_error("libtcvideo", "tcv_clip: invalid frame parameters!");
         return 0;
     }
@@ -225,7 +229,7 @@ int tcv_clip(TCVHandle handle,
                     - (clip_bottom<0 ? 0 : clip_bottom);
 
     if (clip_top < 0) {
-        memset(dest, black_pixel, (-clip_top) * new_w * Bpp);
+        clip_fill(dest, Bpp, black_pixel, (-clip_top) * new_w);
         dest += (-clip_top) * new_w * Bpp;
     } else {
         src += clip_top * width * Bpp;
@@ -234,7 +238,7 @@ int tcv_clip(TCVHandle handle,
         src += clip_left * Bpp;
     for (y = 0; y < copy_h; y++) {
         if (clip_left < 0) {
-            memset(dest, black_pixel, (-clip_left) * Bpp);
+            clip_fill(dest, Bpp, black_pixel, -clip_left);
             dest += (-clip_left) * Bpp;
         }
         if (copy_w > 0)
@@ -242,12 +246,12 @@ int tcv_clip(TCVHandle handle,
         dest += copy_w * Bpp;
         src += width * Bpp;
         if (clip_right < 0) {
-            memset(dest, black_pixel, (-clip_right) * Bpp);
+            clip_fill(dest, Bpp, black_pixel, -clip_right);
             dest += (-clip_right) * Bpp;
         }
     }
     if (clip_bottom < 0) {
-        memset(dest, black_pixel, (-clip_bottom) * new_w * Bpp);
+        clip_fill(dest, Bpp, black_pixel, (-clip_bottom) * new_w);
     }
     return 1;
 }
@@ -534,6 +538,8 @@ static inline void rescale_pixel(const uint8_t *src1, const uint8_t *src2,
 
 /**
  * tcv_zoom:  Resize the given image to an arbitrary size, with filtering.
+ * A `Bpp' of 2 means one 16-bit sample per pixel, as in the planes of the
+ * high bit depth YUV formats.
  *
  * Parameters: handle: tcvideo handle.
  *                src: Source data plane.
@@ -564,7 +570,8 @@ int tcv_zoom(TCVHandle handle,
     int interlace_mode = 0;
     int i;
 
-    if (!src || !dest || width <= 0 || height <= 0 || (Bpp != 1 && Bpp != 3)) {
+    if (!src || !dest || width <= 0 || height <= 0
+     || (Bpp != 1 && Bpp != 2 && Bpp != 3)) {
         tc_log_error("libtcvideo", "tcv_zoom: invalid frame parameters!");
         return 0;
     }
@@ -980,6 +987,368 @@ static void antialias_line(TCVHandle handle,
 
 /*************************************************************************/
 
+/**
+ * tcv_match:  Find where the given pattern appears in the image, trying
+ * every position within `radius' pixels (in both directions) of the
+ * expected one, or the whole image if `radius' is negative.  The
+ * expected position is tried first, and wins ties with the others; a
+ * tracking caller should pass the last match there, which also makes the
+ * sum of absolute differences stop early on most other positions.
+ *
+ * Parameters:  handle: tcvideo handle.
+ *                 src: Image to search.
+ *               width: Width of image.
+ *              height: Height of image.
+ *                 Bpp: Bytes (not bits!) per pixel.
+ *             pattern: Pattern to look for (same pixel format).
+ *                mask: Bytes of the pattern to compare (0xFF) or to
+ *                      ignore (0x00), or NULL to compare all of them.
+ *              pwidth: Width of pattern.
+ *             pheight: Height of pattern.
+ *              method: TCV_MATCH_SAD for the least mean absolute
+ *                      difference, TCV_MATCH_NCC for the highest
+ *                      normalized cross-correlation.
+ *                   x: Expected horizontal position of the pattern.
+ *                   y: Expected vertical position of the pattern.
+ *              radius: Search radius around the expected position.
+ *               x_ret: Where to store the horizontal position found.
+ *               y_ret: Where to store the vertical position found.
+ *           score_ret: Where to store the mean absolute difference per
+ *                      byte compared (TCV_MATCH_SAD, 0 to 255) or the
+ *                      correlation (TCV_MATCH_NCC, -1 to 1).
+ * Return value: Nonzero on success, zero on error (invalid parameters).
+ * Preconditions: handle != 0: handle was returned by tcv_init()
+ *                src != NULL: src[0]..src[width*height*Bpp-1] are readable
+ *                pattern != NULL:
+ *                    pattern[0]..pattern[pwidth*pheight*Bpp-1] are readable
+ *                mask == NULL || mask[0]..mask[pwidth*pheight*Bpp-1] are
+ *                    readable, and at least one is 0xFF
+ *                pwidth <= width, pheight <= height
+ * Postconditions: (on success) *x_ret, *y_ret and *score_ret are set; the
+ *                 position is within the image and the search area
+ */
+
+static int match_sad_at(const uint8_t *src, int width, int Bpp,
+                        const uint8_t *pattern, const uint8_t *mask,
+                        int pwidth, int pheight, int x, int y,
+                        uint32_t limit, uint32_t *sad_ret);
+static void match_ncc_at(const uint8_t *src, int width, int Bpp,
+                         const uint8_t *pattern, const uint8_t *mask,
+                         int pwidth, int pheight, int x, int y,
+                         double n, const uint32_t *psums, double *ncc_ret);
+
+int tcv_match(TCVHandle handle,
+              const uint8_t *src, int width, int height, int Bpp,
+              const uint8_t *pattern, const uint8_t *mask,
+              int pwidth, int pheight, TCVMatchMethod method,
+              int x, int y, int radius,
+              int *x_ret, int *y_ret, double *score_ret)
+{
+    int Bpl = pwidth * Bpp;  /* bytes per pattern line */
+    int xmin, xmax, ymin, ymax, px, py, bestx, besty, i;
+    uint32_t n = 0, psums[3] = { 0, 0, 0 };
+
+    if (!handle) {
+        tc_log_error("libtcvideo", "tcv_match: no handle given!");
+        return 0;
+    }
+    if (!src || !pattern || width <= 0 || height <= 0 || Bpp < 1 || Bpp > 4
+     || pwidth <= 0 || pheight <= 0 || pwidth > width || pheight > height
+     || !x_ret || !y_ret || !score_ret
+    ) {
+        tc_log_error("libtcvideo", "tcv_match: invalid frame parameters!");
+        return 0;
+    }
+    if (method != TCV_MATCH_SAD && method != TCV_MATCH_NCC) {
+        tc_log_error("libtcvideo", "tcv_match: invalid method (%d)!",
+                     method);
+        return 0;
+    }
+
+    /* The pattern side of the correlation, and the number of bytes
+     * compared, are the same for every position. */
+    for (i = 0; i < pheight; i++) {
+        uint32_t sums[3];
+        const uint8_t *maskline = mask ? mask + i*Bpl : NULL;
+        int j;
+        if (method == TCV_MATCH_NCC) {
+            ac_correlate(pattern + i*Bpl, pattern + i*Bpl, maskline, Bpl,
+                         sums);
+            psums[0] += sums[0];
+            psums[1] += sums[1];
+        }
+        if (maskline) {
+            for (j = 0; j < Bpl; j++)
+                n += maskline[j] & 1;
+        } else {
+            n += Bpl;
+        }
+    }
+    if (!n) {
+        tc_log_error("libtcvideo", "tcv_match: empty pattern mask!");
+        return 0;
+    }
+
+    if (radius < 0) {
+        xmin = ymin = 0;
+        xmax = width - pwidth;
+        ymax = height - pheight;
+    } else {
+        xmin = x - radius;
+        xmax = x + radius;
+        ymin = y - radius;
+        ymax = y + radius;
+        if (xmin < 0)
+            xmin = 0;
+        if (xmax > width - pwidth)
+            xmax = width - pwidth;
+        if (ymin < 0)
+            ymin = 0;
+        if (ymax > height - pheight)
+            ymax = height - pheight;
+        if (xmin > xmax)  /* expected position entirely off the image */
+            xmin = xmax = (x < 0) ? 0 : width - pwidth;
+        if (ymin > ymax)
+            ymin = ymax = (y < 0) ? 0 : height - pheight;
+    }
+    bestx = (x < xmin) ? xmin : (x > xmax) ? xmax : x;
+    besty = (y < ymin) ? ymin : (y > ymax) ? ymax : y;
+
+    if (method == TCV_MATCH_SAD) {
+        uint32_t best = 0xFFFFFFFF;
+        match_sad_at(src, width, Bpp, pattern, mask, pwidth, pheight,
+                     bestx, besty, 0xFFFFFFFF, &best);
+        for (py = ymin; py <= ymax && best > 0; py++) {
+            for (px = xmin; px <= xmax; px++) {
+                uint32_t sad;
+                if (match_sad_at(src, width, Bpp, pattern, mask,
+                                 pwidth, pheight, px, py, best, &sad)) {
+                    best = sad;
+                    bestx = px;
+                    besty = py;
+                }
+            }
+        }
+        *score_ret = (double)best / n;
+    } else {
+        double best;
+        match_ncc_at(src, width, Bpp, pattern, mask, pwidth, pheight,
+                     bestx, besty, n, psums, &best);
+        for (py = ymin; py <= ymax; py++) {
+            for (px = xmin; px <= xmax; px++) {
+                double ncc;
+                match_ncc_at(src, width, Bpp, pattern, mask, pwidth, pheight,
+                             px, py, n, psums, &ncc);
+                if (ncc > best) {
+                    best = ncc;
+                    bestx = px;
+                    besty = py;
+                }
+            }
+        }
+        *score_ret = best;
+    }
+
+    *x_ret = bestx;
+    *y_ret = besty;
+    return 1;
+}
+
+
+/* Helper functions: */
+
+/* Stores the sum of absolute differences at (x,y) in *sad_ret and returns
+ * 1 if it is below `limit'; returns 0, as soon as it knows, otherwise. */
+
+static int match_sad_at(const uint8_t *src, int width, int Bpp,
+                        const uint8_t *pattern, const uint8_t *mask,
+                        int pwidth, int pheight, int x, int y,
+                        uint32_t limit, uint32_t *sad_ret)
+{
+    int Bpl = pwidth * Bpp;
+    uint32_t sad = 0;
+    int i;
+
+    src += (y*width + x) * Bpp;
+    for (i = 0; i < pheight; i++) {
+        sad += ac_sad(src + i*width*Bpp, pattern + i*Bpl,
+                      mask ? mask + i*Bpl : NULL, Bpl);
+        if (sad >= limit)
+            return 0;
+    }
+    *sad_ret = sad;
+    return 1;
+}
+
+/* Stores the normalized cross-correlation at (x,y) in *ncc_ret; `psums'
+ * are the sum of the pattern and of its squares.  A flat image area or
+ * pattern has no defined correlation, and counts as 0. */
+
+static void match_ncc_at(const uint8_t *src, int width, int Bpp,
+                         const uint8_t *pattern, const uint8_t *mask,
+                         int pwidth, int pheight, int x, int y,
+                         double n, const uint32_t *psums, double *ncc_ret)
+{
+    int Bpl = pwidth * Bpp;
+    double sum = 0, sumsq = 0, cross = 0, var;
+    int i;
+
+    src += (y*width + x) * Bpp;
+    for (i = 0; i < pheight; i++) {
+        uint32_t sums[3];
+        ac_correlate(src + i*width*Bpp, pattern + i*Bpl,
+                     mask ? mask + i*Bpl : NULL, Bpl, sums);
+        sum   += sums[0];
+        sumsq += sums[1];
+        cross += sums[2];
+    }
+    var = (n*sumsq - sum*sum) * (n*psums[1] - (double)psums[0]*psums[0]);
+    *ncc_ret = (var > 0) ? (n*cross - sum*psums[0]) / sqrt(var) : 0;
+}
+
+/*************************************************************************/
+
+/**
+ * tcv_affine:  Apply an affine transformation (rotation, scaling,
+ * translation, shear) to an image, with bilinear interpolation.  Each
+ * destination pixel (x,y) is taken from the source position
+ *     (matrix[0]*x + matrix[1]*y + matrix[2],
+ *      matrix[3]*x + matrix[4]*y + matrix[5])
+ * worked out in 16.16 fixed point (stepping along each row) and
+ * interpolated in 1/128 pixel units.  Source pixels outside the image
+ * have the value `fill', or that of the destination pixel itself if
+ * `fill' is negative.  Only the rows first_row..last_row-1 are done;
+ * the handle is not modified, so several threads can do separate bands
+ * of rows of the same image at the same time, with the same result as
+ * doing them all at once.
+ *
+ * Parameters:      handle: tcvideo handle.
+ *                     src: Source image.
+ *                   width: Width of source image.
+ *                  height: Height of source image.
+ *                     Bpp: Bytes (not bits!) per pixel.
+ *                    dest: Destination image.
+ *              dest_width: Width of destination image.
+ *             dest_height: Height of destination image.
+ *                  matrix: Transformation from destination to source
+ *                          coordinates (6 values, as above).
+ *                    fill: Value for source pixels outside the image
+ *                          (0-255, for each byte of the pixel), or -1 to
+ *                          leave the destination pixel as it was there.
+ *               first_row: First destination row to do.
+ *                last_row: Destination row to stop at (dest_height to
+ *                          do all rows from first_row).
+ * Return value: Nonzero on success, zero on error (invalid parameters).
+ * Preconditions: handle != 0: handle was returned by tcv_init()
+ *                src != NULL: src[0]..src[width*height*Bpp-1] are readable
+ *                dest != NULL: dest[0]..dest[dest_width*dest_height*Bpp-1]
+ *                    are writable
+ *                src and dest do not overlap
+ * Postconditions: None.
+ */
+
+/* Pixels passed to ac_remap_bilinear() at a time */
+#define AFFINE_CHUNK 256
+
+static void affine_border_pixel(const uint8_t *src, int width, int height,
+                                int Bpp, int64_t ix, int64_t iy,
+                                int fx, int fy, uint8_t *dest, int fill);
+
+int tcv_affine(TCVHandle handle,
+               const uint8_t *src, int width, int height, int Bpp,
+               uint8_t *dest, int dest_width, int dest_height,
+               const double *matrix, int fill, int first_row, int last_row)
+{
+    int32_t offset[AFFINE_CHUNK];
+    int16_t weight[AFFINE_CHUNK*4];
+    int64_t m[6];
+    int x, y, i;
+
+    if (!handle) {
+        tc_log_error("libtcvideo", "tcv_affine: no handle given!");
+        return 0;
+    }
+    if (!src || !dest || !matrix || width <= 0 || height <= 0
+     || Bpp < 1 || Bpp > 4 || dest_width <= 0 || dest_height <= 0
+     || fill > 255 || first_row < 0 || last_row > dest_height
+    ) {
+        tc_log_error("libtcvideo", "tcv_affine: invalid frame parameters!");
+        return 0;
+    }
+
+    for (i = 0; i < 6; i++)
+        m[i] = llrint(matrix[i] * 65536);
+    for (y = first_row; y < last_row; y++) {
+        uint8_t *row = dest + y*dest_width*Bpp;
+        int64_t sx = m[1]*y + m[2], sy = m[4]*y + m[5];
+        int n = 0, first = 0;
+
+        for (x = 0; x < dest_width; x++, sx += m[0], sy += m[3]) {
+            int64_t ix = sx >> 16, iy = sy >> 16;
+            int fx = (sx >> 9) & 127, fy = (sy >> 9) & 127;
+
+            if (ix >= 0 && ix < width-1 && iy >= 0 && iy < height-1) {
+                int16_t *w = weight + n*4;
+                if (n == AFFINE_CHUNK) {
+                    ac_remap_bilinear(src, width*Bpp, Bpp, offset, weight,
+                                      row + first*Bpp, n);
+                    n = 0;
+                    w = weight;
+                }
+                if (n == 0)
+                    first = x;
+                offset[n++] = (iy*width + ix) * Bpp;
+                w[0] = 128 - fx;
+                w[1] = fx;
+                w[2] = 128 - fy;
+                w[3] = fy;
+            } else {
+                if (n > 0) {
+                    ac_remap_bilinear(src, width*Bpp, Bpp, offset, weight,
+                                      row + first*Bpp, n);
+                    n = 0;
+                }
+                affine_border_pixel(src, width, height, Bpp, ix, iy, fx, fy,
+                                    row + x*Bpp, fill);
+            }
+        }
+        if (n > 0) {
+            ac_remap_bilinear(src, width*Bpp, Bpp, offset, weight,
+                              row + first*Bpp, n);
+        }
+    }
+    return 1;
+}
+
+/* Helper function: */
+
+/* Interpolates one pixel whose 2x2 source pixels are not all within the
+ * image, in the same way as ac_remap_bilinear(). */
+
+static void affine_border_pixel(const uint8_t *src, int width, int height,
+                                int Bpp, int64_t ix, int64_t iy,
+                                int fx, int fy, uint8_t *dest, int fill)
+{
+    int c, i;
+
+    for (c = 0; c < Bpp; c++) {
+        int32_t tap[4], t, b;
+        for (i = 0; i < 4; i++) {
+            int64_t px = ix + (i & 1), py = iy + (i >> 1);
+            if (px < 0 || px >= width || py < 0 || py >= height) {
+                tap[i] = (fill < 0) ? dest[c] : fill;
+            } else {
+                tap[i] = src[(py*width + px) * Bpp + c];
+            }
+        }
+        t = tap[0]*(128-fx) + tap[1]*fx;
+        b = tap[2]*(128-fx) + tap[3]*fx;
+        dest[c] = (t*(128-fy) + b*fy + 8192) >> 14;
+    }
+}
+
+/*************************************************************************/
+
 /**
  * tcv_convert:  Convert an image from one image format to another.  The
  * source and destination image pointers can be the same, causing the image
@@ -1222,6 +1591,32 @@ static void init_aa_table(TCVHandle handle, double aa_weight, double aa_bias)
     }
 }
 
+/*************************************************************************/
+
+/**
+ * clip_fill:  Fill pixels of an area added by tcv_clip().
+ *
+ * Parameters:  dest: Pointer to the first pixel to fill.
+ *               Bpp: Bytes per pixel, as for tcv_clip().
+ *             value: Byte value, or 16-bit sample value if Bpp == 2.
+ *             count: Number of pixels to fill.
+ * Return value: None.
+ * Preconditions: dest[0]..dest[count*Bpp-1] are writable
+ * Postconditions: dest[0]..dest[count*Bpp-1] are set
+ */
+
+static void clip_fill(uint8_t *dest, int Bpp, int value, int count)
+{
+    if (Bpp == 2) {
+        uint16_t *samples = (uint16_t *)dest;
+        int i;
+        for (i = 0; i < count; i++)
+            samples[i] = value;
+    } else {
+        memset(dest, value, count * Bpp);
+    }
+}
+
 /*************************************************************************/
 /*************************************************************************/
 
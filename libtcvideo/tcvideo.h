@@ -49,6 +49,12 @@ typedef enum {
     TCV_ZOOM_NULL, /* this one MUST be the last one */
 } TCVZoomFilter;
 
+/* Comparison methods for tcv_match(): */
+typedef enum {
+    TCV_MATCH_SAD,  /* least sum of absolute differences */
+    TCV_MATCH_NCC,  /* highest normalized cross-correlation */
+} TCVMatchMethod;
+
 /*************************************************************************/
 
 TCVHandle tcv_init(void);
@@ -58,7 +64,7 @@ void tcv_free(TCVHandle handle);
 int tcv_clip(TCVHandle handle,
              uint8_t *src, uint8_t *dest, int width, int height, int Bpp,
              int clip_left, int clip_right, int clip_top, int clip_bottom,
-             uint8_t black_pixel);
+             int black_pixel);
 
 int tcv_deinterlace(TCVHandle handle,
                     uint8_t *src, uint8_t *dest, int width, int height,
@@ -90,6 +96,18 @@ int tcv_antialias(TCVHandle handle,
                   uint8_t *src, uint8_t *dest, int width, int height,
                   int Bpp, double weight, double bias);
 
+int tcv_match(TCVHandle handle,
+              const uint8_t *src, int width, int height, int Bpp,
+              const uint8_t *pattern, const uint8_t *mask,
+              int pwidth, int pheight, TCVMatchMethod method,
+              int x, int y, int radius,
+              int *x_ret, int *y_ret, double *score_ret);
+
+int tcv_affine(TCVHandle handle,
+               const uint8_t *src, int width, int height, int Bpp,
+               uint8_t *dest, int dest_width, int dest_height,
+               const double *matrix, int fill, int first_row, int last_row);
+
 int tcv_convert(TCVHandle handle, uint8_t *src, uint8_t *dest, int width,
                 int height, ImageFormat srcfmt, ImageFormat destfmt);
 
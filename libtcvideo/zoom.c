@@ -39,6 +39,7 @@ struct zoominfo {
     int old_w, old_h;           /* Original width and height */
     int new_w, new_h;           /* New width and height */
     int Bpp;                    /* Bytes per pixel */
+    int deep;                   /* Nonzero for 16-bit samples (Bpp == 2) */
     int old_stride;             /* Bytes per line (original image) */
     int new_stride;             /* Bytes per line (new image) */
     double (*filter)(double);   /* Filter function */
@@ -407,7 +408,8 @@ static struct clist *gen_contrib(int oldsize, int newsize, int stride,
  *          old_h: Height of original image.
  *          new_w: Width of resized image.
  *          new_h: Height of resized image.
- *            Bpp: Bytes (not bits!) per pixel.
+ *            Bpp: Bytes (not bits!) per pixel; 2 means one 16-bit
+ *                 sample per pixel.
  *     old_stride: Bytes per line of original image.
  *     new_stride: Bytes per line of resized image.
  *         filter: Filter identifier (TCV_ZOOM_*).
@@ -421,6 +423,8 @@ ZoomInfo *zoom_init(int old_w, int old_h, int new_w, int new_h, int Bpp,
 {
     ZoomInfo *zi;
     struct clist *x_contrib = NULL, *y_contrib = NULL;
+    int chans = (Bpp == 2) ? 1 : Bpp;  /* samples per pixel */
+    int ssize = Bpp / chans;           /* bytes per sample */
 
     /* Sanity check */
     if (old_w <= 0 || old_h <= 0 || new_w <= 0 || new_h <= 0 || Bpp <= 0
@@ -438,6 +442,7 @@ ZoomInfo *zoom_init(int old_w, int old_h, int new_w, int new_h, int Bpp,
     zi->new_w = new_w;
     zi->new_h = new_h;
     zi->Bpp = Bpp;
+    zi->deep = (Bpp == 2);
     zi->old_stride = old_stride;
     zi->new_stride = new_stride;
     switch (filter) {
@@ -489,14 +494,15 @@ ZoomInfo *zoom_init(int old_w, int old_h, int new_w, int new_h, int Bpp,
     if (!zi->tmpimage)
         goto error_out;
     if (old_w != new_w) {
-        x_contrib = gen_contrib(old_w, new_w, Bpp, zi->filter, zi->fwidth);
+        x_contrib = gen_contrib(old_w, new_w, chans, zi->filter,
+                                zi->fwidth);
         if (!x_contrib)
             goto error_out;
     }
     if (old_h != new_h) {
-        /* Calculate the correct stride--if the width isn't changing,
-         * this will just be old_stride */
-        int stride = (old_w==new_w) ? old_stride : Bpp*new_w;
+        /* Calculate the correct stride (in samples)--if the width isn't
+         * changing, this will just be old_stride */
+        int stride = (old_w==new_w) ? old_stride/ssize : chans*new_w;
         y_contrib = gen_contrib(old_h, new_h, stride, zi->filter,
                                 zi->fwidth);
         if (!y_contrib)
@@ -506,8 +512,9 @@ ZoomInfo *zoom_init(int old_w, int old_h, int new_w, int new_h, int Bpp,
     /* Convert contributor lists into flat arrays and fixed-point values.
      * The flat array consists of a contributor count plus two values per
      * contributor (index and fixed-point weight) for each output pixel.
-     * Note that for the horizontal direction, we make `Bpp' copies of the
-     * contributors, adjusting the offset for each byte of the pixel. */
+     * Note that for the horizontal direction, we make `chans' copies of
+     * the contributors, adjusting the offset for each sample of the
+     * pixel.  Offsets count samples, not bytes. */
 
     if (x_contrib) {
         int count = 0, i;
@@ -515,15 +522,15 @@ ZoomInfo *zoom_init(int old_w, int old_h, int new_w, int new_h, int Bpp,
 
         for (i = 0; i < new_w; i++)
             count += 1 + 2 * x_contrib[i].n;
-        zi->x_contrib = tc_malloc(sizeof(int32_t) * count * Bpp);
+        zi->x_contrib = tc_malloc(sizeof(int32_t) * count * chans);
         if (!zi->x_contrib)
             goto error_out;
-        for (ptr = zi->x_contrib, i = 0; i < new_w * Bpp; i++) {
+        for (ptr = zi->x_contrib, i = 0; i < new_w * chans; i++) {
             int j;
-            *ptr++ = x_contrib[i/Bpp].n;
-            for (j = 0; j < x_contrib[i/Bpp].n; j++) {
-                *ptr++ = x_contrib[i/Bpp].list[j].pixel + i%Bpp;
-                *ptr++ = DOUBLE_TO_FIXED(x_contrib[i/Bpp].list[j].weight);
+            *ptr++ = x_contrib[i/chans].n;
+            for (j = 0; j < x_contrib[i/chans].n; j++) {
+                *ptr++ = x_contrib[i/chans].list[j].pixel + i%chans;
+                *ptr++ = DOUBLE_TO_FIXED(x_contrib[i/chans].list[j].weight);
             }
         }
         /* Free original contributor list */
@@ -598,12 +605,20 @@ ZoomInfo *zoom_init(int old_w, int old_h, int new_w, int new_h, int Bpp,
 /* clamp the input to the specified range */
 #define CLAMP(v,l,h)    ((v)<(l) ? (l) : (v) > (h) ? (h) : (v))
 
+static void zoom_process16(const ZoomInfo *zi, const uint16_t *src,
+                           uint16_t *dest);
+
 void zoom_process(const ZoomInfo *zi, const uint8_t *src, uint8_t *dest)
 {
     int from_stride, to_stride;
     const uint8_t *from;
     uint8_t *to;
 
+    if (zi->deep) {
+        zoom_process16(zi, (const uint16_t *)src, (uint16_t *)dest);
+        return;
+    }
+
     from = src;
     from_stride = zi->old_stride;
 
@@ -667,6 +682,67 @@ void zoom_process(const ZoomInfo *zi, const uint8_t *src, uint8_t *dest)
     }
 }
 
+/* The same for 16-bit samples.  The samples times the 16.16 weights
+ * overflow 32 bits, so the sums are done in 64 bits. */
+
+static void zoom_process16(const ZoomInfo *zi, const uint16_t *src,
+                           uint16_t *dest)
+{
+    int from_stride, to_stride;
+    const uint16_t *from;
+    uint16_t *to;
+
+    from = src;
+    from_stride = zi->old_stride / 2;
+
+    if (zi->x_contrib) {
+        int y;
+        to = (uint16_t *)zi->tmpimage;
+        to_stride = zi->new_w;
+        for (y = 0; y < zi->old_h; y++, from += from_stride, to += to_stride) {
+            int32_t *contrib = zi->x_contrib;
+            int x;
+            for (x = 0; x < zi->new_w; x++) {
+                int64_t weight = DOUBLE_TO_FIXED(0.5);
+                int n = *contrib++, i;
+                for (i = 0; i < n; i++) {
+                    int pixel = *contrib++;
+                    weight += (int64_t)from[pixel] * (*contrib++);
+                }
+                to[x] = CLAMP(FIXED_TO_INT(weight), 0, 65535);
+            }
+        }
+        from = (const uint16_t *)zi->tmpimage;
+        from_stride = to_stride;
+    }
+
+    to = dest;
+    to_stride = zi->new_stride / 2;
+    if (zi->y_contrib) {
+        int32_t *contrib = zi->y_contrib;
+        int y;
+        for (y = 0; y < zi->new_h; y++, to += to_stride) {
+            int n = *contrib++, x;
+            for (x = 0; x < zi->new_w; x++) {
+                int64_t weight = DOUBLE_TO_FIXED(0.5);
+                int i;
+                for (i = 0; i < n; i++) {
+                    int pixel = contrib[i*2];
+                    weight += (int64_t)from[x+pixel] * contrib[i*2+1];
+                }
+                to[x] = CLAMP(FIXED_TO_INT(weight), 0, 65535);
+            }
+            contrib += 2*n;
+        }
+    } else {
+        int y;
+        for (y = 0; y < zi->new_h; y++) {
+            ac_memcpy(to + y*to_stride, from + y*from_stride,
+                      zi->new_w * 2);
+        }
+    }
+}
+
 /*************************************************************************/
 
 /**
@@ -26,14 +26,14 @@
 #include "avilib/avilib.h"
 
 #define MOD_NAME    "multiplex_avi.so"
-#define MOD_VERSION "v0.1.0 (2009-02-07)"
+#define MOD_VERSION "v0.1.1 (2026-10-18)"
 #define MOD_CAP     "create an AVI stream using avilib"
 
 #define MOD_FEATURES \
     TC_MODULE_FEATURE_MULTIPLEX|TC_MODULE_FEATURE_VIDEO|TC_MODULE_FEATURE_AUDIO
 
 #define MOD_FLAGS \
-    TC_MODULE_FLAG_RECONFIGURABLE
+    TC_MODULE_FLAG_RECONFIGURABLE|TC_MODULE_FLAG_REPEAT
 
 
 /* default FourCC to use if given one isn't known or if it's just absent */
@@ -45,6 +45,7 @@ static const char avi_help[] = ""
     "    AVI streams produced by this module can have a\n"
     "    maximum of one audio and video track.\n"
     "    You can add more tracks with further processing.\n"
+    "    Repeated video frames are stored as empty chunks.\n"
     "Options:\n"
     "    help    produce module overview and options explanations\n";
 
@@ -170,6 +171,11 @@ static int avi_write_video(TCModuleInstance *self,  TCFrameVideo *frame)
 
     key = ((frame->attributes & TC_FRAME_IS_KEYFRAME)
            || pd->force_kf) ?1 :0;
+    if (frame->attributes & TC_FRAME_IS_REPEAT) {
+        /* empty chunk: players show the previous frame again */
+        frame->video_len = 0;
+        key = 0;
+    }
 
     ret = AVI_write_frame(pd->avifile, (const char*)frame->video_buf,
                           frame->video_len, key);
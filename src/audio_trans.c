@@ -126,6 +126,9 @@ static int do_process_audio(vob_t *vob, aframe_list_t *ptr)
 
 int process_aud_frame(vob_t *vob, aframe_list_t *ptr)
 {
+    uint64_t start;
+    int ret;
+
     /* Check parameter validity */
     if (!vob || !ptr)
         return -1;
@@ -160,7 +163,10 @@ int process_aud_frame(vob_t *vob, aframe_list_t *ptr)
     }
 
     /* Actually perform processing */
-    return do_process_audio(vob, ptr) ? 0 : -1;
+    start = tc_latency_now();
+    ret = do_process_audio(vob, ptr) ? 0 : -1;
+    tc_latency_record(TC_LATENCY_AUDIO_PROCESS, start);
+    return ret;
 }
 
 /*************************************************************************/
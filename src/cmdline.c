@@ -11,6 +11,8 @@
 #include "transcode.h"
 #include "decoder.h"
 #include "probe.h"
+#include "probecache.h"
+#include "synchronizer.h"
 #include "libtc/libtc.h"
 #include "libtc/ratiocodes.h"
 #include "libtc/tccodecs.h"
@@ -29,7 +31,7 @@
 
 /* Global variables from transcode.c that should eventually go away. */
 char
-    *nav_seek_file=NULL, *socket_file=NULL,
+    *nav_seek_file=NULL, *socket_file=NULL, *latency_file=NULL,
     *chbase=NULL, //*dirbase=NULL,
     base[TC_BUF_MIN];
 int preset_flag=0, auto_probe=1, seek_range=1;
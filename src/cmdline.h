@@ -18,7 +18,8 @@ extern int parse_cmdline(int argc, char **argv, vob_t *vob,
                          TCSession *session);
 
 /* Global variables from transcode.c that should eventually go away. */
-extern char *nav_seek_file, *socket_file, *chbase, //*dirbase,
+extern char *nav_seek_file, *socket_file, *latency_file,
+            *chbase, //*dirbase,
             base[TC_BUF_MIN];
 extern int preset_flag, auto_probe, seek_range;
 extern int no_audio_adjust, no_split;
@@ -285,6 +285,15 @@ TC_OPTION(socket,             0,   "file",
                 }
                 socket_file = optarg;
 )
+TC_OPTION(latency_stats,      0,   "file",
+                "write per-stage latency statistics to \"file\" at exit"
+                " [off]",
+                if (*optarg == '-') {
+                    tc_error("Missing argument for --latency_stats");
+                    goto short_usage;
+                }
+                latency_file = optarg;
+)
 TC_OPTION(write_pid,          0,   "file",
                 "write pid of transcode process to \"file\" [off]",
                 FILE *f;
@@ -337,6 +346,43 @@ TC_OPTION(frame_interval,     0,   "N",
                     goto short_usage;
                 }
 )
+TC_OPTION(sample,             0,   "K[,L]",
+                "analysis run: decode only K windows of L frames spread"
+                " over the source [off,25]",
+                if (sscanf(optarg, "%d,%d", &session->sample_windows,
+                           &session->sample_length) < 1
+                 || session->sample_windows < 1
+                 || session->sample_length < 1
+                ) {
+                    tc_error("Invalid argument for --sample");
+                    goto short_usage;
+                }
+                session->sample_keyframes = 0;
+                session->core_mode = TC_MODE_ANALYSIS;
+)
+TC_OPTION(sample_keyframes,   0,   "N[,L]",
+                "analysis run: decode only L frames from every Nth"
+                " keyframe (needs --nav_seek) [off,25]",
+                if (sscanf(optarg, "%d,%d", &session->sample_keyframes,
+                           &session->sample_length) < 1
+                 || session->sample_keyframes < 1
+                 || session->sample_length < 1
+                ) {
+                    tc_error("Invalid argument for --sample_keyframes");
+                    goto short_usage;
+                }
+                session->sample_windows = 0;
+                session->core_mode = TC_MODE_ANALYSIS;
+)
+TC_OPTION(sample_settle,      0,   "N",
+                "stop analysis run when filter results are unchanged for"
+                " N frames, 0=never [250]",
+                session->sample_settle = strtol(optarg, &optarg, 0);
+                if (*optarg || session->sample_settle < 0) {
+                    tc_error("Invalid argument for --sample_settle");
+                    goto short_usage;
+                }
+)
 TC_OPTION(title,              'T', "t[,c[-d][,a]]",
                 "select DVD title[,chapters[,angle]] [1,all,1]",
                 if (sscanf(optarg, "%d,%d-%d,%d", &vob->dvd_title,
@@ -419,6 +465,14 @@ TC_OPTION(mplayer_probe,      0,   0,
                 "use (external) mplayer to probe source [off]",
                 preset_flag |= TC_PROBE_NO_BUILTIN;
 )
+TC_OPTION(probe_cache,        0,   "dir",
+                "cache probe results in \"dir\" across runs [off]",
+                if (*optarg == '-') {
+                    tc_error("Missing argument for --probe_cache");
+                    goto short_usage;
+                }
+                tc_probe_cache_set_dir(optarg);
+)
 TC_OPTION(import_with,        'x', "vmod[,amod]",
                 "video[,audio] import modules [null]",
                 /* Careful here!  "static char vbuf[1001], abuf[1001]" will
@@ -681,6 +735,16 @@ TC_OPTION(export_with,        'y', "module-string",
                     }
                 }
 )
+TC_OPTION(export_output,      0,   "file[,...]",
+                "also export to file; V=,A=,M= modules and Z=WxH size"
+                " can follow [off]",
+                if (session->export_output_num >= TC_EXPORT_OUTPUTS_MAX) {
+                    tc_error("Too many --export_output (max %i)",
+                             TC_EXPORT_OUTPUTS_MAX);
+                    goto short_usage;
+                }
+                session->export_outputs[session->export_output_num++] = optarg;
+)
 TC_OPTION(export_param,       'F', "string",
                 "encoder parameter strings [module dependent]",
                 char *s;
@@ -1409,6 +1473,15 @@ TC_OPTION(resync_margin,            0,   "N",
                     goto short_usage;
                 }
 )
+TC_OPTION(resync_method,            0,   "name",
+                "A/V (re)synchronization method (none|adjust|\n"
+                "resample|resample_live) [adjust with -M 5, else none]",
+                vob->resync_method = tc_sync_method_from_name(optarg);
+                if (vob->resync_method == TC_SYNC_NULL) {
+                    tc_error("Invalid argument for --resync_method");
+                    goto short_usage;
+                }
+)
 
 /********/ TC_HEADER("Miscellaneous options") /********/
 
@@ -1443,6 +1516,17 @@ TC_OPTION(threads,            0,   "N",
                     goto short_usage;
                 }
 )
+TC_OPTION(import_threads,     0,   "N",
+                "decode video in N threads (intra-only codecs) [off]",
+                session->import_threads = strtol(optarg, &optarg, 10);
+                if (*optarg
+                 || session->import_threads < 0
+                 || session->import_threads > TC_IMPORT_THREADS_MAX
+                ) {
+                    tc_error("Invalid argument for --import_threads");
+                    goto short_usage;
+                }
+)
 TC_OPTION(progress_meter,     0,   "N",
                 "select type of progress meter [1]",
                 session->progress_meter = strtol(optarg, &optarg, 0);
@@ -59,6 +59,9 @@ struct tcimportdata_ {
     vob_t           *vob;        /* XXX                              */
     void            *im_handle;  /* import module handle             */
     long int        framecount;
+    int             workers;     /* parallel decoding threads (video) */
+    int             readahead;   /* frames read ahead, 0: default    */
+    struct tcdecodepool_ *pool;  /* while decoding in parallel       */
 
     volatile int    active_flag; /* active or not?                   */
     TCThread        th_handle;
@@ -80,6 +83,9 @@ static void init_imdata(TCImportData *data,
     data->fd          = NULL;
     data->im_handle   = NULL;
     data->framecount  = 0;
+    data->workers     = 0;
+    data->readahead   = 0;
+    data->pool        = NULL;
     data->active_flag = TC_FALSE;
 
     tc_mutex_init(&(data->lock));
@@ -423,6 +429,7 @@ static int video_get_frame(void *ctx, TCFrameVideo *ptr)
 {
     transfer_t import_para;
     TCImportData *data = ctx;
+    uint64_t start = tc_latency_now();
     int ret = TC_OK;
 
     if (data->fd != NULL) {
@@ -430,6 +437,7 @@ static int video_get_frame(void *ctx, TCFrameVideo *ptr)
             ret = TC_ERROR;
         ptr->video_len  = data->bytes;
         ptr->video_size = data->bytes;
+        tc_latency_record(TC_LATENCY_VIDEO_READ, start);
     } else {
         import_para.fd         = NULL;
         import_para.buffer     = ptr->video_buf;
@@ -443,10 +451,432 @@ static int video_get_frame(void *ctx, TCFrameVideo *ptr)
         ptr->video_len   = import_para.size;
         ptr->video_size  = import_para.size;
         ptr->attributes |= import_para.attributes;
+        tc_latency_record(TC_LATENCY_VIDEO_DECODE, start);
     }
     return ret;
 }
 
+/*
+ * video_finish_frame: complete an imported frame (end of stream
+ * marking, synchronous pre-processing) and hand it to the next
+ * transcoding layer. Frames must be finished in their import order.
+ *
+ * Parameters:
+ *      data: import data of the video stream.
+ *       ptr: frame to finish.
+ *       ret: outcome of the frame filling (<0: failed).
+ *      next: status to push the frame into.
+ * Return Value:
+ *      None.
+ */
+static void video_finish_frame(TCImportData *data, TCFrameVideo *ptr,
+                               int ret, TCFrameStatus next)
+{
+    TCSession *session = tc_get_session(); /* FIXME: bandaid */
+    vob_t *vob = data->vob;
+
+    if (ret < 0) {
+        tc_debug(TC_DEBUG_THREADS,
+                 "(video import) data read failed - end of stream");
+
+        ptr->video_len  = 0;
+        ptr->video_size = 0;
+        if (!tc_has_more_video_in_file(session)) {
+            ptr->attributes = TC_FRAME_IS_END_OF_STREAM;
+        } else {
+            ptr->attributes = TC_FRAME_IS_SKIPPED;
+        }
+    }
+
+    ptr->v_height = vob->im_v_height;
+    ptr->v_width  = vob->im_v_width;
+    ptr->v_bpp    = BPP;
+
+    tc_debug(TC_DEBUG_THREADS, "(video import) new frame is being processed");
+
+    /* stage 3: account filled frame and process it if needed */
+    if (TC_FRAME_NEED_PROCESSING(ptr)) {
+        //first stage pre-processing - (synchronous)
+        preprocess_vid_frame(vob, ptr);
+
+        //filter pre-processing - (synchronous)
+        ptr->tag = TC_VIDEO|TC_PRE_S_PROCESS;
+        tc_filter_process((frame_list_t *)ptr);
+    }
+
+    tc_debug(TC_DEBUG_THREADS, "(video import) new frame ready to be pushed");
+
+    /* stage 4: push frame to next transcoding layer */
+    vframe_push_next(ptr, next);
+
+    tc_debug(TC_DEBUG_THREADS, "(video import) new frame pushed");
+}
+
+/*************************************************************************/
+/*                  parallel video decoding                              */
+/*************************************************************************/
+
+/*
+ * Import modules advertising TC_CAP_SPLIT can separate the reading of
+ * a compressed frame (TC_IMPORT_READ), which must stay sequential, from
+ * its decoding (TC_IMPORT_UNPACK), which for intra-only codecs does not
+ * depend on other frames and can be run concurrently.
+ *
+ * The import thread registers frames and reads packets in order into a
+ * ring of slots; the decoding workers unpack them in whatever order they
+ * complete. Whoever completes the oldest pending slot finishes (see
+ * video_finish_frame) all the consecutive decoded slots, one at time, so
+ * the synchronous stages and the next layer still see frames in order.
+ *
+ * The reader stays at most `window' frames ahead of the oldest frame
+ * not yet finished. The window can be changed while running (see
+ * tc_import_set_readahead), so there are more slots than needed by
+ * default; their packet buffers are allocated when first used.
+ */
+
+#define DECODE_SLOTS_PER_WORKER 2   /* default read-ahead */
+#define DECODE_SLOTS_MAX_WORKER 8   /* maximum read-ahead */
+#define DECODE_PACKET_SLACK     4096 /* for framing/headers of packets */
+
+/* Packet buffer for frames of `bytes' bytes: enough for the worst case
+ * of LZO on incompressible data (n + n/16 + 64 + 3 bytes) plus headers.
+ * A buffer still too small for a packet is grown when it is read. */
+#define DECODE_PACKET_SIZE(bytes) \
+    ((bytes) + (bytes) / 16 + 64 + 3 + DECODE_PACKET_SLACK)
+
+enum {
+    DECODE_SLOT_FREE = 0, /* ready to be filled by the reader */
+    DECODE_SLOT_READ,     /* packet available, to be decoded  */
+    DECODE_SLOT_BUSY,     /* being decoded                    */
+    DECODE_SLOT_DONE,     /* to be finished and pushed        */
+};
+
+typedef struct tcdecodeslot_ TCDecodeSlot;
+struct tcdecodeslot_ {
+    TCFrameVideo    *ptr;
+    uint8_t         *packet;
+    int             packet_size;    /* allocated */
+    int             packet_len;     /* used      */
+    int             ret;
+    int             state;
+};
+
+typedef struct tcdecodepool_ TCDecodePool;
+struct tcdecodepool_ {
+    TCImportData    *data;
+    TCFrameStatus   next;
+
+    TCDecodeSlot    *slots;
+    int             packet_size;
+    int             nslots;
+    int             window;     /* read-ahead, up to nslots       */
+
+    long            read;       /* slots filled by the reader     */
+    long            decoded;    /* slots taken by workers         */
+    long            finished;   /* slots finished and pushed      */
+    int             finishing;  /* a thread is finishing slots    */
+    int             stop;
+
+    int             workers;
+    TCThread        threads[TC_IMPORT_THREADS_MAX];
+    TCMutex         lock;
+    TCCondition     cond;
+};
+
+/*
+ * video_read_packet: read the next packet into `slot', growing its
+ * buffer if the module asks for a larger one.
+ *
+ * Return Value:
+ *      TC_IMPORT_OK on success, TC_IMPORT_ERROR otherwise; the packet
+ *      length is left to 0 if that's because the stream ended.
+ */
+static int video_read_packet(TCImportData *data, TCDecodeSlot *slot)
+{
+    transfer_t import_para;
+    uint64_t start = tc_latency_now();
+    int ret;
+
+    while (TC_TRUE) {
+        uint8_t *packet = NULL;
+
+        memset(&import_para, 0, sizeof(transfer_t));
+        import_para.buffer     = slot->packet;
+        import_para.size       = slot->packet_size;
+        import_para.flag       = TC_VIDEO;
+        import_para.attributes = slot->ptr->attributes;
+
+        ret = tcv_import(TC_IMPORT_READ, &import_para, data->vob);
+        if (ret >= 0 || import_para.size <= slot->packet_size) {
+            break;
+        }
+
+        packet = tc_bufalloc(import_para.size);
+        if (packet == NULL) {
+            tc_log_error(__FILE__, "can't allocate a %i bytes packet",
+                         import_para.size);
+            break;
+        }
+        tc_debug(TC_DEBUG_THREADS, "packet buffer grown to %i bytes",
+                 import_para.size);
+        tc_buffree(slot->packet);
+        slot->packet      = packet;
+        slot->packet_size = import_para.size;
+    }
+
+    slot->packet_len        = import_para.size;
+    slot->ptr->attributes  |= import_para.attributes;
+    tc_latency_record(TC_LATENCY_VIDEO_READ, start);
+    return ret;
+}
+
+static int video_unpack_packet(TCImportData *data, TCDecodeSlot *slot)
+{
+    transfer_t import_para;
+    TCFrameVideo *ptr = slot->ptr;
+    uint64_t start = tc_latency_now();
+    int ret;
+
+    memset(&import_para, 0, sizeof(transfer_t));
+    import_para.buffer     = ptr->video_buf;
+    import_para.buffer2    = slot->packet;
+    import_para.size       = slot->packet_len;
+    import_para.flag       = TC_VIDEO;
+    import_para.attributes = ptr->attributes;
+
+    ret = tcv_import(TC_IMPORT_UNPACK, &import_para, data->vob);
+
+    ptr->video_len   = import_para.size;
+    ptr->video_size  = import_para.size;
+    ptr->attributes |= import_para.attributes;
+    tc_latency_record(TC_LATENCY_VIDEO_DECODE, start);
+    return ret;
+}
+
+/* must be called with pool lock held */
+static void decode_pool_finish(TCDecodePool *pool)
+{
+    if (pool->finishing) {
+        return; /* the other thread will take care of our slots too */
+    }
+    pool->finishing = TC_TRUE;
+    while (pool->finished < pool->read) {
+        TCDecodeSlot *slot = &pool->slots[pool->finished % pool->nslots];
+
+        if (slot->state != DECODE_SLOT_DONE) {
+            break;
+        }
+        tc_mutex_unlock(&pool->lock);
+        video_finish_frame(pool->data, slot->ptr, slot->ret, pool->next);
+        tc_mutex_lock(&pool->lock);
+
+        slot->ptr   = NULL;
+        slot->state = DECODE_SLOT_FREE;
+        pool->finished++;
+        tc_condition_broadcast(&pool->cond);
+    }
+    pool->finishing = TC_FALSE;
+}
+
+static int decode_pool_worker(TCThreadData *td, void *datum)
+{
+    TCDecodePool *pool = datum;
+
+    tc_mutex_lock(&pool->lock);
+    while (TC_TRUE) {
+        TCDecodeSlot *slot = NULL;
+
+        while (!pool->stop && pool->decoded == pool->read) {
+            tc_condition_wait(&pool->cond, &pool->lock);
+        }
+        if (pool->decoded == pool->read) {
+            break; /* stopped and nothing left */
+        }
+
+        slot = &pool->slots[pool->decoded % pool->nslots];
+        pool->decoded++;
+
+        if (slot->state == DECODE_SLOT_READ) {
+            slot->state = DECODE_SLOT_BUSY;
+            tc_mutex_unlock(&pool->lock);
+
+            slot->ret = video_unpack_packet(pool->data, slot);
+            if (slot->ret < 0) {
+                tc_log_error(__FILE__, "(%s) can't decode video frame [%i]",
+                             td->name, slot->ptr->id);
+            }
+            tc_debug(TC_DEBUG_THREADS, "(%s) frame [%i] decoded (%s)",
+                     td->name, slot->ptr->id,
+                     (slot->ret < 0) ?"FAILED" :"OK");
+
+            tc_mutex_lock(&pool->lock);
+            slot->state = DECODE_SLOT_DONE;
+        }
+        decode_pool_finish(pool);
+    }
+    tc_mutex_unlock(&pool->lock);
+    return TC_OK;
+}
+
+static void decode_pool_fini(TCDecodePool *pool)
+{
+    int i;
+
+    tc_mutex_lock(&pool->lock);
+    pool->stop = TC_TRUE;
+    tc_condition_broadcast(&pool->cond);
+    tc_mutex_unlock(&pool->lock);
+
+    for (i = 0; i < pool->workers; i++) {
+        tc_thread_wait(&pool->threads[i], NULL);
+    }
+    if (pool->slots != NULL) {
+        for (i = 0; i < pool->nslots; i++) {
+            tc_buffree(pool->slots[i].packet);
+        }
+    }
+    tc_free(pool->slots);
+}
+
+static int decode_pool_init(TCDecodePool *pool, TCImportData *data,
+                            TCFrameStatus next)
+{
+    int i;
+
+    memset(pool, 0, sizeof(TCDecodePool));
+    pool->data        = data;
+    pool->next        = next;
+    pool->nslots      = data->workers * DECODE_SLOTS_MAX_WORKER;
+    pool->window      = data->workers * DECODE_SLOTS_PER_WORKER;
+    pool->packet_size = DECODE_PACKET_SIZE(data->bytes);
+    tc_mutex_init(&pool->lock);
+    tc_condition_init(&pool->cond);
+
+    if (data->readahead > 0) {
+        pool->window = TC_MIN(data->readahead, pool->nslots);
+    }
+
+    pool->slots = tc_zalloc(pool->nslots * sizeof(TCDecodeSlot));
+    if (pool->slots == NULL) {
+        tc_log_warn(__FILE__, "can't allocate the decoding slots");
+        decode_pool_fini(pool);
+        return TC_ERROR;
+    }
+
+    for (i = 0; i < data->workers; i++) {
+        tc_thread_init(&pool->threads[i], "video decode");
+        if (tc_thread_start(&pool->threads[i],
+                            decode_pool_worker, pool) != TC_OK) {
+            tc_log_warn(__FILE__, "can't start video decoding thread #%i",
+                        i);
+            break;
+        }
+        pool->workers++;
+    }
+    if (pool->workers == 0) {
+        decode_pool_fini(pool);
+        return TC_ERROR;
+    }
+    return TC_OK;
+}
+
+/*
+ * video_import_loop_split: the video import loop for TC_CAP_SPLIT
+ * modules. See above.
+ */
+static int video_import_loop_split(TCThreadData *td, TCImportData *data,
+                                   TCDecodePool *pool)
+{
+    int ret = 0;
+    int im_ret = TC_IM_THREAD_UNKNOWN;
+    vob_t *vob = data->vob;
+
+    while (tc_running() && tc_import_thread_is_active(data)) {
+        TCDecodeSlot *slot = NULL;
+        TCFrameVideo *ptr = NULL;
+        int skip = 0;
+
+        tc_mutex_lock(&pool->lock);
+        while (pool->read - pool->finished >= pool->window) {
+            tc_condition_wait(&pool->cond, &pool->lock);
+        }
+        slot = &pool->slots[pool->read % pool->nslots];
+        tc_mutex_unlock(&pool->lock);
+
+        if (slot->packet == NULL) {
+            slot->packet = tc_bufalloc(pool->packet_size);
+            if (slot->packet == NULL) {
+                tc_log_error(__FILE__, "can't allocate a decoding slot");
+                im_ret = TC_IM_THREAD_INT_ERROR;
+                break;
+            }
+            slot->packet_size = pool->packet_size;
+        }
+
+        /* stage 1: register new blank frame */
+        ptr = vframe_register(data->framecount);
+        if (ptr == NULL) {
+            tc_debug(TC_DEBUG_THREADS,
+                     "(%s) frame registration interrupted!", td->name);
+            break;
+        }
+
+        /* stage 2: read the packet, it will be decoded by a worker */
+        ptr->attributes = 0;
+        MARK_TIME_RANGE(ptr, vob);
+
+        slot->ptr = ptr;
+        ret = video_read_packet(data, slot);
+
+        tc_debug(TC_DEBUG_THREADS, "(%s) frame [%li] read (%s)",
+                 td->name, data->framecount, (ret < 0) ?"FAILED" :"OK");
+
+        if (ret < 0 && slot->packet_len > 0) {
+            /* not the end of the stream: don't pass it off as one */
+            tc_log_error(__FILE__, "(%s) can't read video frame [%li]",
+                         td->name, data->framecount);
+            im_ret = TC_IM_THREAD_EXT_ERROR;
+        }
+
+        /* frames outside the -c ranges are never looked at, and unpacking
+         * is reentrant, so no later frame depends on it: don't decode
+         * them at all (this is what makes sampled analysis runs fast) */
+        skip = (ret >= 0 && (ptr->attributes & TC_FRAME_IS_OUT_OF_RANGE));
+        if (skip) {
+            ptr->video_len  = 0;
+            ptr->video_size = 0;
+        }
+
+        tc_mutex_lock(&pool->lock);
+        slot->ret   = ret;
+        slot->state = (ret < 0 || skip) ?DECODE_SLOT_DONE :DECODE_SLOT_READ;
+        pool->read++;
+        tc_condition_broadcast(&pool->cond);
+        decode_pool_finish(pool);
+        tc_mutex_unlock(&pool->lock);
+
+        if (ret < 0) {
+            tc_import_thread_stop(data);
+            if (im_ret == TC_IM_THREAD_UNKNOWN) {
+                im_ret = TC_IM_THREAD_DONE;
+            }
+            break;
+        }
+        data->framecount++;
+    }
+
+    /* every frame registered must reach the next layer */
+    tc_mutex_lock(&pool->lock);
+    while (pool->finished < pool->read) {
+        tc_condition_wait(&pool->cond, &pool->lock);
+    }
+    tc_mutex_unlock(&pool->lock);
+
+    return stop_cause(im_ret);
+}
+
+/*************************************************************************/
+
 /*
  * {video,audio}_import_loop: data import loops. Feed frame FIFOs with
  * new data forever until are interrupted or stopped.
@@ -464,9 +894,28 @@ static int video_import_loop(TCThreadData *td, void *datum)
     TCFrameStatus next = (tc_frame_threads_have_video_workers())
                             ?TC_FRAME_WAIT :TC_FRAME_READY;
     int im_ret = TC_IM_THREAD_UNKNOWN;
-    TCSession *session = tc_get_session(); /* FIXME: bandaid */
     vob_t *vob = data->vob;
 
+    if (data->workers > 1) {
+        TCDecodePool pool;
+
+        if (decode_pool_init(&pool, data, next) == TC_OK) {
+            tc_mutex_lock(&data->lock);
+            data->pool = &pool;
+            tc_mutex_unlock(&data->lock);
+
+            im_ret = video_import_loop_split(td, data, &pool);
+
+            tc_mutex_lock(&data->lock);
+            data->pool = NULL;
+            tc_mutex_unlock(&data->lock);
+
+            decode_pool_fini(&pool);
+            return im_ret;
+        }
+        tc_log_warn(__FILE__, "falling back to serial video decoding");
+    }
+
     while (tc_running() && tc_import_thread_is_active(data)) {
         tc_debug(TC_DEBUG_THREADS, "(%s) requesting [%li] %i bytes",
                  td->name, data->framecount, data->bytes);
@@ -493,44 +942,8 @@ static int video_import_loop(TCThreadData *td, void *datum)
                  "(%s) new frame filled (%s)",
                  td->name, (ret == -1) ?"FAILED" :"OK");
 
-        if (ret < 0) {
-            tc_debug(TC_DEBUG_THREADS,
-                     "(%s) data read failed - end of stream", td->name);
-
-            ptr->video_len  = 0;
-            ptr->video_size = 0;
-            if (!tc_has_more_video_in_file(session)) {
-                ptr->attributes = TC_FRAME_IS_END_OF_STREAM;
-            } else {
-                ptr->attributes = TC_FRAME_IS_SKIPPED;
-            }
-        }
-
-        ptr->v_height = vob->im_v_height;
-        ptr->v_width  = vob->im_v_width;
-        ptr->v_bpp    = BPP;
-
-        tc_debug(TC_DEBUG_THREADS,
-                 "(%s) new frame is being processed", td->name);
-
-        /* stage 3: account filled frame and process it if needed */
-        if (TC_FRAME_NEED_PROCESSING(ptr)) {
-            //first stage pre-processing - (synchronous)
-            preprocess_vid_frame(vob, ptr);
-
-            //filter pre-processing - (synchronous)
-            ptr->tag = TC_VIDEO|TC_PRE_S_PROCESS;
-            tc_filter_process((frame_list_t *)ptr);
-        }
-
-        tc_debug(TC_DEBUG_THREADS, 
-                 "(%s) new frame ready to be pushed", td->name);
-
-        /* stage 4: push frame to next transcoding layer */
-        vframe_push_next(ptr, next);
-
-        tc_debug(TC_DEBUG_THREADS,
-                 "(%s) new frame pushed", td->name);
+        /* stages 3 and 4 */
+        video_finish_frame(data, ptr, ret, next);
 
         if (ret < 0) {
             /* 
@@ -550,6 +963,7 @@ static int audio_get_frame(void *ctx, TCFrameAudio *ptr)
 {
     transfer_t import_para;
     TCImportData *data = ctx;
+    uint64_t start = tc_latency_now();
     int ret = TC_OK;
 
     if (data->fd != NULL) {
@@ -557,6 +971,7 @@ static int audio_get_frame(void *ctx, TCFrameAudio *ptr)
             ret = TC_ERROR;
         ptr->audio_len  = data->bytes;
         ptr->audio_size = data->bytes;
+        tc_latency_record(TC_LATENCY_AUDIO_READ, start);
     } else {
         import_para.fd         = NULL;
         import_para.buffer     = ptr->audio_buf;
@@ -568,6 +983,7 @@ static int audio_get_frame(void *ctx, TCFrameAudio *ptr)
 
         ptr->audio_len  = import_para.size;
         ptr->audio_size = import_para.size;
+        tc_latency_record(TC_LATENCY_AUDIO_DECODE, start);
     }
     return ret;
 }
@@ -679,6 +1095,42 @@ int tc_import_audio_status(void)
     return (tc_import_thread_is_active(&video_imdata) || aframe_have_more());
 }
 
+int tc_import_set_readahead(int frames)
+{
+    TCImportData *data = &video_imdata;
+    int ret = TC_ERROR;
+
+    tc_mutex_lock(&data->lock);
+    if (data->pool != NULL && frames >= 1 && frames <= data->pool->nslots) {
+        TCDecodePool *pool = data->pool;
+
+        tc_mutex_lock(&pool->lock);
+        pool->window = frames;
+        tc_condition_broadcast(&pool->cond);
+        tc_mutex_unlock(&pool->lock);
+
+        data->readahead = frames; /* for the next sources, if any */
+        ret = TC_OK;
+    }
+    tc_mutex_unlock(&data->lock);
+    return ret;
+}
+
+int tc_import_get_readahead(void)
+{
+    TCImportData *data = &video_imdata;
+    int frames = 0;
+
+    tc_mutex_lock(&data->lock);
+    if (data->pool != NULL) {
+        tc_mutex_lock(&data->pool->lock);
+        frames = data->pool->window;
+        tc_mutex_unlock(&data->pool->lock);
+    }
+    tc_mutex_unlock(&data->lock);
+    return frames;
+}
+
 
 void tc_import_threads_cancel(void)
 {
@@ -706,6 +1158,12 @@ void tc_import_threads_create(vob_t *vob)
 {
     int ret;
 
+    /* frames are numbered from the point the source was opened at: the
+     * frame ranges of a seek (--nav_seek, PSU and chapter modes) are
+     * relative to it */
+    audio_imdata.framecount = 0;
+    video_imdata.framecount = 0;
+
     tc_thread_init(&audio_imdata.th_handle, "audio import");
     tc_import_thread_start(&audio_imdata);
     ret = tc_thread_start(&audio_imdata.th_handle,
@@ -726,10 +1184,15 @@ void tc_import_threads_create(vob_t *vob)
 
 int tc_import_init(vob_t *vob, const char *a_mod, const char *v_mod)
 {
-    TCSyncMethodID sync_method = (vob->demuxer == 5) ?TC_SYNC_ADJUST_FRAMES :TC_SYNC_NONE;
+    TCSyncMethodID sync_method = vob->resync_method;
+    TCSession *session = tc_get_session(); /* FIXME: bandaid */
     transfer_t import_para;
     int caps;
 
+    if (sync_method == TC_SYNC_NULL) {
+        sync_method = (vob->demuxer == 5) ?TC_SYNC_ADJUST_FRAMES :TC_SYNC_NONE;
+    }
+
     init_imdata(&audio_imdata, vob, vob->im_a_size, "audio import");
     init_imdata(&video_imdata, vob, vob->im_v_size, "video import");
 
@@ -755,6 +1218,24 @@ int tc_import_init(vob_t *vob, const char *a_mod, const char *v_mod)
     caps = check_module_caps(&import_para, vob->im_v_codec, vidpairs);
     RETURN_IF_NOT_SUPPORTED(caps, "video");
 
+    /*
+     * modules decoding out of process (through tcdecode) can use
+     * im_v_threads by themselves; the others need to split decoding
+     * in TC_IMPORT_READ + TC_IMPORT_UNPACK for us to run it in parallel.
+     */
+    vob->im_v_threads = session->import_threads;
+    video_imdata.workers = 0;
+    if (session->import_threads > 1
+     && import_para.flag != verbose /* legacy module */
+     && (import_para.flag & TC_CAP_SPLIT)) {
+        if (sync_method != TC_SYNC_NONE) {
+            tc_log_info(PACKAGE, "parallel video decoding not available"
+                                 " with A/V resync, using one thread");
+        } else {
+            video_imdata.workers = session->import_threads;
+        }
+    }
+
     return tc_sync_init(vob, sync_method, TC_AUDIO);
 }
 
@@ -810,7 +1291,63 @@ static void dump_probeinfo(const ProbeInfo *pi, int i, const char *tag)
     }
 }
 
-static int probe_im_stream(const char *src, ProbeInfo *info)
+/*
+ * probe results of the sources still to be imported in directory mode,
+ * gathered all at once before the import threads start.
+ */
+typedef struct tcmultiprobe_ TCMultiProbe;
+struct tcmultiprobe_ {
+    const char * const  *files;  /* owned by vob->video_in_files */
+    ProbeInfo           *infos;
+    int                 *results;
+    int                 count;
+};
+
+static TCMultiProbe multi_probe = { NULL, NULL, NULL, 0 };
+
+static void multi_probe_prefetch(vob_t *vob)
+{
+    const char * const *files = NULL;
+    int count = tc_glob_pending(vob->video_in_files, &files);
+    int done = 0;
+
+    if (count <= 0) {
+        return;
+    }
+    multi_probe.infos   = tc_malloc(count * sizeof(ProbeInfo));
+    multi_probe.results = tc_malloc(count * sizeof(int));
+    if (!multi_probe.infos || !multi_probe.results) {
+        /* not fatal: sources will be probed when needed */
+        tc_free(multi_probe.infos);
+        tc_free(multi_probe.results);
+        multi_probe.infos   = NULL;
+        multi_probe.results = NULL;
+        return;
+    }
+
+    done = probe_stream_data_list((const char **)files, count, seek_range,
+                                  0, multi_probe.infos, multi_probe.results);
+    multi_probe.files = files;
+    multi_probe.count = count;
+
+    if (verbose) {
+        tc_log_info(__FILE__, "probed %i/%i sources in advance",
+                    done, count);
+    }
+}
+
+static void multi_probe_free(void)
+{
+    tc_free(multi_probe.infos);
+    tc_free(multi_probe.results);
+    multi_probe.files   = NULL;
+    multi_probe.infos   = NULL;
+    multi_probe.results = NULL;
+    multi_probe.count   = 0;
+}
+
+/* idx: position of `src' among the sources still to be imported */
+static int probe_im_stream(const char *src, int idx, ProbeInfo *info)
 {
     static TCMutex probe_lock; /* FIXME */
     static int inited = 0;
@@ -822,9 +1359,15 @@ static int probe_im_stream(const char *src, ProbeInfo *info)
         inited = 1;
     }
 
-    tc_mutex_lock(&probe_lock);
-    ret = probe_stream_data(src, seek_range, info);
-    tc_mutex_unlock(&probe_lock);
+    if (idx >= 0 && idx < multi_probe.count
+     && multi_probe.results[idx]
+     && strcmp(multi_probe.files[idx], src) == 0) {
+        *info = multi_probe.infos[idx];
+    } else {
+        tc_mutex_lock(&probe_lock);
+        ret = probe_stream_data(src, seek_range, info);
+        tc_mutex_unlock(&probe_lock);
+    }
 
     dump_probeinfo(info, 0, "probed");
 
@@ -986,7 +1529,7 @@ static int multi_import_thread(TCThreadData *td, void *datum)
 
         fname = current_in_file(sid->imdata->vob, sid->kind);
         /* probing coherency check */
-        ret = probe_im_stream(fname, new);
+        ret = probe_im_stream(fname, i - 1, new);
         RETURN_IF_PROBE_FAILED(ret, fname);
 
         if (probe_matches(old, new, track_id)) {
@@ -1018,6 +1561,8 @@ void tc_multi_import_threads_create(vob_t *vob)
 {
     int ret;
 
+    multi_probe_prefetch(vob);
+
     probe_from_vob(&(audio_multidata.infos), vob);
     MULTIDATA_INIT(audio, TC_AUDIO);
     tc_import_thread_start(&audio_imdata);
@@ -1046,6 +1591,8 @@ void tc_multi_import_threads_cancel(void)
     MULTIDATA_FINI(video);
 
     tc_import_threads_cancel();
+
+    multi_probe_free();
 }
 
 
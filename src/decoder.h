@@ -150,6 +150,23 @@ int tc_import_status(void);
 int tc_import_audio_status(void);
 int tc_import_video_status(void);
 
+/*
+ * tc_import_{set,get}_readahead (Thread safe):
+ * change or query how many video frames the import layer reads ahead
+ * of the oldest frame still being decoded. Only meaningful while video
+ * is decoded in parallel (see --import_threads): the limit is
+ * 8 frames per decoding thread.
+ *
+ * Parameters:
+ *      frames: new read-ahead, in frames.
+ * Return Value:
+ *      set: TC_OK if succesfull, TC_ERROR if there is no parallel
+ *           decoding going on or the value is out of range.
+ *      get: the current read-ahead, 0 if not decoding in parallel.
+ */
+int tc_import_set_readahead(int frames);
+int tc_import_get_readahead(void);
+
 /*************************************************************************/
 
 void tc_multi_import_threads_create(vob_t *vob);
@@ -77,6 +77,7 @@ struct tcringbuffersource_ {
     int             have_vid_threads;
 
     int             frame_id;
+    int             draining; /* end of stream reached, emptying filters */
 
     TCFrameVideo    *vptr;
     TCFrameAudio    *aptr;
@@ -103,6 +104,24 @@ static void apply_video_filters(TCRingBufferSource *buf,
 static void apply_audio_filters(TCRingBufferSource *buf,
                                 TCFrameAudio *aptr, TCJob *job);
 
+/*
+ * drain_audio_filters:
+ *       Once the audio stream ended, fill the end of stream frame with
+ *       the next audio frame still held back by the filter chain, if any.
+ *       A filled frame is marked as cloned, so the encoder hands it
+ *       back once done and it can carry the following held frame;
+ *       when the filters are empty it becomes the end of stream frame
+ *       again.
+ *
+ * Parameters:
+ *       buf: encoder buffer in use.
+ *      aptr: end of stream audio framebuffer.
+ * Return Value:
+ *      !0 if `aptr' was filled with a held frame,
+ *       0 if the filter chain is drained.
+ */
+static int drain_audio_filters(TCRingBufferSource *buf, TCFrameAudio *aptr);
+
 /*
  * encoder_acquire_{v,a}frame:
  *      Get respectively a new video or audio framebuffer for encoding.
@@ -205,6 +224,26 @@ static void apply_audio_filters(TCRingBufferSource *buf,
     }
 }
 
+static int drain_audio_filters(TCRingBufferSource *buf, TCFrameAudio *aptr)
+{
+    aptr->attributes = 0;
+    aptr->tag = TC_AUDIO|TC_POST_S_PROCESS;
+    while (tc_filter_drain((frame_list_t *)aptr)) {
+        if (!(aptr->attributes & TC_FRAME_IS_SKIPPED)) {
+            /* preview _after_ all post-processing */
+            aptr->tag = TC_AUDIO|TC_PREVIEW;
+            tc_filter_process((frame_list_t *)aptr);
+            aptr->attributes |= TC_FRAME_IS_CLONED;
+            return 1;
+        }
+        aptr->attributes = 0;
+    }
+    aptr->audio_len  = 0;
+    aptr->audio_size = 0;
+    aptr->attributes = TC_FRAME_IS_END_OF_STREAM;
+    return 0;
+}
+
 static TCFrameVideo *encoder_acquire_vframe(TCFrameSource *FS)
 {
     TCRingBufferSource *buf = FS->privdata;
@@ -279,6 +318,12 @@ static TCFrameAudio *encoder_acquire_aframe(TCFrameSource *FS)
             return NULL;
         }
 
+        if (buf->draining || (frame->attributes & TC_FRAME_IS_END_OF_STREAM)) {
+            /* give out what the filters held back before the end */
+            buf->draining = drain_audio_filters(buf, frame);
+            break;
+        }
+
         apply_audio_filters(buf, frame, FS->job);
 
         if (frame->attributes & TC_FRAME_IS_SKIPPED) {
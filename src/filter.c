@@ -11,6 +11,10 @@
 #include "transcode.h"
 #include "filter.h"
 
+#include "libtcutil/tcthread.h"
+#include "libtcmodule/tcmodule-data.h"
+#include "tccore/runcontrol.h"
+
 // temp defines during module system switchover
 //#define SUPPORT_NMS     // support NMS modules?
 #define SUPPORT_CLASSIC // support classic modules?
@@ -35,6 +39,12 @@ typedef struct FilterInstance_ {
     char name[MAX_FILTER_NAME_LEN+1]; // Filter name
     int id;                     // Unique ID value for this filter instance
     int enabled;                // Nonzero if filter is inabled
+    int reentrant;              // Nonzero if filter handles parallel frames
+    int shares;                 // Nonzero if filter handles shared frames
+    TCMutex lock;               // Serializes calls to non-reentrant filters
+    int stage;                  // Latency statistics stage for this filter
+    int reports;                // Nonzero if filter reports its progress
+    int unchanged;              // Frames since the filter's result changed
 #ifdef SUPPORT_CLASSIC
     void *handle;               // DLL handle for old-style modules
     TCFilterOldEntryFunc entry; // Module entry point for old-style modules
@@ -51,6 +61,14 @@ static int initialized = 0;
 /* Filter instance table. */
 static FilterInstance filters[MAX_FILTERS];
 
+/* Number of unchanged frames after which an analysis filter's result is
+ * considered settled (0 = never), whether the run has already been stopped
+ * because all results settled, and a lock protecting both and the
+ * reports/unchanged fields of the filter table. */
+static int settle_frames = 0;
+static int settled = 0;
+static TCMutex settle_lock;
+
 
 /* Macro to check that tc_filter_init() has been called, and abort the
  * function otherwise.  Pass the appropriate return value (nothing for a
@@ -95,6 +113,46 @@ static int id_to_index(int id, const char *func)
     return i;
 }
 
+/**
+ * filter_has_cap:  Local helper function to check whether a filter
+ * description, as built by optstr_filter_desc(), lists the given
+ * capability.
+ *
+ * Parameters:
+ *     desc: Filter description (may be NULL).
+ *      cap: Capability character to look for.
+ * Return value:
+ *     Nonzero if the capability is listed, zero otherwise.
+ */
+
+static int filter_has_cap(const char *desc, int cap)
+{
+    const char *end, *first = NULL, *last = NULL, *s;
+
+    if (!desc)
+        return 0;
+    /* The capabilities are the next to last field of the first line */
+    end = strchr(desc, '\n');
+    if (!end)
+        end = desc + strlen(desc);
+    for (s = end - 1; s >= desc; s--) {
+        if (*s == ',') {
+            if (last) {
+                first = s;
+                break;
+            }
+            last = s;
+        }
+    }
+    if (!first)
+        return 0;
+    for (s = first + 1; s < last; s++) {
+        if (*s == cap)
+            return 1;
+    }
+    return 0;
+}
+
 /*************************************************************************/
 /*************************************************************************/
 
@@ -115,8 +173,16 @@ int tc_filter_init(void)
         tc_log_warn(__FILE__, "tc_filter_init() called twice!");
         return 1;
     }
-    for (i = 0; i < MAX_FILTERS; i++)
+    for (i = 0; i < MAX_FILTERS; i++) {
         filters[i].id = 0;
+        filters[i].reentrant = 0;
+        filters[i].shares = 0;
+        filters[i].reports = 0;
+        filters[i].unchanged = 0;
+        tc_mutex_init(&filters[i].lock);
+    }
+    tc_mutex_init(&settle_lock);
+    settled = 0;
     initialized = 1;
     return 1;
 }
@@ -150,6 +216,81 @@ void tc_filter_fini(void)
 
 /*************************************************************************/
 
+/**
+ * next_filter:  Local helper function to find the enabled filter coming
+ * after the given one in the chain.  The order of the filters is given by
+ * their ID values--however, this does not necessarily match the order in
+ * the filters[] array, so we search for the lowest ID greater than the
+ * given one.
+ *
+ * Parameters:
+ *     last_id: ID of the last filter processed (0 to start the chain,
+ *              lower than any valid ID).
+ * Return value:
+ *     filters[] index of the next filter, or -1 at the end of the chain.
+ */
+
+static int next_filter(int last_id)
+{
+    int next = -1, i;
+
+    for (i = 0; i < MAX_FILTERS; i++) {
+        if (filters[i].id <= last_id || !filters[i].enabled)
+            continue;
+        if (next < 0 || filters[i].id < filters[next].id)
+            next = i;
+    }
+    return next;
+}
+
+/**
+ * call_filter:  Local helper function to send a frame to a single filter.
+ *
+ * Parameters:
+ *         i: filters[] index of the filter.
+ *     frame: Frame to process.
+ * Return value:
+ *     None.
+ */
+
+static void call_filter(int i, frame_list_t *frame)
+{
+#ifdef SUPPORT_NMS
+# error please write NMS support code
+#endif
+
+#ifdef SUPPORT_CLASSIC
+    if (!filters[i].entry) {
+        tc_log_warn(__FILE__, "Filter %s (%d) missing entry function"
+                    " (bug?), disabling", filters[i].name, filters[i].id);
+        filters[i].enabled = 0;
+        return;
+    }
+    frame->filter_id = filters[i].id;
+    /* Shared frames are read-only (see tcframes.h); filters which
+     * don't know about them get a private copy to work on. */
+    if ((frame->tag & TC_VIDEO) && !filters[i].shares)
+        tc_unshare_video_frame((vframe_list_t *)frame);
+    /* Filters which keep per-instance state across frames can't cope
+     * with the frame threads calling them concurrently, so only let
+     * one frame at a time through unless the filter says otherwise. */
+    if (filters[i].reentrant) {
+        uint64_t start = tc_latency_now();
+        filters[i].entry(frame, NULL);
+        tc_latency_record(filters[i].stage, start);
+    } else {
+        uint64_t start = 0;
+        tc_mutex_lock(&filters[i].lock);
+        start = tc_latency_now();
+        filters[i].entry(frame, NULL);
+        tc_latency_record(filters[i].stage, start);
+        tc_mutex_unlock(&filters[i].lock);
+    }
+#endif
+}
+
+/*************************************************************************/
+
 /**
  * tc_filter_process:  Sends the given frame to all enabled filters for
  * processing.
@@ -164,7 +305,7 @@ void tc_filter_fini(void)
 
 void tc_filter_process(frame_list_t *frame)
 {
-    int last_id;
+    int i, last_id = 0;
 
     CHECK_INITIALIZED();
     if (!frame) {
@@ -172,43 +313,59 @@ void tc_filter_process(frame_list_t *frame)
         return;
     }
 
-    /* The order of the filters is given by their ID values--however, this
-     * does not necessarily match the order in the filters[] array.  We
-     * keep track of the last ID processed (starting at 0, lower than any
-     * valid ID), then each time through the loop, search for the lowest ID
-     * greater than that value, which will be the next filter to process.
-     * The loop ends when no enabled filter has an ID greater than the last
-     * ID processed. */
+    while ((i = next_filter(last_id)) >= 0) {
+        last_id = filters[i].id;
+        call_filter(i, frame);
+    }
+}
 
-    last_id = 0;
-    for (;;) {
-        int next_filter = -1, i;
+/*************************************************************************/
 
-        for (i = 0; i < MAX_FILTERS; i++) {
-            if (filters[i].id <= last_id || !filters[i].enabled)
-                continue;
-            if (next_filter < 0 || filters[i].id < filters[next_filter].id)
-                next_filter = i;
-        }
-        if (next_filter < 0)
-            break;
-        last_id = filters[next_filter].id;
+/**
+ * tc_filter_drain:  At end of stream, asks the enabled filters for one of
+ * the frames they still hold back (e.g. for lookahead).  Filters are asked
+ * in chain order with a tag of TC_FILTER_DRAIN plus the media type, and
+ * the frame marked as skipped; a filter which has a frame left fills it
+ * in and clears TC_FRAME_IS_SKIPPED.  The frame is then sent to the rest
+ * of the chain with the original tag, as in tc_filter_process().  The
+ * core only drains the TC_POST_S_PROCESS stage, so filters holding back
+ * frames must do it there.
+ *
+ * Parameters:
+ *     frame: Frame buffer to fill; frame->tag gives the media type and
+ *            the processing stage the frame continues with.
+ * Return value:
+ *     Nonzero if a filter gave out a frame (the rest of the chain may
+ *     still skip it), zero when all filters are drained.
+ */
 
-#ifdef SUPPORT_NMS
-# error please write NMS support code
-#endif
+int tc_filter_drain(frame_list_t *frame)
+{
+    int i, tag, last_id = 0;
 
-#ifdef SUPPORT_CLASSIC
-        if (!filters[next_filter].entry) {
-            tc_log_warn(__FILE__, "Filter %s (%d) missing entry function"
-                        " (bug?), disabling", filters[i].name, last_id);
-            filters[next_filter].enabled = 0;
-            continue;
+    CHECK_INITIALIZED(0);
+    if (!frame) {
+        tc_log_warn(__FILE__, "tc_filter_drain: frame is NULL!");
+        return 0;
+    }
+
+    tag = frame->tag;
+    while ((i = next_filter(last_id)) >= 0) {
+        last_id = filters[i].id;
+        frame->tag = (tag & (TC_VIDEO|TC_AUDIO)) | TC_FILTER_DRAIN;
+        frame->attributes |= TC_FRAME_IS_SKIPPED;
+        call_filter(i, frame);
+        if (!(frame->attributes & TC_FRAME_IS_SKIPPED)) {
+            frame->tag = tag;
+            while ((i = next_filter(last_id)) >= 0) {
+                last_id = filters[i].id;
+                call_filter(i, frame);
+            }
+            return 1;
         }
-        frame->filter_id = last_id;
-        filters[next_filter].entry(frame, NULL);
-#endif
-    }  // for (;;)
+    }
+    frame->tag = tag;
+    return 0;
 }
 
 /*************************************************************************/
@@ -226,6 +383,7 @@ void tc_filter_process(frame_list_t *frame)
 
 int tc_filter_add(const char *name, const char *options)
 {
+    char stage_name[MAX_FILTER_NAME_LEN+32];
     int i, id;
 
     CHECK_INITIALIZED(0);
@@ -267,6 +425,11 @@ int tc_filter_add(const char *name, const char *options)
     }
     strlcpy(filters[i].name, name, sizeof(filters[i].name));
     filters[i].enabled = 0;
+    filters[i].reentrant = 0;
+    filters[i].shares = 0;
+    filters[i].reports = 0;
+    filters[i].unchanged = 0;
+    filters[i].stage = -1;
 
 #ifdef SUPPORT_NMS
 # error please write NMS support code
@@ -276,6 +439,7 @@ int tc_filter_add(const char *name, const char *options)
     {
         char path[1000];
         frame_list_t dummy_frame;
+        const TCModuleClass *(*setup)(void) = NULL;
 
         /* Load the module and look up the tc_filter() address */
         if (tc_snprintf(path, sizeof(path), "%s/filter_%s.so",
@@ -305,6 +469,21 @@ int tc_filter_add(const char *name, const char *options)
         if (verbose >= TC_DEBUG)
             tc_log_msg(__FILE__, "tc_filter_add: module %s loaded", path);
 
+        /* Modules already ported to the new module system carry their
+         * capabilities in the class descriptor; trust those to tell us
+         * whether the frame threads may run them in parallel. */
+        setup = dlsym(filters[i].handle, "tc_plugin_setup");
+        if (setup) {
+            const TCModuleClass *klass = setup();
+            if (klass && klass->info
+             && (klass->info->flags & TC_MODULE_FLAG_REENTRANT)) {
+                filters[i].reentrant = 1;
+            }
+        }
+        if (verbose >= TC_DEBUG)
+            tc_log_msg(__FILE__, "tc_filter_add: filter %s is %sreentrant",
+                       name, filters[i].reentrant ? "" : "not ");
+
         /* Call tc_filter() to initialize the module */
         dummy_frame.filter_id = id;
         dummy_frame.tag = TC_FILTER_INIT;
@@ -322,6 +501,14 @@ int tc_filter_add(const char *name, const char *options)
 #endif  // SUPPORT_CLASSIC
 
     /* Module was successfully loaded and initialized, so enable it */
+    if (filters[i].id == id) {
+        filters[i].shares = filter_has_cap(tc_filter_get_conf(id, NULL), 'S');
+        if (verbose >= TC_DEBUG)
+            tc_log_msg(__FILE__, "tc_filter_add: filter %s %s shared frames",
+                       name, filters[i].shares ? "handles" : "copies");
+    }
+    tc_snprintf(stage_name, sizeof(stage_name), "filter.%s#%d", name, id);
+    filters[i].stage = tc_latency_stage_add(stage_name);
     filters[i].enabled = 1;
     return 1;
 }
@@ -393,6 +580,10 @@ void tc_filter_remove(int id)
     memset(filters[i].name, 0, sizeof(filters[i].name));
     filters[i].id = 0;
     filters[i].enabled = 0;
+    filters[i].reentrant = 0;
+    filters[i].shares = 0;
+    filters[i].reports = 0;
+    filters[i].unchanged = 0;
 }
 
 /*************************************************************************/
@@ -469,6 +660,7 @@ int tc_filter_configure(int id, const char *options)
 #ifdef SUPPORT_CLASSIC
     {
         frame_list_t dummy_frame;
+        int ret;
 
         if (!filters[i].entry) {
             tc_log_warn(__FILE__, "Filter %s (%d) missing entry function"
@@ -477,6 +669,7 @@ int tc_filter_configure(int id, const char *options)
             return 0;
         }
         /* Old filter API does a close before reconfiguring */
+        tc_mutex_lock(&filters[i].lock);
         dummy_frame.filter_id = id;
         dummy_frame.tag = TC_FILTER_CLOSE;
         filters[i].entry(&dummy_frame, NULL);
@@ -484,7 +677,9 @@ int tc_filter_configure(int id, const char *options)
         dummy_frame.tag = TC_FILTER_INIT;
         dummy_frame.size = 0;
         /* XXX: it seems never used, so 0 should be safe -- FR */
-        if (filters[i].entry(&dummy_frame, (char *)options) < 0) {
+        ret = filters[i].entry(&dummy_frame, (char *)options);
+        tc_mutex_unlock(&filters[i].lock);
+        if (ret < 0) {
             tc_log_warn(PACKAGE, "Reconfiguration of filter %s failed,"
                         " disabling.", filters[i].name);
             filters[i].enabled = 0;
@@ -592,6 +787,79 @@ const char *tc_filter_list(enum tc_filter_list_enum what)
 
 /*************************************************************************/
 
+/**
+ * tc_filter_set_settle:  Set the number of consecutive frames without a
+ * change in their results after which analysis filters (those calling
+ * tc_filter_report()) are considered settled.  Once every such filter has
+ * settled, the run is stopped.
+ *
+ * Parameters:
+ *     frames: Number of unchanged frames; zero disables the early stop.
+ * Return value:
+ *     None.
+ */
+
+void tc_filter_set_settle(int frames)
+{
+    settle_frames = (frames > 0) ? frames : 0;
+}
+
+/*************************************************************************/
+
+/**
+ * tc_filter_report:  Called by an analysis filter after each frame to say
+ * whether the frame changed the filter's result (detected borders, levels,
+ * field order and the like).  When the results of all reporting filters
+ * have stayed unchanged for the number of frames set with
+ * tc_filter_set_settle(), further frames cannot be expected to tell
+ * anything new, so the run is stopped.
+ *
+ * Parameters:
+ *          id: ID of the reporting filter (frame->filter_id).
+ *     changed: Nonzero if the frame changed the filter's result.
+ * Return value:
+ *     None.
+ */
+
+void tc_filter_report(int id, int changed)
+{
+    int i, done = 1;
+
+    CHECK_INITIALIZED();
+    if ((i = id_to_index(id, __FUNCTION__)) < 0)
+        return;
+
+    tc_mutex_lock(&settle_lock);
+    filters[i].reports = 1;
+    if (changed)
+        filters[i].unchanged = 0;
+    else
+        filters[i].unchanged++;
+    if (!settle_frames || settled) {
+        done = 0;
+    } else {
+        for (i = 0; i < MAX_FILTERS; i++) {
+            if (filters[i].id && filters[i].enabled && filters[i].reports
+             && filters[i].unchanged < settle_frames) {
+                done = 0;
+                break;
+            }
+        }
+    }
+    if (done)
+        settled = 1;
+    tc_mutex_unlock(&settle_lock);
+
+    if (done) {
+        tc_log_info(PACKAGE, "analysis results unchanged for %d frames,"
+                    " stopping", settle_frames);
+        tc_stop();
+        tc_framebuffer_interrupt();
+    }
+}
+
+/*************************************************************************/
+
 /*
  * Local variables:
  *   c-file-style: "stroustrup"
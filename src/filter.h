@@ -33,6 +33,7 @@ enum tc_filter_list_enum {
 extern int tc_filter_init(void);
 extern void tc_filter_fini(void);
 extern void tc_filter_process(frame_list_t *frame);
+extern int tc_filter_drain(frame_list_t *frame);
 extern int tc_filter_add(const char *name, const char *options);
 extern int tc_filter_find(const char *name);
 extern void tc_filter_remove(int id);
@@ -41,6 +42,8 @@ extern int tc_filter_disable(int id);
 extern int tc_filter_configure(int id, const char *options);
 extern const char *tc_filter_get_conf(int id, const char *option);
 extern const char *tc_filter_list(enum tc_filter_list_enum what);
+extern void tc_filter_set_settle(int frames);
+extern void tc_filter_report(int id, int changed);
 
 /* Type of the exported module entry point for the old module system, and a
  * prototype for tc_filter() for those modules. */
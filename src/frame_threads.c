@@ -42,19 +42,30 @@
 typedef struct tcframethreaddata_ TCFrameThreadData;
 struct tcframethreaddata_ {
     TCThread     threads[TC_FRAME_THREADS_MAX]; /* thread pool        */
-    int          count;                         /* how many workers?  */
+    int          alive[TC_FRAME_THREADS_MAX];   /* not retired yet?   */
+    int          count;                         /* threads[] used     */
+    int          active;                        /* how many workers?  */
+    TCThreadBodyFn body;
+    vob_t        *vob;
 
     TCMutex      lock;
     volatile int running;                       /* POOL running flag  */
 };
 
+static int process_video_frame(TCThreadData *td, void *_vob);
+static int process_audio_frame(TCThreadData *td, void *_vob);
+
 TCFrameThreadData audio_threads = {
     .count   = 0,
+    .active  = 0,
+    .body    = process_audio_frame,
     .running = TC_FALSE,
 };
 
 TCFrameThreadData video_threads = {
     .count   = 0,
+    .active  = 0,
+    .body    = process_video_frame,
     .running = TC_FALSE,
 };
 
@@ -101,6 +112,36 @@ static int tc_frame_threads_are_active(TCFrameThreadData *data)
     return ret;
 }
 
+/*
+ * tc_frame_threads_retired (Thread safe):
+ * verify if the calling thread was left out of its pool by a resize,
+ * and mark it as gone if so.
+ *
+ * Parameters:
+ *      data: thread pool descriptor.
+ *        td: thread data of the calling thread.
+ * Return Value:
+ *      !0: the thread has to exit.
+ *       0: the thread is still part of the pool.
+ */
+static int tc_frame_threads_retired(TCFrameThreadData *data,
+                                    TCThreadData *td)
+{
+    int n = 0, ret = TC_FALSE;
+    tc_mutex_lock(&data->lock);
+    for (n = 0; n < data->count; n++) {
+        if (&data->threads[n].data == td) {
+            if (n >= data->active) {
+                data->alive[n] = TC_FALSE;
+                ret = TC_TRUE;
+            }
+            break;
+        }
+    }
+    tc_mutex_unlock(&data->lock);
+    return ret;
+}
+
 /*
  * stop_requested: verify if the pool thread has to stop.
  * First thread in the pool notifying the core has to stop must
@@ -108,13 +149,16 @@ static int tc_frame_threads_are_active(TCFrameThreadData *data)
  *
  * Parameters:
  *      data: thread pool descriptor.
+ *        td: thread data of the calling thread.
  * Return Value:
- *      !0: thread pool has to halt as soon as is possible.
+ *      !0: thread pool (or just this thread) has to halt as soon as
+ *          is possible.
  *       0: thread pool can continue to run.
  */
-static int stop_requested(TCFrameThreadData *data)
+static int stop_requested(TCFrameThreadData *data, TCThreadData *td)
 {
-    return (!tc_running() || !tc_frame_threads_are_active(data));
+    return (!tc_running() || !tc_frame_threads_are_active(data)
+            || tc_frame_threads_retired(data, td));
 }
 
 
@@ -177,7 +221,7 @@ static int process_video_frame(TCThreadData *td, void *_vob)
     vob_t *vob = _vob;
     int res = 0;
 
-    while (!stop_requested(&video_threads)) {
+    while (!stop_requested(&video_threads, td)) {
         ptr = vframe_reserve();
         if (ptr == NULL) {
             SET_STOP_FLAG(&video_threads, "video interrupted: exiting!");
@@ -234,7 +278,7 @@ static int process_audio_frame(TCThreadData *td, void *_vob)
     vob_t *vob = _vob;
     int res = 0;
 
-    while (!stop_requested(&audio_threads)) {
+    while (!stop_requested(&audio_threads, td)) {
         ptr = aframe_reserve();
         if (ptr == NULL) {
             SET_STOP_FLAG(&audio_threads, "audio interrupted: exiting!");
@@ -286,6 +330,97 @@ static int process_audio_frame(TCThreadData *td, void *_vob)
 /*************************************************************************/
 
 
+/*
+ * start_pool_thread: (re)start the thread in the given slot of a pool.
+ * A former thread in the slot, if any, must have been waited for.
+ */
+static int start_pool_thread(TCFrameThreadData *data, int n)
+{
+    if (tc_thread_start(&(data->threads[n]), data->body, data->vob) != 0) {
+        return TC_ERROR;
+    }
+    data->alive[n] = TC_TRUE;
+    return TC_OK;
+}
+
+/*
+ * resize_pool: change the number of workers of a running pool.
+ * Workers in excess are retired when they finish their current frame;
+ * slots whose thread is already gone are reaped and reused.
+ */
+static int resize_pool(TCFrameThreadData *data, int workers,
+                       const char *tag)
+{
+    int n = 0, ret = TC_OK;
+
+    if (data->count == 0 || workers < 1 || workers > TC_FRAME_THREADS_MAX) {
+        return TC_ERROR; /* frames are processed inline, or bad count */
+    }
+
+    tc_mutex_lock(&data->lock);
+    if (!data->running) {
+        tc_mutex_unlock(&data->lock);
+        return TC_ERROR;
+    }
+    data->active = workers;
+    for (n = 0; n < workers; n++) {
+        if (n < data->count && data->alive[n]) {
+            continue; /* still running, maybe was retiring */
+        }
+        if (n < data->count) {
+            tc_thread_wait(&(data->threads[n]), NULL);
+        }
+        if (start_pool_thread(data, n) != TC_OK) {
+            tc_log_warn(__FILE__, "failed to start %s frame processing"
+                                  " thread #%i", tag, n);
+            data->active = n;
+            ret = TC_ERROR;
+            break;
+        }
+        if (n >= data->count) {
+            data->count = n + 1;
+        }
+    }
+    tc_mutex_unlock(&data->lock);
+
+    if (verbose >= TC_DEBUG) {
+        tc_log_info(__FILE__, "now using %i %s frame processing"
+                              " thread(s)", data->active, tag);
+    }
+    return ret;
+}
+
+static int pool_size(TCFrameThreadData *data)
+{
+    int n;
+    tc_mutex_lock(&data->lock);
+    n = (data->running) ?data->active :0;
+    tc_mutex_unlock(&data->lock);
+    return n;
+}
+
+int tc_frame_threads_set_workers(int media, int workers)
+{
+    if (media == TC_VIDEO) {
+        return resize_pool(&video_threads, workers, "video");
+    }
+    if (media == TC_AUDIO) {
+        return resize_pool(&audio_threads, workers, "audio");
+    }
+    return TC_ERROR;
+}
+
+int tc_frame_threads_get_workers(int media)
+{
+    if (media == TC_VIDEO) {
+        return pool_size(&video_threads);
+    }
+    if (media == TC_AUDIO) {
+        return pool_size(&audio_threads);
+    }
+    return 0;
+}
+
 int tc_frame_threads_have_video_workers(void)
 {
     return (video_threads.count > 0);
@@ -305,6 +440,8 @@ void tc_frame_threads_init(vob_t *vob, int vworkers, int aworkers)
 
     if (vworkers > 0 && !video_threads.running) {
         video_threads.count   = vworkers;
+        video_threads.active  = vworkers;
+        video_threads.vob     = vob;
         video_threads.running = TC_TRUE; /* enforce, needed when restarting */
 
         if (verbose >= TC_DEBUG)
@@ -313,14 +450,15 @@ void tc_frame_threads_init(vob_t *vob, int vworkers, int aworkers)
 
         // start the thread pool
         for (n = 0; n < vworkers; n++) {
-            if (tc_thread_start(&(video_threads.threads[n]),
-                                process_video_frame, vob) != 0)
+            if (start_pool_thread(&video_threads, n) != TC_OK)
                 tc_error("failed to start video frame processing thread");
         }
     }
 
     if (aworkers > 0 && !audio_threads.running) {
         audio_threads.count   = aworkers;
+        audio_threads.active  = aworkers;
+        audio_threads.vob     = vob;
         audio_threads.running = TC_TRUE; /* enforce, needed when restarting */
 
         if (verbose >= TC_DEBUG)
@@ -329,8 +467,7 @@ void tc_frame_threads_init(vob_t *vob, int vworkers, int aworkers)
 
         // start the thread pool
         for (n = 0; n < aworkers; n++) {
-            if (tc_thread_start(&(audio_threads.threads[n]),
-                                process_audio_frame, vob) != 0)
+            if (start_pool_thread(&audio_threads, n) != TC_OK)
                 tc_error("failed to start audio frame processing thread");
         }
     }
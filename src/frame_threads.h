@@ -32,7 +32,8 @@
  *
  * Those are the frame processing threads, implementing the threaded
  * filter layer. There isn't direct control to those threads. They
- * start to run after init(), and they are stopped by fini().
+ * start to run after init(), and they are stopped by fini(); in the
+ * meantime the size of each pool can be changed.
  * It is important to note that each thread is equivalent to each
  * other, and each one will take care of one frame and applies to
  * it the whole filter chain.
@@ -81,4 +82,31 @@ void tc_frame_threads_close(void);
 int tc_frame_threads_have_video_workers(void);
 int tc_frame_threads_have_audio_workers(void);
 
+/*
+ * tc_frame_threads_set_workers: change the number of threads of
+ * a running filter pool. New threads start at once; threads in excess
+ * exit as soon as they are done with the frame they are processing.
+ * Pools started with no threads can't be resized, since their frames
+ * are filtered by the import and export layers themselves.
+ *
+ * Parameters:
+ *        media: TC_VIDEO or TC_AUDIO, pool to resize.
+ *      workers: new number of threads, up to TC_FRAME_THREADS_MAX.
+ * Return Value:
+ *      TC_OK: succesfull.
+ *      TC_ERROR: pool not running or bad number of threads.
+ */
+int tc_frame_threads_set_workers(int media, int workers);
+
+/*
+ * tc_frame_threads_get_workers: query the number of threads of
+ * a filter pool, as set by the last init() or set_workers().
+ *
+ * Parameters:
+ *      media: TC_VIDEO or TC_AUDIO.
+ * Return Value:
+ *      number of threads, 0 if the pool is not running.
+ */
+int tc_frame_threads_get_workers(int media);
+
 #endif /* FRAME_THREADS_H */
@@ -515,6 +515,11 @@ STATIC TCFramePtr tc_frame_pool_get_frame(TCFramePool *P)
 
     P->waiting++;
     while (!interrupted && tc_frame_queue_empty(P->queue)) {
+        if (!tc_running()) {
+            /* the wakeup was already broadcast, don't miss it */
+            interrupted = TC_TRUE;
+            break;
+        }
         tc_debug(TC_DEBUG_THREADS,
                  "(%s|get_frame|%s|%s|0x%X) blocking (no frames in pool)",
                  FPOOL_NAME,
@@ -587,6 +592,10 @@ struct tcframering_ {
 
     TCFramePtr          *frames; /* main frame references */
     int                 size;    /* how many of them? */
+    /* the following are protected by the lock of the `NULL' pool */
+    int                 capacity;   /* room in `frames' and in the pools */
+    int                 count;      /* frames currently allocated */
+    int                 target;     /* frames wanted (see resize) */
 
     TCFramePool         pools[TC_FRAME_STAGE_NUM];
 
@@ -670,7 +679,9 @@ static void tc_frame_ring_dump_status(TCFrameRing *rfb,
  *     specs: frame specifications to use for allocation.
  *     alloc: frame allocation function to use.
  *      free: frame disposal function to use.
- *      size: size of ringbuffer (number of frame to allocate)
+ *      size: size of ringbuffer (number of frame to allocate);
+ *            room is reserved to grow it up to TC_FRAME_BUFFER_MAX
+ *            frames later (see tc_frame_ring_resize).
  * Return Value:
  *      > 0: wrong (NULL) parameters
  *        0: succesfull
@@ -683,31 +694,35 @@ static int tc_frame_ring_init(TCFrameRing *rfb,
                               TCFrameFreeFn free,
                               int size)
 {
-    int i = 0;
+    int i = 0, capacity = 0;
 
     if (rfb == NULL   || specs == NULL || size < 0
      || alloc == NULL || free == NULL) {
         return 1;
     }
     size = (size > 0) ?size :1; /* allocate at least one frame */
+    capacity = (size > TC_FRAME_BUFFER_MAX) ?size :TC_FRAME_BUFFER_MAX;
 
-    rfb->frames = tc_malloc(size * sizeof(TCFramePtr));
+    rfb->frames = tc_zalloc(capacity * sizeof(TCFramePtr));
     if (rfb->frames == NULL) {
         return -1;
     }
 
-    rfb->tag   = tag;
-    rfb->size  = size;
-    rfb->specs = specs;
-    rfb->alloc = alloc;
-    rfb->free  = free;
+    rfb->tag      = tag;
+    rfb->size     = size;
+    rfb->capacity = capacity;
+    rfb->count    = size;
+    rfb->target   = size;
+    rfb->specs    = specs;
+    rfb->alloc    = alloc;
+    rfb->free     = free;
 
     /* first, warm up the pools */
     for (i = 0; i < TC_FRAME_STAGE_NUM; i++) {
         TCFrameStatus S = TC_FRAME_STAGE_ST(i);
         const char *name = frame_status_name(S);
 
-        int err = tc_frame_pool_init(&(rfb->pools[i]), size,
+        int err = tc_frame_pool_init(&(rfb->pools[i]), capacity,
                                      (S == TC_FRAME_READY),
                                      name, tag);
         
@@ -769,6 +784,9 @@ static void tc_frame_ring_fini(TCFrameRing *rfb)
         }
    
         for (i = 0; i < rfb->size; i++) {
+            if (TCFRAMEPTR_IS_NULL(rfb->frames[i])) {
+                continue; /* retired by a resize */
+            }
             tc_debug(TC_DEBUG_CLEANUP,
                      "(%s|fini|%s) freeing frame #%i in [%s] status",
                      FRING_NAME, rfb->tag, i,
@@ -779,6 +797,44 @@ static void tc_frame_ring_fini(TCFrameRing *rfb)
     }
 }
 
+/*
+ * tc_frame_ring_alloc_frame (NOT thread safe, lock of the `NULL' pool
+ * must be held):
+ *      allocate a new framebuffer into the first free slot of the
+ *      ringbuffer, in TC_FRAME_NULL status. The new frame is counted
+ *      but not queued anywhere.
+ *
+ * Parameters:
+ *      rfb: ring framebuffer to use.
+ * Return Value:
+ *      generic pointer to the new framebuffer, pointing to NULL
+ *      if the ringbuffer is full or the allocation failed.
+ */
+static TCFramePtr tc_frame_ring_alloc_frame(TCFrameRing *rfb)
+{
+    TCFramePtr ptr = { .generic = NULL };
+    int i = 0;
+
+    for (i = 0; i < rfb->capacity; i++) {
+        if (TCFRAMEPTR_IS_NULL(rfb->frames[i])) {
+            break;
+        }
+    }
+    if (i < rfb->capacity) {
+        ptr = rfb->alloc(rfb->specs);
+    }
+    if (!TCFRAMEPTR_IS_NULL(ptr)) {
+        ptr.generic->bufid  = i;
+        ptr.generic->status = TC_FRAME_NULL;
+        rfb->frames[i] = ptr;
+        rfb->count++;
+        if (i >= rfb->size) {
+            rfb->size = i + 1;
+        }
+    }
+    return ptr;
+}
+
 /*
  * tc_frame_ring_register_frame:
  *      retrieve and register a framebuffer from a ringbuffer by
@@ -830,6 +886,41 @@ static TCFramePtr tc_frame_ring_register_frame(TCFrameRing *rfb,
     return ptr; 
 }
 
+/*
+ * tc_frame_ring_register_clone:
+ *      register a framebuffer for a clone of a frame held by the caller.
+ *      If no framebuffer is free, they are all claimed by the stages
+ *      feeding the caller, which would wait for it forever: a spare one
+ *      is lent instead, within the capacity of the ringbuffer, and it
+ *      is retired as soon as a frame is removed (see remove_frame).
+ *
+ * Parameters:
+ *      rfb: ring framebuffer to use.
+ * Return Value:
+ *      Generic pointer to a framebuffer in TC_FRAME_WAIT status; as
+ *      for register_frame, it can point to NULL on interruption.
+ */
+static TCFramePtr tc_frame_ring_register_clone(TCFrameRing *rfb)
+{
+    TCFramePool *NP = tc_frame_ring_get_pool(rfb, TC_FRAME_NULL);
+    TCFramePtr ptr = { .generic = NULL };
+
+    tc_mutex_lock(&NP->lock);
+    if (tc_frame_queue_empty(NP->queue)) {
+        ptr = tc_frame_ring_alloc_frame(rfb);
+    }
+    tc_mutex_unlock(&NP->lock);
+
+    if (TCFRAMEPTR_IS_NULL(ptr)) {
+        return tc_frame_ring_register_frame(rfb, 0, TC_FRAME_WAIT);
+    }
+    tc_debug(TC_DEBUG_FLIST,
+             "(%s|register_clone|%s) spare frame #%i lent",
+             FRING_NAME, rfb->tag, ptr.generic->bufid);
+    ptr.generic->status = TC_FRAME_WAIT;
+    return ptr;
+}
+
 /*
  * tc_frame_ring_remove_frame:
  *      De-register and release a given framebuffer;
@@ -849,6 +940,26 @@ static void tc_frame_ring_remove_frame(TCFrameRing *rfb,
                                        TCFramePtr frame)
 {
     if (rfb != NULL && !TCFRAMEPTR_IS_NULL(frame)) {
+        TCFramePool *NP = tc_frame_ring_get_pool(rfb, TC_FRAME_NULL);
+        int retire = TC_FALSE;
+
+        tc_mutex_lock(&NP->lock);
+        if (rfb->count > rfb->target) {
+            /* the ring is shrinking: this frame goes away */
+            rfb->frames[frame.generic->bufid].generic = NULL;
+            rfb->count--;
+            retire = TC_TRUE;
+        }
+        tc_mutex_unlock(&NP->lock);
+
+        if (retire) {
+            tc_debug(TC_DEBUG_FLIST,
+                     "(%s|remove_frame|%s) frame #%i retired",
+                     FRING_NAME, rfb->tag, frame.generic->bufid);
+            rfb->free(frame);
+            return;
+        }
+
         /* release valid pointer to pool */
         tc_frame_ring_put_frame(rfb, TC_FRAME_NULL, frame);
 
@@ -884,7 +995,12 @@ static int tc_frame_ring_flush(TCFrameRing *rfb)
     TCFramePool *NP = tc_frame_ring_get_pool(rfb, TC_FRAME_NULL);
 
     for (i = 0; i < rfb->size; i++) {
-        TCFrameStatus S = rfb->frames[i].generic->status;
+        TCFrameStatus S;
+
+        if (TCFRAMEPTR_IS_NULL(rfb->frames[i])) {
+            continue; /* retired by a resize */
+        }
+        S = rfb->frames[i].generic->status;
 
         if (S == TC_FRAME_NULL) {
             /* 99% of times we don't want to see this. */
@@ -916,6 +1032,128 @@ static int tc_frame_ring_flush(TCFrameRing *rfb)
     return n;
 }
 
+/*
+ * tc_frame_ring_resize (Thread safe):
+ *      change the number of frames circulating in the ringbuffer
+ *      while it is in use. Growing allocates the missing frames and
+ *      makes them immediately available; shrinking frees the frames
+ *      currently unclaimed, and every other frame in excess as soon
+ *      as it is released.
+ *
+ * Parameters:
+ *       rfb: ring framebuffer to use.
+ *      size: new number of frames, between 1 and the capacity of
+ *            the ringbuffer.
+ * Return Value:
+ *      TC_OK: succesfull.
+ *      TC_ERROR: bad size or allocation failed (the ringbuffer is
+ *                left with the frames allocated so far).
+ */
+static int tc_frame_ring_resize(TCFrameRing *rfb, int size)
+{
+    TCFramePool *NP = tc_frame_ring_get_pool(rfb, TC_FRAME_NULL);
+    TCFramePtr ptr;
+    int ret = TC_OK;
+
+    if (rfb->frames == NULL || size < 1 || size > rfb->capacity) {
+        return TC_ERROR;
+    }
+
+    tc_mutex_lock(&NP->lock);
+    rfb->target = size;
+
+    while (rfb->count < rfb->target) {
+        ptr = tc_frame_ring_alloc_frame(rfb);
+        if (TCFRAMEPTR_IS_NULL(ptr)) {
+            tc_log_warn(FRING_NAME, "(resize|%s) failed frame allocation",
+                        rfb->tag);
+            ret = TC_ERROR;
+            break;
+        }
+        tc_frame_queue_put(NP->queue, ptr);
+    }
+    while (rfb->count > rfb->target && !tc_frame_queue_empty(NP->queue)) {
+        ptr = tc_frame_queue_get(NP->queue);
+        rfb->frames[ptr.generic->bufid].generic = NULL;
+        rfb->count--;
+        rfb->free(ptr);
+    }
+    if (NP->waiting) {
+        tc_condition_broadcast(&NP->empty);
+    }
+
+    tc_debug(TC_DEBUG_FLIST, "(%s|resize|%s) size=%i count=%i",
+             FRING_NAME, rfb->tag, rfb->target, rfb->count);
+    tc_mutex_unlock(&NP->lock);
+    return ret;
+}
+
+static int tc_frame_ring_get_size(TCFrameRing *rfb)
+{
+    TCFramePool *NP = tc_frame_ring_get_pool(rfb, TC_FRAME_NULL);
+    int size;
+
+    if (rfb->frames == NULL) {
+        return 0;
+    }
+    tc_mutex_lock(&NP->lock);
+    size = rfb->target;
+    tc_mutex_unlock(&NP->lock);
+    return size;
+}
+
+#ifdef FBUF_TEST
+/*
+ * tc_frame_ring_check (NOT thread safe):
+ *      verify that every frame of the ringbuffer sits in the slot given
+ *      by its buffer id, and in no other one.
+ *
+ * Parameters:
+ *      rfb: ring framebuffer to check.
+ * Return Value:
+ *      number of inconsistencies found (0 if none).
+ */
+static int tc_frame_ring_check(TCFrameRing *rfb)
+{
+    int i, j, n = 0, bad = 0;
+
+    for (i = 0; i < rfb->size; i++) {
+        if (TCFRAMEPTR_IS_NULL(rfb->frames[i])) {
+            continue;
+        }
+        n++;
+        if (rfb->frames[i].generic->bufid != i) {
+            tc_log_warn(FRING_NAME, "(check|%s) frame #%i has bufid=%i",
+                        rfb->tag, i, rfb->frames[i].generic->bufid);
+            bad++;
+        }
+        for (j = i + 1; j < rfb->size; j++) {
+            if (rfb->frames[j].generic == rfb->frames[i].generic) {
+                tc_log_warn(FRING_NAME, "(check|%s) frame #%i also in #%i",
+                            rfb->tag, i, j);
+                bad++;
+            }
+        }
+    }
+    if (n != rfb->count) {
+        tc_log_warn(FRING_NAME, "(check|%s) %i frames in slots, count=%i",
+                    rfb->tag, n, rfb->count);
+        bad++;
+    }
+    return bad;
+}
+
+int vframe_check(void)
+{
+    return tc_frame_ring_check(&tc_video_ringbuffer);
+}
+
+int aframe_check(void)
+{
+    return tc_frame_ring_check(&tc_audio_ringbuffer);
+}
+#endif
+
 #define TC_FRAME_STAGE_ALL (-1)
 
 static void tc_frame_ring_wakeup(TCFrameRing *rfb, int stage)
@@ -974,6 +1212,26 @@ int vframe_alloc(int num)
                               tc_video_alloc, tc_video_free, num);
 }
 
+int aframe_resize(int num)
+{
+    return tc_frame_ring_resize(&tc_audio_ringbuffer, num);
+}
+
+int vframe_resize(int num)
+{
+    return tc_frame_ring_resize(&tc_video_ringbuffer, num);
+}
+
+int aframe_get_size(void)
+{
+    return tc_frame_ring_get_size(&tc_audio_ringbuffer);
+}
+
+int vframe_get_size(void)
+{
+    return tc_frame_ring_get_size(&tc_video_ringbuffer);
+}
+
 void aframe_free(void)
 {
     tc_frame_ring_fini(&tc_audio_ringbuffer);
@@ -994,12 +1252,10 @@ aframe_list_t *aframe_dup(aframe_list_t *f)
         return NULL;
     }
 
-    frame = tc_frame_ring_register_frame(&tc_audio_ringbuffer,
-                                         0, TC_FRAME_WAIT);
+    frame = tc_frame_ring_register_clone(&tc_audio_ringbuffer);
     if (!TCFRAMEPTR_IS_NULL(frame)) {
+        /* the caller queues it with aframe_push_next */
         aframe_copy(frame.audio, f, 1);
-        tc_frame_ring_put_frame(&tc_audio_ringbuffer,
-                                TC_FRAME_WAIT, frame);
     }
     return frame.audio;
 }
@@ -1013,12 +1269,17 @@ vframe_list_t *vframe_dup(vframe_list_t *f)
         return NULL;
     }
 
-    frame = tc_frame_ring_register_frame(&tc_video_ringbuffer,
-                                         0, TC_FRAME_WAIT);
+    frame = tc_frame_ring_register_clone(&tc_video_ringbuffer);
     if (!TCFRAMEPTR_IS_NULL(frame)) {
-        vframe_copy(frame.video, f, 1);
-        tc_frame_ring_put_frame(&tc_video_ringbuffer,
-                                TC_FRAME_WAIT, frame);
+        /* both frames show the same picture until one is modified */
+        TCFramePayload *pl = tc_hold_video_frame(f);
+
+        vframe_copy(frame.video, f, (pl == NULL));
+        if (pl != NULL) {
+            tc_share_video_frame(frame.video, pl);
+            tc_release_payload(pl);
+        }
+        /* the caller queues it with vframe_push_next */
     }
     return frame.video;
 }
@@ -1036,6 +1297,10 @@ vframe_list_t *vframe_register(int id)
 {
     TCFramePtr frame = tc_frame_ring_register_frame(&tc_video_ringbuffer,
                                                     id, TC_FRAME_EMPTY); 
+    if (!TCFRAMEPTR_IS_NULL(frame)) {
+        /* flushed frames may still show a shared payload */
+        tc_restore_video_frame(frame.video);
+    }
     return frame.video;
 }
 
@@ -1055,6 +1320,7 @@ void vframe_remove(vframe_list_t *ptr)
         tc_log_warn(FRBUF_NAME, "vframe_remove: given NULL frame pointer");
     } else {
         TCFramePtr frame = { .video = ptr };
+        tc_restore_video_frame(ptr);  /* give back any shared payload */
         tc_frame_ring_remove_frame(&tc_video_ringbuffer, frame);
     }
 }
@@ -1199,13 +1465,18 @@ int aframe_have_more(void)
 void aframe_copy(aframe_list_t *dst, const aframe_list_t *src,
                  int copy_data)
 {
+    int bufid;
+
     if (!dst || !src) {
         tc_log_warn(__FILE__, "aframe_copy: given NULL frame pointer");
     	return;
     }
 
-    /* copy all common fields with just one move */
+    /* copy all common fields with just one move, but the buffer id:
+     * dst keeps its own slot in the ringbuffer */
+    bufid = dst->bufid;
     ac_memcpy(dst, src, sizeof(frame_list_t));
+    dst->bufid = bufid;
     
     if (copy_data) {
         /* really copy video data */
@@ -1219,13 +1490,18 @@ void aframe_copy(aframe_list_t *dst, const aframe_list_t *src,
 void vframe_copy(vframe_list_t *dst, const vframe_list_t *src,
                  int copy_data)
 {
+    int bufid;
+
     if (!dst || !src) {
         tc_log_warn(__FILE__, "vframe_copy: given NULL frame pointer");
     	return;
     }
 
-    /* copy all common fields with just one move */
+    /* copy all common fields with just one move, but the buffer id:
+     * dst keeps its own slot in the ringbuffer */
+    bufid = dst->bufid;
     ac_memcpy(dst, src, sizeof(frame_list_t));
+    dst->bufid = bufid;
     
     dst->deinter_flag = src->deinter_flag;
     dst->free         = src->free;
@@ -176,6 +176,36 @@ void tc_framebuffer_interrupt_stage(TCFrameStatus S);
 int vframe_alloc(int num);
 int aframe_alloc(int num);
 
+/*
+ * vframe_resize, aframe_resize: (Thread safe)
+ *     change the number of frames of respectively the video or audio
+ *     ringbuffer while it is in use, up to TC_FRAME_BUFFER_MAX frames
+ *     (or the size given to vframe_alloc/aframe_alloc, if larger).
+ *     New frames are available at once; when shrinking, the frames in
+ *     excess are released as soon as they come back unused.
+ *
+ * Parameters:
+ *     num: new size of ringbuffer (number of framebuffers).
+ * Return Value:
+ *     TC_OK: succesfull
+ *     TC_ERROR: size out of range or frame allocation failed.
+ */
+int vframe_resize(int num);
+int aframe_resize(int num);
+
+/*
+ * vframe_get_size, aframe_get_size: (Thread safe)
+ *     get the size of respectively the video or audio ringbuffer, as set
+ *     by last vframe_alloc/aframe_alloc or vframe_resize/aframe_resize.
+ *
+ * Parameters:
+ *     None.
+ * Return Value:
+ *     number of framebuffers, 0 if the ringbuffer was not allocated.
+ */
+int vframe_get_size(void);
+int aframe_get_size(void);
+
 /*
  * vframe_alloc_single, aframe_alloc_single: (NOT thread safe)
  *     allocate a single framebuffer (respectively, video or audio)
@@ -335,6 +365,7 @@ TCFrameAudio *aframe_retrieve(void);
  * vframe_remove, aframe_remove: (thread safe)
  *     Respectively release an audio or video frame,
  *     by marking it as unused and putting it back on the frame pool.
+ *     A video frame gives back the payload it shares, if any.
  *
  *     Those function are (and should be) used at the end
  *     of the frame chain. Those should are the last function
@@ -398,9 +429,14 @@ void aframe_push_next(TCFrameAudio *ptr, TCFrameStatus status);
  * vframe_dup, aframe_dup: (thread safe)
  *     Frame claiming functions.
  *     Duplicate given respectively video or audio framebuffer.
- *     New framebuffer will be a full (deep) copy of old one
+ *     New audio framebuffer will be a full (deep) copy of old one
  *     (see aframe_copy/vframe_copy documentation to learn about
- *     deep copy).
+ *     deep copy). Video framebuffers share the picture instead
+ *     (see tc_hold_video_frame in tcframes.h): it is copied only
+ *     when one of them is modified.
+ *     The duplicate is claimed in TC_FRAME_WAIT status but it is not
+ *     queued yet: the caller has to hand it to {v,a}frame_push_next
+ *     (or to {v,a}frame_remove) once it is done with it.
  *
  * Parameters:
  *     f: framebuffer to be copied.
@@ -408,9 +444,12 @@ void aframe_push_next(TCFrameAudio *ptr, TCFrameStatus status);
  *     A valid pointer to respectively duplicate video or audio frame.
  *     If framebuffer is interrupted, both returns NULL.
  * Side Effects:
- *     Being frame claiming functions, those functions will block
+ *     Being frame claiming functions, those functions can block
  *     calling thread until a new frame will be avalaible, OR
- *     until an interruption happens.
+ *     until an interruption happens. As the caller holds the frame
+ *     to copy, if all the others are claimed too a spare frame is
+ *     allocated instead, and freed again once removed; they block
+ *     only if the ringbuffer is full up to TC_FRAME_BUFFER_MAX.
  */
 TCFrameVideo *vframe_dup(TCFrameVideo *f);
 TCFrameAudio *aframe_dup(TCFrameAudio *f);
@@ -515,6 +554,8 @@ typedef struct tcframepool_ TCFramePool;
 
 extern const char *frame_status_name(TCFrameStatus S);
 extern int is_heap(TCFrameQueue *Q, int debug);
+extern int vframe_check(void);
+extern int aframe_check(void);
 
 extern void tc_frame_queue_dump_status(TCFrameQueue *Q, const char *tag);
 extern void tc_frame_queue_del(TCFrameQueue *Q);
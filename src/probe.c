@@ -10,12 +10,15 @@
 
 #include "transcode.h"
 #include "probe.h"
+#include "probecache.h"
 #include "libtc/libtc.h"
 #include "libtc/tccodecs.h"
 #include "libtc/ratiocodes.h"
 #include "import/magic.h"
+#include "libtcutil/tcthread.h"
 
 #include <sys/wait.h>  // for waitpid()
+#include <fcntl.h>     // for FD_CLOEXEC
 
 /*************************************************************************/
 
@@ -23,11 +26,32 @@
  * particular field (pass the flag name without TC_PROBE_NO_): */
 #define MAY_SET(flagname)  (!(flags & TC_PROBE_NO_##flagname))
 
+/* Sources probed by a single tcprobe run, and maximum number of tcprobe
+ * runs in parallel, in probe_stream_data_list(): */
+#define PROBE_LIST_BATCH    32
+#define PROBE_LIST_WORKERS  16
+
+/* Work queue shared by probe_stream_data_list() workers: */
+typedef struct probelist_ ProbeList;
+struct probelist_ {
+    TCMutex     lock;
+    int         next;  /* first source not yet taken by a worker */
+
+    const char  **files;
+    int         nfiles;
+    int         range;
+    int         verbose_flag;
+    ProbeInfo   *infos;
+    int         *results;
+};
+
 /* Internal routine declarations: */
 
 static int do_probe(const char *file, const char *nav_seek_file, int title,
                     int range, int mplayer_flag, int verbose_flag,
                     ProbeInfo *info_ret);
+static void do_probe_list(ProbeList *pl, const int *idx, int n);
+static int probe_list_worker(TCThreadData *td, void *datum);
 static void select_modules(int flags, vob_t *vob);
 
 /*************************************************************************/
@@ -75,6 +99,84 @@ int probe_stream_data(const char *file, int range, ProbeInfo *info)
 }
 
 
+/**
+ * probe_stream_data_list:  Probe a list of source files and store the
+ * stream informations in data structures, preserving the order.  Sources
+ * are probed in batches, a whole batch with a single tcprobe run, and up
+ * to `workers' batches at the same time.
+ *
+ * Parameters:
+ *       files: Array of file names to probe.
+ *      nfiles: Number of entries in `files'.
+ *       range: Amount of each source to probe, in MB.
+ *     workers: Maximum number of tcprobe processes to run at the same
+ *              time; 0 means one for each online CPU.
+ *       infos: Array of `nfiles' structures to be filled in with probed
+ *              data.
+ *     results: Array of `nfiles' entries, each one set to nonzero if the
+ *              matching source was probed succesfully, zero otherwise.
+ * Return value:
+ *     Number of sources succesfully probed, zero on error.
+ * Preconditions:
+ *     files != NULL, infos != NULL, results != NULL, range > 0
+ */
+int probe_stream_data_list(const char **files, int nfiles, int range,
+                           int workers, ProbeInfo *infos, int *results)
+{
+    TCThread threads[PROBE_LIST_WORKERS];
+    ProbeList pl;
+    int i, started = 0, done = 0;
+
+    if (!files || !infos || !results || nfiles < 0 || range <= 0) {
+        tc_log_error(PACKAGE, "wrong probing parameters");
+        return 0;
+    }
+
+    if (workers <= 0) {
+        long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+        workers = (ncpu > 0) ?ncpu :1;
+    }
+    workers = TC_MIN(workers, PROBE_LIST_WORKERS);
+    workers = TC_MIN(workers,
+                     (nfiles + PROBE_LIST_BATCH - 1) / PROBE_LIST_BATCH);
+
+    tc_mutex_init(&pl.lock);
+    pl.next         = 0;
+    pl.files        = files;
+    pl.nfiles       = nfiles;
+    pl.range        = range;
+    pl.verbose_flag = (verbose >= TC_DEBUG) ? verbose : 0;
+    pl.infos        = infos;
+    pl.results      = results;
+
+    for (i = 1; i < workers; i++) {
+        tc_thread_init(&threads[started], "probe");
+        if (tc_thread_start(&threads[started],
+                            probe_list_worker, &pl) != TC_OK) {
+            tc_log_warn(PACKAGE, "can't start probe worker thread,"
+                                 " going on with %i", started + 1);
+            break;
+        }
+        started++;
+    }
+    /* the caller takes its share of the work too */
+    probe_list_worker(NULL, &pl);
+    for (i = 0; i < started; i++) {
+        tc_thread_wait(&threads[i], NULL);
+    }
+
+    for (i = 0; i < nfiles; i++) {
+        if (results[i]) {
+            done++;
+        } else if (verbose >= TC_DEBUG) {
+            tc_log_warn(PACKAGE, "(%s) failed to probe stream '%s'",
+                        __FILE__, files[i]);
+        }
+    }
+    return done;
+}
+
+
 /**
  * probe_source:  Probe the given input file(s) and store the results in
  * the global data structure.
@@ -341,6 +443,13 @@ static int do_probe(const char *file, const char *nav_seek_file, int title,
     char cmdbuf[PATH_MAX+1000];
     FILE *pipe;
 
+    /* the navigation file changes the result, but is not in the key */
+    if (!nav_seek_file
+     && tc_probe_cache_lookup(file, title, range, mplayer_flag,
+                              info_ret) == TC_OK) {
+        return 1;
+    }
+
     if (mplayer_flag) {
         if (tc_snprintf(cmdbuf, sizeof(cmdbuf),
                 "%s -B -M -i \"%s\" -d %d",
@@ -370,11 +479,148 @@ static int do_probe(const char *file, const char *nav_seek_file, int title,
         return 0;
     }
     pclose(pipe);
+    if (!nav_seek_file) {
+        tc_probe_cache_store(file, title, range, mplayer_flag, info_ret);
+    }
     return 1;
 }
 
 /*************************************************************************/
 
+/**
+ * probe_list_worker:  Thread body for probe_stream_data_list(): take
+ * batches of sources from the shared queue until it is empty, and probe
+ * the ones not already in the probe cache.
+ *
+ * Parameters:
+ *        td: Thread data (unused, NULL when called directly).
+ *     datum: Pointer to the shared ProbeList.
+ * Return value:
+ *     Always zero.
+ */
+
+static int probe_list_worker(TCThreadData *td, void *datum)
+{
+    ProbeList *pl = datum;
+    int idx[PROBE_LIST_BATCH];
+    int first, last, i, n;
+
+    while (1) {
+        tc_mutex_lock(&pl->lock);
+        first = pl->next;
+        last  = TC_MIN(first + PROBE_LIST_BATCH, pl->nfiles);
+        pl->next = last;
+        tc_mutex_unlock(&pl->lock);
+
+        if (first >= last) {
+            break;
+        }
+
+        n = 0;
+        for (i = first; i < last; i++) {
+            if (tc_probe_cache_lookup(pl->files[i], 0, pl->range, 0,
+                                      &pl->infos[i]) == TC_OK) {
+                pl->results[i] = 1;
+            } else {
+                pl->results[i] = 0;
+                idx[n++] = i;
+            }
+        }
+        if (n > 0) {
+            do_probe_list(pl, idx, n);
+        }
+    }
+    return 0;
+}
+
+/**
+ * do_probe_list:  Probe a batch of sources with a single tcprobe run,
+ * using its multiple source binary mode.  The result of each source is
+ * stored in the probe cache like do_probe() does.
+ *
+ * Parameters:
+ *      pl: ProbeList holding sources and result arrays.
+ *     idx: Indexes in `pl' of the sources to probe.
+ *       n: Number of entries in `idx' (at most PROBE_LIST_BATCH).
+ * Return value:
+ *     None.  pl->results[] is updated for each source.
+ */
+
+static void do_probe_list(ProbeList *pl, const int *idx, int n)
+{
+    const char *argv[PROBE_LIST_BATCH + 10];
+    char rangebuf[16], verbosebuf[16];
+    int fds[2], i, j = 0;
+    pid_t pid, probe_pid;
+    FILE *fp;
+
+    tc_snprintf(rangebuf, sizeof(rangebuf), "%i", pl->range);
+    tc_snprintf(verbosebuf, sizeof(verbosebuf), "%i", pl->verbose_flag);
+    argv[j++] = TCPROBE_EXE;
+    argv[j++] = "-B";
+    argv[j++] = "-T";
+    argv[j++] = "0";
+    argv[j++] = "-H";
+    argv[j++] = rangebuf;
+    argv[j++] = "-d";
+    argv[j++] = verbosebuf;
+    argv[j++] = "--";
+    for (i = 0; i < n; i++) {
+        argv[j++] = pl->files[idx[i]];
+    }
+    argv[j] = NULL;
+
+    if (pipe(fds) == -1) {
+        tc_log_perror(PACKAGE, "do_probe_list(): pipe failed");
+        return;
+    }
+    /* don't leak this pipe into tcprobe runs of other workers */
+    fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+    fcntl(fds[1], F_SETFD, FD_CLOEXEC);
+
+    pid = fork();
+    if (pid == -1) {
+        tc_log_perror(PACKAGE, "do_probe_list(): fork failed");
+        close(fds[0]);
+        close(fds[1]);
+        return;
+    } else if (pid == 0) {
+        /* Child process */
+        if (dup2(fds[1], 1) == -1) {
+            _exit(-1);
+        }
+        execvp(TCPROBE_EXE, (char **)argv);
+        _exit(-1);
+    }
+    /* Parent process */
+    close(fds[1]);
+    fp = fdopen(fds[0], "r");
+    if (!fp) {
+        close(fds[0]);
+    } else {
+        if (fread(&probe_pid, sizeof(pid_t), 1, fp) == 1) {
+            for (i = 0; i < n; i++) {
+                ProbeInfo *info = &pl->infos[idx[i]];
+                int32_t error;
+
+                if (fread(&error, sizeof(error), 1, fp) != 1
+                 || fread(info, sizeof(*info), 1, fp) != 1) {
+                    break;
+                }
+                if (error == 0) {
+                    pl->results[idx[i]] = 1;
+                    tc_probe_cache_store(pl->files[idx[i]], 0, pl->range, 0,
+                                         info);
+                }
+            }
+        }
+        fclose(fp);
+    }
+    waitpid(pid, NULL, 0);
+}
+
+/*************************************************************************/
+
 /**
  * probe_to_vob:  Use the results of probing the input files to set global
  * parameters.
@@ -420,6 +666,10 @@ void probe_to_vob(ProbeInfo *vinfo, ProbeInfo *ainfo, int flags, vob_t *vob)
                 vob->fps = vinfo->fps;
         }
 
+        /* Set stream length, if known */
+        if (vinfo->frames > 0)
+            vob->im_frames = vinfo->frames;
+
         /* Set aspect ratio */
         if (MAY_SET(IMASR)) {
             if (vinfo->asr > 0)
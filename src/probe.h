@@ -22,6 +22,8 @@ int probe_source(const char *vid_file, const char *aud_file, int range,
 int probe_source_xml(vob_t *vob, int which);
 
 int probe_stream_data(const char *file, int range, ProbeInfo *info);
+int probe_stream_data_list(const char **files, int nfiles, int range,
+                           int workers, ProbeInfo *infos, int *results);
 void probe_to_vob(ProbeInfo *vinfo, ProbeInfo *ainfo, int flags, vob_t *vob);
 
 /* Flags for probe_source(), indicating which parameters were specified by
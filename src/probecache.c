@@ -0,0 +1,509 @@
+/*
+ * probecache.c - cache of probed stream informations
+ *
+ * This file is part of transcode, a video stream processing tool.
+ * transcode is free software, distributable under the terms of the GNU
+ * General Public License (version 2 or later).  See the file COPYING
+ * for details.
+ */
+
+#include "transcode.h"
+#include "probecache.h"
+#include "libtc/libtc.h"
+#include "libtcutil/tcthread.h"
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <errno.h>
+
+/*************************************************************************/
+
+#define PROBE_CACHE_MAGIC       "TCPCACHE"  /* 8 bytes, no terminator */
+#define PROBE_CACHE_MAGIC_LEN   8
+#define PROBE_CACHE_VERSION     2
+#define PROBE_CACHE_SUFFIX      ".tcpc"
+
+/* number of entries kept in memory; multi-input mode walks the sources
+ * in order, so a small round-robin table is enough */
+#define PROBE_CACHE_MEM_SLOTS   32
+
+typedef struct probecachekey_ ProbeCacheKey;
+struct probecachekey_ {
+    char     path[PATH_MAX];
+    uint64_t dev;
+    uint64_t ino;
+    uint64_t size;
+    int64_t  mtime;
+    int64_t  mtime_ns;  /* sub-second part, where the system has it */
+    int32_t  title;
+    int32_t  range;
+    int32_t  flags;
+};
+
+/* packed key: fixed fields, path length, path */
+#define PROBE_CACHE_KEY_FIXED   (8*5 + 4*3 + 4)
+
+typedef struct probecacheslot_ ProbeCacheSlot;
+struct probecacheslot_ {
+    int           used;
+    ProbeCacheKey key;
+    ProbeInfo     info;
+};
+
+static TCMutex        cache_lock = { PTHREAD_MUTEX_INITIALIZER };
+static char           cache_dir[PATH_MAX] = { '\0' };
+static ProbeCacheSlot cache_mem[PROBE_CACHE_MEM_SLOTS];
+static int            cache_next = 0;
+
+static void mem_insert(const ProbeCacheKey *key, const ProbeInfo *info)
+{
+    tc_mutex_lock(&cache_lock);
+    cache_mem[cache_next].used = 1;
+    cache_mem[cache_next].key  = *key;
+    cache_mem[cache_next].info = *info;
+    cache_next = (cache_next + 1) % PROBE_CACHE_MEM_SLOTS;
+    tc_mutex_unlock(&cache_lock);
+}
+
+/*************************************************************************/
+
+/* little endian, fixed width (de)serialization helpers */
+
+static uint8_t *put_u32(uint8_t *p, uint32_t v)
+{
+    p[0] = v & 0xFF;
+    p[1] = (v >>  8) & 0xFF;
+    p[2] = (v >> 16) & 0xFF;
+    p[3] = (v >> 24) & 0xFF;
+    return p + 4;
+}
+
+static uint8_t *put_u64(uint8_t *p, uint64_t v)
+{
+    p = put_u32(p, (uint32_t)(v & 0xFFFFFFFFUL));
+    return put_u32(p, (uint32_t)(v >> 32));
+}
+
+static uint8_t *put_double(uint8_t *p, double d)
+{
+    uint64_t v;
+    memcpy(&v, &d, sizeof(v));
+    return put_u64(p, v);
+}
+
+static const uint8_t *get_u32(const uint8_t *p, uint32_t *v)
+{
+    *v = (uint32_t)p[0]         | ((uint32_t)p[1] <<  8)
+      | ((uint32_t)p[2] << 16)  | ((uint32_t)p[3] << 24);
+    return p + 4;
+}
+
+static const uint8_t *get_u64(const uint8_t *p, uint64_t *v)
+{
+    uint32_t lo, hi;
+    p = get_u32(p, &lo);
+    p = get_u32(p, &hi);
+    *v = ((uint64_t)hi << 32) | lo;
+    return p;
+}
+
+static const uint8_t *get_double(const uint8_t *p, double *d)
+{
+    uint64_t v;
+    p = get_u64(p, &v);
+    memcpy(d, &v, sizeof(*d));
+    return p;
+}
+
+/* shortcuts for signed fields */
+#define PUT_INT(P, V)   ((P) = put_u32((P), (uint32_t)(int32_t)(V)))
+#define PUT_LONG(P, V)  ((P) = put_u64((P), (uint64_t)(int64_t)(V)))
+#define GET_INT(P, V)   do { \
+    uint32_t tmp_; (P) = get_u32((P), &tmp_); (V) = (int32_t)tmp_; \
+} while (0)
+#define GET_LONG(P, V)  do { \
+    uint64_t tmp_; (P) = get_u64((P), &tmp_); (V) = (int64_t)tmp_; \
+} while (0)
+
+/*************************************************************************/
+
+size_t tc_probe_info_pack(const ProbeInfo *info, uint8_t *buf, size_t len)
+{
+    uint8_t *p = buf;
+    int i, j;
+
+    if (!info || !buf || len < TC_PROBE_INFO_PACKED_SIZE) {
+        return 0;
+    }
+
+    PUT_INT(p, info->width);
+    PUT_INT(p, info->height);
+    p = put_double(p, info->fps);
+    PUT_LONG(p, info->codec);
+    PUT_LONG(p, info->magic);
+    PUT_LONG(p, info->magic_xml);
+    PUT_INT(p, info->asr);
+    PUT_INT(p, info->frc);
+    PUT_INT(p, info->par_width);
+    PUT_INT(p, info->par_height);
+    PUT_INT(p, info->attributes);
+    PUT_INT(p, info->num_tracks);
+    PUT_LONG(p, info->frames);
+    PUT_LONG(p, info->time);
+    PUT_INT(p, info->unit_cnt);
+    p = put_double(p, info->pts_start);
+    PUT_LONG(p, info->bitrate);
+    for (j = 0; j < 4; j++) {
+        PUT_INT(p, info->ext_attributes[j]);
+    }
+    PUT_INT(p, info->is_video);
+
+    PUT_INT(p, TC_MAX_AUD_TRACKS);
+    for (i = 0; i < TC_MAX_AUD_TRACKS; i++) {
+        const ProbeTrackInfo *t = &info->track[i];
+        PUT_INT(p, t->samplerate);
+        PUT_INT(p, t->chan);
+        PUT_INT(p, t->bits);
+        PUT_INT(p, t->bitrate);
+        PUT_INT(p, t->padrate);
+        PUT_INT(p, t->format);
+        PUT_INT(p, t->lang);
+        PUT_INT(p, t->attribute);
+        PUT_INT(p, t->tid);
+        p = put_double(p, t->pts_start);
+    }
+
+    return (size_t)(p - buf);
+}
+
+size_t tc_probe_info_unpack(ProbeInfo *info, const uint8_t *buf, size_t len)
+{
+    const uint8_t *p = buf;
+    int i, j, ntracks;
+
+    if (!info || !buf || len < TC_PROBE_INFO_PACKED_SIZE) {
+        return 0;
+    }
+
+    memset(info, 0, sizeof(ProbeInfo));
+
+    GET_INT(p, info->width);
+    GET_INT(p, info->height);
+    p = get_double(p, &info->fps);
+    GET_LONG(p, info->codec);
+    GET_LONG(p, info->magic);
+    GET_LONG(p, info->magic_xml);
+    GET_INT(p, info->asr);
+    GET_INT(p, info->frc);
+    GET_INT(p, info->par_width);
+    GET_INT(p, info->par_height);
+    GET_INT(p, info->attributes);
+    GET_INT(p, info->num_tracks);
+    GET_LONG(p, info->frames);
+    GET_LONG(p, info->time);
+    GET_INT(p, info->unit_cnt);
+    p = get_double(p, &info->pts_start);
+    GET_LONG(p, info->bitrate);
+    for (j = 0; j < 4; j++) {
+        GET_INT(p, info->ext_attributes[j]);
+    }
+    GET_INT(p, info->is_video);
+
+    GET_INT(p, ntracks);
+    if (ntracks != TC_MAX_AUD_TRACKS) {
+        return 0; /* packed by a differently configured transcode */
+    }
+    for (i = 0; i < TC_MAX_AUD_TRACKS; i++) {
+        ProbeTrackInfo *t = &info->track[i];
+        GET_INT(p, t->samplerate);
+        GET_INT(p, t->chan);
+        GET_INT(p, t->bits);
+        GET_INT(p, t->bitrate);
+        GET_INT(p, t->padrate);
+        GET_INT(p, t->format);
+        GET_INT(p, t->lang);
+        GET_INT(p, t->attribute);
+        GET_INT(p, t->tid);
+        p = get_double(p, &t->pts_start);
+    }
+
+    return (size_t)(p - buf);
+}
+
+/*************************************************************************/
+
+/*
+ * make_key:
+ *      build the identity of a source. Only regular files are accepted:
+ *      devices, pipes and directories can change content under the same
+ *      identity.
+ */
+static int make_key(ProbeCacheKey *key, const char *file,
+                    int title, int range, int flags)
+{
+    struct stat st;
+
+    if (!file || stat(file, &st) != 0 || !S_ISREG(st.st_mode)) {
+        return TC_ERROR;
+    }
+    if (strlcpy(key->path, file, sizeof(key->path)) >= sizeof(key->path)) {
+        return TC_ERROR;
+    }
+    key->dev   = (uint64_t)st.st_dev;
+    key->ino   = (uint64_t)st.st_ino;
+    key->size  = (uint64_t)st.st_size;
+    key->mtime = (int64_t)st.st_mtime;
+#ifdef HAVE_STRUCT_STAT_ST_MTIM_TV_NSEC
+    key->mtime_ns = (int64_t)st.st_mtim.tv_nsec;
+#else
+    key->mtime_ns = 0;
+#endif
+    key->title = title;
+    key->range = range;
+    key->flags = flags;
+    return TC_OK;
+}
+
+static int key_equal(const ProbeCacheKey *a, const ProbeCacheKey *b)
+{
+    return (a->dev   == b->dev   && a->ino   == b->ino
+         && a->size  == b->size  && a->mtime == b->mtime
+         && a->mtime_ns == b->mtime_ns
+         && a->title == b->title && a->range == b->range
+         && a->flags == b->flags && strcmp(a->path, b->path) == 0);
+}
+
+static size_t key_pack(const ProbeCacheKey *key, uint8_t *buf)
+{
+    uint8_t *p = buf;
+    uint32_t plen = strlen(key->path);
+
+    p = put_u64(p, key->dev);
+    p = put_u64(p, key->ino);
+    p = put_u64(p, key->size);
+    PUT_LONG(p, key->mtime);
+    PUT_LONG(p, key->mtime_ns);
+    PUT_INT(p, key->title);
+    PUT_INT(p, key->range);
+    PUT_INT(p, key->flags);
+    p = put_u32(p, plen);
+    memcpy(p, key->path, plen);
+    return (size_t)(p - buf) + plen;
+}
+
+/* FNV-1a over the packed key: names the entry file */
+static uint64_t key_hash(const uint8_t *buf, size_t len)
+{
+    uint64_t h = 0xcbf29ce484222325ULL;
+    size_t i;
+
+    for (i = 0; i < len; i++) {
+        h ^= buf[i];
+        h *= 0x100000001b3ULL;
+    }
+    return h;
+}
+
+/* largest packed entry: magic, version, key, info */
+#define PROBE_CACHE_ENTRY_MAX \
+    (PROBE_CACHE_MAGIC_LEN + 4 + PROBE_CACHE_KEY_FIXED + PATH_MAX \
+     + TC_PROBE_INFO_PACKED_SIZE)
+
+static size_t entry_pack(const ProbeCacheKey *key, const ProbeInfo *info,
+                         uint8_t *buf, size_t *key_len)
+{
+    uint8_t *p = buf;
+    size_t klen = 0, ilen = 0;
+
+    memcpy(p, PROBE_CACHE_MAGIC, PROBE_CACHE_MAGIC_LEN);
+    p += PROBE_CACHE_MAGIC_LEN;
+    p = put_u32(p, PROBE_CACHE_VERSION);
+    klen = key_pack(key, p);
+    if (key_len) {
+        *key_len = klen;
+    }
+    p += klen;
+    if (info) {
+        ilen = tc_probe_info_pack(info, p, TC_PROBE_INFO_PACKED_SIZE);
+    }
+    return (size_t)(p - buf) + ilen;
+}
+
+static int entry_path(char *path, size_t len, const ProbeCacheKey *key)
+{
+    uint8_t buf[PROBE_CACHE_KEY_FIXED + PATH_MAX];
+    size_t klen = key_pack(key, buf);
+
+    return tc_snprintf(path, len, "%s/%016llx%s", cache_dir,
+                       (unsigned long long)key_hash(buf, klen),
+                       PROBE_CACHE_SUFFIX);
+}
+
+/*************************************************************************/
+
+static int disk_lookup(const ProbeCacheKey *key, ProbeInfo *info)
+{
+    uint8_t want[PROBE_CACHE_ENTRY_MAX], have[PROBE_CACHE_ENTRY_MAX];
+    char path[PATH_MAX];
+    size_t hlen = 0, klen = 0, got = 0;
+    FILE *f = NULL;
+
+    if (entry_path(path, sizeof(path), key) < 0) {
+        return TC_ERROR;
+    }
+    f = fopen(path, "rb");
+    if (!f) {
+        return TC_ERROR;
+    }
+    got = fread(have, 1, sizeof(have), f);
+    fclose(f);
+
+    /* magic, version and key must match byte by byte */
+    hlen = entry_pack(key, NULL, want, &klen);
+    if (got != hlen + TC_PROBE_INFO_PACKED_SIZE
+     || memcmp(want, have, hlen) != 0) {
+        if (verbose >= TC_DEBUG) {
+            tc_log_info(__FILE__, "stale probe cache entry '%s'", path);
+        }
+        return TC_ERROR;
+    }
+    if (!tc_probe_info_unpack(info, have + hlen, got - hlen)) {
+        return TC_ERROR;
+    }
+    return TC_OK;
+}
+
+static int disk_store(const ProbeCacheKey *key, const ProbeInfo *info)
+{
+    uint8_t buf[PROBE_CACHE_ENTRY_MAX];
+    char path[PATH_MAX], tmp[PATH_MAX];
+    size_t len = 0;
+    FILE *f = NULL;
+    int ret = TC_ERROR, err = 0;
+
+    if (entry_path(path, sizeof(path), key) < 0
+     || tc_snprintf(tmp, sizeof(tmp), "%s.%i.tmp",
+                    path, (int)getpid()) < 0) {
+        return TC_ERROR;
+    }
+
+    len = entry_pack(key, info, buf, NULL);
+
+    /* write aside and rename, so concurrent jobs never see a partial
+     * entry */
+    f = fopen(tmp, "wb");
+    if (!f) {
+        return TC_ERROR;
+    }
+    if (fwrite(buf, 1, len, f) != len) {
+        err = errno;
+        fclose(f);
+    } else if (fclose(f) != 0 || rename(tmp, path) != 0) {
+        err = errno;
+    } else {
+        ret = TC_OK;
+    }
+    if (ret != TC_OK) {
+        tc_log_warn(__FILE__, "unable to write probe cache entry '%s': %s",
+                    path, strerror(err));
+        unlink(tmp);
+    }
+    return ret;
+}
+
+/*************************************************************************/
+
+int tc_probe_cache_set_dir(const char *dir)
+{
+    struct stat st;
+
+    tc_mutex_lock(&cache_lock);
+    cache_dir[0] = '\0';
+    tc_mutex_unlock(&cache_lock);
+
+    if (!dir) {
+        return TC_OK;
+    }
+
+    if (mkdir(dir, 0755) != 0 && errno != EEXIST) {
+        tc_log_warn(__FILE__, "unable to create probe cache directory"
+                              " '%s': %s", dir, strerror(errno));
+        return TC_ERROR;
+    }
+    if (stat(dir, &st) != 0 || !S_ISDIR(st.st_mode)
+     || access(dir, R_OK | W_OK | X_OK) != 0) {
+        tc_log_warn(__FILE__, "probe cache directory '%s' not usable", dir);
+        return TC_ERROR;
+    }
+
+    tc_mutex_lock(&cache_lock);
+    strlcpy(cache_dir, dir, sizeof(cache_dir));
+    tc_mutex_unlock(&cache_lock);
+    return TC_OK;
+}
+
+int tc_probe_cache_lookup(const char *file, int title, int range, int flags,
+                          ProbeInfo *info)
+{
+    ProbeCacheKey key;
+    int i, ret = TC_ERROR;
+
+    if (!info || make_key(&key, file, title, range, flags) != TC_OK) {
+        return TC_ERROR;
+    }
+
+    tc_mutex_lock(&cache_lock);
+    for (i = 0; i < PROBE_CACHE_MEM_SLOTS; i++) {
+        if (cache_mem[i].used && key_equal(&cache_mem[i].key, &key)) {
+            ac_memcpy(info, &cache_mem[i].info, sizeof(ProbeInfo));
+            ret = TC_OK;
+            break;
+        }
+    }
+    tc_mutex_unlock(&cache_lock);
+
+    if (ret == TC_OK) {
+        if (verbose >= TC_DEBUG) {
+            tc_log_info(__FILE__, "probe cache hit (memory) for '%s'", file);
+        }
+        return TC_OK;
+    }
+
+    if (cache_dir[0] != '\0' && disk_lookup(&key, info) == TC_OK) {
+        if (verbose >= TC_DEBUG) {
+            tc_log_info(__FILE__, "probe cache hit (disk) for '%s'", file);
+        }
+        mem_insert(&key, info); /* no need to write it back */
+        return TC_OK;
+    }
+    return TC_ERROR;
+}
+
+int tc_probe_cache_store(const char *file, int title, int range, int flags,
+                         const ProbeInfo *info)
+{
+    ProbeCacheKey key;
+
+    if (!info || make_key(&key, file, title, range, flags) != TC_OK) {
+        return TC_ERROR;
+    }
+
+    mem_insert(&key, info);
+
+    if (cache_dir[0] != '\0') {
+        return disk_store(&key, info);
+    }
+    return TC_OK;
+}
+
+/*************************************************************************/
+
+/*
+ * Local variables:
+ *   c-file-style: "stroustrup"
+ *   c-file-offsets: ((case-label . *) (statement-case-intro . *))
+ *   indent-tabs-mode: nil
+ * End:
+ *
+ * vim: expandtab shiftwidth=4:
+ */
@@ -0,0 +1,110 @@
+/*
+ * probecache.h - cache of probed stream informations
+ *
+ * This file is part of transcode, a video stream processing tool.
+ * transcode is free software, distributable under the terms of the GNU
+ * General Public License (version 2 or later).  See the file COPYING
+ * for details.
+ */
+
+#ifndef PROBECACHE_H
+#define PROBECACHE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "tccore/probe.h"
+
+/*************************************************************************/
+
+/*
+ * Probe results are cached at two levels:
+ * - in memory, for the lifetime of the process. This is always enabled
+ *   and avoids to fork tcprobe again and again for the same file (e.g.
+ *   audio and video coming from the same source, multi-input mode).
+ * - on disk, in a directory given by the user (--probe_cache). This
+ *   let consecutive runs (preflight, pass 1, pass 2...) share results.
+ *
+ * Entries are keyed by path, size, modification time, device and inode
+ * of the source plus the probing parameters. Only regular files are
+ * cached: devices, directories and network sources are always probed.
+ */
+
+/* size of a ProbeInfo once packed by tc_probe_info_pack():
+ * 8 int and 8 64-bit fields, track count, unit_cnt, ext_attributes,
+ * is_video, then 9 int and a double for each track */
+#define TC_PROBE_INFO_PACKED_SIZE \
+    (4*8 + 8*8 + 4 + 4 + 4*4 + 4 + TC_MAX_AUD_TRACKS*(4*9 + 8))
+
+/*
+ * tc_probe_cache_set_dir:
+ *      enable the on-disk cache, storing entries in the given directory.
+ *      The directory is created if it does not exist.
+ *
+ * Parameters:
+ *      dir: path of cache directory. NULL disables the on-disk cache.
+ * Return Value:
+ *      TC_OK: succesfull.
+ *      TC_ERROR: the directory is not usable. The on-disk cache stays
+ *                disabled.
+ */
+int tc_probe_cache_set_dir(const char *dir);
+
+/*
+ * tc_probe_cache_lookup:
+ *      look for cached probe results of a source, first in memory,
+ *      then on disk.
+ *
+ * Parameters:
+ *       file: source to look for.
+ *      title: DVD title used for probing.
+ *      range: amount of source probed, in MB.
+ *      flags: probing flags (e.g. external probe).
+ *       info: structure to be filled with cached data.
+ * Return Value:
+ *      TC_OK: cache hit, `info' is filled.
+ *      TC_ERROR: cache miss, `info' is untouched.
+ */
+int tc_probe_cache_lookup(const char *file, int title, int range, int flags,
+                          ProbeInfo *info);
+
+/*
+ * tc_probe_cache_store:
+ *      remember probe results of a source. Parameters as
+ *      tc_probe_cache_lookup().
+ *
+ * Return Value:
+ *      TC_OK: succesfull.
+ *      TC_ERROR: source not cacheable or I/O error. Not fatal.
+ */
+int tc_probe_cache_store(const char *file, int title, int range, int flags,
+                         const ProbeInfo *info);
+
+/*
+ * tc_probe_info_pack, tc_probe_info_unpack:
+ *      (de)serialize a ProbeInfo in a portable way (fixed size fields,
+ *      little endian) unlike the raw structure dump of `tcprobe -B'.
+ *
+ * Parameters:
+ *      info: structure to pack/unpack.
+ *       buf: buffer holding at least TC_PROBE_INFO_PACKED_SIZE bytes.
+ *       len: size of `buf'.
+ * Return Value:
+ *      number of bytes written/read, 0 on error.
+ */
+size_t tc_probe_info_pack(const ProbeInfo *info, uint8_t *buf, size_t len);
+size_t tc_probe_info_unpack(ProbeInfo *info, const uint8_t *buf, size_t len);
+
+/*************************************************************************/
+
+#endif  /* PROBECACHE_H */
+
+/*
+ * Local variables:
+ *   c-file-style: "stroustrup"
+ *   c-file-offsets: ((case-label . *) (statement-case-intro . *))
+ *   indent-tabs-mode: nil
+ * End:
+ *
+ * vim: expandtab shiftwidth=4:
+ */
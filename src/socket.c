@@ -12,6 +12,9 @@
 #include "transcode.h"
 #include "filter.h"
 #include "socket.h"
+#include "decoder.h"
+#include "framebuffer.h"
+#include "frame_threads.h"
 #include "libtcexport/export.h"
 #include "libtc/libtc.h"
 #include "libtcutil/tcthread.h"
@@ -404,6 +407,7 @@ static int handle_help(char *params)
             "parameters <filter>\n"
             "list [ load | enable | disable ]\n"
             "dump\n"
+            "latency\n"
             "progress\n"
             "pause\n"
             "preview <command>\n"
@@ -413,6 +417,8 @@ static int handle_help(char *params)
             "    faster | toggle | grab ]\n"
             "status\n"
             "stop\n"
+            "tune [ vthreads | athreads | vbuffers | abuffers |\n"
+            "       readahead ] <value>\n"
             "help\n"
             "version\n"
             "quit\n"
@@ -422,6 +428,29 @@ static int handle_help(char *params)
 
 /*************************************************************************/
 
+/**
+ * handle_latency():  Process a "latency" command received on the socket:
+ * send the per-stage latency statistics as a JSON document.
+ *
+ * Parameters:
+ *     params: Command parameters (unused).
+ * Return value:
+ *     Nonzero on success, zero on failure.
+ */
+
+static int handle_latency(char *params)
+{
+    char *json = tc_latency_json();
+
+    if (!json)
+        return 0;
+    sendstr(client_sock, json);
+    tc_free(json);
+    return 1;
+}
+
+/*************************************************************************/
+
 /**
  * handle_list():  Process a "list" command received on the socket.
  *
@@ -576,6 +605,56 @@ static int handle_preview(char *params)
 
 /*************************************************************************/
 
+/**
+ * handle_tune():  Process a "tune" command received on the socket: change
+ * a pipeline parameter while running, if one is given, then send the
+ * current values of all of them.
+ *
+ * Parameters:
+ *     params: Command parameters.
+ * Return value:
+ *     Nonzero on success, zero on failure.
+ */
+
+static int handle_tune(char *params)
+{
+    char name[16], buf[128];
+    int value = 0, ret = TC_OK;
+
+    if (*params) {
+        if (sscanf(params, "%15s %i", name, &value) != 2)
+            return 0;
+
+        if (strcasecmp(name, "vthreads") == 0)
+            ret = tc_frame_threads_set_workers(TC_VIDEO, value);
+        else if (strcasecmp(name, "athreads") == 0)
+            ret = tc_frame_threads_set_workers(TC_AUDIO, value);
+        else if (strcasecmp(name, "vbuffers") == 0)
+            ret = vframe_resize(value);
+        else if (strcasecmp(name, "abuffers") == 0)
+            ret = aframe_resize(value);
+        else if (strcasecmp(name, "readahead") == 0)
+            ret = tc_import_set_readahead(value);
+        else
+            return 0;
+
+        if (ret != TC_OK)
+            return 0;
+    }
+
+    tc_snprintf(buf, sizeof(buf),
+                "vthreads=%i athreads=%i vbuffers=%i abuffers=%i"
+                " readahead=%i\n",
+                tc_frame_threads_get_workers(TC_VIDEO),
+                tc_frame_threads_get_workers(TC_AUDIO),
+                vframe_get_size(), aframe_get_size(),
+                tc_import_get_readahead());
+    sendstr(client_sock, buf);
+    return 1;
+}
+
+/*************************************************************************/
+
 /**
  * handle:  Handle a single message from a socket.
  *
@@ -616,6 +695,8 @@ static int handle(char *buf)
         retval = handle_enable(params);
     } else if (strncasecmp(cmd, "help", 2) == 0) {
         retval = handle_help(params);
+    } else if (strncasecmp(cmd, "latency", 2) == 0) {
+        retval = handle_latency(params);
     } else if (strncasecmp(cmd, "list", 2) == 0) {
         retval = handle_list(params);
     } else if (strncasecmp(cmd, "load", 2) == 0) {
@@ -636,12 +717,14 @@ static int handle(char *buf)
     } else if (strncasecmp(cmd, "quit", 2) == 0
             || strncasecmp(cmd, "exit", 2) == 0) {
         return 0;  // tell caller to close socket
+    } else if (strncasecmp(cmd, "tune", 2) == 0) {
+        retval = handle_tune(params);
     } else if (strncasecmp(cmd, "unload", 2) == 0) {
         retval = 0;  // FIXME: not implemented
     } else if (strncasecmp(cmd, "version", 2) == 0) {
         sendstr(client_sock, PACKAGE_VERSION "\n");
         retval = 1;
-    } else if (strncasecmp(cmd, "stop", 4)) {
+    } else if (strncasecmp(cmd, "stop", 4) == 0) {
         tc_interrupt();
         tc_framebuffer_interrupt();
         retval = 1;
@@ -30,6 +30,10 @@
 
 #include "tccore/tc_defaults.h"
 #include "aclib/ac.h"
+#include "libtcutil/tcthread.h"
+#include "libtcutil/tctimer.h"
+
+#include <math.h>
 
 #include "synchronizer.h"
 
@@ -331,19 +335,444 @@ no_context:
 }
 
 
+/*************************************************************************/
+
+/*
+ * Resample synchro method:
+ * the video frames are left untouched; the drift between the audio and
+ * the video clocks is followed continuously and corrected by resampling
+ * the audio with a slowly varying ratio, so the correction is spread over
+ * all the samples instead of happening a whole frame at time.
+ *
+ * The clock of a frame is its timestamp (microseconds, capture time of
+ * the first sample of audio frames) if the import layer set one. In the
+ * `live' variant frames without timestamp are clocked at their arrival,
+ * which follows the capture devices, while for files only timestamps
+ * make sense. Only the drift with respect of the first measurement is
+ * corrected; the initial offset is up to -D and --av_fine_ms.
+ *
+ * Audio is consumed in chunks of whatever size the filler provides,
+ * through an input buffer allocated once; output frames have the same
+ * size they would have without the synchronizer.
+ */
+
+#define RESAMPLE_TAPS       32      /* length of the filter (samples) */
+#define RESAMPLE_HIST       (RESAMPLE_TAPS/2 - 1) /* taps before the pos */
+#define RESAMPLE_PHASES     256     /* subsample positions in the bank */
+#define RESAMPLE_BETA       8.0     /* Kaiser window shape */
+#define RESAMPLE_MAX_CORR   0.005   /* max deviation of ratio from 1 */
+#define RESAMPLE_REACTION   50.0    /* frames to recover a drift */
+#define RESAMPLE_SMOOTHING  16.0    /* frames of clock jitter averaging */
+
+typedef struct resamplecontext_ ResampleContext;
+struct resamplecontext_ {
+    const char *method_name;
+    int live;               /* clock untimed frames at arrival? */
+
+    int chans;
+    int rate;
+    double fps;
+    int frame_size;         /* bytes per frame, as in vob->im_a_size */
+    int leap_bytes;         /* as in vob->a_leap_bytes */
+    int interval;           /* adjust the ratio every `interval' frames */
+
+    /* polyphase bank; phase RESAMPLE_PHASES eases the interpolation */
+    float bank[RESAMPLE_PHASES + 1][RESAMPLE_TAPS];
+
+    int16_t *buf;           /* input samples, interleaved */
+    int size;               /* capacity of buf, in samples per channel */
+    int len;                /* valid samples in buf */
+    double pos;             /* position of next output sample in buf */
+    int64_t base;           /* input sample held in buf[0] */
+    int eos;                /* filler is exhausted... */
+    int64_t last;           /* ...after this input sample */
+
+    double ratio;           /* input samples per output sample */
+    double drift;           /* smoothed drift, in input samples */
+    double integral;
+    double offset;          /* initial offset, left alone */
+    int measured;
+    long clamped;           /* frames on which the correction saturated */
+    double max_drift;
+
+    long frames;            /* audio frames delivered so far */
+
+    /* audio clock: input sample `a_sample' was taken at `a_time' */
+    int64_t a_sample;
+    uint64_t a_time;
+
+    TCMutex lock;           /* guards the video clock */
+    long v_frames;
+    long v_frame;           /* video frame `v_frame' was taken at `v_time' */
+    uint64_t v_time;
+};
+
+/* modified Bessel function of first kind, order zero */
+static double resample_bessel_i0(double x)
+{
+    double sum = 1.0, term = 1.0;
+    int k;
+
+    for (k = 1; k < 32; k++) {
+        term *= (x / (2.0 * k)) * (x / (2.0 * k));
+        sum += term;
+    }
+    return sum;
+}
+
+/* Kaiser windowed sinc, one row per subsample phase, unity gain. */
+static void resample_init_bank(ResampleContext *ctx)
+{
+    const double half = RESAMPLE_TAPS / 2.0;
+    const double norm = resample_bessel_i0(RESAMPLE_BETA);
+    int p, t;
+
+    for (p = 0; p <= RESAMPLE_PHASES; p++) {
+        double sum = 0.0, h[RESAMPLE_TAPS];
+        for (t = 0; t < RESAMPLE_TAPS; t++) {
+            double x = t - RESAMPLE_HIST - (double)p / RESAMPLE_PHASES;
+            double w = 1.0 - (x / half) * (x / half);
+            h[t] = 0.0;
+            if (w > 0.0) {
+                h[t] = (x == 0.0) ?1.0 :sin(M_PI * x) / (M_PI * x);
+                h[t] *= resample_bessel_i0(RESAMPLE_BETA * sqrt(w)) / norm;
+            }
+            sum += h[t];
+        }
+        for (t = 0; t < RESAMPLE_TAPS; t++) {
+            ctx->bank[p][t] = h[t] / sum;
+        }
+    }
+}
+
+/* bytes of the next audio frame, following the decoder's leap rule */
+static int resample_frame_bytes(const ResampleContext *ctx)
+{
+    if (ctx->frames != 0 && ctx->frames % TC_LEAP_FRAME == 0) {
+        return ctx->frame_size + ctx->leap_bytes;
+    }
+    return ctx->frame_size;
+}
+
+/*
+ * resample_fill:
+ *     get from the filler input samples until buf[need] is valid.
+ *     On end of stream, the buffer is padded with silence as long as
+ *     there is still real data beyond the current position.
+ *
+ * Return Value:
+ *     TC_OK if buf[need] is valid, TC_ERROR if the stream is over.
+ */
+static int resample_fill(ResampleContext *ctx, int need, TCFrameAudio *af,
+                         TCFillFrameAudio filler, void *ud)
+{
+    const int bpf = ctx->chans * sizeof(int16_t);
+
+    /* drop the samples no longer needed by the filter */
+    int drop = (int)ctx->pos - RESAMPLE_HIST;
+    if (drop > 0) {
+        memmove(ctx->buf, ctx->buf + drop * ctx->chans,
+                (ctx->len - drop) * bpf);
+        ctx->len  -= drop;
+        ctx->pos  -= drop;
+        ctx->base += drop;
+        need      -= drop;
+    }
+
+    while (need >= ctx->len && !ctx->eos) {
+        uint64_t t;
+        int n;
+
+        af->timestamp = 0;
+        if (filler(ud, af) < 0 || af->audio_len < bpf) {
+            ctx->eos  = TC_TRUE;
+            ctx->last = ctx->base + ctx->len;
+            break;
+        }
+        n = af->audio_len / bpf;
+        if (ctx->len + n > ctx->size) {
+            tc_log_error(__FILE__, "(%s) audio frame too large (%i bytes)",
+                         ctx->method_name, af->audio_len);
+            return TC_ERROR;
+        }
+        ac_memcpy(ctx->buf + ctx->len * ctx->chans, af->audio_buf, n * bpf);
+
+        /* update the audio clock */
+        t = af->timestamp;
+        if (t != 0) {
+            ctx->a_sample = ctx->base + ctx->len;
+            ctx->a_time   = t;
+        } else if (ctx->live) {
+            ctx->a_sample = ctx->base + ctx->len + n;
+            ctx->a_time   = tc_gettime();
+        }
+        ctx->len += n;
+    }
+
+    if (ctx->eos && ctx->base + ctx->pos >= ctx->last) {
+        return TC_ERROR;
+    }
+    if (need >= ctx->len) {
+        memset(ctx->buf + ctx->len * ctx->chans, 0,
+               (need + 1 - ctx->len) * bpf);
+        ctx->len = need + 1;
+    }
+    return TC_OK;
+}
+
+/* update the resampling ratio from the drift of the clocks */
+static void resample_adjust(ResampleContext *ctx)
+{
+    const double spf = ctx->rate / ctx->fps;
+    double vclock, error, corr;
+    uint64_t v_time;
+    long v_frame;
+
+    tc_mutex_lock(&ctx->lock);
+    v_time  = ctx->v_time;
+    v_frame = ctx->v_frame;
+    tc_mutex_unlock(&ctx->lock);
+
+    if (v_time == 0 || ctx->a_time == 0) {
+        return; /* nothing to compare */
+    }
+
+    /* video clock at the start of this audio frame */
+    vclock = (double)v_time + (ctx->frames - v_frame) * 1000000.0 / ctx->fps;
+    /* input samples we should have consumed, minus what we did */
+    error = ctx->a_sample
+          + ((vclock - (double)ctx->a_time) * ctx->rate) / 1000000.0
+          - (ctx->base + ctx->pos);
+    if (!ctx->measured) {
+        ctx->offset   = error;
+        ctx->measured = TC_TRUE;
+    }
+    ctx->drift += (error - ctx->offset - ctx->drift) / RESAMPLE_SMOOTHING;
+    if (fabs(ctx->drift) > ctx->max_drift) {
+        ctx->max_drift = fabs(ctx->drift);
+    }
+
+    /* proportional-integral control, critically damped */
+    ctx->integral += ctx->drift
+                   / (4.0 * RESAMPLE_REACTION * RESAMPLE_REACTION * spf);
+    ctx->integral = TC_CLAMP(ctx->integral,
+                             -RESAMPLE_MAX_CORR, RESAMPLE_MAX_CORR);
+    corr = ctx->drift / (RESAMPLE_REACTION * spf) + ctx->integral;
+    if (fabs(corr) > RESAMPLE_MAX_CORR) {
+        corr = (corr > 0) ?RESAMPLE_MAX_CORR :-RESAMPLE_MAX_CORR;
+        ctx->clamped++;
+    }
+    ctx->ratio = 1.0 + corr;
+}
+
+/* produce `n' output samples into `out' */
+static void resample_run(ResampleContext *ctx, int16_t *out, int n)
+{
+    const int chans = ctx->chans;
+    float coef[RESAMPLE_TAPS];
+    int i, c, t;
+
+    for (i = 0; i < n; i++) {
+        int ip = (int)ctx->pos;
+        double frac = ctx->pos - ip;
+        const int16_t *in = ctx->buf + (ip - RESAMPLE_HIST) * chans;
+
+        if (frac == 0.0) {
+            /* exactly on an input sample (always so with no drift) */
+            memcpy(out, ctx->buf + ip * chans, chans * sizeof(int16_t));
+        } else {
+            double ph = frac * RESAMPLE_PHASES;
+            int p = (int)ph;
+            float mu = ph - p;
+            const float *c0 = ctx->bank[p], *c1 = ctx->bank[p + 1];
+
+            for (t = 0; t < RESAMPLE_TAPS; t++) {
+                coef[t] = c0[t] + mu * (c1[t] - c0[t]);
+            }
+            for (c = 0; c < chans; c++) {
+                float acc = 0.0f;
+                long v;
+                for (t = 0; t < RESAMPLE_TAPS; t++) {
+                    acc += coef[t] * in[t * chans + c];
+                }
+                v = lrintf(acc);
+                out[c] = TC_CLAMP(v, -32768, 32767);
+            }
+        }
+        out += chans;
+        ctx->pos += ctx->ratio;
+    }
+}
+
+static int tc_sync_resample_get_video(TCSynchronizer *sy, TCFrameVideo *vf,
+                                      TCFillFrameVideo filler, void *ud)
+{
+    ResampleContext *ctx = NULL;
+    uint64_t t;
+    int ret;
+    TC_SYNC_ARG_CHECK(vf);
+    ctx = sy->privdata;
+
+    vf->timestamp = 0;
+    ret = filler(ud, vf);
+    if (ret >= 0) {
+        t = vf->timestamp;
+        if (t == 0 && ctx->live) {
+            t = tc_gettime();
+        }
+        tc_mutex_lock(&ctx->lock);
+        if (t != 0) {
+            ctx->v_time  = t;
+            ctx->v_frame = ctx->v_frames;
+        }
+        ctx->v_frames++;
+        tc_mutex_unlock(&ctx->lock);
+    }
+    return ret;
+}
+
+static int tc_sync_resample_get_audio(TCSynchronizer *sy, TCFrameAudio *af,
+                                      TCFillFrameAudio filler, void *ud)
+{
+    ResampleContext *ctx = NULL;
+    int bytes, n, need;
+    TC_SYNC_ARG_CHECK(af);
+    ctx = sy->privdata;
+
+    tc_sync_audio_shift(sy, af, filler, ud);
+
+    if (ctx->interval <= 1 || ctx->frames % ctx->interval == 0) {
+        resample_adjust(ctx);
+    }
+
+    bytes = resample_frame_bytes(ctx);
+    n     = bytes / (ctx->chans * sizeof(int16_t));
+    need  = (int)(ctx->pos + (n - 1) * ctx->ratio) + RESAMPLE_TAPS / 2;
+    if (resample_fill(ctx, need, af, filler, ud) != TC_OK) {
+        return TC_ERROR;
+    }
+    resample_run(ctx, (int16_t *)af->audio_buf, n);
+    af->audio_len  = bytes;
+    af->audio_size = bytes;
+    ctx->frames++;
+    return TC_OK;
+}
+
+static int tc_sync_resample_fini(TCSynchronizer *sy)
+{
+    if (sy) {
+        ResampleContext *ctx = sy->privdata;
+        if (ctx) {
+            if (sy->verbose >= TC_INFO) {
+                tc_log_info(__FILE__, "(%s) max drift: %.1f ms,"
+                            " final ratio: %.6f, saturated on %li frames",
+                            ctx->method_name,
+                            ctx->max_drift * 1000.0 / ctx->rate,
+                            ctx->ratio, ctx->clamped);
+            }
+            tc_free(ctx->buf);
+            tc_free(ctx);
+            sy->privdata = NULL;
+        }
+    }
+    return TC_OK;
+}
+
+static int tc_sync_resample_init_common(TCSynchronizer *sy, vob_t *vob,
+                                        int master, int live)
+{
+    ResampleContext *ctx = NULL;
+    int maxframe;
+
+    if (master != TC_AUDIO) {
+        tc_log_error(__FILE__,
+                     "(resample) only audio master source supported yet");
+        return TC_ERROR;
+    }
+    if (vob->im_a_codec != TC_CODEC_PCM || vob->a_bits != 16
+     || vob->a_chan <= 0 || vob->a_rate <= 0 || vob->fps <= 0) {
+        tc_log_error(__FILE__, "(resample) needs 16 bit PCM audio");
+        return TC_ERROR;
+    }
+
+    ctx = tc_zalloc(sizeof(ResampleContext));
+    if (!ctx) {
+        goto no_context;
+    }
+    ctx->chans      = vob->a_chan;
+    ctx->rate       = vob->a_rate;
+    ctx->fps        = vob->fps;
+    ctx->frame_size = vob->im_a_size;
+    ctx->leap_bytes = vob->a_leap_bytes;
+    ctx->interval   = vob->resync_frame_interval;
+
+    /* room for the filter, a full output frame and a chunk more */
+    maxframe  = (vob->im_a_size + abs(vob->a_leap_bytes))
+              / (ctx->chans * sizeof(int16_t)) + 1;
+    ctx->size = RESAMPLE_TAPS + 3 * maxframe;
+    ctx->buf  = tc_zalloc(ctx->size * ctx->chans * sizeof(int16_t));
+    if (!ctx->buf) {
+        goto no_buffer;
+    }
+    /* silence before the first sample feeds the filter history */
+    ctx->len   = RESAMPLE_HIST;
+    ctx->pos   = RESAMPLE_HIST;
+    ctx->base  = -RESAMPLE_HIST;
+    ctx->ratio = 1.0;
+    resample_init_bank(ctx);
+    tc_mutex_init(&ctx->lock);
+
+    ctx->method_name = (live) ?"resample_live" :"resample";
+    ctx->live        = live;
+    sy->method_name  = ctx->method_name;
+    sy->privdata     = ctx;
+    sy->audio_shift  = vob->sync;
+    sy->verbose      = vob->verbose;
+    sy->get_video    = tc_sync_resample_get_video;
+    sy->get_audio    = tc_sync_resample_get_audio;
+    sy->fini         = tc_sync_resample_fini;
+
+    if (sy->verbose >= TC_INFO) {
+        tc_log_info(__FILE__, "(%s) audio ratio adjusted up to %.1f%%,"
+                    " interval=%i", sy->method_name,
+                    RESAMPLE_MAX_CORR * 100.0, ctx->interval);
+    }
+    return TC_OK;
+
+no_buffer:
+    tc_free(ctx);
+no_context:
+    return TC_ERROR;
+}
+
+static int tc_sync_resample_init(TCSynchronizer *sy, vob_t *vob, int master)
+{
+    return tc_sync_resample_init_common(sy, vob, master, TC_FALSE);
+}
+
+static int tc_sync_resample_live_init(TCSynchronizer *sy, vob_t *vob,
+                                      int master)
+{
+    return tc_sync_resample_init_common(sy, vob, master, TC_TRUE);
+}
+
+
 
 /*************************************************************************/
 
 typedef struct tcsyncmethod_ TCSyncMethod;
 struct tcsyncmethod_ {
     TCSyncMethodID id;
+    const char *name;
     int (*init)(TCSynchronizer *sy, vob_t *vob, int master);
 };
 
 static const TCSyncMethod methods[] = {
-    { TC_SYNC_NONE,          tc_sync_none_init     },
-    { TC_SYNC_ADJUST_FRAMES, tc_sync_adjust_init   },
-    { TC_SYNC_NULL,          NULL                  },
+    { TC_SYNC_NONE,          "none",          tc_sync_none_init          },
+    { TC_SYNC_ADJUST_FRAMES, "adjust",        tc_sync_adjust_init        },
+    { TC_SYNC_RESAMPLE,      "resample",      tc_sync_resample_init      },
+    { TC_SYNC_RESAMPLE_LIVE, "resample_live", tc_sync_resample_live_init },
+    { TC_SYNC_NULL,          NULL,            NULL                       },
 };
 
 /* it doesn't yet make sense to have more than one synchro engine */
@@ -364,6 +793,17 @@ int tc_sync_init(vob_t *vob, TCSyncMethodID method, int master)
     return TC_ERROR;
 }
 
+TCSyncMethodID tc_sync_method_from_name(const char *name)
+{
+    int i;
+    for (i = 0; methods[i].id != TC_SYNC_NULL; i++) {
+        if (name && strcmp(methods[i].name, name) == 0) {
+            return methods[i].id;
+        }
+    }
+    return TC_SYNC_NULL;
+}
+
 int tc_sync_fini(void)
 {
     return tcsync.fini(&tcsync);
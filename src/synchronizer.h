@@ -39,6 +39,9 @@ enum tcsyncmethodid_ {
     TC_SYNC_NULL = -1,        /* NULL value (invalid method) */
     TC_SYNC_NONE = 0,         /* no method: don't mess with the sync */
     TC_SYNC_ADJUST_FRAMES,    /* use frame number to enforce the sync */
+    TC_SYNC_RESAMPLE,         /* resample audio to follow the timestamps */
+    TC_SYNC_RESAMPLE_LIVE,    /* as above, clocking frames at arrival
+                                 if they have no timestamp */
 };
 
 /*
@@ -76,6 +79,18 @@ typedef int (*TCFillFrameAudio)(void *ctx, TCFrameAudio *af);
  */
 int tc_sync_init(TCJob *vob, TCSyncMethodID method, int master);
 
+/*
+ * tc_sync_method_from_name:
+ *    look up a sync method by its user visible name
+ *    ("none", "adjust", "resample", "resample_live").
+ *
+ * Parameters:
+ *    name: name of the method.
+ * Return Value:
+ *    the identifier of the method, TC_SYNC_NULL if unknown.
+ */
+TCSyncMethodID tc_sync_method_from_name(const char *name);
+
 /*
  * tc_sync_fini:
  *    finalizes the Syncrhonizer engine and frees all acquired resources.
@@ -38,6 +38,7 @@
 #include "probe.h"
 #include "socket.h"
 #include "split.h"
+#include "synchronizer.h"
 
 #include "cmdline.h"
 
@@ -429,7 +430,7 @@ static int transcode_find_modules(TCSession *S)
 
 static int transcode_init(TCSession *session, const TCFrameSpecs *specs)
 {
-    int ret;
+    int i, ret;
     TCRunControl *runcontrol = tc_runcontrol_get_instance();
     TCJob *vob = session->job;
 
@@ -460,6 +461,15 @@ static int transcode_init(TCSession *session, const TCFrameSpecs *specs)
     ret = transcode_find_modules(session);
     RETURN_IF(ret != TC_OK, "can't setup export modules", TC_ERROR);
 
+    RETURN_IF(session->export_output_num > 0
+              && (session->core_mode == TC_MODE_PSU
+               || session->core_mode == TC_MODE_DVD_CHAPTER),
+              "--export_output is not supported in this mode", TC_ERROR);
+    for (i = 0; i < session->export_output_num; i++) {
+        ret = tc_export_add_output(session->export_outputs[i]);
+        RETURN_IF(ret != TC_OK, "bad --export_output", TC_ERROR);
+    }
+
     ret = tc_export_setup(session->ex_aud_mod, session->ex_vid_mod,
                           session->ex_mplex_mod, session->ex_mplex_mod_aux);
     RETURN_IF(ret != TC_OK, "failed to init the export modules", TC_ERROR);
@@ -554,8 +564,8 @@ static int transcode_mode_default(TCSession *session)
         tc_export_loop(tc_get_ringbuffer(vob, th_num, th_num),
                        session->frame_a, session->frame_b);
 
-        // check for user cancelation request
-        if (tc_interrupted()) {
+        // check for user cancelation request (or a settled analysis)
+        if (tc_interrupted() || tc_stopped()) {
             break;
         }
 
@@ -563,7 +573,9 @@ static int transcode_mode_default(TCSession *session)
         tstart = tstart->next;
         // see if we're using vob_offset
         if ((tstart != NULL) && (tstart->vob_offset != 0)) {
-            session->decoder_delay = 3;
+            // sampled analysis seeks a lot, don't stall on every window
+            session->decoder_delay =
+                (session->core_mode == TC_MODE_ANALYSIS) ?0 :3;
             tc_import_threads_cancel();
             tc_import_close();
             tc_framebuffer_flush();
@@ -941,6 +953,7 @@ static vob_t *new_vob(void)
     vob->im_v_width          = PAL_W;
     vob->im_v_height         = PAL_H;
     vob->im_v_size           = SIZE_RGB_FRAME;
+    vob->im_frames           = 0;
     vob->ex_a_size           = SIZE_PCM_FRAME;
     vob->ex_v_width          = PAL_W;
     vob->ex_v_height         = PAL_H;
@@ -1000,6 +1013,7 @@ static vob_t *new_vob(void)
     vob->decolor             = 0;
     vob->im_a_codec          = TC_CODEC_PCM;
     vob->im_v_codec          = TC_CODEC_YUV420P;
+    vob->im_v_threads        = 0;
     vob->mod_path            = tc_module_default_path();
     vob->audiologfile        = NULL;
     vob->divxlogfile         = NULL;
@@ -1084,6 +1098,7 @@ static vob_t *new_vob(void)
 
     vob->resync_frame_interval = 0;
     vob->resync_frame_margin   = 1;
+    vob->resync_method         = TC_SYNC_NULL;
 
     vob->rgbswap             = TC_FALSE;
     vob->pcmswap             = TC_FALSE;
@@ -1134,6 +1149,7 @@ static TCSession *new_session(TCJob *job)
     session->ex_vid_mod          = NULL;
     session->ex_mplex_mod        = NULL;
     session->ex_mplex_mod_aux    = NULL;
+    session->export_output_num   = 0;
 
     session->plugins_string      = NULL;
 
@@ -1144,6 +1160,11 @@ static TCSession *new_session(TCJob *job)
 
     session->psu_frame_threshold = 12;
     /* FIXME: magic number */
+
+    session->sample_windows      = 0;
+    session->sample_keyframes    = 0;
+    session->sample_length       = 25;
+    session->sample_settle       = 250;
     
     // FIXME: those must go away soon
     // begin
@@ -1177,6 +1198,7 @@ static TCSession *new_session(TCJob *job)
     session->hw_threads          = 1;  /* sane fallback */
     tc_sys_get_hw_threads(&(session->hw_threads));
     session->max_frame_threads   = session->hw_threads;
+    session->import_threads      = 0;
 
     session->progress_meter      = -1;
     session->progress_rate       = 1;
@@ -1306,6 +1328,194 @@ static void parse_navigation_file(vob_t *vob, const char *nav_seek_file)
 
 /*************************************************************************/
 
+/*
+ * read_nav_keyframes:
+ *      collect the keyframe positions listed in a navigation data file
+ *      (the same aviindex or tcdemux -W files parse_navigation_file reads).
+ *
+ * Parameters:
+ *      nav_seek_file: Path of navigation file.
+ *              nkeys: Where to store the number of keyframes found.
+ *             frames: Where to store the total number of video frames.
+ * Return Value:
+ *      Array of keyframe indices in ascending order, to be freed by the
+ *      caller; NULL if no keyframes were found.
+ */
+static int *read_nav_keyframes(const char *nav_seek_file,
+                               int *nkeys, long *frames)
+{
+    FILE *fp = NULL;
+    char buf[TC_BUF_MIN];
+    int *keys = NULL;
+    int size = 0;
+    int is_aviindex = 0;
+    long line_count = 0;
+
+    *nkeys = 0;
+    *frames = 0;
+
+    fp = fopen(nav_seek_file, "r");
+    if (NULL == fp) {
+        tc_error("unable to open: %s", nav_seek_file);
+    }
+
+    // aviindex files start with a magic and a comment line
+    if (fgets(buf, sizeof(buf), fp)
+     && strncasecmp(buf, "AVIIDX1", 7) == 0) {
+        is_aviindex = 1;
+        if (!fgets(buf, sizeof(buf), fp))
+            *buf = 0;
+    } else {
+        fseek(fp, 0, SEEK_SET);
+    }
+
+    for (; fgets(buf, sizeof(buf), fp); line_count++) {
+        long frame = -1;
+        int key = 0;
+
+        if (!is_aviindex) {
+            int n;
+
+            // one line per frame, n is the frame number within its GOP
+            if (1 == sscanf(buf, "%*d %*d %*d %*d %*d %d", &n)) {
+                frame = line_count;
+                key = (n == 0);
+            }
+        } else {
+            long chunk, chunkptype;
+            long long pos, len;
+            char tag[8];
+            int type;
+
+            // TAG TYPE CHUNK CHUNK/TYPE POS LEN KEY MS
+            if (7 == sscanf(buf, "%7s %d %ld %ld %lld %lld %d",
+                            tag, &type, &chunk, &chunkptype, &pos, &len,
+                            &key)
+             && type == 1) {
+                frame = chunkptype;
+            }
+        }
+        if (frame < 0)
+            continue;
+
+        if (frame >= *frames)
+            *frames = frame + 1;
+        if (key) {
+            if (*nkeys >= size) {
+                size = size ? size * 2 : 256;
+                keys = tc_realloc(keys, size * sizeof(*keys));
+                if (!keys)
+                    tc_error("out of memory reading %s", nav_seek_file);
+            }
+            keys[(*nkeys)++] = frame;
+        }
+    }
+    fclose(fp);
+
+    return keys;
+}
+
+/*
+ * setup_sample_windows:
+ *      replace the frame ranges to process with the sample windows of an
+ *      analysis run: either session->sample_windows windows spread evenly
+ *      over the given ranges, or one window at every
+ *      session->sample_keyframes'th keyframe listed in the navigation
+ *      file.  Each window is session->sample_length frames long; windows
+ *      which overlap are merged.  With a navigation file, the windows
+ *      are later turned into keyframe seeks by parse_navigation_file, so
+ *      the frames between them are never decoded at all.
+ *
+ * Parameters:
+ *                vob: Pointer to the global vob_t data structure.
+ *      nav_seek_file: Path of navigation file, or NULL.
+ * Return Value:
+ *      None
+ */
+static void setup_sample_windows(vob_t *vob, const char *nav_seek_file)
+{
+    struct fc_time *range = NULL, *head = NULL, *tail = NULL;
+    int *keys = NULL;
+    int nkeys = 0, nwin = 0, k = 0, i = 0;
+    long first = 0, last = 0, frames = 0, total = 0;
+
+    if (nav_seek_file)
+        keys = read_nav_keyframes(nav_seek_file, &nkeys, &frames);
+    if (session->sample_keyframes > 0 && !keys)
+        tc_error("--sample_keyframes needs the keyframes of a"
+                 " --nav_seek file");
+
+    // analyse the span covered by the given ranges
+    first = vob->ttime->stf;
+    for (range = vob->ttime; range->next; range = range->next)
+        ;
+    last = range->etf;
+    if (last == TC_FRAME_LAST) {
+        last = (frames > 0) ? frames : vob->im_frames;
+        if (last <= 0)
+            tc_error("source length unknown, please give the frames to"
+                     " analyse with -c");
+    }
+    if (last <= first)
+        tc_error("nothing to analyse in frames %ld-%ld", first, last);
+
+    // skip the keyframes before the span
+    while (k < nkeys && keys[k] < first)
+        k++;
+
+    for (i = 0; ; i++) {
+        long start, end;
+
+        if (session->sample_keyframes > 0) {
+            if (k + i * session->sample_keyframes >= nkeys)
+                break;
+            start = keys[k + i * session->sample_keyframes];
+            if (start >= last)
+                break;
+        } else {
+            if (i >= session->sample_windows)
+                break;
+            start = first + (long)((double)(last - first) * i
+                                   / session->sample_windows);
+        }
+        end = start + session->sample_length;
+        if (end > last)
+            end = last;
+
+        if (tail && start <= (long)tail->etf) {
+            // overlaps (or touches) the previous window
+            if (end > (long)tail->etf)
+                set_fc_time(tail, -1, end);
+            continue;
+        }
+        range = new_fc_time();
+        if (!range)
+            tc_error("out of memory setting up sample windows");
+        range->fps = vob->fps;
+        set_fc_time(range, start, end);
+        if (tail)
+            tail->next = range;
+        else
+            head = range;
+        tail = range;
+    }
+    free(keys);
+
+    if (!head)
+        tc_error("no frames to analyse, check -c and --sample options");
+
+    free_fc_time(vob->ttime);
+    vob->ttime = head;
+
+    for (nwin = 0, range = head; range; range = range->next, nwin++)
+        total += range->etf - range->stf;
+    if (verbose >= TC_INFO)
+        tc_log_info(PACKAGE, "analysis: %d window%s, %ld of %ld frames",
+                    nwin, nwin == 1 ? "" : "s", total, last - first);
+}
+
+/*************************************************************************/
+
 static void handle_keep_asr(vob_t *vob)
 {
     int clip, zoomto;
@@ -1617,6 +1827,18 @@ int main(int argc, char *argv[])
         }
     }
 
+    if (session->core_mode == TC_MODE_ANALYSIS) {
+        // only the filters get to see the frames, nothing is written
+        if (session->ex_vid_mod == NULL)
+            session->ex_vid_mod = "null";
+        if (session->ex_aud_mod == NULL)
+            session->ex_aud_mod = "null";
+        if (session->ex_mplex_mod == NULL)
+            session->ex_mplex_mod = "null";
+        if (vob->video_out_file == NULL)
+            vob->video_out_file = TC_DEFAULT_OUT_FILE;
+    }
+
     if (session->psu_mode) {
         if (vob->video_out_file == NULL)
             tc_error("please specify output file name for psu mode");
@@ -1713,6 +1935,8 @@ int main(int argc, char *argv[])
         vob->ttime->etf = TC_FRAME_LAST;
         vob->ttime->next = NULL;
     }
+    if (session->core_mode == TC_MODE_ANALYSIS)
+        setup_sample_windows(vob, nav_seek_file);
     session->frame_a = vob->ttime->stf;
     session->frame_b = vob->ttime->etf;
     vob->ttime->vob_offset = 0;
@@ -2587,6 +2811,10 @@ int main(int argc, char *argv[])
     if (socket_file)
         if (!tc_socket_init(socket_file))
             tc_error("failed to initialize socket handler");
+
+    // latency statistics can be asked through the socket at any time
+    if (socket_file || latency_file)
+        tc_latency_enable(TC_TRUE);
     
     // now we start the signal handler thread
     if (pthread_create(&event_thread_id, NULL, event_thread, &sigs_to_block) != 0)
@@ -2620,6 +2848,11 @@ int main(int argc, char *argv[])
         transcode_mode_dvd(session);
         break;
 
+      case TC_MODE_ANALYSIS:
+        tc_filter_set_settle(session->sample_settle);
+        transcode_mode_default(session);
+        break;
+
       case TC_MODE_DEBUG:
         /* FIXME: get rid of this? */
         tc_log_msg(PACKAGE, "debug \"core\" mode");
@@ -2662,6 +2895,11 @@ int main(int argc, char *argv[])
     SHUTDOWN_MARK("control socket");
     tc_socket_fini();
 
+    if (latency_file) {
+        SHUTDOWN_MARK("latency statistics");
+        tc_latency_write(latency_file);
+    }
+
     // all done
     SHUTDOWN_MARK("completed");
 
@@ -94,6 +94,10 @@ struct tcsession_ {
     const char *ex_mplex_mod;
     const char *ex_mplex_mod_aux;
 
+    /* secondary outputs (see tc_export_add_output) */
+    const char *export_outputs[TC_EXPORT_OUTPUTS_MAX];
+    int export_output_num;
+
     char *plugins_string;
 
     char *nav_seek_file;
@@ -112,10 +116,16 @@ struct tcsession_ {
 
     int max_frame_buffers;
     int max_frame_threads;
+    int import_threads; /* video decoding threads, split modules only */
     int hw_threads;
     /* how many threads the HW can do in parallel? */
 
     int psu_frame_threshold;
+
+    int sample_windows;   /* analysis mode: windows spread over the source */
+    int sample_keyframes; /* analysis mode: window at every Nth keyframe */
+    int sample_length;    /* analysis mode: frames per window */
+    int sample_settle;    /* analysis mode: stop after N unchanged frames */
     
     // FIXME: those must go away soon
     // begin
@@ -203,8 +213,17 @@ enum {
     TC_IMPORT_OPEN,
     TC_IMPORT_DECODE,
     TC_IMPORT_CLOSE,
+    TC_IMPORT_READ,    /* TC_CAP_SPLIT only: fetch a compressed frame    */
+    TC_IMPORT_UNPACK,  /* TC_CAP_SPLIT only: decode it, must be reentrant */
 };
 
+/*
+ * TC_IMPORT_READ fails with `size' set to 0 at the end of the stream,
+ * and with `size' set to the room it needs, reading nothing, when the
+ * buffer is too small for the next packet; after any other failure
+ * `size' is left untouched.
+ */
+
 enum {
     TC_IMPORT_ERROR    = -1,
     TC_IMPORT_OK       =  0,
@@ -223,6 +242,7 @@ enum {
     TC_CAP_YUY2   = 128,
     TC_CAP_DV     = 256,
     TC_CAP_YUV422 = 512,
+    TC_CAP_SPLIT  = 1024, /* decoding can be split in READ+UNPACK */
 };
 
 /*************************************************************************/
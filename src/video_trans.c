@@ -150,6 +150,27 @@ static void preadjust_frame_size(video_trans_data_t *vtd, int new_w, int new_h)
 
 /*************************************************************************/
 
+/**
+ * make_writable:  Make sure the frame owns the picture it shows before
+ * modifying it in place, since shared pictures are read-only (see
+ * tcframes.h).  Also sets up the plane pointers again if needed.
+ *
+ * Parameters:
+ *     vtd: Pointer to video frame data.
+ * Return value:
+ *     None.
+ */
+
+static void make_writable(video_trans_data_t *vtd)
+{
+    if (vtd->ptr->payload) {
+        tc_unshare_video_frame(vtd->ptr);
+        set_vtd(vtd, vtd->ptr);
+    }
+}
+
+/*************************************************************************/
+
 /**
  * swap_buffers:  Swap current video frame buffer with free buffer.  Also
  * updates frame size if preadjust_frame_size() has been called.
@@ -164,6 +185,8 @@ static void swap_buffers(video_trans_data_t *vtd)
 {
     vtd->ptr->video_buf = vtd->ptr->video_buf_Y[vtd->ptr->free];
     vtd->ptr->free = (vtd->ptr->free==0) ? 1 : 0;
+    /* A shared picture (see tcframes.h) has just been left behind */
+    tc_unshare_video_frame(vtd->ptr);
     /* Install new width/height if preadjust_frame_size() was called */
     if (vtd->preadj_w && vtd->preadj_h) {
         vtd->ptr->v_width = vtd->preadj_w;
@@ -360,6 +383,7 @@ static int do_process_frame(vob_t *vob, vframe_list_t *ptr)
     /**** -k: red/blue swap ****/
 
     if (vob->rgbswap) {
+        make_writable(&vtd);
         if (ptr->v_codec == TC_CODEC_RGB24) {
             int i;
             for (i = 0; i < ptr->v_width * ptr->v_height; i++) {
@@ -379,6 +403,7 @@ static int do_process_frame(vob_t *vob, vframe_list_t *ptr)
     /**** -K: grayscale ****/
 
     if (vob->decolor) {
+        make_writable(&vtd);
         if (ptr->v_codec == TC_CODEC_RGB24) {
             /* Convert to 8-bit grayscale, then back to RGB24.  Just
              * averaging the values won't give us the right intensity. */
@@ -398,6 +423,7 @@ static int do_process_frame(vob_t *vob, vframe_list_t *ptr)
     /**** -G: gamma correction ****/
 
     if (vob->dgamma) {
+        make_writable(&vtd);
         /* Only process the first plane (Y) for YUV; for RGB it's all in
          * one plane anyway */
         tcv_gamma_correct(handle, ptr->video_buf, ptr->video_buf,
@@ -458,8 +484,13 @@ int process_vid_frame(vob_t *vob, vframe_list_t *ptr)
      || vob->im_v_codec == TC_CODEC_YUV420P
      || vob->im_v_codec == TC_CODEC_YUV422P
     ) {
+        uint64_t start = tc_latency_now();
+        int ret;
+
         ptr->v_codec = vob->im_v_codec;
-        return do_process_frame(vob, ptr);
+        ret = do_process_frame(vob, ptr);
+        tc_latency_record(TC_LATENCY_VIDEO_PROCESS, start);
+        return ret;
     }
 
     /* Invalid colorspace, bail out */
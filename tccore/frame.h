@@ -79,6 +79,8 @@ enum tcframeattributes_ {
     TC_FRAME_IS_OUT_OF_RANGE   =  64,
     TC_FRAME_IS_DELAYED        = 128,
     TC_FRAME_IS_END_OF_STREAM  = 256,
+    TC_FRAME_IS_BORROWED       = 512, /* payload not owned, see tcframes.h */
+    TC_FRAME_IS_REPEAT         =1024, /* same picture as the previous one */
 };
 
 #define TC_FRAME_NEED_PROCESSING(PTR) \
@@ -249,6 +251,9 @@ struct tcframevideo_ {
     uint8_t *video_buf_Y[2];
     uint8_t *video_buf_U[2];
     uint8_t *video_buf_V[2];
+
+    int video_buf_size; /* allocated size of each internal buffer */
+    struct tcframepayload_ *payload; /* shown but not owned, see tcframes.h */
 };
 typedef struct tcframevideo_ vframe_list_t;
 
@@ -172,6 +172,7 @@ struct _vob_t {
     int im_v_height;            // Import picture height
     int im_v_width;             // Import picture width
     int im_v_size;              // Total number of bytes per frame
+    long im_frames;             // Total number of frames (0 if unknown)
 
     int im_asr;                 // Import aspect ratio code
     int im_par;                 // Import pixel aspect (code)
@@ -185,6 +186,7 @@ struct _vob_t {
     int attributes;             // More video frame attributes
 
     int im_v_codec;             // True frame buffer video codec
+    int im_v_threads;           // Parallel decoding threads (0: serial)
 
     int encode_fields;          // Interlaced field handling flag
 
@@ -262,6 +264,7 @@ struct _vob_t {
 
     int resync_frame_interval;
     int resync_frame_margin;
+    int resync_method;          // TCSyncMethodID, -1: depends on -M
 
     // Encoding parameters
 
@@ -332,6 +335,7 @@ enum {
     TC_MODE_PSU         =  4,
     TC_MODE_DIRECTORY   = 16,
     TC_MODE_DEBUG       = 32,
+    TC_MODE_ANALYSIS    = 64,
 };
 
 enum {
@@ -83,6 +83,7 @@ enum tcmediatype_ {
 
 #define TC_IMPORT             8192
 #define TC_EXPORT            16384
+#define TC_FILTER_DRAIN      32768
 
 #define TC_DELAY_MAX         40000
 #define TC_DELAY_MIN         10000
@@ -94,8 +95,11 @@ enum tcmediatype_ {
 #define TC_DEFAULT_EXPORT_MPLEX "null"
 
 #define TC_FRAME_BUFFER        10
+#define TC_FRAME_BUFFER_MAX   256
 #define TC_FRAME_THREADS        1
 #define TC_FRAME_THREADS_MAX   32
+#define TC_IMPORT_THREADS_MAX  16
+#define TC_EXPORT_OUTPUTS_MAX   8
 
 #define TC_FRAME_FIRST          0
 #define TC_FRAME_LAST     INT_MAX
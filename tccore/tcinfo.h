@@ -86,6 +86,7 @@ typedef struct {
     long format;        // Specifies raw stream format for output
     int select;         // Selected packet payload type
     int accel; 
+    int threads;        // Decoding threads (intra-only codecs)
 } decode_t;
 
 /*************************************************************************/
@@ -0,0 +1,166 @@
+#!/usr/bin/python
+#
+# tcbench.py -- end-to-end throughput benchmark for the transcode pipeline.
+#
+# This file is part of transcode, a video stream processing tool.
+# transcode is free software, distributable under the terms of the GNU
+# General Public License (version 2 or later).  See the file COPYING
+# for details.
+#
+# Frames are synthesized by import_framegen (color wave, pink noise) and
+# thrown away by encode_null/multiplex_null, so what is measured is the
+# core itself: import threads, framebuffer ring, frame threads, filters
+# and export loop. A grid of resolutions, pixel formats, filter chains,
+# thread counts and ring sizes is swept; every run produces one JSON
+# object on a line of its own:
+#
+#   { "size": "720x576", "format": "yuv420p", "filters": "smooth",
+#     "threads": 2, "buffers": 10, "frames": 500, "status": 0,
+#     "missing": [], "seconds": 3.512, "fps": 142.37, "maxrss_kb": 24612,
+#     "stages": [ { "name": "video.read", "count": 500, ... }, ... ] }
+#
+# "stages" is the --latency_stats dump of the run (microseconds).
+# "status" is the exit status of transcode (minus the signal number if
+# it was killed); a run where some filter of the chain never ran (e.g.
+# it failed to load or to initialize) has status 1 even if transcode
+# exited cleanly, and those filters are listed in "missing".
+#
+# Usage example:
+#   python tcbench.py --transcode=../src/transcode \
+#       --sizes=720x576,1920x1080 --threads=1,2,4 --filters="none;smooth"
+
+import json
+import optparse
+import os
+import re
+import subprocess
+import sys
+import tempfile
+import time
+
+def _split(value, sep=','):
+    return [ v.strip() for v in value.split(sep) if v.strip() ]
+
+def _ints(value):
+    return [ int(v) for v in _split(value) ]
+
+def chain_filters(chain):
+    """Names of the filters of a -J chain, split as transcode does."""
+    if chain == 'none':
+        return []
+    parts = re.split(r'(?<!\\),', chain)
+    return [ p.split('=', 1)[0] for p in parts if p ]
+
+def missing_filters(chain, stages):
+    """Filters of the chain with no latency stage, i.e. which never ran."""
+    names = [ s.get('name', '') for s in stages if s.get('count', 0) > 0 ]
+    return [ f for f in chain_filters(chain)
+             if not [ n for n in names if n.startswith('filter.%s#' % f) ] ]
+
+def make_cmdline(opts, size, fmt, chain, threads, buffers, stats):
+    cmd = [ opts.transcode,
+            '-q', '0',
+            '-i', '/dev/zero',    # framegen ignores it, but needs one
+            '-H', '0',
+            '-x', 'framegen',
+            '-g', size,
+            '-V', fmt,
+            '-c', '0-%i' % opts.frames,
+            '-u', str(buffers),
+            '--threads', str(threads),
+            '-y', 'V=null,A=null,M=null',
+            '-o', '/dev/null',
+            '--latency_stats', stats ]
+    if opts.import_threads > 0:
+        cmd += [ '--import_threads', str(opts.import_threads) ]
+    if chain != 'none':
+        cmd += [ '-J', chain ]
+    return cmd
+
+def run_case(opts, size, fmt, chain, threads, buffers):
+    fd, stats = tempfile.mkstemp(prefix='tcbench-', suffix='.json')
+    os.close(fd)
+    res = { 'size': size, 'format': fmt, 'filters': chain,
+            'threads': threads, 'buffers': buffers, 'frames': opts.frames }
+    try:
+        cmd = make_cmdline(opts, size, fmt, chain, threads, buffers, stats)
+        null = open(os.devnull, 'w')
+        start = time.time()
+        proc = subprocess.Popen(cmd, stdout=null, stderr=null)
+        # wait4 gives the usage of this very child, so the RSS peak
+        # is not polluted by the previous (maybe bigger) runs
+        pid, status, usage = os.wait4(proc.pid, 0)
+        elapsed = time.time() - start
+        null.close()
+
+        if os.WIFEXITED(status):
+            res['status'] = os.WEXITSTATUS(status)
+        else:
+            res['status'] = -os.WTERMSIG(status)
+        res['seconds'] = round(elapsed, 3)
+        res['fps'] = round(opts.frames / elapsed, 2) if elapsed > 0 else 0
+        res['maxrss_kb'] = usage.ru_maxrss
+        try:
+            f = open(stats)
+            res['stages'] = json.load(f)['stages']
+            f.close()
+        except (IOError, ValueError):
+            res['stages'] = []
+        res['missing'] = missing_filters(chain, res['stages'])
+        if res['missing'] and res['status'] == 0:
+            res['status'] = 1
+    finally:
+        os.unlink(stats)
+    return res
+
+def main(args):
+    parser = optparse.OptionParser(usage='%prog [options]')
+    parser.add_option('--transcode', default='transcode',
+                      help='transcode binary to benchmark [%default]')
+    parser.add_option('--frames', type='int', default=500,
+                      help='frames to process in each run [%default]')
+    parser.add_option('--sizes', default='352x288,720x576,1920x1080',
+                      help='comma separated frame sizes [%default]')
+    parser.add_option('--formats', default='yuv420p,yuv422p,rgb24',
+                      help='comma separated internal formats [%default]')
+    parser.add_option('--filters', default='none;smooth',
+                      help='semicolon separated filter chains, "none" for'
+                           ' no filters [%default]')
+    parser.add_option('--threads', default='1,2,4',
+                      help='comma separated frame thread counts [%default]')
+    parser.add_option('--buffers', default='10,32',
+                      help='comma separated framebuffer ring sizes'
+                           ' [%default]')
+    parser.add_option('--import_threads', type='int', default=0,
+                      help='import decoding threads, 0 to leave the'
+                           ' default [%default]')
+    parser.add_option('--output', default='-',
+                      help='file to write the results to [stdout]')
+    opts, rest = parser.parse_args(args)
+    if rest:
+        parser.error('unexpected arguments: %s' % ' '.join(rest))
+
+    if opts.output == '-':
+        out = sys.stdout
+    else:
+        out = open(opts.output, 'w')
+
+    failed = 0
+    for size in _split(opts.sizes):
+        for fmt in _split(opts.formats):
+            for chain in _split(opts.filters, ';'):
+                for threads in _ints(opts.threads):
+                    for buffers in _ints(opts.buffers):
+                        res = run_case(opts, size, fmt, chain,
+                                       threads, buffers)
+                        if res['status'] != 0:
+                            failed += 1
+                        out.write(json.dumps(res, sort_keys=True) + '\n')
+                        out.flush()
+
+    if out is not sys.stdout:
+        out.close()
+    return 1 if failed else 0
+
+if __name__ == '__main__':
+    sys.exit(main(sys.argv[1:]))
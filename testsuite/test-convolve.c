@@ -0,0 +1,254 @@
+/*
+ * test-convolve.c - check the accelerated aclib neighbourhood operations
+ *                   against the C ones
+ *
+ * This file is part of transcode, a video stream processing tool.
+ * transcode is free software, distributable under the terms of the GNU
+ * General Public License (version 2 or later).  See the file COPYING
+ * for details.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "config.h"
+
+#define ac_rows_mean local_ac_rows_mean  /* to avoid clash with libac.a */
+#define ac_rows_min local_ac_rows_min
+#define ac_rows_max local_ac_rows_max
+#define ac_rows_convolve local_ac_rows_convolve
+#define ac_rows_convolve32 local_ac_rows_convolve32
+#define ac_box_mean local_ac_box_mean
+#define ac_convolve_init local_ac_convolve_init
+#include "aclib/ac.h"
+
+/* Include convolve.c directly for access to the implementations */
+#include "../aclib/convolve.c"
+
+#define ROWS    80      /* rows in the test picture */
+#define WIDTH   300     /* bytes per row, with room for offsets */
+#define SPILL   16      /* bytes checked past the end of the output */
+
+/* Value of the bytes the functions should not touch */
+static const uint8_t UNTOUCHED = 0x5A;
+
+/*************************************************************************/
+
+static uint8_t picture[ROWS][WIDTH];
+static uint32_t picture32[ROWS][WIDTH];
+
+static void make_picture(int seed)
+{
+    int x, y;
+
+    srand(seed);
+    for (y = 0; y < ROWS; y++) {
+        for (x = 0; x < WIDTH; x++) {
+            /* the extremes often, to catch overflows */
+            int r = rand() % 8;
+            picture[y][x] = (r == 0) ? 0 : (r == 1) ? 255 : rand() % 256;
+            picture32[y][x] = (r == 2) ? 0xFFFFFFFF : (uint32_t)rand() * 7;
+        }
+    }
+}
+
+/* Picks `n' rows, starting at a random byte. */
+static void pick_rows(const uint8_t **rows, const uint32_t **rows32, int n)
+{
+    int i, x = rand() % 17;
+
+    for (i = 0; i < n; i++) {
+        int y = rand() % ROWS;
+        rows[i] = &picture[y][x];
+        rows32[i] = &picture32[y][x];
+    }
+}
+
+/*************************************************************************/
+
+/* Runs every function once with the C and the SSE2 version; returns 1
+ * if they agree and stay in bounds, 0 if not. */
+
+static int test_once(int n, int count, int weightbits, int verbose)
+{
+#if defined(HAVE_ASM_SSE2) && defined(ARCH_X86_64)
+    const uint8_t *rows[MAX_CONV_ROWS+8];
+    const uint32_t *rows32[MAX_CONV_ROWS+8];
+    uint32_t kernel[MAX_CONV_ROWS+8];
+    uint8_t out_c[WIDTH+SPILL], out_sse2[WIDTH+SPILL];
+    uint32_t out32_c[WIDTH+SPILL], out32_sse2[WIDTH+SPILL];
+    const char *failed = NULL;
+    int i;
+
+    pick_rows(rows, rows32, n);
+    for (i = 0; i < n; i++) {
+        kernel[i] = (weightbits < 32) ? rand() % (1 << weightbits)
+                                      : (uint32_t)rand() * 3;
+    }
+
+#define COMPARE(name, c_call, sse2_call, out1, out2) do {               \
+    memset(out1, UNTOUCHED, sizeof(out1));                              \
+    memset(out2, UNTOUCHED, sizeof(out2));                              \
+    c_call;                                                             \
+    sse2_call;                                                          \
+    if (!failed && memcmp(out1, out2, sizeof(out1)) != 0)               \
+        failed = name;                                                  \
+} while (0)
+
+    if (n <= MAX_MEAN_ROWS + 4) {
+        COMPARE("mean", rows_mean(rows, n, out_c, count),
+                rows_mean_sse2(rows, n, out_sse2, count), out_c, out_sse2);
+    }
+    COMPARE("min", rows_min(rows, n, out_c, count),
+            rows_min_sse2(rows, n, out_sse2, count), out_c, out_sse2);
+    COMPARE("max", rows_max(rows, n, out_c, count),
+            rows_max_sse2(rows, n, out_sse2, count), out_c, out_sse2);
+    COMPARE("convolve", rows_convolve(rows, kernel, n, out32_c, count),
+            rows_convolve_sse2(rows, kernel, n, out32_sse2, count),
+            out32_c, out32_sse2);
+    COMPARE("convolve32", rows_convolve32(rows32, kernel, n, out32_c, count),
+            rows_convolve32_sse2(rows32, kernel, n, out32_sse2, count),
+            out32_c, out32_sse2);
+
+#undef COMPARE
+
+    if (failed && verbose > 0) {
+        printf("FAILED (%s, %d rows, %d samples, %d bit weights)\n",
+               failed, n, count, weightbits);
+    }
+    return failed ? 0 : 1;
+#else
+    return -1;
+#endif
+}
+
+static int test_sse2(int verbose)
+{
+    static const int weightbits[] = { 8, 15, 16, 32, 0 };
+    int n, count, w, ret = 1;
+
+    if (!(ac_cpuinfo() & AC_SSE2)) {
+        printf("WARNING: unable to test (no support in CPU)\n");
+        return -1;
+    }
+    make_picture(1);
+    for (n = 1; n <= MAX_CONV_ROWS + 4 && ret > 0; n++) {
+        for (count = 0; count <= WIDTH - 20 && ret > 0; count += 1 + count/8) {
+            for (w = 0; weightbits[w] > 0 && ret > 0; w++) {
+                ret = test_once(n, count, weightbits[w], verbose);
+            }
+        }
+    }
+    if (ret < 0) {
+        printf("WARNING: unable to test (wrong architecture or not"
+               " compiled in)\n");
+    }
+    return ret;
+}
+
+/*************************************************************************/
+
+/* The box mean, direct or sliding, against the definition. */
+
+static int test_box(int verbose)
+{
+    uint8_t out[WIDTH+SPILL];
+    int n, step, count, i, j;
+
+    make_picture(2);
+    for (n = 1; n <= 40; n++) {
+        for (step = 1; step <= 4; step++) {
+            count = WIDTH - SPILL - (n-1)*step;
+            if (count <= 0)
+                continue;
+            memset(out, UNTOUCHED, sizeof(out));
+            ac_box_mean(picture[n], n, step, out, count);
+            for (i = 0; i < count + SPILL; i++) {
+                int expect = UNTOUCHED;
+                if (i < count) {
+                    expect = 0;
+                    for (j = 0; j < n; j++)
+                        expect += picture[n][i + j*step];
+                    expect /= n;
+                }
+                if (out[i] != expect) {
+                    if (verbose > 0) {
+                        printf("FAILED (n=%d, step=%d, byte %d)\n",
+                               n, step, i);
+                    }
+                    return 0;
+                }
+            }
+        }
+    }
+    return 1;
+}
+
+/*************************************************************************/
+
+int main(int argc, char *argv[])
+{
+    int verbose = 1;
+    int ch, ret, failed = 0;
+
+    while ((ch = getopt(argc, argv, "hq")) != EOF) {
+        if (ch == 'q') {
+            verbose = 0;
+        } else {
+            fprintf(stderr,
+                    "Usage: %s [-q]\n"
+                    "-q: quiet (don't print test names)\n",
+                    argv[0]);
+            return 1;
+        }
+    }
+
+    if (verbose > 0) {
+        printf("rows sse2: ");
+        fflush(stdout);
+    }
+    ret = test_sse2(verbose);
+    if (ret == 0) {
+        failed = 1;
+    } else if (ret > 0 && verbose > 0) {
+        printf("ok\n");
+    }
+
+    if (verbose > 0) {
+        printf("box mean C: ");
+        fflush(stdout);
+    }
+    ac_convolve_init(AC_NONE);
+    if (!test_box(verbose)) {
+        failed = 1;
+    } else if (verbose > 0) {
+        printf("ok\n");
+    }
+
+    if (verbose > 0) {
+        printf("box mean accelerated: ");
+        fflush(stdout);
+    }
+    ac_convolve_init(ac_cpuinfo());
+    if (!test_box(verbose)) {
+        failed = 1;
+    } else if (verbose > 0) {
+        printf("ok\n");
+    }
+
+    return failed ? 1 : 0;
+}
+
+/*************************************************************************/
+
+/*
+ * Local variables:
+ *   c-file-style: "stroustrup"
+ *   c-file-offsets: ((case-label . *) (statement-case-intro . *))
+ *   indent-tabs-mode: nil
+ * End:
+ *
+ * vim: expandtab shiftwidth=4:
+ */
@@ -0,0 +1,384 @@
+/*
+ * test-deepcolor.c - check the conversions between the high bit depth
+ *                    YUV formats and the 8-bit ones, and the 16-bit
+ *                    paths of tcv_clip() and tcv_zoom()
+ *
+ * This file is part of transcode, a video stream processing tool.
+ * transcode is free software, distributable under the terms of the GNU
+ * General Public License (version 2 or later).  See the file COPYING
+ * for details.
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "config.h"
+
+/* to avoid clash with libac.a */
+#define ac_imgconvert_init_yuv_deep local_ac_imgconvert_init_yuv_deep
+#include "aclib/ac.h"
+#include "aclib/imgconvert.h"
+
+/* Include img_yuv_deep.c directly for access to the row kernels */
+#include "../aclib/img_yuv_deep.c"
+
+#undef ac_imgconvert_init_yuv_deep
+#include "libtcvideo/tcvideo.h"
+
+#define WIDTH   104     /* test picture width (a multiple of 8, for the */
+#define HEIGHT  40      /*   4x4 dither blocks of the U/V planes)       */
+#define COUNT   300     /* samples in the row kernel test */
+
+/* Value of the samples the functions should not touch */
+#define UNTOUCHED 0x5A5A
+
+/*************************************************************************/
+
+static uint8_t picture[WIDTH*HEIGHT*3];
+static uint16_t deep[WIDTH*HEIGHT*3];
+
+static void make_picture(int seed)
+{
+    int i;
+
+    srand(seed);
+    for (i = 0; i < WIDTH*HEIGHT*3; i++) {
+        /* the extremes often, to catch overflows */
+        int r = rand() % 8;
+        picture[i] = (r == 0) ? 0 : (r == 1) ? 255 : rand() % 256;
+        deep[i] = (r == 0) ? 0 : (r == 1) ? 0xFFFF : (r == 2) ? 1023
+                : rand() % 0x10000;
+    }
+}
+
+/*************************************************************************/
+
+/* Runs the row kernels on COUNT samples with the C and the SSE2
+ * version, for every count up to COUNT in some steps; returns 1 if they
+ * agree, 0 if not, -1 if the SSE2 version is not available. */
+
+static int test_sse2(int verbose)
+{
+#if defined(HAVE_ASM_SSE2)
+    static const int shifts[] = { 2, 8 };
+    static uint8_t out8_c[COUNT+16], out8_s[COUNT+16];
+    static uint16_t out16_c[COUNT+16], out16_s[COUNT+16];
+    uint16_t dither[8];
+    int count, s, y;
+
+    if (!(ac_cpuinfo() & AC_SSE2)) {
+        printf("WARNING: unable to test (no support in CPU)\n");
+        return -1;
+    }
+    make_picture(1);
+    for (s = 0; s < 2; s++) {
+        for (y = 0; y < 4; y++) {
+            dither_row(dither, y, shifts[s]);
+            for (count = 0; count <= COUNT; count += 1 + count/4) {
+                memset(out8_c, 0x5A, sizeof(out8_c));
+                memset(out8_s, 0x5A, sizeof(out8_s));
+                reduce_row(deep, out8_c, dither, shifts[s], count);
+                reduce_row_sse2(deep, out8_s, dither, shifts[s], count);
+                memset(out16_c, 0x5A, sizeof(out16_c));
+                memset(out16_s, 0x5A, sizeof(out16_s));
+                expand_row(picture, out16_c, shifts[s], count);
+                expand_row_sse2(picture, out16_s, shifts[s], count);
+                if (memcmp(out8_c, out8_s, sizeof(out8_c)) != 0
+                 || memcmp(out16_c, out16_s, sizeof(out16_c)) != 0
+                 || out8_s[count] != 0x5A || out16_s[count] != UNTOUCHED) {
+                    if (verbose > 0)
+                        printf("FAILED (shift %d, row %d, %d samples)\n",
+                               shifts[s], y, count);
+                    return 0;
+                }
+            }
+        }
+    }
+    return 1;
+#else
+    printf("WARNING: unable to test (wrong architecture or not"
+           " compiled in)\n");
+    return -1;
+#endif
+}
+
+/*************************************************************************/
+
+/* Checks the conversions through ac_imgconvert() with the given
+ * acceleration: widening exactly, reducing flat planes to the right mean
+ * over each 4x4 block, and a round trip to within one step; returns 1 on
+ * success, 0 on failure. */
+
+static int test_convert(int accel, int verbose)
+{
+    static const struct {
+        ImageFormat fmt, fmt8;
+        int xdiv, ydiv;
+    } formats[] = {
+        { IMG_YUV420P10, IMG_YUV420P, 2, 2 },
+        { IMG_YUV422P10, IMG_YUV422P, 2, 1 },
+        { IMG_YUV444P16, IMG_YUV444P, 1, 1 },
+    };
+    static const int levels[] = { 0, 1, 2, 3, 5, 127, 128, 511, 512, 513,
+                                  1019, 1020, 4099, 32768, 65287 };
+    static uint16_t buf16[WIDTH*HEIGHT*3];
+    static uint8_t buf8[WIDTH*HEIGHT*3], back[WIDTH*HEIGHT*3];
+    uint8_t *src[3], *dest[3];
+    int f, l, p, i;
+
+    if (!ac_init(accel)) {
+        printf("FAILED (ac_init)\n");
+        return 0;
+    }
+    make_picture(2);
+    for (f = 0; f < (int)(sizeof(formats) / sizeof(*formats)); f++) {
+        int bits = YUV_SAMPLE_BITS(formats[f].fmt), shift = bits - 8;
+        int size = WIDTH*HEIGHT
+                 + 2 * (WIDTH/formats[f].xdiv) * (HEIGHT/formats[f].ydiv);
+
+        /* widening */
+        YUV_INIT_PLANES(src, picture, formats[f].fmt8, WIDTH, HEIGHT);
+        YUV_INIT_PLANES(dest, (uint8_t *)buf16, formats[f].fmt,
+                        WIDTH, HEIGHT);
+        if (!ac_imgconvert(src, formats[f].fmt8, dest, formats[f].fmt,
+                           WIDTH, HEIGHT)) {
+            if (verbose > 0)
+                printf("FAILED (format %d: widening failed)\n", f);
+            return 0;
+        }
+        for (i = 0; i < size; i++) {
+            if (buf16[i] != (picture[i] << shift | picture[i] >> (8-shift))) {
+                if (verbose > 0)
+                    printf("FAILED (format %d: %d widened to %d)\n",
+                           f, picture[i], buf16[i]);
+                return 0;
+            }
+        }
+
+        /* and back */
+        YUV_INIT_PLANES(src, (uint8_t *)buf16, formats[f].fmt,
+                        WIDTH, HEIGHT);
+        YUV_INIT_PLANES(dest, back, formats[f].fmt8, WIDTH, HEIGHT);
+        if (!ac_imgconvert(src, formats[f].fmt, dest, formats[f].fmt8,
+                           WIDTH, HEIGHT)) {
+            if (verbose > 0)
+                printf("FAILED (format %d: reducing failed)\n", f);
+            return 0;
+        }
+        for (i = 0; i < size; i++) {
+            if (back[i] != picture[i]
+             && back[i] != picture[i] + 1) {
+                if (verbose > 0)
+                    printf("FAILED (format %d: %d came back as %d)\n",
+                           f, picture[i], back[i]);
+                return 0;
+            }
+        }
+
+        /* flat planes */
+        for (l = 0; l < (int)(sizeof(levels) / sizeof(*levels)); l++) {
+            int level = levels[l];
+            if (level >> bits)
+                continue;
+            for (i = 0; i < size; i++)
+                buf16[i] = level;
+            YUV_INIT_PLANES(dest, buf8, formats[f].fmt8, WIDTH, HEIGHT);
+            if (!ac_imgconvert(src, formats[f].fmt, dest, formats[f].fmt8,
+                               WIDTH, HEIGHT)) {
+                if (verbose > 0)
+                    printf("FAILED (format %d: reducing failed)\n", f);
+                return 0;
+            }
+            for (p = 0; p < 3; p++) {
+                int w = p ? WIDTH/formats[f].xdiv : WIDTH;
+                int h = p ? HEIGHT/formats[f].ydiv : HEIGHT;
+                int bx, by, x, y;
+                for (by = 0; by < h; by += 4) {
+                    for (bx = 0; bx < w; bx += 4) {
+                        double sum = 0;
+                        double expect = (double)level * 16 / (1 << shift);
+                        for (y = by; y < by+4; y++) {
+                            for (x = bx; x < bx+4; x++)
+                                sum += dest[p][y*w+x];
+                        }
+                        if (fabs(sum - expect) > 0.5) {
+                            if (verbose > 0)
+                                printf("FAILED (format %d, level %d, plane"
+                                       " %d, block %d,%d: sum %g, expected"
+                                       " %g)\n", f, level, p, bx, by, sum,
+                                       expect);
+                            return 0;
+                        }
+                    }
+                }
+            }
+        }
+    }
+    return 1;
+}
+
+/*************************************************************************/
+
+/* Clips and expands a 16-bit plane, and zooms one in a few ways, checking
+ * against the same zoom of the 8-bit plane it was widened from; returns
+ * 1 on success, 0 on failure. */
+
+static int test_tcvideo(int verbose)
+{
+    static const struct {
+        int new_w, new_h;
+        TCVZoomFilter filter;
+    } zooms[] = {
+        { WIDTH*3/4, HEIGHT*3/4, TCV_ZOOM_LANCZOS3 },
+        { WIDTH*2,   HEIGHT,     TCV_ZOOM_TRIANGLE },
+        { WIDTH,     HEIGHT*2,   TCV_ZOOM_BOX      },
+        { WIDTH/2,   -HEIGHT,    TCV_ZOOM_MITCHELL },
+    };
+    static uint16_t in16[WIDTH*HEIGHT], out16[WIDTH*HEIGHT*4];
+    static uint8_t out8[WIDTH*HEIGHT*4];
+    TCVHandle handle = tcv_init();
+    int new_w, new_h, x, y, z, ret = 1;
+
+    if (!handle) {
+        printf("FAILED (tcv_init)\n");
+        return 0;
+    }
+    make_picture(3);
+
+    /* 3 columns off the left, 5 added on the right, 2 rows off the top
+     * and 4 added at the bottom */
+    new_w = WIDTH - 3 + 5;
+    new_h = HEIGHT - 2 + 4;
+    for (x = 0; x < new_w*new_h + 8; x++)
+        out16[x] = UNTOUCHED;
+    if (!tcv_clip(handle, (uint8_t *)deep, (uint8_t *)out16, WIDTH, HEIGHT,
+                  2, 3, -5, 2, -4, 512)) {
+        if (verbose > 0)
+            printf("FAILED (clip: call failed)\n");
+        tcv_free(handle);
+        return 0;
+    }
+    for (y = 0; y < new_h && ret; y++) {
+        for (x = 0; x < new_w && ret; x++) {
+            int expect = (x >= WIDTH-3 || y >= HEIGHT-2) ? 512
+                       : deep[(y+2)*WIDTH + x+3];
+            if (out16[y*new_w+x] != expect) {
+                if (verbose > 0)
+                    printf("FAILED (clip, pixel %d,%d: %d, expected %d)\n",
+                           x, y, out16[y*new_w+x], expect);
+                ret = 0;
+            }
+        }
+    }
+    if (ret && out16[new_w*new_h] != UNTOUCHED) {
+        if (verbose > 0)
+            printf("FAILED (clip: overrun)\n");
+        ret = 0;
+    }
+
+    for (x = 0; x < WIDTH*HEIGHT; x++)
+        in16[x] = picture[x] * 257;
+    for (z = 0; z < (int)(sizeof(zooms) / sizeof(*zooms)) && ret; z++) {
+        new_w = zooms[z].new_w;
+        new_h = zooms[z].new_h;
+        if (!tcv_zoom(handle, picture, out8, WIDTH, HEIGHT, 1,
+                      new_w, new_h, zooms[z].filter)
+         || !tcv_zoom(handle, (uint8_t *)in16, (uint8_t *)out16, WIDTH,
+                      HEIGHT, 2, new_w, new_h, zooms[z].filter)
+        ) {
+            if (verbose > 0)
+                printf("FAILED (zoom %d: call failed)\n", z);
+            ret = 0;
+            break;
+        }
+        /* the 8-bit zoom rounds between the passes, so allow two steps */
+        for (x = 0; x < new_w * abs(new_h) && ret; x++) {
+            if (abs(out16[x] - out8[x]*257) > 2*257) {
+                if (verbose > 0)
+                    printf("FAILED (zoom %d, sample %d: %d, 8-bit %d)\n",
+                           z, x, out16[x], out8[x]);
+                ret = 0;
+            }
+        }
+    }
+    tcv_free(handle);
+    return ret;
+}
+
+/*************************************************************************/
+
+int main(int argc, char *argv[])
+{
+    int verbose = 1;
+    int ch, ret, failed = 0;
+
+    while ((ch = getopt(argc, argv, "hq")) != EOF) {
+        if (ch == 'q') {
+            verbose = 0;
+        } else {
+            fprintf(stderr,
+                    "Usage: %s [-q]\n"
+                    "-q: quiet (don't print test names)\n",
+                    argv[0]);
+            return 1;
+        }
+    }
+
+    if (verbose > 0) {
+        printf("row kernels SSE2: ");
+        fflush(stdout);
+    }
+    ret = test_sse2(verbose);
+    if (ret == 0) {
+        failed = 1;
+    } else if (ret > 0 && verbose > 0) {
+        printf("ok\n");
+    }
+
+    if (verbose > 0) {
+        printf("conversions C: ");
+        fflush(stdout);
+    }
+    if (!test_convert(AC_NONE, verbose)) {
+        failed = 1;
+    } else if (verbose > 0) {
+        printf("ok\n");
+    }
+
+    if (verbose > 0) {
+        printf("conversions accelerated: ");
+        fflush(stdout);
+    }
+    if (!test_convert(AC_ALL, verbose)) {
+        failed = 1;
+    } else if (verbose > 0) {
+        printf("ok\n");
+    }
+
+    if (verbose > 0) {
+        printf("16-bit clip/zoom: ");
+        fflush(stdout);
+    }
+    if (!test_tcvideo(verbose)) {
+        failed = 1;
+    } else if (verbose > 0) {
+        printf("ok\n");
+    }
+
+    return failed ? 1 : 0;
+}
+
+/*************************************************************************/
+
+/*
+ * Local variables:
+ *   c-file-style: "stroustrup"
+ *   c-file-offsets: ((case-label . *) (statement-case-intro . *))
+ *   indent-tabs-mode: nil
+ * End:
+ *
+ * vim: expandtab shiftwidth=4:
+ */
@@ -23,6 +23,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "config.h"
 #include "libtc/libtc.h"
@@ -35,8 +36,11 @@
 #define PACKAGE __FILE__
 #endif
 
-static int format[] = { TC_CODEC_RGB24, TC_CODEC_YUV422P, TC_CODEC_YUV420P };
-static const char *strfmt[] = { "rgb24", "yuv422p", "yuv420p" };
+static int format[] = { TC_CODEC_RGB24, TC_CODEC_YUV422P, TC_CODEC_YUV420P,
+                        TC_CODEC_YUV420P10, TC_CODEC_YUV422P10,
+                        TC_CODEC_YUV444P16 };
+static const char *strfmt[] = { "rgb24", "yuv422p", "yuv420p",
+                                "yuv420p10", "yuv422p10", "yuv444p16" };
 
 static int test_alloc_vid(int w, int h, int fmtid, int part)
 {
@@ -108,6 +112,61 @@ static int test_alloc_memset_vid(int w, int h, int fmtid, int part)
     return ret;
 }
 
+static int test_share_vid(int w, int h, int fmtid)
+{
+    int ret = 0;
+    int fmt = format[fmtid];
+    vframe_list_t *vptr = tc_new_video_frame(w, h, fmt, 0);
+    vframe_list_t *clone = tc_new_video_frame(w, h, fmt, 0);
+    TCFramePayload *pl = NULL;
+
+    if (vptr == NULL || clone == NULL) {
+        goto done;
+    }
+    vptr->video_size = clone->video_size = w * h * 3 / 2;
+    memset(vptr->video_buf, 'A', vptr->video_size);
+
+    pl = tc_hold_video_frame(vptr);
+    if (pl == NULL || vptr->video_buf != pl->data || pl->refs != 2) {
+        goto done;
+    }
+    tc_share_video_frame(clone, pl);
+    tc_release_payload(pl);
+    if (clone->video_buf != vptr->video_buf || pl->refs != 2) {
+        goto done;
+    }
+    /* the clone gets its own copy, the original is left alone */
+    tc_unshare_video_frame(clone);
+    if (clone->video_buf == vptr->video_buf || clone->payload != NULL
+     || memcmp(clone->video_buf, vptr->video_buf, vptr->video_size) != 0) {
+        goto done;
+    }
+    memset(clone->video_buf, 'B', clone->video_size);
+    if (vptr->video_buf[vptr->video_size-1] != 'A' || pl->refs != 1) {
+        goto done;
+    }
+    /* the last holder takes the picture back */
+    tc_unshare_video_frame(vptr);
+    if (vptr->payload != NULL || vptr->video_buf[0] != 'A'
+     || vptr->video_buf[vptr->video_size-1] != 'A') {
+        goto done;
+    }
+    ret = 1;
+
+  done:
+    tc_del_video_frame(clone);
+    tc_del_video_frame(vptr);
+
+    if (ret) {
+        tc_info("testing frame (share): width=%i height=%i format=%s -> OK",
+                w, h, strfmt[fmtid]);
+    } else {
+        tc_warn("testing frame (share): width=%i height=%i format=%s -> FAILED",
+                w, h, strfmt[fmtid]);
+    }
+    return ret;
+}
+
 static int test_alloc_memset_aud(double rate, double fps, int chans, int bits)
 {
     int ret = 0;
@@ -194,6 +253,13 @@ int main(int argc, char *argv[])
         }
     }
 
+    for (f = 0; f < LEN(format); f++) {
+        for (w = 0; w < LEN(width); w++) {
+            succesfull += test_share_vid(width[w], height[w], f);
+            runned++;
+        }
+    }
+
     tc_info("test summary: %i tests runned, %i succesfully",
             runned, succesfull);
     return 0;
@@ -0,0 +1,140 @@
+/*
+ * test-framering.c -- check the frame ringbuffers stay consistent when
+ *                     they are resized while frames are being cloned
+ *
+ * This file is part of transcode, a video stream processing tool.
+ * transcode is free software, distributable under the terms of the GNU
+ * General Public License (version 2 or later).  See the file COPYING
+ * for details.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "config.h"
+#include "libtc/libtc.h"
+#include "src/framebuffer.h"
+
+/*************************************************************************/
+
+#define RING_SIZE   8   /* frames allocated at start */
+#define IN_FLIGHT   3   /* frames held, each with its clone */
+#define ROUNDS      4
+
+/*
+ * Each round takes IN_FLIGHT frames and has each of them cloned, as
+ * filters asking for a frame clone do (each clone must be queued once
+ * and only once), then shrinks the ring below the number of frames
+ * held, gives all of them back, and grows the ring again. The ring
+ * must be consistent after each step.
+ */
+#define RING_TEST(X, TYPE) \
+static int X ## frame_ring_test(const char *name) \
+{ \
+    TYPE *held[IN_FLIGHT * 2]; \
+    int round, i, id = 0, errors = 0, im, fl, ex; \
+    \
+    if (X ## frame_alloc(RING_SIZE) != 0) { \
+        tc_log_warn(__FILE__, "%s: allocation failed", name); \
+        return 1; \
+    } \
+    for (round = 0; round < ROUNDS; round++) { \
+        if (round & 1) { \
+            /* no frame left for the clones: they must get spare ones */ \
+            X ## frame_resize(IN_FLIGHT); \
+        } \
+        for (i = 0; i < IN_FLIGHT; i++) { \
+            held[i*2] = X ## frame_register(id++); \
+        } \
+        for (i = 0; i < IN_FLIGHT; i++) { \
+            held[i*2 + 1] = X ## frame_dup(held[i*2]); \
+            if (!held[i*2] || !held[i*2 + 1]) { \
+                tc_log_warn(__FILE__, "%s: can't clone frame %i", \
+                            name, id - IN_FLIGHT + i); \
+                return errors + 1; \
+            } \
+            /* as the frame threads do with a clone */ \
+            X ## frame_push_next(held[i*2 + 1], TC_FRAME_WAIT); \
+            if (X ## frame_reserve() != held[i*2 + 1]) { \
+                tc_log_warn(__FILE__, "%s: clone of frame %i not queued", \
+                            name, id - IN_FLIGHT + i); \
+                return errors + 1; \
+            } \
+        } \
+        X ## frame_get_counters(&im, &fl, &ex); \
+        if (fl != 0) { \
+            tc_log_warn(__FILE__, "%s: %i frame(s) queued twice", \
+                        name, fl); \
+            errors++; \
+        } \
+        errors += X ## frame_check(); \
+        \
+        X ## frame_resize(IN_FLIGHT - 1); \
+        errors += X ## frame_check(); \
+        /* originals first on even rounds, clones first on odd ones */ \
+        for (i = 0; i < IN_FLIGHT * 2; i++) { \
+            X ## frame_remove(held[i ^ (round & 1)]); \
+            errors += X ## frame_check(); \
+        } \
+        if (X ## frame_get_size() != IN_FLIGHT - 1) { \
+            tc_log_warn(__FILE__, "%s: ring not shrunk", name); \
+            errors++; \
+        } \
+        \
+        X ## frame_resize(RING_SIZE * 4); \
+        errors += X ## frame_check(); \
+        X ## frame_resize(RING_SIZE); \
+        errors += X ## frame_check(); \
+    } \
+    X ## frame_flush(); \
+    errors += X ## frame_check(); \
+    X ## frame_free(); \
+    \
+    tc_log_info(__FILE__, "%s: %s", name, (errors > 0) ?"FAILED" :"ok"); \
+    return errors; \
+}
+
+RING_TEST(v, TCFrameVideo)
+RING_TEST(a, TCFrameAudio)
+
+/*************************************************************************/
+
+/* stubs */
+int verbose = TC_INFO;
+int tc_running(void);
+int tc_running(void)
+{
+    return TC_TRUE;
+}
+
+int main(int argc, char *argv[])
+{
+    int errors = 0;
+
+    libtc_init(&argc, &argv);
+
+    if (argc == 2) {
+        verbose = atoi(argv[1]);
+    }
+
+    errors += vframe_ring_test("video ring");
+    errors += aframe_ring_test("audio ring");
+
+    tc_log_info(__FILE__, "test summary: %i error%s (%s)",
+                errors,
+                (errors > 1) ?"s" :"",
+                (errors > 0) ?"FAILED" :"PASSED");
+    return (errors > 0) ?1 :0;
+}
+
+/*************************************************************************/
+
+/*
+ * Local variables:
+ *   c-file-style: "stroustrup"
+ *   c-file-offsets: ((case-label . *) (statement-case-intro . *))
+ *   indent-tabs-mode: nil
+ * End:
+ *
+ * vim: expandtab shiftwidth=4:
+ */
@@ -0,0 +1,242 @@
+/*
+ * test-hqdn3d.c - check the banded and SSE2 hqdn3d denoiser against the
+ *                 original single pass one
+ *
+ * This file is part of transcode, a video stream processing tool.
+ * transcode is free software, distributable under the terms of the GNU
+ * General Public License (version 2 or later).  See the file COPYING
+ * for details.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "config.h"
+
+/* Include filter_hqdn3d.c directly for access to the implementations */
+#include "../filter/filter_hqdn3d.c"
+
+/* The filter runs inside transcode, which provides these */
+int verbose = 0;
+
+TCSession *tc_get_session(void)
+{
+    static TCSession session;
+    return &session;
+}
+
+vob_t *tc_get_vob(void)
+{
+    return NULL;
+}
+
+#define FRAMES  6       /* frames filtered in a row, for the temporal part */
+
+/*************************************************************************/
+
+/* The original deNoise, doing the three low-passes in a single pass. */
+
+static void ref_deNoise(unsigned char *Frame, unsigned char *FrameDest,
+                        unsigned int *LineAnt, unsigned short **FrameAntPtr,
+                        int W, int H,
+                        int *Horizontal, int *Vertical, int *Temporal)
+{
+    int X, Y;
+    int LineOffs = 0;
+    unsigned int PixelAnt;
+    int PixelDst;
+    unsigned short *FrameAnt = *FrameAntPtr;
+
+    if (!FrameAnt) {
+        *FrameAntPtr = FrameAnt = tc_malloc(W*H*sizeof(unsigned short));
+        for (Y = 0; Y < H; Y++) {
+            for (X = 0; X < W; X++)
+                FrameAnt[Y*W + X] = Frame[Y*W + X]<<8;
+        }
+    }
+
+    LineAnt[0] = PixelAnt = Frame[0]<<16;
+    PixelDst = LowPassMul(FrameAnt[0]<<8, PixelAnt, Temporal);
+    FrameAnt[0] = ((PixelDst+0x1000007F)/256);
+    FrameDest[0] = ((PixelDst+0x10007FFF)/65536);
+
+    for (X = 1; X < W; X++) {
+        LineAnt[X] = PixelAnt = LowPassMul(PixelAnt, Frame[X]<<16, Horizontal);
+        PixelDst = LowPassMul(FrameAnt[X]<<8, PixelAnt, Temporal);
+        FrameAnt[X] = ((PixelDst+0x1000007F)/256);
+        FrameDest[X] = ((PixelDst+0x10007FFF)/65536);
+    }
+
+    for (Y = 1; Y < H; Y++) {
+        unsigned short *LinePrev = &FrameAnt[Y*W];
+        LineOffs += W;
+        PixelAnt = Frame[LineOffs]<<16;
+        LineAnt[0] = LowPassMul(LineAnt[0], PixelAnt, Vertical);
+        PixelDst = LowPassMul(LinePrev[0]<<8, LineAnt[0], Temporal);
+        LinePrev[0] = ((PixelDst+0x1000007F)/256);
+        FrameDest[LineOffs] = ((PixelDst+0x10007FFF)/65536);
+
+        for (X = 1; X < W; X++) {
+            PixelAnt = LowPassMul(PixelAnt, Frame[LineOffs+X]<<16, Horizontal);
+            LineAnt[X] = LowPassMul(LineAnt[X], PixelAnt, Vertical);
+            PixelDst = LowPassMul(LinePrev[X]<<8, LineAnt[X], Temporal);
+            LinePrev[X] = ((PixelDst+0x1000007F)/256);
+            FrameDest[LineOffs+X] = ((PixelDst+0x10007FFF)/65536);
+        }
+    }
+}
+
+/*************************************************************************/
+
+/* Noise over a moving gradient, with the extremes often, so that the
+ * differences hit the outermost coefficients. */
+static void make_frame(uint8_t *buf, int W, int H, int n)
+{
+    int x, y;
+
+    for (y = 0; y < H; y++) {
+        for (x = 0; x < W; x++) {
+            int r = rand() % 8;
+            buf[y*W + x] = (r == 0) ? 0 : (r == 1) ? 255
+                         : (x*5 + y*3 + n*11 + rand() % 32) % 256;
+        }
+    }
+}
+
+/* Filters FRAMES frames with the original code and with the given
+ * settings; returns 1 if the output and the previous frame kept agree
+ * byte for byte, 0 if not. */
+
+static int test_plane(int W, int H, double spatial, double temporal,
+                      int threads, int sse2, int verbose)
+{
+    static Hqdn3dPrivateData pd;
+    unsigned short *ant_ref = NULL, *ant = NULL;
+    unsigned int *line_ref = tc_malloc(W * sizeof(unsigned int));
+    uint8_t *src = tc_malloc(W*H);
+    uint8_t *out_ref = tc_malloc(W*H), *out = tc_malloc(W*H);
+    int n, ret = 1;
+
+    memset(&pd, 0, sizeof(pd));
+    pd.Line    = tc_malloc(W * sizeof(unsigned int));
+    pd.Spatial = tc_malloc(W*H * sizeof(unsigned int));
+    pd.threads = threads;
+    pd.sse2    = sse2;
+    PrecalcCoefs(pd.Coefs[0], spatial);
+    PrecalcCoefs(pd.Coefs[1], temporal);
+
+    srand(W*H);
+    for (n = 0; n < FRAMES && ret; n++) {
+        make_frame(src, W, H, n);
+        ref_deNoise(src, out_ref, line_ref, &ant_ref, W, H,
+                    pd.Coefs[0], pd.Coefs[0], pd.Coefs[1]);
+        deNoise(&pd, src, out, &ant, W, H,
+                pd.Coefs[0], pd.Coefs[0], pd.Coefs[1]);
+        if (memcmp(out_ref, out, W*H) != 0
+         || memcmp(ant_ref, ant, W*H * sizeof(unsigned short)) != 0) {
+            if (verbose > 0) {
+                printf("FAILED (%dx%d, strength %.1f/%.1f, frame %d)\n",
+                       W, H, spatial, temporal, n);
+            }
+            ret = 0;
+        }
+    }
+
+    tc_free(ant_ref);
+    tc_free(ant);
+    tc_free(line_ref);
+    tc_free(pd.Line);
+    tc_free(pd.Spatial);
+    tc_free(src);
+    tc_free(out_ref);
+    tc_free(out);
+    return ret;
+}
+
+static int test_all(int threads, int sse2, int verbose)
+{
+    static const int sizes[][2] = {
+        { 1, 1 }, { 3, 2 }, { 16, 16 }, { 17, 5 }, { 61, 37 },
+        { 88, 72 }, { 176, 144 }, { 0, 0 }
+    };
+    /* defaults, then strong enough to reach the outermost coefficients */
+    static const double strengths[][2] = {
+        { 4.0, 6.0 }, { 3.0, 4.5 }, { 40.0, 100.0 }, { 0, 0 }
+    };
+    int i, j, ret = 1;
+
+    for (i = 0; sizes[i][0] > 0 && ret; i++) {
+        for (j = 0; strengths[j][0] > 0 && ret; j++) {
+            ret = test_plane(sizes[i][0], sizes[i][1],
+                             strengths[j][0], strengths[j][1],
+                             threads, sse2, verbose);
+        }
+    }
+    return ret;
+}
+
+/*************************************************************************/
+
+int main(int argc, char *argv[])
+{
+    static const struct { const char *name; int threads, sse2; } tests[] = {
+        { "C",             1, 0 },
+        { "C, 3 bands",    3, 0 },
+        { "SSE2",          1, 1 },
+        { "SSE2, 4 bands", 4, 1 },
+    };
+    int verbose = 1;
+    int ch, i, failed = 0;
+
+    while ((ch = getopt(argc, argv, "hq")) != EOF) {
+        if (ch == 'q') {
+            verbose = 0;
+        } else {
+            fprintf(stderr,
+                    "Usage: %s [-q]\n"
+                    "-q: quiet (don't print test names)\n",
+                    argv[0]);
+            return 1;
+        }
+    }
+
+    for (i = 0; i < sizeof(tests) / sizeof(*tests); i++) {
+        if (verbose > 0) {
+            printf("hqdn3d %s: ", tests[i].name);
+            fflush(stdout);
+        }
+        if (tests[i].sse2) {
+#if defined(HAVE_ASM_SSE2) && defined(ARCH_X86_64)
+            if (!(ac_cpuinfo() & AC_SSE2)) {
+                printf("WARNING: unable to test (no support in CPU)\n");
+                continue;
+            }
+#else
+            printf("WARNING: unable to test (wrong architecture or not"
+                   " compiled in)\n");
+            continue;
+#endif
+        }
+        if (!test_all(tests[i].threads, tests[i].sse2, verbose)) {
+            failed = 1;
+        } else if (verbose > 0) {
+            printf("ok\n");
+        }
+    }
+
+    return failed ? 1 : 0;
+}
+
+/*************************************************************************/
+
+/*
+ * Local variables:
+ *   c-file-style: "stroustrup"
+ *   c-file-offsets: ((case-label . *) (statement-case-intro . *))
+ *   indent-tabs-mode: nil
+ * End:
+ *
+ * vim: expandtab shiftwidth=4:
+ */
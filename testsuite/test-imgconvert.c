@@ -50,6 +50,9 @@ static struct {
     { IMG_UYVY,    "UYVY", 2, 1 },
     { IMG_YVYU,    "YVYU", 2, 1 },
     { IMG_Y8,      " Y8 ", 1, 1 },
+    { IMG_YUV420P10, "P010", 2, 2 },
+    { IMG_YUV422P10, "P210", 2, 1 },
+    { IMG_YUV444P16, "P416", 1, 1 },
     { IMG_RGB24,   "RGB ", 1, 1 },
     { IMG_BGR24,   "BGR ", 1, 1 },
     { IMG_RGBA32,  "RGBA", 1, 1 },
@@ -94,8 +97,8 @@ static void clear_signals(void)
 static int testit(uint8_t *srcimage, ImageFormat srcfmt, ImageFormat destfmt,
                   int width, int height, int accel, int verbose, int check)
 {
-    static __attribute__((aligned(16))) uint8_t srcbuf[WIDTH*HEIGHT*4],
-        destbuf[WIDTH*HEIGHT*4], cmpbuf[WIDTH*HEIGHT*4];
+    static __attribute__((aligned(16))) uint8_t srcbuf[WIDTH*HEIGHT*6],
+        destbuf[WIDTH*HEIGHT*6], cmpbuf[WIDTH*HEIGHT*6];
     uint8_t *src[3], *dest[3];
     long long tdiff;
     unsigned long long start, stop;
@@ -245,7 +248,7 @@ static const char *accel_flags(int accel)
 
 int main(int argc, char **argv)
 {
-    static uint8_t srcbuf[WIDTH*HEIGHT*4];
+    static uint8_t srcbuf[WIDTH*HEIGHT*6];
     int check = 0, accel = 0, compare = 0, verbose = 0, width = WIDTH,
         height = HEIGHT;
     int i, j;
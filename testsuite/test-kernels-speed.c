@@ -0,0 +1,633 @@
+/*
+ * test-kernels-speed.c - time the aclib and libtcvideo kernels at every
+ *                        acceleration level supported by the CPU
+ *
+ * This file is part of transcode, a video stream processing tool.
+ * transcode is free software, distributable under the terms of the GNU
+ * General Public License (version 2 or later).  See the file COPYING
+ * for details.
+ */
+
+/*
+ * Every kernel is run on a full frame at each size; the reported figure
+ * is the best (lowest) time of a single call, in CPU cycles (TSC ticks
+ * on x86, nanoseconds elsewhere) per pixel of the source frame.  Each
+ * column is an acceleration level as passed to ac_init(); levels which
+ * the CPU can't tell apart from the previous one are not shown.  A
+ * kernel which is not faster in a column than in the one on its left is
+ * missing an accelerated path for that instruction set (or has a slow
+ * one).
+ *
+ * Kernels:
+ *   imgconvert   every conversion pair registered in ac_imgconvert
+ *   aclib        ac_memcpy, ac_average, ac_rescale
+ *   tcvideo      the tcv_* operations, on a luma plane and an RGB frame
+ *   zoom         zoom_process with every filter, to 3/4 of the size
+ */
+
+#define DEF_TESTTIME    50      /* milliseconds per kernel and level */
+#define MIN_CALLS       3       /* minimum calls per measurement */
+#define DEF_SIZES       "sd,hd,uhd"
+
+/*************************************************************************/
+
+#define _GNU_SOURCE
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <setjmp.h>
+#include <signal.h>
+#include <sys/time.h>
+
+#include "config.h"
+#include "aclib/ac.h"
+#include "aclib/imgconvert.h"
+#include "libtc/libtc.h"
+#include "libtcvideo/tcvideo.h"
+#include "libtcvideo/zoom.h"
+
+/*************************************************************************/
+
+/* Acceleration levels, each a superset of the previous one */
+static const struct {
+    const char *name;
+    int accel;
+} levels[] = {
+    { "C",     AC_NONE },
+    { "asm",   AC_IA32ASM | AC_AMD64ASM | AC_CMOVE },
+    { "mmx",   AC_IA32ASM | AC_AMD64ASM | AC_CMOVE | AC_MMX },
+    { "sse",   AC_IA32ASM | AC_AMD64ASM | AC_CMOVE | AC_MMX | AC_MMXEXT
+             | AC_3DNOW | AC_3DNOWEXT | AC_SSE },
+    { "sse2",  AC_IA32ASM | AC_AMD64ASM | AC_CMOVE | AC_MMX | AC_MMXEXT
+             | AC_3DNOW | AC_3DNOWEXT | AC_SSE | AC_SSE2 },
+    { "sse3",  AC_IA32ASM | AC_AMD64ASM | AC_CMOVE | AC_MMX | AC_MMXEXT
+             | AC_3DNOW | AC_3DNOWEXT | AC_SSE | AC_SSE2 | AC_SSE3
+             | AC_SSSE3 },
+    { "all",   AC_ALL },
+    { NULL }
+};
+
+#define MAX_LEVELS  (sizeof(levels) / sizeof(levels[0]))
+
+/* Levels actually usable on this CPU (accel masked with ac_cpuinfo()) */
+static int n_used = 0;
+static int used_accel[MAX_LEVELS];
+static const char *used_name[MAX_LEVELS];
+
+/* Frame sizes */
+static const struct {
+    const char *name;
+    int width, height;
+} sizelist[] = {
+    { "sd",   720,  576 },
+    { "hd",  1920, 1080 },
+    { "uhd", 3840, 2160 },
+    { NULL }
+};
+
+/* Formats for ac_imgconvert, as in test-imgconvert.c */
+static const struct {
+    ImageFormat fmt;
+    const char *name;
+} fmtlist[] = {
+    { IMG_YUV420P, "420P" },
+    { IMG_YV12,    "YV12" },
+    { IMG_YUV411P, "411P" },
+    { IMG_YUV422P, "422P" },
+    { IMG_YUV444P, "444P" },
+    { IMG_YUY2,    "YUY2" },
+    { IMG_UYVY,    "UYVY" },
+    { IMG_YVYU,    "YVYU" },
+    { IMG_Y8,      "Y8"   },
+    { IMG_YUV420P10, "P010" },
+    { IMG_YUV422P10, "P210" },
+    { IMG_YUV444P16, "P416" },
+    { IMG_RGB24,   "RGB"  },
+    { IMG_BGR24,   "BGR"  },
+    { IMG_RGBA32,  "RGBA" },
+    { IMG_ABGR32,  "ABGR" },
+    { IMG_ARGB32,  "ARGB" },
+    { IMG_BGRA32,  "BGRA" },
+    { IMG_GRAY8,   "GRAY" },
+    { IMG_NONE,    NULL   }
+};
+
+/*************************************************************************/
+
+/* Everything a kernel needs; set up once per frame size */
+typedef struct {
+    uint8_t *src, *dest;
+    int width, height;
+    TCVHandle tcv;
+    ZoomInfo *zoom;
+    ImageFormat srcfmt, destfmt;
+    int Bpp;
+} BenchData;
+
+static sigjmp_buf env;
+static volatile int sigsave;
+
+static void sighandler(int sig)
+{
+    sigsave = sig;
+    siglongjmp(env, 1);
+}
+
+/*************************************************************************/
+
+/* Timestamp in cycles where the CPU has a cheap counter, else in ns */
+#if defined(ARCH_X86) || defined(ARCH_X86_64)
+# define CLOCK_UNIT "cycles"
+static inline uint64_t bench_clock(void)
+{
+    uint32_t lo, hi;
+    __asm__ __volatile__ ("rdtsc" : "=a" (lo), "=d" (hi));
+    return ((uint64_t)hi << 32) | lo;
+}
+#else
+# define CLOCK_UNIT "ns"
+static inline uint64_t bench_clock(void)
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return ((uint64_t)tv.tv_sec * 1000000 + tv.tv_usec) * 1000;
+}
+#endif
+
+static long elapsed_msec(const struct timeval *start)
+{
+    struct timeval now;
+    gettimeofday(&now, NULL);
+    return (now.tv_sec - start->tv_sec) * 1000
+         + (now.tv_usec - start->tv_usec) / 1000;
+}
+
+/* Returns the best time per pixel of func(bd), or <0 on error:
+ *   -1: the kernel failed
+ *   -2: SIGSEGV
+ *   -3: SIGILL
+ */
+static double timeit(int (*func)(BenchData *), BenchData *bd, int msec)
+{
+    void *old_SIGSEGV, *old_SIGILL;
+    struct timeval start;
+    uint64_t best = ~(uint64_t)0;
+    int calls = 0;
+    double ret;
+
+    old_SIGSEGV = signal(SIGSEGV, sighandler);
+    old_SIGILL  = signal(SIGILL , sighandler);
+    if (sigsetjmp(env, 1)) {
+        ret = (sigsave == SIGILL) ? -3 : -2;
+    } else if (!(*func)(bd)) {  /* warm up caches and tables */
+        ret = -1;
+    } else {
+        gettimeofday(&start, NULL);
+        do {
+            uint64_t t0 = bench_clock(), t;
+            (*func)(bd);
+            t = bench_clock() - t0;
+            if (t < best)
+                best = t;
+            calls++;
+        } while (calls < MIN_CALLS || elapsed_msec(&start) < msec);
+        ret = (double)best / ((double)bd->width * bd->height);
+    }
+    signal(SIGSEGV, old_SIGSEGV);
+    signal(SIGILL , old_SIGILL );
+    return ret;
+}
+
+/*************************************************************************/
+
+/* Kernels; all return nonzero on success */
+
+static int k_imgconvert(BenchData *bd)
+{
+    uint8_t *src[3], *dest[3];
+
+    src[0] = bd->src;
+    if (IS_YUV_FORMAT(bd->srcfmt))
+        YUV_INIT_PLANES(src, bd->src, bd->srcfmt, bd->width, bd->height);
+    dest[0] = bd->dest;
+    if (IS_YUV_FORMAT(bd->destfmt))
+        YUV_INIT_PLANES(dest, bd->dest, bd->destfmt, bd->width, bd->height);
+    return ac_imgconvert(src, bd->srcfmt, dest, bd->destfmt,
+                         bd->width, bd->height);
+}
+
+static int k_memcpy(BenchData *bd)
+{
+    ac_memcpy(bd->dest, bd->src, bd->width * bd->height);
+    return 1;
+}
+
+static int k_average(BenchData *bd)
+{
+    int size = bd->width * bd->height;
+    ac_average(bd->src, bd->src + size, bd->dest, size);
+    return 1;
+}
+
+static int k_rescale(BenchData *bd)
+{
+    int size = bd->width * bd->height;
+    ac_rescale(bd->src, bd->src + size, bd->dest, size, 21845, 43691);
+    return 1;
+}
+
+static int k_sad(BenchData *bd)
+{
+    int size = bd->width * bd->height;
+    ac_sad(bd->src, bd->src + size, NULL, size);
+    return 1;
+}
+
+static int k_correlate(BenchData *bd)
+{
+    uint32_t sums[3];
+    int size = bd->width * bd->height;
+    if (size > 65536)  /* the sums would wrap */
+        size = 65536;
+    ac_correlate(bd->src, bd->src + size, NULL, size, sums);
+    return 1;
+}
+
+/* Pixels to take from each side of a dimension: 8, but at least half
+ * of it is left */
+static int clip_margin(int size)
+{
+    return (size >= 32) ? 8 : size / 4;
+}
+
+/* Blocks of 1/8 of a dimension to take away: 8 (64 pixels), but at
+ * least one block is left */
+static int resize_blocks(int size)
+{
+    return (size / 8 > 8) ? 8 : size / 8 - 1;
+}
+
+static int k_clip(BenchData *bd)
+{
+    int cw = clip_margin(bd->width), ch = clip_margin(bd->height);
+
+    return tcv_clip(bd->tcv, bd->src, bd->dest, bd->width, bd->height,
+                    bd->Bpp, cw, cw, ch, ch, 0);
+}
+
+static int k_expand(BenchData *bd)
+{
+    return tcv_clip(bd->tcv, bd->src, bd->dest, bd->width, bd->height,
+                    bd->Bpp, -8, -8, -8, -8, 0);
+}
+
+static int k_deint_drop(BenchData *bd)
+{
+    return tcv_deinterlace(bd->tcv, bd->src, bd->dest, bd->width,
+                           bd->height, bd->Bpp,
+                           TCV_DEINTERLACE_DROP_FIELD_TOP);
+}
+
+static int k_deint_interpolate(BenchData *bd)
+{
+    return tcv_deinterlace(bd->tcv, bd->src, bd->dest, bd->width,
+                           bd->height, bd->Bpp, TCV_DEINTERLACE_INTERPOLATE);
+}
+
+static int k_deint_blend(BenchData *bd)
+{
+    return tcv_deinterlace(bd->tcv, bd->src, bd->dest, bd->width,
+                           bd->height, bd->Bpp, TCV_DEINTERLACE_LINEAR_BLEND);
+}
+
+static int k_resize_w(BenchData *bd)
+{
+    return tcv_resize(bd->tcv, bd->src, bd->dest, bd->width, bd->height,
+                      bd->Bpp, -resize_blocks(bd->width), 0, 8, 8);
+}
+
+static int k_resize_h(BenchData *bd)
+{
+    return tcv_resize(bd->tcv, bd->src, bd->dest, bd->width, bd->height,
+                      bd->Bpp, 0, -resize_blocks(bd->height), 8, 8);
+}
+
+static int k_reduce(BenchData *bd)
+{
+    return tcv_reduce(bd->tcv, bd->src, bd->dest, bd->width, bd->height,
+                      bd->Bpp, 2, 2);
+}
+
+static int k_flip_v(BenchData *bd)
+{
+    return tcv_flip_v(bd->tcv, bd->src, bd->dest, bd->width, bd->height,
+                      bd->Bpp);
+}
+
+static int k_flip_h(BenchData *bd)
+{
+    return tcv_flip_h(bd->tcv, bd->src, bd->dest, bd->width, bd->height,
+                      bd->Bpp);
+}
+
+static int k_gamma(BenchData *bd)
+{
+    return tcv_gamma_correct(bd->tcv, bd->src, bd->dest, bd->width,
+                             bd->height, bd->Bpp, 1.2);
+}
+
+static int k_antialias(BenchData *bd)
+{
+    return tcv_antialias(bd->tcv, bd->src, bd->dest, bd->width, bd->height,
+                         bd->Bpp, 1.0/3.0, 0.5);
+}
+
+/* Tracking a 32x32 pattern which moved by 3 pixels */
+static int k_match(BenchData *bd)
+{
+    uint8_t pattern[32*32*3];
+    int x0 = bd->width/2, y0 = bd->height/2, x, y, i;
+    double score;
+
+    /* from the center, or as far as the pattern fits in the frame */
+    if (x0 + 32 > bd->width)
+        x0 = bd->width - 32;
+    if (y0 + 32 > bd->height)
+        y0 = bd->height - 32;
+    if (x0 < 3 || y0 < 3)
+        return 0;  /* no room for the pattern to move */
+    for (i = 0; i < 32; i++) {
+        ac_memcpy(pattern + i*32*bd->Bpp,
+                  bd->src + ((y0+i)*bd->width + x0) * bd->Bpp, 32*bd->Bpp);
+    }
+    return tcv_match(bd->tcv, bd->src, bd->width, bd->height, bd->Bpp,
+                     pattern, NULL, 32, 32, TCV_MATCH_SAD,
+                     x0-3, y0-3, 16, &x, &y, &score);
+}
+
+/* Rotating by 5 degrees around the center, as filter_transform does */
+static int k_affine(BenchData *bd)
+{
+    double c = cos(5 * M_PI / 180), s = sin(5 * M_PI / 180), m[6];
+    double cx = bd->width / 2.0, cy = bd->height / 2.0;
+
+    m[0] =  c;
+    m[1] =  s;
+    m[2] = -c*cx - s*cy + cx;
+    m[3] = -s;
+    m[4] =  c;
+    m[5] =  s*cx - c*cy + cy;
+    return tcv_affine(bd->tcv, bd->src, bd->width, bd->height, bd->Bpp,
+                      bd->dest, bd->width, bd->height, m, 16,
+                      0, bd->height);
+}
+
+static int k_zoom(BenchData *bd)
+{
+    zoom_process(bd->zoom, bd->src, bd->dest);
+    return 1;
+}
+
+static const struct {
+    const char *name;
+    int (*func)(BenchData *);
+} aclib_kernels[] = {
+    { "memcpy",            k_memcpy },
+    { "average",           k_average },
+    { "rescale",           k_rescale },
+    { "sad",               k_sad },
+    { "correlate",         k_correlate },
+    { NULL }
+}, tcv_kernels[] = {
+    { "clip",              k_clip },
+    { "expand",            k_expand },
+    { "deint_drop",        k_deint_drop },
+    { "deint_interpolate", k_deint_interpolate },
+    { "deint_blend",       k_deint_blend },
+    { "resize_w",          k_resize_w },
+    { "resize_h",          k_resize_h },
+    { "reduce",            k_reduce },
+    { "flip_v",            k_flip_v },
+    { "flip_h",            k_flip_h },
+    { "gamma",             k_gamma },
+    { "antialias",         k_antialias },
+    { "match",             k_match },
+    { "affine",            k_affine },
+    { NULL }
+};
+
+/*************************************************************************/
+
+static int testtime = DEF_TESTTIME;
+static int csv = 0;
+static const char *pattern = NULL;
+
+static void print_header(const char *section, const char *size)
+{
+    int i;
+
+    if (csv)
+        return;
+    printf("\n%s @ %s (%s/pixel)\n%-24s", section, size, CLOCK_UNIT, "");
+    for (i = 0; i < n_used; i++)
+        printf(" %7s", used_name[i]);
+    printf("\n");
+}
+
+/* Time one kernel at all levels and print a result row */
+static void run_kernel(const char *section, const char *size,
+                       const char *name, int (*func)(BenchData *),
+                       BenchData *bd)
+{
+    int i;
+
+    if (pattern && !strstr(name, pattern) && !strstr(section, pattern))
+        return;
+    if (!csv) {
+        printf("%-24s", name);
+        fflush(stdout);
+    }
+    for (i = 0; i < n_used; i++) {
+        double t;
+
+        ac_init(used_accel[i]);
+        t = timeit(func, bd, testtime);
+        if (csv) {
+            printf("%s,%s,%s,%s,", section, name, size, used_name[i]);
+            if (t >= 0)
+                printf("%.4f\n", t);
+            else
+                printf("%s\n", t == -1 ? "FAIL" : t == -2 ? "SEGV" : "ILL");
+        } else if (t >= 0) {
+            printf(" %7.3f", t);
+        } else {
+            printf(" %7s", t == -1 ? "FAIL" : t == -2 ? "SEGV" : "ILL");
+        }
+        fflush(stdout);
+    }
+    if (!csv)
+        printf("\n");
+}
+
+static void bench_size(const char *size, int width, int height)
+{
+    BenchData bd;
+    /* room for expand's borders too */
+    size_t bufsize = (size_t)(width + 16) * (height + 16) * 6 + 64;
+    uint8_t *srcbase = malloc(bufsize), *destbase = malloc(bufsize);
+    char name[64];
+    size_t n;
+    int i, j;
+
+    if (!srcbase || !destbase) {
+        fprintf(stderr, "Out of memory for %dx%d\n", width, height);
+        exit(1);
+    }
+    memset(&bd, 0, sizeof(bd));
+    bd.src    = (uint8_t *)(((uintptr_t)srcbase  + 63) & ~(uintptr_t)63);
+    bd.dest   = (uint8_t *)(((uintptr_t)destbase + 63) & ~(uintptr_t)63);
+    bd.width  = width;
+    bd.height = height;
+    bd.tcv    = tcv_init();
+    for (n = 0; n < bufsize - 64; n++)
+        bd.src[n] = rand() >> 8;
+
+    /* Only registered pairs succeed at AC_NONE: that's the enumeration */
+    print_header("imgconvert", size);
+    ac_init(AC_NONE);
+    for (i = 0; fmtlist[i].fmt != IMG_NONE; i++) {
+        for (j = 0; fmtlist[j].fmt != IMG_NONE; j++) {
+            bd.srcfmt  = fmtlist[i].fmt;
+            bd.destfmt = fmtlist[j].fmt;
+            if (i == j || !k_imgconvert(&bd))
+                continue;
+            snprintf(name, sizeof(name), "%s->%s",
+                     fmtlist[i].name, fmtlist[j].name);
+            run_kernel("imgconvert", size, name, k_imgconvert, &bd);
+        }
+    }
+
+    print_header("aclib", size);
+    for (i = 0; aclib_kernels[i].name; i++) {
+        run_kernel("aclib", size, aclib_kernels[i].name,
+                   aclib_kernels[i].func, &bd);
+    }
+
+    print_header("tcvideo", size);
+    for (bd.Bpp = 1; bd.Bpp <= 3; bd.Bpp += 2) {
+        for (i = 0; tcv_kernels[i].name; i++) {
+            snprintf(name, sizeof(name), "%s/%s",
+                     tcv_kernels[i].name, bd.Bpp == 1 ? "Y" : "RGB");
+            run_kernel("tcvideo", size, name, tcv_kernels[i].func, &bd);
+        }
+    }
+
+    print_header("zoom", size);
+    for (i = TCV_ZOOM_HERMITE; i < TCV_ZOOM_NULL; i++) {
+        int new_w = (width * 3 / 4) & ~1, new_h = (height * 3 / 4) & ~1;
+
+        bd.zoom = zoom_init(width, height, new_w, new_h, 1,
+                            width, new_w, (TCVZoomFilter)i);
+        if (!bd.zoom) {
+            fprintf(stderr, "zoom_init(%s) failed\n",
+                    tcv_zoom_filter_to_string(i));
+            continue;
+        }
+        run_kernel("zoom", size, tcv_zoom_filter_to_string(i), k_zoom, &bd);
+        zoom_free(bd.zoom);
+        bd.zoom = NULL;
+    }
+
+    tcv_free(bd.tcv);
+    free(srcbase);
+    free(destbase);
+}
+
+/*************************************************************************/
+
+int main(int argc, char *argv[])
+{
+    char *sizes = strdup(DEF_SIZES), *size, *saveptr = NULL;
+    int cpu = ac_cpuinfo();
+    int ch, i;
+
+    libtc_init(&argc, &argv);
+    while ((ch = getopt(argc, argv, "hk:ms:t:")) != EOF) {
+        if (ch == 'k') {
+            pattern = optarg;
+        } else if (ch == 'm') {
+            csv = 1;
+        } else if (ch == 's') {
+            free(sizes);
+            sizes = strdup(optarg);
+        } else if (ch == 't') {
+            testtime = atoi(optarg);
+        } else {
+          usage:
+            fprintf(stderr,
+"Usage: %s [-k pattern] [-m] [-s size[,size...]] [-t msec-per-test]\n"
+"-k: only run kernels whose name or section contains `pattern'\n"
+"-m: machine-readable output (section,kernel,size,level,%s/pixel)\n"
+"-s: frame sizes, among sd, hd, uhd or WIDTHxHEIGHT [%s]\n"
+"-t: minimum time per kernel and acceleration level [%d]\n",
+                    argv[0], CLOCK_UNIT, DEF_SIZES, DEF_TESTTIME);
+            return 1;
+        }
+    }
+    if (testtime <= 0 || !sizes)
+        goto usage;
+
+    for (i = 0; levels[i].name; i++) {
+        int accel = levels[i].accel & cpu;
+        if (n_used > 0 && accel == used_accel[n_used-1])
+            continue;
+        used_accel[n_used] = accel;
+        used_name[n_used]  = levels[i].name;
+        n_used++;
+    }
+    if (!csv) {
+        printf("CPU:%s\n", ac_flagstotext(cpu));
+        for (i = 0; i < n_used; i++)
+            printf("%-5s=%s\n", used_name[i], ac_flagstotext(used_accel[i]));
+    }
+
+    for (size = strtok_r(sizes, ",", &saveptr); size;
+         size = strtok_r(NULL, ",", &saveptr)) {
+        int width = 0, height = 0;
+
+        for (i = 0; sizelist[i].name; i++) {
+            if (strcmp(size, sizelist[i].name) == 0) {
+                width  = sizelist[i].width;
+                height = sizelist[i].height;
+                break;
+            }
+        }
+        if (!width && (sscanf(size, "%dx%d", &width, &height) != 2
+                       || width < 16 || height < 16
+                       || width % 16 || height % 16)) {
+            fprintf(stderr, "Invalid size `%s' (dimensions must be"
+                    " multiples of 16)\n", size);
+            return 1;
+        }
+        bench_size(size, width, height);
+    }
+
+    free(sizes);
+    return 0;
+}
+
+/*************************************************************************/
+
+/*
+ * Local variables:
+ *   c-file-style: "stroustrup"
+ *   c-file-offsets: ((case-label . *) (statement-case-intro . *))
+ *   indent-tabs-mode: nil
+ * End:
+ *
+ * vim: expandtab shiftwidth=4:
+ */
@@ -0,0 +1,272 @@
+/*
+ * test-match.c - check the aclib block comparison routines and the
+ *                libtcvideo template search
+ *
+ * This file is part of transcode, a video stream processing tool.
+ * transcode is free software, distributable under the terms of the GNU
+ * General Public License (version 2 or later).  See the file COPYING
+ * for details.
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "config.h"
+
+#define ac_sad local_ac_sad  /* to avoid clash with libac.a */
+#define ac_correlate local_ac_correlate
+#define ac_match_init local_ac_match_init
+#include "aclib/ac.h"
+
+/* Include match.c directly for access to the implementations */
+#include "../aclib/match.c"
+
+#undef ac_sad
+#undef ac_correlate
+#undef ac_match_init
+#include "libtcvideo/tcvideo.h"
+
+#define WIDTH   160     /* test picture width in pixels */
+#define HEIGHT  120     /* test picture height */
+#define PWIDTH  23      /* pattern width (odd, to test the row tails) */
+#define PHEIGHT 17      /* pattern height */
+
+/*************************************************************************/
+
+static uint8_t picture[HEIGHT][WIDTH*3];
+static uint8_t pattern[PHEIGHT*PWIDTH*3];
+static uint8_t mask[PHEIGHT*PWIDTH*3];
+
+static void make_picture(int seed)
+{
+    int x, y;
+
+    srand(seed);
+    for (y = 0; y < HEIGHT; y++) {
+        for (x = 0; x < WIDTH*3; x++) {
+            /* the extremes often, to catch overflows */
+            int r = rand() % 8;
+            picture[y][x] = (r == 0) ? 0 : (r == 1) ? 255 : rand() % 256;
+        }
+    }
+}
+
+/* Sets a random mask, and copies the pattern from the picture at (x,y)
+ * with garbage in the bytes the mask excludes. */
+static void make_pattern(int x, int y, int Bpp)
+{
+    int i, j;
+
+    for (i = 0; i < PHEIGHT; i++) {
+        for (j = 0; j < PWIDTH*Bpp; j++) {
+            int k = i*PWIDTH*Bpp + j;
+            mask[k] = (rand() % 4) ? 0xFF : 0x00;
+            pattern[k] = mask[k] ? picture[y+i][x*Bpp+j] : rand() % 256;
+        }
+    }
+}
+
+/*************************************************************************/
+
+/* Runs both functions once with the C and the SSE2 version; returns 1
+ * if they agree, 0 if not. */
+
+static int test_once(const uint8_t *src1, const uint8_t *src2,
+                     const uint8_t *msk, int bytes, int verbose)
+{
+#if defined(HAVE_ASM_SSE2) && defined(ARCH_X86_64)
+    uint32_t sad_c, sad_s, sums_c[3], sums_s[3];
+
+    sad_c = sad(src1, src2, msk, bytes);
+    sad_s = sad_sse2(src1, src2, msk, bytes);
+    correlate(src1, src2, msk, bytes, sums_c);
+    correlate_sse2(src1, src2, msk, bytes, sums_s);
+    if (sad_c != sad_s || memcmp(sums_c, sums_s, sizeof(sums_c)) != 0) {
+        if (verbose > 0) {
+            printf("FAILED (%d bytes, %s: sad %u/%u, sums %u/%u %u/%u"
+                   " %u/%u)\n", bytes, msk ? "masked" : "unmasked",
+                   sad_c, sad_s, sums_c[0], sums_s[0], sums_c[1], sums_s[1],
+                   sums_c[2], sums_s[2]);
+        }
+        return 0;
+    }
+    return 1;
+#else
+    return -1;
+#endif
+}
+
+static int test_sse2(int verbose)
+{
+    static uint8_t big1[65536], big2[65536];
+    int bytes, i, ret = 1;
+
+    if (!(ac_cpuinfo() & AC_SSE2)) {
+        printf("WARNING: unable to test (no support in CPU)\n");
+        return -1;
+    }
+    make_picture(1);
+    make_pattern(0, 0, 3);
+    for (bytes = 0; bytes <= PWIDTH*PHEIGHT*3 - 8 && ret > 0;
+         bytes += 1 + bytes/8) {
+        int off = rand() % 8;
+        ret = test_once(picture[1] + off, pattern + off, mask + off,
+                        bytes, verbose);
+        if (ret > 0) {
+            ret = test_once(picture[1] + off, pattern + off, NULL,
+                            bytes, verbose);
+        }
+    }
+    /* the largest size whose sums cannot wrap, at full scale */
+    for (i = 0; i < 65536 && ret > 0; i++) {
+        big1[i] = 255;
+        big2[i] = (i & 1) ? 255 : rand() % 256;
+    }
+    if (ret > 0)
+        ret = test_once(big1, big2, NULL, 65536, verbose);
+    if (ret < 0) {
+        printf("WARNING: unable to test (wrong architecture or not"
+               " compiled in)\n");
+    }
+    return ret;
+}
+
+/*************************************************************************/
+
+/* Plants the pattern and looks for it with tcv_match() in a few ways,
+ * with the given acceleration; returns 1 on success, 0 on failure. */
+
+static int test_search(int accel, int verbose)
+{
+    static const struct {
+        int x, y;       /* where the pattern is */
+        int ex, ey;     /* expected position passed in */
+        int radius;
+    } cases[] = {
+        {  0,  0,   0,   0, -1 },
+        { 70, 41,   0,   0, -1 },
+        { 70, 41,  66,  44,  4 },
+        { 70, 41,  62,  44,  8 },
+        { WIDTH-PWIDTH, HEIGHT-PHEIGHT, WIDTH-PWIDTH+2, 500, 3 },
+        { 13, 90,  13,  90,  0 },
+    };
+    static const TCVMatchMethod methods[] = { TCV_MATCH_SAD, TCV_MATCH_NCC };
+    TCVHandle handle = tcv_init();
+    int Bpp, c, m, ret = 1;
+
+    if (!handle) {
+        printf("FAILED (tcv_init)\n");
+        return 0;
+    }
+    if (!ac_init(accel)) {
+        printf("FAILED (ac_init)\n");
+        tcv_free(handle);
+        return 0;
+    }
+    make_picture(2);
+    for (Bpp = 1; Bpp <= 3 && ret; Bpp += 2) {
+        for (c = 0; c < (int)(sizeof(cases) / sizeof(*cases)) && ret; c++) {
+            make_pattern(cases[c].x, cases[c].y, Bpp);
+            for (m = 0; m < 2 && ret; m++) {
+                const uint8_t *msk = (c & 1) ? mask : NULL;
+                double score = -1, perfect = (m == 0) ? 0 : 1;
+                int x = -1, y = -1;
+
+                if (!msk) {
+                    /* no garbage for the unmasked search */
+                    int i;
+                    for (i = 0; i < PHEIGHT; i++) {
+                        memcpy(pattern + i*PWIDTH*Bpp,
+                               picture[cases[c].y+i] + cases[c].x*Bpp,
+                               PWIDTH*Bpp);
+                    }
+                }
+                if (!tcv_match(handle, picture[0], WIDTH*3/Bpp, HEIGHT, Bpp,
+                               pattern, msk, PWIDTH, PHEIGHT, methods[m],
+                               cases[c].ex, cases[c].ey, cases[c].radius,
+                               &x, &y, &score)
+                 || x != cases[c].x || y != cases[c].y
+                 || fabs(score - perfect) > 1e-9
+                ) {
+                    if (verbose > 0) {
+                        printf("FAILED (%s, %d Bpp, %s, case %d:"
+                               " found %d,%d score %g)\n",
+                               m ? "ncc" : "sad", Bpp,
+                               msk ? "masked" : "unmasked", c, x, y, score);
+                    }
+                    ret = 0;
+                }
+            }
+        }
+    }
+    tcv_free(handle);
+    return ret;
+}
+
+/*************************************************************************/
+
+int main(int argc, char *argv[])
+{
+    int verbose = 1;
+    int ch, ret, failed = 0;
+
+    while ((ch = getopt(argc, argv, "hq")) != EOF) {
+        if (ch == 'q') {
+            verbose = 0;
+        } else {
+            fprintf(stderr,
+                    "Usage: %s [-q]\n"
+                    "-q: quiet (don't print test names)\n",
+                    argv[0]);
+            return 1;
+        }
+    }
+
+    if (verbose > 0) {
+        printf("sad/correlate SSE2: ");
+        fflush(stdout);
+    }
+    ret = test_sse2(verbose);
+    if (ret == 0) {
+        failed = 1;
+    } else if (ret > 0 && verbose > 0) {
+        printf("ok\n");
+    }
+
+    if (verbose > 0) {
+        printf("search C: ");
+        fflush(stdout);
+    }
+    if (!test_search(AC_NONE, verbose)) {
+        failed = 1;
+    } else if (verbose > 0) {
+        printf("ok\n");
+    }
+
+    if (verbose > 0) {
+        printf("search accelerated: ");
+        fflush(stdout);
+    }
+    if (!test_search(AC_ALL, verbose)) {
+        failed = 1;
+    } else if (verbose > 0) {
+        printf("ok\n");
+    }
+
+    return failed ? 1 : 0;
+}
+
+/*************************************************************************/
+
+/*
+ * Local variables:
+ *   c-file-style: "stroustrup"
+ *   c-file-offsets: ((case-label . *) (statement-case-intro . *))
+ *   indent-tabs-mode: nil
+ * End:
+ *
+ * vim: expandtab shiftwidth=4:
+ */
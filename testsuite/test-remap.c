@@ -0,0 +1,284 @@
+/*
+ * test-remap.c - check the aclib bilinear remapping routine and the
+ *                libtcvideo affine transformation
+ *
+ * This file is part of transcode, a video stream processing tool.
+ * transcode is free software, distributable under the terms of the GNU
+ * General Public License (version 2 or later).  See the file COPYING
+ * for details.
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "config.h"
+
+#define ac_remap_bilinear local_ac_remap_bilinear  /* to avoid clash */
+#define ac_remap_init local_ac_remap_init          /*   with libac.a  */
+#include "aclib/ac.h"
+
+/* Include remap.c directly for access to the implementations */
+#include "../aclib/remap.c"
+
+#undef ac_remap_bilinear
+#undef ac_remap_init
+#include "libtcvideo/tcvideo.h"
+
+#define WIDTH   97      /* test picture width in pixels (odd on purpose) */
+#define HEIGHT  61      /* test picture height */
+#define COUNT   1000    /* pixels sampled in the kernel test */
+
+/*************************************************************************/
+
+static uint8_t picture[HEIGHT][WIDTH*3];
+
+static void make_picture(int seed)
+{
+    int x, y;
+
+    srand(seed);
+    for (y = 0; y < HEIGHT; y++) {
+        for (x = 0; x < WIDTH*3; x++) {
+            /* the extremes often, to catch overflows */
+            int r = rand() % 8;
+            picture[y][x] = (r == 0) ? 0 : (r == 1) ? 255 : rand() % 256;
+        }
+    }
+}
+
+/*************************************************************************/
+
+/* Samples COUNT random positions with the C and the SSE2 version, for
+ * every count up to COUNT in some steps; returns 1 if they agree, 0 if
+ * not, -1 if the SSE2 version is not available. */
+
+static int test_sse2(int verbose)
+{
+#if defined(HAVE_ASM_SSE2) && defined(ARCH_X86_64)
+    static int32_t offset[COUNT];
+    static int16_t weight[COUNT*4];
+    static uint8_t out_c[COUNT], out_s[COUNT];
+    int count, i;
+
+    if (!(ac_cpuinfo() & AC_SSE2)) {
+        printf("WARNING: unable to test (no support in CPU)\n");
+        return -1;
+    }
+    make_picture(1);
+    for (i = 0; i < COUNT; i++) {
+        int fx = (i % 5 == 0) ? 0 : (i % 5 == 1) ? 127 : rand() % 128;
+        int fy = (i % 7 == 0) ? 0 : (i % 7 == 1) ? 127 : rand() % 128;
+        offset[i] = (rand() % (HEIGHT-1)) * WIDTH + rand() % (WIDTH-1);
+        weight[i*4+0] = 128 - fx;
+        weight[i*4+1] = fx;
+        weight[i*4+2] = 128 - fy;
+        weight[i*4+3] = fy;
+    }
+    for (count = 0; count <= COUNT; count += 1 + count/4) {
+        memset(out_c, 0x5A, sizeof(out_c));
+        memset(out_s, 0x5A, sizeof(out_s));
+        remap_bilinear(picture[0], WIDTH, 1, offset, weight, out_c, count);
+        remap_bilinear_sse2(picture[0], WIDTH, 1, offset, weight, out_s,
+                            count);
+        if (memcmp(out_c, out_s, sizeof(out_c)) != 0) {
+            if (verbose > 0)
+                printf("FAILED (%d pixels)\n", count);
+            return 0;
+        }
+    }
+    return 1;
+#else
+    printf("WARNING: unable to test (wrong architecture or not"
+           " compiled in)\n");
+    return -1;
+#endif
+}
+
+/*************************************************************************/
+
+/* Transforms the picture with tcv_affine() in a few ways, with the given
+ * acceleration, and checks the result against a floating point bilinear
+ * interpolation (to within rounding, plus what the position may move in
+ * 1/128 pixel steps), and that doing the rows in two bands changes
+ * nothing; returns 1 on success, 0 on failure. */
+
+static int test_affine(int accel, int verbose)
+{
+    static const struct {
+        double angle, scale, tx, ty;
+        int fill;
+    } cases[] = {
+        { 0,     1,    0,    0,     -1 },
+        { 0,     1,    5,   -3,     16 },
+        { 0.01,  1,    0.3,  0.7,   -1 },
+        { 0.3,   1,   -2.5,  4.25, 128 },
+        { -1.2,  0.8,  0,    0,      0 },
+        { 3.0,   1.7, 10,  -20,    255 },
+    };
+    static uint8_t out[HEIGHT][WIDTH*3], out2[HEIGHT][WIDTH*3];
+    TCVHandle handle = tcv_init();
+    int Bpp, c, x, y, i, ret = 1;
+
+    if (!handle) {
+        printf("FAILED (tcv_init)\n");
+        return 0;
+    }
+    if (!ac_init(accel)) {
+        printf("FAILED (ac_init)\n");
+        tcv_free(handle);
+        return 0;
+    }
+    make_picture(2);
+    for (Bpp = 1; Bpp <= 3 && ret; Bpp += 2) {
+        int width = WIDTH*3/Bpp;
+        for (c = 0; c < (int)(sizeof(cases) / sizeof(*cases)) && ret; c++) {
+            double cs = cos(cases[c].angle) / cases[c].scale;
+            double sn = sin(cases[c].angle) / cases[c].scale;
+            double m[6];
+            m[0] = cs;
+            m[1] = sn;
+            m[2] = -cs*width/2 - sn*HEIGHT/2 + width/2 - cases[c].tx;
+            m[3] = -sn;
+            m[4] = cs;
+            m[5] = sn*width/2 - cs*HEIGHT/2 + HEIGHT/2 - cases[c].ty;
+
+            for (y = 0; y < HEIGHT; y++) {
+                for (x = 0; x < width*Bpp; x++)
+                    out[y][x] = out2[y][x] = (x + y) & 0xFF;
+            }
+            if (!tcv_affine(handle, picture[0], width, HEIGHT, Bpp,
+                            out[0], width, HEIGHT, m, cases[c].fill,
+                            0, HEIGHT)
+             || !tcv_affine(handle, picture[0], width, HEIGHT, Bpp,
+                            out2[0], width, HEIGHT, m, cases[c].fill,
+                            HEIGHT/3, HEIGHT)
+             || !tcv_affine(handle, picture[0], width, HEIGHT, Bpp,
+                            out2[0], width, HEIGHT, m, cases[c].fill,
+                            0, HEIGHT/3)
+            ) {
+                if (verbose > 0)
+                    printf("FAILED (%d Bpp, case %d: call failed)\n", Bpp, c);
+                ret = 0;
+                break;
+            }
+            if (memcmp(out, out2, sizeof(out)) != 0) {
+                if (verbose > 0)
+                    printf("FAILED (%d Bpp, case %d: bands differ)\n",
+                           Bpp, c);
+                ret = 0;
+                break;
+            }
+            for (y = 0; y < HEIGHT && ret; y++) {
+                for (x = 0; x < width && ret; x++) {
+                    double sx = m[0]*x + m[1]*y + m[2];
+                    double sy = m[3]*x + m[4]*y + m[5];
+                    int ix = floor(sx), iy = floor(sy);
+                    double fx = sx - ix, fy = sy - iy;
+                    for (i = 0; i < Bpp; i++) {
+                        double tap[4], expect, lo = 255, hi = 0;
+                        int k;
+                        /* the 4x4 pixels around, as the position found
+                         * may be on the other side of a pixel edge */
+                        for (k = 0; k < 16; k++) {
+                            int kx = k & 3, ky = k >> 2;
+                            int px = ix - 1 + kx, py = iy - 1 + ky;
+                            double v;
+                            if (px < 0 || px >= width
+                             || py < 0 || py >= HEIGHT) {
+                                v = cases[c].fill < 0
+                                  ? (x*Bpp + i + y) & 0xFF : cases[c].fill;
+                            } else {
+                                v = picture[py][px*Bpp+i];
+                            }
+                            if (kx >= 1 && kx <= 2 && ky >= 1 && ky <= 2)
+                                tap[(ky-1)*2 + kx-1] = v;
+                            lo = (v < lo) ? v : lo;
+                            hi = (v > hi) ? v : hi;
+                        }
+                        expect = (tap[0]*(1-fx) + tap[1]*fx) * (1-fy)
+                               + (tap[2]*(1-fx) + tap[3]*fx) * fy;
+                        if (fabs(out[y][x*Bpp+i] - expect)
+                            > 1 + (hi - lo) / 64) {
+                            if (verbose > 0) {
+                                printf("FAILED (%d Bpp, case %d, pixel"
+                                       " %d,%d: %d, expected %g)\n", Bpp,
+                                       c, x, y, out[y][x*Bpp+i], expect);
+                            }
+                            ret = 0;
+                        }
+                    }
+                }
+            }
+        }
+    }
+    tcv_free(handle);
+    return ret;
+}
+
+/*************************************************************************/
+
+int main(int argc, char *argv[])
+{
+    int verbose = 1;
+    int ch, ret, failed = 0;
+
+    while ((ch = getopt(argc, argv, "hq")) != EOF) {
+        if (ch == 'q') {
+            verbose = 0;
+        } else {
+            fprintf(stderr,
+                    "Usage: %s [-q]\n"
+                    "-q: quiet (don't print test names)\n",
+                    argv[0]);
+            return 1;
+        }
+    }
+
+    if (verbose > 0) {
+        printf("remap_bilinear SSE2: ");
+        fflush(stdout);
+    }
+    ret = test_sse2(verbose);
+    if (ret == 0) {
+        failed = 1;
+    } else if (ret > 0 && verbose > 0) {
+        printf("ok\n");
+    }
+
+    if (verbose > 0) {
+        printf("affine C: ");
+        fflush(stdout);
+    }
+    if (!test_affine(AC_NONE, verbose)) {
+        failed = 1;
+    } else if (verbose > 0) {
+        printf("ok\n");
+    }
+
+    if (verbose > 0) {
+        printf("affine accelerated: ");
+        fflush(stdout);
+    }
+    if (!test_affine(AC_ALL, verbose)) {
+        failed = 1;
+    } else if (verbose > 0) {
+        printf("ok\n");
+    }
+
+    return failed ? 1 : 0;
+}
+
+/*************************************************************************/
+
+/*
+ * Local variables:
+ *   c-file-style: "stroustrup"
+ *   c-file-offsets: ((case-label . *) (statement-case-intro . *))
+ *   indent-tabs-mode: nil
+ * End:
+ *
+ * vim: expandtab shiftwidth=4:
+ */
@@ -0,0 +1,324 @@
+/*
+ * test-rtjpeg.c - check the context based RTjpeg decoder against the
+ *                 original one
+ *
+ * This file is part of transcode, a video stream processing tool.
+ * transcode is free software, distributable under the terms of the GNU
+ * General Public License (version 2 or later).  See the file COPYING
+ * for details.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/time.h>
+
+#include "config.h"
+#include "aclib/ac.h"
+
+/* Include RTjpegN.c directly for access to the IDCT implementations */
+#include "../import/nuv/RTjpegN.c"
+
+/* Value of the pixels the decoders should not touch */
+static const uint8_t UNTOUCHED = 0x5A;
+
+/*************************************************************************/
+
+static double now(void)
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+/* Smooth gradients, some flat areas and some noise. */
+static void make_picture(uint8_t *buf, int width, int height, int seed)
+{
+    uint8_t *u = buf + width*height;
+    uint8_t *v = u + width*height/4;
+    int x, y;
+
+    srand(seed);
+    for (y = 0; y < height; y++) {
+        for (x = 0; x < width; x++) {
+            int val = 16 + (x*3 + y*2 + seed*7) % 220;
+            if (y > height/2 && x < width/2) {
+                val = 128;  /* flat */
+            } else if (x > width/2) {
+                val += rand() % 40 - 20;  /* noise */
+            }
+            buf[y*width + x] = val < 0 ? 0 : val > 255 ? 255 : val;
+        }
+    }
+    for (y = 0; y < height/2; y++) {
+        for (x = 0; x < width/2; x++) {
+            u[y*width/2 + x] = 64 + (x + seed) % 128;
+            v[y*width/2 + x] = 200 - (y*3) % 128;
+        }
+    }
+}
+
+/*************************************************************************/
+
+/*
+ * Feed random blocks to both IDCTs, including out of range values.
+ * Returns 1 if they agree, 0 if not, -1 if the test can't be run.
+ */
+static int test_idct(int verbose)
+{
+#if defined(HAVE_ASM_SSE2) && defined(ARCH_X86_64)
+    int16_t levels[64] __attribute__((aligned(16)));
+    int16_t qtbl[64] __attribute__((aligned(16)));
+    uint8_t out_c[64], out_sse2[64];
+    int n, i;
+
+    if (!(ac_cpuinfo() & AC_SSE2)) {
+        printf("WARNING: unable to test (no support in CPU)\n");
+        return -1;
+    }
+    srand(1);
+    for (n = 0; n < 100000; n++) {
+        /* sparse blocks first, then dense and then huge values */
+        int density = (n < 30000) ? 8 : 64;
+        int range = (n < 60000) ? 32 : 256;
+        for (i = 0; i < 64; i++) {
+            levels[i] = (rand() % 64 < density) ? rand()%range - range/2 : 0;
+            qtbl[i] = (n < 90000) ? 1 + rand()%200 : rand();
+        }
+        levels[0] = rand() % 256;
+        RTjpeg_idct_c(out_c, levels, qtbl, 8);
+        RTjpeg_idct_sse2(out_sse2, levels, qtbl, 8);
+        if (memcmp(out_c, out_sse2, 64) != 0) {
+            if (verbose > 0) {
+                printf("FAILED (block %d)\n", n);
+            }
+            return 0;
+        }
+    }
+    return 1;
+#else
+    printf("WARNING: unable to test (wrong architecture or not"
+           " compiled in)\n");
+    return -1;
+#endif
+}
+
+/*************************************************************************/
+
+/*
+ * Decode `stream' with the original decoder and with the context based
+ * one (whole frame, and row by row backwards), check they agree.
+ */
+static int test_frame(uint32_t *tables, int width, int height,
+                      int8_t *stream, int len, int accel)
+{
+    const int size = width*height*3/2;
+    uint8_t *ref = malloc(size), *out = malloc(size);
+    RTjpegDecoder *dec = RTjpeg_decoder_new(tables, width, height, accel);
+    int i, ok = 1;
+
+    memset(ref, UNTOUCHED, size);
+    RTjpeg_init_decompress(tables, width, height);
+    RTjpeg_decompressYUV420(stream, ref);
+
+    memset(out, UNTOUCHED, size);
+    if (RTjpeg_decoder_parseYUV420(dec, stream, len) != len) {
+        ok = 0;
+    }
+    RTjpeg_decoder_idctYUV420(dec, out, 0, RTjpeg_decoder_rows(dec));
+    if (memcmp(ref, out, size) != 0) {
+        ok = 0;
+    }
+
+    memset(out, UNTOUCHED, size);
+    RTjpeg_decoder_parseYUV420(dec, stream, len);
+    for (i = RTjpeg_decoder_rows(dec) - 1; i >= 0; i--) {
+        RTjpeg_decoder_idctYUV420(dec, out, i, i + 1);
+    }
+    if (memcmp(ref, out, size) != 0) {
+        ok = 0;
+    }
+
+    /* a truncated frame must not be decoded past its end */
+    if (RTjpeg_decoder_parseYUV420(dec, stream, len / 2) != -1) {
+        ok = 0;
+    }
+
+    RTjpeg_decoder_free(dec);
+    free(ref);
+    free(out);
+    return ok;
+}
+
+static int test_decode(int accel, int verbose)
+{
+    static const int sizes[][2] = {
+        { 720, 576 }, { 64, 48 }, { 16, 16 }, { 352, 288 }, { 0, 0 }
+    };
+    static const int quality[] = { 32, 128, 255, 0 };
+    int s, q;
+
+    for (s = 0; sizes[s][0] > 0; s++) {
+        const int width = sizes[s][0], height = sizes[s][1];
+        const int size = width*height*3/2;
+        uint8_t *pic = malloc(size);
+        int8_t *stream = malloc(size*2);
+        uint32_t tables[128];
+        int len;
+
+        for (q = 0; quality[q] > 0; q++) {
+            if (verbose >= 2) {
+                printf("%dx%d Q=%d ", width, height, quality[q]);
+                fflush(stdout);
+            }
+            make_picture(pic, width, height, q);
+            RTjpeg_init_compress(tables, width, height, quality[q]);
+            len = RTjpeg_compressYUV420(stream, pic);
+            if (!test_frame(tables, width, height, stream, len, accel)) {
+                if (verbose > 0) {
+                    printf("FAILED (%dx%d, Q=%d)\n",
+                           width, height, quality[q]);
+                }
+                return 0;
+            }
+        }
+
+        if (s == 0) {
+            /* motion compressed frames, with blocks left out */
+            RTjpeg_init_mcompress();
+            make_picture(pic, width, height, 1);
+            RTjpeg_mcompressYUV420(stream, pic, 1, 1);
+            memset(pic, 200, width*16);
+            len = RTjpeg_mcompressYUV420(stream, pic, 1, 1);
+            if (!test_frame(tables, width, height, stream, len, accel)) {
+                if (verbose > 0) {
+                    printf("FAILED (motion compressed)\n");
+                }
+                return 0;
+            }
+        }
+        free(pic);
+        free(stream);
+    }
+    return 1;
+}
+
+/*************************************************************************/
+
+/* Frames per second of each decoder on a 720x576 picture. */
+static void speed(int frames)
+{
+    const int width = 720, height = 576, size = width*height*3/2;
+    uint8_t *pic = malloc(size);
+    int8_t *stream = malloc(size*2);
+    uint32_t tables[128];
+    RTjpegDecoder *dec;
+    double start;
+    int i, len;
+
+    make_picture(pic, width, height, 0);
+    RTjpeg_init_compress(tables, width, height, 255);
+    len = RTjpeg_compressYUV420(stream, pic);
+
+    RTjpeg_init_decompress(tables, width, height);
+    start = now();
+    for (i = 0; i < frames; i++) {
+        RTjpeg_decompressYUV420(stream, pic);
+    }
+    printf("original:   %8.1f fps\n", frames / (now() - start));
+
+    dec = RTjpeg_decoder_new(tables, width, height, AC_NONE);
+    start = now();
+    for (i = 0; i < frames; i++) {
+        RTjpeg_decoder_decompressYUV420(dec, stream, len, pic);
+    }
+    printf("context C:  %8.1f fps\n", frames / (now() - start));
+    RTjpeg_decoder_free(dec);
+
+    if (ac_cpuinfo() & AC_SSE2) {
+        dec = RTjpeg_decoder_new(tables, width, height, AC_SSE2);
+        start = now();
+        for (i = 0; i < frames; i++) {
+            RTjpeg_decoder_decompressYUV420(dec, stream, len, pic);
+        }
+        printf("context SSE2:%7.1f fps\n", frames / (now() - start));
+        RTjpeg_decoder_free(dec);
+    }
+    free(pic);
+    free(stream);
+}
+
+/*************************************************************************/
+
+int main(int argc, char *argv[])
+{
+    int verbose = 1, frames = 0;
+    int ch, ret, failed = 0;
+
+    while ((ch = getopt(argc, argv, "hqs:v")) != EOF) {
+        if (ch == 'q') {
+            verbose = 0;
+        } else if (ch == 'v') {
+            verbose = 2;
+        } else if (ch == 's') {
+            frames = atoi(optarg);
+        } else {
+            fprintf(stderr,
+                    "Usage: %s [-q | -v] [-s frames]\n"
+                    "-q: quiet (don't print test names)\n"
+                    "-v: verbose (print each picture size as processed)\n"
+                    "-s: measure the decoding speed on that many frames\n",
+                    argv[0]);
+            return 1;
+        }
+    }
+
+    if (verbose > 0) {
+        printf("idct sse2: ");
+        fflush(stdout);
+    }
+    ret = test_idct(verbose);
+    if (ret == 0) {
+        failed = 1;
+    } else if (ret > 0 && verbose > 0) {
+        printf("ok\n");
+    }
+
+    if (verbose > 0) {
+        printf("decode C: ");
+        fflush(stdout);
+    }
+    if (!test_decode(AC_NONE, verbose)) {
+        failed = 1;
+    } else if (verbose > 0) {
+        printf("ok\n");
+    }
+
+    if (verbose > 0) {
+        printf("decode accelerated: ");
+        fflush(stdout);
+    }
+    if (!test_decode(ac_cpuinfo(), verbose)) {
+        failed = 1;
+    } else if (verbose > 0) {
+        printf("ok\n");
+    }
+
+    if (frames > 0) {
+        speed(frames);
+    }
+    return failed ? 1 : 0;
+}
+
+/*************************************************************************/
+
+/*
+ * Local variables:
+ *   c-file-style: "stroustrup"
+ *   c-file-offsets: ((case-label . *) (statement-case-intro . *))
+ *   indent-tabs-mode: nil
+ * End:
+ *
+ * vim: expandtab shiftwidth=4:
+ */
@@ -0,0 +1,206 @@
+/*
+ * test-synchronizer.c - check the resample A/V synchronization method
+ *
+ * This file is part of transcode, a video stream processing tool.
+ * transcode is free software, distributable under the terms of the GNU
+ * General Public License (version 2 or later).  See the file COPYING
+ * for details.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <math.h>
+
+#include "config.h"
+#include "libtc/libtc.h"
+
+/* Include synchronizer.c directly for access to the method context */
+#include "../src/synchronizer.c"
+
+#define RATE    48000
+#define FPS     25
+#define CHANS   2
+#define FREQ    440.0
+#define AMPL    10000.0
+
+/*************************************************************************/
+
+/*
+ * Fake capture: video frames at exactly FPS, audio sampled by a clock
+ * running `drift' faster than the video one. Frames are timestamped
+ * with their capture time, in microseconds.
+ */
+typedef struct {
+    double drift;
+    long vframes;
+    long asamples;
+} Source;
+
+static int fill_video(void *ud, TCFrameVideo *vf)
+{
+    Source *src = ud;
+    vf->timestamp = 1 + src->vframes * 1000000LL / FPS;
+    src->vframes++;
+    return TC_OK;
+}
+
+static double source_sample(const Source *src, double i)
+{
+    return AMPL * sin(2.0 * M_PI * FREQ * i / (RATE * (1.0 + src->drift)));
+}
+
+static int fill_audio(void *ud, TCFrameAudio *af)
+{
+    Source *src = ud;
+    int16_t *buf = (int16_t *)af->audio_buf;
+    const int n = RATE / FPS;
+    int i;
+
+    af->timestamp = 1 + (uint64_t)(src->asamples * 1000000.0
+                                   / (RATE * (1.0 + src->drift)));
+    for (i = 0; i < n; i++) {
+        buf[i*CHANS] = lrint(source_sample(src, src->asamples + i));
+        buf[i*CHANS + 1] = -buf[i*CHANS];
+    }
+    src->asamples += n;
+    af->audio_len  = n * CHANS * sizeof(int16_t);
+    af->audio_size = af->audio_len;
+    return TC_OK;
+}
+
+/*************************************************************************/
+
+/*
+ * Run `frames' frames through the resample method with the given drift.
+ * Returns 1 if the audio stays in sync (and, without drift, untouched),
+ * 0 if not.
+ */
+static int test_drift(double drift, int frames, int verbose)
+{
+    const int bytes = RATE / FPS * CHANS * sizeof(int16_t);
+    vob_t vob;
+    Source src = { drift, 0, 0 };
+    TCFrameVideo vf;
+    TCFrameAudio *af = tc_new_audio_frame(RATE / FPS * 2, CHANS, 16);
+    ResampleContext *ctx;
+    double worst_pos = 0.0, worst_err = 0.0;
+    int k, m, ok = 1;
+
+    memset(&vob, 0, sizeof(vob));
+    memset(&vf, 0, sizeof(vf));
+    vob.im_a_codec = TC_CODEC_PCM;
+    vob.a_bits     = 16;
+    vob.a_chan     = CHANS;
+    vob.a_rate     = RATE;
+    vob.fps        = FPS;
+    vob.im_a_size  = bytes;
+    if (tc_sync_init(&vob, TC_SYNC_RESAMPLE, TC_AUDIO) != TC_OK) {
+        return 0;
+    }
+    ctx = tcsync.privdata;
+
+    for (k = 0; k < frames; k++) {
+        const int16_t *out = (const int16_t *)af->audio_buf;
+        double end;
+
+        tc_sync_get_video_frame(&vf, fill_video, &src);
+        if (tc_sync_get_audio_frame(af, fill_audio, &src) != TC_OK
+         || af->audio_len != bytes) {
+            ok = 0;
+            break;
+        }
+
+        /* input position of the last output sample vs the video clock */
+        end = ctx->base + ctx->pos - ctx->ratio;
+        if (k >= frames / 2) {
+            double target = (k + 1) * (1.0 + drift) * RATE / FPS - 1;
+            if (fabs(end - target) > worst_pos) {
+                worst_pos = fabs(end - target);
+            }
+        }
+
+        /* the output must be the input at that position */
+        for (m = 0; m < RATE / FPS; m++) {
+            double x = end - (RATE / FPS - 1 - m) * ctx->ratio;
+            double ref = source_sample(&src, x);
+            double err = fabs(out[m*CHANS] - ref);
+            if (drift == 0.0 && out[m*CHANS] != lrint(ref)) {
+                err = AMPL;  /* no drift, no change */
+            }
+            if (out[m*CHANS] != -out[m*CHANS + 1]) {
+                err = AMPL;
+            }
+            if (err > worst_err) {
+                worst_err = err;
+            }
+        }
+    }
+
+    if (verbose >= 2) {
+        printf("drift %+.4f: ratio %.6f, position error %.2f samples,"
+               " sample error %.2f\n",
+               drift, ctx->ratio, worst_pos, worst_err);
+    }
+    /* in sync within a millisecond, filter error below -70dB */
+    if (worst_pos > RATE / 1000 || worst_err > AMPL * 0.0003) {
+        ok = 0;
+    }
+    tc_sync_fini();
+    tc_del_audio_frame(af);
+    return ok;
+}
+
+/*************************************************************************/
+
+int main(int argc, char *argv[])
+{
+    static const double drifts[] = { 0.0, 0.0002, -0.0005, 0.003, 1 };
+    int verbose = 1, failed = 0;
+    int ch, i;
+
+    while ((ch = getopt(argc, argv, "hqv")) != EOF) {
+        if (ch == 'q') {
+            verbose = 0;
+        } else if (ch == 'v') {
+            verbose = 2;
+        } else {
+            fprintf(stderr,
+                    "Usage: %s [-q | -v]\n"
+                    "-q: quiet (don't print test names)\n"
+                    "-v: verbose (print the measured errors)\n",
+                    argv[0]);
+            return 1;
+        }
+    }
+
+    libtc_init(&argc, &argv);
+    for (i = 0; drifts[i] < 1; i++) {
+        if (verbose > 0) {
+            printf("resample drift %+.4f: ", drifts[i]);
+            fflush(stdout);
+        }
+        if (!test_drift(drifts[i], 3000, verbose)) {
+            failed = 1;
+            if (verbose > 0) {
+                printf("FAILED\n");
+            }
+        } else if (verbose > 0) {
+            printf("ok\n");
+        }
+    }
+    return failed ? 1 : 0;
+}
+
+/*************************************************************************/
+
+/*
+ * Local variables:
+ *   c-file-style: "stroustrup"
+ *   c-file-offsets: ((case-label . *) (statement-case-intro . *))
+ *   indent-tabs-mode: nil
+ * End:
+ *
+ * vim: expandtab shiftwidth=4:
+ */
@@ -0,0 +1,186 @@
+/*
+ * test-tcaudio.c - check the libtcaudio gain ramp, accelerated and not
+ *
+ * This file is part of transcode, a video stream processing tool.
+ * transcode is free software, distributable under the terms of the GNU
+ * General Public License (version 2 or later).  See the file COPYING
+ * for details.
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "config.h"
+
+#include "aclib/ac.h"
+#include "libtcaudio/tcaudio.h"
+
+#define SAMPLES 1000    /* samples (all channels) in the test buffer */
+#define SPILL   16      /* bytes checked past the end of the output */
+
+/* Value of the bytes the functions should not touch */
+static const uint8_t UNTOUCHED = 0x5A;
+
+/*************************************************************************/
+
+static int16_t sound[SAMPLES];
+
+static void make_sound(int seed)
+{
+    int i;
+
+    srand(seed);
+    for (i = 0; i < SAMPLES; i++) {
+        /* the extremes often, to catch overflows */
+        int r = rand() % 8;
+        sound[i] = (r == 0) ? -0x8000 : (r == 1) ? 0x7FFF
+                 : (r == 2) ? 0 : rand() % 0x10000 - 0x8000;
+    }
+}
+
+/*************************************************************************/
+
+/* Amplifies `len' samples per channel of the test sound with `handle'
+ * and checks every output sample against the definition; returns the
+ * number of clipped samples, or -1 on failure. */
+
+static int test_ramp(TCAHandle handle, int16_t *out, int len, int chans,
+                     double from, double to, int verbose)
+{
+    int nclip = -1, expect_clip = 0, i;
+    float scale = from, step = (to - from) / (len ? len : 1);
+
+    memset(out, UNTOUCHED, (SAMPLES * sizeof(*out)) + SPILL);
+    memcpy(out, sound, len * chans * sizeof(*out));
+    if (!tca_amplify_ramp(handle, out, len, chans, from, to, &nclip)) {
+        if (verbose > 0)
+            printf("FAILED (call failed)\n");
+        return -1;
+    }
+    for (i = 0; i < len * chans; i++) {
+        float v = (float)sound[i] * (scale + step * (float)(i / chans));
+        long expect = lrintf(v);
+        if (expect > 0x7FFF) {
+            expect = 0x7FFF;
+            expect_clip++;
+        } else if (expect < -0x8000) {
+            expect = -0x8000;
+            expect_clip++;
+        }
+        if (out[i] != expect) {
+            if (verbose > 0) {
+                printf("FAILED (%d channels, %d samples, %g -> %g,"
+                       " sample %d: %d != %ld)\n",
+                       chans, len, from, to, i, out[i], expect);
+            }
+            return -1;
+        }
+    }
+    for (i = 0; i < SPILL; i++) {
+        if (((uint8_t *)(out + len * chans))[i] != UNTOUCHED) {
+            if (verbose > 0)
+                printf("FAILED (%d channels, %d samples: overrun)\n",
+                       chans, len);
+            return -1;
+        }
+    }
+    if (nclip != expect_clip) {
+        if (verbose > 0)
+            printf("FAILED (%d channels, %d samples, %g -> %g:"
+                   " %d clipped, expected %d)\n",
+                   chans, len, from, to, nclip, expect_clip);
+        return -1;
+    }
+    return nclip;
+}
+
+/* Runs the ramp over several lengths and factors with the given
+ * acceleration; returns 1 on success, 0 on failure. */
+
+static int test_accel(int accel, int verbose)
+{
+    static const double factors[][2] = {
+        { 1.0, 1.0 }, { 0.0, 0.0 }, { 0.5, 2.0 }, { 3.7, 0.1 },
+        { -1.0, 1.0 }, { 5.0, 5.0 }, { 1.0/3, 0.999 }, { 100.0, 0.0 },
+        { 40000.0, 1.0 }
+    };
+    static int16_t out[SAMPLES + SPILL/2];
+    TCAHandle handle = tca_init(TCA_S16LE);
+    int chans, len, f, ret = 1;
+
+    if (!handle) {
+        printf("FAILED (tca_init)\n");
+        return 0;
+    }
+    tca_set_accel(handle, accel);
+    make_sound(1);
+    for (chans = 1; chans <= 3 && ret; chans++) {
+        for (len = 0; len * chans <= SAMPLES && ret; len += 1 + len/4) {
+            for (f = 0; f < (int)(sizeof(factors) / sizeof(*factors)) && ret;
+                 f++) {
+                if (test_ramp(handle, out, len, chans, factors[f][0],
+                              factors[f][1], verbose) < 0)
+                    ret = 0;
+            }
+        }
+    }
+    tca_free(handle);
+    return ret;
+}
+
+/*************************************************************************/
+
+int main(int argc, char *argv[])
+{
+    int verbose = 1;
+    int ch, failed = 0;
+
+    while ((ch = getopt(argc, argv, "hq")) != EOF) {
+        if (ch == 'q') {
+            verbose = 0;
+        } else {
+            fprintf(stderr,
+                    "Usage: %s [-q]\n"
+                    "-q: quiet (don't print test names)\n",
+                    argv[0]);
+            return 1;
+        }
+    }
+
+    if (verbose > 0) {
+        printf("gain ramp C: ");
+        fflush(stdout);
+    }
+    if (!test_accel(AC_NONE, verbose)) {
+        failed = 1;
+    } else if (verbose > 0) {
+        printf("ok\n");
+    }
+
+    if (verbose > 0) {
+        printf("gain ramp accelerated: ");
+        fflush(stdout);
+    }
+    if (!test_accel(ac_cpuinfo(), verbose)) {
+        failed = 1;
+    } else if (verbose > 0) {
+        printf("ok\n");
+    }
+
+    return failed ? 1 : 0;
+}
+
+/*************************************************************************/
+
+/*
+ * Local variables:
+ *   c-file-style: "stroustrup"
+ *   c-file-offsets: ((case-label . *) (statement-case-intro . *))
+ *   indent-tabs-mode: nil
+ * End:
+ *
+ * vim: expandtab shiftwidth=4:
+ */
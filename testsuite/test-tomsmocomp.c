@@ -0,0 +1,254 @@
+/*
+ * test-tomsmocomp.c - check the tomsmocomp deinterlacer output against
+ *                     the one of the original SSE version
+ *
+ * This file is part of transcode, a video stream processing tool.
+ * transcode is free software, distributable under the terms of the GNU
+ * General Public License (version 2 or later).  See the file COPYING
+ * for details.
+ */
+
+/*
+ * The SSE version is 32-bit x86 inline assembly, and the SSE2 version
+ * is built on x86-64 only, so both never live in the same binary.
+ * Instead, both are checked against checksums of the SSE version's
+ * output on the same fixed fields: on x86-64 this runs the SSE2 version
+ * (in a single band and split in several), on x86 the SSE version
+ * itself, which keeps the expected values honest.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "config.h"
+
+#include "aclib/ac.h"
+#include "libtcutil/memutils.h"
+
+/* Include the implementations directly, as the filter module does not
+ * export them */
+#if defined(ARCH_X86_64)
+# include "../filter/tomsmocomp/tomsmocompfilter_sse2.c"
+# define HAVE_TOMSMOCOMP
+#elif defined(ARCH_X86) && defined(HAVE_ASM_SSE)
+# include "../filter/tomsmocomp/tomsmocompfilter_sse.c"
+# define HAVE_TOMSMOCOMP
+#endif
+
+#define GUARD   64      /* bytes checked past the end of the frame */
+
+/*************************************************************************/
+
+#ifdef HAVE_TOMSMOCOMP
+
+static const int sizes[][2] = {
+    { 16, 8 }, { 36, 20 }, { 104, 48 }, { 176, 144 }, { 0, 0 }
+};
+
+/* every SearchEffort level, then a higher one */
+static const int efforts[] = { 0, 1, 3, 5, 9, 11, 13, 15, 19, 21, 30, -1 };
+
+/* FNV-1a hash of the SSE version's output, for each size and effort,
+ * over both field orders and both bob modes */
+static const uint32_t expected[][11] = {
+    { 0x01A83E7E, 0xF2A90B4D, 0x78CFF4C7, 0x33784A32, 0xD7C3C243,
+      0x598FEB32, 0x620A2B8E, 0x879D44BC, 0xFDAADC4F, 0x36D40BF4,
+      0xDFF31FA6 },
+    { 0x1D523F0C, 0xA99AA1A6, 0x0EB9C5E8, 0x25F807A3, 0x69687A2E,
+      0xF37857B1, 0x2AF45D34, 0x20071359, 0x2B98571E, 0xDA826FE3,
+      0x2A348675 },
+    { 0x77C040F6, 0x3F4EFA71, 0x3ADFD2CC, 0x15A31813, 0x8FC8E8F4,
+      0x4F002432, 0xBFEAF1E7, 0x4C2D85C1, 0xDADDA85E, 0x3537D8FE,
+      0x495ADB4C },
+    { 0xEDB329DA, 0x69BFA05F, 0x3E18C742, 0xBC10CA0C, 0x59A741A9,
+      0xEABF3504, 0x3613DC59, 0x5F0D277E, 0x513B927D, 0xB965FB22,
+      0x26C6D21B },
+};
+
+static uint32_t seed;
+
+/* Our own generator, so that the fields are the same everywhere */
+static int rnd(void)
+{
+    seed = seed * 1103515245 + 12345;
+    return (seed >> 16) & 0x7FFF;
+}
+
+/* YUY2 frame n: a gradient moving from a frame to the next, so that
+ * the motion searches find something, over noise and flat areas. */
+static void make_frame(uint8_t *buf, int rowsize, int height, int n)
+{
+    int x, y;
+
+    for (y = 0; y < height; y++) {
+        for (x = 0; x < rowsize; x++) {
+            int r = rnd() % 4;
+            buf[y*rowsize + x] = (r == 0) ? (x*3 + y*5 + n*7) & 0xFF
+                               : (r == 1) ? 128 + rnd() % 8
+                               : rnd() & 0xFF;
+        }
+    }
+}
+
+static uint32_t hash(uint32_t h, const uint8_t *buf, int len)
+{
+    int i;
+
+    for (i = 0; i < len; i++) {
+        h = (h ^ buf[i]) * 16777619;
+    }
+    return h;
+}
+
+static void deinterlace(TDeinterlaceInfo *info, int effort, int strangebob,
+                        int threads)
+{
+#ifdef ARCH_X86_64
+    filterDScaler_SSE2(info, effort, strangebob, threads);
+#else
+    filterDScaler_SSE(info, effort, strangebob);
+#endif
+}
+
+/* Deinterlaces the same two frames as the filter does, with both field
+ * orders and bob modes; returns the hash of the outputs. */
+static uint32_t test_effort(int width, int height, int effort, int threads)
+{
+    int rowsize = width * 2, size = rowsize * height;
+    uint8_t *prev = tc_malloc(size), *in = tc_malloc(size);
+    uint8_t *out = tc_malloc(size + GUARD);
+    TPicture pictures[4], *history[4];
+    TDeinterlaceInfo info;
+    uint32_t h = 2166136261U;
+    int topfirst, strangebob, i;
+
+    seed = width * height;
+    make_frame(prev, rowsize, height, 0);
+    make_frame(in, rowsize, height, 1);
+
+    for (i = 0; i < 4; i++) {
+        history[i] = &pictures[i];
+    }
+    memset(&info, 0, sizeof(info));
+    info.PictureHistory = history;
+    info.Overlay        = out;
+    info.OverlayPitch   = rowsize;
+    info.LineLength     = rowsize;
+    info.FrameWidth     = width;
+    info.FrameHeight    = height;
+    info.FieldHeight    = height / 2;
+    info.pMemcpy        = (MEMCPY_FUNC *)memcpy;
+    info.InputPitch     = 2 * rowsize;
+
+    for (topfirst = 0; topfirst <= 1; topfirst++) {
+        /* as in filter_tomsmocomp.c:do_deinterlace() */
+        for (i = 0; i < 4; i++) {
+            uint8_t *frame = (i < 2) ? in : prev;
+            int odd = ((i & 1) == !topfirst);
+            pictures[i].Flags = odd ? PICTURE_INTERLACED_ODD
+                                    : PICTURE_INTERLACED_EVEN;
+            pictures[i].pData = frame + (odd ? rowsize : 0);
+        }
+        for (strangebob = 0; strangebob <= 1; strangebob++) {
+            memset(out, 0x5A, size + GUARD);
+            deinterlace(&info, effort, strangebob, threads);
+            h = hash(h, out, size + GUARD);
+        }
+    }
+
+    tc_free(prev);
+    tc_free(in);
+    tc_free(out);
+    return h;
+}
+
+static int test_all(int threads, int verbose)
+{
+    int i, j, ret = 1;
+
+    for (i = 0; sizes[i][0] > 0; i++) {
+        for (j = 0; efforts[j] >= 0; j++) {
+            uint32_t h = test_effort(sizes[i][0], sizes[i][1], efforts[j],
+                                     threads);
+            if (h != expected[i][j]) {
+                if (verbose > 0) {
+                    printf("FAILED (%dx%d, effort %d: 0x%08X, expected"
+                           " 0x%08X)\n", sizes[i][0], sizes[i][1],
+                           efforts[j], h, expected[i][j]);
+                }
+                ret = 0;
+            }
+        }
+    }
+    return ret;
+}
+
+#endif  /* HAVE_TOMSMOCOMP */
+
+/*************************************************************************/
+
+int main(int argc, char *argv[])
+{
+    static const struct { const char *name; int threads; } tests[] = {
+#ifdef ARCH_X86_64
+        { "SSE2",          1 },
+        { "SSE2, 3 bands", 3 },
+        { "SSE2, 8 bands", 8 },
+#else
+        { "SSE",           1 },
+#endif
+    };
+    int verbose = 1;
+    int ch, i, failed = 0;
+
+    while ((ch = getopt(argc, argv, "hq")) != EOF) {
+        if (ch == 'q') {
+            verbose = 0;
+        } else {
+            fprintf(stderr,
+                    "Usage: %s [-q]\n"
+                    "-q: quiet (don't print test names)\n",
+                    argv[0]);
+            return 1;
+        }
+    }
+
+    for (i = 0; i < sizeof(tests) / sizeof(*tests); i++) {
+        if (verbose > 0) {
+            printf("tomsmocomp %s: ", tests[i].name);
+            fflush(stdout);
+        }
+#ifdef HAVE_TOMSMOCOMP
+# ifndef ARCH_X86_64
+        if (!(ac_cpuinfo() & AC_SSE)) {
+            printf("WARNING: unable to test (no support in CPU)\n");
+            continue;
+        }
+# endif
+        if (!test_all(tests[i].threads, verbose)) {
+            failed = 1;
+        } else if (verbose > 0) {
+            printf("ok\n");
+        }
+#else
+        printf("WARNING: unable to test (wrong architecture or not"
+               " compiled in)\n");
+#endif
+    }
+
+    return failed ? 1 : 0;
+}
+
+/*************************************************************************/
+
+/*
+ * Local variables:
+ *   c-file-style: "stroustrup"
+ *   c-file-offsets: ((case-label . *) (statement-case-intro . *))
+ *   indent-tabs-mode: nil
+ * End:
+ *
+ * vim: expandtab shiftwidth=4:
+ */
@@ -154,8 +154,8 @@ static TCFrameAudio *rawsource_read_audio(TCFrameSource *FS)
 
 static void rawsource_free_video(TCFrameSource *FS, TCFrameVideo *vf)
 {
-    /* nothing to do here. */
-    return;
+    /* give back the picture, if the export layer shared it */
+    tc_restore_video_frame(vf);
 }
 
 static void rawsource_free_audio(TCFrameSource *FS, TCFrameAudio *af)
@@ -105,6 +105,11 @@ int tc_filter_find(const char *name)
     return 0;
 }
 
+void tc_filter_report(int id, int changed)
+{
+    return;
+}
+
 
 
 #ifdef TC_FRAMEBUFFER_STUBS